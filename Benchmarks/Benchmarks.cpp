@@ -0,0 +1,388 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: benchmarks of the launcher's hot paths
+//======================================================================================================================
+
+// All the input data are generated from fixed seeds into a temporary directory, so that the results of different runs
+// and different versions can be compared. Run with "-median 5" or more to filter out the noise of the file system.
+
+#include "UserData.hpp"
+#include "OptionsSerializer.hpp"
+#include "Widgets/ListModel.hpp"
+#include "Utils/WADReader.hpp"
+#include "Utils/FileSystemUtils.hpp"
+#include "Utils/WidgetUtils.hpp"
+#include "Utils/JsonUtils.hpp"
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QRandomGenerator>
+#include <QFile>
+#include <QDir>
+#include <QJsonDocument>
+#include <QStringBuilder>
+#include <QListView>
+
+#include <iterator>  // size
+
+
+//======================================================================================================================
+//  input data generators
+
+/// Writes a PWAD with the given number of lumps, organized into maps of 11 lumps (the marker and its 10 data lumps).
+static void writeSyntheticWad( const QString & filePath, int numLumps )
+{
+	static const char * const mapLumpNames [] = {
+		"THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SEGS", "SSECTORS", "NODES", "SECTORS", "REJECT", "BLOCKMAP"
+	};
+	static constexpr int LumpDataSize = 16;
+
+	QByteArray data;
+	QByteArray directory;
+	auto appendLE32 = []( QByteArray & bytes, qint32 value )
+	{
+		char buffer [4];
+		qToLittleEndian( value, buffer );
+		bytes.append( buffer, 4 );
+	};
+	auto appendLump = [&]( const QByteArray & name, int size )
+	{
+		appendLE32( directory, 12 + data.size() );
+		appendLE32( directory, size );
+		directory.append( name.leftJustified( 8, '\0', /*truncate*/true ) );
+		data.append( size, 'x' );
+	};
+
+	for (int i = 0; i < numLumps; ++i)
+	{
+		int mapIdx = i / 11;
+		int lumpIdx = i % 11;
+		if (lumpIdx == 0)
+			appendLump( "MAP" % QByteArray::number( mapIdx % 100 ).rightJustified( 2, '0' ), 0 );
+		else
+			appendLump( mapLumpNames[ lumpIdx - 1 ], LumpDataSize );
+	}
+
+	QByteArray header( "PWAD" );
+	appendLE32( header, numLumps );
+	appendLE32( header, 12 + data.size() );
+
+	const QByteArray content = header + data + directory;
+	QFile file( filePath );
+	QVERIFY( file.open( QIODevice::WriteOnly ) );
+	QVERIFY( file.write( content ) == content.size() );
+}
+
+/// Creates a tree of directories with the given number of files in total, about 100 files per directory.
+static void writeSyntheticTree( const QString & rootDir, int numFiles )
+{
+	static const char * const suffixes [] = { "wad", "pk3", "deh", "txt", "zip" };
+
+	for (int i = 0; i < numFiles; ++i)
+	{
+		QString dirPath = rootDir % "/dir" % QString::number( i / 1000 ) % "/sub" % QString::number( (i / 100) % 10 );
+		if (i % 100 == 0)
+			QVERIFY( QDir().mkpath( dirPath ) );
+		QFile file( dirPath % "/file" % QString::number( i ) % '.' % suffixes[ i % std::size( suffixes ) ] );
+		QVERIFY( file.open( QIODevice::WriteOnly ) );
+	}
+}
+
+static QList< Preset > makeSyntheticPresets( int numPresets )
+{
+	QRandomGenerator rng( 12345 );  // fixed seed, the same content in every run
+
+	QList< Preset > presets;
+	presets.reserve( numPresets );
+	for (int i = 0; i < numPresets; ++i)
+	{
+		Preset preset( "Preset " % QString::number( i ) );
+		preset.selectedEnginePath = "C:/Games/Doom/gzdoom.exe";
+		preset.selectedIWAD = "C:/Games/Doom/IWADs/doom2.wad";
+		preset.selectedConfig = "config" % QString::number( rng.bounded( 10 ) ) % ".ini";
+		int numMods = rng.bounded( 1, 11 );
+		for (int j = 0; j < numMods; ++j)
+		{
+			Mod mod( QFileInfo( "C:/Games/Doom/Mods/mod" % QString::number( rng.bounded( 500 ) ) % ".pk3" ) );
+			preset.mods.append( std::move(mod) );
+		}
+		preset.cmdArgs = "+sv_cheats 1";
+		presets.append( std::move(preset) );
+	}
+	return presets;
+}
+
+
+//======================================================================================================================
+
+class Benchmarks : public QObject {
+
+	Q_OBJECT
+
+	QTemporaryDir _tempDir;
+
+ private slots:
+
+	void initTestCase()
+	{
+		QVERIFY( _tempDir.isValid() );
+	}
+
+	//-- WAD reading ---------------------------------------------------------------------------------------------------
+
+	void readWadInfo_data()
+	{
+		QTest::addColumn< int >( "numLumps" );
+		QTest::newRow( "1k lumps" ) << 1000;
+		QTest::newRow( "10k lumps" ) << 10000;
+		QTest::newRow( "65k lumps" ) << 65000;
+	}
+
+	void readWadInfo()
+	{
+		QFETCH( int, numLumps );
+		const QString filePath = _tempDir.filePath( "synthetic" % QString::number( numLumps ) % ".wad" );
+		writeSyntheticWad( filePath, numLumps );
+
+		doom::UncertainWadInfo wadInfo;
+		QBENCHMARK {
+			wadInfo = doom::readWadInfo( filePath );
+		}
+		QCOMPARE( wadInfo.status, ReadStatus::Success );
+		QVERIFY( !wadInfo.mapNames.isEmpty() );
+	}
+
+	//-- directory traversal -------------------------------------------------------------------------------------------
+
+	void traverseDirectory_data()
+	{
+		QTest::addColumn< int >( "numFiles" );
+		QTest::newRow( "1k files" ) << 1000;
+		QTest::newRow( "10k files" ) << 10000;
+	}
+
+	void traverseDirectory()
+	{
+		QFETCH( int, numFiles );
+		const QString rootDir = _tempDir.filePath( "tree" % QString::number( numFiles ) );
+		writeSyntheticTree( rootDir, numFiles );
+		const PathConvertor pathConvertor( QDir( rootDir ), PathStyle::Absolute );
+
+		int visitedFiles = 0;
+		QBENCHMARK {
+			visitedFiles = 0;
+			fs::traverseDirectory( rootDir, /*recursively*/true, fs::EntryType::FILE, pathConvertor,
+				[&]( const QFileInfo & ) { ++visitedFiles; }
+			);
+		}
+		QCOMPARE( visitedFiles, numFiles );
+	}
+
+	//-- options file --------------------------------------------------------------------------------------------------
+
+	void options_data()
+	{
+		QTest::addColumn< int >( "numPresets" );
+		QTest::newRow( "10 presets" ) << 10;
+		QTest::newRow( "1000 presets" ) << 1000;
+		QTest::newRow( "10000 presets" ) << 10000;
+	}
+
+	void writeOptions_data()  { options_data(); }
+	void writeOptions()
+	{
+		QFETCH( int, numPresets );
+		const QString filePath = _tempDir.filePath( "options" % QString::number( numPresets ) % ".json" );
+		Options options( makeSyntheticPresets( numPresets ) );
+
+		QBENCHMARK {
+			// nothing is cached from the previous iteration, so this measures the first save after a start
+			for (const Preset & preset : options.presets)
+				preset.markModified();
+			OptionsWriteCache cache;
+			OptionsFileContent content = serializeOptions( options.toSave(), cache );
+			QVERIFY( fs::updateFileSafely( filePath, content.json ).isEmpty() );
+			QVERIFY( fs::updateFileSafely( getOptionsSidecarPath( filePath ), content.binary ).isEmpty() );
+		}
+	}
+
+	void readOptions_data()  { options_data(); }
+	void readOptions()
+	{
+		QFETCH( int, numPresets );
+		const QString filePath = _tempDir.filePath( "options" % QString::number( numPresets ) % ".json" );
+		{
+			Options options( makeSyntheticPresets( numPresets ) );
+			OptionsWriteCache cache;
+			QVERIFY( fs::updateFileSafely( filePath, serializeOptions( options.toSave(), cache ).json ).isEmpty() );
+			QFile::remove( getOptionsSidecarPath( filePath ) );  // measure the JSON, the sidecar is benchmarked below
+		}
+
+		Options loaded{ QList< Preset >() };
+		QBENCHMARK {
+			OptionsToLoad opts = loaded.toLoad();
+			QVERIFY( readOptionsFromFile( opts, filePath ) );
+			QCOMPARE( opts.presets.size(), numPresets );
+		}
+	}
+
+	void readOptionsSidecar_data()  { options_data(); }
+	void readOptionsSidecar()
+	{
+		QFETCH( int, numPresets );
+		const QString filePath = _tempDir.filePath( "options_sidecar" % QString::number( numPresets ) % ".json" );
+		{
+			Options options( makeSyntheticPresets( numPresets ) );
+			OptionsWriteCache cache;
+			OptionsFileContent content = serializeOptions( options.toSave(), cache );
+			QVERIFY( fs::updateFileSafely( filePath, content.json ).isEmpty() );
+			QVERIFY( fs::updateFileSafely( getOptionsSidecarPath( filePath ), content.binary ).isEmpty() );
+		}
+
+		Options loaded{ QList< Preset >() };
+		QBENCHMARK {
+			OptionsToLoad opts = loaded.toLoad();
+			QVERIFY( readOptionsFromFile( opts, filePath ) );
+			QCOMPARE( opts.presets.size(), numPresets );
+		}
+	}
+
+	//-- list updates --------------------------------------------------------------------------------------------------
+
+	void updateListFromDir_data()
+	{
+		QTest::addColumn< int >( "numFiles" );
+		QTest::newRow( "1k files" ) << 1000;
+		QTest::newRow( "10k files" ) << 10000;
+	}
+
+	void updateListFromDir()
+	{
+		QFETCH( int, numFiles );
+		const QString rootDir = _tempDir.filePath( "list" % QString::number( numFiles ) );
+		writeSyntheticTree( rootDir, numFiles );
+		const PathConvertor pathConvertor( QDir( rootDir ), PathStyle::Absolute );
+		const QStringVec suffixes = { "wad", "pk3" };
+
+		ReadOnlyDirectListModel< IWAD > model(
+			/*makeDisplayString*/ []( const IWAD & iwad ) { return iwad.name; }
+		);
+		QListView view;  // the update also maintains the selection and the scroll position of the view
+		view.setModel( &model );
+
+		bool addAll = true;
+		QBENCHMARK {
+			// alternate between filling an empty model and updating a full one that is up to date, the most common case
+			if (addAll)
+			{
+				model.startCompleteUpdate();
+				model.clear();
+				model.finishCompleteUpdate();
+			}
+			wdg::updateListFromDir( model, &view, rootDir, /*recursively*/true, pathConvertor, suffixes );
+			addAll = !addAll;
+		}
+		QVERIFY( model.size() > 0 );
+	}
+
+	//-- file info cache -----------------------------------------------------------------------------------------------
+
+	void fileInfoCache_data()
+	{
+		QTest::addColumn< int >( "numWads" );
+		QTest::newRow( "100 WADs" ) << 100;
+		QTest::newRow( "1000 WADs" ) << 1000;
+	}
+
+	void serializeFileInfoCache_data()  { fileInfoCache_data(); }
+	void serializeFileInfoCache()
+	{
+		QFETCH( int, numWads );
+		fillWadHeaderCache( numWads );
+
+		QJsonObject jsCache;
+		QBENCHMARK {
+			jsCache = doom::g_cachedWadHeaders.serialize();
+		}
+		QVERIFY( !jsCache.isEmpty() );
+	}
+
+	void deserializeFileInfoCache_data()  { fileInfoCache_data(); }
+	void deserializeFileInfoCache()
+	{
+		QFETCH( int, numWads );
+		fillWadHeaderCache( numWads );
+		const QJsonDocument jsonDoc( doom::g_cachedWadHeaders.serialize() );
+
+		QBENCHMARK {
+			JsonDocumentCtx jsonCtx( "benchmark", jsonDoc );
+			doom::g_cachedWadHeaders.deserialize( jsonCtx.rootObject() );
+		}
+		QVERIFY( doom::g_cachedWadHeaders.size() >= numWads );
+	}
+
+ private:
+
+	/// Everything the options serializer needs, the presets are the only part that varies.
+	struct Options
+	{
+		QList< EngineInfo > engines;
+		QList< IWAD > iwads;
+		LaunchOptions launchOpts;
+		MultiplayerOptions multOpts;
+		GameplayOptions gameOpts;
+		CompatibilityOptions compatOpts;
+		VideoOptions videoOpts;
+		AudioOptions audioOpts;
+		GlobalOptions globalOpts;
+		QList< Preset > presets;
+		EngineSettings engineSettings;
+		IwadSettings iwadSettings;
+		MapSettings mapSettings;
+		ModSettings modSettings;
+		LauncherSettings settings;
+
+		Options( QList< Preset > presets ) : presets( std::move(presets) ) {}
+
+		OptionsToSave toSave() const
+		{
+			return OptionsToSave{
+				engines, iwads,
+				launchOpts, multOpts, gameOpts, compatOpts, videoOpts, audioOpts, globalOpts,
+				presets, presets.isEmpty() ? -1 : 0,
+				engineSettings, iwadSettings, mapSettings, modSettings, settings, WindowGeometry()
+			};
+		}
+		OptionsToLoad toLoad()
+		{
+			return OptionsToLoad{
+				{}, {},
+				launchOpts, multOpts, gameOpts, compatOpts, videoOpts, audioOpts, globalOpts,
+				{}, {},
+				engineSettings, iwadSettings, mapSettings, modSettings, settings, WindowGeometry()
+			};
+		}
+	};
+
+	/// The header cache is cheap to fill, the WADs are tiny, but the entries are the same as for real files.
+	void fillWadHeaderCache( int numWads )
+	{
+		const QString wadDir = _tempDir.filePath( "cache" % QString::number( numWads ) );
+		QVERIFY( QDir().mkpath( wadDir ) );
+		for (int i = 0; i < numWads; ++i)
+		{
+			const QString filePath = wadDir % "/wad" % QString::number( i ) % ".wad";
+			if (!QFileInfo::exists( filePath ))
+				writeSyntheticWad( filePath, 11 );
+			doom::g_cachedWadHeaders.getFileInfo( filePath );
+		}
+	}
+
+};
+
+
+QTEST_MAIN( Benchmarks )
+
+#include "Benchmarks.moc"
@@ -42,36 +42,68 @@ HEADERS += \
 	Sources/Dialogs/AboutDialog.hpp \
 	Sources/Dialogs/CompatOptsDialog.hpp \
 	Sources/Dialogs/DialogCommon.hpp \
+	Sources/Dialogs/DiagnosticsDialog.hpp \
 	Sources/Dialogs/EngineDialog.hpp \
 	Sources/Dialogs/GameOptsDialog.hpp \
+	Sources/Dialogs/MultiProcessOutputWindow.hpp \
 	Sources/Dialogs/NewConfigDialog.hpp \
 	Sources/Dialogs/OptionsStorageDialog.hpp \
 	Sources/Dialogs/OwnFileDialog.hpp \
 	Sources/Dialogs/ProcessOutputWindow.hpp \
 	Sources/Dialogs/SetupDialog.hpp \
 	Sources/DoomFiles.hpp \
+	Sources/Utils/AsyncDirTraverser.hpp \
+	Sources/Utils/AsyncFileWriter.hpp \
+	Sources/Utils/AsyncLogFileWriter.hpp \
 	Sources/Utils/ContainerUtils.hpp \
+	Sources/Utils/DemoFileReader.hpp \
+	Sources/Utils/Diagnostics.hpp \
+	Sources/Utils/DirProber.hpp \
+	Sources/Utils/DirSnapshotCache.hpp \
+	Sources/Utils/DirWatcher.hpp \
 	Sources/Utils/ErrorHandling.hpp \
 	Sources/Utils/EventFilters.hpp \
 	Sources/Utils/ExeReader.hpp \
+	Sources/Utils/FileIconCache.hpp \
 	Sources/Utils/FileInfoCache.hpp \
+	Sources/Utils/FilePrewarmer.hpp \
 	Sources/Utils/FileSystemUtils.hpp \
+	Sources/Utils/IdleScheduler.hpp \
 	Sources/Utils/JsonUtils.hpp \
 	Sources/Utils/LangUtils.hpp \
+	Sources/Utils/MapDescReader.hpp \
+	Sources/Utils/MapInfoParser.hpp \
 	Sources/Utils/MiscUtils.hpp \
+	Sources/Utils/ModConflictAnalyzer.hpp \
 	Sources/Utils/OSUtils.hpp \
+	Sources/Utils/SaveFileReader.hpp \
+	Sources/Utils/SevenZipReader.hpp \
 	Sources/Utils/StandardOutput.hpp \
+	Sources/Utils/StringPool.hpp \
+	Sources/Utils/TaskGroup.hpp \
+	Sources/Utils/ThumbnailCache.hpp \
 	Sources/Utils/TimeStats.hpp \
+	Sources/Utils/TitlePicReader.hpp \
 	Sources/Utils/WADReader.hpp \
+	Sources/Utils/WadContentIndex.hpp \
+	Sources/Utils/WadInfoCacheFile.hpp \
+	Sources/Utils/WadInfoPrefetcher.hpp \
 	Sources/Utils/WidgetUtils.hpp \
+	Sources/Utils/ZipReader.hpp \
 	Sources/Widgets/EditableListView.hpp \
 	Sources/Widgets/ExtendedTreeView.hpp \
 	Sources/Widgets/ListModel.hpp \
+	Sources/Widgets/MapPackModel.hpp \
 	Sources/CommonTypes.hpp \
+	Sources/EngineDiscovery.hpp \
 	Sources/EngineTraits.hpp \
 	Sources/Essential.hpp \
+	Sources/HeadlessLaunch.hpp \
+	Sources/LaunchCommand.hpp \
 	Sources/MainWindow.hpp \
 	Sources/OptionsSerializer.hpp \
+	Sources/PresetContentIndex.hpp \
+	Sources/PresetExport.hpp \
 	Sources/Themes.hpp \
 	Sources/UpdateChecker.hpp \
 	Sources/UserData.hpp \
@@ -82,34 +114,67 @@ SOURCES += \
 	Sources/Dialogs/AboutDialog.cpp \
 	Sources/Dialogs/CompatOptsDialog.cpp \
 	Sources/Dialogs/DialogCommon.cpp \
+	Sources/Dialogs/DiagnosticsDialog.cpp \
 	Sources/Dialogs/EngineDialog.cpp \
 	Sources/Dialogs/GameOptsDialog.cpp \
+	Sources/Dialogs/MultiProcessOutputWindow.cpp \
 	Sources/Dialogs/NewConfigDialog.cpp \
 	Sources/Dialogs/OptionsStorageDialog.cpp \
 	Sources/Dialogs/OwnFileDialog.cpp \
 	Sources/Dialogs/ProcessOutputWindow.cpp \
 	Sources/Dialogs/SetupDialog.cpp \
 	Sources/DoomFiles.cpp \
+	Sources/Utils/AsyncDirTraverser.cpp \
+	Sources/Utils/AsyncFileWriter.cpp \
+	Sources/Utils/AsyncLogFileWriter.cpp \
 	Sources/Utils/ContainerUtils.cpp \
+	Sources/Utils/DemoFileReader.cpp \
+	Sources/Utils/Diagnostics.cpp \
+	Sources/Utils/DirProber.cpp \
+	Sources/Utils/DirSnapshotCache.cpp \
+	Sources/Utils/DirWatcher.cpp \
 	Sources/Utils/ErrorHandling.cpp \
 	Sources/Utils/EventFilters.cpp \
 	Sources/Utils/ExeReader.cpp \
+	Sources/Utils/FileIconCache.cpp \
 	Sources/Utils/FileInfoCache.cpp \
+	Sources/Utils/FilePrewarmer.cpp \
 	Sources/Utils/FileSystemUtils.cpp \
+	Sources/Utils/IdleScheduler.cpp \
 	Sources/Utils/LangUtils.cpp \
 	Sources/Utils/JsonUtils.cpp \
+	Sources/Utils/MapDescReader.cpp \
+	Sources/Utils/MapInfoParser.cpp \
 	Sources/Utils/MiscUtils.cpp \
+	Sources/Utils/ModConflictAnalyzer.cpp \
 	Sources/Utils/OSUtils.cpp \
+	Sources/Utils/SaveFileReader.cpp \
+	Sources/Utils/SevenZipReader.cpp \
 	Sources/Utils/StandardOutput.cpp \
+	Sources/Utils/StringPool.cpp \
+	Sources/Utils/TaskGroup.cpp \
+	Sources/Utils/ThumbnailCache.cpp \
+	Sources/Utils/TimeStats.cpp \
+	Sources/Utils/TitlePicReader.cpp \
 	Sources/Utils/WADReader.cpp \
+	Sources/Utils/WadContentIndex.cpp \
+	Sources/Utils/WadInfoCacheFile.cpp \
+	Sources/Utils/WadInfoPrefetcher.cpp \
 	Sources/Utils/WidgetUtils.cpp \
+	Sources/Utils/ZipReader.cpp \
 	Sources/Widgets/EditableListView.cpp \
 	Sources/Widgets/ExtendedTreeView.cpp \
 	Sources/Widgets/ListModel.cpp \
+	Sources/Widgets/MapPackModel.cpp \
 	Sources/CommonTypes.cpp \
+	Sources/EngineDiscovery.cpp \
 	Sources/EngineTraits.cpp \
+	Sources/HeadlessLaunch.cpp \
+	Sources/LaunchCommand.cpp \
 	Sources/MainWindow.cpp \
 	Sources/OptionsSerializer.cpp \
+	Sources/PresetContentIndex.cpp \
+	Sources/PresetExport.cpp \
 	Sources/Themes.cpp \
 	Sources/UpdateChecker.cpp \
 	Sources/UserData.cpp \
@@ -123,6 +188,7 @@ FORMS += \
 	Forms/EngineDialog.ui \
 	Forms/GameOptsDialog.ui \
 	Forms/MainWindow.ui \
+	Forms/MultiProcessOutputWindow.ui \
 	Forms/NewConfigDialog.ui \
 	Forms/OptionsStorageDialog.ui \
 	Forms/ProcessOutputWindow.ui \
@@ -162,6 +228,13 @@ win32: LIBS += -lole32 -luuid -ldwmapi -lversion
 # add "CONFIG+=flatpak" to the qmake command to activate this
 flatpak: DEFINES += FLATPAK_BUILD
 
+# add "CONFIG+=dev_tools" to the qmake command to add the developer tools (--generate-test-library)
+dev_tools {
+	DEFINES += DEV_TOOLS_BUILD
+	HEADERS += Sources/TestLibraryGenerator.hpp
+	SOURCES += Sources/TestLibraryGenerator.cpp
+}
+
 
 #-- deployment -----------------------------------
 
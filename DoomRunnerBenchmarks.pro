@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Benchmarks of the launcher's hot paths, built from the same sources as the application
+#
+#   qmake ../DoomRunnerBenchmarks.pro "CONFIG+=release" && make && ./DoomRunnerBenchmarks -median 5
+#
+# The results are comparable across runs, the input data are generated from fixed seeds.
+# Compare them with the output of the previous version to see the regressions.
+#
+#-------------------------------------------------
+
+# it must stay in the same directory as DoomRunner.pro, the paths of the included sources are relative to it
+include(DoomRunner.pro)
+
+TARGET = DoomRunnerBenchmarks
+
+QT += testlib
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+SOURCES -= Sources/main.cpp
+SOURCES += Benchmarks/Benchmarks.cpp
+
+# not to be installed nor bundled with an icon
+INSTALLS -= target
+win32: RC_ICONS =
+macx: ICON =
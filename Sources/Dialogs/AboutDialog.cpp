@@ -80,6 +80,7 @@ void AboutDialog::checkForUpdate()
 				showUpdateNotification( this, versionInfo, /*checkbox*/false );
 				break;
 			}
-		}
+		},
+		/*requestedByUser*/true
 	);
 }
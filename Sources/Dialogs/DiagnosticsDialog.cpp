@@ -0,0 +1,166 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: logic of the Diagnostics dialog that appears when you click Menu -> Diagnostics
+//======================================================================================================================
+
+#include "DiagnosticsDialog.hpp"
+
+#include "Version.hpp"
+#include "Utils/Diagnostics.hpp"
+#include "Utils/AsyncDirTraverser.hpp"
+#include "Utils/WADReader.hpp"        // g_cachedWadInfo, g_cachedWadHeaders
+#include "Utils/ExeReader.hpp"        // g_cachedExeInfo
+#include "Utils/MapDescReader.hpp"    // g_cachedMapPackDescs
+#include "Utils/SaveFileReader.hpp"   // g_cachedSaveInfo
+#include "Utils/DemoFileReader.hpp"   // g_cachedDemoInfo
+#include "Utils/StringPool.hpp"       // g_pathPool
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QFontDatabase>
+#include <QGuiApplication>
+#include <QClipboard>
+#include <QTextStream>
+#include <QScrollBar>
+
+
+//======================================================================================================================
+
+static constexpr int RefreshIntervalMs = 1000;
+
+DiagnosticsDialog::DiagnosticsDialog( QWidget * parent, QVector< NamedTraverser > traversers )
+:
+	QDialog( parent ),
+	DialogCommon( this ),
+	traversers( std::move(traversers) )
+{
+	setObjectName( "Diagnostics" );
+	setWindowTitle( "Diagnostics" );
+
+	QVBoxLayout * layout = new QVBoxLayout( this );
+
+	reportView = new QPlainTextEdit( this );
+	reportView->setReadOnly( true );
+	reportView->setWordWrapMode( QTextOption::NoWrap );
+	QFont font = QFontDatabase::systemFont( QFontDatabase::FixedFont );
+	reportView->setFont( font );
+	layout->addWidget( reportView );
+
+	QHBoxLayout * buttonLayout = new QHBoxLayout;
+	buttonLayout->addStretch();
+	QPushButton * copyBtn = new QPushButton( "Copy to clipboard", this );
+	QPushButton * closeBtn = new QPushButton( "Close", this );
+	buttonLayout->addWidget( copyBtn );
+	buttonLayout->addWidget( closeBtn );
+	layout->addLayout( buttonLayout );
+
+	connect( copyBtn, &QPushButton::clicked, this, &thisClass::copyReport );
+	connect( closeBtn, &QPushButton::clicked, this, &QDialog::close );
+
+	resize( 640, 520 );
+
+	// the counters change all the time, but re-rendering the text more often than this would be just a waste
+	connect( &refreshTimer, &QTimer::timeout, this, &thisClass::updateReport );
+	refreshTimer.start( RefreshIntervalMs );
+
+	updateReport();
+}
+
+DiagnosticsDialog::~DiagnosticsDialog() {}
+
+void DiagnosticsDialog::updateReport()
+{
+	if (!isVisible() && reportView->document()->characterCount() > 1)
+		return;
+
+	// keep the scroll position, the user might be reading the bottom part
+	int scrollPos = reportView->verticalScrollBar()->value();
+	reportView->setPlainText( makeReport() );
+	reportView->verticalScrollBar()->setValue( scrollPos );
+}
+
+void DiagnosticsDialog::copyReport()
+{
+	QGuiApplication::clipboard()->setText( makeReport() );
+}
+
+template< typename FileInfo >
+static void writeCacheStats( QTextStream & stream, const char * cacheName, const FileInfoCache< FileInfo > & cache )
+{
+	auto stats = cache.getStats();
+	quint64 lookups = stats.hits + stats.misses + stats.rereads;
+	int hitRate = lookups > 0 ? int( stats.hits * 100 / lookups ) : 0;
+	stream << "  " << qSetFieldWidth( 18 ) << Qt::left << cacheName << qSetFieldWidth( 0 )
+	       << qSetFieldWidth( 8 ) << Qt::right << stats.hits << stats.misses << stats.rereads << stats.entries
+	       << qSetFieldWidth( 0 ) << "   " << hitRate << "%\n";
+}
+
+/// Returns whether there was any scan to write.
+static bool writeScans( QTextStream & stream, const QString & scannedBy, const diag::ScanHistory & history )
+{
+	const auto scans = history.getScans();
+	for (const diag::ScanHistory::Scan & scan : scans)
+	{
+		stream << "  " << qSetFieldWidth( 16 ) << Qt::left << scannedBy << qSetFieldWidth( 0 )
+		       << qSetFieldWidth( 9 ) << Qt::right << scan.durationMs << scan.entriesVisited << scan.entriesMatched
+		       << qSetFieldWidth( 0 ) << "   " << (scan.dir.isEmpty() ? QStringLiteral("<none>") : scan.dir) << "\n";
+	}
+	return !scans.isEmpty();
+}
+
+QString DiagnosticsDialog::makeReport() const
+{
+	QString report;
+	QTextStream stream( &report );
+
+	stream << "DoomRunner " << appVersion << "\n\n";
+
+	stream << "File info caches" << qSetFieldWidth( 10 ) << Qt::right << "hits" << "misses" << "rereads" << "entries"
+	       << qSetFieldWidth( 0 ) << "  hit rate\n";
+	writeCacheStats( stream, "WAD info", doom::g_cachedWadInfo );
+	writeCacheStats( stream, "WAD headers", doom::g_cachedWadHeaders );
+	writeCacheStats( stream, "EXE info", os::g_cachedExeInfo );
+	writeCacheStats( stream, "map descriptions", doom::g_cachedMapPackDescs );
+	writeCacheStats( stream, "save info", doom::g_cachedSaveInfo );
+	writeCacheStats( stream, "demo info", doom::g_cachedDemoInfo );
+	stream << "  (rereads are entries that were outdated or failed to read the last time)\n\n";
+
+	stream << "Last directory scans\n";
+	stream << "  " << qSetFieldWidth( 16 ) << Qt::left << "by" << qSetFieldWidth( 0 )
+	       << qSetFieldWidth( 9 ) << Qt::right << "ms" << "visited" << "listed" << qSetFieldWidth( 0 ) << "   directory\n";
+	bool anyScan = false;
+	for (const auto & [listName, traverser] : traversers)
+		anyScan |= writeScans( stream, listName, traverser->lastScans() );
+	anyScan |= writeScans( stream, "main thread", diag::g_syncScans );
+	if (!anyScan)
+		stream << "  none yet\n";
+	stream << "\n";
+
+	const diag::Stats & stats = diag::g_stats;
+
+	stream << "Options\n";
+	stream << "  saves: " << stats.optionsSaves.value() << "\n";
+	stream << "  last save: " << stats.lastOptionsSaveMs.value() << " ms, " << stats.lastOptionsSaveBytes.value() << " bytes\n\n";
+
+	stream << "Launch command\n";
+	stream << "  regenerations: " << stats.launchCommandUpdates.value() << "\n\n";
+
+	stream << "Presets\n";
+	stream << "  switches: " << stats.presetSwitches.value() << "\n";
+	stream << "  last switch: " << stats.lastPresetSwitchMs.value() << " ms\n\n";
+
+	stream << "Logging\n";
+	stream << "  messages: " << stats.logMessages.value() << "\n";
+	stream << "  lines for the log file: " << stats.logFileLines.value() << "\n";
+	stream << "  log file writes: " << stats.logFileWrites.value() << "\n\n";
+
+	stream << "Memory\n";
+	stream << "  interned paths: " << g_pathPool.size() << "\n";
+
+	stream.flush();
+	return report;
+}
@@ -0,0 +1,61 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: logic of the Diagnostics dialog that appears when you click Menu -> Diagnostics
+//======================================================================================================================
+
+#ifndef DIAGNOSTICS_DIALOG_INCLUDED
+#define DIAGNOSTICS_DIALOG_INCLUDED
+
+
+#include "DialogCommon.hpp"
+
+#include <QDialog>
+#include <QTimer>
+#include <QString>
+#include <QVector>
+#include <QPair>
+
+class AsyncDirTraverser;
+class QPlainTextEdit;
+
+
+//======================================================================================================================
+/// Non-modal window with live counters of the caches, the directory scans, the options saving and the logging.
+/** Meant for attaching a screenshot to a report of a slowdown. The counters are collected all the time,
+  * this only displays them, and only while it's open. */
+class DiagnosticsDialog : public QDialog, private DialogCommon {
+
+	Q_OBJECT
+
+	using thisClass = DiagnosticsDialog;
+
+ public:
+
+	using NamedTraverser = QPair< QString, const AsyncDirTraverser * >;
+
+	/// The traversers must outlive the dialog.
+	explicit DiagnosticsDialog( QWidget * parent, QVector< NamedTraverser > traversers );
+	virtual ~DiagnosticsDialog() override;
+
+ private slots:
+
+	void updateReport();
+	void copyReport();
+
+ private:
+
+	QString makeReport() const;
+
+ private:
+
+	QVector< NamedTraverser > traversers;
+
+	QPlainTextEdit * reportView = nullptr;
+	QTimer refreshTimer;
+
+};
+
+
+#endif // DIAGNOSTICS_DIALOG_INCLUDED
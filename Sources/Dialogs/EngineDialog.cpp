@@ -8,7 +8,8 @@
 #include "EngineDialog.hpp"
 #include "ui_EngineDialog.h"
 
-#include "Utils/OSUtils.hpp"  // standard paths
+#include "EngineDiscovery.hpp"  // suggestEngineName, suggestEngineConfigDir, suggestEngineDataDir
+#include "Utils/FileSystemUtils.hpp"  // isInvalidFile, isInvalidDir
 #include "Utils/MiscUtils.hpp"  // highlightInvalidPath
 #include "Utils/ErrorHandling.hpp"
 
@@ -115,84 +116,6 @@ void EngineDialog::onWindowShown()
 		done( QDialog::Rejected );
 }
 
-#if IS_WINDOWS
-static bool assumeGZDoom49_orLater( const EngineInfo & engine )
-{
-	// If we have version info from the executable file, decide based on the application name and version,
-	// otherwise if the executable file name seems like GZDoom, assume the latest version.
-	if (!engine.exeAppName().isEmpty() && engine.exeVersion().isValid())
-		return engine.exeAppName() == "GZDoom" && engine.exeVersion() >= Version(4,9,0);
-	else
-		return engine.exeBaseName() == "gzdoom";
-}
-#endif
-
-static QString suggestEngineName( const EngineInfo & engine )
-{
- #if IS_WINDOWS
-
-	// On Windows we can use the metadata built into the executable, or the name of its directory.
-	if (!engine.exeAppName().isEmpty())
-		return engine.exeAppName();  // exe metadata should be most reliable source
-	else
-		return fs::getDirnameOfFile( engine.executablePath );
-
- #else
-
-	// On Linux we have to fallback to the binary name (or use the Flatpak name if there is one).
-	if (engine.sandboxEnvType() != os::Sandbox::None)
-		return engine.sandboxAppName();
-	else
-		return engine.exeBaseName();
-
- #endif
-}
-
-static QString suggestEngineConfigDir( const EngineInfo & engine )
-{
- #if IS_WINDOWS
-
-	// On Windows, engines usually store their config in the directory of its binaries,
-	// with the exception of latest GZDoom (thanks Graph) that started storing it to Documents\My Games\GZDoom
-	QString dirOfExecutable = fs::getDirOfFile( engine.executablePath );
-	QString portableIniFilePath = fs::getPathFromFileName( dirOfExecutable, "gzdoom_portable.ini" );
-	if (assumeGZDoom49_orLater( engine ) && !fs::isValidFile( portableIniFilePath ))
-		return os::getDocumentsDir()%"/My Games/GZDoom";
-	else
-		return dirOfExecutable;
-
- #else
-
-	// On Linux they store them in standard user's app config dir (usually something like /home/youda/.config/).
-	if (engine.sandboxEnvType() == os::Sandbox::Snap)
-		return os::getHomeDir()%"/snap/"%engine.exeBaseName()%"/current/.config/"%engine.exeBaseName();
-	else if (engine.sandboxEnvType() == os::Sandbox::Flatpak)  // the engine is a Flatpak installation
-		return os::getHomeDir()%"/.var/app/"%engine.sandboxAppName()%"/.config/"%engine.exeBaseName();
-	else
-		return os::getConfigDirForApp( engine.executablePath );  // -> /home/youda/.config/zdoom
-
- #endif
-}
-
-static QString suggestEngineDataDir( const EngineInfo & engine )
-{
- #if IS_WINDOWS
-
-	QString dirOfExecutable = fs::getDirOfFile( engine.executablePath );
-	QString portableIniFilePath = fs::getPathFromFileName( dirOfExecutable, "gzdoom_portable.ini" );
-	if (assumeGZDoom49_orLater( engine ) && !fs::isValidFile( portableIniFilePath ))
-		return os::getSavedGamesDir()%"/GZDoom";
-	else
-		return dirOfExecutable;
-
- #else
-
-	// On Linux it is generally the same as config dir.
-	return suggestEngineConfigDir( engine );
-
- #endif
-}
-
 void EngineDialog::browseExecutable()
 {
 	QString executablePath = DialogWithPaths::browseFile( this, "engine's executable", QString(),
@@ -0,0 +1,281 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: window that shows statuses and outputs of several processes started together
+//======================================================================================================================
+
+#include "MultiProcessOutputWindow.hpp"
+#include "ui_MultiProcessOutputWindow.h"
+
+#include "Utils/ErrorHandling.hpp"
+
+#include <QPlainTextEdit>
+#include <QTabBar>
+#include <QFontDatabase>
+#include <QPushButton>
+#include <QStringBuilder>
+#include <QColor>
+#include <QPalette>
+
+
+//======================================================================================================================
+
+static const char * const terminateBtnText = "Terminate all";
+static const char * const killBtnText = "Kill all";
+
+
+//======================================================================================================================
+
+MultiProcessOutputWindow::MultiProcessOutputWindow( QWidget * parent )
+:
+	QDialog( parent ),
+	DialogCommon( this )
+{
+	logDebug() << "MultiProcessOutputWindow()";
+
+	ui = new Ui::MultiProcessOutputWindow;
+	ui->setupUi( this );
+	abortBtn = ui->buttonBox->button( QDialogButtonBox::StandardButton::Abort );
+	closeBtn = ui->buttonBox->button( QDialogButtonBox::StandardButton::Close );
+
+	setAttribute( Qt::WA_DeleteOnClose );
+
+	abortBtn->setText( terminateBtnText );
+	abortBtn->setEnabled( false );
+	closeBtn->setText("Close");
+	connect( abortBtn, &QPushButton::clicked, this, &thisClass::onAbortClicked );
+	connect( closeBtn, &QPushButton::clicked, this, &thisClass::reject );
+
+	startTimer.setSingleShot( true );
+	connect( &startTimer, &QTimer::timeout, this, &thisClass::startNextProcess );
+
+	outputFlushTimer.setSingleShot( true );
+	outputFlushTimer.setInterval( OutputFlushIntervalMs );
+	connect( &outputFlushTimer, &QTimer::timeout, this, &thisClass::flushProcessOutput );
+}
+
+MultiProcessOutputWindow::~MultiProcessOutputWindow()
+{
+	logDebug() << "~MultiProcessOutputWindow()";
+
+	startTimer.stop();
+	outputFlushTimer.stop();
+
+	for (Instance & instance : instances)
+	{
+		instance.process->disconnect( this );  // our own data are being destroyed
+		if (instance.process->state() != QProcess::NotRunning)
+		{
+			// last resort, window is quiting, we cannot let the processes continue
+			logInfo() << "    killing process " << instance.name;
+			instance.process->kill();
+			instance.process->waitForFinished( 1000 );
+		}
+	}
+
+	delete ui;
+	ui = nullptr;
+}
+
+void MultiProcessOutputWindow::startProcesses(
+	QVector< ProcessToStart > processes, const QString & workingDir, const QProcessEnvironment & env, int startDelayMs
+){
+	logDebug() << "MultiProcessOutputWindow::startProcesses: " << processes.size();
+
+	this->workingDir = workingDir;
+
+	processEnv = env;
+
+	QFont font = QFontDatabase::systemFont( QFontDatabase::FixedFont );
+	font.setPointSize( 10 );
+
+	// the same colors as in ProcessOutputWindow
+	QPalette palette = this->palette();
+	palette.setColor( QPalette::Base, QColor( 12, 12, 12 ) );
+	palette.setColor( QPalette::Text, QColor( 204, 204, 204 ) );
+
+	instances.resize( processes.size() );
+	for (int i = 0; i < processes.size(); ++i)
+	{
+		Instance & instance = instances[i];
+		instance.name = std::move( processes[i].name );
+		instance.executable = std::move( processes[i].executable );
+		instance.arguments = std::move( processes[i].arguments );
+
+		instance.textEdit = new QPlainTextEdit;
+		instance.textEdit->setReadOnly( true );
+		instance.textEdit->setFont( font );
+		instance.textEdit->setPalette( palette );
+		instance.textEdit->setMaximumBlockCount( MaxDisplayedOutputLines );
+		ui->tabWidget->addTab( instance.textEdit, instance.name );
+
+		instance.process = new QProcess( this );
+		instance.process->setProgram( instance.executable );
+		instance.process->setArguments( instance.arguments.toList() );
+		instance.process->setWorkingDirectory( workingDir );
+		instance.process->setProcessChannelMode( QProcess::MergedChannels );  // merge stdout and stderr
+		instance.process->setProcessEnvironment( processEnv );
+
+		// each process is read only when it has some output, the others don't slow it down
+		connect( instance.process, &QProcess::started, this, [ this, i ]() { setInstanceStatus( i, ProcessStatus::Running ); } );
+		connect( instance.process, &QProcess::readyReadStandardOutput, this, [ this, i ]() { readProcessOutput( i ); } );
+		connect( instance.process, QOverload< int, QProcess::ExitStatus >::of( &QProcess::finished ), this,
+			[ this, i ]( int exitCode, QProcess::ExitStatus exitStatus ) { onProcessFinished( i, exitCode, exitStatus ); } );
+		connect( instance.process, &QProcess::errorOccurred, this,
+			[ this, i ]( QProcess::ProcessError error ) { onErrorOccurred( i, error ); } );
+
+		setInstanceStatus( i, ProcessStatus::NotStarted );
+	}
+
+	startTimer.setInterval( startDelayMs );
+	nextInstanceIdx = 0;
+
+	this->show();
+
+	startNextProcess();
+}
+
+void MultiProcessOutputWindow::startNextProcess()
+{
+	if (nextInstanceIdx >= instances.size())
+		return;
+
+	int instanceIdx = nextInstanceIdx++;
+	Instance & instance = instances[ instanceIdx ];
+
+	logDebug() << "    starting " << instance.name;
+
+	setInstanceStatus( instanceIdx, ProcessStatus::Starting );
+	instance.process->start();  // asynchronously, the result comes in the signals
+
+	// the next one should start only after this one is ready to accept it
+	if (nextInstanceIdx < instances.size())
+		startTimer.start();
+}
+
+void MultiProcessOutputWindow::readProcessOutput( int instanceIdx )
+{
+	Instance & instance = instances[ instanceIdx ];
+
+	instance.pendingOutput.append( instance.process->readAllStandardOutput() );
+
+	// coalesce the output of all the processes until the timer fires into a single update
+	if (!outputFlushTimer.isActive())
+		outputFlushTimer.start();
+}
+
+void MultiProcessOutputWindow::flushProcessOutput()
+{
+	outputFlushTimer.stop();  // when called directly
+
+	for (Instance & instance : instances)
+		instance.pendingOutput.flushInto( instance.textEdit );
+}
+
+void MultiProcessOutputWindow::onProcessFinished( int instanceIdx, int exitCode, QProcess::ExitStatus exitStatus )
+{
+	const Instance & instance = instances[ instanceIdx ];
+
+	logDebug() << "MultiProcessOutputWindow::processFinished: " << instance.name << ", " << exitCode << ", " << exitStatus;
+
+	flushProcessOutput();  // display the last output together with the final status
+
+	if (instance.status == ProcessStatus::ShuttingDown)
+		setInstanceStatus( instanceIdx, ProcessStatus::Terminated );
+	else if (instance.status == ProcessStatus::Dying)
+		setInstanceStatus( instanceIdx, ProcessStatus::Killed );
+	else if (exitStatus == QProcess::CrashExit)
+		setInstanceStatus( instanceIdx, ProcessStatus::Crashed );
+	else if (exitCode != 0)
+		setInstanceStatus( instanceIdx, ProcessStatus::ExitedWithError, QString::number( exitCode ) );
+	else
+		setInstanceStatus( instanceIdx, ProcessStatus::Finished );
+}
+
+void MultiProcessOutputWindow::onErrorOccurred( int instanceIdx, QProcess::ProcessError error )
+{
+	const Instance & instance = instances[ instanceIdx ];
+
+	logDebug() << "MultiProcessOutputWindow::errorOccurred: " << instance.name << ", " << error;
+
+	// When we kill the process, Qt consideres it crashed, so it calls this function.
+	if (instance.status == ProcessStatus::Dying)
+		return;
+
+	// Unlike ProcessOutputWindow, no message boxes, one failed process doesn't have to stop the others,
+	// and the status in the tab shows what happened.
+	switch (error)
+	{
+		case QProcess::FailedToStart:
+		case QProcess::Timedout:
+			setInstanceStatus( instanceIdx, ProcessStatus::FailedToStart, instance.process->errorString() );
+			break;
+		case QProcess::Crashed:
+			setInstanceStatus( instanceIdx, ProcessStatus::Crashed );
+			break;
+		default:
+			setInstanceStatus( instanceIdx, ProcessStatus::UnknownError, instance.process->errorString() );
+			break;
+	}
+}
+
+void MultiProcessOutputWindow::setInstanceStatus( int instanceIdx, ProcessStatus status, const QString & detail )
+{
+	Instance & instance = instances[ instanceIdx ];
+
+	logDebug().noquote() << "    setInstanceStatus: " << instance.name << ": " << toString( status );
+
+	instance.status = status;
+
+	QString tabText = instance.name % " - " % toString( status );
+	if (!detail.isEmpty())
+		tabText += " (" % detail % ")";
+	ui->tabWidget->setTabText( instanceIdx, tabText );
+	ui->tabWidget->tabBar()->setTabTextColor( instanceIdx, getStatusColor( status ).darker( 150 ) );  // the tab is light
+
+	bool anyRunning = isAnyProcessRunning() || nextInstanceIdx < instances.size();
+	abortBtn->setEnabled( anyRunning );
+	if (!anyRunning)
+		abortBtn->setText( terminateBtnText );
+}
+
+bool MultiProcessOutputWindow::isAnyProcessRunning() const
+{
+	for (const Instance & instance : instances)
+		if (instance.process->state() != QProcess::NotRunning)
+			return true;
+	return false;
+}
+
+void MultiProcessOutputWindow::onAbortClicked( bool )
+{
+	logDebug().noquote() << "MultiProcessOutputWindow::onAbortClicked: " << abortBtn->text();
+
+	// the remaining ones would have nothing to connect to
+	startTimer.stop();
+	nextInstanceIdx = int( instances.size() );
+
+	bool terminate = abortBtn->text() == terminateBtnText;
+	for (int i = 0; i < instances.size(); ++i)
+	{
+		Instance & instance = instances[i];
+		if (instance.process->state() == QProcess::NotRunning)
+			continue;
+
+		if (terminate)
+		{
+			// Attempt to quit the processes in a polite way, if they don't listen, the button will kill them.
+			setInstanceStatus( i, ProcessStatus::ShuttingDown );
+			instance.process->terminate();
+		}
+		else
+		{
+			setInstanceStatus( i, ProcessStatus::Dying );
+			instance.process->kill();
+		}
+	}
+
+	if (terminate && isAnyProcessRunning())
+		abortBtn->setText( killBtnText );
+}
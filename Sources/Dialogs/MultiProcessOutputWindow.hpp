@@ -0,0 +1,109 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: window that shows statuses and outputs of several processes started together
+//======================================================================================================================
+
+#ifndef MULTI_PROCESS_OUTPUT_WINDOW_INCLUDED
+#define MULTI_PROCESS_OUTPUT_WINDOW_INCLUDED
+
+
+#include "DialogCommon.hpp"
+
+#include "ProcessOutputWindow.hpp"  // ProcessStatus, PendingProcessOutput
+#include "CommonTypes.hpp"
+#include "UserData.hpp"  // EnvVars
+
+#include <QDialog>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QTimer>
+#include <QVector>
+
+class QPushButton;
+class QPlainTextEdit;
+
+namespace Ui {
+	class MultiProcessOutputWindow;
+}
+
+
+//======================================================================================================================
+/// Non-modal window that starts several processes and displays the output of each of them in its own tab.
+/**
+  * Meant for testing a multiplayer setup on a single machine, where the host and the clients have to be started
+  * one after another. The outputs are read as soon as they arrive and displayed together in regular intervals,
+  * so several chatty processes don't make the window unresponsive.
+  *
+  * The window deletes itself when closed, the processes still running at that time are killed.
+  */
+class MultiProcessOutputWindow : public QDialog, private DialogCommon {
+
+	Q_OBJECT
+
+	using thisClass = MultiProcessOutputWindow;
+
+ public:
+
+	struct ProcessToStart
+	{
+		QString name;  ///< displayed in the tab
+		QString executable;
+		QStringVec arguments;
+	};
+
+	explicit MultiProcessOutputWindow( QWidget * parent );
+	virtual ~MultiProcessOutputWindow() override;
+
+	/// Shows the window and starts the processes one after another, so that each can get ready for the next one.
+	/** Returns immediately, the parameters are the same as the ones of ProcessOutputWindow::runProcess(). */
+	void startProcesses(
+		QVector< ProcessToStart > processes, const QString & workingDir, const QProcessEnvironment & env, int startDelayMs
+	);
+
+ private slots:
+
+	void startNextProcess();
+	void flushProcessOutput();
+
+	void onAbortClicked( bool checked );
+
+ private: // methods
+
+	void readProcessOutput( int instanceIdx );
+	void onProcessFinished( int instanceIdx, int exitCode, QProcess::ExitStatus exitStatus );
+	void onErrorOccurred( int instanceIdx, QProcess::ProcessError error );
+
+	void setInstanceStatus( int instanceIdx, ProcessStatus status, const QString & detail = QString() );
+	bool isAnyProcessRunning() const;
+
+ private: // members
+
+	struct Instance
+	{
+		QString name;
+		QString executable;
+		QStringVec arguments;
+		QProcess * process = nullptr;        ///< owned by the window
+		QPlainTextEdit * textEdit = nullptr;  ///< owned by the tab widget
+		PendingProcessOutput pendingOutput;
+		ProcessStatus status = ProcessStatus::NotStarted;
+	};
+
+	Ui::MultiProcessOutputWindow * ui;
+	QPushButton * abortBtn;  ///< shortcut to the Terminate button in the list of ui->buttonBox
+	QPushButton * closeBtn;  ///< shortcut to the Close button in the list of ui->buttonBox
+
+	QVector< Instance > instances;  ///< filled once at the start, so that the indexes captured by the callbacks stay valid
+	int nextInstanceIdx = 0;
+
+	QString workingDir;
+	QProcessEnvironment processEnv;
+
+	QTimer startTimer;
+	QTimer outputFlushTimer;
+};
+
+
+#endif // MULTI_PROCESS_OUTPUT_WINDOW_INCLUDED
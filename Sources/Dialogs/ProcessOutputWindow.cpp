@@ -11,8 +11,9 @@
 #include "Utils/WidgetUtils.hpp"  // setTextColor
 #include "Utils/FileSystemUtils.hpp"  // getFileNameFromPath
 #include "Utils/ErrorHandling.hpp"
+#include "Utils/TimeStats.hpp"  // LaunchTimeline, LoadPhaseTracker
 
-#include <QTextEdit>
+#include <QPlainTextEdit>
 #include <QFontDatabase>
 #include <QPushButton>
 #include <QStringBuilder>
@@ -47,11 +48,97 @@ const char * toString( ProcessStatus status )
 		return "<invalid>";
 }
 
+QColor getStatusColor( ProcessStatus status )
+{
+	switch (status)
+	{
+		case ProcessStatus::NotStarted:
+		case ProcessStatus::Starting:
+			return Qt::white;
+		case ProcessStatus::Running:
+		case ProcessStatus::Finished:
+			return QColor::fromHsv( 120, 200, 255 );  // lighter green
+		case ProcessStatus::ShuttingDown:
+		case ProcessStatus::Dying:
+		case ProcessStatus::Terminated:
+		case ProcessStatus::Killed:
+			return QColor::fromHsv( 50, 255, 255 );   // darker yellow
+		default:  // all kinds of errors
+			return QColor::fromHsv( 4, 180, 255 );    // lighter red
+	}
+}
+
 static const char * const terminateBtnText = "Terminate";
 static const char * const killBtnText = "Kill";
 
+static constexpr int MaxPendingOutputSize = 1024 * 1024;
+static constexpr qint64 MaxOutputLogSize = 16 * 1024 * 1024;
+static constexpr int MaxOutputLogBackups = 2;
+
+
+//======================================================================================================================
+//  PendingProcessOutput
+
+void PendingProcessOutput::append( const QByteArray & output )
+{
+	_output += output;
+
+	// If the widget can't keep up, it's better to show the latest output than to have the memory grow indefinitely.
+	if (_output.size() > MaxPendingOutputSize)
+	{
+		int excessSize = _output.size() - MaxPendingOutputSize;
+		int nextLineStart = _output.indexOf( '\n', excessSize ) + 1;  // don't start in the middle of a line
+		int removedSize = nextLineStart > 0 ? nextLineStart : excessSize;
+		_output.remove( 0, removedSize );
+		_skippedSize += removedSize;
+	}
+}
+
+void PendingProcessOutput::flushInto( QPlainTextEdit * textEdit )
+{
+	if (isEmpty())
+		return;
+
+	QByteArray output = std::move(_output);
+	_output.clear();
+
+ #if IS_WINDOWS
+	output.replace( "\r\n", "\n" );
+ #endif
+
+	QTextCursor cursor = textEdit->textCursor();
+	cursor.beginEditBlock();  // the layout is then updated only once for the whole batch
+
+	if (_skippedSize > 0)
+	{
+		cursor.insertText( "\n[... " % QString::number( _skippedSize ) % " bytes of output skipped ...]\n" );
+		_skippedSize = 0;
+	}
+
+	// If there are still CRs, the process probably wants to return the cursor to the start of the line to overwrite it.
+	// In that case everytime we encounter CR, we need to move the cursor to the beginning of the current line manually.
+	const QList< QByteArray > parts = output.split('\r');
+
+	const QByteArray & beforeCR = parts[0];
+	cursor.insertText( QString::fromLatin1( beforeCR ) );
+
+	for (int i = 1; i < parts.count(); ++i)
+	{
+		const QByteArray & afterCR = parts[i];
+		// Of course in fucking Qt the override mode doesn't work so we have to select and delete the old text manually.
+		cursor.movePosition( QTextCursor::StartOfLine, QTextCursor::KeepAnchor );
+		cursor.removeSelectedText();
+		cursor.insertText( QString::fromLatin1( afterCR ) );
+	}
+
+	cursor.endEditBlock();
+
+	textEdit->setTextCursor( cursor );
+}
+
 
 //======================================================================================================================
+//  ProcessOutputWindow
 
 ProcessOutputWindow::ProcessOutputWindow( QWidget * parent )
 :
@@ -70,6 +157,11 @@ ProcessOutputWindow::ProcessOutputWindow( QWidget * parent )
 	ui->textEdit->setFont( font );
 	ui->textEdit->clear();
 	ui->textEdit->setOverwriteMode( true );
+	ui->textEdit->setMaximumBlockCount( MaxDisplayedOutputLines );
+
+	outputFlushTimer.setSingleShot( true );
+	outputFlushTimer.setInterval( OutputFlushIntervalMs );
+	connect( &outputFlushTimer, &QTimer::timeout, this, &thisClass::flushProcessOutput );
 
 	// capture key presses so that we can send them to the process
 	keyPressFilter.toggleKeyPressSupression( true );  // stop Enter/Esc key events, otherwise they would close the window
@@ -98,6 +190,8 @@ ProcessOutputWindow::~ProcessOutputWindow()
 		process.kill();
 	}
 
+	outputFlushTimer.stop();
+
 	delete ui;
 	ui = nullptr;
 }
@@ -115,28 +209,7 @@ void ProcessOutputWindow::setOwnStatus( ProcessStatus status, const QString & de
 	ui->statusLine->setText( statusText );
 
 	// set status line color
-	QColor textColor;
-	switch (status)
-	{
-		case ProcessStatus::NotStarted:
-		case ProcessStatus::Starting:
-			textColor = Qt::white;
-			break;
-		case ProcessStatus::Running:
-		case ProcessStatus::Finished:
-			textColor = QColor::fromHsv( 120, 200, 255 );  // lighter green
-			break;
-		case ProcessStatus::ShuttingDown:
-		case ProcessStatus::Dying:
-		case ProcessStatus::Terminated:
-		case ProcessStatus::Killed:
-			textColor = QColor::fromHsv( 50, 255, 255 );   // darker yellow
-			break;
-		default:  // all kinds of errors
-			textColor = QColor::fromHsv( 4, 180, 255 );    // lighter red
-			break;
-	}
-	wdg::setTextColor( ui->statusLine, textColor );
+	wdg::setTextColor( ui->statusLine, getStatusColor( status ) );
 
 	// toggle buttons
 	switch (status)
@@ -186,10 +259,13 @@ void ProcessOutputWindow::setOwnStatus( ProcessStatus status, const QString & de
 }
 
 ProcessStatus ProcessOutputWindow::runProcess(
-	const QString & executable, const QStringVec & arguments, const QString & workingDir, const EnvVars & envVars
+	const QString & executable, const QStringVec & arguments, const QString & workingDir, const QProcessEnvironment & env,
+	LaunchTimeline * launchTimeline
 ){
 	logDebug() << "ProcessOutputWindow::runProcess: " << executable;
 
+	this->launchTimeline = launchTimeline;
+
 	executableName = fs::getFileNameFromPath( executable );
 	this->setWindowTitle( executableName % " output" );
 
@@ -198,12 +274,7 @@ ProcessStatus ProcessOutputWindow::runProcess(
 	process.setWorkingDirectory( workingDir );
 	process.setProcessChannelMode( QProcess::MergedChannels );  // merge stdout and stderr
 
-	QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-	for (const auto & envVar : envVars)
-	{
-		env.insert( envVar.name, envVar.value );
-	}
-	process.setProcessEnvironment(env);
+	process.setProcessEnvironment( env );
 
 	connect( &process, &QProcess::started, this, &thisClass::onProcessStarted );
 	connect( &process, &QProcess::readyReadStandardOutput, this, &thisClass::readProcessOutput );
@@ -212,9 +283,16 @@ ProcessStatus ProcessOutputWindow::runProcess(
 
 	setOwnStatus( ProcessStatus::Starting );
 
+	if (launchTimeline)
+		launchTimeline->addLauncherTimePoint( "output window setup" );
+
 	// start asynchronously and wait for signals
+	loadPhaseTracker.start( loadPhaseMarkers );
 	process.start();
 
+	if (launchTimeline)
+		launchTimeline->addEngineTimePoint( "process start" );
+
 	// When the error occurs early and the signal is sent from within process.start(),
 	// the accept()/reject()/done() call does not initiate closing the dialog because "fuck yea Qt".
 	// So we have to manually return here, otherwise the dialog would never quit.
@@ -226,42 +304,54 @@ ProcessStatus ProcessOutputWindow::runProcess(
 	// start dialog event loop and wait for the process to finish or for the user to close it
 	this->exec();
 
+	lastLoadPhases = loadPhaseTracker.finish();
+
 	return ownStatus;
 }
 
+void ProcessOutputWindow::logOutputToFile( const QString & filePath )
+{
+	outputLog.open( filePath, MaxOutputLogSize, MaxOutputLogBackups );
+}
+
 void ProcessOutputWindow::onProcessStarted()
 {
 	logDebug() << "ProcessOutputWindow::processStarted";
 
+	if (launchTimeline)
+		launchTimeline->addEngineTimePoint( "started signal" );
+
 	setOwnStatus( ProcessStatus::Running );
 }
 
 void ProcessOutputWindow::readProcessOutput()
 {
 	QByteArray output = process.readAllStandardOutput();
- #if IS_WINDOWS
-	output.replace( "\r\n", "\n" );
- #endif
 
-	// If there are still CRs, the process probably wants to return the cursor to the start of the line to overwrite it.
-	// In that case everytime we encounter CR, we need to move the cursor to the beginning of the current line manually.
-	const QList< QByteArray > parts = output.split('\r');
+	if (!outputReceived && launchTimeline)
+		launchTimeline->addEngineTimePoint( "first output" );
+	outputReceived = true;
 
-	QTextCursor cursor = ui->textEdit->textCursor();
+	outputLog.write( output );  // only shares the buffer, the worker thread does the rest
 
-	const QByteArray & beforeCR = parts[0];
-	cursor.insertText( QString::fromLatin1( beforeCR ) );
+	// the time points must be taken when the output arrives, not when it's displayed
+	loadPhaseTracker.processOutput( output );
 
-	for (int i = 1; i < parts.count(); ++i)
-	{
-		const QByteArray & afterCR = parts[i];
-		// Of course in fucking Qt the override mode doesn't work so we have to select and delete the old text manually.
-		cursor.movePosition( QTextCursor::StartOfLine, QTextCursor::KeepAnchor );
-		cursor.removeSelectedText();
-		cursor.insertText( QString::fromLatin1( afterCR ) );
-	}
+	pendingOutput.append( output );
 
-	ui->textEdit->setTextCursor( cursor );
+	// coalesce all the output that arrives until the timer fires into a single widget update
+	if (!outputFlushTimer.isActive())
+		outputFlushTimer.start();
+}
+
+void ProcessOutputWindow::flushProcessOutput()
+{
+	outputFlushTimer.stop();  // when called directly
+
+	if (ui == nullptr)
+		return;
+
+	pendingOutput.flushInto( ui->textEdit );
 }
 
 void ProcessOutputWindow::onKeyPressed( int key, uint8_t modifiers )
@@ -284,6 +374,8 @@ void ProcessOutputWindow::onProcessFinished( int exitCode, QProcess::ExitStatus
 	if (ui == nullptr)
 		return;
 
+	flushProcessOutput();  // display the last output before the dialog potentially closes
+
 	if (ownStatus == ProcessStatus::ShuttingDown)  // user requested to terminate the process and now it finally shut down
 	{
 		setOwnStatus( ProcessStatus::Terminated );
@@ -14,12 +14,19 @@
 #include "CommonTypes.hpp"
 #include "UserData.hpp"  // EnvVars
 #include "Utils/EventFilters.hpp"
+#include "Utils/AsyncLogFileWriter.hpp"
+#include "Utils/TimeStats.hpp"  // LoadPhaseTracker
 
 #include <QDialog>
 #include <QProcess>
+#include <QProcessEnvironment>
+#include <QByteArray>
+#include <QTimer>
 
 class QPushButton;
 class QCloseEvent;
+class QPlainTextEdit;
+class QColor;
 
 namespace Ui {
 	class ProcessOutputWindow;
@@ -48,6 +55,36 @@ enum class ProcessStatus
 };
 
 const char * toString( ProcessStatus status );
+/// Color in which the status is displayed (on a dark background).
+QColor getStatusColor( ProcessStatus status );
+
+/// How often the output of the processes is displayed, ~30 updates per second is smooth enough.
+constexpr int OutputFlushIntervalMs = 33;
+/// Older lines are removed from the widget.
+constexpr int MaxDisplayedOutputLines = 10000;
+
+
+//======================================================================================================================
+/// Output of a process that has been read but not displayed yet.
+/**
+  * The output should always be read from the pipe immediately, so that the process never blocks on writing it,
+  * but displayed only in regular intervals, because updating the widget is much slower than some engines can print.
+  * The buffer is bounded, when the widget can't keep up, the oldest lines are thrown away.
+  */
+class PendingProcessOutput
+{
+	QByteArray _output;
+	qint64 _skippedSize = 0;  ///< how much of the output was thrown away since the last flush
+
+ public:
+
+	void append( const QByteArray & output );
+
+	bool isEmpty() const  { return _output.isEmpty() && _skippedSize == 0; }
+
+	/// Appends the output to the end of the widget, handling the CRs like a terminal, and clears it.
+	void flushInto( QPlainTextEdit * textEdit );
+};
 
 
 //======================================================================================================================
@@ -74,17 +111,29 @@ class ProcessOutputWindow : public QDialog, private DialogCommon {
 	  * \param arguments Program arguments. Any file paths must be either absolute or relative to the workingDir argument.
 	  * \param workingDir Working directory for the started process. All file paths given via arguments must be relative to this.
 	  *                   If not specified, the current working directory is used.
-	  * \param envVars Optional evironment variables to be set for the starting process.
+	  * \param env Complete environment of the starting process, see makeProcessEnvironment().
+	  * \param launchTimeline Optional timeline to record when the process started and when it printed its first output.
 	  * \return In which state of the process was the dialog closed.
 	  */
 	ProcessStatus runProcess(
-		const QString & executable, const QStringVec & arguments, const QString & workingDir = {}, const EnvVars & envVars = {}
+		const QString & executable, const QStringVec & arguments, const QString & workingDir, const QProcessEnvironment & env,
+		LaunchTimeline * launchTimeline = nullptr
 	);
 
+	/// Makes the following runProcess() also write the raw output of the process to a file.
+	/** The file is written in a background thread and rotated when it gets too big. */
+	void logOutputToFile( const QString & filePath );
+
+	/// Makes the following runProcess() measure the phases of the process's loading, see LoadPhaseTracker.
+	void trackLoadPhases( const LoadPhaseMarker * markers )  { loadPhaseMarkers = markers; }
+	/// Returns the measured phases after runProcess() returns, empty if they were not tracked or not found.
+	const QString & loadPhasesSummary() const  { return lastLoadPhases; }
+
  private slots:
 
 	void onProcessStarted();
 	void readProcessOutput();
+	void flushProcessOutput();
 	void onProcessFinished( int exitCode, QProcess::ExitStatus exitStatus );
 	void onErrorOccurred( QProcess::ProcessError error );
 
@@ -113,6 +162,18 @@ class ProcessOutputWindow : public QDialog, private DialogCommon {
 
 	ProcessStatus ownStatus;
 
+	LaunchTimeline * launchTimeline = nullptr;
+	bool outputReceived = false;
+
+	PendingProcessOutput pendingOutput;
+	QTimer outputFlushTimer;
+
+	AsyncLogFileWriter outputLog;  ///< gets the output exactly as it was read, before it's processed for the display
+
+	const LoadPhaseMarker * loadPhaseMarkers = nullptr;
+	LoadPhaseTracker loadPhaseTracker;
+	QString lastLoadPhases;
+
 	KeyPressFilter keyPressFilter;
 };
 
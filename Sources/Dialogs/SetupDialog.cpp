@@ -21,6 +21,45 @@
 #include <QFileInfo>
 #include <QAction>
 #include <QTimer>
+#include <QSet>
+
+
+//======================================================================================================================
+//  additional directories
+
+ExtraDir::ExtraDir( const QFileInfo & file ) : path( file.filePath() ) {}
+
+static QStringVec getDirPaths( const EditableDirectListModel< ExtraDir > & model )
+{
+	QStringVec dirs;
+	dirs.reserve( model.size() );
+	for (const ExtraDir & dir : model)
+		dirs.append( dir.path );
+	return dirs;
+}
+
+static void highlightInvalidDirs( EditableDirectListModel< ExtraDir > & model )
+{
+	if (model.isEmpty())
+		return;
+
+	for (const ExtraDir & dir : model)
+	{
+		if (fs::isValidDir( dir.path ))
+			unhighlightListItem( dir );
+		else
+			highlightInvalidListItem( dir );
+	}
+	model.annotationsChanged( 0 );
+}
+
+static bool isAnyDirValid( const QStringVec & dirs )
+{
+	for (const QString & dir : dirs)
+		if (fs::isValidDir( dir ))
+			return true;
+	return false;
+}
 
 
 //======================================================================================================================
@@ -37,6 +76,12 @@ SetupDialog::SetupDialog(
 :
 	QDialog( parent ),
 	DialogWithPaths( this, pathConv ),
+	iwadExtraDirModel(
+		/*makeDisplayString*/ []( const ExtraDir & dir ) -> QString { return dir.path; }
+	),
+	mapExtraDirModel(
+		/*makeDisplayString*/ []( const ExtraDir & dir ) -> QString { return dir.path; }
+	),
 	engineSettings( engineSettings ),
 	engineModel( engineList,
 		/*makeDisplayString*/ []( const Engine & engine ) -> QString { return engine.name % "   [" % engine.executablePath % "]"; }
@@ -58,6 +103,8 @@ SetupDialog::SetupDialog(
 
 	setupEngineList();
 	setupIWADList();
+	setupExtraDirList( ui->iwadExtraDirListView, iwadExtraDirModel );
+	setupExtraDirList( ui->mapExtraDirListView, mapExtraDirModel );
 
 	// initialize widget data
 
@@ -67,12 +114,21 @@ SetupDialog::SetupDialog(
 		manageIWADsAutomatically();
 	}
 	ui->iwadDirLine->setText( iwadSettings.dir );
+	for (const QString & extraDir : iwadSettings.extraDirs)
+		iwadExtraDirModel.append( extraDir );
 	ui->iwadSubdirs->setChecked( iwadSettings.searchSubdirs );
+	ui->iwadDetectByHeader->setChecked( iwadSettings.detectByHeader );
 	ui->mapDirLine->setText( mapSettings.dir );
+	for (const QString & extraDir : mapSettings.extraDirs)
+		mapExtraDirModel.append( extraDir );
 	ui->modDirLine->setText( modSettings.dir );
 	ui->absolutePathsChkBox->setChecked( settings.pathStyle == PathStyle::Absolute );
 	ui->showEngineOutputChkBox->setChecked( settings.showEngineOutput );
 	ui->closeOnLaunchChkBox->setChecked( settings.closeOnLaunch );
+	ui->pollDirsChkBox->setChecked( settings.pollDirectories );
+	ui->prewarmFilesChkBox->setChecked( settings.prewarmFiles );
+	ui->shareFileCacheChkBox->setChecked( settings.shareFileCache );
+	ui->logEngineOutputChkBox->setChecked( settings.logEngineOutput );
 
 	ui->styleCmbBox->addItem( "System default" );
 	ui->styleCmbBox->addItems( themes::getAvailableAppStyles() );
@@ -91,7 +147,9 @@ SetupDialog::SetupDialog(
 
 	// mark invalid paths
 	highlightDirPathIfInvalid( ui->iwadDirLine, iwadSettings.dir );
+	highlightInvalidDirs( iwadExtraDirModel );
 	highlightDirPathIfInvalid( ui->mapDirLine, mapSettings.dir );
+	highlightInvalidDirs( mapExtraDirModel );
 	highlightDirPathIfInvalid( ui->modDirLine, modSettings.dir );
 
 	// setup buttons
@@ -107,7 +165,18 @@ SetupDialog::SetupDialog(
 	connect( ui->mapDirLine, &QLineEdit::textChanged, this, &thisClass::onMapDirChanged );
 	connect( ui->modDirLine, &QLineEdit::textChanged, this, &thisClass::onModDirChanged );
 
+	connect( ui->iwadExtraDirBtnAdd, &QToolButton::clicked, this, &thisClass::iwadExtraDirAdd );
+	connect( ui->iwadExtraDirBtnDel, &QToolButton::clicked, this, &thisClass::iwadExtraDirDelete );
+	connect( ui->iwadExtraDirBtnUp, &QToolButton::clicked, this, &thisClass::iwadExtraDirMoveUp );
+	connect( ui->iwadExtraDirBtnDown, &QToolButton::clicked, this, &thisClass::iwadExtraDirMoveDown );
+
+	connect( ui->mapExtraDirBtnAdd, &QToolButton::clicked, this, &thisClass::mapExtraDirAdd );
+	connect( ui->mapExtraDirBtnDel, &QToolButton::clicked, this, &thisClass::mapExtraDirDelete );
+	connect( ui->mapExtraDirBtnUp, &QToolButton::clicked, this, &thisClass::mapExtraDirMoveUp );
+	connect( ui->mapExtraDirBtnDown, &QToolButton::clicked, this, &thisClass::mapExtraDirMoveDown );
+
 	connect( ui->iwadSubdirs, &QCheckBox::toggled, this, &thisClass::onIWADSubdirsToggled );
+	connect( ui->iwadDetectByHeader, &QCheckBox::toggled, this, &thisClass::onIWADDetectionToggled );
 
 	connect( ui->absolutePathsChkBox, &QCheckBox::toggled, this, &thisClass::onAbsolutePathsToggled );
 
@@ -118,6 +187,10 @@ SetupDialog::SetupDialog(
 
 	connect( ui->showEngineOutputChkBox, &QCheckBox::toggled, this, &thisClass::onShowEngineOutputToggled );
 	connect( ui->closeOnLaunchChkBox, &QCheckBox::toggled, this, &thisClass::onCloseOnLaunchToggled );
+	connect( ui->pollDirsChkBox, &QCheckBox::toggled, this, &thisClass::onPollDirsToggled );
+	connect( ui->prewarmFilesChkBox, &QCheckBox::toggled, this, &thisClass::onPrewarmFilesToggled );
+	connect( ui->shareFileCacheChkBox, &QCheckBox::toggled, this, &thisClass::onShareFileCacheToggled );
+	connect( ui->logEngineOutputChkBox, &QCheckBox::toggled, this, &thisClass::onLogEngineOutputToggled );
 
 	connect( ui->doneBtn, &QPushButton::clicked, this, &thisClass::accept );
 
@@ -157,12 +230,16 @@ void SetupDialog::setupEngineList()
 	// setup reaction to key shortcuts and right click
 	ui->engineListView->toggleContextMenu( true );
 	setDefaultEngineAction = ui->engineListView->addAction( "Set as default", {} );
+	discoverEnginesAction = ui->engineListView->addAction( "Discover installed engines", {} );
+	discoverEnginesInDirAction = ui->engineListView->addAction( "Discover engines in directory...", {} );
 	ui->engineListView->enableOpenFileLocation();
 	connect( ui->engineListView->addItemAction, &QAction::triggered, this, &thisClass::engineAdd );
 	connect( ui->engineListView->deleteItemAction, &QAction::triggered, this, &thisClass::engineDelete );
 	connect( ui->engineListView->moveItemUpAction, &QAction::triggered, this, &thisClass::engineMoveUp );
 	connect( ui->engineListView->moveItemDownAction, &QAction::triggered, this, &thisClass::engineMoveDown );
 	connect( setDefaultEngineAction, &QAction::triggered, this, &thisClass::setEngineAsDefault );
+	connect( discoverEnginesAction, &QAction::triggered, this, &thisClass::discoverEngines );
+	connect( discoverEnginesInDirAction, &QAction::triggered, this, &thisClass::discoverEnginesInDir );
 
 	// setup buttons
 	connect( ui->engineBtnAdd, &QPushButton::clicked, this, &thisClass::engineAdd );
@@ -212,6 +289,23 @@ void SetupDialog::setupIWADList()
 	connect( ui->iwadBtnDown, &QPushButton::clicked, this, &thisClass::iwadMoveDown );
 }
 
+void SetupDialog::setupExtraDirList( EditableListView * view, EditableDirectListModel< ExtraDir > & model )
+{
+	view->setModel( &model );
+	view->setSelectionMode( QAbstractItemView::SingleSelection );
+
+	// the order is the priority, it's changed only by the buttons, so that the settings are updated together with the list
+	model.toggleEditing( false );
+	view->toggleNameEditing( false );
+	view->toggleListModifications( false );
+	view->toggleIntraWidgetDragAndDrop( false );
+	view->toggleInterWidgetDragAndDrop( false );
+	view->toggleExternalFileDragAndDrop( false );
+
+	view->toggleContextMenu( true );
+	view->enableOpenFileLocation();
+}
+
 void SetupDialog::timerEvent( QTimerEvent * event )  // called once per second
 {
 	QDialog::timerEvent( event );
@@ -226,13 +320,14 @@ void SetupDialog::timerEvent( QTimerEvent * event )  // called once per second
 
 	if (tickCount % dirUpdateDelay == 0)
 	{
-		if (iwadSettings.updateFromDir && fs::isValidDir( iwadSettings.dir ))  // the second prevents clearing the list when the path is invalid
+		if (iwadSettings.updateFromDir && isAnyDirValid( iwadSettings.getDirs() ))  // the second prevents clearing the list when the path is invalid
 			updateIWADsFromDir();
 	}
 }
 
 SetupDialog::~SetupDialog()
 {
+	engineDiscovery.cancel();  // the engines must not be added into the destroyed model
 	delete ui;
 }
 
@@ -353,6 +448,56 @@ void SetupDialog::editSelectedEngine()
 	}
 }
 
+void SetupDialog::discoverEngines()
+{
+	startEngineDiscovery( getStandardEngineSearchDirs() );
+}
+
+void SetupDialog::discoverEnginesInDir()
+{
+	QString dir = DialogWithPaths::browseDir( this, "where to look for engines" );
+	if (dir.isEmpty())  // user probably clicked cancel
+		return;
+
+	startEngineDiscovery({ { pathConvertor.getAbsolutePath( dir ), /*searchSubdirs*/ true } });
+}
+
+void SetupDialog::startEngineDiscovery( const QVector< EngineSearchDir > & dirs )
+{
+	discoverEnginesAction->setEnabled( false );
+	discoverEnginesInDirAction->setEnabled( false );
+
+	// the engines are added one by one as they are found, the slow directories don't hold back the others
+	engineDiscovery.start( this, dirs,
+		[this]( EngineInfo && engine ) { addDiscoveredEngine( std::move(engine) ); },
+		[this]()
+		{
+			discoverEnginesAction->setEnabled( true );
+			discoverEnginesInDirAction->setEnabled( true );
+		}
+	);
+}
+
+void SetupDialog::addDiscoveredEngine( EngineInfo && engine )
+{
+	// the suggested paths are always absolute
+	if (pathConvertor.usingRelativePaths())
+	{
+		engine.executablePath = pathConvertor.getRelativePath( engine.executablePath );
+		engine.configDir = pathConvertor.getRelativePath( engine.configDir );
+		engine.dataDir = pathConvertor.getRelativePath( engine.dataDir );
+	}
+
+	// the user might have already added it manually
+	QString absExePath = pathConvertor.getAbsolutePath( engine.executablePath );
+	bool isAlreadyListed = findSuch( engineModel, [&]( const Engine & e )
+	                                 { return pathConvertor.getAbsolutePath( e.executablePath ) == absExePath; } ) >= 0;
+	if (isAlreadyListed)
+		return;
+
+	wdg::appendItem( ui->engineListView, engineModel, engine );
+}
+
 
 //----------------------------------------------------------------------------------------------------------------------
 //  IWADs
@@ -415,7 +560,13 @@ void SetupDialog::toggleAutoIWADUpdate( bool enabled )
 
 	ui->iwadDirLine->setEnabled( enabled );
 	ui->iwadDirBtn->setEnabled( enabled );
+	ui->iwadExtraDirListView->setEnabled( enabled );
+	ui->iwadExtraDirBtnAdd->setEnabled( enabled );
+	ui->iwadExtraDirBtnDel->setEnabled( enabled );
+	ui->iwadExtraDirBtnUp->setEnabled( enabled );
+	ui->iwadExtraDirBtnDown->setEnabled( enabled );
 	ui->iwadSubdirs->setEnabled( enabled );
+	ui->iwadDetectByHeader->setEnabled( enabled );
 	ui->iwadBtnAdd->setEnabled( !enabled );
 	ui->iwadBtnDel->setEnabled( !enabled );
 	ui->iwadBtnUp->setEnabled( !enabled );
@@ -429,7 +580,7 @@ void SetupDialog::toggleAutoIWADUpdate( bool enabled )
 	ui->iwadListView->toggleListModifications( !enabled );
 
 	// populate the list
-	if (iwadSettings.updateFromDir && fs::isValidDir( iwadSettings.dir ))  // don't clear the current items when the dir line is empty
+	if (iwadSettings.updateFromDir && isAnyDirValid( iwadSettings.getDirs() ))  // don't clear the current items when the dir line is empty
 		updateIWADsFromDir();
 }
 
@@ -447,7 +598,53 @@ void SetupDialog::onIWADSubdirsToggled( bool checked )
 {
 	iwadSettings.searchSubdirs = checked;
 
-	if (iwadSettings.updateFromDir && fs::isValidDir( iwadSettings.dir ))  // don't clear the current items when the dir line is empty
+	if (iwadSettings.updateFromDir && isAnyDirValid( iwadSettings.getDirs() ))  // don't clear the current items when the dir line is empty
+		updateIWADsFromDir();
+}
+
+void SetupDialog::onIWADDetectionToggled( bool checked )
+{
+	iwadSettings.detectByHeader = checked;
+
+	if (iwadSettings.updateFromDir && isAnyDirValid( iwadSettings.getDirs() ))
+		updateIWADsFromDir();
+}
+
+void SetupDialog::iwadExtraDirAdd()
+{
+	QString dir = DialogWithPaths::browseDir( this, "with IWADs" );
+	if (dir.isEmpty())  // user probably clicked cancel
+		return;
+
+	wdg::appendItem( ui->iwadExtraDirListView, iwadExtraDirModel, { dir } );
+	onIWADExtraDirsChanged();
+}
+
+void SetupDialog::iwadExtraDirDelete()
+{
+	if (wdg::deleteSelectedItem( ui->iwadExtraDirListView, iwadExtraDirModel ) >= 0)
+		onIWADExtraDirsChanged();
+}
+
+void SetupDialog::iwadExtraDirMoveUp()
+{
+	if (wdg::moveUpSelectedItem( ui->iwadExtraDirListView, iwadExtraDirModel ) >= 0)
+		onIWADExtraDirsChanged();
+}
+
+void SetupDialog::iwadExtraDirMoveDown()
+{
+	if (wdg::moveDownSelectedItem( ui->iwadExtraDirListView, iwadExtraDirModel ) >= 0)
+		onIWADExtraDirsChanged();
+}
+
+void SetupDialog::onIWADExtraDirsChanged()
+{
+	iwadSettings.extraDirs = getDirPaths( iwadExtraDirModel );
+
+	highlightInvalidDirs( iwadExtraDirModel );
+
+	if (iwadSettings.updateFromDir && isAnyDirValid( iwadSettings.getDirs() ))
 		updateIWADsFromDir();
 }
 
@@ -476,7 +673,7 @@ void SetupDialog::onIWADDirChanged( const QString & dir )
 
 	highlightDirPathIfInvalid( ui->iwadDirLine, dir );
 
-	if (iwadSettings.updateFromDir && fs::isValidDir( iwadSettings.dir ))
+	if (iwadSettings.updateFromDir && isAnyDirValid( iwadSettings.getDirs() ))
 		updateIWADsFromDir();
 }
 
@@ -487,6 +684,41 @@ void SetupDialog::onMapDirChanged( const QString & dir )
 	highlightDirPathIfInvalid( ui->mapDirLine, dir );
 }
 
+void SetupDialog::mapExtraDirAdd()
+{
+	QString dir = DialogWithPaths::browseDir( this, "with maps" );
+	if (dir.isEmpty())  // user probably clicked cancel
+		return;
+
+	wdg::appendItem( ui->mapExtraDirListView, mapExtraDirModel, { dir } );
+	onMapExtraDirsChanged();
+}
+
+void SetupDialog::mapExtraDirDelete()
+{
+	if (wdg::deleteSelectedItem( ui->mapExtraDirListView, mapExtraDirModel ) >= 0)
+		onMapExtraDirsChanged();
+}
+
+void SetupDialog::mapExtraDirMoveUp()
+{
+	if (wdg::moveUpSelectedItem( ui->mapExtraDirListView, mapExtraDirModel ) >= 0)
+		onMapExtraDirsChanged();
+}
+
+void SetupDialog::mapExtraDirMoveDown()
+{
+	if (wdg::moveDownSelectedItem( ui->mapExtraDirListView, mapExtraDirModel ) >= 0)
+		onMapExtraDirsChanged();
+}
+
+void SetupDialog::onMapExtraDirsChanged()
+{
+	mapSettings.extraDirs = getDirPaths( mapExtraDirModel );
+
+	highlightInvalidDirs( mapExtraDirModel );
+}
+
 void SetupDialog::onModDirChanged( const QString & dir )
 {
 	modSettings.dir = dir;
@@ -496,7 +728,30 @@ void SetupDialog::onModDirChanged( const QString & dir )
 
 void SetupDialog::updateIWADsFromDir()
 {
-	wdg::updateListFromDir( iwadModel, ui->iwadListView, iwadSettings.dir, iwadSettings.searchSubdirs, pathConvertor, doom::isIWAD );
+	const QStringVec dirs = iwadSettings.getDirs();
+
+	// the same merging as in the main window, the copies of the same IWAD in the later directories are skipped
+	QList< IWAD > iwads;
+	QSet< QString > seenFingerprints;
+	for (const QString & dir : dirs)
+	{
+		QList< IWAD > dirIWADs = iwadSettings.detectByHeader
+			? wdg::readItemsFromDir< IWAD >( dir, iwadSettings.searchSubdirs, pathConvertor, doom::isIWADByHeader )
+			: wdg::readItemsFromDir< IWAD >( dir, iwadSettings.searchSubdirs, pathConvertor, doom::allIwadSuffixes );
+		for (IWAD & iwad : dirIWADs)
+		{
+			if (dirs.size() > 1)
+			{
+				// one directory can be inside another one, then the fingerprints are the same too
+				QString fingerprint = doom::getIWADFingerprint( QFileInfo( iwad.path ) );
+				if (seenFingerprints.contains( fingerprint ))
+					continue;
+				seenFingerprints.insert( fingerprint );
+			}
+			iwads.append( std::move(iwad) );
+		}
+	}
+	wdg::updateListContent( iwadModel, ui->iwadListView, std::move(iwads) );
 
 	if (!iwadSettings.defaultIWAD.isEmpty())
 	{
@@ -569,6 +824,12 @@ void SetupDialog::onAbsolutePathsToggled( bool checked )
 
 	iwadSettings.dir = pathConvertor.convertPath( iwadSettings.dir );
 	ui->iwadDirLine->setText( iwadSettings.dir );
+	for (ExtraDir & extraDir : iwadExtraDirModel)
+	{
+		extraDir.path = pathConvertor.convertPath( extraDir.path );
+	}
+	iwadExtraDirModel.contentChanged( 0 );
+	iwadSettings.extraDirs = getDirPaths( iwadExtraDirModel );
 	for (IWAD & iwad : iwadModel)
 	{
 		iwad.path = pathConvertor.convertPath( iwad.path );
@@ -577,6 +838,12 @@ void SetupDialog::onAbsolutePathsToggled( bool checked )
 
 	mapSettings.dir = pathConvertor.convertPath( mapSettings.dir );
 	ui->mapDirLine->setText( mapSettings.dir );
+	for (ExtraDir & extraDir : mapExtraDirModel)
+	{
+		extraDir.path = pathConvertor.convertPath( extraDir.path );
+	}
+	mapExtraDirModel.contentChanged( 0 );
+	mapSettings.extraDirs = getDirPaths( mapExtraDirModel );
 
 	modSettings.dir = pathConvertor.convertPath( modSettings.dir );
 	ui->modDirLine->setText( modSettings.dir );
@@ -603,3 +870,23 @@ void SetupDialog::onCloseOnLaunchToggled( bool checked )
 		ui->showEngineOutputChkBox->setChecked( false );
 	}
 }
+
+void SetupDialog::onPollDirsToggled( bool checked )
+{
+	settings.pollDirectories = checked;
+}
+
+void SetupDialog::onPrewarmFilesToggled( bool checked )
+{
+	settings.prewarmFiles = checked;
+}
+
+void SetupDialog::onShareFileCacheToggled( bool checked )
+{
+	settings.shareFileCache = checked;
+}
+
+void SetupDialog::onLogEngineOutputToggled( bool checked )
+{
+	settings.logEngineOutput = checked;
+}
@@ -12,13 +12,16 @@
 #include "DialogCommon.hpp"
 
 #include "UserData.hpp"  // Engine, IWAD
+#include "EngineDiscovery.hpp"
 #include "Widgets/ListModel.hpp"
 #include "Utils/EventFilters.hpp"  // ConfirmationFilter
 
 #include <QDialog>
 
 class QDir;
+class QFileInfo;
 class QLineEdit;
+class EditableListView;
 class QAction;
 class QItemSelection;
 
@@ -27,6 +30,23 @@ namespace Ui {
 }
 
 
+//======================================================================================================================
+
+/// additional directory of a game file category (e.g. on another disk), an entry of the list in the dialog
+struct ExtraDir : public EditableListModelItem
+{
+	QString path;
+
+	ExtraDir() {}
+	ExtraDir( QString path ) : path( std::move(path) ) {}
+	ExtraDir( const QFileInfo & file );
+
+	// requirements of EditableListModel
+	const QString & getFilePath() const   { return path; }
+	QString getID() const                 { return path; }
+};
+
+
 //======================================================================================================================
 
 class SetupDialog : public QDialog, public DialogWithPaths {
@@ -66,6 +86,9 @@ class SetupDialog : public QDialog, public DialogWithPaths {
 	void editEngine( const QModelIndex & index );
 	void editSelectedEngine();
 
+	void discoverEngines();
+	void discoverEnginesInDir();
+
 	// IWADs
 
 	void iwadAdd();
@@ -79,6 +102,12 @@ class SetupDialog : public QDialog, public DialogWithPaths {
 	void manageIWADsManually();
 	void manageIWADsAutomatically();
 	void onIWADSubdirsToggled( bool checked );
+	void onIWADDetectionToggled( bool checked );
+
+	void iwadExtraDirAdd();
+	void iwadExtraDirDelete();
+	void iwadExtraDirMoveUp();
+	void iwadExtraDirMoveDown();
 
 	// game file directories
 
@@ -90,6 +119,11 @@ class SetupDialog : public QDialog, public DialogWithPaths {
 	void onMapDirChanged( const QString & dir );
 	void onModDirChanged( const QString & dir );
 
+	void mapExtraDirAdd();
+	void mapExtraDirDelete();
+	void mapExtraDirMoveUp();
+	void mapExtraDirMoveDown();
+
 	void updateIWADsFromDir();
 
 	// theme options
@@ -105,25 +139,43 @@ class SetupDialog : public QDialog, public DialogWithPaths {
 
 	void onShowEngineOutputToggled( bool checked );
 	void onCloseOnLaunchToggled( bool checked );
+	void onPollDirsToggled( bool checked );
+	void onPrewarmFilesToggled( bool checked );
+	void onShareFileCacheToggled( bool checked );
+	void onLogEngineOutputToggled( bool checked );
 
  private: // methods
 
 	void setupEngineList();
 	void setupIWADList();
+	void setupExtraDirList( EditableListView * view, EditableDirectListModel< ExtraDir > & model );
+
+	void onIWADExtraDirsChanged();
+	void onMapExtraDirsChanged();
 
 	void toggleAutoIWADUpdate( bool enabled );
 
+	void startEngineDiscovery( const QVector< EngineSearchDir > & dirs );
+	void addDiscoveredEngine( EngineInfo && engine );
+
  private: // members
 
 	Ui::SetupDialog * ui;
 
 	QAction * setDefaultEngineAction;
 	QAction * setDefaultIWADAction;
+	QAction * discoverEnginesAction;
+	QAction * discoverEnginesInDirAction;
 
 	uint tickCount;
 
 	ConfirmationFilter engineConfirmationFilter;
 
+	EngineDiscovery engineDiscovery;
+
+	EditableDirectListModel< ExtraDir > iwadExtraDirModel;  ///< mirrors iwadSettings.extraDirs
+	EditableDirectListModel< ExtraDir > mapExtraDirModel;  ///< mirrors mapSettings.extraDirs
+
  public: // return values from this dialog
 
 	EngineSettings engineSettings;
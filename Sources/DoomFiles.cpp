@@ -7,10 +7,16 @@
 
 #include "DoomFiles.hpp"
 
+#include "Utils/WADReader.hpp"  // g_cachedWadHeaders, g_cachedWadInfo
+
 #include <QVector>
 #include <QHash>
+#include <QMap>
 #include <QFileInfo>
 #include <QRegularExpression>
+#include <QStringBuilder>
+
+#include <algorithm>  // sort
 
 
 namespace doom {
@@ -27,28 +33,51 @@ const QStringVec iwadSuffixes = {"wad", "iwad", "pk3", "ipk3", "pk7", "ipk7", "p
 const QStringVec pwadSuffixes = {"wad", "pwad", "pk3", "pk7", "pkz", "pke", "zip", "7z", "deh", "bex"};
 const QStringVec dukeSuffixes = {"grp", "rff"};
 
+static QStringVec concat( const QStringVec & suffixes1, const QStringVec & suffixes2 )
+{
+	QStringVec result;
+	result.reserve( suffixes1.size() + suffixes2.size() );
+	result.append( suffixes1 );
+	result.append( suffixes2 );
+	return result;
+}
+
+const QStringVec allIwadSuffixes = concat( iwadSuffixes, dukeSuffixes );  // i did not want this, but the guy was insisting on it
+const QStringVec allMapPackSuffixes = concat( pwadSuffixes, dukeSuffixes );
+
 // The correct way would be to recognize the type by file header, but there are incorrectly made mods
 // that present themselfs as IWADs, so in order to support those we need to use the file suffix
 bool isIWAD( const QFileInfo & file )
 {
-	return (iwadSuffixes.contains( file.suffix().toLower() ))
-	     || dukeSuffixes.contains( file.suffix().toLower() );  // i did not want this, but the guy was insisting on it
+	return allIwadSuffixes.contains( file.suffix().toLower() );
 }
 
 bool isMapPack( const QFileInfo & file )
 {
-	return (pwadSuffixes.contains( file.suffix().toLower() ))
-	     || dukeSuffixes.contains( file.suffix().toLower() );  // i did not want this, but the guy was insisting on it
+	return allMapPackSuffixes.contains( file.suffix().toLower() );
 }
 
-QStringList getModFileSuffixes()
+// these suffixes are used only for IWADs, so they can be trusted without reading the file
+static const QStringVec explicitIwadSuffixes = {"iwad", "ipk3", "ipk7"};
+
+bool isIWADByHeader( const QFileInfo & file )
 {
-	QStringList suffixes;
-	for (const QString & suffix : pwadSuffixes)
-		suffixes.append( "*."+suffix );
-	for (const QString & suffix : dukeSuffixes)
-		suffixes.append( "*."+suffix );
-	return suffixes;
+	QString suffix = file.suffix().toLower();
+	if (!allIwadSuffixes.contains( suffix ))
+		return false;
+	if (explicitIwadSuffixes.contains( suffix ) || dukeSuffixes.contains( suffix ))
+		return true;
+
+	auto headerInfo = g_cachedWadHeaders.getFileInfo( file.filePath(), FileStamp( file ) );
+	if (headerInfo.status != ReadStatus::Success)
+		return true;  // we can't tell, rather show it than hide a valid IWAD
+
+	return headerInfo.type == WadType::IWAD;
+}
+
+QString getIWADFingerprint( const QFileInfo & file )
+{
+	return file.fileName().toCaseFolded() % '/' % QString::number( file.size() );
 }
 
 
@@ -159,4 +188,112 @@ QString getStartingMap( const QString & wadFileName )
 }
 
 
+//======================================================================================================================
+//  map names from WADs
+
+QStringList getUniqueMapNamesFromWADs( const QVector< QString > & wadPaths )
+{
+	QMap< QString, int > uniqueMapNames;  // we cannot use QSet because that one is unordered and we need to retain order
+	for (const QString & wadPath : wadPaths)
+	{
+		QFileInfo wadFile( wadPath );  // one stat for both the validity check and the cache freshness check
+		if (!wadFile.isFile())
+			continue;
+
+		const UncertainWadInfo wadInfo = g_cachedWadInfo.getFileInfo( wadPath, FileStamp( wadFile ) );
+		if (wadInfo.status != ReadStatus::Success)
+			continue;
+
+		for (const QString & mapName : wadInfo.mapNames)
+			uniqueMapNames.insert( mapName.toUpper(), 0 );  // the 0 doesn't matter
+	}
+	return uniqueMapNames.keys();
+}
+
+void MapNameSet::addWAD( const QString & wadPath, QStringVec & addedNames, QStringVec & removedNames )
+{
+	QFileInfo wadFile( wadPath );  // one stat for the validity check, the change check and the cache freshness check
+	FileStamp stamp = wadFile.isFile() ? FileStamp( wadFile ) : FileStamp();
+
+	auto wadIter = _wads.find( wadPath );
+	if (wadIter != _wads.end() && wadIter->stamp == stamp)
+		return;
+
+	QStringVec wadMapNames;
+
+	if (wadFile.isFile())
+	{
+		const UncertainWadInfo wadInfo = g_cachedWadInfo.getFileInfo( wadPath, stamp );
+		if (wadInfo.status == ReadStatus::Success)
+		{
+			wadMapNames.reserve( wadInfo.mapNames.size() );
+			for (const QString & mapName : wadInfo.mapNames)
+			{
+				QString upperName = mapName.toUpper();
+				if (!wadMapNames.contains( upperName ))  // a WAD can contain the same map twice, it must be counted once
+					wadMapNames.append( std::move(upperName) );
+			}
+		}
+	}
+
+	// The new names are counted before the old ones are released,
+	// so that the names the changed WAD still contains are neither removed nor added.
+	auto addedBegin = addedNames.size();
+	for (const QString & mapName : wadMapNames)
+		if (++_refCounts[ mapName ] == 1)
+			addedNames.append( mapName );
+	std::sort( addedNames.begin() + addedBegin, addedNames.end() );
+
+	if (wadIter != _wads.end())
+	{
+		auto removedBegin = removedNames.size();
+		releaseNames( wadIter->names, removedNames );
+		std::sort( removedNames.begin() + removedBegin, removedNames.end() );
+	}
+
+	// even a WAD without maps is remembered, so that it's recognized when it's removed
+	_wads.insert( wadPath, { stamp, std::move(wadMapNames) } );
+}
+
+QStringVec MapNameSet::removeWAD( const QString & wadPath )
+{
+	auto wadIter = _wads.find( wadPath );
+	if (wadIter == _wads.end())
+		return {};
+
+	QStringVec removedNames;
+	releaseNames( wadIter->names, removedNames );
+	_wads.erase( wadIter );
+
+	std::sort( removedNames.begin(), removedNames.end() );
+	return removedNames;
+}
+
+void MapNameSet::releaseNames( const QStringVec & wadMapNames, QStringVec & removedNames )
+{
+	for (const QString & mapName : wadMapNames)
+	{
+		auto countIter = _refCounts.find( mapName );
+		if (countIter != _refCounts.end() && --countIter.value() <= 0)
+		{
+			_refCounts.erase( countIter );
+			removedNames.append( mapName );
+		}
+	}
+}
+
+void MapNameSet::clear()
+{
+	_wads.clear();
+	_refCounts.clear();
+}
+
+QStringList MapNameSet::sortedNames() const
+{
+	QStringList names = _refCounts.keys();
+	std::sort( names.begin(), names.end() );
+	return names;
+}
+
+
 } // namespace doom
@@ -11,10 +11,12 @@
 
 #include "Essential.hpp"
 #include "CommonTypes.hpp"
+#include "Utils/FileInfoCache.hpp"  // FileStamp
 
 #include <QVector>
 #include <QString>
 #include <QStringList>
+#include <QHash>
 
 class QFileInfo;
 
@@ -33,12 +35,23 @@ extern const QStringVec iwadSuffixes;
 extern const QStringVec pwadSuffixes;
 extern const QStringVec dukeSuffixes;
 
+/// All the suffixes accepted by isIWAD() and isMapPack(), to be used for suffix-filtered directory traversal.
+extern const QStringVec allIwadSuffixes;
+extern const QStringVec allMapPackSuffixes;
+
 // convenience wrappers to be used, where otherwise lambda would have to be written
 bool isIWAD( const QFileInfo & file );
 bool isMapPack( const QFileInfo & file );
 
-// used to setup file filter in QFileSystemModel
-QStringList getModFileSuffixes();
+/// Stricter variant of isIWAD(), that also reads the file header to filter out the PWADs lying in the IWAD directory.
+/** The result is cached by file size and modification time, so only new or changed files are actually read.
+  * Can be called from a worker thread. */
+bool isIWADByHeader( const QFileInfo & file );
+
+/// Identifies the same IWAD found in multiple directories, without reading its content.
+/** Two files with the same name and size are considered the same IWAD. Different versions of an IWAD (e.g. 1.9 and BFG)
+  * differ in size. This needs to stat the file, so it should be called where the QFileInfo has been queried already. */
+QString getIWADFingerprint( const QFileInfo & file );
 
 
 //======================================================================================================================
@@ -51,6 +64,57 @@ QStringList getStandardMapNames( const QString & iwadFileName );
 QString getStartingMap( const QString & wadFileName );
 
 
+//======================================================================================================================
+//  map names from WADs
+
+/// Reads the map names from the WADs and merges them, so that the entries are not duplicated.
+/** The result is cached by file size and modification time, so only new or changed files are actually read. */
+QStringList getUniqueMapNamesFromWADs( const QVector< QString > & wadPaths );
+
+/// Union of the map names of several WADs, that can be updated one WAD at a time.
+/** Each name is reference-counted by the WADs that contain it, so removing a WAD removes only the names
+  * that no other WAD contains, and adding or removing a WAD costs only as much as the number of its own maps.
+  * The names are stored in upper case, the same form getUniqueMapNamesFromWADs() returns. */
+class MapNameSet {
+
+ public:
+
+	/// Reads the map names of a WAD through the WAD info cache and adds them to the set.
+	/** Appends the names that were not in the set before to addedNames, in sorted order.
+	  * Adding the same WAD again does nothing, unless the file has changed since, then its names are re-read
+	  * and those that no other WAD contains anymore are appended to removedNames. */
+	void addWAD( const QString & wadPath, QStringVec & addedNames, QStringVec & removedNames );
+
+	/// Removes the map names of a previously added WAD.
+	/** Returns the names that are no longer in the set, in sorted order. */
+	QStringVec removeWAD( const QString & wadPath );
+
+	void clear();
+
+	bool isEmpty() const                                 { return _refCounts.isEmpty(); }
+	bool containsWAD( const QString & wadPath ) const    { return _wads.contains( wadPath ); }
+	QStringList wadPaths() const                         { return _wads.keys(); }
+
+	/// All the names in the set, in sorted order.
+	QStringList sortedNames() const;
+
+ private:
+
+	struct WadEntry
+	{
+		FileStamp stamp;   ///< of the file when its names were read
+		QStringVec names;  ///< upper-case map names, without duplicates
+	};
+
+	/// Decrements the counts of the names and appends those that dropped to zero to removedNames.
+	void releaseNames( const QStringVec & wadMapNames, QStringVec & removedNames );
+
+	QHash< QString, WadEntry > _wads;  ///< the added WADs by their paths
+	QHash< QString, int > _refCounts;  ///< in how many of the added WADs each name is
+
+};
+
+
 } // namespace doom
 
 
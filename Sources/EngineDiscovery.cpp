@@ -0,0 +1,305 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: automatic detection of installed engines and their properties
+//======================================================================================================================
+
+#include "EngineDiscovery.hpp"
+
+#include "EngineTraits.hpp"  // isKnownEngine, guessEngineFamily
+#include "Utils/FileSystemUtils.hpp"
+#include "Utils/OSUtils.hpp"
+#include "Utils/ExeReader.hpp"  // g_cachedExeInfo
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSet>
+#include <QMutex>
+#include <QPointer>
+#include <QStringBuilder>
+
+
+//======================================================================================================================
+//  engine properties
+
+#if IS_WINDOWS
+static bool assumeGZDoom49_orLater( const EngineInfo & engine )
+{
+	// If we have version info from the executable file, decide based on the application name and version,
+	// otherwise if the executable file name seems like GZDoom, assume the latest version.
+	if (!engine.exeAppName().isEmpty() && engine.exeVersion().isValid())
+		return engine.exeAppName() == "GZDoom" && engine.exeVersion() >= Version(4,9,0);
+	else
+		return engine.exeBaseName() == "gzdoom";
+}
+#endif
+
+QString suggestEngineName( const EngineInfo & engine )
+{
+ #if IS_WINDOWS
+
+	// On Windows we can use the metadata built into the executable, or the name of its directory.
+	if (!engine.exeAppName().isEmpty())
+		return engine.exeAppName();  // exe metadata should be most reliable source
+	else
+		return fs::getDirnameOfFile( engine.executablePath );
+
+ #else
+
+	// On Linux we have to fallback to the binary name (or use the Flatpak name if there is one).
+	if (engine.sandboxEnvType() != os::Sandbox::None)
+		return engine.sandboxAppName();
+	else
+		return engine.exeBaseName();
+
+ #endif
+}
+
+QString suggestEngineConfigDir( const EngineInfo & engine )
+{
+ #if IS_WINDOWS
+
+	// On Windows, engines usually store their config in the directory of its binaries,
+	// with the exception of latest GZDoom (thanks Graph) that started storing it to Documents\My Games\GZDoom
+	QString dirOfExecutable = fs::getDirOfFile( engine.executablePath );
+	QString portableIniFilePath = fs::getPathFromFileName( dirOfExecutable, "gzdoom_portable.ini" );
+	if (assumeGZDoom49_orLater( engine ) && !fs::isValidFile( portableIniFilePath ))
+		return os::getDocumentsDir()%"/My Games/GZDoom";
+	else
+		return dirOfExecutable;
+
+ #else
+
+	// On Linux they store them in standard user's app config dir (usually something like /home/youda/.config/).
+	if (engine.sandboxEnvType() == os::Sandbox::Snap)
+		return os::getHomeDir()%"/snap/"%engine.exeBaseName()%"/current/.config/"%engine.exeBaseName();
+	else if (engine.sandboxEnvType() == os::Sandbox::Flatpak)  // the engine is a Flatpak installation
+		return os::getHomeDir()%"/.var/app/"%engine.sandboxAppName()%"/.config/"%engine.exeBaseName();
+	else
+		return os::getConfigDirForApp( engine.executablePath );  // -> /home/youda/.config/zdoom
+
+ #endif
+}
+
+QString suggestEngineDataDir( const EngineInfo & engine )
+{
+ #if IS_WINDOWS
+
+	QString dirOfExecutable = fs::getDirOfFile( engine.executablePath );
+	QString portableIniFilePath = fs::getPathFromFileName( dirOfExecutable, "gzdoom_portable.ini" );
+	if (assumeGZDoom49_orLater( engine ) && !fs::isValidFile( portableIniFilePath ))
+		return os::getSavedGamesDir()%"/GZDoom";
+	else
+		return dirOfExecutable;
+
+ #else
+
+	// On Linux it is generally the same as config dir.
+	return suggestEngineConfigDir( engine );
+
+ #endif
+}
+
+
+//======================================================================================================================
+//  discovery
+
+QVector< EngineSearchDir > getStandardEngineSearchDirs()
+{
+	QVector< EngineSearchDir > dirs;
+
+	// the search path of the system
+	const QStringList pathDirs = qEnvironmentVariable("PATH").split( QDir::listSeparator() );
+	for (const QString & dir : pathDirs)
+		if (!dir.isEmpty())
+			dirs.append({ QDir::fromNativeSeparators( dir ), false });
+
+ #if IS_WINDOWS
+
+	// each engine usually has its own directory in these
+	for (const char * envVar : { "ProgramFiles", "ProgramFiles(x86)" })
+	{
+		QString programFiles = qEnvironmentVariable( envVar );
+		if (!programFiles.isEmpty())
+			dirs.append({ QDir::fromNativeSeparators( programFiles ), true });
+	}
+	dirs.append({ "C:/Games", true });
+
+ #else
+
+	dirs.append({ "/usr/bin", false });
+	dirs.append({ "/usr/local/bin", false });
+	dirs.append({ "/usr/games", false });
+	dirs.append({ "/usr/local/games", false });
+	dirs.append({ os::getHomeDir()%"/.local/bin", false });
+	dirs.append({ "/snap/bin", false });
+	dirs.append({ "/var/lib/flatpak/exports/bin", false });
+	dirs.append({ os::getHomeDir()%"/.local/share/flatpak/exports/bin", false });
+
+ #endif
+
+	return dirs;
+}
+
+namespace {
+
+/// State shared by all the tasks of one search.
+struct SearchState
+{
+	QMutex mutex;
+	QSet< QString > seenExecutables;  ///< canonical paths, the same file is often reachable from multiple dirs
+};
+
+using CancelFlag = std::shared_ptr< std::atomic< bool > >;
+
+} // namespace
+
+/// Returns the name by which the engine can be recognized, or an empty string if it's not a known engine.
+static QString getRecognizableName( const QFileInfo & file )
+{
+	QString baseName = file.completeBaseName();
+	if (isKnownEngine( baseName ))
+		return baseName;
+
+ #if !IS_WINDOWS
+	// the exported Flatpak apps are named after their ID, for example org.zdoom.GZDoom
+	QString lastIdSegment = file.fileName().section( '.', -1 );
+	if (isKnownEngine( lastIdSegment ))
+		return lastIdSegment;
+ #endif
+
+	return {};
+}
+
+/// Lists the executable files of the directory, optionally also in one level of its subdirectories.
+static QFileInfoList listExecutables( const EngineSearchDir & searchDir )
+{
+	QStringList dirsToList = { searchDir.path };
+	if (searchDir.searchSubdirs)
+	{
+		const QStringList subdirs = QDir( searchDir.path ).entryList( QDir::Dirs | QDir::NoDotAndDotDot );
+		for (const QString & subdir : subdirs)
+			dirsToList.append( searchDir.path%'/'%subdir );
+	}
+
+	QFileInfoList executables;
+	for (const QString & dirPath : dirsToList)
+	{
+	 #if IS_WINDOWS
+		executables += QDir( dirPath ).entryInfoList( { "*.exe" }, QDir::Files );
+	 #else
+		executables += QDir( dirPath ).entryInfoList( QDir::Files | QDir::Executable );
+	 #endif
+	}
+	return executables;
+}
+
+/// Returns a path that is the same for all the links to the same engine, and different for different engines.
+static QString getExecutableIdentity( const QFileInfo & file, const QString & canonicalPath )
+{
+	// All the Snap launchers in /snap/bin are links to the same /usr/bin/snap, which finds out the application to run
+	// from the name it was started by, so for them the link itself is what identifies the engine.
+	if (os::getSandboxInfo( file.filePath() ).type == os::Sandbox::Snap)
+		return file.absoluteFilePath();
+	if (fs::getFileNameFromPath( canonicalPath ) == "snap")
+	{
+		// a link to a Snap launcher, e.g. /usr/local/bin/gzdoom -> /snap/bin/gzdoom
+		QString target = file.isSymLink() ? file.symLinkTarget() : QString();
+		return os::getSandboxInfo( target ).type == os::Sandbox::Snap ? target : file.absoluteFilePath();
+	}
+	return canonicalPath;
+}
+
+/// Fills everything that doesn't have to be read from the file, must be called in the main thread.
+static EngineInfo makeDiscoveredEngine( QString executablePath, const QString & recognizedName, const os::UncertainExeVersionInfo & versionInfo )
+{
+	EngineInfo engine;
+
+	engine.executablePath = std::move( executablePath );
+	engine.initSandboxInfo( engine.executablePath );
+	engine.initAppInfoFromPath( engine.executablePath );
+	engine.setExeVersionInfo( versionInfo );
+
+	engine.name = suggestEngineName( engine );
+	engine.configDir = suggestEngineConfigDir( engine );
+	engine.dataDir = suggestEngineDataDir( engine );
+	engine.family = guessEngineFamily( recognizedName );
+	engine.assignFamilyTraits( engine.family );
+
+	return engine;
+}
+
+EngineDiscovery::~EngineDiscovery()
+{
+	cancel();
+	// the TaskGroup waits for the running tasks
+}
+
+void EngineDiscovery::cancel()
+{
+	if (_cancelled)
+		*_cancelled = true;
+	_cancelled.reset();
+}
+
+void EngineDiscovery::start( QObject * context, const QVector< EngineSearchDir > & dirs, FoundCallback onFound, FinishedCallback onFinished )
+{
+	cancel();
+
+	CancelFlag cancelled = std::make_shared< std::atomic< bool > >( false );
+	_cancelled = cancelled;
+
+	auto state = std::make_shared< SearchState >();
+	auto sharedOnFound = std::make_shared< FoundCallback >( std::move(onFound) );
+
+	for (const EngineSearchDir & searchDir : dirs)
+	{
+		_tasks.addTask( [ searchDir, context = QPointer< QObject >( context ), cancelled, state, sharedOnFound ]()
+		{
+			const QFileInfoList executables = listExecutables( searchDir );
+			for (const QFileInfo & file : executables)
+			{
+				if (*cancelled)
+					return;
+
+				QString recognizedName = getRecognizableName( file );
+				if (recognizedName.isEmpty())
+					continue;  // don't open the files of the other applications, it's what takes the time
+
+				QString canonicalPath = file.canonicalFilePath();
+				if (canonicalPath.isEmpty())
+					continue;  // broken symlink
+				QString identityPath = getExecutableIdentity( file, canonicalPath );
+				{
+					QMutexLocker lock( &state->mutex );
+					if (state->seenExecutables.contains( identityPath ))
+						continue;
+					state->seenExecutables.insert( identityPath );
+				}
+
+				// The sandbox environment is recognized only from the real location of the Flatpak app,
+				// for the other engines the path the user knows is nicer.
+				QString executablePath = file.filePath();
+				if (os::getSandboxInfo( canonicalPath ).type == os::Sandbox::Flatpak)
+					executablePath = canonicalPath;
+
+				// this is the slow part, and the cache is thread-safe
+				os::UncertainExeVersionInfo versionInfo = os::g_cachedExeInfo.getFileInfo( executablePath );
+
+				postToMainThread( context, [ cancelled, sharedOnFound, executablePath, recognizedName, versionInfo ]() mutable
+				{
+					if (!*cancelled)
+						(*sharedOnFound)( makeDiscoveredEngine( std::move(executablePath), recognizedName, versionInfo ) );
+				});
+			}
+		});
+	}
+
+	// the engines found by the tasks are posted before this, so the finished callback always comes last
+	_tasks.whenAllDone( context, [ cancelled, onFinished = std::move(onFinished) ]()
+	{
+		if (!*cancelled && onFinished)
+			onFinished();
+	});
+}
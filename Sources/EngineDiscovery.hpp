@@ -0,0 +1,87 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: automatic detection of installed engines and their properties
+//======================================================================================================================
+
+#ifndef ENGINE_DISCOVERY_INCLUDED
+#define ENGINE_DISCOVERY_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "UserData.hpp"  // EngineInfo
+#include "Utils/TaskGroup.hpp"
+
+#include <QString>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+#include <atomic>
+
+class QObject;
+
+
+//======================================================================================================================
+//  engine properties
+
+/// Suggests a display name of the engine from its executable info.
+QString suggestEngineName( const EngineInfo & engine );
+
+/// Suggests where the engine stores its config files, the result is always absolute.
+QString suggestEngineConfigDir( const EngineInfo & engine );
+
+/// Suggests where the engine stores its saves and other data files, the result is always absolute.
+QString suggestEngineDataDir( const EngineInfo & engine );
+
+
+//======================================================================================================================
+//  discovery
+
+struct EngineSearchDir
+{
+	QString path;
+	bool searchSubdirs = false;  ///< also search one level of subdirectories, where the engines usually have their own dir
+};
+
+/// Returns the search path of the system and the directories where the engines are usually installed.
+QVector< EngineSearchDir > getStandardEngineSearchDirs();
+
+/// Searches directories for Doom engines in worker threads.
+/**
+  * Every directory is searched in a separate task. The executables are recognized by the names that guessEngineFamily()
+  * knows, and only those are then opened to read their version info, so a search takes about as long as listing
+  * the slowest directory.
+  * Must be used from the main thread. The destructor cancels the search and waits until the running tasks finish.
+  */
+class EngineDiscovery {
+
+ public:
+
+	/// Called for each engine as soon as it's recognized, with the properties already suggested.
+	using FoundCallback = std::function< void ( EngineInfo && engine ) >;
+	using FinishedCallback = std::function< void () >;
+
+	~EngineDiscovery();
+
+	/// Starts searching the directories, a search still in progress is cancelled first.
+	/** Both callbacks are called in the main thread, unless the context has been destroyed in the meantime.
+	  * Each executable is reported only once, even if it's found in multiple directories. */
+	void start( QObject * context, const QVector< EngineSearchDir > & dirs, FoundCallback onFound, FinishedCallback onFinished );
+
+	/// The callbacks of the current search will not be called anymore.
+	void cancel();
+
+	bool isRunning()  { return _tasks.isRunning(); }
+
+ private:
+
+	TaskGroup _tasks;
+	std::shared_ptr< std::atomic< bool > > _cancelled;  ///< of the current search, the tasks and callbacks keep their own
+
+};
+
+
+#endif // ENGINE_DISCOVERY_INCLUDED
@@ -7,17 +7,19 @@
 
 #include "EngineTraits.hpp"
 
-#include "Utils/ContainerUtils.hpp"   // find
 #include "Utils/FileSystemUtils.hpp"  // getFileBasenameFromPath
 
-#include <QHash>
-#include <QRegularExpression>
+#include <QLatin1String>
+
+#include <iterator>  // size
 
 
 //======================================================================================================================
 //  engine definitions - add support for new engines here
 
-static const char * const engineFamilyStrings [] =
+// All the tables are compile-time data, because they are consulted on the path that regenerates the launch command.
+
+static constexpr const char * engineFamilyStrings [] =
 {
 	"ZDoom",
 	"PrBoom",
@@ -26,9 +28,13 @@ static const char * const engineFamilyStrings [] =
 };
 static_assert( std::size(engineFamilyStrings) == size_t(EngineFamily::_EnumEnd), "Please update this table too" );
 
-static const QHash< QString, EngineFamily > knownEngineFamilies =
+struct KnownEngineFamily
+{
+	const char * exeName;  ///< executable name in lower case without the .exe suffix
+	EngineFamily family;
+};
+static constexpr KnownEngineFamily knownEngineFamilies [] =
 {
-	// the key is an executable name in lower case without the .exe suffix
 	{ "zdoom",            EngineFamily::ZDoom },
 	{ "lzdoom",           EngineFamily::ZDoom },
 	{ "gzdoom",           EngineFamily::ZDoom },
@@ -49,23 +55,48 @@ static const QHash< QString, EngineFamily > knownEngineFamilies =
 	// TODO: add all the EDGE ports
 };
 
-static const EngineFamilyTraits engineFamilyTraits [] =
+// only the phases that can take a noticeable time with big mods
+static constexpr LoadPhaseMarker zdoomLoadPhases [] =
 {
-	//              -warp or +map        -complevel or +compatmode   savedir param   has +screenshot_dir   needs -stdout
-	/*ZDoom*/     { MapParamStyle::Map,  CompatLevelStyle::ZDoom,    "-savedir",     true,                 IS_WINDOWS },
-	/*PrBoom*/    { MapParamStyle::Warp, CompatLevelStyle::PrBoom,   "-save",        false,                false },
-	/*MBF*/       { MapParamStyle::Warp, CompatLevelStyle::PrBoom,   "-save",        false,                false },
-	/*Chocolate*/ { MapParamStyle::Warp, CompatLevelStyle::None,     "-savedir",     false,                false },
+	{ "W_Init",        "WAD init" },
+	{ "Texman.Init",   "textures" },
+	{ "LoadActors",    "actors" },
+	{ "R_Init",        "renderer init" },
+	{ "P_Init",        "game init" },
+	{ "\x1d",          "map" },  // the horizontal bar above the level name
+	{ nullptr,         nullptr }
+};
+static constexpr LoadPhaseMarker boomLoadPhases [] =  // Boom descendants and Chocolate Doom share the vanilla messages
+{
+	{ "W_Init",        "WAD init" },
+	{ "R_Init",        "renderer init" },
+	{ "P_Init",        "game init" },
+	{ "S_Init",        "sound init" },
+	{ "ST_Init",       "status bar init" },
+	{ nullptr,         nullptr }
+};
+
+static constexpr EngineFamilyTraits engineFamilyTraits [] =
+{
+	//              -warp or +map        -complevel or +compatmode   savedir param   has +screenshot_dir   needs -stdout   load phases
+	/*ZDoom*/     { MapParamStyle::Map,  CompatLevelStyle::ZDoom,    "-savedir",     true,                 IS_WINDOWS,     zdoomLoadPhases },
+	/*PrBoom*/    { MapParamStyle::Warp, CompatLevelStyle::PrBoom,   "-save",        false,                false,          boomLoadPhases },
+	/*MBF*/       { MapParamStyle::Warp, CompatLevelStyle::PrBoom,   "-save",        false,                false,          boomLoadPhases },
+	/*Chocolate*/ { MapParamStyle::Warp, CompatLevelStyle::None,     "-savedir",     false,                false,          boomLoadPhases },
 };
 static_assert( std::size(engineFamilyTraits) == std::size(engineFamilyStrings), "Please update this table too" );
 
-static const QHash< QString, int > startingMonitorIndexes =
+struct StartingMonitorIndex
+{
+	const char * exeName;  ///< executable name in lower case without the .exe suffix
+	int index;
+};
+static constexpr StartingMonitorIndex startingMonitorIndexes [] =
 {
-	// the key is an executable name in lower case without the .exe suffix
 	{ "zdoom", 1 },
 };
 
-static const QStringList zdoomCompatLevels =
+static constexpr const char * zdoomCompatLevels [] =
 {
 	"0 - Default",        // All compatibility options are turned off.
 	"1 - Doom",           // Enables a set of options that should allow nearly all maps made for vanilla Doom to work in ZDoom:
@@ -82,7 +113,7 @@ static const QStringList zdoomCompatLevels =
 	                      //   corpsegibs, hitscan, invisibility, nopassover, notossdrop, wallrun, maskedmidtex
 };
 
-static const QStringList prboomCompatLevels =
+static constexpr const char * prboomCompatLevels [] =
 {
 	"0  - Doom v1.2",     // (note: flawed; use PrBoom+ 2.5.0.8 or higher instead if this complevel is desired)
 	"1  - Doom v1.666",
@@ -108,20 +139,40 @@ static const QStringList prboomCompatLevels =
 	"21 - MBF21",
 };
 
-static const QStringList noCompatLevels = {};
+static_assert( std::size(zdoomCompatLevels) == 7 && std::size(prboomCompatLevels) == 22, "the compat level numbers are the indexes" );
 
 
 //======================================================================================================================
 //  code
 
+template< size_t Size >
+static QStringList toStringList( const char * const (& strings) [Size] )
+{
+	QStringList list;
+	list.reserve( int(Size) );
+	for (const char * str : strings)
+		list.append( QString::fromLatin1( str ) );
+	return list;
+}
+
 const QStringList & getCompatLevels( CompatLevelStyle style )
 {
+	// converted only once, when the engine of that style is selected for the first time
+	static const QStringList noCompatLevels;
 	if (style == CompatLevelStyle::ZDoom)
-		return zdoomCompatLevels;
+	{
+		static const QStringList zdoomCompatLevelList = toStringList( zdoomCompatLevels );
+		return zdoomCompatLevelList;
+	}
 	else if (style == CompatLevelStyle::PrBoom)
-		return prboomCompatLevels;
+	{
+		static const QStringList prboomCompatLevelList = toStringList( prboomCompatLevels );
+		return prboomCompatLevelList;
+	}
 	else
+	{
 		return noCompatLevels;
+	}
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -137,20 +188,27 @@ const char * familyToStr( EngineFamily family )
 
 EngineFamily familyFromStr( const QString & familyStr )
 {
-	int idx = find( engineFamilyStrings, familyStr );
-	if (idx >= 0)
-		return EngineFamily( idx );
-	else
-		return EngineFamily::_EnumEnd;
+	for (size_t idx = 0; idx < std::size(engineFamilyStrings); ++idx)
+		if (familyStr == QLatin1String( engineFamilyStrings[ idx ] ))
+			return EngineFamily( idx );
+	return EngineFamily::_EnumEnd;
 }
 
 EngineFamily guessEngineFamily( const QString & executableBaseName )
 {
-	auto iter = knownEngineFamilies.find( executableBaseName.toLower() );
-	if (iter != knownEngineFamilies.end())
-		return iter.value();
-	else
-		return EngineFamily::ZDoom;
+	// the table is short, comparing without conversion is faster than hashing a lower-case copy
+	for (const KnownEngineFamily & known : knownEngineFamilies)
+		if (executableBaseName.compare( QLatin1String( known.exeName ), Qt::CaseInsensitive ) == 0)
+			return known.family;
+	return EngineFamily::ZDoom;
+}
+
+bool isKnownEngine( const QString & executableBaseName )
+{
+	for (const KnownEngineFamily & known : knownEngineFamilies)
+		if (executableBaseName.compare( QLatin1String( known.exeName ), Qt::CaseInsensitive ) == 0)
+			return true;
+	return false;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -160,19 +218,41 @@ const Version EngineTraits::emptyVersion;
 
 EngineTraits::EngineTraits()
 {
+	_exeVersionInfoLoaded = false;
 	_familyTraits = nullptr;
+	_compatLevelParam = nullptr;
+	_startingMonitorIndex = 0;
 }
 
 void EngineTraits::loadAppInfo( const QString & executablePath )
 {
-	_exePath = executablePath;
-	_exeBaseName = fs::getFileBasenameFromPath( executablePath );
+	initAppInfoFromPath( executablePath );
 
 	// Sometimes opening an executable file takes incredibly long (even > 1 second) for unknown reason (antivirus maybe?).
 	// So we cache the results here so that at least the subsequent calls are fast.
 	if (fs::isValidFile( executablePath ))
-		_exeVersionInfo = os::g_cachedExeInfo.getFileInfo( executablePath );
+		setExeVersionInfo( os::g_cachedExeInfo.getFileInfo( executablePath ) );
+	else
+		setExeVersionInfo( {} );
+}
 
+void EngineTraits::initAppInfoFromPath( const QString & executablePath )
+{
+	_exePath = executablePath;
+	_exeBaseName = fs::getFileBasenameFromPath( executablePath );
+	_exeVersionInfo = {};
+	_exeVersionInfoLoaded = false;
+	_appNameNormalized = _exeBaseName.toLower();
+
+	resolveDerivedTraits();
+}
+
+void EngineTraits::setExeVersionInfo( const os::UncertainExeVersionInfo & versionInfo )
+{
+	assert( hasAppInfo() );
+
+	_exeVersionInfo = versionInfo;
+	_exeVersionInfoLoaded = true;
 	_appNameNormalized = (!_exeVersionInfo.appName.isEmpty() ? _exeVersionInfo.appName : _exeBaseName).toLower();
 }
 
@@ -182,6 +262,30 @@ void EngineTraits::assignFamilyTraits( EngineFamily family )
 		_familyTraits = &engineFamilyTraits[ size_t(family) ];
 	else
 		_familyTraits = &engineFamilyTraits[ 0 ];  // use ZDoom traits as fallback
+
+	resolveDerivedTraits();
+}
+
+void EngineTraits::resolveDerivedTraits()
+{
+	_compatLevelParam = nullptr;
+	_startingMonitorIndex = 0;
+
+	if (_familyTraits)
+	{
+		// Properly working -compatmode is present only in GZDoom,
+		// for other ZDoom-based engines use at least something, even if it doesn't fully work.
+		if (_exeBaseName == QLatin1String("gzdoom"))
+			_compatLevelParam = "-compatmode";
+		else if (_familyTraits->compLvlStyle == CompatLevelStyle::ZDoom)
+			_compatLevelParam = "+compatmode";
+		else if (_familyTraits->compLvlStyle == CompatLevelStyle::PrBoom)
+			_compatLevelParam = "-complevel";
+	}
+
+	for (const StartingMonitorIndex & entry : startingMonitorIndexes)
+		if (_exeBaseName == QLatin1String( entry.exeName ))
+			_startingMonitorIndex = entry.index;
 }
 
 EngineTraits::SaveBaseDir EngineTraits::baseDirStyleForSaveFiles() const
@@ -195,8 +299,49 @@ EngineTraits::SaveBaseDir EngineTraits::baseDirStyleForSaveFiles() const
 		return SaveBaseDir::WorkingDir;
 }
 
-static const QRegularExpression doom1MapNameRegex("E(\\d+)M(\\d+)");
-static const QRegularExpression doom2MapNameRegex("MAP(\\d+)");
+/// Searches the map name for "E<digits>M<digits>", returns the positions and lengths of both numbers if found.
+static bool scanDoom1MapName( const QString & mapName, int & episodePos, int & episodeLen, int & mapPos, int & mapLen )
+{
+	for (int i = 0; i < mapName.size(); ++i)
+	{
+		if (mapName[ i ] != 'E')
+			continue;
+		int pos = i + 1;
+		int len = 0;
+		while (pos + len < mapName.size() && mapName[ pos + len ].isDigit())
+			++len;
+		if (len == 0 || pos + len >= mapName.size() || mapName[ pos + len ] != 'M')
+			continue;
+		int mpos = pos + len + 1;
+		int mlen = 0;
+		while (mpos + mlen < mapName.size() && mapName[ mpos + mlen ].isDigit())
+			++mlen;
+		if (mlen == 0)
+			continue;
+		episodePos = pos;  episodeLen = len;
+		mapPos = mpos;  mapLen = mlen;
+		return true;
+	}
+	return false;
+}
+
+/// Searches the map name for "MAP<digits>", returns the position and length of the number if found.
+static bool scanDoom2MapName( const QString & mapName, int & mapPos, int & mapLen )
+{
+	for (int from = 0; (from = mapName.indexOf( QLatin1String("MAP"), from )) >= 0; ++from)
+	{
+		int pos = from + 3;
+		int len = 0;
+		while (pos + len < mapName.size() && mapName[ pos + len ].isDigit())
+			++len;
+		if (len > 0)
+		{
+			mapPos = pos;  mapLen = len;
+			return true;
+		}
+	}
+	return false;
+}
 
 QStringVec EngineTraits::getMapArgs( int mapIdx, const QString & mapName ) const
 {
@@ -213,14 +358,14 @@ QStringVec EngineTraits::getMapArgs( int mapIdx, const QString & mapName ) const
 	}
 	else  // this engine only supports the old -warp, we must deduce map number
 	{
-		QRegularExpressionMatch match;
-		if ((match = doom1MapNameRegex.match( mapName )).hasMatch())
+		int episodePos, episodeLen, mapPos, mapLen;
+		if (scanDoom1MapName( mapName, episodePos, episodeLen, mapPos, mapLen ))
 		{
-			return { "-warp", match.captured(1), match.captured(2) };
+			return { "-warp", mapName.mid( episodePos, episodeLen ), mapName.mid( mapPos, mapLen ) };
 		}
-		else if ((match = doom2MapNameRegex.match( mapName )).hasMatch())
+		else if (scanDoom2MapName( mapName, mapPos, mapLen ))
 		{
-			return { "-warp", match.captured(1) };
+			return { "-warp", mapName.mid( mapPos, mapLen ) };
 		}
 		else  // in case the WAD defines it's own map names, we have to resort to guessing the number by using its combo-box index
 		{
@@ -233,14 +378,8 @@ QStringVec EngineTraits::getCompatLevelArgs( int compatLevel ) const
 {
 	assert( hasAppInfo() && hasFamilyTraits() );
 
-	// Properly working -compatmode is present only in GZDoom,
-	// for other ZDoom-based engines use at least something, even if it doesn't fully work.
-	if (_exeBaseName == "gzdoom")
-		return { "-compatmode", QString::number( compatLevel ) };
-	else if (_familyTraits->compLvlStyle == CompatLevelStyle::ZDoom)
-		return { "+compatmode", QString::number( compatLevel ) };
-	else if (_familyTraits->compLvlStyle == CompatLevelStyle::PrBoom)
-		return { "-complevel", QString::number( compatLevel ) };
+	if (_compatLevelParam)
+		return { _compatLevelParam, QString::number( compatLevel ) };
 	else
 		return {};
 }
@@ -249,10 +388,5 @@ QString EngineTraits::getCmdMonitorIndex( int ownIndex ) const
 {
 	assert( hasAppInfo() && hasFamilyTraits() );
 
-	int startingMonitorIndex = 0;
-	auto iter = startingMonitorIndexes.find( _exeBaseName );
-	if (iter != startingMonitorIndexes.end())
-		startingMonitorIndex = iter.value();
-
-	return QString::number( startingMonitorIndex + ownIndex );
+	return QString::number( _startingMonitorIndex + ownIndex );
 }
@@ -14,6 +14,7 @@
 #include "CommonTypes.hpp"
 #include "Utils/OSUtils.hpp"    // SandboxInfo
 #include "Utils/ExeReader.hpp"  // ExeVersionInfo
+#include "Utils/TimeStats.hpp"  // LoadPhaseMarker
 
 #include <QString>
 #include <QStringList>
@@ -40,6 +41,7 @@ enum class CompatLevelStyle
 	PrBoom,  // https://doom.fandom.com/wiki/PrBoom#Compatibility_modes_and_settings
 };
 
+/// Display names of the compat levels, the index of a name is the number passed to the engine.
 const QStringList & getCompatLevels( CompatLevelStyle style );
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -60,6 +62,9 @@ EngineFamily familyFromStr( const QString & familyStr );
 // EngineFamily is user-overridable in EngineDialog, but this is our default automatic detection
 EngineFamily guessEngineFamily( const QString & executableBaseName );
 
+/// Whether the executable name is one of the engines guessEngineFamily() recognizes, and not its ZDoom fallback.
+bool isKnownEngine( const QString & executableBaseName );
+
 //----------------------------------------------------------------------------------------------------------------------
 
 /// Traits that are shared among different engines belonging to the same family.
@@ -70,6 +75,7 @@ struct EngineFamilyTraits
 	const char * saveDirParam;
 	bool hasScreenshotDirParam;
 	bool needsStdoutParam;
+	const LoadPhaseMarker * loadPhaseMarkers;  ///< lines the engine prints during its loading, see LoadPhaseTracker
 };
 
 /// Properties and capabilities of a particular engine that decide what command-line parameters will be used.
@@ -79,12 +85,18 @@ class EngineTraits {
 	QString _exePath;             ///< path of the file from which the application info was constructed
 	QString _exeBaseName;         ///< executable file name without file suffix
 	os::UncertainExeVersionInfo _exeVersionInfo;
+	bool _exeVersionInfoLoaded;   ///< false while the version info is still being read in the background
 	QString _appNameNormalized;   ///< application name normalized for indexing engine property tables
 	// family traits
 	const EngineFamilyTraits * _familyTraits;
+	// derived from both of the above when they change, so that they don't need to be looked up for every command
+	const char * _compatLevelParam;   ///< nullptr if the engine doesn't support compat levels
+	int _startingMonitorIndex;
 
 	static const Version emptyVersion;
 
+	void resolveDerivedTraits();
+
  public:
 
 	// initialization
@@ -96,6 +108,13 @@ class EngineTraits {
 	void loadAppInfo( const QString & executablePath );
 	bool hasAppInfo() const                     { return !_exePath.isEmpty(); }
 
+	/// Initializes only the part of application info that can be deduced from the path, without opening the file.
+	/** Until the version info is supplied via setExeVersionInfo(), the engine is treated as if its version was unknown. */
+	void initAppInfoFromPath( const QString & executablePath );
+	/// Completes the application info with the version info read from the executable, possibly in another thread.
+	void setExeVersionInfo( const os::UncertainExeVersionInfo & versionInfo );
+	bool hasExeVersionInfo() const              { return _exeVersionInfoLoaded; }
+
 	/// Initializes family traits according to specified engine family.
 	void assignFamilyTraits( EngineFamily family );
 	bool hasFamilyTraits() const                { return _familyTraits != nullptr; }
@@ -121,6 +140,8 @@ class EngineTraits {
 
 	bool needsStdoutParam() const               { assert( hasFamilyTraits() ); return _familyTraits->needsStdoutParam; }
 
+	const LoadPhaseMarker * loadPhaseMarkers() const  { assert( hasFamilyTraits() ); return _familyTraits->loadPhaseMarkers; }
+
 	enum class SaveBaseDir
 	{
 		WorkingDir,  ///< path of save file must be relative to the current working directory
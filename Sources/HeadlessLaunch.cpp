@@ -0,0 +1,270 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: launching a preset from the command line without the main window
+//======================================================================================================================
+
+#include "HeadlessLaunch.hpp"
+
+#include "LaunchCommand.hpp"
+#include "OptionsSerializer.hpp"
+#include "DoomFiles.hpp"
+#include "Dialogs/CompatOptsDialog.hpp"  // getCmdArgsFromOptions
+
+#include "Utils/ContainerUtils.hpp"
+#include "Utils/FileSystemUtils.hpp"
+#include "Utils/OSUtils.hpp"
+#include "Utils/ExeReader.hpp"
+#include "Utils/MiscUtils.hpp"  // PathChecker
+#include "Utils/StandardOutput.hpp"
+
+#include <QDir>
+
+
+//======================================================================================================================
+
+/// Returns the options of the preset or the global ones, depending on where the user chose to store them.
+template< typename Options >
+static const Options & selectOptions( OptionsStorage storage, const Options & presetOpts, const Options & globalOpts )
+{
+	return storage == StoreToPreset ? presetOpts : globalOpts;
+}
+
+/// Does the same as MainWindow::fillDerivedEngineInfo(), but synchronously and only for the launched engine.
+static void fillDerivedEngineInfo( EngineInfo & engine )
+{
+	engine.initSandboxInfo( engine.executablePath );
+	engine.initAppInfoFromPath( engine.executablePath );
+	if (fs::isValidFile( engine.executablePath ))
+		engine.setExeVersionInfo( os::g_cachedExeInfo.getFileInfo( engine.executablePath ) );
+	else
+		engine.setExeVersionInfo( {} );
+	engine.assignFamilyTraits( engine.family );
+}
+
+/// Finds the index of the map the same way as the map combo-box of the main window would display it.
+static int getMapIdx( const EngineInfo & engine, const IWAD & iwad, const QStringVec & mapPacks, const QString & mapName )
+{
+	// the index is needed only by the engines that support only -warp and only if the WAD defines its own map names,
+	// so don't read the WADs when it's not needed
+	if (mapName.isEmpty() || engine.supportsCustomMapNames())
+		return -1;
+
+	auto mapNames = doom::getUniqueMapNamesFromWADs( QStringVec{ iwad.path } + mapPacks );
+	if (mapNames.isEmpty())  // the same fallback as in the main window
+		mapNames = doom::getStandardMapNames( fs::getFileNameFromPath( iwad.path ) );
+
+	return int( mapNames.indexOf( mapName ) );
+}
+
+void fillLaunchCommandInput(
+	LaunchCommandInput & input, Preset & preset, EngineInfo & engine, std::optional< IWAD > & iwad, const StoredLaunchOptions & opts
+){
+	input.engine = &engine;
+	if (!preset.selectedConfig.isEmpty() && !engine.configDir.isEmpty())
+		input.configPath = fs::getPathFromFileName( engine.configDir, preset.selectedConfig );
+
+	// the IWAD doesn't have to be in the IWAD list, when the list is updated from a directory it isn't even stored
+	iwad.reset();
+	if (!preset.selectedIWAD.isEmpty())
+		iwad.emplace( QFileInfo( preset.selectedIWAD ) );
+	input.iwad = iwad ? &*iwad : nullptr;
+
+	input.mapPackPaths = preset.selectedMapPacks;
+	input.mods = &preset.mods;
+	input.mapDirs = opts.mapDirs;
+	input.modDir = opts.modDir;
+
+	//-- alternative directories ---------------------------------------------------
+
+	AlternativePaths altPaths = preset.altPaths;
+	if (opts.globalOpts.usePresetNameAsDir)
+	{
+		altPaths.saveDir = fs::sanitizePath( preset.name );
+		altPaths.screenshotDir = engine.hasScreenshotDirParam() ? altPaths.saveDir : QString();
+	}
+
+	// the alternative paths are relative to the engine's data dir by convention, see MainWindow::getSaveDir()
+	PathRebaser engineDataDirRebaser( {}, engine.dataDir, defaultPathStyle );
+	input.isCustomSaveDir = !altPaths.saveDir.isEmpty();
+	input.saveDir = input.isCustomSaveDir ? engineDataDirRebaser.rebasePathBack( altPaths.saveDir ) : engine.dataDir;
+	if (!altPaths.screenshotDir.isEmpty())
+		input.screenshotDir = engineDataDirRebaser.rebasePathBack( altPaths.screenshotDir );
+
+	//-- options, as the main window would restore them into its widgets -----------
+
+	const StorageSettings & storage = opts.storage;
+	const LaunchOptions & activeLaunchOpts = selectOptions( storage.launchOptsStorage, preset.launchOpts, opts.launchOpts );
+	const MultiplayerOptions & activeMultOpts = selectOptions( storage.launchOptsStorage, preset.multOpts, opts.multOpts );
+	const GameplayOptions & activeGameOpts = selectOptions( storage.gameOptsStorage, preset.gameOpts, opts.gameOpts );
+	const CompatibilityOptions & activeCompatOpts = selectOptions( storage.compatOptsStorage, preset.compatOpts, opts.compatOpts );
+	const VideoOptions & activeVideoOpts = selectOptions( storage.videoOptsStorage, preset.videoOpts, opts.videoOpts );
+	const AudioOptions & activeAudioOpts = selectOptions( storage.audioOptsStorage, preset.audioOpts, opts.audioOpts );
+
+	LaunchMode mode = activeLaunchOpts.mode;
+	input.launchMode = mode;
+	// without an IWAD the map combo-boxes would be empty
+	if (iwad)
+	{
+		input.mapName = activeLaunchOpts.mapName;
+		input.mapIdx = getMapIdx( engine, *iwad, preset.selectedMapPacks, input.mapName );
+		input.mapName_demo = activeLaunchOpts.mapName_demo;
+		input.mapIdx_demo = getMapIdx( engine, *iwad, preset.selectedMapPacks, input.mapName_demo );
+	}
+	input.saveFileName = activeLaunchOpts.saveFile;
+	input.demoFileName_record = activeLaunchOpts.demoFile_record;
+	input.demoFileName_replay = activeLaunchOpts.demoFile_replay;
+
+	input.multOpts = activeMultOpts;
+	input.multOpts.isMultiplayer = activeMultOpts.isMultiplayer && mode != ReplayDemo;  // can't replay demo in multiplayer
+
+	// the same rules as in MainWindow::onModeChosen_*() and MainWindow::onMultiplayerToggled()
+	input.skillEnabled = mode == LaunchMap || mode == RecordDemo;
+	input.skillNum = activeGameOpts.skillNum;
+	input.gameOptsEnabled = (mode == Default && !input.multOpts.isMultiplayer) || mode == LaunchMap || mode == RecordDemo;
+	input.gameOpts = activeGameOpts;
+	input.compatLevelEnabled = input.gameOptsEnabled && engine.compatLevelStyle() != CompatLevelStyle::None;
+	input.compatLevel = activeCompatOpts.compatLevel;
+	input.compatOptsCmdArgs = CompatOptsDialog::getCmdArgsFromOptions( activeCompatOpts );
+
+	input.showEngineOutput = false;  // there is no window to show it in
+
+	input.monitorIdx = activeVideoOpts.monitorIdx - 1;  // the first item of the combo-box is a placeholder for leaving it default
+	if (activeVideoOpts.resolutionX > 0)
+		input.resolutionX = QString::number( activeVideoOpts.resolutionX );
+	if (activeVideoOpts.resolutionY > 0)
+		input.resolutionY = QString::number( activeVideoOpts.resolutionY );
+	input.showFps = activeVideoOpts.showFPS;
+	input.audioOpts = activeAudioOpts;
+
+	input.presetCmdArgs = preset.cmdArgs;
+	input.globalCmdArgs = opts.globalOpts.cmdArgs;
+}
+
+int launchPresetHeadless( const QString & presetName, bool dryRun )
+{
+	QString optionsFilePath = QDir( os::getThisAppDataDir() ).filePath( defaultOptionsFileName );
+	if (!fs::isValidFile( optionsFilePath ))
+	{
+		stderrStream << "Options file " << optionsFilePath << " doesn't exist." << Qt::endl;
+		return 1;
+	}
+
+	//-- read the options ----------------------------------------------------------
+
+	StoredLaunchOptions stored;
+	EngineSettings engineSettings;
+	IwadSettings iwadSettings;
+	MapSettings mapSettings;
+	ModSettings modSettings;
+	LauncherSettings settings;
+
+	OptionsToLoad opts
+	{
+		// files
+		{},  // engines
+		{},  // IWADs
+
+		// options
+		stored.launchOpts,
+		stored.multOpts,
+		stored.gameOpts,
+		stored.compatOpts,
+		stored.videoOpts,
+		stored.audioOpts,
+		stored.globalOpts,
+
+		// presets
+		{},  // presets
+		{},  // selected preset
+
+		// global settings
+		engineSettings,
+		iwadSettings,
+		mapSettings,
+		modSettings,
+		settings,
+		{},  // window geometry
+
+		// only the launched preset needs to be deserialized
+		true  // load presets lazily
+	};
+
+	if (!deserializeOptions( opts, parseOptionsFile( optionsFilePath ) ))
+	{
+		return 1;  // errors are already shown during the deserialization
+	}
+	stored.storage = settings;
+	stored.mapDirs = mapSettings.getDirs();
+	stored.modDir = modSettings.dir;
+
+	int presetIdx = findSuch( opts.presets, [&]( const Preset & preset ) { return preset.name == presetName; } );
+	if (presetIdx < 0)
+	{
+		stderrStream << "Preset \"" << presetName << "\" doesn't exist." << Qt::endl;
+		return 1;
+	}
+	Preset & preset = opts.presets[ presetIdx ];
+	loadPresetContent( preset, settings, mapSettings, optionsFilePath );
+
+	//-- find the files of the preset ----------------------------------------------
+
+	int engineIdx = findSuch( opts.engines, [&]( const Engine & engine )
+	                                        { return engine.executablePath == preset.selectedEnginePath; } );
+	if (engineIdx < 0)
+	{
+		stderrStream << "Preset \"" << presetName << "\" has no engine selected." << Qt::endl;
+		return 1;
+	}
+	EngineInfo & engine = opts.engines[ engineIdx ];
+	fillDerivedEngineInfo( engine );
+
+	std::optional< IWAD > iwad;
+	LaunchCommandInput input;
+	fillLaunchCommandInput( input, preset, engine, iwad, stored );
+
+	//-- generate the command ------------------------------------------------------
+
+	// the same arguments as in MainWindow::launch(), see the comments there
+	QDir launcherWorkingDir = QDir::current();
+	QString engineWorkingDir = fs::getAbsoluteDirOfFile( engine.executablePath );
+
+	if (dryRun)
+	{
+		PathChecker p( nullptr, /*verificationRequired*/ false );
+		auto cmd = generateLaunchCommand(
+			input, launcherWorkingDir, launcherWorkingDir.path(), PathStyle::Absolute, engineWorkingDir, settings.pathStyle, QuotePaths, p
+		);
+		stdoutStream << cmd.executable << " " << cmd.arguments.join(' ') << Qt::endl;
+		return 0;
+	}
+
+	PathChecker p( nullptr, /*verificationRequired*/ true );
+	auto cmd = generateLaunchCommand(
+		input, launcherWorkingDir, launcherWorkingDir.path(), PathStyle::Absolute, engineWorkingDir, settings.pathStyle, DontQuotePaths, p
+	);
+	if (cmd.executable.isNull())
+	{
+		return 1;  // errors are already shown during the generation
+	}
+
+	// There is nobody to ask, the user started it explicitly, so at least let them know.
+	if (!cmd.extraPermissions.isEmpty())
+	{
+		stdoutStream << "Granting extra permissions to " << fs::getFileNameFromPath( engine.executablePath ) << ":\n"
+		             << cmd.extraPermissions.join('\n') << Qt::endl;
+	}
+
+	// Make sure the alternative save dir exists, because engine will not create it if demo file path points there.
+	if (!fs::createDirIfDoesntExist( input.saveDir ))
+	{
+		stderrStream << "Failed to create directory \"" << input.saveDir << "\". Check permissions." << Qt::endl;
+		// we can continue without this directory, it will just not save demos
+	}
+
+	EnvVars envVars = stored.globalOpts.envVars + preset.envVars;
+
+	bool success = startDetached( nullptr, cmd.executable, cmd.arguments, engineWorkingDir, envVars );
+	return success ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: launching a preset from the command line without the main window
+//======================================================================================================================
+
+#ifndef HEADLESS_LAUNCH_INCLUDED
+#define HEADLESS_LAUNCH_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "UserData.hpp"
+
+#include <QString>
+
+#include <optional>
+
+struct LaunchCommandInput;
+
+
+//======================================================================================================================
+
+/// The stored options that are not part of the preset, but the launch command is generated from them too.
+struct StoredLaunchOptions
+{
+	LaunchOptions launchOpts;
+	MultiplayerOptions multOpts;
+	GameplayOptions gameOpts;
+	CompatibilityOptions compatOpts;
+	VideoOptions videoOpts;
+	AudioOptions audioOpts;
+	GlobalOptions globalOpts;
+	StorageSettings storage;
+	QStringVec mapDirs;
+	QString modDir;
+};
+
+/// Fills the launch command input from a loaded preset the same way the main window fills it from its widgets.
+/**
+  * Doesn't touch any widgets or global state, so it can be used from worker threads.
+  * \param engine The engine selected in the preset, with its derived information already filled.
+  * \param iwad Receives the IWAD of the preset, the input then points to it, so it must outlive the input.
+  */
+void fillLaunchCommandInput(
+	LaunchCommandInput & input, Preset & preset, EngineInfo & engine, std::optional< IWAD > & iwad, const StoredLaunchOptions & opts
+);
+
+/// Launches the engine with the options stored in a preset, without constructing the main window.
+/**
+  * Only the options file and the files of the preset are read, which makes it fast enough to be used from desktop
+  * shortcuts or scripts. Nothing is saved back.
+  * \param presetName Name of the preset as displayed in the preset list.
+  * \param dryRun Only print the command to the standard output instead of launching it.
+  * \return Exit code for the application.
+  */
+int launchPresetHeadless( const QString & presetName, bool dryRun );
+
+
+#endif // HEADLESS_LAUNCH_INCLUDED
@@ -0,0 +1,546 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: generation of the command that launches the engine, independent of the widgets
+//======================================================================================================================
+
+#include "LaunchCommand.hpp"
+
+#include "Utils/MiscUtils.hpp"  // PathChecker, splitCommandLineArguments
+#include "Utils/ErrorHandling.hpp"
+
+#include <QFileInfo>
+#include <QSet>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QStringBuilder>
+
+
+//======================================================================================================================
+//  helpers
+
+// Iterates over all directories which the engine will need to access (either for reading or writing).
+template< typename Functor >
+static void forEachDirToBeAccessed( const LaunchCommandInput & input, const Functor & loopBody )
+{
+	if (!input.engine)
+	{
+		return;
+	}
+
+	// dir of config files
+	if (!input.configPath.isEmpty())
+	{
+		loopBody( input.engine->configDir );  // cannot be empty otherwise config would not be selected
+	}
+
+	// dir of IWAD
+	if (input.iwad)
+	{
+		loopBody( fs::getDirOfFile( input.iwad->path ) );
+	}
+
+	// dirs of map files
+	if (!input.mapPackPaths.isEmpty())
+	{
+		// aggregate the map files under the configured map dirs they are in, each dir is used only once
+		QVector< bool > mapDirUsed( input.mapDirs.size(), false );
+		for (const QString & mapPackPath : input.mapPackPaths)
+		{
+			int mapDirIdx = 0;
+			while (mapDirIdx < input.mapDirs.size() && !fs::isInsideDir( mapPackPath, QDir( input.mapDirs[ mapDirIdx ] ) ))
+				++mapDirIdx;
+
+			if (mapDirIdx < input.mapDirs.size())
+			{
+				if (!mapDirUsed[ mapDirIdx ])
+				{
+					loopBody( input.mapDirs[ mapDirIdx ] );
+					mapDirUsed[ mapDirIdx ] = true;
+				}
+			}
+			else  // the preset might have been saved with different map dirs
+			{
+				loopBody( fs::getDirOfFile( mapPackPath ) );
+			}
+		}
+	}
+
+	// dirs of mod files
+	if (input.mods)
+	{
+		QDir modDir( input.modDir );
+		bool modDirUsed = false;
+		for (const Mod & mod : *input.mods)
+		{
+			if (!mod.checked)
+				continue;
+
+			if (fs::isInsideDir( mod.path, modDir ))  // aggregate all mods inside the configured mod dir under single dir path
+			{
+				if (!modDirUsed)  // use it only once
+				{
+					loopBody( input.modDir );
+					modDirUsed = true;
+				}
+			}
+			else  // but still add directories outside of the configured mod dir, because mod dir is only a hint
+			{
+				loopBody( fs::getDirOfFile( mod.path ) );
+			}
+		}
+	}
+
+	// dir of saves and demo files
+	if ((input.launchMode == LoadSave && !input.saveFileName.isEmpty())
+	 || (input.launchMode == ReplayDemo && !input.demoFileName_replay.isEmpty()))
+	{
+		loopBody( input.saveDir );
+	}
+
+	// dir of screenshots
+	if (!input.screenshotDir.isEmpty())
+	{
+		loopBody( input.screenshotDir );
+	}
+}
+
+QStringVec getDirsToBeAccessed( const LaunchCommandInput & input )
+{
+	QSet< QString > dirSet;  // de-duplicate the paths
+
+	forEachDirToBeAccessed( input, [&]( const QString & dir )
+	{
+		dirSet.insert( dir );
+	});
+
+	return QStringVec( dirSet.begin(), dirSet.end() );
+}
+
+/// Concatenates everything the file arguments of the launch command are generated from.
+/** Building this string is much cheaper than rebasing all the paths, so it's used to find out whether they need to be. */
+static QString makeFileArgumentsKey(
+	const LaunchCommandInput & input, const QString & engineWorkingDir, PathStyle argPathStyle, bool quotePaths
+){
+	QString key;
+	key.reserve( 64 * ((input.mods ? input.mods->size() : 0) + input.mapPackPaths.size() + 4) );
+
+	key += engineWorkingDir;
+	key += '\n';
+	key += argPathStyle == PathStyle::Absolute ? 'a' : 'r';
+	key += quotePaths ? 'q' : '-';
+	key += '\n';
+
+	key += input.configPath; key += '\n';
+
+	if (input.iwad)
+	{
+		key += input.iwad->path; key += '\n';
+	}
+
+	for (const QString & mapFilePath : input.mapPackPaths)
+	{
+		key += mapFilePath; key += '\n';
+	}
+
+	if (input.mods)
+	{
+		for (const Mod & mod : *input.mods)
+		{
+			if (!mod.isSeparator && mod.checked)
+			{
+				// a custom argument must not be mistaken for a file of the same name
+				key += mod.isCmdArg ? '+' : '-';
+				key += mod.isCmdArg ? mod.fileName : mod.path;
+				key += '\n';
+			}
+		}
+	}
+
+	return key;
+}
+
+static QString rebaseSaveFilePath(
+	const QString & filePath, const PathRebaser & workingDirRebaser, const LaunchCommandInput & input, const QDir & launcherWorkingDir
+){
+	// the base dir for the save file parameter depends on the engine and its version
+	if (input.engine->baseDirStyleForSaveFiles() == EngineTraits::SaveBaseDir::SaveDir)
+	{
+		PathRebaser saveDirRebaser( launcherWorkingDir, input.saveDir, PathStyle::Relative, workingDirRebaser.quotePaths() );
+		return saveDirRebaser.rebaseAndQuotePath( filePath );
+	}
+	else
+	{
+		return workingDirRebaser.rebaseAndQuotePath( filePath );
+	}
+}
+
+
+//======================================================================================================================
+//  command generation
+
+os::ShellCommand generateLaunchCommand(
+	LaunchCommandInput & input, const QDir & launcherWorkingDir,
+	const QString & parentWorkingDir, PathStyle enginePathStyle, const QString & engineWorkingDir, PathStyle argPathStyle,
+	bool quotePaths, PathChecker & p, LaunchCommandCache * cache
+){
+	os::ShellCommand cmd;
+
+	// The stored engine path is relative to DoomRunner's directory, but we need it relative to parentWorkingDir.
+	PathRebaser parentDirRebaser( launcherWorkingDir, parentWorkingDir, enginePathStyle, quotePaths );
+	// All stored paths are relative to DoomRunner's directory, but we need them relative to engineWorkingDir.
+	PathRebaser engineDirRebaser( launcherWorkingDir, engineWorkingDir, argPathStyle, quotePaths );
+	// the rebaser remembers the paths it had to resolve, so reuse the one from the last time, if it's set up the same
+	if (cache && cache->engineDirRebaser && cache->engineDirRebaser->hasSameSetup( engineDirRebaser ))
+		engineDirRebaser = *cache->engineDirRebaser;
+
+	//-- engine --------------------------------------------------------------------
+
+	if (!input.engine)
+	{
+		return {};  // no point in generating a command if we don't even know the engine, it determines everything
+	}
+
+	EngineInfo & engine = *input.engine;  // non-const so that we can change color of invalid paths
+
+	{
+		p.checkItemFilePath( engine, "the selected engine", "Please update its path in Menu -> Initial Setup, or select another one." );
+
+		// get the beginning of the launch command based on OS and installation type
+		cmd = os::getRunCommand( engine.executablePath, engine.sandboxInfo(), parentDirRebaser, getDirsToBeAccessed( input ) );
+	}
+
+	auto appendCustomArguments = [&]( QStringVec & args, const QString & customArgsStr )
+	{
+		auto splitArgs = splitCommandLineArguments( customArgsStr );
+		for (const auto & arg : splitArgs)
+		{
+			if (quotePaths && arg.wasQuoted)
+				args << quoted( arg.str );
+			else
+				args << arg.str;
+		}
+	};
+
+	// Rebasing and quoting of all the files is the most expensive part of the command, and most of the updates
+	// of the displayed command are caused by other options, so this part is reused while none of the files change.
+	auto generateFileArguments = [&]()
+	{
+		QStringVec fileArgs;
+
+		//-- engine's config -----------------------------------------------------------
+
+		if (!input.configPath.isEmpty())
+		{
+			p.checkFilePath( input.configPath, "the selected config", "Please update the config dir in Menu -> Initial Setup, or select another one." );
+			fileArgs << "-config" << engineDirRebaser.rebaseAndQuotePath( input.configPath );
+		}
+
+		//-- game data files -----------------------------------------------------------
+
+		// IWAD
+		if (input.iwad)
+		{
+			p.checkItemFilePath( *input.iwad, "selected IWAD", "Please select another one." );
+			fileArgs << "-iwad" << engineDirRebaser.rebaseAndQuotePath( input.iwad->path );
+		}
+
+		// This part is tricky.
+		// Older engines only accept single -file parameter, so all the regular map/mod files must be listed together.
+		// But the user is allowed to intersperse the regular files with deh/bex files or custom cmd arguments.
+		// So we must somehow build an ordered sequence of mod files and custom arguments in which all the regular files are
+		// grouped together, and the easiest option seems to be by using a placeholder item.
+
+		QStringVec modArguments;
+		QStringVec fileList;
+
+		auto addFileAccordingToSuffix = [&]( const QString & filePath )
+		{
+			QString suffix = QFileInfo( filePath ).suffix().toLower();
+			if (suffix == "deh") {
+				modArguments << "-deh" << engineDirRebaser.rebaseAndQuotePath( filePath );
+			} else if (suffix == "bex") {
+				modArguments << "-bex" << engineDirRebaser.rebaseAndQuotePath( filePath );
+			} else {
+				if (fileList.isEmpty())
+					modArguments << "-file" << "<file_list>";  // insert placeholder where all the files will be together
+				fileList.append( engineDirRebaser.rebaseAndQuotePath( filePath ) );
+			}
+		};
+
+		// map files
+		for (const QString & mapFilePath : input.mapPackPaths)
+		{
+			p.checkAnyPath( mapFilePath, "the selected map pack", "Please select another one." );
+			addFileAccordingToSuffix( mapFilePath );
+		}
+
+		// mod files
+		if (input.mods)
+		{
+			for (Mod & mod : *input.mods)
+			{
+				if (!mod.isSeparator && mod.checked)
+				{
+					if (mod.isCmdArg) {  // this is not a file but a custom command line argument
+						appendCustomArguments( modArguments, mod.fileName );  // the fileName holds the argument value
+					} else {
+						p.checkItemAnyPath( mod, "the selected mod", "Please update the mod list." );
+						addFileAccordingToSuffix( mod.path );
+					}
+				}
+			}
+		}
+
+		// output the final sequence to the file arguments
+		for (QString & modArgument : modArguments)
+		{
+			if (modArgument == "<file_list>") {
+				// replace the placeholder with the actual list
+				for (QString & filePath : fileList)
+					fileArgs << std::move(filePath);
+			} else {
+				fileArgs << std::move(modArgument);
+			}
+		}
+
+		return fileArgs;
+	};
+
+	if (cache && !p.isVerificationRequired())
+	{
+		QString fileArgsKey = makeFileArgumentsKey( input, engineWorkingDir, argPathStyle, quotePaths );
+		if (fileArgsKey != cache->fileArgsKey)
+		{
+			cache->fileArgs = generateFileArguments();
+			cache->fileArgsKey = std::move(fileArgsKey);
+		}
+		cmd.arguments << cache->fileArgs;
+	}
+	else
+	{
+		cmd.arguments << generateFileArguments();
+	}
+
+	if (cache)
+		cache->engineDirRebaser = engineDirRebaser;
+
+	//-- alternative directories ---------------------------------------------------
+	// Rather set them before the launch parameters, because some of the parameters
+	// (e.g. -loadgame) can be relative to these alternative directories.
+
+	if (input.isCustomSaveDir)
+	{
+		p.checkNotAFile( input.saveDir, "the save dir", {} );
+		cmd.arguments << engine.saveDirParam() << engineDirRebaser.rebaseAndQuotePath( input.saveDir );
+	}
+	if (!input.screenshotDir.isEmpty())
+	{
+		p.checkNotAFile( input.screenshotDir, "the screenshot dir", {} );
+		cmd.arguments << "+screenshot_dir" << engineDirRebaser.rebaseAndQuotePath( input.screenshotDir );
+	}
+
+	//-- launch mode and parameters ------------------------------------------------
+	// Beware that while -record and -playdemo are either absolute or relative to the current working dir
+	// -loadgame might need to be relative to -savedir, depending on the engine and its version
+
+	if (input.launchMode == LaunchMap)
+	{
+		cmd.arguments << engine.getMapArgs( input.mapIdx, input.mapName );
+	}
+	else if (input.launchMode == LoadSave && !input.saveFileName.isEmpty())
+	{
+		// save dir cannot be empty, otherwise there would be no save files to choose from
+		QString trueSavePath = fs::getPathFromFileName( input.saveDir, input.saveFileName );
+		p.checkFilePath( trueSavePath, "the selected save file", "Please select another one." );
+		cmd.arguments << "-loadgame" << rebaseSaveFilePath( trueSavePath, engineDirRebaser, input, launcherWorkingDir );
+	}
+	else if (input.launchMode == RecordDemo && !input.demoFileName_record.isEmpty())
+	{
+		// if demo dir is empty (no custom save dir and engine.dataDir is not set), then the demo file name will be used as is
+		QString demoPath = fs::getPathFromFileName( input.saveDir, input.demoFileName_record );
+		cmd.arguments << "-record" << engineDirRebaser.rebaseAndQuotePath( demoPath );
+		cmd.arguments << engine.getMapArgs( input.mapIdx_demo, input.mapName_demo );
+	}
+	else if (input.launchMode == ReplayDemo && !input.demoFileName_replay.isEmpty())
+	{
+		// demo dir cannot be empty, otherwise there would be no demo files to choose from
+		QString demoPath = fs::getPathFromFileName( input.saveDir, input.demoFileName_replay );
+		p.checkFilePath( demoPath, "the selected demo", "Please select another one." );
+		cmd.arguments << "-playdemo" << engineDirRebaser.rebaseAndQuotePath( demoPath );
+	}
+
+	//-- gameplay and compatibility options ----------------------------------------
+
+	const GameplayOptions & gameOpts = input.gameOpts;
+	if (input.skillEnabled)
+		cmd.arguments << "-skill" << QString::number( input.skillNum );
+	if (input.gameOptsEnabled && gameOpts.noMonsters)
+		cmd.arguments << "-nomonsters";
+	if (input.gameOptsEnabled && gameOpts.fastMonsters)
+		cmd.arguments << "-fast";
+	if (input.gameOptsEnabled && gameOpts.monstersRespawn)
+		cmd.arguments << "-respawn";
+	if (input.gameOptsEnabled && gameOpts.dmflags1 != 0)
+		cmd.arguments << "+dmflags" << QString::number( gameOpts.dmflags1 );
+	if (input.gameOptsEnabled && gameOpts.dmflags2 != 0)
+		cmd.arguments << "+dmflags2" << QString::number( gameOpts.dmflags2 );
+
+	if (input.compatLevelEnabled && input.compatLevel >= 0)
+		cmd.arguments << engine.getCompatLevelArgs( input.compatLevel );
+	if (input.gameOptsEnabled && !input.compatOptsCmdArgs.isEmpty())
+		cmd.arguments << input.compatOptsCmdArgs;
+	if (gameOpts.allowCheats)
+		cmd.arguments << "+sv_cheats" << "1";
+
+	//-- multiplayer options -------------------------------------------------------
+
+	const MultiplayerOptions & multOpts = input.multOpts;
+	if (multOpts.isMultiplayer)
+	{
+		switch (multOpts.multRole)
+		{
+		 case MultRole::Server:
+			cmd.arguments << "-host" << QString::number( multOpts.playerCount );
+			if (multOpts.port != 5029)
+				cmd.arguments << "-port" << QString::number( multOpts.port );
+			switch (multOpts.gameMode)
+			{
+			 case Deathmatch:
+				cmd.arguments << "-deathmatch";
+				break;
+			 case TeamDeathmatch:
+				cmd.arguments << "-deathmatch" << "+teamplay";
+				break;
+			 case AltDeathmatch:
+				cmd.arguments << "-altdeath";
+				break;
+			 case AltTeamDeathmatch:
+				cmd.arguments << "-altdeath" << "+teamplay";
+				break;
+			 case Cooperative: // default mode, which is started without any param
+				break;
+			 default:
+				reportLogicError( nullptr, "Invalid game mode index", "The game mode index is out of range." );
+			}
+			if (multOpts.teamDamage != 0.0)
+				cmd.arguments << "+teamdamage" << QString::number( multOpts.teamDamage, 'f', 2 );
+			if (multOpts.timeLimit != 0)
+				cmd.arguments << "-timer" << QString::number( multOpts.timeLimit );
+			if (multOpts.fragLimit != 0)
+				cmd.arguments << "+fraglimit" << QString::number( multOpts.fragLimit );
+			cmd.arguments << "-netmode" << QString::number( multOpts.netMode );
+			break;
+		 case MultRole::Client:
+			cmd.arguments << "-join" << multOpts.hostName % ":" % QString::number( multOpts.port );
+			if (input.clientPort != 0)
+				cmd.arguments << "-port" << QString::number( input.clientPort );
+			break;
+		 default:
+			reportLogicError( nullptr, "Invalid multiplayer role index", "The multiplayer role index is out of range." );
+		}
+	}
+
+	//-- output options ------------------------------------------------------------
+
+	// On Windows ZDoom doesn't log its output to stdout by default.
+	// Force it to do so, so that our ProcessOutputWindow displays something.
+	if (input.showEngineOutput && engine.needsStdoutParam())
+		cmd.arguments << "-stdout";
+
+	// video options
+	if (input.monitorIdx >= 0)
+	{
+		cmd.arguments << "+vid_adapter" << engine.getCmdMonitorIndex( input.monitorIdx );  // some engines index monitors from 1 and others from 0
+	}
+	if (!input.resolutionX.isEmpty())
+		cmd.arguments << "-width" << input.resolutionX;
+	if (!input.resolutionY.isEmpty())
+		cmd.arguments << "-height" << input.resolutionY;
+	if (input.showFps)
+		cmd.arguments << "+vid_fps" << "1";
+
+	// audio options
+	if (input.audioOpts.noSound)
+		cmd.arguments << "-nosound";
+	if (input.audioOpts.noSFX)
+		cmd.arguments << "-nosfx";
+	if (input.audioOpts.noMusic)
+		cmd.arguments << "-nomusic";
+
+	//-- additional custom command line arguments ----------------------------------
+
+	if (!input.presetCmdArgs.isEmpty())
+		appendCustomArguments( cmd.arguments, input.presetCmdArgs );
+
+	if (!input.globalCmdArgs.isEmpty())
+		appendCustomArguments( cmd.arguments, input.globalCmdArgs );
+
+	//------------------------------------------------------------------------------
+
+	return p.gotSomeInvalidPaths() ? os::ShellCommand() : cmd;
+}
+
+
+//======================================================================================================================
+//  process start
+
+const QProcessEnvironment & getSystemEnvironment()
+{
+	// Copying the environment of this process involves a system call and parsing of all the variables,
+	// and it doesn't change while we are running.
+	static const QProcessEnvironment systemEnv = QProcessEnvironment::systemEnvironment();
+	return systemEnv;
+}
+
+QProcessEnvironment makeProcessEnvironment( const EnvVars & envVars )
+{
+	QProcessEnvironment env = getSystemEnvironment();  // implicitly shared, detaches only if there is something to add
+	for (const auto & envVar : envVars)
+	{
+		env.insert( envVar.name, envVar.value );
+	}
+	return env;
+}
+
+const QProcessEnvironment & PreparedEnvironment::get( const EnvVars & globalEnvVars, const EnvVars & presetEnvVars )
+{
+	if (!_isPrepared || globalEnvVars != _globalEnvVars || presetEnvVars != _presetEnvVars)
+	{
+		_globalEnvVars = globalEnvVars;
+		_presetEnvVars = presetEnvVars;
+		_env = makeProcessEnvironment( globalEnvVars + presetEnvVars );
+		_isPrepared = true;
+	}
+	return _env;
+}
+
+bool startDetached(
+	QWidget * parent, const QString & executable, const QStringVec & arguments, const QString & workingDir, const EnvVars & envVars
+){
+	return startDetached( parent, executable, arguments, workingDir, makeProcessEnvironment( envVars ) );
+}
+
+bool startDetached(
+	QWidget * parent, const QString & executable, const QStringVec & arguments, const QString & workingDir,
+	const QProcessEnvironment & env
+){
+	QString executableName = fs::getFileNameFromPath( executable );
+
+	QProcess process;
+
+	process.setProgram( executable );
+	process.setArguments( arguments.toList() );
+	process.setWorkingDirectory( workingDir );
+
+	process.setProcessEnvironment( env );
+
+	bool success = process.startDetached();
+	if (!success)
+	{
+		reportRuntimeError( parent, "Process start error", "Failed to start \""%executableName%"\" ("%process.errorString()%")" );
+	}
+
+	return success;
+}
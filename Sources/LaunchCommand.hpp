@@ -0,0 +1,158 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: generation of the command that launches the engine, independent of the widgets
+//======================================================================================================================
+
+#ifndef LAUNCH_COMMAND_INCLUDED
+#define LAUNCH_COMMAND_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "CommonTypes.hpp"
+#include "UserData.hpp"
+#include "Utils/FileSystemUtils.hpp"  // PathStyle, PathRebaser
+#include "Utils/OSUtils.hpp"  // ShellCommand
+
+#include <QString>
+#include <QList>
+#include <QDir>
+#include <QProcessEnvironment>
+
+#include <optional>
+
+class QWidget;
+class PathChecker;
+
+
+//======================================================================================================================
+/// Everything the launch command is generated from.
+/**
+  * It's filled either from the widgets of the main window, or directly from the stored options when a preset
+  * is launched from the command line without constructing the window. All the paths are relative to the working dir
+  * of the launcher, the same way they are stored.
+  */
+struct LaunchCommandInput
+{
+	// files - non-const, so that the invalid ones can be highlighted in the lists
+	EngineInfo * engine = nullptr;
+	QString configPath;            ///< empty if no config is selected
+	IWAD * iwad = nullptr;
+	QStringVec mapPackPaths;
+	QList< Mod > * mods = nullptr;
+	QStringVec mapDirs;            ///< directories containing the map packs, for the sandbox permissions
+	QString modDir;                ///< directory containing most of the mods, for the sandbox permissions
+
+	// alternative directories
+	QString saveDir;               ///< where the saves and demos are, either the custom save dir or the engine's data dir
+	bool isCustomSaveDir = false;  ///< whether the save dir needs to be passed to the engine
+	QString screenshotDir;         ///< empty if the engine should use its default
+
+	// launch mode
+	LaunchMode launchMode = Default;
+	int mapIdx = -1;               ///< index of the map in the list of available maps, needed by engines without +map
+	QString mapName;
+	QString saveFileName;          ///< relative to the save dir
+	int mapIdx_demo = -1;
+	QString mapName_demo;
+	QString demoFileName_record;   ///< relative to the save dir
+	QString demoFileName_replay;   ///< relative to the save dir
+
+	// gameplay and compatibility options
+	bool skillEnabled = false;     ///< the skill doesn't apply when loading a save or replaying a demo
+	int skillNum = TooYoungToDie;
+	bool gameOptsEnabled = false;  ///< the same for the other gameplay and compatibility options
+	GameplayOptions gameOpts;
+	bool compatLevelEnabled = false;
+	int compatLevel = -1;
+	QStringVec compatOptsCmdArgs;
+
+	// other options
+	MultiplayerOptions multOpts;   ///< isMultiplayer also says whether the multiplayer is allowed in this launch mode
+	uint16_t clientPort = 0;       ///< own port of a client, needed when more instances run on the same machine, 0 means default
+	bool showEngineOutput = false;
+	int monitorIdx = -1;           ///< -1 means the engine's default monitor
+	QString resolutionX;           ///< empty means the engine's default
+	QString resolutionY;
+	bool showFps = false;
+	AudioOptions audioOpts;
+
+	QString presetCmdArgs;
+	QString globalCmdArgs;
+};
+
+/// Fragments of the previously generated command, which are expensive to generate, but change only sometimes.
+struct LaunchCommandCache
+{
+	QString fileArgsKey;  ///< everything the file arguments were generated from, see makeFileArgumentsKey()
+	QStringVec fileArgs;  ///< config, IWAD, map packs and mods
+	std::optional< PathRebaser > engineDirRebaser;  ///< kept for the paths it remembers
+};
+
+/// Gets (deduplicated) directories which the engine will need to access (either for reading or writing).
+/** Required for supporting sandbox environments like Snap or Flatpak. */
+QStringVec getDirsToBeAccessed( const LaunchCommandInput & input );
+
+/// Generates a command to be run, displayed or saved to a script file, according to the specified options.
+/**
+  * \param input Options selected by the user. The engine must not be null.
+  * \param launcherWorkingDir Working directory of the launcher, to which all the input paths are relative.
+  * \param parentWorkingDir Working directory when the command is executed by the parent process.
+  *                         This will determine the relative path of the engine executable in the command.
+  * \param enginePathStyle Path style to be used for the engine executable.
+  * \param engineWorkingDir Working directory for the engine process that will be started.
+  *                         This will determine the relative paths of the file or directory arguments passed to the engine.
+  * \param argPathStyle Path style to be used for the paths in the command line arguments.
+  * \param quotePaths Surround each path in the command with quotes.
+  *                   Required for displaying the command or saving it to a script file.
+  * \param pathChecker Verifies each path in the command, if it was set up to.
+  * \param cache Fragments of the previously generated command that can be reused if their inputs haven't changed.
+  *              Used only without path verification, the verification must go through all the paths every time.
+  */
+os::ShellCommand generateLaunchCommand(
+	LaunchCommandInput & input, const QDir & launcherWorkingDir,
+	const QString & parentWorkingDir, PathStyle enginePathStyle, const QString & engineWorkingDir, PathStyle argPathStyle,
+	bool quotePaths, PathChecker & pathChecker, LaunchCommandCache * cache = nullptr
+);
+
+//======================================================================================================================
+//  process start
+
+/// Environment of this process, read only once.
+const QProcessEnvironment & getSystemEnvironment();
+
+/// Environment of this process with the variables added or overriden.
+QProcessEnvironment makeProcessEnvironment( const EnvVars & envVars );
+
+/// Environment for the engine, built in advance, so that the launch itself doesn't have to do it.
+/** It's rebuilt only when the variables it was made of differ from the last time. */
+class PreparedEnvironment {
+
+ public:
+
+	/// Returns the system environment with the global variables and then the preset variables applied on top.
+	const QProcessEnvironment & get( const EnvVars & globalEnvVars, const EnvVars & presetEnvVars );
+
+ private:
+
+	EnvVars _globalEnvVars;
+	EnvVars _presetEnvVars;
+	QProcessEnvironment _env;
+	bool _isPrepared = false;
+
+};
+
+/// Starts the process detached from this one, shows an error message if it fails.
+bool startDetached(
+	QWidget * parent, const QString & executable, const QStringVec & arguments, const QString & workingDir = {}, const EnvVars & envVars = {}
+);
+/// Same as above, but with the complete environment for the process already prepared.
+bool startDetached(
+	QWidget * parent, const QString & executable, const QStringVec & arguments, const QString & workingDir,
+	const QProcessEnvironment & env
+);
+
+
+#endif // LAUNCH_COMMAND_INCLUDED
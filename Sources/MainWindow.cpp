@@ -16,6 +16,8 @@
 #include "Dialogs/GameOptsDialog.hpp"
 #include "Dialogs/CompatOptsDialog.hpp"
 #include "Dialogs/ProcessOutputWindow.hpp"
+#include "Dialogs/MultiProcessOutputWindow.hpp"
+#include "Dialogs/DiagnosticsDialog.hpp"
 
 #include "OptionsSerializer.hpp"
 #include "Version.hpp"  // window title
@@ -29,34 +31,61 @@
 #include "Utils/FileSystemUtils.hpp"
 #include "Utils/OSUtils.hpp"
 #include "Utils/ExeReader.hpp"
+#include "Utils/FileIconCache.hpp"
+#include "Utils/MapDescReader.hpp"
 #include "Utils/WADReader.hpp"
+#include "Utils/WadContentIndex.hpp"
+#include "Utils/WadInfoCacheFile.hpp"
+#include "Utils/ThumbnailCache.hpp"
 #include "Utils/WidgetUtils.hpp"
 #include "Utils/MiscUtils.hpp"  // checkPath, highlightPathIfInvalid
 #include "Utils/ErrorHandling.hpp"
+#include "Utils/TimeStats.hpp"  // g_startupTimeline, LaunchTimeline, LoadPhaseMarker
+#include "Utils/Diagnostics.hpp"  // g_stats
 
 #include <QVector>
 #include <QList>
 #include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QString>
 #include <QStringList>
 #include <QStringBuilder>
 #include <QTextStream>
 #include <QFile>
 #include <QDir>
-#include <QFileIconProvider>
 #include <QMessageBox>
 #include <QTimer>
 #include <QProcess>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QSignalBlocker>
+#include <QApplication>
+#include <QPalette>
 
 #include <QVBoxLayout>
 #include <QPlainTextEdit>
 #include <QFontDatabase>
 
+#include <algorithm>  // lower_bound
+#include <iterator>  // size
+
 
 //======================================================================================================================
 
-static const char defaultOptionsFileName [] = "options.json";
 static const char defaultCacheFileName [] = "file_info_cache.json";
+static const char startupTimelineFileName [] = "startup_timeline.txt";
+static const char defaultWadCacheFileName [] = "wad_info_cache.bin";
+static const char iconCacheFileName [] = "file_icon_cache.bin";
+static const char listSnapshotFileName [] = "list_snapshot.json";
+static const char launchStatsFileName [] = "launch_stats.txt";
+static const char engineOutputDirName [] = "engine_output";
+static const char thumbnailCacheDirName [] = "thumbnails";
+static const char updateCheckFileName [] = "update_check.json";
+
+static constexpr int MaxLaunchStatsRecords = 100;
+static constexpr int MaxEngineOutputLogs = 20;
+static constexpr int LocalMultiplayerStartDelayMs = 1500;  // the host has to be ready to accept the clients
 
 #if IS_WINDOWS
 	static const QString scriptFileSuffix = "*.bat";
@@ -100,8 +129,7 @@ IWAD * MainWindow::getSelectedIWAD() const
 template< typename Functor >
 void MainWindow::forEachSelectedMapPack( const Functor & loopBody ) const
 {
-	// clicking on an item in QTreeView with QFileSystemModel selects all elements (columns) of a row,
-	// but we only care about the first one
+	// clicking on an item in QTreeView selects all elements (columns) of a row, but we only care about the first one
 	const auto selectedRows = wdg::getSelectedRows( ui->mapDirView );
 
 	// extract the file paths
@@ -124,24 +152,6 @@ QStringVec MainWindow::getSelectedMapPacks() const
 	return selectedMapPacks;
 }
 
-QStringList MainWindow::getUniqueMapNamesFromWADs( const QVector<QString> & selectedWADs ) const
-{
-	QMap< QString, int > uniqueMapNames;  // we cannot use QSet because that one is unordered and we need to retain order
-	for (const QString & selectedWAD : selectedWADs)
-	{
-		if (!fs::isValidFile( selectedWAD ))
-			continue;
-
-		const doom::UncertainWadInfo & wadInfo = doom::g_cachedWadInfo.getFileInfo( selectedWAD );
-		if (wadInfo.status != ReadStatus::Success)
-			continue;
-
-		for (const QString & mapName : wadInfo.mapNames)
-			uniqueMapNames.insert( mapName.toUpper(), 0 );  // the 0 doesn't matter
-	}
-	return uniqueMapNames.keys();
-}
-
 QString MainWindow::getConfigDir() const
 {
 	int currentEngineIdx = ui->engineCmbBox->currentIndex();
@@ -203,21 +213,6 @@ QString MainWindow::convertRebasedEngineDataPath( QString rebasedPath ) const
 	}
 }
 
-QString MainWindow::rebaseSaveFilePath( const QString & filePath, const PathRebaser & workingDirRebaser, const EngineInfo * engine )
-{
-	// the base dir for the save file parameter depends on the engine and its version
-	if (engine && engine->baseDirStyleForSaveFiles() == EngineTraits::SaveBaseDir::SaveDir)
-	{
-		QString saveDir = getSaveDir();
-		PathRebaser saveDirRebaser( pathConvertor.workingDir(), saveDir, PathStyle::Relative, workingDirRebaser.quotePaths() );
-		return saveDirRebaser.rebaseAndQuotePath( filePath );
-	}
-	else
-	{
-		return workingDirRebaser.rebaseAndQuotePath( filePath );
-	}
-};
-
 LaunchMode MainWindow::getLaunchModeFromUI() const
 {
 	if (ui->launchMode_map->isChecked())
@@ -232,90 +227,22 @@ LaunchMode MainWindow::getLaunchModeFromUI() const
 		return LaunchMode::Default;
 }
 
-// Iterates over all directories which the engine will need to access (either for reading or writing).
-// Required for supporting sandbox environments like Snap or Flatpak
-template< typename Functor >
-void MainWindow::forEachDirToBeAccessed( const Functor & loopBody ) const
+// This needs to be called everytime the user make a change that needs to be saved into the options file.
+void MainWindow::scheduleSavingOptions( bool storedOptionsModified )
 {
-	const EngineInfo * selectedEngine = getSelectedEngine();
-	if (!selectedEngine)
-	{
-		return;
-	}
-
-	// dir of config files
-	if (const ConfigFile * selectedConfig = getSelectedConfig())
-	{
-		loopBody( selectedEngine->configDir );  // cannot be empty otherwise config would not be selected
-	}
-
-	// dir of IWAD
-	if (const IWAD * selectedIWAD = getSelectedIWAD())
-	{
-		loopBody( fs::getDirOfFile( selectedIWAD->path ) );
-	}
-
-	// dir of map files
-	if (wdg::isSomethingSelected( ui->mapDirView ))
-	{
-		loopBody( mapSettings.dir );  // all map files will always be inside the configured map dir
-	}
+	// update the options file at the nearest file-saving cycle
+	optionsNeedUpdate = optionsNeedUpdate || storedOptionsModified;
 
-	// dirs of mod files
-	QDir modDir( modSettings.dir );
-	bool modDirUsed = false;
-	for (const Mod & mod : modModel)
+	// Almost all the changes are made to the selected preset, so instead of tracking which of them actually were,
+	// the selected preset is always serialized again. Changes to other presets must mark them explicitly.
+	if (storedOptionsModified)
 	{
-		if (!mod.checked)
-			continue;
-
-		if (fs::isInsideDir( mod.path, modDir ))  // aggregate all mods inside the configured mod dir under single dir path
-		{
-			if (!modDirUsed)  // use it only once
-			{
-				loopBody( modSettings.dir );
-				modDirUsed = true;
-			}
-		}
-		else  // but still add directories outside of the configured mod dir, because mod dir is only a hint
+		if (const Preset * selectedPreset = getSelectedPreset())
 		{
-			loopBody( fs::getDirOfFile( mod.path ) );
+			selectedPreset->markModified();
+			presetContentIndex.markStale( selectedPreset->getID() );
 		}
 	}
-
-	// dir of saves and demo files
-	LaunchMode launchMode = getLaunchModeFromUI();
-	if ((launchMode == LoadSave && !ui->saveFileCmbBox->currentText().isEmpty())
-	 || (launchMode == ReplayDemo && !ui->demoFileCmbBox_replay->currentText().isEmpty()))
-	{
-		loopBody( getSaveDir() );
-	}
-
-	// dir of screenshots
-	if (!ui->screenshotDirLine->text().isEmpty())
-	{
-		loopBody( ui->screenshotDirLine->text() );
-	}
-}
-
-// Gets (deduplicated) directories which the engine will need to access (either for reading or writing).
-QStringVec MainWindow::getDirsToBeAccessed() const
-{
-	QSet< QString > dirSet;  // de-duplicate the paths
-
-	forEachDirToBeAccessed( [&]( const QString & dir )
-	{
-		dirSet.insert( dir );
-	});
-
-	return QStringVec( dirSet.begin(), dirSet.end() );
-}
-
-// This needs to be called everytime the user make a change that needs to be saved into the options file.
-void MainWindow::scheduleSavingOptions( bool storedOptionsModified )
-{
-	// update the options file at the nearest file-saving cycle
-	optionsNeedUpdate = optionsNeedUpdate || storedOptionsModified;
 }
 
 LaunchOptions & MainWindow::activeLaunchOptions()
@@ -514,10 +441,10 @@ MainWindow::MainWindow()
 		/*makeDisplayString*/ []( const ConfigFile & config ) { return config.fileName; }
 	),
 	saveModel(
-		/*makeDisplayString*/ []( const SaveFile & save ) { return save.fileName; }
+		/*makeDisplayString*/ []( const SaveFile & save ) { return makeSaveDisplayString( save ); }
 	),
 	demoModel(
-		/*makeDisplayString*/ []( const DemoFile & demo ) { return demo.fileName; }
+		/*makeDisplayString*/ []( const DemoFile & demo ) { return makeDemoDisplayString( demo ); }
 	),
 	iwadModel(
 		/*makeDisplayString*/ []( const IWAD & iwad ) { return iwad.name; }
@@ -532,6 +459,7 @@ MainWindow::MainWindow()
 {
 	ui = new Ui::MainWindow;
 	ui->setupUi( this );
+	g_startupTimeline.addTimePoint( "UI setup" );
 
 	this->setWindowTitle( windowTitle() + ' ' + appVersion );
 
@@ -549,12 +477,18 @@ MainWindow::MainWindow()
 	connect( ui->optionsStorageAction, &QAction::triggered, this, &thisClass::runOptsStorageDialog );
 	connect( ui->exportPresetToScriptAction, &QAction::triggered, this, &thisClass::exportPresetToScript );
 	connect( ui->exportPresetToShortcutAction, &QAction::triggered, this, &thisClass::exportPresetToShortcut );
+	connect( ui->exportAllPresetsToScriptsAction, &QAction::triggered, this, &thisClass::exportAllPresetsToScripts );
+	connect( ui->exportAllPresetsToShortcutsAction, &QAction::triggered, this, &thisClass::exportAllPresetsToShortcuts );
 	//connect( ui->importPresetAction, &QAction::triggered, this, &thisClass::importPreset );
+	connect( ui->launchLocalMultiplayerAction, &QAction::triggered, this, &thisClass::launchLocalMultiplayer );
+	connect( ui->launchStatsAction, &QAction::triggered, this, &thisClass::showLaunchStats );
+	connect( ui->diagnosticsAction, &QAction::triggered, this, &thisClass::showDiagnostics );
 	connect( ui->aboutAction, &QAction::triggered, this, &thisClass::runAboutDialog );
 	connect( ui->exitAction, &QAction::triggered, this, &thisClass::close );
 
  #if !IS_WINDOWS  // Windows-only feature
 	ui->exportPresetToShortcutAction->setEnabled( false );
+	ui->exportAllPresetsToShortcutsAction->setEnabled( false );
  #endif
 
 	// setup main list views
@@ -577,13 +511,33 @@ MainWindow::MainWindow()
 	connect( ui->configCmbBox, QOverload<int>::of( &QComboBox::currentIndexChanged ), this, &thisClass::onConfigSelected );
 	connect( ui->configCloneBtn, &QToolButton::clicked, this, &thisClass::cloneConfig );
 
+	// these are re-read from directories, the selection is then restored by IDs
+	saveModel.toggleIDIndex( true );
+	demoModel.toggleIDIndex( true );
+	// the display strings are composed from the info read from the files, the combo-boxes ask for them often
+	saveModel.toggleDisplayCache( true );
+	demoModel.toggleDisplayCache( true );
+
 	ui->saveFileCmbBox->setModel( &saveModel );
 	connect( ui->saveFileCmbBox, QOverload<int>::of( &QComboBox::currentIndexChanged ), this, &thisClass::onSavedGameSelected );
 
 	ui->demoFileCmbBox_replay->setModel( &demoModel );
 	connect( ui->demoFileCmbBox_replay, QOverload<int>::of( &QComboBox::currentIndexChanged ), this, &thisClass::onDemoFileSelected_replay );
 
+	// both map combo-boxes display the same names, so they share one model that is updated only by the names that changed
+	ui->mapCmbBox->setModel( &mapNamesModel );
+	ui->mapCmbBox_demo->setModel( &mapNamesModel );
+	// the text typed into the editable combo-box must not end up in the shared list
+	ui->mapCmbBox->setInsertPolicy( QComboBox::NoInsert );
+	ui->mapCmbBox_demo->setInsertPolicy( QComboBox::NoInsert );
+
 	connect( ui->mapCmbBox, &QComboBox::currentTextChanged, this, &thisClass::onMapChanged );
+
+	// the directories are listed only when they respond, and listed again as soon as they start responding
+	dirProber.setStateChangedCallback( this, [ this ]( const QString & dir, DirProber::State newState )
+	{
+		onDirStateChanged( dir, newState );
+	});
 	connect( ui->mapCmbBox_demo, &QComboBox::currentTextChanged, this, &thisClass::onMapChanged_demo );
 
 	connect( ui->demoFileLine_record, &QLineEdit::textChanged, this, &thisClass::onDemoFileChanged_record );
@@ -630,7 +584,7 @@ MainWindow::MainWindow()
 	connect( ui->screenshotDirBtn, &QPushButton::clicked, this, &thisClass::browseScreenshotDir );
 
 	// video
-	loadMonitorInfo( ui->monitorCmbBox );
+	// the monitor list is filled in onWindowShown(), while the worker threads are busy with the files
 	connect( ui->monitorCmbBox, QOverload<int>::of( &QComboBox::currentIndexChanged ), this, &thisClass::onMonitorSelected );
 	connect( ui->resolutionXLine, &QLineEdit::textChanged, this, &thisClass::onResolutionXChanged );
 	connect( ui->resolutionYLine, &QLineEdit::textChanged, this, &thisClass::onResolutionYChanged );
@@ -646,11 +600,15 @@ MainWindow::MainWindow()
 	connect( ui->presetCmdArgsLine, &QLineEdit::textChanged, this, &thisClass::onPresetCmdArgsChanged );
 	connect( ui->globalCmdArgsLine, &QLineEdit::textChanged, this, &thisClass::onGlobalCmdArgsChanged );
 	connect( ui->launchBtn, &QPushButton::clicked, this, &thisClass::launch );
+	ui->launchBtn->installEventFilter( &launchBtnHoverFilter );
+	connect( &launchBtnHoverFilter, &HoverFilter::hovered, this, &thisClass::prewarmSelectedFiles );
 
 	// this will call the function when the window is fully initialized and displayed
 	// not sure, which one of these 2 options is better
 	//QMetaObject::invokeMethod( this, &thisClass::onWindowShown, Qt::ConnectionType::QueuedConnection ); // this doesn't work in Qt 5.9
 	QTimer::singleShot( 0, this, &thisClass::onWindowShown );
+
+	g_startupTimeline.addTimePoint( "widget setup" );
 }
 
 void MainWindow::adjustUi()
@@ -669,6 +627,8 @@ void MainWindow::setupPresetList()
 {
 	// connect the view with model
 	ui->presetListView->setModel( &presetModel );
+	presetModel.toggleIDIndex( true );  // the selection is restored by ID after every search
+	ui->presetListView->toggleLargeListMode( true );  // some users have thousands of presets
 
 	// set selection rules
 	ui->presetListView->setSelectionMode( QAbstractItemView::SingleSelection );
@@ -707,7 +667,7 @@ void MainWindow::setupPresetList()
 	connect( ui->presetBtnDown, &QToolButton::clicked, this, &thisClass::presetMoveDown );
 
 	// setup search
-	presetSearchPanel = new SearchPanel( ui->searchShowBtn, ui->searchLine, ui->caseSensitiveChkBox, ui->regexChkBox );
+	presetSearchPanel = new SearchPanel( ui->searchShowBtn, ui->searchLine, ui->caseSensitiveChkBox, ui->regexChkBox, ui->contentChkBox );
 	ui->presetListView->enableFinding();
 	connect( ui->presetListView->findItemAction, &QAction::triggered, presetSearchPanel, &SearchPanel::expand );
 	connect( presetSearchPanel, &SearchPanel::searchParamsChanged, this, &thisClass::searchPresets );
@@ -717,6 +677,7 @@ void MainWindow::setupIWADList()
 {
 	// connect the view with model
 	ui->iwadListView->setModel( &iwadModel );
+	iwadModel.toggleIDIndex( true );  // the list is re-read from a directory and the selection restored by ID
 
 	// set selection rules
 	ui->iwadListView->setSelectionMode( QAbstractItemView::SingleSelection );
@@ -734,29 +695,25 @@ void MainWindow::setupMapPackList()
 	ui->mapDirView->setSelectionMode( QAbstractItemView::ExtendedSelection );
 
 	// set item filters
-	mapModel.setFilter( QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks );
-	mapModel.setNameFilters( doom::getModFileSuffixes() );
-	mapModel.setNameFilterDisables( false );
+	mapModel.setFileSuffixes( doom::allMapPackSuffixes );
+
+	// give the model our path convertor, it needs it for recognizing the paths stored in the presets
+	mapModel.setPathContext( &pathConvertor );
 
 	// remove the column names at the top
 	ui->mapDirView->setHeaderHidden( true );
 
-	// remove all other columns except the first one with name
+	// remove all other columns except the first one with name, the WAD info is shown in its tooltip instead
 	for (int i = 1; i < mapModel.columnCount(); ++i)
 		ui->mapDirView->hideColumn(i);
 
+	// show the title pictures of the map packs, they're decoded in the background only for the rows that are visible
+	mapModel.toggleThumbnails( true );
+	ui->mapDirView->setIconSize( ThumbnailCache::thumbnailSize() );
+
 	// make the view display a horizontal scrollbar rather than clipping the items
 	ui->mapDirView->toggleAutomaticColumnResizing( true );
 
-	// remove icons
-	class EmptyIconProvider : public QFileIconProvider
-	{
-	 public:
-		virtual QIcon icon( IconType ) const override { return QIcon(); }
-		virtual QIcon icon( const QFileInfo & ) const override { return QIcon(); }
-	};
-	mapModel.setIconProvider( new EmptyIconProvider );
-
 	// set drag&drop behaviour
 	ui->mapDirView->setDragEnabled( true );
 	ui->mapDirView->setDragDropMode( QAbstractItemView::DragOnly );
@@ -765,16 +722,15 @@ void MainWindow::setupMapPackList()
 	connect( ui->mapDirView->selectionModel(), &QItemSelectionModel::selectionChanged, this, &thisClass::onMapPackToggled );
 	connect( ui->mapDirView, &QTreeView::doubleClicked, this, &thisClass::showMapPackDesc );
 
-	// QFileSystemModel updates its content asynchronously in a separate thread. For this reason,
-	// when the model is set to display a certain directory, we cannot select items from the view right away,
-	// but must wait until the list is populated.
-	connect( &mapModel, &QFileSystemModel::directoryLoaded, this, &thisClass::onMapDirUpdated );
+	// The directories are loaded in the background, so the items can't be selected until their directories are loaded.
+	// restoreSelectedMapPacks() takes care of that, and the model reads the WAD info of the loaded map packs by itself.
 }
 
 void MainWindow::setupModList()
 {
 	// connect the view with model
 	ui->modListView->setModel( &modModel );
+	ui->modListView->toggleLargeListMode( true );
 
 	// set selection rules
 	ui->modListView->setSelectionMode( QAbstractItemView::ExtendedSelection );
@@ -823,6 +779,36 @@ void MainWindow::setupModList()
 	ui->modListView->enableTogglingIcons();  // allow the icons to be toggled via context-menu
 	ui->modListView->toggleIcons( true );  // we need to do this instead of modModel.toggleIcons() in order to update the action text
 	connect( ui->modListView->toggleIconsAction, &QAction::triggered, this, &thisClass::modToggleIcons );
+
+	// the icons that were not known yet are resolved in the background, then only the affected rows are repainted
+	g_fileIconCache.setResolvedCallback( this, [ this ]( const QStringList & paths )
+	{
+		onModIconsResolved( paths );
+	});
+}
+
+void MainWindow::onModIconsResolved( const QStringList & paths )
+{
+	if (!modModel.areIconsEnabled() || modModel.isEmpty())
+		return;
+
+	const QSet< QString > resolvedPaths( paths.begin(), paths.end() );
+
+	// coalesce the affected rows into a single range, the mod list is short and the repaint is cheap
+	int firstRow = -1, lastRow = -1;
+	for (int row = 0; row < modModel.size(); ++row)
+	{
+		const Mod & mod = modModel[ row ];
+		if (!mod.isSeparator && !mod.isCmdArg && resolvedPaths.contains( mod.path ))
+		{
+			if (firstRow < 0)
+				firstRow = row;
+			lastRow = row;
+		}
+	}
+
+	if (firstRow >= 0)
+		modModel.iconsChanged( firstRow, lastRow + 1 );
 }
 
 void MainWindow::setupEnvVarLists()
@@ -840,7 +826,7 @@ void MainWindow::setupEnvVarLists()
 
 void MainWindow::loadMonitorInfo( QComboBox * box )
 {
-	const auto monitors = os::listMonitors();
+	const auto & monitors = os::getMonitors();
 	for (const os::MonitorInfo & monitor : monitors)
 	{
 		QString monitorDescription;
@@ -851,8 +837,65 @@ void MainWindow::loadMonitorInfo( QComboBox * box )
 			descStream << " (primary)";
 
 		descStream.flush();
-		box->addItem( std::move(monitorDescription) );
+		box->addItem( std::move(monitorDescription), QVariant::fromValue( monitor ) );
+	}
+}
+
+/// Finds the monitor in the new list that is most likely the same physical monitor, returns -1 if there is none.
+static int findSameMonitor( const QVector< os::MonitorInfo > & monitors, const os::MonitorInfo & oldMonitor )
+{
+	// The name is just the connector (HDMI-1, \\.\DISPLAY1, ...), another monitor can be plugged into it,
+	// so it's trusted only together with the serial number, or with the geometry if there is no serial number.
+	if (!oldMonitor.serialNumber.isEmpty())
+	{
+		return findSuch( monitors, [&]( const os::MonitorInfo & monitor )
+		{
+			return monitor.serialNumber == oldMonitor.serialNumber;
+		});
+	}
+	int idx = findSuch( monitors, [&]( const os::MonitorInfo & monitor )
+	{
+		return monitor.name == oldMonitor.name && monitor.x == oldMonitor.x && monitor.y == oldMonitor.y
+		    && monitor.width == oldMonitor.width && monitor.height == oldMonitor.height;
+	});
+	if (idx < 0)  // only the resolution of the monitor changed
+	{
+		idx = findSuch( monitors, [&]( const os::MonitorInfo & monitor )
+		{
+			return monitor.name == oldMonitor.name && monitor.x == oldMonitor.x && monitor.y == oldMonitor.y;
+		});
+	}
+	return idx;
+}
+
+/// Reloads the monitor list after the screen configuration changed, keeping the same monitor selected if it's still there.
+void MainWindow::updateMonitorInfo()
+{
+	QComboBox * box = ui->monitorCmbBox;
+	int selectedIdx = box->currentIndex();
+	std::optional< os::MonitorInfo > selectedMonitor;
+	if (selectedIdx > 0)  // the first item is a placeholder for leaving it default
+		selectedMonitor = box->itemData( selectedIdx ).value< os::MonitorInfo >();
+
+	// The stored option stays what the user has chosen, the screen change can be temporary (a docking station,
+	// a monitor turned off), and the option would otherwise be silently rewritten every time it happens.
+	// Only what is displayed and what goes into the command follow the current monitors.
+	QSignalBlocker blocker( box );
+
+	while (box->count() > 1)
+		box->removeItem( box->count() - 1 );
+	loadMonitorInfo( box );
+
+	int newIdx = 0;  // if the monitor was disconnected, fall back to the default one
+	if (selectedMonitor)
+	{
+		int monitorIdx = findSameMonitor( os::getMonitors(), *selectedMonitor );
+		if (monitorIdx >= 0)
+			newIdx = monitorIdx + 1;
 	}
+	box->setCurrentIndex( newIdx );
+
+	updateLaunchCommand();
 }
 
 // Backward compatibility: Older versions stored options file in config dir.
@@ -917,8 +960,6 @@ void MainWindow::onWindowShown()
 {
 	// Potentially expensive file-system operations are done here,
 	// just to make sure the application doesn't hang without even showing anything.
-	// We should probably do this asynchronously, but there has not been any reported problems with this,
-	// so it's probably fine.
 
 	// create a directory for application data, if it doesn't exist already
 	appDataDir.setPath( os::getThisAppDataDir() );
@@ -932,26 +973,148 @@ void MainWindow::onWindowShown()
 
 	optionsFilePath = appDataDir.filePath( defaultOptionsFileName );
 	cacheFilePath = appDataDir.filePath( defaultCacheFileName );
+	wadCacheFilePath = appDataDir.filePath( defaultWadCacheFileName );
+	sharedCacheDir = os::getSharedThisAppDataDir();
+	iconCacheFilePath = appDataDir.filePath( iconCacheFileName );
+	listSnapshotFilePath = appDataDir.filePath( listSnapshotFileName );
+	launchStatsFilePath = appDataDir.filePath( launchStatsFileName );
+	g_thumbnailCache.setCacheDir( appDataDir.filePath( thumbnailCacheDirName ) );
+	UpdateChecker::setStateFilePath( appDataDir.filePath( updateCheckFileName ), fileWriter );
+
+	g_startupTimeline.addTimePoint( "first paint" );
+
+	// Reading and parsing of the files are independent of each other, so they run in parallel in worker threads.
+	// Only the results are then applied in the main thread, because that involves the UI and potential error messages.
+	// The user must not change anything until the options are loaded, they would be overwritten.
+	startupInProgress = true;
+	setEnabled( false );
+
+	startupFiles.cacheExists = fs::isValidFile( cacheFilePath );
+	startupFiles.wadCacheExists = fs::isValidFile( wadCacheFilePath );
+	startupFiles.iconCacheExists = fs::isValidFile( iconCacheFilePath );
+	startupFiles.optionsExist = fs::isValidFile( optionsFilePath );
+	startupFiles.listSnapshotExists = fs::isValidFile( listSnapshotFilePath );
+
+	if (startupFiles.cacheExists)
+	{
+		startupTasks.addTask( [ this ]()
+		{
+			ScopeTimer timer( "parsing file-info cache" );
+			startupFiles.cacheError = parseJsonFile( cacheFilePath, "file-info cache", IgnoreEmpty, startupFiles.cacheDoc );
+		});
+	}
+	if (startupFiles.wadCacheExists)
+	{
+		// the WAD info cache is thread-safe and its loading doesn't report anything to the user, so it can be done entirely here
+		startupTasks.addTask( [ this ]()
+		{
+			ScopeTimer timer( "loading WAD info cache" );
+			startupFiles.wadCacheError = doom::loadWadInfoCache( wadCacheFilePath );
+		});
+	}
+	if (startupFiles.iconCacheExists)
+	{
+		// the pixmaps can only be decoded in the main thread, so only the reading is done here
+		startupTasks.addTask( [ this ]()
+		{
+			startupFiles.iconCacheError = fs::readWholeFile( iconCacheFilePath, startupFiles.iconCacheData );
+		});
+	}
+	if (startupFiles.optionsExist)
+	{
+		startupTasks.addTask( [ this ]()
+		{
+			startupFiles.options = parseOptionsFile( optionsFilePath );
+		});
+	}
+	if (startupFiles.listSnapshotExists)
+	{
+		startupTasks.addTask( [ this ]()
+		{
+			startupFiles.listSnapshotError = parseJsonFile( listSnapshotFilePath, "list snapshot", IgnoreEmpty, startupFiles.listSnapshotDoc );
+		});
+	}
 
-	// cache needs to be loaded first, because loadOptions() already needs it
-	if (fs::isValidFile( cacheFilePath ))
+	// meanwhile do the things that can only be done in the main thread
 	{
-		loadCache( cacheFilePath );
+		QSignalBlocker blocker( ui->monitorCmbBox );  // there are no options to store the selection to yet
+		loadMonitorInfo( ui->monitorCmbBox );
 	}
+	os::watchMonitorChanges( this, [ this ]() { updateMonitorInfo(); } );
+	g_startupTimeline.addTimePoint( "loadMonitorInfo" );
+
+	startupTasks.whenAllDone( this, [ this ]()
+	{
+		onStartupFilesLoaded();
+	});
+}
+
+void MainWindow::onStartupFilesLoaded()
+{
+	g_startupTimeline.addTimePoint( "parallel loading of files" );
+
+	// the main thread is busy until the options are restored, but the message boxes shown meanwhile must be usable
+	setEnabled( true );
+
+	// cache needs to be loaded first, because loadOptions() already needs it
+	loadCache();
+	doom::g_wadContentIndex.rebuildInBackground();  // so that the first content query doesn't have to wait for it
+	g_startupTimeline.addTimePoint( "loadCache" );
+
+	// the lists are then populated with their last known content, instead of waiting for the directories to be read
+	loadListSnapshot();
 
 	// try to load last saved state
-	if (fs::isValidFile( optionsFilePath ))
+	if (startupFiles.optionsExist)
 	{
-		loadOptions( optionsFilePath );
+		loadOptions( startupFiles.options );
 	}
 	else  // this is a first run, perform an initial setup
 	{
 		runSetupDialog();
 	}
 
+	// The caches have been loaded before the options, so the limit is applied only now. A library bigger than the default
+	// would otherwise have its entries evicted and read again in every session.
+	os::g_cachedExeInfo.setMaxEntries( settings.maxCachedFiles );
+	doom::g_cachedWadHeaders.setMaxEntries( settings.maxCachedFiles );
+	doom::g_cachedWadInfo.setMaxEntries( settings.maxCachedFiles );
+	doom::g_cachedSaveInfo.setMaxEntries( settings.maxCachedFiles );
+	doom::g_cachedDemoInfo.setMaxEntries( settings.maxCachedFiles );
+
+	// the WADs the other installations have already read don't have to be read again by this one
+	if (settings.shareFileCache)
+	{
+		syncSharedWadInfoCache();
+	}
+
+	startupFiles = {};  // the parsed documents are no longer needed
+	listSnapshot.clear();  // from now on the lists will be populated only from the directories
+	startupInProgress = false;
+
+	// the request goes over the network, start it before the rest of the UI is set up
+	if (settings.checkForUpdates)
+	{
+		updateChecker.checkForUpdates_async(
+			/* result callback */[ this ]( UpdateChecker::Result result, QString /*errorDetail*/, QStringVec versionInfo )
+			{
+				if (result == UpdateChecker::UpdateAvailable)
+				{
+					settings.checkForUpdates = showUpdateNotification( this, versionInfo, /*checkbox*/true );
+				}
+				// silently ignore the rest of the results, since nobody asked for anything
+			}
+		);
+	}
+
+	// The directories are scanned in the background and populate the lists when they're done,
+	// so don't wait for the first scheduled update with it. This also reconciles the lists restored from the snapshot.
+	updateListsFromDirs( /*pollingTick*/true );
+
 	// This must be called after the options are loaded, because options might change application style,
 	// and that might change widget sizes.
 	adjustUi();
+	g_startupTimeline.addTimePoint( "adjustUi" );
 
 	// integrate the loaded storage settings into the titles of options group-boxes
 	updateOptionsGrpBoxTitles( settings );
@@ -977,29 +1140,20 @@ void MainWindow::onWindowShown()
 		autoselectItems();
 	}
 
-	if (settings.checkForUpdates)
-	{
-		updateChecker.checkForUpdates_async(
-			/* result callback */[ this ]( UpdateChecker::Result result, QString /*errorDetail*/, QStringVec versionInfo )
-			{
-				if (result == UpdateChecker::UpdateAvailable)
-				{
-					settings.checkForUpdates = showUpdateNotification( this, versionInfo, /*checkbox*/true );
-				}
-				// silently ignore the rest of the results, since nobody asked for anything
-			}
-		);
-	}
+	// the options file may be managed by someone else, their changes must not be overwritten by the next save
+	watchOptionsFile();
+
+	// the periodic saves and updates
+	scheduleBackgroundJobs();
 
-	// setup an update timer
-	startTimer( 1000 );
+	g_startupTimeline.addTimePoint( "rest of startup" );
+	g_startupTimeline.finish( appDataDir.filePath( startupTimelineFileName ) );
 }
 
-void MainWindow::timerEvent( QTimerEvent * event )  // called once per second
+void MainWindow::scheduleBackgroundJobs()
 {
-	superClass::timerEvent( event );
-
-	tickCount++;
+	using Priority = IdleScheduler::Priority;
+	using RunIn = IdleScheduler::RunIn;
 
  #if IS_DEBUG_BUILD
 	constexpr uint dirUpdateDelay = 8;
@@ -1007,12 +1161,17 @@ void MainWindow::timerEvent( QTimerEvent * event )  // called once per second
 	constexpr uint dirUpdateDelay = 2;
  #endif
 
-	if (tickCount % dirUpdateDelay == 0)
-	{
-		updateListsFromDirs();
-	}
+	// When the directories are watched, this only re-scans those that have actually changed since the last update.
+	// The traversal itself runs in the background, only the differences are applied to the lists here.
+	idleScheduler.addPeriodicJob( "directory update", 1000, 2000, Priority::High, RunIn::MainThread,
+		[ this, updateCount = uint(0) ]() mutable
+		{
+			updateListsFromDirs( /*pollingTick*/ ++updateCount % dirUpdateDelay == 0 );
+		}
+	);
 
-	if (tickCount % 10 == 0)
+	// The content is serialized here, because it's read from the UI models, but written by the background file writer.
+	idleScheduler.addPeriodicJob( "options save", 10000, 10000, Priority::Normal, RunIn::MainThread, [ this ]()
 	{
 		if (optionsNeedUpdate   // don't do unnecessary file writes when nothing has changed
 		 && !optionsCorrupted)  // don't overwrite existing file with empty data, just because there was a syntax error
@@ -1020,21 +1179,59 @@ void MainWindow::timerEvent( QTimerEvent * event )  // called once per second
 			saveOptions( optionsFilePath );
 			optionsNeedUpdate = false;
 		}
-
+	});
+	idleScheduler.addPeriodicJob( "cache save", 10000, 10000, Priority::Normal, RunIn::MainThread, [ this ]()
+	{
 		if (isCacheDirty())
 		{
 			saveCache( cacheFilePath );
 		}
-	}
+	});
+
+	// release the paths of the deleted presets and of the files that disappeared from the lists,
+	// the pool is thread-safe and a string that is only in the pool cannot be taken from it without its lock
+	idleScheduler.addPeriodicJob( "path pool pruning", 60000, 60000, Priority::Low, RunIn::WorkerThread, []()
+	{
+		g_pathPool.prune();
+	});
+
+	idleScheduler.start();
 }
 
 void MainWindow::closeEvent( QCloseEvent * event )
 {
-	if (!optionsCorrupted)  // don't overwrite existing file with empty data, when there was just one small syntax error
-		saveOptions( optionsFilePath );
+	idleScheduler.stop();  // the final saves are done below
+	dirTraverser.cancelAll();  // the results would only be thrown away
+	wadPrefetcher.cancelAll();
+	filePrewarmer.cancelAll();
+	g_thumbnailCache.shutdown();  // the pixmaps must be gone before the QApplication, the static destructor is too late
+	// the same for the workers of the file caches, they post their results to the QApplication
+	os::g_cachedExeInfo.shutdown();
+	doom::g_cachedWadHeaders.shutdown();
+	doom::g_cachedWadInfo.shutdown();
+	doom::g_cachedLumpNames.shutdown();
+	doom::g_cachedMapPackDescs.shutdown();
+	doom::g_cachedSaveInfo.shutdown();
+	doom::g_cachedDemoInfo.shutdown();
+
+	if (startupInProgress)  // closed before the files were loaded, there is nothing to save yet
+	{
+		startupTasks.waitForDone();  // the tasks write into this object
+	}
+	else
+	{
+		if (!optionsCorrupted)  // don't overwrite existing file with empty data, when there was just one small syntax error
+			saveOptions( optionsFilePath );
+
+		if (isCacheDirty())
+			saveCache( cacheFilePath );
 
-	if (isCacheDirty())
-		saveCache( cacheFilePath );
+		saveListSnapshot( listSnapshotFilePath );
+	}
+
+	sharedCacheTask.waitForDone();  // it only waits for the lock for a moment
+
+	fileWriter.flush();  // the application may exit right after the window is closed
 
  #if IS_WINDOWS
 	themeWatcher.terminate();
@@ -1062,6 +1259,47 @@ void MainWindow::runAboutDialog()
 	settings.checkForUpdates = dialog.checkForUpdates;
 }
 
+void MainWindow::showLaunchStats()
+{
+	loadLaunchStats();
+
+	if (launchStats.isEmpty())
+	{
+		reportInformation( this, "Launch statistics", "Nothing has been launched yet." );
+		return;
+	}
+
+	QString records = launchStats.mid( std::max( launchStats.size() - 20, 0 ) ).join('\n');
+
+	QMessageBox messageBox( QMessageBox::Information, "Launch statistics",
+		"How long the last launches took from clicking the Launch button until the engine printed its first output. "
+		"The launcher time is spent preparing the command, the engine time is spent loading the engine process. "
+		"The first output is known only when the engine output is shown.",
+		QMessageBox::Ok,
+		this
+	);
+	messageBox.setDetailedText( records );
+	messageBox.exec();
+}
+
+void MainWindow::showDiagnostics()
+{
+	// non-modal, so that the numbers can be watched while using the main window
+	if (diagnosticsDialog)
+	{
+		diagnosticsDialog->raise();
+		diagnosticsDialog->activateWindow();
+		return;
+	}
+
+	diagnosticsDialog = new DiagnosticsDialog( this, {
+		{ "file lists", &dirTraverser },
+		{ "map pack tree", &mapModel.dirTraverser() },
+	});
+	diagnosticsDialog->setAttribute( Qt::WA_DeleteOnClose );
+	diagnosticsDialog->show();
+}
+
 void MainWindow::runSetupDialog()
 {
 	// The dialog gets a copy of all the required data and when it's confirmed, we copy them back.
@@ -1092,6 +1330,9 @@ void MainWindow::runSetupDialog()
 		auto currentIWAD = wdg::getCurrentItemID( ui->iwadListView, iwadModel );
 		auto selectedIWAD = wdg::getSelectedItemID( ui->iwadListView, iwadModel );
 
+		// the lists being updated in the background might be based on the old directories
+		dirTraverser.cancelAll();
+
 		// prevent unnecessary updates when an engine or IWAD is deselected and then the same one selected again.
 		disableSelectionCallbacks = true;
 
@@ -1109,10 +1350,18 @@ void MainWindow::runSetupDialog()
 		//fillDerivedEngineInfo( engineModel );  // fill the derived fields of EngineInfo
 		iwadSettings = std::move( dialog.iwadSettings );
 		iwadModel.assignList( std::move( dialog.iwadModel.list() ) );
+		optionsWriteCache.invalidateFileLists();
+		// the lazily loaded presets must be deserialized according to the map directories they were saved with
+		if (dialog.mapSettings.getDirs() != mapSettings.getDirs())
+			loadAllPresets();
 		mapSettings = std::move( dialog.mapSettings );
 		modSettings = std::move( dialog.modSettings );
+		bool shareFileCacheEnabled = settings.shareFileCache != dialog.settings.shareFileCache && dialog.settings.shareFileCache;
 		settings = std::move( dialog.settings );
 
+		if (shareFileCacheEnabled)
+			syncSharedWadInfoCache();
+
 		// update all stored paths
 		togglePathStyle( settings.pathStyle );
 		currentEngine = pathConvertor.convertPath( currentEngine );
@@ -1154,6 +1403,8 @@ void MainWindow::runOptsStorageDialog()
 	// update the data only if user clicked Ok
 	if (code == QDialog::Accepted)
 	{
+		// the lazily loaded presets must be deserialized according to the storage settings they were saved with
+		loadAllPresets();
 		settings.assign( dialog.storageSettings );
 		scheduleSavingOptions();
 		updateOptionsGrpBoxTitles( settings );
@@ -1277,7 +1528,7 @@ void MainWindow::autoselectItems()
 		else
 		{
 			// select engine marked as default
-			int defaultIdx = findSuch( engineModel, [&]( const Engine & e ){ return e.getID() == engineSettings.defaultEngine; } );
+			int defaultIdx = engineModel.findIndexByID( engineSettings.defaultEngine );
 			if (defaultIdx >= 0)
 				ui->engineCmbBox->setCurrentIndex( defaultIdx );
 		}
@@ -1292,7 +1543,7 @@ void MainWindow::autoselectItems()
 		else
 		{
 			// select IWAD marked as default
-			int defaultIdx = findSuch( iwadModel, [&]( const IWAD & i ){ return i.getID() == iwadSettings.defaultIWAD; } );
+			int defaultIdx = iwadModel.findIndexByID( iwadSettings.defaultIWAD );
 			if (defaultIdx >= 0)
 				wdg::selectAndSetCurrentByIndex( ui->iwadListView, defaultIdx );
 		}
@@ -1353,9 +1604,13 @@ void MainWindow::onEngineSelected( int index )
 	if (disableSelectionCallbacks)
 		return;
 
-	const EngineInfo * selectedEngine = index >= 0 ? &engineModel[ index ] : nullptr;
+	EngineInfo * selectedEngine = index >= 0 ? &engineModel[ index ] : nullptr;
 	const QString & enginePath = selectedEngine ? selectedEngine->executablePath : emptyString;
 
+	// the widgets updated below and the launch command depend on the engine version
+	if (selectedEngine)
+		completeEngineVersionInfo( *selectedEngine );
+
 	bool storageModified = STORE_TO_CURRENT_PRESET_IF_SAFE( selectedEnginePath, enginePath );
 
 	// engine's data dir has changed -> from now on rebase engine data paths to the new dir, if empty it will rebase to "."
@@ -1377,10 +1632,7 @@ void MainWindow::onEngineSelected( int index )
 	// update related UI elements
 	ui->engineDirBtn->setEnabled( selectedEngine != nullptr );
 
-	updateConfigFilesFromDir();
-	updateSaveFilesFromDir();
-	updateDemoFilesFromDir();
-	updateCompatLevels();
+	requestUpdates( ConfigListUpdate | SaveListUpdate | DemoListUpdate | CompatLevelsUpdate );
 
 	scheduleSavingOptions( storageModified );
 	updateLaunchCommand();
@@ -1418,7 +1670,7 @@ void MainWindow::onIWADToggled( const QItemSelection & /*selected*/, const QItem
 
 	bool storageModified = STORE_TO_CURRENT_PRESET_IF_SAFE( selectedIWAD, iwadPath );
 
-	updateMapsFromSelectedWADs();
+	requestUpdates( MapListUpdate );
 
 	scheduleSavingOptions( storageModified );
 	updateLaunchCommand();
@@ -1438,7 +1690,15 @@ void MainWindow::onMapPackToggled( const QItemSelection & /*selected*/, const QI
 	for (const QModelIndex & index : selectedRows)
 		wdg::expandParentsOfNode( ui->mapDirView, index );
 
-	updateMapsFromSelectedWADs( &selectedMapPacks );
+	if (updateBatchDepth > 0)
+	{
+		deferredUpdates |= MapListUpdate | MapDescUpdate;  // the IWAD is probably being changed too
+	}
+	else
+	{
+		updateMapsFromSelectedWADs( &selectedMapPacks );
+		updateMapDescPreview();
+	}
 
 	// if this is a known map pack, that starts at different level than the first one, automatically select it
 	if (selectedMapPacks.size() >= 1 && !fs::isDirectory( selectedMapPacks[0] ))
@@ -1448,6 +1708,8 @@ void MainWindow::onMapPackToggled( const QItemSelection & /*selected*/, const QI
 		QString startingMap = doom::getStartingMap( wadFileName );
 		if (!startingMap.isEmpty())
 		{
+			runDeferredUpdates( MapListUpdate );  // the map needs to be in the list
+
 			if (ui->mapCmbBox->findText( startingMap ) >= 0)
 			{
 				ui->mapCmbBox->setCurrentText( startingMap );
@@ -1484,6 +1746,9 @@ void MainWindow::onPresetDataChanged( const QModelIndex & topLeft, const QModelI
 
 void MainWindow::onModDataChanged( const QModelIndex & topLeft, const QModelIndex & bottomRight, const QVector<int> & roles )
 {
+	if (ListModelCommon::isOnlyPresentation( roles ))  // only the icons have been resolved or the conflicts annotated, nothing to save
+		return;
+
 	int topModIdx = topLeft.row();
 	int bottomModIdx = bottomRight.row();
 
@@ -1522,41 +1787,74 @@ void MainWindow::onModDataChanged( const QModelIndex & topLeft, const QModelInde
 
 void MainWindow::showMapPackDesc( const QModelIndex & index )
 {
-	QFileInfo mapDataFileInfo( mapModel.filePath( index ) );
-
-	if (!mapDataFileInfo.isFile())  // user could click on a directory
+	QString mapPackPath = mapModel.filePath( index );
+	if (!index.isValid() || mapModel.isDir( index ))  // user could click on a directory
 	{
 		return;
 	}
 
-	// get the corresponding file with txt suffix
-	QFileInfo mapDescFileInfo(fs::replaceFileSuffix( mapDataFileInfo.filePath(), "txt" ));
-	if (!mapDescFileInfo.isFile())
+	// the description might be inside a big archive or on a slow drive, so it's read in the background
+	doom::g_cachedMapPackDescs.requestFileInfo( doom::getMapPackDescFile( mapPackPath ), this, [ this, mapPackPath ]( const doom::UncertainMapPackDesc & desc )
 	{
-		// try TXT in case we are in a case-sensitive file-system such as Linux
-		mapDescFileInfo = QFileInfo(fs::replaceFileSuffix( mapDataFileInfo.filePath(), "TXT" ));
-		if (!mapDescFileInfo.isFile())
+		if (desc.status == ReadStatus::Success)
+		{
+			openMapDescDialog( desc.sourceName, desc.text );
+		}
+		else if (desc.status == ReadStatus::InfoNotPresent || desc.status == ReadStatus::NotSupported)
 		{
 			reportUserError( this, "Cannot open map description",
-				"Map description file \""%mapDescFileInfo.fileName()%"\" does not exist" );
-			return;
+				"No description was found for \""%fs::getFileNameFromPath( mapPackPath )%"\". "
+				"Neither a text file next to it, nor a text file or a text lump inside it." );
 		}
-	}
+		else
+		{
+			reportRuntimeError( this, "Cannot open map description",
+				"Failed to read the description of \""%fs::getFileNameFromPath( mapPackPath )%"\"" );
+		}
+	});
+}
+
+void MainWindow::updateMapDescPreview()
+{
+	QString mapPackPath;
+	QModelIndex currentIdx = ui->mapDirView->selectionModel()->currentIndex();
+	if (currentIdx.isValid() && ui->mapDirView->selectionModel()->isSelected( currentIdx ) && !mapModel.isDir( currentIdx ))
+		mapPackPath = mapModel.filePath( currentIdx );
 
-	QFile mapDescFile( mapDescFileInfo.filePath() );
-	if (!mapDescFile.open( QIODevice::Text | QIODevice::ReadOnly ))
+	if (mapPackPath.isEmpty())
 	{
-		reportRuntimeError( this, "Cannot open map description",
-			"Failed to open map description file \""%mapDescFileInfo.fileName()%"\" ("%mapDescFile.errorString()%")" );
+		ui->mapDescPreview->clear();
+		ui->mapDescPreview->hide();
 		return;
 	}
 
-	QByteArray desc = mapDescFile.readAll();
+	doom::g_cachedMapPackDescs.requestFileInfo( doom::getMapPackDescFile( mapPackPath ), this, [ this, mapPackPath ]( const doom::UncertainMapPackDesc & desc )
+	{
+		// the selection could have changed while the description was being read
+		QModelIndex currentIdx = ui->mapDirView->selectionModel()->currentIndex();
+		if (!currentIdx.isValid() || mapModel.filePath( currentIdx ) != mapPackPath)
+			return;
 
-	QDialog descDialog( this );
-	descDialog.setObjectName( "MapDescription" );
-	descDialog.setWindowTitle( mapDescFileInfo.fileName() );
-	descDialog.setWindowModality( Qt::WindowModal );
+		if (desc.status == ReadStatus::Success && !desc.text.isEmpty())
+		{
+			ui->mapDescPreview->setPlainText( desc.text );
+			ui->mapDescPreview->setToolTip( desc.sourceName );
+			ui->mapDescPreview->show();
+		}
+		else
+		{
+			ui->mapDescPreview->clear();
+			ui->mapDescPreview->hide();
+		}
+	});
+}
+
+void MainWindow::openMapDescDialog( const QString & title, const QString & desc )
+{
+	QDialog descDialog( this );
+	descDialog.setObjectName( "MapDescription" );
+	descDialog.setWindowTitle( title );
+	descDialog.setWindowModality( Qt::WindowModal );
 
 	QVBoxLayout * layout = new QVBoxLayout( &descDialog );
 
@@ -1584,28 +1882,6 @@ void MainWindow::showMapPackDesc( const QModelIndex & index )
 	descDialog.exec();
 }
 
-void MainWindow::onMapDirUpdated( const QString & path )
-{
-	// the QFileSystemModel mapModel has finally updated its content from mapSettings.dir
-	if (path == pathConvertor.getAbsolutePath( mapSettings.dir ))
-	{
-		// idiotic workaround, because Qt never stops surprising me with its stupidity.
-		//
-		// The QFileSystemModel::directoryLoaded signal is supposed to indicate the mapModel is fully loaded,
-		// but still when we call mapModel.index( path ), it returns a zeroed-out model index with incorrect row number.
-		// This is a desperate attempt to call restoreSelectedMapPacks() when the mapModel.index( path ) finally starts
-		// returning valid indexes so that we can select the right items in the view.
-		QTimer::singleShot( 0, nullptr, [ this ]()
-		{
-			if (Preset * preset = getSelectedPreset())
-			{
-				// now we can finally select the right items in the map pack view
-				restoreSelectedMapPacks( *preset );
-			}
-		});
-	}
-}
-
 
 //----------------------------------------------------------------------------------------------------------------------
 //  preset list manipulation
@@ -1735,7 +2011,55 @@ void MainWindow::onPresetsReordered()
 	scheduleSavingOptions();
 }
 
-void MainWindow::searchPresets( const QString & phrase, bool caseSensitive, bool useRegex )
+/// Returns IDs of the presets that use a file containing a map of this name (MAP07), or a key lump of this name (DEHACKED).
+/** The content is known from the WAD info cache, no file needs to be opened. All the presets must be loaded. */
+QSet< QString > MainWindow::findPresetsWithFileContent( const QString & word )
+{
+	static const QHash< QString, doom::KeyLump > keyLumpsByName =
+	{
+		{ "MAPINFO",  doom::MapInfoLump },
+		{ "DEHACKED", doom::DehackedLump },
+		{ "TITLEPIC", doom::TitlePicLump },
+	};
+
+	if (word.isEmpty() || word.contains(' '))
+		return {};
+
+	QString upperWord = word.toUpper();
+	auto lumpIter = keyLumpsByName.find( upperWord );
+	const QStringVec files = lumpIter != keyLumpsByName.end()
+		? doom::g_wadContentIndex.findFilesWithLump( *lumpIter )
+		: doom::g_wadContentIndex.findFilesWithMap( upperWord );
+	if (files.isEmpty())
+		return {};
+
+	// the cache might have been queried with a different form of the path than the presets store
+	QSet< QString > absFilePaths;
+	for (const QString & filePath : files)
+		absFilePaths.insert( pathConvertor.getAbsolutePath( filePath ) );
+	auto containsFile = [&]( const QString & path )
+	{
+		return !path.isEmpty() && absFilePaths.contains( pathConvertor.getAbsolutePath( path ) );
+	};
+
+	QSet< QString > presetIDs;
+	for (const Preset & preset : presetModel.fullList())
+	{
+		if (preset.isSeparator)
+			continue;
+		bool usesFile = containsFile( preset.selectedIWAD )
+			|| std::any_of( preset.selectedMapPacks.begin(), preset.selectedMapPacks.end(), containsFile )
+			|| std::any_of( preset.mods.begin(), preset.mods.end(), [&]( const Mod & mod )
+			   {
+			       return mod.checked && containsFile( mod.path );
+			   });
+		if (usesFile)
+			presetIDs.insert( preset.getID() );
+	}
+	return presetIDs;
+}
+
+void MainWindow::searchPresets( const QString & phrase, bool caseSensitive, bool useRegex, bool searchContent )
 {
 	if (phrase.length() > 0)
 	{
@@ -1747,7 +2071,18 @@ void MainWindow::searchPresets( const QString & phrase, bool caseSensitive, bool
 
 		// filter the model data
 		presetModel.startCompleteUpdate();
-		presetModel.search( phrase, caseSensitive, useRegex );
+		if (searchContent)
+		{
+			loadAllPresets();  // the content of the presets that haven't been loaded yet is not known
+			presetContentIndex.update( presetModel.fullList() );
+			QSet< QString > foundIDs = presetContentIndex.findPresets( phrase );
+			foundIDs.unite( findPresetsWithFileContent( phrase.trimmed() ) );
+			presetModel.searchByIDs( foundIDs );
+		}
+		else
+		{
+			presetModel.search( phrase, caseSensitive, useRegex );
+		}
 		presetModel.finishCompleteUpdate();
 
 		// try to re-select the same preset as before
@@ -1812,21 +2147,21 @@ void MainWindow::modAdd()
 		for (QString & path : paths)
 			path = pathConvertor.getRelativePath( path );
 
-	Preset * selectedPreset = getSelectedPreset();
-
+	QList< Mod > mods;
+	mods.reserve( paths.size() );
 	for (const QString & path : paths)
-	{
-		Mod mod( QFileInfo( path ), true );
+		mods.append( Mod( QFileInfo( path ), true ) );
 
-		wdg::appendItem( ui->modListView, modModel, mod );
-
-		// add it also to the current preset
-		if (selectedPreset)
-		{
+	// add them also to the current preset
+	if (Preset * selectedPreset = getSelectedPreset())
+	{
+		selectedPreset->mods.reserve( selectedPreset->mods.size() + mods.size() );
+		for (const Mod & mod : mods)
 			selectedPreset->mods.append( mod );
-		}
 	}
 
+	wdg::appendItems( ui->modListView, modModel, std::move(mods) );
+
 	scheduleSavingOptions();
 	updateLaunchCommand();
 }
@@ -1980,26 +2315,31 @@ void MainWindow::modToggleIcons()
 	scheduleSavingOptions();
 }
 
+/// Compares the user data of the mods, not their highlighting.
+static bool isSameMod( const Mod & mod1, const Mod & mod2 )
+{
+	return isSameString( mod1.path, mod2.path ) && isSameString( mod1.fileName, mod2.fileName ) && mod1.checked == mod2.checked
+	    && mod1.isCmdArg == mod2.isCmdArg && mod1.isSeparator == mod2.isSeparator;
+}
+
 void MainWindow::onModsDropped( int dropRow, int count )
 {
 	// update the preset
 	if (Preset * selectedPreset = getSelectedPreset())
 	{
-		selectedPreset->mods = modModel.list();  // not the most optimal way, but the size of the list will be always small
+		// Presets can have hundreds of mods, so copy only the dropped part instead of the whole list,
+		// sharing the list would make the next edit of either of them copy it anyway.
+		replaceChangedRange( selectedPreset->mods, modModel.list(), isSameMod );
 	}
 
 	// if these files were dragged here from the map pack list, deselect them there
-	QDir mapRootDir = mapModel.rootDirectory();
 	for (int row = dropRow; row < dropRow + count; ++row)
 	{
 		const Mod & mod = modModel[ row ];
-		if (fs::isInsideDir( mod.path, mapRootDir ))
+		QModelIndex mapPackIdx = mapModel.index( mod.path );  // invalid if it's outside of the map directories
+		if (mapPackIdx.isValid())
 		{
-			QModelIndex mapPackIdx = mapModel.index( mod.path );
-			if (mapPackIdx.isValid())
-			{
-				wdg::deselectItemByIndex( ui->mapDirView, mapPackIdx );
-			}
+			wdg::deselectItemByIndex( ui->mapDirView, mapPackIdx );
 		}
 	}
 
@@ -2182,6 +2522,10 @@ void MainWindow::onDemoFileSelected_replay( int demoIdx )
 
 	/*bool storageModified =*/ STORE_LAUNCH_OPTION( demoFile_replay, demoFileName );
 
+	// the user would most likely have to find out by trial and error which IWAD the demo needs
+	if (demoIdx >= 0 && demoModel[ demoIdx ].info)
+		preselectOptionsForDemo( *demoModel[ demoIdx ].info );
+
 	//scheduleSavingOptions( storageModified );
 	updateLaunchCommand();
 }
@@ -2796,20 +3140,30 @@ void MainWindow::togglePathStyle( PathStyle style )
 	}
 
 	iwadSettings.dir = pathConvertor.convertPath( iwadSettings.dir );
+	for (QString & extraDir : iwadSettings.extraDirs)
+		extraDir = pathConvertor.convertPath( extraDir );
 	for (IWAD & iwad : iwadModel)
 	{
 		iwad.path = pathConvertor.convertPath( iwad.path );
 	}
+	optionsWriteCache.invalidateFileLists();
 
 	mapSettings.dir = pathConvertor.convertPath( mapSettings.dir );
-	mapModel.setRootPath( mapSettings.dir );
+	for (QString & extraDir : mapSettings.extraDirs)
+		extraDir = pathConvertor.convertPath( extraDir );
+	mapModel.setRootPaths( mapSettings.getDirs() );
 
 	modSettings.dir = pathConvertor.convertPath( modSettings.dir );
 	for (Mod & mod : modModel)
 	{
 		mod.path = pathConvertor.convertPath( mod.path );
 	}
+	engineModel.invalidateIDIndex();  // the IDs are the paths
+	iwadModel.invalidateIDIndex();
+	modModel.invalidateIDIndex();
 
+	if (styleChanged)
+		loadAllPresets();  // the paths of the presets that aren't loaded yet would otherwise stay in the old style
 	for (Preset & preset : presetModel)
 	{
 		preset.selectedEnginePath = pathConvertor.convertPath( preset.selectedEnginePath );
@@ -2822,7 +3176,9 @@ void MainWindow::togglePathStyle( PathStyle style )
 		{
 			mod.path = pathConvertor.convertPath( mod.path );
 		}
+		preset.markModified();
 	}
+	presetContentIndex.markAllStale();
 
 	ui->saveDirLine->setText( convertRebasedEngineDataPath( ui->saveDirLine->text() ) );
 	ui->screenshotDirLine->setText( convertRebasedEngineDataPath( ui->screenshotDirLine->text() ) );
@@ -2832,15 +3188,58 @@ void MainWindow::togglePathStyle( PathStyle style )
 
 void MainWindow::fillDerivedEngineInfo( DirectList< EngineInfo > & engines )
 {
+	// Reading the version info of all the executables one after another can take seconds, so only the info deducible
+	// from the path is filled in here, and the version info is read in parallel in worker threads.
+	// The engine that is selected before the info arrives is completed synchronously by completeEngineVersionInfo().
 	for (EngineInfo & engine : engines)
 	{
 		if (!engine.hasAppInfo())
-			engine.loadAppInfo( engine.executablePath );
+		{
+			engine.initSandboxInfo( engine.executablePath );
+			engine.initAppInfoFromPath( engine.executablePath );
+			if (fs::isValidFile( engine.executablePath ))
+			{
+				QString executablePath = engine.executablePath;
+				os::g_cachedExeInfo.requestFileInfo( executablePath, this,
+					[ this, executablePath ]( const os::UncertainExeVersionInfo & versionInfo )
+					{
+						onEngineVersionInfoLoaded( executablePath, versionInfo );
+					}
+				);
+			}
+			else
+			{
+				engine.setExeVersionInfo( {} );  // nothing to read
+			}
+		}
 		if (!engine.hasFamilyTraits())
 			engine.assignFamilyTraits( engine.family );
 	}
 }
 
+void MainWindow::onEngineVersionInfoLoaded( const QString & executablePath, const os::UncertainExeVersionInfo & versionInfo )
+{
+	// The engines might have been edited or reordered in the meantime, so find them again by the path.
+	// Those that have been completed synchronously in the meantime already have the same info.
+	for (EngineInfo & engine : engineModel)
+	{
+		if (engine.hasAppInfo() && !engine.hasExeVersionInfo() && engine.appInfoSrcExePath() == executablePath)
+		{
+			engine.setExeVersionInfo( versionInfo );
+		}
+	}
+}
+
+/// Makes sure the version info of this engine is complete, reading it right away if it hasn't arrived from the worker yet.
+void MainWindow::completeEngineVersionInfo( EngineInfo & engine )
+{
+	if (engine.hasAppInfo() && !engine.hasExeVersionInfo())
+	{
+		// if the worker is already reading it, the file is just read twice, the cache will hold the same info either way
+		engine.setExeVersionInfo( os::g_cachedExeInfo.getFileInfo( engine.appInfoSrcExePath() ) );
+	}
+}
+
 
 //----------------------------------------------------------------------------------------------------------------------
 //  automatic list updates according to directory content
@@ -2856,27 +3255,324 @@ void MainWindow::fillDerivedEngineInfo( DirectList< EngineInfo > & engines )
 // to be re-selected, so we have to manually notify the callbacks (which were disabled before) that the selection was
 // reset, so that everything updates correctly.
 
-void MainWindow::updateListsFromDirs()
+void MainWindow::updateListsFromDirs( bool pollingTick )
 {
+	QString configDir = getConfigDir();
+	QString saveDir = getSaveDir();
+	QString demoDir = getDemoDir();
+
+	const QStringVec mapDirs = mapSettings.getDirs();
+	QStringVec dirsInUse = { configDir, saveDir, demoDir };
+	dirsInUse += mapDirs;
 	if (iwadSettings.updateFromDir)
-		updateIWADsFromDir();
-	updateConfigFilesFromDir();
-	updateSaveFilesFromDir();
-	updateDemoFilesFromDir();
+		dirsInUse += iwadSettings.getDirs();
+	dirProber.forgetAllExcept( dirsInUse );
+
+	// A directory on a network share that went away would block even the stat() in the watcher, let alone the listing,
+	// so the directories are touched only when the last background probe says they respond.
+	auto isReachable = [&]( const QString & dir )
+	{
+		return DirProber::isReachable( dirProber.getState( dir ) );
+	};
+
+	if (settings.pollDirectories)  // user explicitly requested polling, because his file system does not deliver change events
+	{
+		dirWatcher.unwatchAll();
+
+		// the same directory can be asked about several times (e.g. saves and demos), the answer must be the same
+		QHash< QString, bool > dirsDue;
+		auto needsUpdate = [&]( const QString & dir )
+		{
+			auto iter = dirsDue.find( dir );
+			if (iter == dirsDue.end())
+			{
+				bool due = false;
+				if (isReachable( dir ))
+				{
+					bool becameReachable = dirsToRescan.remove( dir );
+					due = pollingTick || becameReachable;
+				}
+				iter = dirsDue.insert( dir, due );
+			}
+			return iter.value();
+		};
+
+		if (iwadSettings.updateFromDir)
+		{
+			QStringVec changedIWADDirs;
+			for (const QString & iwadDir : iwadSettings.getDirs())
+				if (needsUpdate( iwadDir ))
+					changedIWADDirs.append( iwadDir );
+			if (!changedIWADDirs.isEmpty())
+				updateIWADsFromDir_async( changedIWADDirs );
+		}
+		for (const QString & mapDir : mapDirs)
+			if (needsUpdate( mapDir ))
+				mapModel.refresh( mapDir );
+		if (needsUpdate( configDir ))
+			updateConfigFilesFromDir_async( configDir );
+		if (needsUpdate( saveDir ))
+			updateSaveFilesFromDir_async( saveDir );
+		if (needsUpdate( demoDir ))
+			updateDemoFilesFromDir_async( demoDir );
+		return;
+	}
+
+	// stop watching the directories that are no longer displayed (e.g. different engine was selected)
+	dirWatcher.unwatchAllExcept( dirsInUse );
+
+	// Multiple lists can be populated from the same directory (e.g. saves and demos),
+	// but the change flag of a directory can be taken only once.
+	QHash< QString, bool > dirsChanged;
+	auto needsUpdate = [&]( const QString & dir, bool recursively )
+	{
+		auto iter = dirsChanged.find( dir );
+		if (iter == dirsChanged.end())
+		{
+			bool changed = false;
+			if (isReachable( dir ))
+			{
+				bool becameReachable = dirsToRescan.remove( dir );
+				changed = dirNeedsUpdate( dir, recursively, pollingTick ) || becameReachable;
+			}
+			iter = dirsChanged.insert( dir, changed );
+		}
+		return iter.value();
+	};
+
+	if (iwadSettings.updateFromDir)
+	{
+		QStringVec changedIWADDirs;
+		for (const QString & iwadDir : iwadSettings.getDirs())
+			if (needsUpdate( iwadDir, iwadSettings.searchSubdirs ))
+				changedIWADDirs.append( iwadDir );
+		if (!changedIWADDirs.isEmpty())
+			updateIWADsFromDir_async( changedIWADDirs );
+	}
+	for (const QString & mapDir : mapDirs)
+		if (needsUpdate( mapDir, /*recursively*/true ))  // the expanded sub-directories are displayed too
+			mapModel.refresh( mapDir );  // lists again only the loaded directories, and updates only what has changed
+	if (needsUpdate( configDir, /*recursively*/false ))
+		updateConfigFilesFromDir_async( configDir );
+	if (needsUpdate( saveDir, /*recursively*/false ))
+		updateSaveFilesFromDir_async( saveDir );
+	if (needsUpdate( demoDir, /*recursively*/false ))
+		updateDemoFilesFromDir_async( demoDir );
+}
+
+bool MainWindow::dirNeedsUpdate( const QString & dir, bool recursively, bool pollingTick )
+{
+	if (dirWatcher.isWatched( dir ) && dirWatcher.watch( dir, recursively ))  // watch() restarts it if recursion has changed
+	{
+		return dirWatcher.takeChange( dir );
+	}
+
+	// Not watched yet, or it can't be watched at all (doesn't exist, unsupported file system, out of watch descriptors).
+	// Fall back to polling, but keep trying to set up the watch, the directory might have been created since.
+	if (!pollingTick)
+	{
+		return false;
+	}
+	dirWatcher.watch( dir, recursively );
+	return true;  // re-scan anyway, the content might have changed before the watch was established
+}
+
+void MainWindow::onDirStateChanged( const QString & dir, DirProber::State newState )
+{
+	if (!DirProber::isReachable( newState ))
+	{
+		// the lists keep displaying what they had, they will be updated when the directory responds again
+		dirsToRescan.remove( dir );
+		return;
+	}
+
+	// it was either unknown, or didn't respond, or it has appeared or disappeared, list it now rather than at the next tick
+	dirsToRescan.insert( dir );
+	updateListsFromDirs( /*pollingTick*/false );
 }
 
+static const QStringVec saveFileSuffixes = { doom::saveFileSuffix };
+static const QStringVec demoFileSuffixes = { doom::demoFileSuffix };
+
+// The synchronous variants are used when the caller needs the list to be up-to-date immediately after the call
+// (e.g. to select an item in it), the asynchronous ones for the periodic updates, so that scanning a large directory
+// doesn't freeze the window. The synchronous update cancels the asynchronous one, which would otherwise overwrite it
+// with an older result.
+
 void MainWindow::updateIWADsFromDir()
+{
+	syncIWADRoots();
+	for (IWADRoot & root : iwadRoots)
+		dirTraverser.cancel( &root );
+
+	// the snapshot from the last session covers the merged list, so it can be used only if there is a single root
+	if (iwadRoots.size() <= 1)
+	{
+		if (auto snapshot = takeListSnapshot( "iwads", iwadSettings.getDirs() ))
+		{
+			if (!iwadRoots.empty())
+			{
+				iwadRoots[0].iwads = makeItemsFromSnapshot< IWAD >( *snapshot );
+				iwadRoots[0].fingerprints.clear();
+			}
+			applyIWADRoots();
+			return;
+		}
+	}
+
+	for (IWADRoot & root : iwadRoots)
+	{
+		if (dirProber.getState( root.dir ) == DirProber::State::Unresponsive)
+			continue;  // keep what it had rather than freezing, it will be updated when the directory responds again
+
+		if (iwadSettings.detectByHeader)
+			root.iwads = wdg::readItemsFromDir< IWAD >( root.dir, iwadSettings.searchSubdirs, pathConvertor, doom::isIWADByHeader );
+		else
+			root.iwads = wdg::readItemsFromDir< IWAD >( root.dir, iwadSettings.searchSubdirs, pathConvertor, doom::allIwadSuffixes );
+
+		// duplicates are possible only with multiple roots, don't stat the files when there is nothing to compare them with
+		root.fingerprints.clear();
+		if (iwadRoots.size() > 1)
+			for (const IWAD & iwad : root.iwads)
+				root.fingerprints.append( doom::getIWADFingerprint( QFileInfo( iwad.path ) ) );
+	}
+
+	applyIWADRoots();
+}
+
+void MainWindow::updateIWADsFromDir_async( const QStringVec & changedDirs )
+{
+	bool rootsChanged = syncIWADRoots();
+
+	bool detectByHeader = iwadSettings.detectByHeader;
+	bool needFingerprints = iwadRoots.size() > 1;
+
+	for (IWADRoot & root : iwadRoots)
+	{
+		if (!rootsChanged && !changedDirs.contains( root.dir ))
+			continue;  // keeps its last result
+
+		struct Result
+		{
+			QList< IWAD > iwads;
+			QStringVec fingerprints;
+		};
+		auto result = std::make_shared< Result >();
+
+		// The headers are read in the worker thread too, the cache behind isIWADByHeader() is thread-safe.
+		// The size for the fingerprint is queried there as well, QFileInfo keeps it, so the main thread doesn't stat
+		// the files on a slow disk.
+		dirTraverser.traverse( &root, root.dir, iwadSettings.searchSubdirs, fs::EntryType::FILE, pathConvertor,
+			/*entryFilter*/[ detectByHeader, needFingerprints ]( const QFileInfo & file )
+			{
+				if (!fs::hasOneOfSuffixes( file.fileName(), doom::allIwadSuffixes ))
+					return false;
+				if (detectByHeader && !doom::isIWADByHeader( file ))
+					return false;
+				if (needFingerprints)
+					(void) file.size();  // QFileInfo caches it
+				return true;
+			},
+			/*onBatch*/[ result, needFingerprints ]( QList< QFileInfo > && files )
+			{
+				for (const QFileInfo & file : files)
+				{
+					result->iwads.append( IWAD( file ) );
+					if (needFingerprints)
+						result->fingerprints.append( doom::getIWADFingerprint( file ) );
+				}
+			},
+			/*onFinished*/[ this, rootPtr = &root, result ]()
+			{
+				if (!iwadSettings.updateFromDir)  // the user might have switched to manual management in the meantime
+					return;
+				// the roots haven't been changed in the meantime, that would cancel this traversal
+				rootPtr->iwads = std::move( result->iwads );
+				rootPtr->fingerprints = std::move( result->fingerprints );
+				applyIWADRoots();  // the other roots keep displaying their last result until they're done
+			}
+		);
+	}
+}
+
+/// Makes the IWAD roots match the directories in the settings, keeps the results of the directories that remained.
+/** Returns true if the roots have changed, then all of them should be scanned again, because the fingerprints
+  * might be needed now. */
+bool MainWindow::syncIWADRoots()
+{
+	QStringVec dirs = iwadSettings.getDirs();
+
+	bool same = dirs.size() == int( iwadRoots.size() );
+	for (int i = 0; same && i < dirs.size(); ++i)
+		same = iwadRoots[i].dir == dirs[i];
+	if (same)
+		return false;
+
+	for (IWADRoot & root : iwadRoots)
+		dirTraverser.cancel( &root );
+
+	std::vector< IWADRoot > newRoots( size_t( dirs.size() ) );
+	for (int i = 0; i < dirs.size(); ++i)
+	{
+		newRoots[i].dir = dirs[i];
+		for (IWADRoot & oldRoot : iwadRoots)
+			if (oldRoot.dir == dirs[i])
+				newRoots[i] = std::move( oldRoot );
+	}
+	iwadRoots = std::move( newRoots );
+
+	return true;
+}
+
+/// Merges the IWADs from all the roots into the list, the copies of the same IWAD in the later roots are skipped.
+void MainWindow::applyIWADRoots()
+{
+	QList< IWAD > merged;
+	QSet< QString > seenPaths;
+	QSet< QString > seenFingerprints;
+
+	for (const IWADRoot & root : iwadRoots)
+	{
+		// the fingerprints are missing when the list was taken from the snapshot, then at least the paths are compared
+		bool hasFingerprints = root.fingerprints.size() == root.iwads.size();
+		for (int i = 0; i < root.iwads.size(); ++i)
+		{
+			const IWAD & iwad = root.iwads[i];
+			if (seenPaths.contains( iwad.path ))
+				continue;  // one root is inside another one
+			if (hasFingerprints && !root.fingerprints[i].isEmpty())
+			{
+				if (seenFingerprints.contains( root.fingerprints[i] ))
+					continue;
+				seenFingerprints.insert( root.fingerprints[i] );
+			}
+			seenPaths.insert( iwad.path );
+			merged.append( iwad );
+		}
+	}
+
+	applyIWADsFromDir( std::move(merged) );
+}
+
+void MainWindow::applyIWADsFromDir( QList< IWAD > && iwads )
 {
 	// workaround (read the big comment above)
 	int origIwadIdx = wdg::getSelectedItemIndex( ui->iwadListView );
 	disableSelectionCallbacks = true;
 
-	wdg::updateListFromDir( iwadModel, ui->iwadListView, iwadSettings.dir, iwadSettings.searchSubdirs, pathConvertor, doom::isIWAD );
+	wdg::updateListContent( iwadModel, ui->iwadListView, std::move(iwads) );
+
+	// only the new or modified ones will actually be read
+	QStringVec iwadPaths;
+	iwadPaths.reserve( iwadModel.size() );
+	for (const IWAD & iwad : iwadModel)
+		iwadPaths.append( iwad.path );
+	wadPrefetcher.prefetchFiles( iwadPaths );
 
 	if (!iwadSettings.defaultIWAD.isEmpty())
 	{
 		// the default item marking was lost during the update, mark it again
-		int defaultIdx = findSuch( iwadModel, [&]( const IWAD & i ){ return i.getID() == iwadSettings.defaultIWAD; } );
+		int defaultIdx = iwadModel.findIndexByID( iwadSettings.defaultIWAD );
 		if (defaultIdx >= 0)
 			markItemAsDefault( iwadModel[ defaultIdx ] );
 	}
@@ -2895,23 +3591,37 @@ void MainWindow::updateIWADsFromDir()
   * so it will most likely not be ready yet when this function returns. */
 void MainWindow::resetMapDirModelAndView()
 {
-	// We use QFileSystemModel which updates the data from directory automatically.
-	// But when the directory is changed, the model and view needs to be reset.
-	QModelIndex newRootIdx = mapModel.setRootPath( mapSettings.dir );
-	ui->mapDirView->setRootIndex( newRootIdx );
+	// The model then lists only the directories that are needed, and updates them when refresh() is called.
+	mapModel.setRootPaths( mapSettings.getDirs() );
 }
 
 void MainWindow::updateConfigFilesFromDir( const QString * callersConfigDir )
 {
 	QString configDir = callersConfigDir ? *callersConfigDir : getConfigDir();
 
+	dirTraverser.cancel( &configModel );
+	if (auto snapshot = takeListSnapshot( "configs", { configDir } ))
+		applyConfigFilesFromDir( makeItemsFromSnapshot< ConfigFile >( *snapshot ) );
+	else if (dirProber.getState( configDir ) == DirProber::State::Unresponsive)
+		return;  // keep what is displayed rather than freezing, it will be updated when the directory responds again
+	else
+		applyConfigFilesFromDir( wdg::readItemsFromDir< ConfigFile >( configDir, /*recursively*/false, pathConvertor, doom::configFileSuffixes ) );
+}
+
+void MainWindow::updateConfigFilesFromDir_async( const QString & configDir )
+{
+	wdg::readItemsFromDir_async< ConfigFile >( dirTraverser, &configModel, configDir, /*recursively*/false, pathConvertor, doom::configFileSuffixes,
+		/*onDone*/[ this ]( QList< ConfigFile > && configs ) { applyConfigFilesFromDir( std::move(configs) ); }
+	);
+}
+
+void MainWindow::applyConfigFilesFromDir( QList< ConfigFile > && configs )
+{
 	// workaround (read the big comment above)
 	int origConfigIdx = ui->configCmbBox->currentIndex();
 	disableSelectionCallbacks = true;
 
-	wdg::updateComboBoxFromDir( configModel, ui->configCmbBox, configDir, /*recursively*/false, /*emptyItem*/true, pathConvertor,
-		/*isDesiredFile*/[]( const QFileInfo & file ) { return doom::configFileSuffixes.contains( file.suffix().toLower() ); }
-	);
+	wdg::updateComboBoxContent( configModel, ui->configCmbBox, /*emptyItem*/true, std::move(configs) );
 
 	disableSelectionCallbacks = false;
 	int newConfigIdx = ui->configCmbBox->currentIndex();
@@ -2923,17 +3633,89 @@ void MainWindow::updateConfigFilesFromDir( const QString * callersConfigDir )
 	}
 }
 
+/// The file names of the saves are usually just numbered slots, so the title and the level are displayed with them.
+QString MainWindow::makeSaveDisplayString( const SaveFile & save )
+{
+	if (!save.info || (save.info->title.isEmpty() && save.info->mapName.isEmpty()))
+		return save.fileName;
+
+	const doom::SaveInfo & info = *save.info;
+
+	QStringList levelDesc;
+	if (!info.mapName.isEmpty())
+		levelDesc.append( info.mapName );
+	if (!info.levelName.isEmpty() && info.levelName.compare( info.mapName, Qt::CaseInsensitive ) != 0)
+		levelDesc.append( info.levelName );
+	if (!info.levelTime.isEmpty())
+		levelDesc.append( info.levelTime );
+
+	QString title = !info.title.isEmpty() ? info.title : save.fileName;
+	if (levelDesc.isEmpty())
+		return title % "  (" % save.fileName % ")";
+	return title % "  [" % levelDesc.join(", ") % "]  (" % save.fileName % ")";
+}
+
 void MainWindow::updateSaveFilesFromDir( const QString * callersSaveDir )
 {
 	QString saveDir = callersSaveDir ? *callersSaveDir : getSaveDir();
 
+	dirTraverser.cancel( &saveModel );
+	if (prefetchedSaveDirs.remove( saveDir ))
+	{
+		if (auto files = fs::g_cachedDirSnapshots.peekFiles( saveDir, /*recursively*/false ))
+		{
+			// listed shortly ago by prefetchSaveDirs(), display it right away and check it for changes in the background
+			applySaveFilesFromDir( makeItemsFromFiles< SaveFile >( *files, saveFileSuffixes ) );
+			requestSaveInfo( saveDir );
+			updateSaveFilesFromDir_async( saveDir );
+			return;
+		}
+	}
+	if (auto snapshot = takeListSnapshot( "saves", { saveDir } ))
+		applySaveFilesFromDir( makeItemsFromSnapshot< SaveFile >( *snapshot ) );
+	else if (dirProber.getState( saveDir ) == DirProber::State::Unresponsive)
+		return;  // keep what is displayed rather than freezing, it will be updated when the directory responds again
+	else
+		applySaveFilesFromDir( wdg::readItemsFromDir< SaveFile >( saveDir, /*recursively*/false, pathConvertor, saveFileSuffixes ) );
+
+	requestSaveInfo( saveDir );
+}
+
+void MainWindow::updateSaveFilesFromDir_async( const QString & saveDir )
+{
+	wdg::readItemsFromDir_async< SaveFile >( dirTraverser, &saveModel, saveDir, /*recursively*/false, pathConvertor, saveFileSuffixes,
+		/*onDone*/[ this, saveDir ]( QList< SaveFile > && saves )
+		{
+			applySaveFilesFromDir( std::move(saves) );
+			requestSaveInfo( saveDir );
+		}
+	);
+}
+
+void MainWindow::applySaveFilesFromDir( QList< SaveFile > && saves )
+{
+	// The list is refreshed every few seconds, keep the info of the saves that haven't changed,
+	// so that their display strings stay the same and nothing needs to be read again.
+	QHash< QString, const SaveFile * > oldSavesByName;
+	for (const SaveFile & oldSave : saveModel)
+		if (oldSave.info)
+			oldSavesByName.insert( oldSave.fileName, &oldSave );
+	for (SaveFile & save : saves)
+	{
+		const SaveFile * oldSave = oldSavesByName.value( save.fileName );
+		if (oldSave && (oldSave->stamp == save.stamp || save.stamp.size < 0))
+		{
+			save.info = oldSave->info;
+			if (save.stamp.size < 0)
+				save.stamp = oldSave->stamp;
+		}
+	}
+
 	// workaround (read the big comment above)
 	int origSaveIdx = ui->saveFileCmbBox->currentIndex();
 	disableSelectionCallbacks = true;
 
-	wdg::updateComboBoxFromDir( saveModel, ui->saveFileCmbBox, saveDir, /*recursively*/false, /*emptyItem*/false, pathConvertor,
-		/*isDesiredFile*/[]( const QFileInfo & file ) { return file.suffix().toLower() == doom::saveFileSuffix; }
-	);
+	wdg::updateComboBoxContent( saveModel, ui->saveFileCmbBox, /*emptyItem*/false, std::move(saves) );
 
 	disableSelectionCallbacks = false;
 	int newSaveIdx = ui->saveFileCmbBox->currentIndex();
@@ -2945,17 +3727,105 @@ void MainWindow::updateSaveFilesFromDir( const QString * callersSaveDir )
 	}
 }
 
+void MainWindow::requestSaveInfo( const QString & saveDir )
+{
+	// only the central directory and the small info entry are read, and only for the saves that are new or changed,
+	// the others are answered from the cache that is persisted across sessions
+	for (const SaveFile & save : saveModel)
+	{
+		if (save.info)
+			continue;
+
+		QString savePath = fs::getPathFromFileName( saveDir, save.fileName );
+		doom::g_cachedSaveInfo.requestFileInfo( savePath, this,
+			[ this, fileName = save.fileName, stamp = save.stamp ]( const doom::UncertainSaveInfo & saveInfo )
+			{
+				onSaveInfoRead( fileName, stamp, saveInfo );
+			}
+		);
+	}
+}
+
+void MainWindow::onSaveInfoRead( const QString & fileName, const FileStamp & stamp, const doom::UncertainSaveInfo & saveInfo )
+{
+	int saveIdx = saveModel.findIndexByID( fileName );
+	if (saveIdx < 0)
+		return;  // the list has changed in the meantime
+
+	SaveFile & save = saveModel[ saveIdx ];
+	if (save.info || (stamp.size >= 0 && save.stamp != stamp))
+		return;  // already known, or it's a different version of the file now
+
+	// an empty info is remembered too, so that the files without it are not requested on every refresh
+	save.info = saveInfo.status == ReadStatus::Success ? static_cast< const doom::SaveInfo & >( saveInfo ) : doom::SaveInfo();
+
+	// the combo-box text changes, but the selection and the stored file name don't
+	QModelIndex index = saveModel.makeIndex( saveIdx );
+	emit saveModel.dataChanged( index, index, { Qt::DisplayRole } );
+}
+
 void MainWindow::updateDemoFilesFromDir( const QString * callersDemoDir )
 {
 	QString demoDir = callersDemoDir ? *callersDemoDir : getDemoDir();
 
+	dirTraverser.cancel( &demoModel );
+	if (prefetchedDemoDirs.remove( demoDir ))
+	{
+		if (auto files = fs::g_cachedDirSnapshots.peekFiles( demoDir, /*recursively*/false ))
+		{
+			// listed shortly ago by prefetchSaveDirs(), display it right away and check it for changes in the background
+			applyDemoFilesFromDir( makeItemsFromFiles< DemoFile >( *files, demoFileSuffixes ) );
+			requestDemoInfo( demoDir );
+			updateDemoFilesFromDir_async( demoDir );
+			return;
+		}
+	}
+	if (auto snapshot = takeListSnapshot( "demos", { demoDir } ))
+		applyDemoFilesFromDir( makeItemsFromSnapshot< DemoFile >( *snapshot ) );
+	else if (dirProber.getState( demoDir ) == DirProber::State::Unresponsive)
+		return;  // keep what is displayed rather than freezing, it will be updated when the directory responds again
+	else
+		applyDemoFilesFromDir( wdg::readItemsFromDir< DemoFile >( demoDir, /*recursively*/false, pathConvertor, demoFileSuffixes ) );
+
+	requestDemoInfo( demoDir );
+}
+
+void MainWindow::updateDemoFilesFromDir_async( const QString & demoDir )
+{
+	wdg::readItemsFromDir_async< DemoFile >( dirTraverser, &demoModel, demoDir, /*recursively*/false, pathConvertor, demoFileSuffixes,
+		/*onDone*/[ this, demoDir ]( QList< DemoFile > && demos )
+		{
+			applyDemoFilesFromDir( std::move(demos) );
+			requestDemoInfo( demoDir );
+		}
+	);
+}
+
+void MainWindow::applyDemoFilesFromDir( QList< DemoFile > && demos )
+{
+	// keep the info of the demos that haven't changed, the same way as with the saves
+	QHash< QString, const DemoFile * > oldDemosByName;
+	for (const DemoFile & oldDemo : demoModel)
+		if (oldDemo.info)
+			oldDemosByName.insert( oldDemo.fileName, &oldDemo );
+	const EngineInfo * selectedEngine = getSelectedEngine();
+	for (DemoFile & demo : demos)
+	{
+		const DemoFile * oldDemo = oldDemosByName.value( demo.fileName );
+		if (oldDemo && (oldDemo->stamp == demo.stamp || demo.stamp.size < 0))
+		{
+			demo.info = oldDemo->info;
+			if (demo.stamp.size < 0)
+				demo.stamp = oldDemo->stamp;
+		}
+		markDemoCompatibility( demo, selectedEngine );
+	}
+
 	// workaround (read the big comment above)
 	int origDemoIdx = ui->demoFileCmbBox_replay->currentIndex();
 	disableSelectionCallbacks = true;
 
-	wdg::updateComboBoxFromDir( demoModel, ui->demoFileCmbBox_replay, demoDir, /*recursively*/false, /*emptyItem*/false, pathConvertor,
-		/*isDesiredFile*/[]( const QFileInfo & file ) { return file.suffix().toLower() == doom::demoFileSuffix; }
-	);
+	wdg::updateComboBoxContent( demoModel, ui->demoFileCmbBox_replay, /*emptyItem*/false, std::move(demos) );
 
 	disableSelectionCallbacks = false;
 	int newDemoIdx = ui->demoFileCmbBox_replay->currentIndex();
@@ -2967,6 +3837,116 @@ void MainWindow::updateDemoFilesFromDir( const QString * callersDemoDir )
 	}
 }
 
+QString MainWindow::makeDemoDisplayString( const DemoFile & demo )
+{
+	if (!demo.info)
+		return demo.fileName;
+
+	static const char * const skillNames [] = { "ITYTD", "HNTR", "HMP", "UV", "NM" };
+
+	const doom::DemoInfo & info = *demo.info;
+
+	QStringList desc;
+	desc.append( info.formatDesc );
+	QString mapName = info.getMapName();
+	if (!mapName.isEmpty())
+		desc.append( mapName );
+	if (info.skill >= 0 && info.skill < int( std::size( skillNames ) ))
+		desc.append( skillNames[ info.skill ] );
+	if (info.numPlayers > 1)
+		desc.append( QString::number( info.numPlayers ) % " players" );
+	if (!info.iwad.isEmpty())
+		desc.append( info.iwad );
+	if (!info.files.isEmpty())
+		desc.append( info.files.join(' ') );
+
+	return demo.fileName % "  [" % desc.join(", ") % "]";
+}
+
+/// Whether the engine is able to play demos of this format at all.
+static bool canEnginePlayDemo( const EngineInfo & engine, const doom::DemoInfo & demoInfo )
+{
+	switch (engine.family)
+	{
+		case EngineFamily::ZDoom:          return demoInfo.format == doom::DemoFormat::ZDoom;
+		case EngineFamily::ChocolateDoom:  return demoInfo.format == doom::DemoFormat::Vanilla;
+		case EngineFamily::PrBoom:
+		case EngineFamily::MBF:            return demoInfo.format == doom::DemoFormat::Vanilla || demoInfo.format == doom::DemoFormat::Boom;
+		default:                           return true;
+	}
+}
+
+void MainWindow::markDemoCompatibility( const DemoFile & demo, const EngineInfo * engine )
+{
+	// The demos that can't be played with the selected engine are only greyed out rather than removed,
+	// so that a preset that refers to one of them doesn't appear broken.
+	if (engine && demo.info && demo.info->format != doom::DemoFormat::Unknown && !canEnginePlayDemo( *engine, *demo.info ))
+		demo.textColor = QApplication::palette().color( QPalette::Disabled, QPalette::Text );
+	else
+		demo.textColor.reset();
+}
+
+void MainWindow::requestDemoInfo( const QString & demoDir )
+{
+	// only the header and the footer are read, and only for the demos that are new or changed
+	for (const DemoFile & demo : demoModel)
+	{
+		if (demo.info)
+			continue;
+
+		QString demoPath = fs::getPathFromFileName( demoDir, demo.fileName );
+		doom::g_cachedDemoInfo.requestFileInfo( demoPath, this,
+			[ this, fileName = demo.fileName, stamp = demo.stamp ]( const doom::UncertainDemoInfo & demoInfo )
+			{
+				onDemoInfoRead( fileName, stamp, demoInfo );
+			}
+		);
+	}
+}
+
+void MainWindow::onDemoInfoRead( const QString & fileName, const FileStamp & stamp, const doom::UncertainDemoInfo & demoInfo )
+{
+	int demoIdx = demoModel.findIndexByID( fileName );
+	if (demoIdx < 0)
+		return;  // the list has changed in the meantime
+
+	DemoFile & demo = demoModel[ demoIdx ];
+	if (demo.info || (stamp.size >= 0 && demo.stamp != stamp))
+		return;  // already known, or it's a different version of the file now
+
+	// an empty info is remembered too, so that the files that aren't demos are not requested on every refresh
+	demo.info = demoInfo.status == ReadStatus::Success ? static_cast< const doom::DemoInfo & >( demoInfo ) : doom::DemoInfo();
+	markDemoCompatibility( demo, getSelectedEngine() );
+
+	QModelIndex index = demoModel.makeIndex( demoIdx );
+	emit demoModel.dataChanged( index, index, { Qt::DisplayRole, Qt::ForegroundRole } );
+}
+
+void MainWindow::preselectOptionsForDemo( const doom::DemoInfo & demoInfo )
+{
+	// the restored preset already has the IWAD the user chose, don't override it with the guess
+	if (restoringPresetInProgress)
+		return;
+
+	// The complevel is not pre-selected, the engines read it from the demo header,
+	// and the complevel box is disabled in the ReplayDemo mode anyway.
+
+	if (!demoInfo.iwad.isEmpty())
+	{
+		const IWAD * selectedIWAD = getSelectedIWAD();
+		bool alreadySelected = selectedIWAD && fs::getFileNameFromPath( selectedIWAD->path ).compare( demoInfo.iwad, Qt::CaseInsensitive ) == 0;
+		if (!alreadySelected)
+		{
+			int iwadIdx = findSuch( iwadModel, [&]( const IWAD & iwad )
+			{
+				return fs::getFileNameFromPath( iwad.path ).compare( demoInfo.iwad, Qt::CaseInsensitive ) == 0;
+			});
+			if (iwadIdx >= 0)
+				wdg::selectAndSetCurrentByIndex( ui->iwadListView, iwadIdx );  // invokes the callback that stores it
+		}
+	}
+}
+
 /// Updates the compat level combo-box according to the currently selected engine.
 void MainWindow::updateCompatLevels()
 {
@@ -3010,6 +3990,9 @@ void MainWindow::updateMapsFromSelectedWADs( const QStringVec * selectedMapPacks
 	const IWAD * selectedIWAD = getSelectedIWAD();
 	const QString & selectedIwadPath = selectedIWAD ? selectedIWAD->path : emptyString;
 
+	// the map packs without their own palette are displayed in the colours of the game they would be played with
+	g_thumbnailCache.setFallbackPalette( !selectedIwadPath.isEmpty() ? pathConvertor.getAbsolutePath( selectedIwadPath ) : QString() );
+
 	// optimization: it the caller already has them, use his ones instead of getting them again
 	QStringVec localSelectedMapPacks;
 	if (!selectedMapPacks)
@@ -3026,44 +4009,54 @@ void MainWindow::updateMapsFromSelectedWADs( const QStringVec * selectedMapPacks
 
 	do
 	{
-		// We don't use the model-view architecture like with the rest of combo-boxes,
-		// because the editable combo-box doesn't work well with a custom model.
-
-		ui->mapCmbBox->setCurrentIndex( -1 );
-		ui->mapCmbBox_demo->setCurrentIndex( -1 );
-
-		ui->mapCmbBox->clear();
-		ui->mapCmbBox_demo->clear();
-
 		if (!selectedIWAD)
 		{
-			break;  // if no IWAD is selected, let's leave this empty, it cannot be launched anyway
+			// if no IWAD is selected, let's leave this empty, it cannot be launched anyway
+			selectedMapNames.clear();
+			mapNamesModel.setStringList( {} );
+			mapNamesAreStandard = false;
+			break;
 		}
 
-		auto selectedWADs = QStringVec{ selectedIwadPath } + *selectedMapPacks;
-
-		// read the map names from the selected files and merge them so that entries are not duplicated
-		auto uniqueMapNames = getUniqueMapNamesFromWADs( selectedWADs );
-
-		// fill the combox-box
-		if (!uniqueMapNames.isEmpty())
+		QStringVec selectedWADs;
+		selectedWADs.reserve( selectedMapPacks->size() + 1 );
+		selectedWADs.append( selectedIwadPath );
+		selectedWADs.append( *selectedMapPacks );
+
+		// Only the WADs that have been selected, deselected or changed on disk since the last time are processed,
+		// and only the names that appeared or disappeared by that are inserted into or removed from the model.
+		QStringVec removedNames, addedNames;
+		for (const QString & wadPath : selectedMapNames.wadPaths())
+			if (!selectedWADs.contains( wadPath ))
+				removedNames.append( selectedMapNames.removeWAD( wadPath ) );
+		for (const QString & wadPath : selectedWADs)
+			selectedMapNames.addWAD( wadPath, addedNames, removedNames );
+
+		if (selectedMapNames.isEmpty())
 		{
-			auto mapNames = uniqueMapNames;
-			ui->mapCmbBox->addItems( mapNames );
-			ui->mapCmbBox_demo->addItems( mapNames );
+			// if we haven't found any map names in the WADs, fallback to the standard names based on IWAD name
+			mapNamesModel.setStringList( doom::getStandardMapNames( fs::getFileNameFromPath( selectedIwadPath ) ) );
+			mapNamesAreStandard = true;
 		}
-		else  // if we haven't found any map names in the WADs, fallback to the standard names based on IWAD name
+		else if (mapNamesAreStandard)
+		{
+			mapNamesModel.setStringList( selectedMapNames.sortedNames() );
+			mapNamesAreStandard = false;
+		}
+		else
 		{
-			auto mapNames = doom::getStandardMapNames( fs::getFileNameFromPath( selectedIwadPath ) );
-			ui->mapCmbBox->addItems( mapNames );
-			ui->mapCmbBox_demo->addItems( mapNames );
+			removeMapNames( removedNames );
+			insertMapNames( addedNames );
 		}
+	}
+	while (false);  // this trick allows us to exit from the block without returning from a function
 
-		// restore the originally selected item
+	// When the selected name was removed, the combo-box moves the selection to a neighbouring name,
+	// but the user should rather see that the map is no longer available.
+	if (ui->mapCmbBox->currentText() != origText)
 		ui->mapCmbBox->setCurrentIndex( ui->mapCmbBox->findText( origText ) );
+	if (ui->mapCmbBox_demo->currentText() != origText_demo)
 		ui->mapCmbBox_demo->setCurrentIndex( ui->mapCmbBox_demo->findText( origText_demo ) );
-	}
-	while (false);  // this trick allows us to exit from the block without returning from a function
 
 	disableSelectionCallbacks = false;
 
@@ -3075,7 +4068,41 @@ void MainWindow::updateMapsFromSelectedWADs( const QStringVec * selectedMapPacks
 	if (ui->mapCmbBox_demo->currentText() != origText_demo)
 	{
 		// selection changed while the callbacks were disabled, we need to call them manually
-		onMapChanged_demo( ui->mapCmbBox->currentText() );
+		onMapChanged_demo( ui->mapCmbBox_demo->currentText() );
+	}
+}
+
+/// Returns the row where the name is or where it would have to be inserted to keep the list sorted.
+static int findSortedRow( const QStringListModel & model, const QString & name, bool & found )
+{
+	// the copy is shallow and it's released before the caller modifies the model, so the list isn't detached
+	const QStringList names = model.stringList();
+	auto iter = std::lower_bound( names.begin(), names.end(), name );
+	found = iter != names.end() && *iter == name;
+	return int( iter - names.begin() );
+}
+
+void MainWindow::insertMapNames( const QStringVec & mapNames )
+{
+	for (const QString & mapName : mapNames)
+	{
+		bool found;
+		int row = findSortedRow( mapNamesModel, mapName, found );
+		if (found)
+			continue;
+		mapNamesModel.insertRows( row, 1 );
+		mapNamesModel.setData( mapNamesModel.index( row ), mapName );
+	}
+}
+
+void MainWindow::removeMapNames( const QStringVec & mapNames )
+{
+	for (const QString & mapName : mapNames)
+	{
+		bool found;
+		int row = findSortedRow( mapNamesModel, mapName, found );
+		if (found)
+			mapNamesModel.removeRows( row, 1 );
 	}
 }
 
@@ -3083,9 +4110,9 @@ void MainWindow::updateMapsFromSelectedWADs( const QStringVec * selectedMapPacks
 //----------------------------------------------------------------------------------------------------------------------
 //  saving and loading user data
 
-bool MainWindow::saveOptions( const QString & filePath )
+OptionsToSave MainWindow::getOptionsToSave()
 {
-	OptionsToSave opts =
+	return
 	{
 		// files
 		engineModel.list(),
@@ -3112,11 +4139,39 @@ bool MainWindow::saveOptions( const QString & filePath )
 		settings,
 		this->geometry()
 	};
+}
+
+void MainWindow::saveOptions( const QString & filePath )
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	OptionsToSave opts = getOptionsToSave();
+
+	// Only the serialization is done here, the file is written in the background, so that a slow drive doesn't freeze the window.
+	OptionsFileContent content = serializeOptions( opts, optionsWriteCache );
+	if (content.isNull())
+		return;  // the content hasn't changed since the last time
 
-	return writeOptionsToFile( opts, filePath );
+	// The change notification of this write will come later, possibly after another write has been scheduled.
+	ownOptionsFileHashes.append( optionsWriteCache.fileHash );
+	if (ownOptionsFileHashes.size() > 4)
+		ownOptionsFileHashes.removeFirst();
+
+	diag::g_stats.optionsSaves.increment();
+	diag::g_stats.lastOptionsSaveMs.set( timer.elapsed() );
+	diag::g_stats.lastOptionsSaveBytes.set( content.json.size() + content.binary.size() );
+
+	fileWriter.writeFile( filePath, std::move(content.json), this, [ this ]( const QString & error )
+	{
+		optionsWriteCache.invalidateFileHash();  // try again the next time, even if nothing changes
+		reportRuntimeError( this, "Error saving options", error );
+	});
+	// the writer keeps the order, so the sidecar will be newer than the JSON
+	fileWriter.writeFile( getOptionsSidecarPath( filePath ), std::move(content.binary) );
 }
 
-bool MainWindow::loadOptions( const QString & filePath )
+bool MainWindow::loadOptions( const ParsedOptionsFile & parsedFile )
 {
 	// Some options can be read directly into the class members using references,
 	// but the models can't, because the UI must be prepared for reseting its models first.
@@ -3145,54 +4200,518 @@ bool MainWindow::loadOptions( const QString & filePath )
 		mapSettings,
 		modSettings,
 		settings,
-		{}  // window geometry
+		{},  // window geometry
+
+		// the presets will be fully loaded when they are selected, see ensurePresetLoaded()
+		true  // load presets lazily
 	};
 
-	bool optionsRead = readOptionsFromFile( opts, filePath );
+	bool optionsRead = deserializeOptions( opts, parsedFile );
+	g_startupTimeline.addTimePoint( "loadOptions" );
 	if (!optionsRead)
 	{
-		if (fs::exists( filePath ))
+		if (fs::exists( parsedFile.filePath ))
 			optionsCorrupted = true;  // file exists but cannot be read, don't overwrite it, give user chance to fix it
 		return false;
 	}
 
+	bool wasMigrated = opts.wasMigrated;
+
 	restoreLoadedOptions( std::move(opts) );
+	g_startupTimeline.addTimePoint( "restoreLoadedOptions" );
+
+	// write it back in the current format right away, so that the next start doesn't have to migrate it again
+	if (wasMigrated)
+		optionsNeedUpdate = true;
 
 	optionsCorrupted = false;
 	return true;
 }
 
+void MainWindow::watchOptionsFile()
+{
+	optionsReloadTimer.setSingleShot( true );
+	optionsReloadTimer.setInterval( 500 );
+	connect( &optionsReloadTimer, &QTimer::timeout, this, &thisClass::reloadModifiedOptions );
+
+	// QSaveFile replaces the file by renaming a new one over it, which removes it from the watcher,
+	// so the directory is watched too, to pick up the new file.
+	connect( &optionsFileWatcher, &QFileSystemWatcher::fileChanged, this, [ this ]( const QString & /*path*/ )
+	{
+		if (!optionsFileWatcher.files().contains( optionsFilePath ))
+			optionsFileWatcher.addPath( optionsFilePath );  // fails while the file is being replaced, the directory will tell us
+		optionsReloadTimer.start();  // restarts it, if the other program is still writing
+	});
+	connect( &optionsFileWatcher, &QFileSystemWatcher::directoryChanged, this, [ this ]( const QString & /*path*/ )
+	{
+		// other files in the directory are changed all the time, the watched file reports its changes itself
+		if (!optionsFileWatcher.files().contains( optionsFilePath ) && optionsFileWatcher.addPath( optionsFilePath ))
+			optionsReloadTimer.start();
+	});
+
+	optionsFileWatcher.addPath( appDataDir.path() );
+	if (fs::exists( optionsFilePath ))
+		optionsFileWatcher.addPath( optionsFilePath );
+}
+
+void MainWindow::reloadModifiedOptions()
+{
+	if (optionsReloadTask.isRunning())
+	{
+		optionsReloadPending = true;  // it will be parsed again when this one is done
+		return;
+	}
+
+	// Reading and parsing the file is done in the background, only the differences are then applied in the main thread.
+	// Most of the notifications are about our own writes, they are recognized by the hash before parsing the file.
+	optionsReloadTask.addTask( [ this, filePath = optionsFilePath, knownHashes = ownOptionsFileHashes ]()
+	{
+		modifiedOptionsFile = parseOptionsFileUnlessKnown( filePath, knownHashes );
+	});
+	optionsReloadTask.whenAllDone( this, [ this ]()
+	{
+		ParsedOptionsFile parsedFile = std::move( modifiedOptionsFile );
+		modifiedOptionsFile = {};
+
+		applyModifiedOptions( parsedFile );
+
+		if (optionsReloadPending)
+		{
+			optionsReloadPending = false;
+			reloadModifiedOptions();
+		}
+	});
+}
+
+/// Replaces a range of the items and notifies the views about only that range, so that the rest keeps its selection.
+template< typename Model, typename Item >
+static void applyListChange( Model & model, ListChange< Item > && change )
+{
+	if (change.removedCount > 0)
+	{
+		model.startDeleting( change.begin, change.removedCount );
+		model.removeRange( change.begin, change.removedCount );
+		model.finishDeleting();
+	}
+	if (!change.inserted.isEmpty())
+	{
+		model.startInserting( change.begin, int( change.inserted.size() ) );
+		model.insertRange( change.begin, std::move( change.inserted ) );
+		model.finishInserting();
+	}
+}
+
+template< typename Item >
+static bool isInRange( int idx, const ListChange< Item > & change )
+{
+	return idx >= change.begin && idx < change.begin + change.removedCount;
+}
+
+void MainWindow::applyModifiedOptions( const ParsedOptionsFile & modifiedFile )
+{
+	if (modifiedFile.isKnownContent)
+		return;  // we have written it ourselves
+
+	if (!modifiedFile.error.isEmpty())
+	{
+		if (!fs::exists( modifiedFile.filePath ))
+			return;  // deleted or being replaced, the next save will create it again
+		reportRuntimeError( this, "Error reloading options", modifiedFile.error );
+		optionsCorrupted = true;  // don't overwrite it, give the author of the change a chance to fix it
+		return;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	OptionsFileDiff diff = diffOptions( getOptionsToSave(), optionsWriteCache, modifiedFile );
+
+	// The positions in the diff are in the full list, and the changed presets might not match the search anyway.
+	// But when only the engines or the IWADs have changed, the user's search result can stay.
+	if (presetModel.isFiltered() && (diff.othersChanged || !diff.presets.isEmpty()))
+		presetSearchPanel->collapse();
+
+	if (diff.othersChanged)
+	{
+		// The settings that the whole window depends on have changed, this path re-initializes everything.
+		QString selectedPreset = wdg::getSelectedItemID( ui->presetListView, presetModel );
+
+		if (!loadOptions( modifiedFile ))
+			return;
+
+		optionsWriteCache.invalidateFileLists();  // the cached parts belong to the previous content
+
+		// keep the current selection rather than the one stored by the other program
+		int selectedPresetIdx = presetModel.findIndexByID( selectedPreset );
+		if (selectedPresetIdx >= 0 && selectedPresetIdx != wdg::getSelectedItemIndex( ui->presetListView ))
+		{
+			wdg::selectAndSetCurrentByIndex( ui->presetListView, selectedPresetIdx );
+			wdg::scrollToItemAtIndex( ui->presetListView, selectedPresetIdx );
+		}
+
+		logInfo() << "options file modified externally, reloaded completely in " << timer.elapsed() << "ms";
+		return;
+	}
+
+	// engines
+	if (!diff.engines.isEmpty())
+	{
+		int currentEngineIdx = ui->engineCmbBox->currentIndex();
+		auto currentEngine = wdg::getCurrentItemID( ui->engineCmbBox, engineModel );
+		bool currentEngineChanged = isInRange( currentEngineIdx, diff.engines );
+		int changeBegin = diff.engines.begin;  // the diff is moved from below
+		int insertedCount = int( diff.engines.inserted.size() );
+
+		disableSelectionCallbacks = true;  // the current engine is handled below
+
+		applyListChange( engineModel, std::move( diff.engines ) );
+		for (int i = changeBegin; i < changeBegin + insertedCount; i++)
+		{
+			EngineInfo & engine = engineModel[i];
+			if (engine.getID() == engineSettings.defaultEngine)
+				engine.textColor = themes::getCurrentPalette().defaultEntryText;
+		}
+		fillDerivedEngineInfo( engineModel );  // only fills the new ones
+		optionsWriteCache.invalidateFileLists();
+
+		if (currentEngineChanged)
+			wdg::setCurrentItemByID( ui->engineCmbBox, engineModel, currentEngine );
+
+		disableSelectionCallbacks = false;
+
+		// its path stayed the same, but the config dir or something else might have changed
+		if (currentEngineChanged)
+			onEngineSelected( ui->engineCmbBox->currentIndex() );
+	}
+
+	// IWADs
+	if (!diff.iwads.isEmpty())
+	{
+		int selectedIWADIdx = wdg::getSelectedItemIndex( ui->iwadListView );
+		auto selectedIWAD = wdg::getSelectedItemID( ui->iwadListView, iwadModel );
+		bool selectedIWADChanged = isInRange( selectedIWADIdx, diff.iwads );
+		int changeBegin = diff.iwads.begin;  // the diff is moved from below
+		int insertedCount = int( diff.iwads.inserted.size() );
+
+		disableSelectionCallbacks = true;
+
+		applyListChange( iwadModel, std::move( diff.iwads ) );
+		for (int i = changeBegin; i < changeBegin + insertedCount; i++)
+		{
+			IWAD & iwad = iwadModel[i];
+			if (iwad.getID() == iwadSettings.defaultIWAD)
+				iwad.textColor = themes::getCurrentPalette().defaultEntryText;
+		}
+		optionsWriteCache.invalidateFileLists();
+
+		if (selectedIWADChanged)
+			wdg::selectItemByID( ui->iwadListView, iwadModel, selectedIWAD );
+
+		disableSelectionCallbacks = false;
+
+		if (selectedIWADChanged)
+			onIWADToggled( QItemSelection(), QItemSelection() );
+	}
+
+	// presets
+	if (!diff.presets.isEmpty())
+	{
+		int selectedPresetIdx = wdg::getSelectedItemIndex( ui->presetListView );
+		QString selectedPreset = wdg::getSelectedItemID( ui->presetListView, presetModel );
+		bool selectedPresetChanged = isInRange( selectedPresetIdx, diff.presets );
+
+		if (selectedPresetChanged)
+			wdg::deselectAllAndUnsetCurrent( ui->presetListView );  // this clears the widgets, the new content is restored below
+
+		for (int i = diff.presets.begin; i < diff.presets.begin + diff.presets.removedCount; i++)
+			presetContentIndex.markStale( presetModel[i].getID() );
+		for (const Preset & preset : diff.presets.inserted)
+			presetContentIndex.markStale( preset.getID() );
+
+		applyListChange( presetModel, std::move( diff.presets ) );
+
+		if (selectedPresetChanged)
+		{
+			// This invokes the callback, which calls restorePreset(...) with the new content
+			int newPresetIdx = presetModel.findIndexByID( selectedPreset );
+			if (newPresetIdx >= 0)
+				wdg::selectAndSetCurrentByIndex( ui->presetListView, newPresetIdx );
+		}
+	}
+
+	optionsCorrupted = false;
+
+	logInfo() << "options file modified externally, applied the differences in " << timer.elapsed() << "ms";
+}
+
 bool MainWindow::isCacheDirty() const
 {
-	return os::g_cachedExeInfo.isDirty();
-	//	|| doom::g_cachedWadInfo.isDirty();
+	return os::g_cachedExeInfo.isDirty()
+		|| doom::g_cachedWadHeaders.isDirty()
+		|| doom::g_cachedWadInfo.isDirty()
+		|| doom::g_cachedSaveInfo.isDirty()
+		|| doom::g_cachedDemoInfo.isDirty()
+		|| g_fileIconCache.isDirty();
+}
+
+void MainWindow::saveCache( const QString & filePath )
+{
+	// the caches are serialized here, but written in the background like the options
+
+	if (os::g_cachedExeInfo.isDirty() || doom::g_cachedWadHeaders.isDirty()
+	 || doom::g_cachedSaveInfo.isDirty() || doom::g_cachedDemoInfo.isDirty())
+	{
+		QJsonObject jsRoot;
+		jsRoot["exe_info"] = os::g_cachedExeInfo.serialize();
+		jsRoot[ doom::WadHeaderCacheKey ] = doom::g_cachedWadHeaders.serialize();
+		jsRoot["save_info"] = doom::g_cachedSaveInfo.serialize();
+		jsRoot["demo_info"] = doom::g_cachedDemoInfo.serialize();
+
+		fileWriter.writeFile( filePath, QJsonDocument( jsRoot ).toJson(), this, [ this ]( const QString & error )
+		{
+			// serialize() has marked them as saved, but they aren't
+			os::g_cachedExeInfo.markAsDirty();
+			doom::g_cachedWadHeaders.markAsDirty();
+			doom::g_cachedSaveInfo.markAsDirty();
+			doom::g_cachedDemoInfo.markAsDirty();
+			reportRuntimeError( this, "Error saving file-info cache", error );
+		});
+	}
+
+	// WAD parsing is faster than JSON parsing, but not faster than loading a flat binary file
+	if (doom::g_cachedWadInfo.isDirty())
+	{
+		// the writer logs the error, it's not worth bothering the user with it, just try again next time
+		fileWriter.writeFile( wadCacheFilePath, doom::serializeWadInfoCache(), this, []( const QString & )
+		{
+			doom::g_cachedWadInfo.markAsDirty();
+		});
+
+		// the newly read WADs are offered to the other installations, unless the previous attempt is still waiting for the lock
+		if (settings.shareFileCache && !sharedCacheTask.isRunning())
+		{
+			sharedCacheTask.addTask( [ dirPath = sharedCacheDir ]()
+			{
+				QString error = doom::appendToSharedWadInfoCache( dirPath );
+				if (!error.isEmpty())
+					logRuntimeError() << "Failed to share the WAD info cache: " << error;
+			});
+		}
+	}
+
+	// asking the OS for the icons is slow even for the ones it has cached, so the next start doesn't ask it at all
+	if (g_fileIconCache.isDirty())
+	{
+		fileWriter.writeFile( iconCacheFilePath, g_fileIconCache.serialize(), this, []( const QString & )
+		{
+			g_fileIconCache.markAsDirty();
+		});
+	}
 }
 
-bool MainWindow::saveCache( const QString & filePath )
+bool MainWindow::loadCache()
+{
+	bool success = true;
+	QElapsedTimer timer;
+
+	if (startupFiles.cacheExists)
+	{
+		timer.start();
+
+		if (!startupFiles.cacheError.isEmpty())
+		{
+			reportRuntimeError( this, "Error loading file-info cache", startupFiles.cacheError );
+			success = false;
+		}
+		else if (!startupFiles.cacheDoc.isNull())  // empty file is ignored
+		{
+			JsonDocumentCtx jsonDoc( cacheFilePath, startupFiles.cacheDoc );
+			const JsonObjectCtx & jsRoot = jsonDoc.rootObject();
+			if (JsonObjectCtx jsExeCache = jsRoot.getObject("exe_info"))
+				os::g_cachedExeInfo.deserialize( jsExeCache );
+			// an older key holds the results of older readers, it's dropped with the next save
+			if (JsonObjectCtx jsHeaderCache = jsRoot.getObject( doom::WadHeaderCacheKey, DontShowError ))
+				doom::g_cachedWadHeaders.deserialize( jsHeaderCache );
+			if (JsonObjectCtx jsSaveCache = jsRoot.getObject("save_info", DontShowError))
+				doom::g_cachedSaveInfo.deserialize( jsSaveCache );
+			if (JsonObjectCtx jsDemoCache = jsRoot.getObject("demo_info", DontShowError))
+				doom::g_cachedDemoInfo.deserialize( jsDemoCache );
+		}
+
+		logDebug() << "loading " << os::g_cachedExeInfo.size() << " entries of exe info from JSON took " << timer.elapsed() << "ms";
+	}
+
+	// the binary cache has already been loaded by the worker thread
+	if (!startupFiles.wadCacheError.isEmpty())
+	{
+		logRuntimeError() << "Failed to load the WAD info cache: " << startupFiles.wadCacheError;
+		success = false;
+	}
+	if (startupFiles.wadCacheExists)
+	{
+		logDebug() << "loaded " << doom::g_cachedWadInfo.size() << " entries of WAD info from binary";
+	}
+
+	if (startupFiles.iconCacheExists)
+	{
+		QString error = startupFiles.iconCacheError;
+		if (error.isEmpty())
+			error = g_fileIconCache.deserialize( startupFiles.iconCacheData );
+		if (!error.isEmpty())
+			logRuntimeError() << "Failed to load the file icon cache: " << error;  // the icons will be simply loaded again
+		startupFiles.iconCacheData.clear();
+	}
+
+	return success;
+}
+
+
+void MainWindow::syncSharedWadInfoCache()
+{
+	// Both the cache and the shared file are guarded against concurrent access, and nothing needs to be reported
+	// to the user, so it can be done entirely in the background. The WAD info read meanwhile will be appended on the next save.
+	sharedCacheTask.addTask( [ dirPath = sharedCacheDir ]()
+	{
+		ScopeTimer timer( "loading shared WAD info cache" );
+		QString error = doom::loadSharedWadInfoCache( dirPath );
+		if (!error.isEmpty())
+			logRuntimeError() << "Failed to load the shared WAD info cache: " << error;
+
+		// what this installation knows from before (e.g. when the sharing has just been enabled) is offered to the others
+		error = doom::appendToSharedWadInfoCache( dirPath );
+		if (!error.isEmpty())
+			logRuntimeError() << "Failed to share the WAD info cache: " << error;
+	});
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  snapshot of the directory-based lists
+
+// Reading the directories (and the IWAD headers) is what keeps the lists empty for a while after the startup.
+// So the last displayed content of the lists is stored on exit and displayed right away on the next start.
+// They are replaced by the results of the background scans started at the end of the startup,
+// so anything that has changed in the meantime is only visible for a moment.
+
+/// Adding or removing a file changes the modification time of its directory, that tells if the list is still up to date.
+/** The files in the subdirectories of a recursive list are not covered, those show up after the background scan. */
+static qint64 getDirLastModified( const QString & dir )
+{
+	QFileInfo dirInfo( dir );
+	return dirInfo.exists() ? dirInfo.lastModified().toMSecsSinceEpoch() : 0;
+}
+
+template< typename List, typename GetEntry >
+static QJsonObject serializeListSnapshot( const QStringVec & dirs, const List & list, const GetEntry & getEntry )
+{
+	QJsonArray jsDirs;
+	for (const QString & dir : dirs)
+	{
+		QJsonObject jsDir;
+		jsDir["path"] = dir;
+		jsDir["last_modified"] = getDirLastModified( dir );
+		jsDirs.append( jsDir );
+	}
+
+	QJsonArray jsEntries;
+	for (const auto & item : list)
+		jsEntries.append( getEntry( item ) );
+
+	QJsonObject jsList;
+	jsList["dirs"] = jsDirs;
+	jsList["entries"] = jsEntries;
+	return jsList;
+}
+
+void MainWindow::saveListSnapshot( const QString & filePath )
 {
 	QJsonObject jsRoot;
-	jsRoot["exe_info"] = os::g_cachedExeInfo.serialize();
-	//jsRoot["wad_info"] = doom::g_cachedWadInfo.serialize();  // not needed, WAD parsing is probably faster than JSON parsing
 
-	QJsonDocument jsonDoc( jsRoot );
-	return writeJsonToFile( jsonDoc, filePath, "file-info cache" );
+	if (iwadSettings.updateFromDir)
+		jsRoot["iwads"] = serializeListSnapshot( iwadSettings.getDirs(), iwadModel, []( const IWAD & iwad ) { return iwad.path; } );
+	jsRoot["configs"] = serializeListSnapshot( { getConfigDir() }, configModel, []( const ConfigFile & cfg ) { return cfg.fileName; } );
+	jsRoot["saves"] = serializeListSnapshot( { getSaveDir() }, saveModel, []( const SaveFile & save ) { return save.fileName; } );
+	jsRoot["demos"] = serializeListSnapshot( { getDemoDir() }, demoModel, []( const DemoFile & demo ) { return demo.fileName; } );
+
+	// it's just a cache, the writer logs the error, it's not worth bothering the user with it
+	fileWriter.writeFile( filePath, QJsonDocument( jsRoot ).toJson( QJsonDocument::Compact ) );
 }
 
-bool MainWindow::loadCache( const QString & filePath )
+void MainWindow::loadListSnapshot()
 {
-	JsonDocumentCtx jsonDoc = readJsonFromFile( filePath, "file-info cache", IgnoreEmpty );
-	if (!jsonDoc)
+	if (!startupFiles.listSnapshotError.isEmpty())
 	{
-		return false;
+		logRuntimeError() << "Failed to load the list snapshot: " << startupFiles.listSnapshotError;
+		return;
 	}
 
-	const JsonObjectCtx & jsRoot = jsonDoc.rootObject();
-	if (JsonObjectCtx jsExeCache = jsRoot.getObject("exe_info"))
-		os::g_cachedExeInfo.deserialize( jsExeCache );
-	//if (JsonObjectCtx jsWadCache = jsRoot.getObject("wad_info"))
-	//	doom::g_cachedWadInfo.deserialize( jsWadCache );  // not needed, WAD parsing is probably faster than JSON parsing
+	// Plain getters are used intentionally, a broken snapshot is not worth an error message, the lists will be read anyway.
+	const QJsonObject jsRoot = startupFiles.listSnapshotDoc.object();
+	for (auto iter = jsRoot.begin(); iter != jsRoot.end(); ++iter)
+	{
+		const QJsonObject jsList = iter.value().toObject();
 
-	return true;
+		ListSnapshot snapshot;
+		const QJsonArray jsDirs = jsList.value("dirs").toArray();
+		for (const QJsonValue & jsDirVal : jsDirs)
+		{
+			const QJsonObject jsDir = jsDirVal.toObject();
+			snapshot.dirs.append({ jsDir.value("path").toString(), qint64( jsDir.value("last_modified").toDouble() ) });
+		}
+		const QJsonArray jsEntries = jsList.value("entries").toArray();
+		snapshot.entries.reserve( jsEntries.size() );
+		for (const QJsonValue & jsEntry : jsEntries)
+			snapshot.entries.append( jsEntry.toString() );
+
+		if (!snapshot.dirs.isEmpty())  // older format without the modification times
+			listSnapshot.insert( iter.key(), std::move(snapshot) );
+	}
+}
+
+/// Returns the last known content of the list, if it was populated from the same directories, none of them has changed
+/// since, and startup is still in progress.
+/** Each snapshot can be taken only once, any subsequent update of the list must read the directory. */
+std::optional< QStringList > MainWindow::takeListSnapshot( const QString & listName, const QStringVec & dirs )
+{
+	auto iter = listSnapshot.find( listName );
+	if (iter == listSnapshot.end())
+		return std::nullopt;
+
+	ListSnapshot snapshot = std::move( iter.value() );
+	listSnapshot.erase( iter );
+
+	if (snapshot.dirs.size() != dirs.size())  // something was changed manually in the options file
+		return std::nullopt;
+	for (int i = 0; i < dirs.size(); ++i)
+	{
+		if (snapshot.dirs[i].first != dirs[i])  // something was changed manually in the options file
+			return std::nullopt;
+		if (snapshot.dirs[i].second != getDirLastModified( dirs[i] ))  // files were added or deleted while we were not running
+			return std::nullopt;
+	}
+
+	return std::move( snapshot.entries );
+}
+
+template< typename Item >
+QList< Item > MainWindow::makeItemsFromSnapshot( const QStringList & entries )
+{
+	QList< Item > items;
+	items.reserve( entries.size() );
+	for (const QString & entry : entries)
+		items.append( Item( QFileInfo( entry ) ) );  // QFileInfo doesn't touch the file system until it's asked something
+	return items;
+}
+
+/// Same as wdg::readItemsFromDir(), but from a listing that has already been made.
+template< typename Item >
+QList< Item > MainWindow::makeItemsFromFiles( const QStringList & filePaths, const QStringVec & fileSuffixes ) const
+{
+	QList< Item > items;
+	for (const QString & filePath : filePaths)
+		if (fs::hasOneOfSuffixes( filePath, fileSuffixes ))
+			items.append( Item( QFileInfo( pathConvertor.convertPath( filePath ) ) ) );
+	return items;
 }
 
 
@@ -3228,7 +4747,7 @@ void MainWindow::restoreLoadedOptions( OptionsToLoad && opts )
 		disableSelectionCallbacks = false;
 
 		// mark the default engine, if chosen
-		int defaultIdx = findSuch( engineModel, [&]( const Engine & e ){ return e.getID() == engineSettings.defaultEngine; } );
+		int defaultIdx = engineModel.findIndexByID( engineSettings.defaultEngine );
 		if (defaultIdx >= 0)
 		{
 			engineModel[ defaultIdx ].textColor = themes::getCurrentPalette().defaultEntryText;
@@ -3256,7 +4775,7 @@ void MainWindow::restoreLoadedOptions( OptionsToLoad && opts )
 		}
 
 		// mark the default IWAD, if chosen
-		int defaultIdx = findSuch( iwadModel, [&]( const IWAD & i ){ return i.getID() == iwadSettings.defaultIWAD; } );
+		int defaultIdx = iwadModel.findIndexByID( iwadSettings.defaultIWAD );
 		if (defaultIdx >= 0)
 		{
 			iwadModel[ defaultIdx ].textColor = themes::getCurrentPalette().defaultEntryText;
@@ -3272,7 +4791,7 @@ void MainWindow::restoreLoadedOptions( OptionsToLoad && opts )
 	{
 		wdg::deselectAllAndUnsetCurrent( ui->mapDirView );
 
-		resetMapDirModelAndView();  // populates the list from mapSettings.dir (asynchronously)
+		resetMapDirModelAndView();  // populates the tree from the map directories (asynchronously)
 	}
 
 	// mods
@@ -3294,6 +4813,7 @@ void MainWindow::restoreLoadedOptions( OptionsToLoad && opts )
 		presetModel.startCompleteUpdate();
 		presetModel.assignList( std::move(opts.presets) );
 		presetModel.finishCompleteUpdate();
+		presetContentIndex.markAllStale();
 	}
 
 	// make sure all paths loaded from JSON are stored in correct format
@@ -3351,7 +4871,121 @@ void MainWindow::restoreLoadedOptions( OptionsToLoad && opts )
 	updateLaunchCommand();
 }
 
+void MainWindow::ensurePresetLoaded( Preset & preset )
+{
+	// Only the names of the presets are loaded at startup, the rest is deserialized when it's needed for the first time.
+	loadPresetContent( preset, settings, mapSettings, optionsFilePath );
+}
+
+void MainWindow::loadAllPresets()
+{
+	for (Preset & preset : presetModel.fullList())
+		ensurePresetLoaded( preset );
+}
+
 void MainWindow::restorePreset( int presetIdx )
+{
+	QElapsedTimer switchTimer;
+	switchTimer.start();
+
+	{
+		// Each of the restore steps changes something that the config list, the map list or the launch command
+		// depend on, so the updates are collected and run only once, when the next step needs them or at the end.
+		UpdateBatch updateBatch( this );
+
+		restorePresetContent( presetIdx );
+	}
+
+	diag::g_stats.presetSwitches.increment();
+	diag::g_stats.lastPresetSwitchMs.set( switchTimer.elapsed() );
+
+	prewarmSelectedFiles();
+	getLaunchEnvironment();  // prepare it now, so that the launch doesn't have to
+	prefetchSaveDirs( presetIdx );
+}
+
+/// Returns the save directory the preset would have when selected, the same way as getSaveDir() does for the current one.
+QString MainWindow::getPresetSaveDir( const Preset & preset ) const
+{
+	int engineIdx = engineModel.findIndexByID( preset.selectedEnginePath );
+	if (engineIdx < 0)
+		return {};  // setAlternativeDirs() doesn't set anything without an engine either
+	const QString & dataDir = engineModel[ engineIdx ].dataDir;
+
+	QString saveDirLine = globalOpts.usePresetNameAsDir ? fs::sanitizePath( preset.name ) : preset.altPaths.saveDir;
+	if (saveDirLine.isEmpty())
+		return dataDir;
+
+	PathRebaser rebaser = engineDataDirRebaser;  // the same output style as the current one
+	rebaser.setOutputBaseDir( dataDir );
+	return rebaser.rebasePathBack( saveDirLine );
+}
+
+/// Lists the save directories of the neighbouring and the recently used presets in the background,
+/// so that switching to them fills the save and demo lists from memory instead of listing a new directory.
+void MainWindow::prefetchSaveDirs( int presetIdx )
+{
+	constexpr int neighbourCount = 2;   // on each side, the user usually moves through the list with arrow keys
+	constexpr int recentCount = 4;
+
+	if (presetIdx < 0 || presetIdx >= presetModel.size())
+		return;
+
+	const QString presetID = presetModel[ presetIdx ].getID();
+	recentPresetIDs.removeOne( presetID );
+	recentPresetIDs.prepend( presetID );
+	if (recentPresetIDs.size() > recentCount)
+		recentPresetIDs.resize( recentCount );
+
+	if (saveDirPrefetchTask.isRunning())
+		return;  // probably a slow disk, don't pile up more work, the next switch will try again
+
+	QVector< int > candidateIdxs;
+	for (int i = presetIdx - neighbourCount; i <= presetIdx + neighbourCount; ++i)
+		if (i != presetIdx && i >= 0 && i < presetModel.size())
+			candidateIdxs.append( i );
+	for (const QString & recentID : recentPresetIDs)
+		if (int recentIdx = presetModel.findIndexByID( recentID ); recentIdx >= 0 && recentIdx != presetIdx)
+			candidateIdxs.append( recentIdx );
+
+	const QString currentSaveDir = getSaveDir();
+	QStringVec dirsToList;
+	for (int idx : candidateIdxs)
+	{
+		const Preset & preset = presetModel[ idx ];
+		if (preset.isSeparator)
+			continue;
+		// Deserializing it only to guess where the user might go would undo the point of loading the presets lazily.
+		// The neighbours the user has already visited are loaded, and that's where they most likely return.
+		if (!preset.isLoaded())
+			continue;
+
+		QString saveDir = getPresetSaveDir( preset );
+		if (saveDir.isEmpty() || saveDir == currentSaveDir || dirsToList.contains( saveDir ))
+			continue;
+		if (dirProber.peekState( saveDir ) == DirProber::State::Unresponsive)
+			continue;  // would only block a worker thread
+		dirsToList.append( std::move(saveDir) );
+	}
+	if (dirsToList.isEmpty())
+		return;
+
+	// the listings end up in g_cachedDirSnapshots, which is thread-safe
+	saveDirPrefetchTask.addTask( [ dirsToList ]()
+	{
+		for (const QString & dir : dirsToList)
+			fs::g_cachedDirSnapshots.getFiles( dir, /*recursively*/false );
+	});
+	saveDirPrefetchTask.whenAllDone( this, [ this, dirsToList ]()
+	{
+		prefetchedSaveDirs.clear();
+		for (const QString & dir : dirsToList)
+			prefetchedSaveDirs.insert( dir );
+		prefetchedDemoDirs = prefetchedSaveDirs;
+	});
+}
+
+void MainWindow::restorePresetContent( int presetIdx )
 {
 	// Restoring any stored options is tricky.
 	// Every change of a selection, like  cmbBox->setCurrentIndex( stored.idx )  or  selectItemByIdx( stored.idx )
@@ -3364,17 +4998,21 @@ void MainWindow::restorePreset( int presetIdx )
 	restoringPresetInProgress = true;
 
 	Preset & preset = presetModel[ presetIdx ];
+	ensurePresetLoaded( preset );
 
 	restoreSelectedEngine( preset );
+	runDeferredUpdates( ConfigListUpdate );  // the configs of the new engine must be listed before one can be selected
 	restoreSelectedConfig( preset );
 	restoreSelectedIWAD( preset );
 	restoreSelectedMods( preset );
 
-	// Beware that when calling this from restoreLoadedOptions, the mapModel might not have been populated yet,
-	// because it's done asynchronously in a separate thread. In that case this needs to be called again
-	// in a callback connected to QFileSystem event, when the mapModel is finally populated.
+	// When calling this from restoreLoadedOptions, the mapModel has not been populated yet, because it's done
+	// asynchronously in a separate thread. In that case the selection is restored when the needed directories are loaded.
 	restoreSelectedMapPacks( preset );
 
+	// the launch options select from the map, save and demo lists, and the compat options from the compat levels
+	runDeferredUpdates( AllUpdates & ~(MapDescUpdate | LaunchCommandUpdate) );
+
 	if (settings.launchOptsStorage == StoreToPreset)
 		restoreLaunchAndMultOptions( preset.launchOpts, preset.multOpts );  // this clears items that are invalid
 
@@ -3419,7 +5057,7 @@ void MainWindow::restoreSelectedEngine( Preset & preset )
 	if (!preset.selectedEnginePath.isEmpty())  // the engine combo box might have been empty when creating this preset
 	{
 		int engineIdx = findSuch( engineModel, [&]( const Engine & engine )
-												   { return engine.executablePath == preset.selectedEnginePath; } );
+												   { return isSameString( engine.executablePath, preset.selectedEnginePath ); } );
 		if (engineIdx >= 0)
 		{
 			ui->engineCmbBox->setCurrentIndex( engineIdx );
@@ -3441,6 +5079,7 @@ void MainWindow::restoreSelectedEngine( Preset & preset )
 			);
 			preset.selectedEnginePath.clear();
 			preset.compatOpts.compatLevel = -1;  // compat level is engine-specific so the previous level is no longer valid
+			preset.markModified();
 		}
 	}
 
@@ -3480,6 +5119,7 @@ void MainWindow::restoreSelectedConfig( Preset & preset )
 				"Please select another one."
 			);
 			preset.selectedConfig.clear();
+			preset.markModified();
 		}
 	}
 
@@ -3502,7 +5142,7 @@ void MainWindow::restoreSelectedIWAD( Preset & preset )
 
 	if (!preset.selectedIWAD.isEmpty())  // the IWAD may have not been selected when creating this preset
 	{
-		int iwadIdx = findSuch( iwadModel, [&]( const IWAD & iwad ) { return iwad.path == preset.selectedIWAD; } );
+		int iwadIdx = findSuch( iwadModel, [&]( const IWAD & iwad ) { return isSameString( iwad.path, preset.selectedIWAD ); } );
 		if (iwadIdx >= 0)
 		{
 			wdg::selectAndSetCurrentByIndex( ui->iwadListView, iwadIdx );
@@ -3524,6 +5164,7 @@ void MainWindow::restoreSelectedIWAD( Preset & preset )
 				"Please select another one."
 			);
 			preset.selectedIWAD.clear();
+			preset.markModified();
 		}
 	}
 
@@ -3540,19 +5181,32 @@ void MainWindow::restoreSelectedIWAD( Preset & preset )
 
 void MainWindow::restoreSelectedMapPacks( Preset & preset )
 {
+	// Without the directories being listed, the map packs would be reported as missing, so wait until they are.
+	bool loaded = mapModel.ensurePathsLoaded( preset.selectedMapPacks, this, [ this ]()
+	{
+		if (Preset * selectedPreset = getSelectedPreset())  // the user might have selected a different one in the meantime
+			restoreSelectedMapPacks( *selectedPreset );
+	});
+	if (!loaded)
+	{
+		// don't leave there the map packs of the previous preset, but don't store the empty selection to this one
+		disableSelectionCallbacks = true;
+		wdg::deselectAllAndUnsetCurrent( ui->mapDirView );
+		disableSelectionCallbacks = false;
+		return;
+	}
+
 	auto origSelection = ui->mapDirView->selectionModel()->selection();
 	disableSelectionCallbacks = true;  // prevent unnecessary widget updates, they will be done in the end in a single step
 
-	QDir mapRootDir = mapModel.rootDirectory();
-
 	wdg::deselectAllAndUnsetCurrent( ui->mapDirView );
 
 	const QStringVec mapPacksCopy = preset.selectedMapPacks;
 	preset.selectedMapPacks.clear();  // clear the list in the preset and let it repopulate only with valid items
 	for (const QString & path : mapPacksCopy)
 	{
-		QModelIndex mapIdx = mapModel.index( path );
-		if (mapIdx.isValid() && fs::isInsideDir( path, mapRootDir ))
+		QModelIndex mapIdx = mapModel.index( path );  // invalid if it's outside of the map directories
+		if (mapIdx.isValid())
 		{
 			if (fs::isValidEntry( path ))
 			{
@@ -3570,11 +5224,14 @@ void MainWindow::restoreSelectedMapPacks( Preset & preset )
 		else
 		{
 			reportUserError( this, "Map file no longer exists",
-				"Map file selected for this preset ("%path%") couldn't be found in the map directory ("%mapRootDir.path()%")."
+				"Map file selected for this preset ("%path%") couldn't be found in the map directories ("%mapSettings.getDirs().join(',')%")."
 			);
 		}
 	}
 
+	if (preset.selectedMapPacks != mapPacksCopy)  // some were dropped
+		preset.markModified();
+
 	disableSelectionCallbacks = false;
 	auto newSelection = ui->mapDirView->selectionModel()->selection();
 
@@ -3591,6 +5248,7 @@ void MainWindow::restoreSelectedMods( Preset & preset )
 
 	modModel.startCompleteUpdate();
 	modModel.clear();
+	modModel.list().reserve( preset.mods.size() );
 	for (Mod & mod : preset.mods)
 	{
 		modModel.append( mod );
@@ -3780,26 +5438,12 @@ void MainWindow::exportPresetToScript()
 
 	lastUsedDir = std::move(scriptDir);
 
-	QFile scriptFile( scriptFilePath );
-	if (!scriptFile.open( QIODevice::WriteOnly | QIODevice::Text ))
-	{
-		reportRuntimeError( this, "Cannot open file", "Cannot open file for writing ("%scriptFile.errorString()%")" );
-		return;
-	}
-
-	QTextStream stream( &scriptFile );
-
-	// make sure the working directory is set to the script file's directory
- #if IS_WINDOWS
-	stream << "cd \"%~dp0\"\n";
- #else
-	stream << "#!/bin/bash\n\n";
-	stream << "cd $(dirname $(readlink -f \"$0\"))\n";
- #endif
-
-	stream << cmd.executable << " " << cmd.arguments.join(' ') << '\n';
-
-	scriptFile.close();
+	QString error = writeLaunchScript( scriptFilePath, cmd );
+	if (!error.isEmpty())
+	{
+		reportRuntimeError( this, "Cannot write file", error );
+		return;
+	}
 }
 
 void MainWindow::exportPresetToShortcut()
@@ -3854,6 +5498,95 @@ void MainWindow::exportPresetToShortcut()
  #endif
 }
 
+void MainWindow::exportAllPresetsToScripts()
+{
+	exportAllPresets( ExportTarget::Script );
+}
+
+void MainWindow::exportAllPresetsToShortcuts()
+{
+ #if IS_WINDOWS
+	exportAllPresets( ExportTarget::Shortcut );
+ #else
+	reportUserError( this, "Not supported", "This feature only works on Windows." );
+ #endif
+}
+
+/// Exports every preset into its own file in a chosen directory, in the background, then shows a single summary.
+void MainWindow::exportAllPresets( ExportTarget target )
+{
+	if (presetExportTask.isRunning())
+	{
+		reportUserError( this, "Export in progress", "The previous export is still running, wait until it's finished." );
+		return;
+	}
+
+	QString outputDir = OwnFileDialog::getExistingDirectory( this, "Export all presets", lastUsedDir );
+	if (outputDir.isEmpty())  // user probably clicked cancel
+	{
+		return;
+	}
+	lastUsedDir = outputDir;
+
+	// The export runs in worker threads, so it gets its own copy of everything. The copies are cheap,
+	// the Qt containers are implicitly shared, but the presets have to be loaded and the engines completed here.
+	auto snapshot = std::make_shared< PresetExportSnapshot >();
+	snapshot->presets.reserve( presetModel.size() );
+	for (Preset & preset : presetModel)
+	{
+		ensurePresetLoaded( preset );
+		snapshot->presets.append( preset );
+	}
+	snapshot->engines.reserve( engineModel.size() );
+	for (EngineInfo & engine : engineModel)
+	{
+		completeEngineVersionInfo( engine );
+		snapshot->engines.append( engine );
+	}
+	snapshot->opts = { launchOpts, multOpts, gameOpts, compatOpts, videoOpts, audioOpts, globalOpts, settings, mapSettings.getDirs(), modSettings.dir };
+	snapshot->launcherWorkingDir = pathConvertor.workingDir();
+	snapshot->pathStyle = pathConvertor.pathStyle();
+
+ #if IS_WINDOWS
+	const QString & fileFilter = target == ExportTarget::Shortcut ? shortcutFileSuffix : scriptFileSuffix;
+ #else
+	const QString & fileFilter = scriptFileSuffix;
+ #endif
+	QString fileSuffix = fileFilter.mid(2);  // without the "*."
+
+	presetExportTask.addTask( [ this, snapshot, target, outputDir, fileSuffix ]()
+	{
+		presetExportResults = exportPresets( *snapshot, target, outputDir, fileSuffix );
+	});
+	presetExportTask.whenAllDone( this, [ this, outputDir ]()
+	{
+		QVector< PresetExportResult > results = std::move( presetExportResults );
+
+		QStringVec failures;
+		for (const PresetExportResult & result : results)
+			if (!result.error.isEmpty())
+				failures.append( result.presetName % ": " % result.error );
+
+		int exportedCount = int( results.size() ) - int( failures.size() );
+		QString summary = QString::number( exportedCount ) % " of " % QString::number( results.size() )
+		                % " presets were exported to " % outputDir % ".";
+		if (failures.isEmpty())
+		{
+			reportInformation( this, "Export finished", summary );
+			return;
+		}
+
+		// there can be hundreds of failures when the output directory is not writable, so list them only in the details
+		QMessageBox messageBox( QMessageBox::Warning, "Export finished with errors",
+			summary % "\n" % QString::number( failures.size() ) % " presets failed to export, see the details.",
+			QMessageBox::Ok,
+			this
+		);
+		messageBox.setDetailedText( failures.join('\n') );
+		messageBox.exec();
+	});
+}
+
 void MainWindow::importPresetFromScript()
 {
 	reportUserError( this, "Not implemented", "Sorry, this feature is not implemented yet." );
@@ -3863,14 +5596,121 @@ void MainWindow::importPresetFromScript()
 //----------------------------------------------------------------------------------------------------------------------
 //  launch command generation
 
+void MainWindow::prewarmSelectedFiles()
+{
+	if (!settings.prewarmFiles)
+		return;
+
+	QStringVec filePaths;
+
+	if (const IWAD * selectedIWAD = getSelectedIWAD())
+		filePaths.append( pathConvertor.getAbsolutePath( selectedIWAD->path ) );
+
+	for (const Mod & mod : modModel)
+		if (mod.checked && !mod.isCmdArg)
+			filePaths.append( pathConvertor.getAbsolutePath( mod.path ) );
+
+	// Checking the paths here would defeat the purpose on a slow drive, the prewarmer skips what it cannot open,
+	// including the directories that can be loaded as mods too.
+
+	filePrewarmer.prewarmFiles( std::move(filePaths) );
+}
+
+void MainWindow::updateModConflicts()
+{
+	QStringVec loadOrder;
+	for (const Mod & mod : modModel)
+		if (mod.checked && !mod.isCmdArg && !mod.isSeparator && !mod.path.isEmpty())
+			loadOrder.append( mod.path );
+
+	if (loadOrder == modConflictsLoadOrder)
+	{
+		// the list might have been re-populated with the same mods, for example by switching to a similar preset,
+		// the new items need the marks, but the view is notified only if some of them actually changed
+		annotateModConflicts();
+		return;
+	}
+	modConflictsLoadOrder = loadOrder;
+
+	modConflictAnalyzer.analyze( loadOrder, this, [ this ]( const doom::ModConflictAnalyzer::Conflicts & conflicts )
+	{
+		modConflicts = conflicts;
+		annotateModConflicts();
+	});
+}
+
+void MainWindow::annotateModConflicts()
+{
+	if (modModel.isEmpty())
+		return;
+
+	// the list is re-annotated after each change of it, most of the time nothing changes and nothing needs repainting
+	bool changed = false;
+	for (const Mod & mod : modModel)
+	{
+		auto conflictsIter = modConflicts.find( mod.path );
+		if (mod.checked && !mod.isCmdArg && !mod.isSeparator && conflictsIter != modConflicts.end())
+			changed |= markItemAsConflicting( mod, doom::ModConflictAnalyzer::describeConflicts( *conflictsIter ) );
+		else
+			changed |= unmarkItemAsConflicting( mod );
+	}
+
+	if (changed)
+		modModel.annotationsChanged( 0 );
+}
+
+void MainWindow::requestUpdates( uint updates )
+{
+	deferredUpdates |= updates;
+	if (updateBatchDepth == 0)
+		runDeferredUpdates( updates );
+}
+
+void MainWindow::runDeferredUpdates( uint updates )
+{
+	// take the flags out first, the updates can request other updates
+	auto takeUpdate = [ this, updates ]( DeferredUpdate update )
+	{
+		if ((updates & update) == 0)
+			return false;
+		bool isPending = (deferredUpdates & update) != 0;
+		deferredUpdates &= ~uint( update );
+		return isPending;
+	};
+
+	if (takeUpdate( ConfigListUpdate ))
+		updateConfigFilesFromDir();
+	if (takeUpdate( SaveListUpdate ))
+		updateSaveFilesFromDir();
+	if (takeUpdate( DemoListUpdate ))
+		updateDemoFilesFromDir();
+	if (takeUpdate( CompatLevelsUpdate ))
+		updateCompatLevels();
+	if (takeUpdate( MapListUpdate ))
+		updateMapsFromSelectedWADs();
+	if (takeUpdate( MapDescUpdate ))
+		updateMapDescPreview();
+	if (takeUpdate( LaunchCommandUpdate ))
+		updateLaunchCommand();
+}
+
 void MainWindow::updateLaunchCommand()
 {
+	// optimization: when a batch of changes is being applied, regenerate the command only once at the end
+	if (updateBatchDepth > 0)
+	{
+		deferredUpdates |= LaunchCommandUpdate;
+		return;
+	}
+
 	// optimization: don't regenerate the command when we're about to make more changes right away
 	if (restoringOptionsInProgress || restoringPresetInProgress)
 		return;
 
-	//static uint callCnt = 1;
-	//logDebug() << "updateLaunchCommand() " << callCnt++;
+	// every change of the mod list ends up here
+	updateModConflicts();
+
+	diag::g_stats.launchCommandUpdates.increment();
 
 	const EngineInfo * selectedEngine = getSelectedEngine();
 	if (!selectedEngine)
@@ -3889,7 +5729,7 @@ void MainWindow::updateLaunchCommand()
 	// because the engine will be executed with the working directory set to engine's directory.
 	// The relative path of the executable does not matter, because here it is for displaying only.
 	auto cmd = generateLaunchCommand(
-		engineDir, cmdPathStyle, engineDir, cmdPathStyle, QuotePaths, DontVerifyPaths
+		engineDir, cmdPathStyle, engineDir, cmdPathStyle, QuotePaths, DontVerifyPaths, &launchCmdCache
 	);
 
 	QString newCommand = cmd.executable % ' ' % cmd.arguments.join(' ');
@@ -3904,293 +5744,133 @@ void MainWindow::updateLaunchCommand()
 	}
 }
 
-/// Generates a command to be run, displayed or saved to a script file, according to the specified options.
-/**
-  * \param parentWorkingDir Working directory when the command is executed by the parent process.
-  *                         This will determine the relative path of the engine executable in the command.
-  * \param engineWorkingDir Working directory for the engine process that will be started.
-  *                         This will determine the relative paths of the file or directory arguments passed to the engine.
-  * \param enginePathStyle Path style to be used for the engine executable.
-  * \param argPathStyle Path style to be used for the paths in the command line arguments.
-  * \param quotePaths Surround each path in the command with quotes.
-  *                   Required for displaying the command or saving it to a script file.
-  * \param verifyPaths Verify that each path in the command is valid and leads to the correct entry type (file or directory).
-  *                    If invalid path is found, display a message box with an error description.
-  */
-os::ShellCommand MainWindow::generateLaunchCommand(
-	const QString & parentWorkingDir, PathStyle enginePathStyle, const QString & engineWorkingDir, PathStyle argPathStyle,
-	bool quotePaths, bool verifyPaths
-){
-	os::ShellCommand cmd;
-
-	// The stored engine path is relative to DoomRunner's directory, but we need it relative to parentWorkingDir.
-	PathRebaser parentDirRebaser( pathConvertor.workingDir(), parentWorkingDir, enginePathStyle, quotePaths );
-	// All stored paths are relative to DoomRunner's directory, but we need them relative to engineWorkingDir.
-	PathRebaser engineDirRebaser( pathConvertor.workingDir(), engineWorkingDir, argPathStyle, quotePaths );
-
-	PathChecker p( this, verifyPaths );
-
-	//-- engine --------------------------------------------------------------------
-
-	const EngineInfo * selectedEngine = getSelectedEngine();
-	if (!selectedEngine)
-	{
-		return {};  // no point in generating a command if we don't even know the engine, it determines everything
-	}
+/// Collects everything the launch command is generated from, as it's currently displayed in the widgets.
+LaunchCommandInput MainWindow::getLaunchCommandInput()
+{
+	LaunchCommandInput input;
 
-	const EngineInfo & engine = *selectedEngine;  // non-const so that we can change color of invalid paths
+	//-- files ---------------------------------------------------------------------
 
+	input.engine = getSelectedEngine();
+	if (!input.engine)
 	{
-		p.checkItemFilePath( engine, "the selected engine", "Please update its path in Menu -> Initial Setup, or select another one." );
-
-		// get the beginning of the launch command based on OS and installation type
-		cmd = os::getRunCommand( engine.executablePath, parentDirRebaser, getDirsToBeAccessed() );
+		return input;  // without the engine nothing else matters
 	}
 
-	//-- engine's config -----------------------------------------------------------
-
 	if (const ConfigFile * selectedConfig = getSelectedConfig())
 	{
 		// at this point the configDir cannot be empty, otherwise the configCmbBox would be empty and there would not be any selected config
-		QString configPath = fs::getPathFromFileName( engine.configDir, selectedConfig->fileName );
-
-		p.checkFilePath( configPath, "the selected config", "Please update the config dir in Menu -> Initial Setup, or select another one." );
-		cmd.arguments << "-config" << engineDirRebaser.rebaseAndQuotePath( configPath );
-	}
-
-	//-- game data files -----------------------------------------------------------
-
-	// IWAD
-	if (const IWAD * selectedIWAD = getSelectedIWAD())
-	{
-		p.checkItemFilePath( *selectedIWAD, "selected IWAD", "Please select another one." );
-		cmd.arguments << "-iwad" << engineDirRebaser.rebaseAndQuotePath( selectedIWAD->path );
-	}
-
-	// This part is tricky.
-	// Older engines only accept single -file parameter, so all the regular map/mod files must be listed together.
-	// But the user is allowed to intersperse the regular files with deh/bex files or custom cmd arguments.
-	// So we must somehow build an ordered sequence of mod files and custom arguments in which all the regular files are
-	// grouped together, and the easiest option seems to be by using a placeholder item.
-
-	QStringVec modArguments;
-	QStringVec fileList;
-
-	auto addFileAccordingToSuffix = [&]( const QString & filePath )
-	{
-		QString suffix = QFileInfo( filePath ).suffix().toLower();
-		if (suffix == "deh") {
-			modArguments << "-deh" << engineDirRebaser.rebaseAndQuotePath( filePath );
-		} else if (suffix == "bex") {
-			modArguments << "-bex" << engineDirRebaser.rebaseAndQuotePath( filePath );
-		} else {
-			if (fileList.isEmpty())
-				modArguments << "-file" << "<file_list>";  // insert placeholder where all the files will be together
-			fileList.append( engineDirRebaser.rebaseAndQuotePath( filePath ) );
-		}
-	};
-
-	auto appendCustomArguments = [&]( QStringVec & args, const QString & customArgsStr )
-	{
-		auto splitArgs = splitCommandLineArguments( customArgsStr );
-		for (const auto & arg : splitArgs)
-		{
-			if (quotePaths && arg.wasQuoted)
-				args << quoted( arg.str );
-			else
-				args << arg.str;
-		}
-	};
-
-	// map files
-	forEachSelectedMapPack( [&]( const QString & mapFilePath )
-	{
-		p.checkAnyPath( mapFilePath, "the selected map pack", "Please select another one." );
-		addFileAccordingToSuffix( mapFilePath );
-	});
-
-	// mod files
-	for (const Mod & mod : modModel)
-	{
-		if (!mod.isSeparator && mod.checked)
-		{
-			if (mod.isCmdArg) {  // this is not a file but a custom command line argument
-				appendCustomArguments( modArguments, mod.fileName );  // the fileName holds the argument value
-			} else {
-				p.checkItemAnyPath( mod, "the selected mod", "Please update the mod list." );
-				addFileAccordingToSuffix( mod.path );
-			}
-		}
+		input.configPath = fs::getPathFromFileName( input.engine->configDir, selectedConfig->fileName );
 	}
 
-	// output the final sequence to the cmd.arguments
-	for (QString & modArgument : modArguments)
-	{
-		if (modArgument == "<file_list>") {
-			// replace the placeholder with the actual list
-			for (QString & filePath : fileList)
-				cmd.arguments << std::move(filePath);
-		} else {
-			cmd.arguments << std::move(modArgument);
-		}
-	}
+	input.iwad = getSelectedIWAD();
+	input.mapPackPaths = getSelectedMapPacks();
+	input.mods = &modModel.list();
+	input.mapDirs = mapSettings.getDirs();
+	input.modDir = modSettings.dir;
 
 	//-- alternative directories ---------------------------------------------------
-	// Rather set them before the launch parameters, because some of the parameters
-	// (e.g. -loadgame) can be relative to these alternative directories.
 
-	if (!ui->saveDirLine->text().isEmpty())
-	{
-		QString saveDirPath = getSaveDir();
-		p.checkNotAFile( saveDirPath, "the save dir", {} );
-		cmd.arguments << engine.saveDirParam() << engineDirRebaser.rebaseAndQuotePath( saveDirPath );
-	}
+	input.saveDir = getSaveDir();
+	input.isCustomSaveDir = !ui->saveDirLine->text().isEmpty();
 	if (!ui->screenshotDirLine->text().isEmpty())
-	{
-		QString screenshotDirPath = getScreenshotDir();
-		p.checkNotAFile( screenshotDirPath, "the screenshot dir", {} );
-		cmd.arguments << "+screenshot_dir" << engineDirRebaser.rebaseAndQuotePath( screenshotDirPath );
-	}
+		input.screenshotDir = getScreenshotDir();
 
 	//-- launch mode and parameters ------------------------------------------------
-	// Beware that while -record and -playdemo are either absolute or relative to the current working dir
-	// -loadgame might need to be relative to -savedir, depending on the engine and its version
 
-	LaunchMode launchMode = getLaunchModeFromUI();
-	if (launchMode == LaunchMap)
-	{
-		cmd.arguments << engine.getMapArgs( ui->mapCmbBox->currentIndex(), ui->mapCmbBox->currentText() );
-	}
-	else if (launchMode == LoadSave && !ui->saveFileCmbBox->currentText().isEmpty())
-	{
-		QString saveDir = getSaveDir();  // save dir cannot be empty, otherwise the saveFileCmbBox would be empty
-		QString trueSavePath = fs::getPathFromFileName( saveDir, ui->saveFileCmbBox->currentText() );
-		p.checkFilePath( trueSavePath, "the selected save file", "Please select another one." );
-		cmd.arguments << "-loadgame" << rebaseSaveFilePath( trueSavePath, engineDirRebaser, &engine );
-	}
-	else if (launchMode == RecordDemo && !ui->demoFileLine_record->text().isEmpty())
-	{
-		QString demoDir = getDemoDir();  // if demo dir is empty (saveDirLine is empty and engine.configDir is not set), then
-		QString demoPath = fs::getPathFromFileName( demoDir, ui->demoFileLine_record->text() );  // the demoFileLine will be used as is
-		cmd.arguments << "-record" << engineDirRebaser.rebaseAndQuotePath( demoPath );
-		cmd.arguments << engine.getMapArgs( ui->mapCmbBox_demo->currentIndex(), ui->mapCmbBox_demo->currentText() );
-	}
-	else if (launchMode == ReplayDemo && !ui->demoFileCmbBox_replay->currentText().isEmpty())
-	{
-		QString demoDir = getDemoDir();  // demo dir cannot be empty, otherwise the demoFileCmbBox_replay would be empty
-		QString demoPath = fs::getPathFromFileName( demoDir, ui->demoFileCmbBox_replay->currentText() );
-		p.checkFilePath( demoPath, "the selected demo", "Please select another one." );
-		cmd.arguments << "-playdemo" << engineDirRebaser.rebaseAndQuotePath( demoPath );
-	}
+	input.launchMode = getLaunchModeFromUI();
+	input.mapIdx = ui->mapCmbBox->currentIndex();
+	input.mapName = ui->mapCmbBox->currentText();
+	int saveIdx = ui->saveFileCmbBox->currentIndex();
+	input.saveFileName = saveIdx >= 0 ? saveModel[ saveIdx ].fileName : QString();  // the displayed text contains the title
+	input.mapIdx_demo = ui->mapCmbBox_demo->currentIndex();
+	input.mapName_demo = ui->mapCmbBox_demo->currentText();
+	input.demoFileName_record = ui->demoFileLine_record->text();
+	int demoIdx = ui->demoFileCmbBox_replay->currentIndex();
+	input.demoFileName_replay = demoIdx >= 0 ? demoModel[ demoIdx ].fileName : QString();  // the displayed text contains the details
 
 	//-- gameplay and compatibility options ----------------------------------------
 
-	const GameplayOptions & activeGameOpts = activeGameplayOptions();
-	if (ui->skillCmbBox->isEnabled())
-		cmd.arguments << "-skill" << ui->skillSpinBox->text();
-	if (ui->noMonstersChkBox->isEnabled() && ui->noMonstersChkBox->isChecked())
-		cmd.arguments << "-nomonsters";
-	if (ui->fastMonstersChkBox->isEnabled() && ui->fastMonstersChkBox->isChecked())
-		cmd.arguments << "-fast";
-	if (ui->monstersRespawnChkBox->isEnabled() && ui->monstersRespawnChkBox->isChecked())
-		cmd.arguments << "-respawn";
-	if (ui->gameOptsBtn->isEnabled() && activeGameOpts.dmflags1 != 0)
-		cmd.arguments << "+dmflags" << QString::number( activeGameOpts.dmflags1 );
-	if (ui->gameOptsBtn->isEnabled() && activeGameOpts.dmflags2 != 0)
-		cmd.arguments << "+dmflags2" << QString::number( activeGameOpts.dmflags2 );
-
-	const CompatibilityOptions & activeCompatOpts = activeCompatOptions();
-	if (ui->compatLevelCmbBox->isEnabled() && activeCompatOpts.compatLevel >= 0)
-		cmd.arguments << engine.getCompatLevelArgs( activeCompatOpts.compatLevel );
-	if (ui->compatOptsBtn->isEnabled() && !compatOptsCmdArgs.isEmpty())
-		cmd.arguments << compatOptsCmdArgs;
-	if (ui->allowCheatsChkBox->isChecked())
-		cmd.arguments << "+sv_cheats" << "1";
+	input.skillEnabled = ui->skillCmbBox->isEnabled();
+	input.skillNum = ui->skillSpinBox->value();
+	input.gameOptsEnabled = ui->gameOptsBtn->isEnabled();
+	input.gameOpts = activeGameplayOptions();  // for the dmflags
+	input.gameOpts.noMonsters = ui->noMonstersChkBox->isChecked();
+	input.gameOpts.fastMonsters = ui->fastMonstersChkBox->isChecked();
+	input.gameOpts.monstersRespawn = ui->monstersRespawnChkBox->isChecked();
+	input.gameOpts.allowCheats = ui->allowCheatsChkBox->isChecked();
+	input.compatLevelEnabled = ui->compatLevelCmbBox->isEnabled();
+	input.compatLevel = activeCompatOptions().compatLevel;
+	input.compatOptsCmdArgs = compatOptsCmdArgs;
 
 	//-- multiplayer options -------------------------------------------------------
 
-	if (ui->multiplayerGrpBox->isChecked())
-	{
-		switch (ui->multRoleCmbBox->currentIndex())
-		{
-		 case MultRole::Server:
-			cmd.arguments << "-host" << ui->playerCountSpinBox->text();
-			if (ui->portSpinBox->value() != 5029)
-				cmd.arguments << "-port" << ui->portSpinBox->text();
-			switch (ui->gameModeCmbBox->currentIndex())
-			{
-			 case Deathmatch:
-				cmd.arguments << "-deathmatch";
-				break;
-			 case TeamDeathmatch:
-				cmd.arguments << "-deathmatch" << "+teamplay";
-				break;
-			 case AltDeathmatch:
-				cmd.arguments << "-altdeath";
-				break;
-			 case AltTeamDeathmatch:
-				cmd.arguments << "-altdeath" << "+teamplay";
-				break;
-			 case Cooperative: // default mode, which is started without any param
-				break;
-			 default:
-				reportLogicError( this, "Invalid game mode index", "The game mode index is out of range." );
-			}
-			if (ui->teamDmgSpinBox->value() != 0.0)
-				cmd.arguments << "+teamdamage" << QString::number( ui->teamDmgSpinBox->value(), 'f', 2 );
-			if (ui->timeLimitSpinBox->value() != 0)
-				cmd.arguments << "-timer" << ui->timeLimitSpinBox->text();
-			if (ui->fragLimitSpinBox->value() != 0)
-				cmd.arguments << "+fraglimit" << ui->fragLimitSpinBox->text();
-			cmd.arguments << "-netmode" << QString::number( ui->netModeCmbBox->currentIndex() );
-			break;
-		 case MultRole::Client:
-			cmd.arguments << "-join" << ui->hostnameLine->text() % ":" % ui->portSpinBox->text();
-			break;
-		 default:
-			reportLogicError( this, "Invalid multiplayer role index", "The multiplayer role index is out of range." );
-		}
-	}
+	MultiplayerOptions & multOpts = input.multOpts;
+	multOpts.isMultiplayer = ui->multiplayerGrpBox->isChecked();
+	multOpts.multRole = MultRole( ui->multRoleCmbBox->currentIndex() );
+	multOpts.hostName = ui->hostnameLine->text();
+	multOpts.port = uint16_t( ui->portSpinBox->value() );
+	multOpts.netMode = NetMode( ui->netModeCmbBox->currentIndex() );
+	multOpts.gameMode = GameMode( ui->gameModeCmbBox->currentIndex() );
+	multOpts.playerCount = uint( ui->playerCountSpinBox->value() );
+	multOpts.teamDamage = ui->teamDmgSpinBox->value();
+	multOpts.timeLimit = uint( ui->timeLimitSpinBox->value() );
+	multOpts.fragLimit = uint( ui->fragLimitSpinBox->value() );
 
 	//-- output options ------------------------------------------------------------
 
-	// On Windows ZDoom doesn't log its output to stdout by default.
-	// Force it to do so, so that our ProcessOutputWindow displays something.
-	if (settings.showEngineOutput && engine.needsStdoutParam())
-		cmd.arguments << "-stdout";
+	input.showEngineOutput = settings.showEngineOutput;
 
-	// video options
-	if (ui->monitorCmbBox->currentIndex() > 0)
-	{
-		int monitorIndex = ui->monitorCmbBox->currentIndex() - 1;  // the first item is a placeholder for leaving it default
-		cmd.arguments << "+vid_adapter" << engine.getCmdMonitorIndex( monitorIndex );  // some engines index monitors from 1 and others from 0
-	}
-	if (!ui->resolutionXLine->text().isEmpty())
-		cmd.arguments << "-width" << ui->resolutionXLine->text();
-	if (!ui->resolutionYLine->text().isEmpty())
-		cmd.arguments << "-height" << ui->resolutionYLine->text();
-	if (ui->showFpsChkBox->isChecked())
-		cmd.arguments << "+vid_fps" << "1";
+	input.monitorIdx = ui->monitorCmbBox->currentIndex() - 1;  // the first item is a placeholder for leaving it default
+	input.resolutionX = ui->resolutionXLine->text();
+	input.resolutionY = ui->resolutionYLine->text();
+	input.showFps = ui->showFpsChkBox->isChecked();
 
-	// audio options
-	if (ui->noSoundChkBox->isChecked())
-		cmd.arguments << "-nosound";
-	if (ui->noSfxChkBox->isChecked())
-		cmd.arguments << "-nosfx";
-	if (ui->noMusicChkBox->isChecked())
-		cmd.arguments << "-nomusic";
+	input.audioOpts.noSound = ui->noSoundChkBox->isChecked();
+	input.audioOpts.noSFX = ui->noSfxChkBox->isChecked();
+	input.audioOpts.noMusic = ui->noMusicChkBox->isChecked();
 
 	//-- additional custom command line arguments ----------------------------------
 
-	if (!ui->presetCmdArgsLine->text().isEmpty())
-		appendCustomArguments( cmd.arguments, ui->presetCmdArgsLine->text() );
+	input.presetCmdArgs = ui->presetCmdArgsLine->text();
+	input.globalCmdArgs = ui->globalCmdArgsLine->text();
+
+	return input;
+}
+
+/// Merges the environment variables defined globally and defined for the selected preset into the system environment.
+/** It's rebuilt only if any of the variables have changed since the last call. */
+const QProcessEnvironment & MainWindow::getLaunchEnvironment()
+{
+	const Preset * preset = getSelectedPreset();
+	return launchEnv.get( globalOpts.envVars, preset ? preset->envVars : EnvVars() );
+}
+
+/// Generates a command to be run, displayed or saved to a script file, from the options displayed in the widgets.
+/**
+  * The parameters are the same as the ones of ::generateLaunchCommand(), additionally:
+  * \param verifyPaths Verify that each path in the command is valid and leads to the correct entry type (file or directory).
+  *                    If invalid path is found, display a message box with an error description.
+  * \param statBatch Batch in the collecting state makes this a dry run that only collects the paths to be verified,
+  *                  otherwise the verification uses its results instead of stat-ing the paths.
+  */
+os::ShellCommand MainWindow::generateLaunchCommand(
+	const QString & parentWorkingDir, PathStyle enginePathStyle, const QString & engineWorkingDir, PathStyle argPathStyle,
+	bool quotePaths, bool verifyPaths, LaunchCommandCache * cache, PathStatBatch * statBatch
+){
+	LaunchCommandInput input = getLaunchCommandInput();
+	if (!input.engine)
+	{
+		return {};  // no point in generating a command if we don't even know the engine, it determines everything
+	}
 
-	if (!ui->globalCmdArgsLine->text().isEmpty())
-		appendCustomArguments( cmd.arguments, ui->globalCmdArgsLine->text() );
+	completeEngineVersionInfo( *input.engine );  // only the selected engine has to wait for its version info
 
-	//------------------------------------------------------------------------------
+	PathChecker p( this, verifyPaths, statBatch );
 
-	return p.gotSomeInvalidPaths() ? os::ShellCommand() : cmd;
+	return ::generateLaunchCommand(
+		input, pathConvertor.workingDir(), parentWorkingDir, enginePathStyle, engineWorkingDir, argPathStyle, quotePaths, p, cache
+	);
 }
 
 int MainWindow::askForExtraPermissions( const EngineInfo & selectedEngine, const QStringVec & permissions )
@@ -4215,35 +5895,72 @@ int MainWindow::askForExtraPermissions( const EngineInfo & selectedEngine, const
 	return answer;
 }
 
-bool MainWindow::startDetached(
-	const QString & executable, const QStringVec & arguments, const QString & workingDir, const EnvVars & envVars
-){
-	QString executableName = fs::getFileNameFromPath( executable );
+void MainWindow::loadLaunchStats()
+{
+	if (launchStatsLoaded)
+		return;
+	launchStatsLoaded = true;
+
+	if (!fs::isValidFile( launchStatsFilePath ))
+		return;
 
-	QProcess process;
+	QByteArray content;
+	QString error = fs::readWholeFile( launchStatsFilePath, content );
+	if (!error.isEmpty())
+	{
+		logRuntimeError() << "Failed to load the launch statistics: " << error;
+		return;
+	}
 
-	process.setProgram( executable );
-	process.setArguments( arguments.toList() );
-	process.setWorkingDirectory( workingDir );
+	launchStats = QString::fromUtf8( content ).split('\n');
+	launchStats.removeAll( QString() );  // the trailing newline
+}
 
-	QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-	for (const auto & envVar : envVars)
+/// Appends the record to the rolling statistics file, the oldest records are dropped.
+void MainWindow::recordLaunchStats( const QString & record )
+{
+	if (record.isEmpty())
+		return;
+
+	logDebug() << "launch timeline: " << record;
+
+	loadLaunchStats();
+
+	launchStats.append( record );
+	if (launchStats.size() > MaxLaunchStatsRecords)
+		launchStats.erase( launchStats.begin(), launchStats.end() - MaxLaunchStatsRecords );
+
+	// it's just a diagnostic, the writer logs the error, it's not worth bothering the user with it
+	fileWriter.writeFile( launchStatsFilePath, (launchStats.join('\n') + '\n').toUtf8() );
+}
+
+/// Makes a path for the output log of a new launch and deletes the logs of the oldest launches.
+QString MainWindow::makeEngineOutputLogPath( const EngineInfo & engine )
+{
+	QDir logDir( appDataDir.filePath( engineOutputDirName ) );
+	if (!logDir.exists() && !logDir.mkpath( "." ))
 	{
-		env.insert( envVar.name, envVar.value );
+		logRuntimeError() << "Failed to create directory " << logDir.path();
+		return {};
 	}
-	process.setProcessEnvironment(env);
 
-	bool success = process.startDetached();
-	if (!success)
+	// the backups of the rotated logs belong to the same launch, remove them together
+	const QStringList oldLogs = logDir.entryList( { "*.log" }, QDir::Files, QDir::Time );  // the newest first
+	for (int i = MaxEngineOutputLogs - 1; i < oldLogs.size(); ++i)
 	{
-		reportRuntimeError( this, "Process start error", "Failed to start \""%executableName%"\" ("%process.errorString()%")" );
+		for (const QString & fileName : logDir.entryList( { oldLogs[i], oldLogs[i] % ".*" }, QDir::Files ))
+			logDir.remove( fileName );
 	}
 
-	return success;
+	QString timeStamp = QDateTime::currentDateTime().toString( "yyyy-MM-dd_hh-mm-ss" );
+	return logDir.filePath( fs::getFileBasenameFromPath( engine.executablePath ) % '_' % timeStamp % ".log" );
 }
 
 void MainWindow::launch()
 {
+	LaunchTimeline timeline;
+	timeline.start();
+
 	const EngineInfo * selectedEngine = getSelectedEngine();
 	if (!selectedEngine)
 	{
@@ -4259,9 +5976,19 @@ void MainWindow::launch()
 	//   from another directory with relative executable path (looking at you Crispy Doom, fix your shit!).
 	// - All paths will be relative to the engine's dir, because working dir will be set to the engine's dir when started.
 	// - When sending arguments to the process directly and skipping the shell parsing, the quotes are undesired.
+	// Stat-ing the files one after another takes long on network drives, so the first run only collects the paths,
+	// then they are all stat-ed in parallel, and the second run verifies them using the results.
+	PathStatBatch statBatch;
+	generateLaunchCommand(
+		currentWorkingDir, PathStyle::Absolute, engineWorkingDir, pathConvertor.pathStyle(), DontQuotePaths, VerifyPaths, nullptr, &statBatch
+	);
+	timeline.addLauncherTimePoint( "command generation" );
+	statBatch.statAll();
+	timeline.addLauncherTimePoint( "path verification" );
 	auto cmd = generateLaunchCommand(
-		currentWorkingDir, PathStyle::Absolute, engineWorkingDir, pathConvertor.pathStyle(), DontQuotePaths, VerifyPaths
+		currentWorkingDir, PathStyle::Absolute, engineWorkingDir, pathConvertor.pathStyle(), DontQuotePaths, VerifyPaths, nullptr, &statBatch
 	);
+	timeline.addLauncherTimePoint( "command regeneration" );  // with the stat results, also shows the errors
 	if (cmd.executable.isNull())
 	{
 		return;  // errors are already shown during the generation
@@ -4269,10 +5996,13 @@ void MainWindow::launch()
 
 	logDebug().quote() << cmd.executable << ' ' << cmd.arguments;
 
+	filePrewarmer.cancelAll();  // from now on the engine reads the files itself
+
 	// If extra permissions are needed to run the engine inside its sandbox environment, better ask the user.
 	if (settings.askForSandboxPermissions && !cmd.extraPermissions.isEmpty())
 	{
 		int answer = askForExtraPermissions( *selectedEngine, cmd.extraPermissions );
+		timeline.addWaitingTimePoint( "permissions dialog" );
 		if (answer != QMessageBox::Yes)
 		{
 			return;
@@ -4293,20 +6023,48 @@ void MainWindow::launch()
 	// The command paths are always generated relative to the engine's dir.
 	const QString & processWorkingDir = engineWorkingDir;
 
-	// merge optional environment variables defined globally and defined for this preset
-	EnvVars envVars = globalOpts.envVars;
-	if (const Preset * preset = getSelectedPreset())
-		envVars += preset->envVars;
+	// usually prepared already when the preset was selected
+	const QProcessEnvironment & env = getLaunchEnvironment();
+
+	timeline.addLauncherTimePoint( "process preparation" );
 
 	if (settings.showEngineOutput)
 	{
 		ProcessOutputWindow processWindow( this );
-		processWindow.runProcess( cmd.executable, cmd.arguments, processWorkingDir, envVars );
+		if (settings.logEngineOutput)
+		{
+			QString logPath = makeEngineOutputLogPath( *selectedEngine );
+			if (!logPath.isEmpty())
+				processWindow.logOutputToFile( logPath );
+		}
+		processWindow.trackLoadPhases( selectedEngine->loadPhaseMarkers() );
+		// the window returns only after the engine exits, but the timeline has the time points from when they happened
+		ProcessStatus status = processWindow.runProcess( cmd.executable, cmd.arguments, processWorkingDir, env, &timeline );
 		//int resultCode = processWindow.result();
+		if (status != ProcessStatus::FailedToStart)
+		{
+			QString record = timeline.finish();
+			const QString & loadPhases = processWindow.loadPhasesSummary();
+			if (!loadPhases.isEmpty())
+			{
+				record += "  loading: " % loadPhases;
+				// so that the load cost of different mod stacks can be compared
+				if (Preset * preset = getSelectedPreset())
+				{
+					preset->lastLoadPhases = loadPhases;
+					scheduleSavingOptions();
+				}
+			}
+			recordLaunchStats( record );
+		}
 	}
 	else
 	{
-		bool success = startDetached( cmd.executable, cmd.arguments, processWorkingDir, envVars );
+		bool success = startDetached( this, cmd.executable, cmd.arguments, processWorkingDir, env );
+		timeline.addEngineTimePoint( "process start" );
+
+		if (success)
+			recordLaunchStats( timeline.finish() );
 
 		if (success && settings.closeOnLaunch)
 		{
@@ -4314,3 +6072,85 @@ void MainWindow::launch()
 		}
 	}
 }
+
+/// Starts the host and all the clients of the multiplayer game set up in the widgets on this machine.
+void MainWindow::launchLocalMultiplayer()
+{
+	LaunchCommandInput input = getLaunchCommandInput();
+	if (!input.engine)
+	{
+		reportUserError( this, "No engine selected", "No Doom engine is selected." );
+		return;
+	}
+	if (!input.multOpts.isMultiplayer || input.multOpts.multRole != MultRole::Server || input.multOpts.playerCount < 2)
+	{
+		reportUserError( this, "Multiplayer not set up",
+			"Enable the multiplayer, select the Server role and set the player count. "
+			"The host and the rest of the players as clients will then be started on this computer."
+		);
+		return;
+	}
+
+	completeEngineVersionInfo( *input.engine );
+	const EngineInfo & engine = *input.engine;
+
+	// the same as in launch(), see the comments there
+	QString currentWorkingDir = pathConvertor.workingDir().path();
+	QString engineWorkingDir = fs::getAbsoluteDirOfFile( engine.executablePath );
+
+	QVector< MultiProcessOutputWindow::ProcessToStart > processes;
+	QStringVec extraPermissions;
+	for (uint instanceIdx = 0; instanceIdx < input.multOpts.playerCount; ++instanceIdx)
+	{
+		LaunchCommandInput instanceInput = input;
+		// the instances are always started in the output window, so the engines must write their output there
+		instanceInput.showEngineOutput = true;
+		if (instanceIdx > 0)
+		{
+			instanceInput.multOpts.multRole = MultRole::Client;
+			instanceInput.multOpts.hostName = "localhost";
+			instanceInput.clientPort = uint16_t( input.multOpts.port + instanceIdx );  // they can't all listen on the same port
+		}
+
+		// all the instances use the same files, verifying them once is enough
+		PathChecker p( this, /*verifyPaths*/ instanceIdx == 0 );
+		auto cmd = ::generateLaunchCommand(
+			instanceInput, pathConvertor.workingDir(),
+			currentWorkingDir, PathStyle::Absolute, engineWorkingDir, pathConvertor.pathStyle(), DontQuotePaths, p
+		);
+		if (cmd.executable.isNull())
+		{
+			return;  // errors are already shown during the generation
+		}
+
+		if (instanceIdx == 0)
+			extraPermissions = cmd.extraPermissions;
+
+		QString name = instanceIdx == 0 ? QString("host") : QStringLiteral("client %1").arg( instanceIdx );
+		processes.append({ std::move(name), std::move(cmd.executable), std::move(cmd.arguments) });
+	}
+
+	filePrewarmer.cancelAll();  // from now on the engine reads the files itself
+
+	if (settings.askForSandboxPermissions && !extraPermissions.isEmpty())
+	{
+		int answer = askForExtraPermissions( engine, extraPermissions );
+		if (answer != QMessageBox::Yes)
+		{
+			return;
+		}
+	}
+
+	QString saveDirPath = getSaveDir();
+	if (!fs::createDirIfDoesntExist( saveDirPath ))
+	{
+		reportRuntimeError( this, "Error creating directory", "Failed to create directory \""%saveDirPath%"\". Check permissions." );
+	}
+
+	const QProcessEnvironment & env = getLaunchEnvironment();
+
+	// deletes itself when closed
+	auto * processWindow = new MultiProcessOutputWindow( this );
+	processWindow->setWindowTitle( fs::getFileNameFromPath( engine.executablePath ) % " - local multiplayer" );
+	processWindow->startProcesses( std::move(processes), engineWorkingDir, env, LocalMultiplayerStartDelayMs );
+}
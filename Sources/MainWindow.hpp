@@ -12,21 +12,51 @@
 #include "Dialogs/DialogCommon.hpp"
 
 #include "Widgets/ListModel.hpp"
+#include "Widgets/MapPackModel.hpp"
 #include "Widgets/SearchPanel.hpp"
 #include "UserData.hpp"
+#include "DoomFiles.hpp"  // MapNameSet
+#include "OptionsSerializer.hpp"  // OptionsWriteCache
+#include "LaunchCommand.hpp"
+#include "PresetExport.hpp"  // PresetExportResult, ExportTarget
+#include "PresetContentIndex.hpp"
 #include "UpdateChecker.hpp"
 #include "Themes.hpp"  // WindowsThemeWatcher
+#include "Utils/DirWatcher.hpp"
+#include "Utils/DirProber.hpp"
+#include "Utils/AsyncDirTraverser.hpp"
+#include "Utils/AsyncFileWriter.hpp"
+#include "Utils/FilePrewarmer.hpp"
+#include "Utils/EventFilters.hpp"  // HoverFilter
+#include "Utils/TaskGroup.hpp"
+#include "Utils/IdleScheduler.hpp"
+#include "Utils/DemoFileReader.hpp"  // DemoInfo
+#include "Utils/SaveFileReader.hpp"  // SaveInfo
+#include "Utils/WadInfoPrefetcher.hpp"
+#include "Utils/ModConflictAnalyzer.hpp"
 
 #include <QMainWindow>
 #include <QString>
 #include <QFileInfo>
-#include <QFileSystemModel>
+#include <QStringList>
+#include <QStringListModel>
+#include <QHash>
+#include <QSet>
+#include <QByteArray>
+#include <QPointer>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+#include <optional>
+#include <vector>
 
 class QTableWidget;
 class QItemSelection;
 class QComboBox;
 class QLineEdit;
 class OptionsToLoad;
+class PathStatBatch;
+class DiagnosticsDialog;
 
 namespace Ui {
 	class MainWindow;
@@ -50,14 +80,17 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
  private: // overridden methods
 
 	virtual void showEvent( QShowEvent * event ) override;
-	virtual void timerEvent( QTimerEvent * event ) override;
 	virtual void closeEvent( QCloseEvent * event ) override;
 
  private slots:
 
 	void onWindowShown();
+	void onStartupFilesLoaded();
+	void reloadModifiedOptions();
 
 	void runAboutDialog();
+	void showLaunchStats();
+	void showDiagnostics();
 	void runSetupDialog();
 	void runOptsStorageDialog();
 	void runGameOptsDialog();
@@ -70,10 +103,10 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 	void onMapPackToggled( const QItemSelection & selected, const QItemSelection & deselected );
 	void onPresetDataChanged( const QModelIndex & topLeft, const QModelIndex & bottomRight, const QVector<int> & roles );
 	void onModDataChanged( const QModelIndex & topLeft, const QModelIndex & bottomRight, const QVector<int> & roles );
+	void onModIconsResolved( const QStringList & paths );
 
 	void showMapPackDesc( const QModelIndex & index );
 
-	void onMapDirUpdated( const QString & path );
 
 	void openEngineDataDir();
 	void cloneConfig();
@@ -86,7 +119,7 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 	void presetInsertSeparator();
 	void onPresetsReordered();
 
-	void searchPresets( const QString & phrase, bool caseSensitive, bool useRegex );
+	void searchPresets( const QString & phrase, bool caseSensitive, bool useRegex, bool searchContent );
 
 	void modAdd();
 	void modAddDir();
@@ -153,15 +186,22 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 
 	void exportPresetToScript();
 	void exportPresetToShortcut();
+	void exportAllPresetsToScripts();
+	void exportAllPresetsToShortcuts();
 	void importPresetFromScript();
 
 	void onPresetCmdArgsChanged( const QString & text );
 	void onGlobalCmdArgsChanged( const QString & text );
 
 	void launch();
+	void launchLocalMultiplayer();
 
  private: // methods
 
+	struct ConfigFile;
+	struct SaveFile;
+	struct DemoFile;
+
 	void adjustUi();
 
 	void setupPresetList();
@@ -174,23 +214,79 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 	void updateOptionsGrpBoxTitles( const StorageSettings & storageSettings );
 
 	void loadMonitorInfo( QComboBox * box );
+	void updateMonitorInfo();
 
 	void togglePathStyle( PathStyle style );
 
 	void fillDerivedEngineInfo( DirectList< EngineInfo > & engines );
+	void onEngineVersionInfoLoaded( const QString & executablePath, const os::UncertainExeVersionInfo & versionInfo );
+	void completeEngineVersionInfo( EngineInfo & engine );
 
 	void autoselectItems();
 
+	void scheduleBackgroundJobs();
+
 	void setAlternativeDirs( const QString & dirName );
 
-	void updateListsFromDirs();
+	void updateListsFromDirs( bool pollingTick );
+	bool dirNeedsUpdate( const QString & dir, bool recursively, bool pollingTick );
+	void onDirStateChanged( const QString & dir, DirProber::State newState );
 	void updateIWADsFromDir();
+	void updateIWADsFromDir_async( const QStringVec & changedDirs );
+	bool syncIWADRoots();
+	void applyIWADRoots();
+	void applyIWADsFromDir( QList< IWAD > && iwads );
 	void resetMapDirModelAndView();
 	void updateConfigFilesFromDir( const QString * configDir = nullptr );
+	void updateConfigFilesFromDir_async( const QString & configDir );
+	void applyConfigFilesFromDir( QList< ConfigFile > && configs );
 	void updateSaveFilesFromDir( const QString * saveDir = nullptr );
+	void updateSaveFilesFromDir_async( const QString & saveDir );
+	void applySaveFilesFromDir( QList< SaveFile > && saves );
+	void requestSaveInfo( const QString & saveDir );
+	static QString makeSaveDisplayString( const SaveFile & save );
+	void onSaveInfoRead( const QString & fileName, const FileStamp & stamp, const doom::UncertainSaveInfo & saveInfo );
 	void updateDemoFilesFromDir( const QString * demoDir = nullptr );
+	void updateDemoFilesFromDir_async( const QString & demoDir );
+	void applyDemoFilesFromDir( QList< DemoFile > && demos );
+	void requestDemoInfo( const QString & demoDir );
+	void onDemoInfoRead( const QString & fileName, const FileStamp & stamp, const doom::UncertainDemoInfo & demoInfo );
+	void markDemoCompatibility( const DemoFile & demo, const EngineInfo * engine );
+	void preselectOptionsForDemo( const doom::DemoInfo & demoInfo );
+	static QString makeDemoDisplayString( const DemoFile & demo );
 	void updateCompatLevels();
 	void updateMapsFromSelectedWADs( const QStringVec * selectedMapPacks = nullptr );
+	void insertMapNames( const QStringVec & mapNames );
+	void removeMapNames( const QStringVec & mapNames );
+	void updateMapDescPreview();
+	void openMapDescDialog( const QString & title, const QString & desc );
+
+	/// Updates of the derived lists and widgets that can be postponed while a batch of changes is being applied.
+	enum DeferredUpdate : uint
+	{
+		ConfigListUpdate    = 1 << 0,
+		SaveListUpdate      = 1 << 1,
+		DemoListUpdate      = 1 << 2,
+		CompatLevelsUpdate  = 1 << 3,
+		MapListUpdate       = 1 << 4,
+		MapDescUpdate       = 1 << 5,
+		LaunchCommandUpdate = 1 << 6,
+
+		AllUpdates = ~0u
+	};
+	/// While an object of this class exists, the requested updates are only collected,
+	/// and when the last one is destroyed, each of them is run once.
+	class UpdateBatch {
+		MainWindow * _window;
+	 public:
+		UpdateBatch( MainWindow * window ) : _window( window )  { _window->updateBatchDepth++; }
+		~UpdateBatch()  { if (--_window->updateBatchDepth == 0) _window->runDeferredUpdates(); }
+	};
+	/// Runs the updates right away, unless there is an UpdateBatch in progress.
+	void requestUpdates( uint updates );
+	/// Runs those of these updates that are pending, in the order of their dependencies.
+	/** Can be used in the middle of a batch, when the following step needs some of the results. */
+	void runDeferredUpdates( uint updates = AllUpdates );
 
 	void moveEnvVarToKeepTableSorted( QTableWidget * table, EnvVars * envVars, int rowIdx );
 
@@ -200,15 +296,32 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 	void toggleSkillSubwidgets( bool enabled );
 	void toggleOptionsSubwidgets( bool enabled );
 
-	bool saveOptions( const QString & filePath );
-	bool loadOptions( const QString & filePath );
+	OptionsToSave getOptionsToSave();
+	void saveOptions( const QString & filePath );
+	bool loadOptions( const ParsedOptionsFile & parsedFile );
+
+	void watchOptionsFile();
+	void applyModifiedOptions( const ParsedOptionsFile & modifiedFile );
 
 	bool isCacheDirty() const;
-	bool saveCache( const QString & filePath );
-	bool loadCache( const QString & filePath );
+	void saveCache( const QString & filePath );
+	bool loadCache();
+	void syncSharedWadInfoCache();
+
+	void saveListSnapshot( const QString & filePath );
+	void loadListSnapshot();
+	std::optional< QStringList > takeListSnapshot( const QString & listName, const QStringVec & dirs );
+	template< typename Item > static QList< Item > makeItemsFromSnapshot( const QStringList & entries );
+	template< typename Item > QList< Item > makeItemsFromFiles( const QStringList & filePaths, const QStringVec & fileSuffixes ) const;
 
 	void restoreLoadedOptions( OptionsToLoad && opts );
+	void ensurePresetLoaded( Preset & preset );
+	QString getPresetSaveDir( const Preset & preset ) const;
+	void prefetchSaveDirs( int presetIdx );
+	void loadAllPresets();
+	QSet< QString > findPresetsWithFileContent( const QString & word );
 	void restorePreset( int index );
+	void restorePresetContent( int index );
 
 	void restoreSelectedEngine( Preset & preset );
 	void restoreSelectedConfig( Preset & preset );
@@ -226,21 +339,27 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 
 	void restoreEnvVars( const EnvVars & envVars, QTableWidget * table );
 
+	void prewarmSelectedFiles();
+
+	void updateModConflicts();
+	void annotateModConflicts();
+
 	void updateLaunchCommand();
+	LaunchCommandInput getLaunchCommandInput();
+	const QProcessEnvironment & getLaunchEnvironment();
 	os::ShellCommand generateLaunchCommand(
 		const QString & parentWorkingDir, PathStyle enginePathStyle, const QString & engineWorkingDir, PathStyle argPathStyle,
-		bool quotePaths, bool verifyPaths
+		bool quotePaths, bool verifyPaths, LaunchCommandCache * cache = nullptr, PathStatBatch * statBatch = nullptr
 	);
 
 	int askForExtraPermissions( const EngineInfo & selectedEngine, const QStringVec & permissions );
-	bool startDetached(
-		const QString & executable, const QStringVec & arguments, const QString & workingDir = {}, const EnvVars & envVars = {}
-	);
+	void exportAllPresets( ExportTarget target );
+	void recordLaunchStats( const QString & record );
+	void loadLaunchStats();
+	QString makeEngineOutputLogPath( const EngineInfo & engine );
 
  private: // MainWindow-specific utils
 
-	struct ConfigFile;
-
 	Preset * getSelectedPreset() const;
 	EngineInfo * getSelectedEngine() const;
 	ConfigFile * getSelectedConfig() const;
@@ -249,8 +368,6 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 	template< typename Functor > void forEachSelectedMapPack( const Functor & loopBody ) const;
 	QStringVec getSelectedMapPacks() const;
 
-	QStringList getUniqueMapNamesFromWADs( const QVector<QString> & selectedWADs ) const;
-
 	QString getConfigDir() const;
 	QString getDataDir() const;
 	QString getSaveDir() const;
@@ -258,13 +375,9 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 	QString getDemoDir() const;
 
 	QString convertRebasedEngineDataPath( QString path ) const;
-	QString rebaseSaveFilePath( const QString & filePath, const PathRebaser & workingDirRebaser, const EngineInfo * engine );
 
 	LaunchMode getLaunchModeFromUI() const;
 
-	template< typename Functor > void forEachDirToBeAccessed( const Functor & loopBody ) const;
-	QStringVec getDirsToBeAccessed() const;
-
 	void scheduleSavingOptions( bool storedOptionsModified = true );
 
 	LaunchOptions & activeLaunchOptions();
@@ -281,19 +394,41 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 
 	QAction * addCmdArgAction = nullptr;
 
-	uint tickCount = 0;
-
 	QDir appDataDir;   ///< directory where this application can store its data
 	QString optionsFilePath;
 	QString cacheFilePath;
+	QString wadCacheFilePath;
+	QString sharedCacheDir;   ///< where the installations on this machine exchange the WAD info, if enabled
+	QString iconCacheFilePath;
+	QString listSnapshotFilePath;
+	QString launchStatsFilePath;
 
 	bool optionsNeedUpdate = false;  ///< indicates that the user has made a change and the options file needs to be updated
 	bool optionsCorrupted = false;   ///< true if there was a critical error during parsing of the options file, such content should not be saved
+	OptionsWriteCache optionsWriteCache;  ///< parts of the options file that didn't change since the last save
+
+	QFileSystemWatcher optionsFileWatcher;   ///< notifies us when someone else modifies the options file, so that it's not overwritten
+	QTimer optionsReloadTimer;   ///< delays the reload until the other program is done writing the file
+	QList< QByteArray > ownOptionsFileHashes;   ///< hashes of the content we have written recently, to tell our own writes from the others
+	ParsedOptionsFile modifiedOptionsFile;   ///< result of the background parsing, valid only until it's applied
+	TaskGroup optionsReloadTask;   ///< parses the modified options file in the background
+	bool optionsReloadPending = false;   ///< the file has been modified again while it was being parsed
+
+	TaskGroup saveDirPrefetchTask;   ///< lists the save directories of the presets that are likely to be selected next
+	QStringVec recentPresetIDs;   ///< the most recently selected presets, the latest first
+	QSet< QString > prefetchedSaveDirs;   ///< listed in the background, the save list can be filled from memory once
+	QSet< QString > prefetchedDemoDirs;   ///< the same for the demo list
+
+	TaskGroup presetExportTask;   ///< exports all the presets at once
+	TaskGroup sharedCacheTask;   ///< reads and appends the WAD info cache shared with the other installations
+	QVector< PresetExportResult > presetExportResults;   ///< valid only in the completion callback of presetExportTask
 
 	bool disableSelectionCallbacks = false;   ///< flag that temporarily disables callbacks like selectEngine(), selectConfig(), selectIWAD()
 	bool disableEnvVarsCallbacks = false;     ///< flag that temporarily disables environment variable callbacks when the list is manually messed with
 	bool restoringOptionsInProgress = false;  ///< flag used to temporarily prevent storing selected values to a preset or global launch options
 	bool restoringPresetInProgress = false;   ///< flag used to temporarily prevent storing selected values to a preset or global launch options
+	int updateBatchDepth = 0;   ///< number of UpdateBatch objects in existence
+	uint deferredUpdates = 0;   ///< combination of DeferredUpdate flags waiting for the end of the batch
 
 	QString selectedPresetBeforeSearch;   ///< which preset was selected before the search results were displayed
 
@@ -303,8 +438,69 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 
 	QStringVec compatOptsCmdArgs;  ///< string with command line args created from compatibility options, cached so that it doesn't need to be regenerated on every command line update
 
+	LaunchCommandCache launchCmdCache;   ///< fragments of the displayed launch command
+	PreparedEnvironment launchEnv;   ///< environment for the engine, prepared when a preset is selected, see getLaunchEnvironment()
+
+	QStringList launchStats;   ///< timings of the last launches, the oldest first, see recordLaunchStats()
+	bool launchStatsLoaded = false;   ///< the file is read only when it's needed, most sessions don't need it
+
+	QPointer< DiagnosticsDialog > diagnosticsDialog;   ///< non-modal, deletes itself when closed
+
 	UpdateChecker updateChecker;
 
+	DirWatcher dirWatcher;   ///< notifies us when the content of the directories we display changes, so that we don't need to poll them
+	DirProber dirProber;   ///< finds out in the background whether the directories respond, so that a dead network share doesn't freeze the window
+	QSet< QString > dirsToRescan;   ///< directories that became reachable and haven't been listed since
+	AsyncDirTraverser dirTraverser;   ///< scans the directories in a background thread so that the window doesn't freeze
+
+	/// One of the directories the IWAD list is updated from, see IwadSettings::getDirs().
+	struct IWADRoot
+	{
+		QString dir;
+		QList< IWAD > iwads;            ///< result of the last scan of this directory
+		QStringVec fingerprints;        ///< of the iwads, empty string if not known, see doom::getIWADFingerprint()
+	};
+	/// Each root is scanned by its own traversal, so a slow disk doesn't delay the IWADs from the fast ones.
+	/** Their addresses identify the traversals, so the vector is resized only after they are all cancelled. */
+	std::vector< IWADRoot > iwadRoots;
+	doom::WadInfoPrefetcher wadPrefetcher;   ///< reads the map names from the WADs before the user selects them
+	doom::ModConflictAnalyzer modConflictAnalyzer;   ///< finds the checked mods that replace each other's lumps
+	QStringVec modConflictsLoadOrder;   ///< the checked mods the last analysis was started for
+	doom::ModConflictAnalyzer::Conflicts modConflicts;   ///< result of the last finished analysis
+	AsyncFileWriter fileWriter;   ///< writes the options and caches in a background thread, so that a slow drive doesn't cause hitches
+	FilePrewarmer filePrewarmer;   ///< reads the files of the selected preset into the system cache, so that the engine starts faster
+	HoverFilter launchBtnHoverFilter;   ///< the user is about to launch, good time to prewarm the files
+	IdleScheduler idleScheduler;   ///< runs the periodic saves and updates at moments when the user isn't interacting
+
+	/// results of the startup tasks, valid only until they are applied in onStartupFilesLoaded()
+	struct StartupFiles
+	{
+		bool cacheExists = false;
+		QJsonDocument cacheDoc;
+		QString cacheError;
+		bool wadCacheExists = false;
+		QString wadCacheError;
+		bool iconCacheExists = false;
+		QByteArray iconCacheData;   ///< decoded in the main thread, because it contains pixmaps
+		QString iconCacheError;
+		bool optionsExist = false;
+		ParsedOptionsFile options;
+		bool listSnapshotExists = false;
+		QJsonDocument listSnapshotDoc;
+		QString listSnapshotError;
+	};
+	StartupFiles startupFiles;
+	TaskGroup startupTasks;   ///< reads and parses the files needed at startup in parallel
+	bool startupInProgress = false;   ///< the files needed at startup are still being loaded, the UI is disabled meanwhile
+
+	/// last known content of a directory-based list, see saveListSnapshot()
+	struct ListSnapshot
+	{
+		QVector< QPair< QString, qint64 > > dirs;  ///< path and modification time of each directory the list was read from
+		QStringList entries;  ///< file paths for the IWADs, file names for the rest
+	};
+	QHash< QString, ListSnapshot > listSnapshot;   ///< key is the list name, used only until the startup is finished
+
  #if IS_WINDOWS
 	WindowsThemeWatcher themeWatcher;
  #endif
@@ -331,8 +527,10 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 	struct SaveFile : public ReadOnlyListModelItem
 	{
 		QString fileName;
+		FileStamp stamp;  ///< unknown if the item comes from the list snapshot
+		std::optional< doom::SaveInfo > info;  ///< read in the background, empty until then or if the file has none
 		SaveFile( const QString & fileName ) : fileName( fileName ) {}
-		SaveFile( const QFileInfo & file ) : fileName( file.fileName() ) {}
+		SaveFile( const QFileInfo & file ) : fileName( file.fileName() ), stamp( file ) {}
 		QString getID() const { return fileName; }
 	};
 	ReadOnlyDirectListModel< SaveFile > saveModel;    ///< list of save files found in pre-defined directory
@@ -340,8 +538,10 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 	struct DemoFile : public ReadOnlyListModelItem
 	{
 		QString fileName;
+		FileStamp stamp;  ///< unknown if the item comes from the list snapshot
+		std::optional< doom::DemoInfo > info;  ///< read in the background, empty until then or if the file is not a demo
 		DemoFile( const QString & fileName ) : fileName( fileName ) {}
-		DemoFile( const QFileInfo & file ) : fileName( file.fileName() ) {}
+		DemoFile( const QFileInfo & file ) : fileName( file.fileName() ), stamp( file ) {}
 		QString getID() const { return fileName; }
 	};
 	ReadOnlyDirectListModel< DemoFile > demoModel;    ///< list of demo files found in pre-defined directory
@@ -350,12 +550,16 @@ class MainWindow : public QMainWindow, private DialogWithPaths {
 	ReadOnlyDirectListModel< IWAD > iwadModel;    ///< user-ordered list of iwads (managed by SetupDialog)
 
 	MapSettings mapSettings;    ///< map-related preferences (value returned by SetupDialog)
-	QFileSystemModel mapModel;  ///< model representing a directory with map files
+	MapPackModel mapModel;  ///< model representing a directory with map files
+	doom::MapNameSet selectedMapNames;  ///< map names of the selected IWAD and map packs, updated one WAD at a time
+	QStringListModel mapNamesModel;  ///< sorted map names shared by both map combo-boxes
+	bool mapNamesAreStandard = false;  ///< the model contains the standard names of the IWAD instead of selectedMapNames
 
 	ModSettings modSettings;    ///< mod-related preferences (value returned by SetupDialog)
 	EditableDirectListModel< Mod > modModel;
 
 	EditableFilteredListModel< Preset > presetModel;    ///< user-made presets, when one is selected from the list view, it applies its stored options to the other widgets
+	PresetContentIndex presetContentIndex;  ///< for searching the presets by their mods, IWADs, map packs and arguments
 
 	LaunchOptions launchOpts;
 	MultiplayerOptions multOpts;
@@ -12,8 +12,24 @@
 #include "Utils/JsonUtils.hpp"
 #include "Utils/MiscUtils.hpp"  // checkPath, highlightInvalidListItem
 #include "Utils/ErrorHandling.hpp"
+#include "Utils/TimeStats.hpp"
+#include "Utils/FileSystemUtils.hpp"  // replaceFileSuffix, readWholeFile
+#include "Utils/StringPool.hpp"  // g_pathPool
 
 #include <QFileInfo>
+#include <QCryptographicHash>
+#include <QCborValue>
+#include <QCborMap>
+
+#include <algorithm>  // any_of, equal
+#include <functional>  // equal_to
+#include <initializer_list>
+
+
+/// Version of the structure of the options file.
+/** Must be increased whenever an element is renamed, moved or removed, or a new one is added without DontShowError,
+  * so that the files written before are loaded by deserializeOlderSchema() with the "missing element" warnings suppressed. */
+static constexpr int optionsSchemaVersion = 1;
 
 
 //======================================================================================================================
@@ -81,7 +97,7 @@ static void deserialize( const JsonObjectCtx & jsEngine, Engine & engine )
 	else
 	{
 		engine.name = jsEngine.getString( "name", "<missing name>" );
-		engine.executablePath = jsEngine.getString( "path", {} );  // empty path is used to indicate invalid entry to be skipped
+		engine.executablePath = g_pathPool.intern( jsEngine.getString( "path", {} ) );  // empty path is used to indicate invalid entry to be skipped
 		engine.configDir = jsEngine.getString( "config_dir", fs::getDirOfFile( engine.executablePath ) );
 		engine.dataDir = jsEngine.getString( "data_dir", engine.configDir, DontShowError );
 		engine.family = familyFromStr( jsEngine.getString( "family", {} ) );
@@ -117,7 +133,7 @@ static void deserialize( const JsonObjectCtx & jsEngine, IWAD & iwad )
 	}
 	else
 	{
-		iwad.path = jsEngine.getString( "path", {} );  // empty path is used to indicate invalid entry to be skipped
+		iwad.path = g_pathPool.intern( jsEngine.getString( "path", {} ) );  // empty path is used to indicate invalid entry to be skipped
 		iwad.name = jsEngine.getString( "name", QFileInfo( iwad.path ).fileName() );
 	}
 }
@@ -146,22 +162,28 @@ static QJsonObject serialize( const Mod & mod )
 	return jsMod;
 }
 
-static void deserialize( const JsonObjectCtx & jsMod, Mod & mod )
+static void deserialize( const JsonObjectCtx & jsModObj, Mod & mod )
 {
-	if ((mod.isSeparator = jsMod.getBool( "separator", false, DontShowError )))
+	// there are thousands of mods in a big options file, so they are read in a single pass
+	enum { Checked, CmdArgument, Name, Path, Separator, Value };
+	static constexpr JsonKeys< 6 > keys = {{ "checked", "cmd_argument", "name", "path", "separator", "value" }};
+	JsonMembers jsMod = jsModObj.getMembers( keys );
+
+	if ((mod.isSeparator = jsMod.getBool( Separator, false, DontShowError )))
 	{
-		mod.fileName = jsMod.getString( "name", "<missing name>" );
+		mod.fileName = jsMod.getString( Name, "<missing name>" );
 	}
-	else if ((mod.isCmdArg = jsMod.getBool( "cmd_argument", false, DontShowError )))
+	else if ((mod.isCmdArg = jsMod.getBool( CmdArgument, false, DontShowError )))
 	{
-		mod.fileName = jsMod.getString( "value", "<missing value>" );
-		mod.checked = jsMod.getBool( "checked", mod.checked );
+		mod.fileName = jsMod.getString( Value, "<missing value>" );
+		mod.checked = jsMod.getBool( Checked, mod.checked );
 	}
 	else
 	{
-		mod.path = jsMod.getString( "path", {} );  // empty path is used to indicate invalid entry to be skipped
-		mod.fileName = QFileInfo( mod.path ).fileName();
-		mod.checked = jsMod.getBool( "checked", mod.checked );
+		// the presets reference the same files over and over, the pool makes them share one copy of each path
+		mod.path = g_pathPool.intern( jsMod.getString( Path, {} ) );  // empty path is used to indicate invalid entry to be skipped
+		mod.fileName = g_pathPool.intern( QFileInfo( mod.path ).fileName() );
+		mod.checked = jsMod.getBool( Checked, mod.checked );
 	}
 }
 
@@ -185,7 +207,9 @@ static QJsonObject serialize( const IwadSettings & iwadSettings )
 
 	jsIWADs["auto_update"] = iwadSettings.updateFromDir;
 	jsIWADs["directory"] = iwadSettings.dir;
+	jsIWADs["extra_directories"] = serializeStringVec( iwadSettings.extraDirs );
 	jsIWADs["search_subdirs"] = iwadSettings.searchSubdirs;
+	jsIWADs["detect_by_header"] = iwadSettings.detectByHeader;
 	jsIWADs["default_iwad"] = iwadSettings.defaultIWAD;
 
 	return jsIWADs;
@@ -195,7 +219,10 @@ static void deserialize( const JsonObjectCtx & jsIWADs, IwadSettings & iwadSetti
 {
 	iwadSettings.updateFromDir = jsIWADs.getBool( "auto_update", iwadSettings.updateFromDir );
 	iwadSettings.dir = jsIWADs.getString( "directory" );
+	if (JsonArrayCtx jsExtraDirs = jsIWADs.getArray( "extra_directories", DontShowError ))
+		iwadSettings.extraDirs = deserializeStringVec( jsExtraDirs );
 	iwadSettings.searchSubdirs = jsIWADs.getBool( "search_subdirs", iwadSettings.searchSubdirs );
+	iwadSettings.detectByHeader = jsIWADs.getBool( "detect_by_header", iwadSettings.detectByHeader, DontShowError );
 	iwadSettings.defaultIWAD = jsIWADs.getString( "default_iwad", {}, DontShowError );
 }
 
@@ -204,6 +231,7 @@ static QJsonObject serialize( const MapSettings & mapSettings )
 	QJsonObject jsMaps;
 
 	jsMaps["directory"] = mapSettings.dir;
+	jsMaps["extra_directories"] = serializeStringVec( mapSettings.extraDirs );
 
 	return jsMaps;
 }
@@ -211,6 +239,8 @@ static QJsonObject serialize( const MapSettings & mapSettings )
 static void deserialize( const JsonObjectCtx & jsMaps, MapSettings & mapSettings )
 {
 	mapSettings.dir = jsMaps.getString( "directory" );
+	if (JsonArrayCtx jsExtraDirs = jsMaps.getArray( "extra_directories", DontShowError ))
+		mapSettings.extraDirs = deserializeStringVec( jsExtraDirs );
 }
 
 static QJsonObject serialize( const ModSettings & modSettings )
@@ -243,14 +273,18 @@ static QJsonObject serialize( const LaunchOptions & opts )
 	return jsOptions;
 }
 
-static void deserialize( const JsonObjectCtx & jsOptions, LaunchOptions & opts )
+static void deserialize( const JsonObjectCtx & jsOptionsObj, LaunchOptions & opts )
 {
-	opts.mode = jsOptions.getEnum< LaunchMode >( "launch_mode", opts.mode );
-	opts.mapName = jsOptions.getString( "map_name" );
-	opts.saveFile = jsOptions.getString( "save_file" );
-	opts.mapName_demo = jsOptions.getString( "map_name_demo" );
-	opts.demoFile_record = jsOptions.getString( "demo_file_record" );
-	opts.demoFile_replay = jsOptions.getString( "demo_file_replay" );
+	enum { DemoFileRecord, DemoFileReplay, LaunchModeKey, MapName, MapNameDemo, SaveFile };
+	static constexpr JsonKeys< 6 > keys = {{ "demo_file_record", "demo_file_replay", "launch_mode", "map_name", "map_name_demo", "save_file" }};
+	JsonMembers jsOptions = jsOptionsObj.getMembers( keys );
+
+	opts.mode = jsOptions.getEnum< LaunchMode >( LaunchModeKey, opts.mode );
+	opts.mapName = jsOptions.getString( MapName );
+	opts.saveFile = jsOptions.getString( SaveFile );
+	opts.mapName_demo = jsOptions.getString( MapNameDemo );
+	opts.demoFile_record = jsOptions.getString( DemoFileRecord );
+	opts.demoFile_replay = jsOptions.getString( DemoFileReplay );
 }
 
 static QJsonObject serialize( const MultiplayerOptions & opts )
@@ -271,18 +305,25 @@ static QJsonObject serialize( const MultiplayerOptions & opts )
 	return jsOptions;
 }
 
-static void deserialize( const JsonObjectCtx & jsOptions, MultiplayerOptions & opts )
+static void deserialize( const JsonObjectCtx & jsOptionsObj, MultiplayerOptions & opts )
 {
-	opts.isMultiplayer = jsOptions.getBool( "is_multiplayer", opts.isMultiplayer );
-	opts.multRole = jsOptions.getEnum< MultRole >( "mult_role", opts.multRole );
-	opts.hostName = jsOptions.getString( "host_name" );
-	opts.port = jsOptions.getUInt16( "port", opts.port );
-	opts.netMode = jsOptions.getEnum< NetMode >( "net_mode", opts.netMode );
-	opts.gameMode = jsOptions.getEnum< GameMode >( "game_mode", opts.gameMode );
-	opts.playerCount = jsOptions.getUInt( "player_count", opts.playerCount );
-	opts.teamDamage = jsOptions.getDouble( "team_damage", opts.teamDamage );
-	opts.timeLimit = jsOptions.getUInt( "time_limit", opts.timeLimit );
-	opts.fragLimit = jsOptions.getUInt( "frag_limit", opts.fragLimit );
+	enum { FragLimit, GameModeKey, HostName, IsMultiplayer, MultRoleKey, NetModeKey, PlayerCount, Port, TeamDamage, TimeLimit };
+	static constexpr JsonKeys< 10 > keys = {{
+		"frag_limit", "game_mode", "host_name", "is_multiplayer", "mult_role",
+		"net_mode", "player_count", "port", "team_damage", "time_limit"
+	}};
+	JsonMembers jsOptions = jsOptionsObj.getMembers( keys );
+
+	opts.isMultiplayer = jsOptions.getBool( IsMultiplayer, opts.isMultiplayer );
+	opts.multRole = jsOptions.getEnum< MultRole >( MultRoleKey, opts.multRole );
+	opts.hostName = jsOptions.getString( HostName );
+	opts.port = jsOptions.getUInt16( Port, opts.port );
+	opts.netMode = jsOptions.getEnum< NetMode >( NetModeKey, opts.netMode );
+	opts.gameMode = jsOptions.getEnum< GameMode >( GameModeKey, opts.gameMode );
+	opts.playerCount = jsOptions.getUInt( PlayerCount, opts.playerCount );
+	opts.teamDamage = jsOptions.getDouble( TeamDamage, opts.teamDamage );
+	opts.timeLimit = jsOptions.getUInt( TimeLimit, opts.timeLimit );
+	opts.fragLimit = jsOptions.getUInt( FragLimit, opts.fragLimit );
 }
 
 static QJsonObject serialize( const GameplayOptions & opts )
@@ -301,16 +342,22 @@ static QJsonObject serialize( const GameplayOptions & opts )
 	return jsOptions;
 }
 
-static void deserialize( const JsonObjectCtx & jsOptions, GameplayOptions & opts )
+static void deserialize( const JsonObjectCtx & jsOptionsObj, GameplayOptions & opts )
 {
-	opts.skillIdx = jsOptions.getInt( "skill_idx", opts.skillIdx );
-	opts.skillNum = jsOptions.getInt( "skill_num", opts.skillNum );
-	opts.noMonsters = jsOptions.getBool( "no_monsters", opts.noMonsters );
-	opts.fastMonsters = jsOptions.getBool( "fast_monsters", opts.fastMonsters );
-	opts.monstersRespawn = jsOptions.getBool( "monsters_respawn", opts.monstersRespawn );
-	opts.dmflags1 = jsOptions.getInt( "dmflags1", opts.dmflags1 );
-	opts.dmflags2 = jsOptions.getInt( "dmflags2", opts.dmflags2 );
-	opts.allowCheats = jsOptions.getBool( "allow_cheats", opts.allowCheats );
+	enum { AllowCheats, DMFlags1, DMFlags2, FastMonsters, MonstersRespawn, NoMonsters, SkillIdx, SkillNum };
+	static constexpr JsonKeys< 8 > keys = {{
+		"allow_cheats", "dmflags1", "dmflags2", "fast_monsters", "monsters_respawn", "no_monsters", "skill_idx", "skill_num"
+	}};
+	JsonMembers jsOptions = jsOptionsObj.getMembers( keys );
+
+	opts.skillIdx = jsOptions.getInt( SkillIdx, opts.skillIdx );
+	opts.skillNum = jsOptions.getInt( SkillNum, opts.skillNum );
+	opts.noMonsters = jsOptions.getBool( NoMonsters, opts.noMonsters );
+	opts.fastMonsters = jsOptions.getBool( FastMonsters, opts.fastMonsters );
+	opts.monstersRespawn = jsOptions.getBool( MonstersRespawn, opts.monstersRespawn );
+	opts.dmflags1 = jsOptions.getInt( DMFlags1, opts.dmflags1 );
+	opts.dmflags2 = jsOptions.getInt( DMFlags2, opts.dmflags2 );
+	opts.allowCheats = jsOptions.getBool( AllowCheats, opts.allowCheats );
 }
 
 static QJsonObject serialize( const CompatibilityOptions & opts )
@@ -324,11 +371,15 @@ static QJsonObject serialize( const CompatibilityOptions & opts )
 	return jsOptions;
 }
 
-static void deserialize( const JsonObjectCtx & jsOptions, CompatibilityOptions & opts )
+static void deserialize( const JsonObjectCtx & jsOptionsObj, CompatibilityOptions & opts )
 {
-	opts.compatflags1 = jsOptions.getInt( "compatflags1", opts.compatflags1 );
-	opts.compatflags2 = jsOptions.getInt( "compatflags2", opts.compatflags2 );
-	opts.compatLevel = jsOptions.getInt( "compat_level", opts.compatLevel );
+	enum { CompatLevel, CompatFlags1, CompatFlags2 };
+	static constexpr JsonKeys< 3 > keys = {{ "compat_level", "compatflags1", "compatflags2" }};
+	JsonMembers jsOptions = jsOptionsObj.getMembers( keys );
+
+	opts.compatflags1 = jsOptions.getInt( CompatFlags1, opts.compatflags1 );
+	opts.compatflags2 = jsOptions.getInt( CompatFlags2, opts.compatflags2 );
+	opts.compatLevel = jsOptions.getInt( CompatLevel, opts.compatLevel );
 }
 
 static QJsonObject serialize( const AlternativePaths & opts )
@@ -341,10 +392,14 @@ static QJsonObject serialize( const AlternativePaths & opts )
 	return jsOptions;
 }
 
-static void deserialize( const JsonObjectCtx & jsOptions, AlternativePaths & opts )
+static void deserialize( const JsonObjectCtx & jsOptionsObj, AlternativePaths & opts )
 {
-	opts.saveDir = jsOptions.getString( "save_dir" );
-	opts.screenshotDir = jsOptions.getString( "screenshot_dir" );
+	enum { SaveDir, ScreenshotDir };
+	static constexpr JsonKeys< 2 > keys = {{ "save_dir", "screenshot_dir" }};
+	JsonMembers jsOptions = jsOptionsObj.getMembers( keys );
+
+	opts.saveDir = jsOptions.getString( SaveDir );
+	opts.screenshotDir = jsOptions.getString( ScreenshotDir );
 }
 
 static QJsonObject serialize( const VideoOptions & opts )
@@ -359,12 +414,16 @@ static QJsonObject serialize( const VideoOptions & opts )
 	return jsOptions;
 }
 
-static void deserialize( const JsonObjectCtx & jsOptions, VideoOptions & opts )
+static void deserialize( const JsonObjectCtx & jsOptionsObj, VideoOptions & opts )
 {
-	opts.monitorIdx = jsOptions.getInt( "monitor_idx", opts.monitorIdx );
-	opts.resolutionX = jsOptions.getUInt( "resolution_x", opts.resolutionX );
-	opts.resolutionY = jsOptions.getUInt( "resolution_y", opts.resolutionY );
-	opts.showFPS = jsOptions.getBool( "show_fps", opts.showFPS );
+	enum { MonitorIdx, ResolutionX, ResolutionY, ShowFPS };
+	static constexpr JsonKeys< 4 > keys = {{ "monitor_idx", "resolution_x", "resolution_y", "show_fps" }};
+	JsonMembers jsOptions = jsOptionsObj.getMembers( keys );
+
+	opts.monitorIdx = jsOptions.getInt( MonitorIdx, opts.monitorIdx );
+	opts.resolutionX = jsOptions.getUInt( ResolutionX, opts.resolutionX );
+	opts.resolutionY = jsOptions.getUInt( ResolutionY, opts.resolutionY );
+	opts.showFPS = jsOptions.getBool( ShowFPS, opts.showFPS );
 }
 
 static QJsonObject serialize( const AudioOptions & opts )
@@ -378,11 +437,15 @@ static QJsonObject serialize( const AudioOptions & opts )
 	return jsOptions;
 }
 
-static void deserialize( const JsonObjectCtx & jsOptions, AudioOptions & opts )
+static void deserialize( const JsonObjectCtx & jsOptionsObj, AudioOptions & opts )
 {
-	opts.noSound = jsOptions.getBool( "no_sound", opts.noSound );
-	opts.noSFX = jsOptions.getBool( "no_sfx", opts.noSFX );
-	opts.noMusic = jsOptions.getBool( "no_music", opts.noMusic );
+	enum { NoMusic, NoSFX, NoSound };
+	static constexpr JsonKeys< 3 > keys = {{ "no_music", "no_sfx", "no_sound" }};
+	JsonMembers jsOptions = jsOptionsObj.getMembers( keys );
+
+	opts.noSound = jsOptions.getBool( NoSound, opts.noSound );
+	opts.noSFX = jsOptions.getBool( NoSFX, opts.noSFX );
+	opts.noMusic = jsOptions.getBool( NoMusic, opts.noMusic );
 }
 
 static QJsonObject serialize( const GlobalOptions & opts )
@@ -404,7 +467,130 @@ static void deserialize( const JsonObjectCtx & jsOptions, GlobalOptions & opts )
 		deserialize( jsEnvVars, opts.envVars );
 }
 
-static QJsonObject serialize( const Preset & preset, const StorageSettings & settings )
+//----------------------------------------------------------------------------------------------------------------------
+//  sharing of identical lists
+
+// Clones and generated preset libraries mostly differ in one or two fields and have the same lists.
+// Qt containers are implicitly shared, so instead of keeping thousands of equal copies, the presets can share one,
+// which gets detached (copied) only when one of the presets is edited.
+
+static bool isSameMod( const Mod & a, const Mod & b )
+{
+	return a.path == b.path && a.fileName == b.fileName && a.checked == b.checked
+	    && a.isCmdArg == b.isCmdArg && a.isSeparator == b.isSeparator;
+}
+
+/// Remembers the recently deserialized lists and replaces an equal list with the remembered instance.
+template< typename List >
+class ListSharer {
+
+	static constexpr int maxLists = 16;  ///< the clones are usually next to each other, no need to remember them all
+	QList< List > _recentLists;
+
+ public:
+
+	template< typename Equals >
+	void share( List & list, const Equals & isSameElem )
+	{
+		if (list.isEmpty())
+			return;  // empty containers don't allocate anything
+
+		for (int i = 0; i < _recentLists.size(); ++i)
+		{
+			const List & recentList = _recentLists[i];
+			if (recentList.size() == list.size() && std::equal( recentList.begin(), recentList.end(), list.begin(), isSameElem ))
+			{
+				list = recentList;  // from now on they share the same data
+				_recentLists.move( i, 0 );
+				return;
+			}
+		}
+
+		_recentLists.prepend( list );
+		if (_recentLists.size() > maxLists)
+			_recentLists.removeLast();
+	}
+
+};
+
+static void shareIdenticalLists( Preset & preset )
+{
+	// the presets can be deserialized from multiple threads at once
+	thread_local ListSharer< QList< Mod > > modLists;
+	thread_local ListSharer< QStringVec > mapPackLists;
+	thread_local ListSharer< EnvVars > envVarLists;
+
+	modLists.share( preset.mods, isSameMod );
+	mapPackLists.share( preset.selectedMapPacks, std::equal_to< QString >() );
+	envVarLists.share( preset.envVars, std::equal_to< os::EnvVar >() );
+}
+
+/// Serializes a list of mods, reusing the JSON of the previous preset if both presets share the same list.
+static QJsonArray serializeModList( const QList< Mod > & mods )
+{
+	thread_local QList< Mod > lastMods;
+	thread_local QJsonArray lastJsMods;
+
+	if (mods.isEmpty() || !mods.isSharedWith( lastMods ))
+	{
+		lastJsMods = serializeList( mods );
+		lastMods = mods;
+	}
+	return lastJsMods;  // implicitly shared as well, the same array is then written into all the presets
+}
+
+/// The map packs inside one of the map directories are stored relative to it, as {"root": index, "path": relative path},
+/// so that the directory can be moved (e.g. a disk mounted elsewhere) by updating only the map settings.
+/** The others are stored as plain paths, which is also the format of the older versions. */
+static QJsonArray serializeMapPacks( const QStringVec & mapPacks, const QStringVec & mapDirs )
+{
+	QJsonArray jsMapPacks;
+	for (const QString & mapPack : mapPacks)
+	{
+		QJsonObject jsMapPack;
+		for (int rootIdx = 0; rootIdx < mapDirs.size(); ++rootIdx)
+		{
+			QString relPath = QDir( mapDirs[ rootIdx ] ).relativeFilePath( mapPack );
+			if (!relPath.startsWith("../") && relPath != ".." && fs::isRelativePath( relPath ))  // otherwise it's outside (or on another drive)
+			{
+				jsMapPack["root"] = rootIdx;
+				jsMapPack["path"] = relPath;
+				break;
+			}
+		}
+		if (!jsMapPack.isEmpty())
+			jsMapPacks.append( jsMapPack );
+		else
+			jsMapPacks.append( mapPack );
+	}
+	return jsMapPacks;
+}
+
+static QStringVec deserializeMapPacks( const JsonArrayCtx & jsMapPacks, const QStringVec & mapDirs )
+{
+	QStringVec mapPacks;
+	for (int i = 0; i < jsMapPacks.size(); i++)
+	{
+		QString mapPack;
+		if (jsMapPacks.wrappedArray()[i].isString())  // older format or outside of the map directories
+		{
+			mapPack = jsMapPacks.getString( i );
+		}
+		else if (JsonObjectCtx jsMapPack = jsMapPacks.getObject( i ))
+		{
+			int rootIdx = jsMapPack.getInt( "root", -1 );
+			mapPack = jsMapPack.getString( "path" );
+			// if the directory has been removed since, keep the path as it is, it will be reported as missing
+			if (rootIdx >= 0 && rootIdx < mapDirs.size() && !mapPack.isEmpty())
+				mapPack = fs::getPathFromFileName( mapDirs[ rootIdx ], mapPack );
+		}
+		if (!mapPack.isEmpty())
+			mapPacks.append( g_pathPool.intern( mapPack ) );
+	}
+	return mapPacks;
+}
+
+static QJsonObject serialize( const Preset & preset, const StorageSettings & settings, const QStringVec & mapDirs )
 {
 	QJsonObject jsPreset;
 
@@ -422,9 +608,9 @@ static QJsonObject serialize( const Preset & preset, const StorageSettings & set
 	jsPreset["selected_config"] = preset.selectedConfig;
 	jsPreset["selected_IWAD"] = preset.selectedIWAD;
 
-	jsPreset["selected_mappacks"] = serializeStringVec( preset.selectedMapPacks );
+	jsPreset["selected_mappacks"] = serializeMapPacks( preset.selectedMapPacks, mapDirs );
 
-	jsPreset["mods"] = serializeList( preset.mods );
+	jsPreset["mods"] = serializeModList( preset.mods );
 
 	// options
 
@@ -453,14 +639,61 @@ static QJsonObject serialize( const Preset & preset, const StorageSettings & set
 	jsPreset["additional_args"] = preset.cmdArgs;
 	jsPreset["env_vars"] = serialize( preset.envVars );
 
+	if (!preset.lastLoadPhases.isEmpty())
+		jsPreset["last_load_phases"] = preset.lastLoadPhases;
+
 	return jsPreset;
 }
 
-static void deserialize( const JsonObjectCtx & jsPreset, Preset & preset, const StorageSettings & settings )
+/// keys of a preset object, in the order of QJsonObject
+enum PresetKey
+{
+	AdditionalArgsKey,
+	AlternativePathsKey,
+	AudioOptionsKey,
+	CompatibilityOptionsKey,
+	EnvVarsKey,
+	GameplayOptionsKey,
+	LastLoadPhasesKey,
+	LaunchOptionsKey,
+	ModsKey,
+	MultiplayerOptionsKey,
+	NameKey,
+	SelectedIWADKey,
+	SelectedConfigKey,
+	SelectedEngineKey,
+	SelectedMapPacksKey,
+	SeparatorKey,
+	VideoOptionsKey,
+	_PresetKeyCount
+};
+static constexpr JsonKeys< _PresetKeyCount > presetKeys = {{
+	"additional_args",
+	"alternative_paths",
+	"audio_options",
+	"compatibility_options",
+	"env_vars",
+	"gameplay_options",
+	"last_load_phases",
+	"launch_options",
+	"mods",
+	"multiplayer_options",
+	"name",
+	"selected_IWAD",
+	"selected_config",
+	"selected_engine",
+	"selected_mappacks",
+	"separator",
+	"video_options",
+}};
+
+static void deserialize( const JsonObjectCtx & jsPresetObj, Preset & preset, const StorageSettings & settings, const QStringVec & mapDirs )
 {
-	preset.name = jsPreset.getString( "name", "<missing name>" );
+	JsonMembers jsPreset = jsPresetObj.getMembers( presetKeys );
 
-	preset.isSeparator = jsPreset.getBool( "separator", false, DontShowError );
+	preset.name = jsPreset.getString( NameKey, "<missing name>" );
+
+	preset.isSeparator = jsPreset.getBool( SeparatorKey, false, DontShowError );
 	if (preset.isSeparator)
 	{
 		return;
@@ -468,16 +701,14 @@ static void deserialize( const JsonObjectCtx & jsPreset, Preset & preset, const
 
 	// files
 
-	preset.selectedEnginePath = jsPreset.getString( "selected_engine" );
-	preset.selectedConfig = jsPreset.getString( "selected_config" );
-	preset.selectedIWAD = jsPreset.getString( "selected_IWAD" );
+	preset.selectedEnginePath = g_pathPool.intern( jsPreset.getString( SelectedEngineKey ) );
+	preset.selectedConfig = jsPreset.getString( SelectedConfigKey );
+	preset.selectedIWAD = g_pathPool.intern( jsPreset.getString( SelectedIWADKey ) );
 
-	if (JsonArrayCtx jsSelectedMapPacks = jsPreset.getArray( "selected_mappacks" ))
-	{
-		preset.selectedMapPacks = deserializeStringVec( jsSelectedMapPacks );
-	}
+	if (JsonArrayCtx jsSelectedMapPacks = jsPreset.getArray( SelectedMapPacksKey ))
+		preset.selectedMapPacks = deserializeMapPacks( jsSelectedMapPacks, mapDirs );
 
-	if (JsonArrayCtx jsMods = jsPreset.getArray( "mods" ))
+	if (JsonArrayCtx jsMods = jsPreset.getArray( ModsKey ))
 	{
 		// iterate manually, so that we can filter-out invalid items
 		for (int i = 0; i < jsMods.size(); i++)
@@ -506,37 +737,72 @@ static void deserialize( const JsonObjectCtx & jsPreset, Preset & preset, const
 	// options
 
 	if (settings.launchOptsStorage == StoreToPreset)
-		if (JsonObjectCtx jsOptions = jsPreset.getObject( "launch_options" ))
+		if (JsonObjectCtx jsOptions = jsPreset.getObject( LaunchOptionsKey ))
 			deserialize( jsOptions, preset.launchOpts );
 
 	if (settings.launchOptsStorage == StoreToPreset)
-		if (JsonObjectCtx jsOptions = jsPreset.getObject( "multiplayer_options" ))
+		if (JsonObjectCtx jsOptions = jsPreset.getObject( MultiplayerOptionsKey ))
 			deserialize( jsOptions, preset.multOpts );
 
 	if (settings.gameOptsStorage == StoreToPreset)
-		if (JsonObjectCtx jsOptions = jsPreset.getObject( "gameplay_options" ))
+		if (JsonObjectCtx jsOptions = jsPreset.getObject( GameplayOptionsKey ))
 			deserialize( jsOptions, preset.gameOpts );
 
 	if (settings.compatOptsStorage == StoreToPreset)
-		if (JsonObjectCtx jsOptions = jsPreset.getObject( "compatibility_options" ))
+		if (JsonObjectCtx jsOptions = jsPreset.getObject( CompatibilityOptionsKey ))
 			deserialize( jsOptions, preset.compatOpts );
 
 	if (settings.videoOptsStorage == StoreToPreset)
-		if (JsonObjectCtx jsOptions = jsPreset.getObject( "video_options" ))
+		if (JsonObjectCtx jsOptions = jsPreset.getObject( VideoOptionsKey ))
 			deserialize( jsOptions, preset.videoOpts );
 
 	if (settings.audioOptsStorage == StoreToPreset)
-		if (JsonObjectCtx jsOptions = jsPreset.getObject( "audio_options" ))
+		if (JsonObjectCtx jsOptions = jsPreset.getObject( AudioOptionsKey ))
 			deserialize( jsOptions, preset.audioOpts );
 
-	if (JsonObjectCtx jsOptions = jsPreset.getObject( "alternative_paths" ))
+	if (JsonObjectCtx jsOptions = jsPreset.getObject( AlternativePathsKey ))
 		deserialize( jsOptions, preset.altPaths );
 
 	// preset-specific args
 
-	preset.cmdArgs = jsPreset.getString( "additional_args" );
-	if (JsonObjectCtx jsEnvVars = jsPreset.getObject( "env_vars" ))
+	preset.cmdArgs = jsPreset.getString( AdditionalArgsKey );
+	if (JsonObjectCtx jsEnvVars = jsPreset.getObject( EnvVarsKey ))
 		deserialize( jsEnvVars, preset.envVars );
+
+	preset.lastLoadPhases = jsPreset.getString( LastLoadPhasesKey, {}, DontShowError );
+
+	shareIdenticalLists( preset );
+}
+
+/// Loads only what's needed to display the preset in the list, and keeps the rest for loadPresetContent().
+static void deserializeLazily( const JsonObjectCtx & jsPresetObj, Preset & preset )
+{
+	enum { Name, Separator };
+	static constexpr JsonKeys< 2 > keys = {{ "name", "separator" }};
+	JsonMembers jsPreset = jsPresetObj.getMembers( keys );
+
+	preset.name = jsPreset.getString( Name, "<missing name>" );
+
+	preset.isSeparator = jsPreset.getBool( Separator, false, DontShowError );
+	if (preset.isSeparator)
+	{
+		return;  // nothing more to load
+	}
+
+	preset.unloadedJson = jsPresetObj.wrappedObject();  // implicitly shared, no deep copy
+}
+
+void loadPresetContent( Preset & preset, const StorageSettings & settings, const MapSettings & mapSettings, const QString & optionsFilePath )
+{
+	if (preset.isLoaded())
+		return;
+
+	JsonDocumentCtx jsonDoc( optionsFilePath, QJsonDocument( preset.unloadedJson ) );
+	preset.unloadedJson = QJsonObject();
+
+	QString name = std::move( preset.name );  // the preset might have been renamed in the meantime
+	deserialize( jsonDoc.rootObject(), preset, settings, mapSettings.getDirs() );
+	preset.name = std::move( name );
 }
 
 static QJsonObject serialize( const WindowGeometry & geometry )
@@ -565,6 +831,11 @@ static void serialize( QJsonObject & jsSettings, const LauncherSettings & settin
 	jsSettings["close_on_launch"] = settings.closeOnLaunch;
 	jsSettings["check_for_updates"] = settings.checkForUpdates;
 	jsSettings["ask_for_sandbox_permissions"] = settings.askForSandboxPermissions;
+	jsSettings["poll_directories"] = settings.pollDirectories;
+	jsSettings["prewarm_files"] = settings.prewarmFiles;
+	jsSettings["share_file_cache"] = settings.shareFileCache;
+	jsSettings["log_engine_output"] = settings.logEngineOutput;
+	jsSettings["max_cached_files"] = settings.maxCachedFiles;
 
 	{
 		QJsonObject jsOptsStorage;
@@ -593,6 +864,11 @@ static void deserialize( const JsonObjectCtx & jsSettings, LauncherSettings & se
 	settings.closeOnLaunch = jsSettings.getBool( "close_on_launch", settings.closeOnLaunch, DontShowError );
 	settings.checkForUpdates = jsSettings.getBool( "check_for_updates", settings.checkForUpdates, DontShowError );
 	settings.askForSandboxPermissions = jsSettings.getBool( "ask_for_sandbox_permissions", settings.askForSandboxPermissions, DontShowError );
+	settings.pollDirectories = jsSettings.getBool( "poll_directories", settings.pollDirectories, DontShowError );
+	settings.prewarmFiles = jsSettings.getBool( "prewarm_files", settings.prewarmFiles, DontShowError );
+	settings.shareFileCache = jsSettings.getBool( "share_file_cache", settings.shareFileCache, DontShowError );
+	settings.logEngineOutput = jsSettings.getBool( "log_engine_output", settings.logEngineOutput, DontShowError );
+	settings.maxCachedFiles = jsSettings.getInt( "max_cached_files", settings.maxCachedFiles, DontShowError );
 
 	if (JsonObjectCtx jsOptsStorage = jsSettings.getObject( "options_storage" ))
 	{
@@ -608,7 +884,16 @@ static void deserialize( const JsonObjectCtx & jsSettings, LauncherSettings & se
 //======================================================================================================================
 //  top-level JSON stucture
 
-static void serialize( QJsonObject & jsOpts, const OptionsToSave & opts )
+static bool isSameStorage( const StorageSettings & a, const StorageSettings & b )
+{
+	return a.launchOptsStorage == b.launchOptsStorage
+	    && a.gameOptsStorage == b.gameOptsStorage
+	    && a.compatOptsStorage == b.compatOptsStorage
+	    && a.videoOptsStorage == b.videoOptsStorage
+	    && a.audioOptsStorage == b.audioOptsStorage;
+}
+
+static void serialize( QJsonObject & jsOpts, const OptionsToSave & opts, OptionsWriteCache & cache )
 {
 	// files and related settings
 
@@ -616,7 +901,9 @@ static void serialize( QJsonObject & jsOpts, const OptionsToSave & opts )
 		// better keep room for adding some engine settings later, so that we don't have to break compatibility again
 		QJsonObject jsEngines = serialize( opts.engineSettings );
 
-		jsEngines["engine_list"] = serializeList( opts.engines );  // serializes only Engine fields, leaves other EngineInfo fields alone
+		if (!cache.engineList)
+			cache.engineList = serializeList( opts.engines );  // serializes only Engine fields, leaves other EngineInfo fields alone
+		jsEngines["engine_list"] = *cache.engineList;
 
 		jsOpts["engines"] = jsEngines;
 	}
@@ -625,7 +912,11 @@ static void serialize( QJsonObject & jsOpts, const OptionsToSave & opts )
 		QJsonObject jsIWADs = serialize( opts.iwadSettings );
 
 		if (!opts.iwadSettings.updateFromDir)
-			jsIWADs["IWAD_list"] = serializeList( opts.iwads );
+		{
+			if (!cache.iwadList)
+				cache.iwadList = serializeList( opts.iwads );
+			jsIWADs["IWAD_list"] = *cache.iwadList;
+		}
 
 		jsOpts["IWADs"] = jsIWADs;
 	}
@@ -659,12 +950,30 @@ static void serialize( QJsonObject & jsOpts, const OptionsToSave & opts )
 	// presets
 
 	{
+		// which options are serialized into the presets depends on the storage settings
+		bool storageChanged = !isSameStorage( opts.settings, cache.presetStorage );
+		cache.presetStorage = opts.settings;
+		// the selected map packs are stored relative to the map directories
+		QStringVec mapDirs = opts.mapSettings.getDirs();
+		bool mapDirsChanged = mapDirs != cache.presetMapDirs;
+		cache.presetMapDirs = mapDirs;
+
 		QJsonArray jsPresetArray;
 
 		for (const Preset & preset : opts.presets)
 		{
-			QJsonObject jsPreset = serialize( preset, opts.settings );
-			jsPresetArray.append( jsPreset );
+			if (!preset.isLoaded())
+			{
+				// Never touched since it was read, so it can be written back as it was, only the name might have changed.
+				// Storage settings and map directories can't have changed in the meantime, the presets are all loaded before that.
+				QJsonObject jsPreset = preset.unloadedJson;
+				jsPreset["name"] = preset.name;
+				jsPresetArray.append( jsPreset );
+				continue;
+			}
+			if (preset.serializedJson.isEmpty() || storageChanged || mapDirsChanged)  // a serialized preset always has at least a name
+				preset.serializedJson = serialize( preset, opts.settings, mapDirs );
+			jsPresetArray.append( preset.serializedJson );  // implicitly shared, no deep copy
 		}
 
 		jsOpts["presets"] = jsPresetArray;
@@ -679,6 +988,34 @@ static void serialize( QJsonObject & jsOpts, const OptionsToSave & opts )
 	jsOpts["geometry"] = serialize( opts.geometry );
 }
 
+/// Deserializes an entry of the engine list, returns false if it's invalid and should be skipped.
+static bool deserializeListEntry( const JsonObjectCtx & jsEngine, Engine & engine )
+{
+	deserialize( jsEngine, engine );
+
+	if (engine.executablePath.isEmpty())  // element isn't present in JSON -> skip this entry
+		return false;
+
+	if (!PathChecker::checkFilePath( engine.executablePath, true, "an Engine from the saved options", "Please update it in Menu -> Initial Setup." ))
+		highlightInvalidListItem( engine );
+
+	return true;
+}
+
+/// Deserializes an entry of the IWAD list, returns false if it's invalid and should be skipped.
+static bool deserializeListEntry( const JsonObjectCtx & jsIWAD, IWAD & iwad )
+{
+	deserialize( jsIWAD, iwad );
+
+	if (iwad.name.isEmpty() || iwad.path.isEmpty())  // element isn't present in JSON -> skip this entry
+		return false;
+
+	if (!PathChecker::checkFilePath( iwad.path, true, "an IWAD from the saved options", "Please update it in Menu -> Initial Setup." ))
+		highlightInvalidListItem( iwad );
+
+	return true;
+}
+
 static void deserialize( const JsonObjectCtx & jsOpts, OptionsToLoad & opts )
 {
 	// global settings
@@ -707,14 +1044,9 @@ static void deserialize( const JsonObjectCtx & jsOpts, OptionsToLoad & opts )
 					continue;
 
 				Engine engine;
-				deserialize( jsEngine, engine );
-
-				if (engine.executablePath.isEmpty())  // element isn't present in JSON -> skip this entry
+				if (!deserializeListEntry( jsEngine, engine ))
 					continue;
 
-				if (!PathChecker::checkFilePath( engine.executablePath, true, "an Engine from the saved options", "Please update it in Menu -> Initial Setup." ))
-					highlightInvalidListItem( engine );
-
 				opts.engines.append( std::move( engine ) );  // populates only Engine fields, leaves other EngineInfo fields empty
 			}
 		}
@@ -727,6 +1059,8 @@ static void deserialize( const JsonObjectCtx & jsOpts, OptionsToLoad & opts )
 		if (opts.iwadSettings.updateFromDir)
 		{
 			PathChecker::checkNonEmptyDirPath( opts.iwadSettings.dir, true, "IWAD directory from the saved options", "Please update it in Menu -> Initial Setup." );
+			for (const QString & extraDir : opts.iwadSettings.extraDirs)
+				PathChecker::checkNonEmptyDirPath( extraDir, true, "additional IWAD directory from the saved options", "Please update it in Menu -> Initial Setup." );
 		}
 		else
 		{
@@ -740,14 +1074,9 @@ static void deserialize( const JsonObjectCtx & jsOpts, OptionsToLoad & opts )
 						continue;
 
 					IWAD iwad;
-					deserialize( jsIWAD, iwad );
-
-					if (iwad.name.isEmpty() || iwad.path.isEmpty())  // element isn't present in JSON -> skip this entry
+					if (!deserializeListEntry( jsIWAD, iwad ))
 						continue;
 
-					if (!PathChecker::checkFilePath( iwad.path, true, "an IWAD from the saved options", "Please update it in Menu -> Initial Setup." ))
-						highlightInvalidListItem( iwad );
-
 					opts.iwads.append( std::move( iwad ) );
 				}
 			}
@@ -759,6 +1088,8 @@ static void deserialize( const JsonObjectCtx & jsOpts, OptionsToLoad & opts )
 		deserialize( jsMaps, opts.mapSettings );
 
 		PathChecker::checkNonEmptyDirPath( opts.mapSettings.dir, true, "map directory from the saved options", "Please update it in Menu -> Initial Setup." );
+		for (const QString & extraDir : opts.mapSettings.extraDirs)
+			PathChecker::checkNonEmptyDirPath( extraDir, true, "additional map directory from the saved options", "Please update it in Menu -> Initial Setup." );
 	}
 
 	if (JsonObjectCtx jsMods = jsOpts.getObject( "mods" ))
@@ -801,6 +1132,8 @@ static void deserialize( const JsonObjectCtx & jsOpts, OptionsToLoad & opts )
 
 	if (JsonArrayCtx jsPresetArray = jsOpts.getArray( "presets" ))
 	{
+		const QStringVec mapDirs = opts.mapSettings.getDirs();  // the selected map packs are stored relative to them
+
 		for (int i = 0; i < jsPresetArray.size(); i++)
 		{
 			JsonObjectCtx jsPreset = jsPresetArray.getObject( i );
@@ -808,7 +1141,10 @@ static void deserialize( const JsonObjectCtx & jsOpts, OptionsToLoad & opts )
 				continue;
 
 			Preset preset;
-			deserialize( jsPreset, preset, opts.settings );
+			if (opts.loadPresetsLazily)
+				deserializeLazily( jsPreset, preset );
+			else
+				deserialize( jsPreset, preset, opts.settings, mapDirs );
 
 			opts.presets.append( std::move( preset ) );
 		}
@@ -827,14 +1163,15 @@ static void deserialize( const JsonObjectCtx & jsOpts, OptionsToLoad & opts )
 //======================================================================================================================
 //  JSON document and version handling
 
-static QJsonDocument serializeOptionsToJsonDoc( const OptionsToSave & opts )
+static QJsonDocument serializeOptionsToJsonDoc( const OptionsToSave & opts, OptionsWriteCache & cache )
 {
 	QJsonObject jsRoot;
 
 	// this will be used to detect options created by older versions and supress "missing element" warnings
 	jsRoot["version"] = appVersion;
+	jsRoot["schema_version"] = optionsSchemaVersion;
 
-	serialize( jsRoot, opts );
+	serialize( jsRoot, opts, cache );
 
 	return QJsonDocument( jsRoot );
 }
@@ -845,54 +1182,262 @@ static void deserializeOptionsFromJsonDoc( const JsonDocumentCtx & jsonDoc, Opti
 	// we want to print a useful error message with information exactly which JSON element is broken.
 	const JsonObjectCtx & jsRoot = jsonDoc.rootObject();
 
-	QString optsVersionStr = jsRoot.getString( "version", {}, DontShowError );
-	Version optsVersion( optsVersionStr );
-
-	if (!optsVersionStr.isEmpty() && optsVersion > appVersion)  // empty version means pre-1.4 version
-	{
-		reportRuntimeError( nullptr, "Loading options from newer version",
-			"Detected saved options from newer version of DoomRunner. "
-			"Some settings might not be compatible. Expect errors."
-		);
-	}
-
-	// backward compatibility with older options format
-	if (optsVersionStr.isEmpty() || optsVersion < Version(1,7))
+	// A file in the current format is recognized by a single number and is loaded by the current parser only.
+	// Anything else goes through the migration once, and is then written back in the current format.
+	int schemaVersion = jsRoot.getInt( "schema_version", 0, DontShowError );
+	if (schemaVersion == optionsSchemaVersion)
 	{
-		jsonDoc.disableWarnings();  // supress "missing element" warnings when loading older version
-
-		// try to load as the 1.6.3 format, older versions will have to accept resetting some values to defaults
-		deserialize_pre17( opts, jsRoot );
+		deserialize( jsRoot, opts );
 	}
 	else
 	{
-		if (optsVersion < appVersion)
-			jsonDoc.disableWarnings();  // supress "missing element" warnings when loading older version
-
-		deserialize( jsRoot, opts );
+		deserializeOlderSchema( jsonDoc, opts, schemaVersion );
 	}
 }
 
 
+//======================================================================================================================
+//  binary sidecar
+
+// Parsing a large JSON text takes a while, so the same document is also stored in CBOR next to the JSON file.
+// It is only used when it was written after the JSON and was created from this exact JSON content,
+// so that the JSON stays the source of truth, and any manual edit of it takes precedence.
+
+static const char sidecarSuffix [] = "cbor";
+
+QString getOptionsSidecarPath( const QString & optionsFilePath )
+{
+	return fs::replaceFileSuffix( optionsFilePath, sidecarSuffix );
+}
+
+static QByteArray serializeSidecar( const QJsonDocument & jsonDoc, const QByteArray & jsonHash )
+{
+	QCborMap cborRoot;
+	cborRoot.insert( QLatin1String("json_hash"), jsonHash );
+	cborRoot.insert( QLatin1String("options"), QCborMap::fromJsonObject( jsonDoc.object() ) );
+	return QCborValue( cborRoot ).toCbor();
+}
+
+/// Returns null document if the sidecar doesn't exist or isn't up to date with the JSON file.
+static QJsonDocument readUpToDateSidecar( const QString & jsonFilePath )
+{
+	QString sidecarPath = getOptionsSidecarPath( jsonFilePath );
+	QFileInfo sidecarInfo( sidecarPath );
+	if (!sidecarInfo.isFile() || sidecarInfo.lastModified() < QFileInfo( jsonFilePath ).lastModified())
+		return {};  // the JSON has been modified since, or it's an old installation
+
+	QByteArray jsonBytes, sidecarBytes;
+	if (!fs::readWholeFile( jsonFilePath, jsonBytes ).isEmpty() || !fs::readWholeFile( sidecarPath, sidecarBytes ).isEmpty())
+		return {};  // let the JSON path report the error
+
+	QCborParserError parseError;
+	QCborMap cborRoot = QCborValue::fromCbor( sidecarBytes, &parseError ).toMap();
+	if (parseError.error != QCborError::NoError)
+		return {};  // it's just a cache, it will be overwritten on the next save
+
+	// The modification times alone can't be trusted, some file systems store them with 2 seconds precision.
+	if (cborRoot.value( QLatin1String("json_hash") ).toByteArray() != QCryptographicHash::hash( jsonBytes, QCryptographicHash::Md5 ))
+		return {};
+
+	// Since Qt 5.15 the JSON classes are built on top of the CBOR containers, so this conversion doesn't re-parse anything.
+	return QJsonDocument( cborRoot.value( QLatin1String("options") ).toMap().toJsonObject() );
+}
+
+
 //======================================================================================================================
 //  top-level API
 
-bool writeOptionsToFile( const OptionsToSave & opts, const QString & filePath )
+OptionsFileContent serializeOptions( const OptionsToSave & opts, OptionsWriteCache & cache )
 {
-	QJsonDocument jsonDoc = serializeOptionsToJsonDoc( opts );
+	ScopeTimer timer( "serializing options" );
+
+	QJsonDocument jsonDoc = serializeOptionsToJsonDoc( opts, cache );
+	QByteArray jsonBytes = jsonDoc.toJson();
 
-	return writeJsonToFile( jsonDoc, filePath, "options" );
+	// Many changes don't end up in the file at all (for example a value was changed and then changed back),
+	// so don't wear out the disk by rewriting it with the same content.
+	QByteArray fileHash = QCryptographicHash::hash( jsonBytes, QCryptographicHash::Md5 );
+	if (fileHash == cache.fileHash)
+		return {};
+
+	cache.fileHash = fileHash;
+	return { std::move(jsonBytes), serializeSidecar( jsonDoc, fileHash ) };
 }
 
 bool readOptionsFromFile( OptionsToLoad & opts, const QString & filePath )
 {
-	JsonDocumentCtx jsonDoc = readJsonFromFile( filePath, "options" );
-	if (!jsonDoc)
+	return deserializeOptions( opts, parseOptionsFile( filePath ) );
+}
+
+ParsedOptionsFile parseOptionsFile( const QString & filePath )
+{
+	ScopeTimer timer( "parsing options" );
+
+	ParsedOptionsFile parsedFile;
+	parsedFile.filePath = filePath;
+
+	parsedFile.jsonDoc = readUpToDateSidecar( filePath );
+	if (parsedFile.jsonDoc.isNull())
+	{
+		parsedFile.error = parseJsonFile( filePath, "options", CheckIfEmpty, parsedFile.jsonDoc );
+	}
+
+	return parsedFile;
+}
+
+bool deserializeOptions( OptionsToLoad & opts, const ParsedOptionsFile & parsedFile )
+{
+	ScopeTimer timer( "deserializing options" );
+
+	if (!parsedFile.error.isEmpty())
 	{
+		reportRuntimeError( nullptr, "Error loading options", parsedFile.error );
 		return false;
 	}
 
+	// when the document comes from the sidecar, the errors should still point the user to the JSON file
+	JsonDocumentCtx jsonDoc( parsedFile.filePath, parsedFile.jsonDoc );
 	deserializeOptionsFromJsonDoc( jsonDoc, opts );
 
 	return true;
 }
+
+ParsedOptionsFile parseOptionsFileUnlessKnown( const QString & filePath, const QList< QByteArray > & knownHashes )
+{
+	ParsedOptionsFile parsedFile;
+	parsedFile.filePath = filePath;
+
+	QByteArray jsonBytes;
+	parsedFile.error = fs::readWholeFile( filePath, jsonBytes );
+	if (!parsedFile.error.isEmpty())
+		return parsedFile;
+
+	// the same hash as serializeOptions() stores into OptionsWriteCache::fileHash
+	if (knownHashes.contains( QCryptographicHash::hash( jsonBytes, QCryptographicHash::Md5 ) ))
+	{
+		parsedFile.isKnownContent = true;
+		return parsedFile;
+	}
+
+	ScopeTimer timer( "parsing modified options" );
+
+	parsedFile.error = parseJsonFileContent( jsonBytes, filePath, "options", CheckIfEmpty, parsedFile.jsonDoc );
+
+	return parsedFile;
+}
+
+
+//======================================================================================================================
+//  external modifications
+
+// Instead of comparing the deserialized data, the current options are serialized and compared with the file
+// on the JSON level. Serializing is cheap thanks to OptionsWriteCache, and only the items that differ
+// then need to be deserialized at all.
+
+/// The presets are compared as JSON, so they don't need to be deserialized completely until they are selected.
+static bool deserializeListEntry( const JsonObjectCtx & jsPreset, Preset & preset )
+{
+	deserializeLazily( jsPreset, preset );
+	return true;
+}
+
+/// Finds the range of the items that differ, the items before it and after it are the same in both lists.
+template< typename Item >
+static ListChange< Item > diffList( const QJsonArray & jsCurrent, const JsonArrayCtx & jsModified )
+{
+	const QJsonArray & jsModifiedArray = jsModified.wrappedArray();
+	const int currentSize = jsCurrent.size();
+	const int modifiedSize = jsModifiedArray.size();
+	const int commonSize = std::min( currentSize, modifiedSize );
+
+	int prefixSize = 0;
+	while (prefixSize < commonSize && jsCurrent[ prefixSize ] == jsModifiedArray[ prefixSize ])
+		prefixSize++;
+
+	int suffixSize = 0;
+	while (suffixSize < commonSize - prefixSize
+	    && jsCurrent[ currentSize - 1 - suffixSize ] == jsModifiedArray[ modifiedSize - 1 - suffixSize ])
+		suffixSize++;
+
+	ListChange< Item > change;
+	change.begin = prefixSize;
+	change.removedCount = currentSize - prefixSize - suffixSize;
+
+	for (int i = prefixSize; i < modifiedSize - suffixSize; i++)
+	{
+		JsonObjectCtx jsItem = jsModified.getObject( i );
+		if (!jsItem)  // wrong type on position i - skip this entry
+			continue;
+
+		Item item;
+		if (deserializeListEntry( jsItem, item ))
+			change.inserted.append( std::move( item ) );
+	}
+
+	return change;
+}
+
+/// Compares the sections of two objects, except the listed ones.
+static bool isSameExcept( const QJsonObject & a, const QJsonObject & b, std::initializer_list< const char * > ignoredKeys )
+{
+	auto isIgnored = [&]( const QString & key )
+	{
+		return std::any_of( ignoredKeys.begin(), ignoredKeys.end(), [&]( const char * ignored ) { return key == QLatin1String( ignored ); } );
+	};
+
+	int comparedInA = 0;
+	for (auto iter = a.constBegin(); iter != a.constEnd(); ++iter)
+	{
+		if (isIgnored( iter.key() ))
+			continue;
+		if (b.value( iter.key() ) != iter.value())  // Undefined when b doesn't have it
+			return false;
+		comparedInA++;
+	}
+
+	int comparedInB = 0;
+	for (auto iter = b.constBegin(); iter != b.constEnd(); ++iter)
+		if (!isIgnored( iter.key() ))
+			comparedInB++;
+
+	return comparedInA == comparedInB;  // otherwise b has something more
+}
+
+OptionsFileDiff diffOptions( const OptionsToSave & current, OptionsWriteCache & cache, const ParsedOptionsFile & modifiedFile )
+{
+	ScopeTimer timer( "diffing options" );
+
+	OptionsFileDiff diff;
+
+	const QJsonObject jsCurrentRoot = serializeOptionsToJsonDoc( current, cache ).object();
+	const QJsonObject jsModifiedRoot = modifiedFile.jsonDoc.object();
+
+	// Only the lists are diffed, everything else needs the complete loading, which re-initializes all the widgets.
+	// The files from other versions also need it, because of the migration.
+	if (!isSameExcept( jsCurrentRoot, jsModifiedRoot, { "engines", "IWADs", "presets", "selected_preset", "version", "geometry" } )
+	 || !isSameExcept( jsCurrentRoot["engines"].toObject(), jsModifiedRoot["engines"].toObject(), { "engine_list" } )
+	 || !isSameExcept( jsCurrentRoot["IWADs"].toObject(), jsModifiedRoot["IWADs"].toObject(), { "IWAD_list" } ))
+	{
+		diff.othersChanged = true;
+		return diff;
+	}
+
+	JsonDocumentCtx jsonDoc( modifiedFile.filePath, modifiedFile.jsonDoc );
+	const JsonObjectCtx & jsModified = jsonDoc.rootObject();
+
+	// the current options are complete, so anything missing in the file is an error like when loading it
+
+	if (JsonObjectCtx jsEngines = jsModified.getObject( "engines" ))
+		if (JsonArrayCtx jsEngineArray = jsEngines.getArray( "engine_list" ))
+			diff.engines = diffList< EngineInfo >( jsCurrentRoot["engines"].toObject().value( "engine_list" ).toArray(), jsEngineArray );
+
+	if (!current.iwadSettings.updateFromDir)  // otherwise the list is not stored
+		if (JsonObjectCtx jsIWADs = jsModified.getObject( "IWADs" ))
+			if (JsonArrayCtx jsIWADArray = jsIWADs.getArray( "IWAD_list" ))
+				diff.iwads = diffList< IWAD >( jsCurrentRoot["IWADs"].toObject().value( "IWAD_list" ).toArray(), jsIWADArray );
+
+	if (JsonArrayCtx jsPresetArray = jsModified.getArray( "presets" ))
+		diff.presets = diffList< Preset >( jsCurrentRoot["presets"].toArray(), jsPresetArray );
+
+	return diff;
+}
@@ -15,10 +15,18 @@
 
 #include <QList>
 #include <QString>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QByteArray>
+
+#include <optional>
 
 
 //======================================================================================================================
 
+/// File in the application data dir, where the options are stored.
+static const char defaultOptionsFileName [] = "options.json";
+
 struct OptionsToSave
 {
 	// files
@@ -73,10 +81,103 @@ struct OptionsToLoad
 	ModSettings & modSettings;
 	LauncherSettings & settings;
 	WindowGeometry geometry;
+
+	// loading mode
+	bool loadPresetsLazily = false;  ///< load only the names of the presets, the rest must be loaded by loadPresetContent()
+
+	// result
+	bool wasMigrated = false;  ///< the file was in an older format and should be written again in the current one
+};
+
+/// Parts of the options from the last write, so that only the parts that have changed since need to be serialized again.
+/**
+  * The presets make up the majority of the file, each of them keeps its own JSON in Preset::serializedJson,
+  * which is reset by Preset::markModified(). The engine and IWAD lists are kept here and must be invalidated
+  * by whoever modifies them. The remaining sections are small and are serialized every time.
+  */
+struct OptionsWriteCache
+{
+	std::optional< QJsonArray > engineList;
+	std::optional< QJsonArray > iwadList;
+	StorageSettings presetStorage;  ///< which options were stored to the presets when their JSON was cached
+	QStringVec presetMapDirs;       ///< the map directories the selected map packs were stored relative to
+	QByteArray fileHash;            ///< hash of the last content to be written, the file isn't rewritten if it's the same
+
+	/// Must be called whenever the engine list or the IWAD list is modified.
+	void invalidateFileLists()   { engineList.reset(); iwadList.reset(); }
+	/// Must be called when writing the serialized content failed, so that it's not skipped the next time.
+	void invalidateFileHash()    { fileHash.clear(); }
 };
 
-bool writeOptionsToFile( const OptionsToSave & opts, const QString & filePath );
+struct OptionsFileContent
+{
+	QByteArray json;    ///< the human-editable options file
+	QByteArray binary;  ///< the same document in a binary form that loads faster, to be stored at getOptionsSidecarPath()
+
+	bool isNull() const   { return json.isNull(); }
+};
+
+/// Serializes the options into the content of the options file and its binary sidecar.
+/** Returns null content if it is the same as the last time, so there is no need to write it.
+  * The binary file should be written after the JSON, it's only used while it's newer. */
+OptionsFileContent serializeOptions( const OptionsToSave & opts, OptionsWriteCache & cache );
+
+/// Path of the binary file, which readOptionsFromFile() loads instead of the JSON, when it's up to date with it.
+QString getOptionsSidecarPath( const QString & optionsFilePath );
 bool readOptionsFromFile( OptionsToLoad & opts, const QString & filePath );
 
+/// Options file that has been read and parsed, but not deserialized yet.
+struct ParsedOptionsFile
+{
+	QString filePath;
+	QJsonDocument jsonDoc;  ///< null if the file could not be read or parsed
+	QString error;          ///< message for the user in case the file could not be read or parsed
+	bool isKnownContent = false;  ///< parseOptionsFileUnlessKnown() recognized the content and didn't parse it
+};
+
+/// First half of readOptionsFromFile(), which doesn't touch anything else than the files, so it can run in a worker thread.
+/** Parsing the file is the slow part of loading the options, the deserialization itself is fast. */
+ParsedOptionsFile parseOptionsFile( const QString & filePath );
+/// Second half of readOptionsFromFile(), must be called from the main thread, because it reports the errors in message boxes.
+bool deserializeOptions( OptionsToLoad & opts, const ParsedOptionsFile & parsedFile );
+
+/// Reads and parses the options file like parseOptionsFile(), unless its content has one of the known hashes.
+/** This is used to recognize whether the file has been modified by someone else or we have just written it.
+  * Always parses the JSON, the binary sidecar is not up to date with the external modifications. */
+ParsedOptionsFile parseOptionsFileUnlessKnown( const QString & filePath, const QList< QByteArray > & knownHashes );
+
+/// Part of a list that differs between the current options and the options file, the items around it are the same.
+template< typename Item >
+struct ListChange
+{
+	int begin = 0;           ///< index of the first differing item in the current list
+	int removedCount = 0;    ///< how many of the current items starting from begin are to be removed
+	QList< Item > inserted;  ///< what is to be inserted in their place
+
+	bool isEmpty() const   { return removedCount == 0 && inserted.isEmpty(); }
+};
+
+/// Differences between the current options and an options file that has been modified by someone else.
+struct OptionsFileDiff
+{
+	bool othersChanged = false;  ///< something else than the engines, the IWADs or the presets differs, the file must be loaded completely
+	ListChange< EngineInfo > engines;  ///< only Engine fields are loaded, like in OptionsToLoad
+	ListChange< IWAD > iwads;
+	ListChange< Preset > presets;  ///< loaded lazily, the rest must be loaded by loadPresetContent()
+
+	bool isEmpty() const   { return !othersChanged && engines.isEmpty() && iwads.isEmpty() && presets.isEmpty(); }
+};
+
+/// Compares the current options with an options file that has been modified by someone else,
+/// and deserializes only the items of the file that differ.
+/** The window geometry, the selected preset and the app version are not compared, the current ones are kept.
+  * Must be called from the main thread, because it reports the errors in message boxes. */
+OptionsFileDiff diffOptions( const OptionsToSave & current, OptionsWriteCache & cache, const ParsedOptionsFile & modifiedFile );
+
+/// Deserializes the rest of a preset, that has been loaded lazily by readOptionsFromFile(). Does nothing if it's loaded already.
+/** The map settings must be the ones the preset was saved with, its map packs are stored relative to the map directories.
+  * The options file path is only used in the error messages. */
+void loadPresetContent( Preset & preset, const StorageSettings & settings, const MapSettings & mapSettings, const QString & optionsFilePath );
+
 
 #endif // OPTIONS_INCLUDED
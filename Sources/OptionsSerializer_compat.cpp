@@ -48,13 +48,15 @@ static void deserialize_pre17( const JsonObjectCtx & jsPreset, Preset & preset,
 
 	// files
 
-	preset.selectedEnginePath = jsPreset.getString( "selected_engine" );
+	preset.selectedEnginePath = g_pathPool.intern( jsPreset.getString( "selected_engine" ) );
 	preset.selectedConfig = jsPreset.getString( "selected_config" );
-	preset.selectedIWAD = jsPreset.getString( "selected_IWAD" );
+	preset.selectedIWAD = g_pathPool.intern( jsPreset.getString( "selected_IWAD" ) );
 
 	if (JsonArrayCtx jsSelectedMapPacks = jsPreset.getArray( "selected_mappacks" ))
 	{
 		preset.selectedMapPacks = deserializeStringVec( jsSelectedMapPacks );
+		for (QString & mapPack : preset.selectedMapPacks)
+			g_pathPool.internInPlace( mapPack );
 	}
 
 	if (JsonArrayCtx jsMods = jsPreset.getArray( "mods" ))
@@ -258,3 +260,45 @@ static void deserialize_pre17( OptionsToLoad & opts, const JsonObjectCtx & jsOpt
 
 	opts.selectedPreset = jsOpts.getString( "selected_preset" );
 }
+
+
+//======================================================================================================================
+//  migration
+
+/// Loads a file that was written before the schema version was introduced, or with a different one.
+/** Everything that decides between the older formats is here, so that the up-to-date files don't go through any of it. */
+static void deserializeOlderSchema( const JsonDocumentCtx & jsonDoc, OptionsToLoad & opts, int schemaVersion )
+{
+	const JsonObjectCtx & jsRoot = jsonDoc.rootObject();
+
+	QString optsVersionStr = jsRoot.getString( "version", {}, DontShowError );
+	Version optsVersion( optsVersionStr );
+
+	if (schemaVersion > optionsSchemaVersion || (!optsVersionStr.isEmpty() && optsVersion > appVersion))  // empty version means pre-1.4 version
+	{
+		reportRuntimeError( nullptr, "Loading options from newer version",
+			"Detected saved options from newer version of DoomRunner. "
+			"Some settings might not be compatible. Expect errors."
+		);
+		deserialize( jsRoot, opts );
+		return;  // don't rewrite it in the older format, the newer version might still be used
+	}
+
+	// backward compatibility with older options format
+	if (optsVersionStr.isEmpty() || optsVersion < Version(1,7))
+	{
+		jsonDoc.disableWarnings();  // supress "missing element" warnings when loading older version
+
+		// try to load as the 1.6.3 format, older versions will have to accept resetting some values to defaults
+		deserialize_pre17( opts, jsRoot );
+	}
+	else
+	{
+		jsonDoc.disableWarnings();  // supress "missing element" warnings when loading older version
+		opts.loadPresetsLazily = false;  // the presets loaded later would no longer know it's an older version
+
+		deserialize( jsRoot, opts );
+	}
+
+	opts.wasMigrated = true;
+}
@@ -0,0 +1,123 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: index of the files and arguments used by the presets for searching through their content
+//======================================================================================================================
+
+#include "PresetContentIndex.hpp"
+
+#include "Utils/FileSystemUtils.hpp"  // getFileNameFromPath
+
+#include <QRegularExpression>
+
+#include <algorithm>
+
+
+//======================================================================================================================
+
+static const QRegularExpression whitespaceRegex("\\s+");
+
+QStringVec PresetContentIndex::extractWords( const Preset & preset )
+{
+	QStringVec words;
+
+	auto addWord = [&words]( const QString & word )
+	{
+		if (!word.isEmpty())
+			words.append( word.toCaseFolded() );
+	};
+	auto addArgs = [&words]( const QString & args )
+	{
+		for (const QString & arg : args.split( whitespaceRegex ))
+			if (!arg.isEmpty())
+				words.append( arg.toCaseFolded() );
+	};
+
+	addWord( preset.name );
+	addWord( fs::getFileNameFromPath( preset.selectedIWAD ) );
+	for (const QString & mapPack : preset.selectedMapPacks)
+		addWord( fs::getFileNameFromPath( mapPack ) );
+	for (const Mod & mod : preset.mods)
+	{
+		if (mod.isSeparator)
+			continue;
+		else if (mod.isCmdArg)
+			addArgs( mod.fileName );
+		else
+			addWord( fs::getFileNameFromPath( mod.path ) );
+	}
+	addArgs( preset.cmdArgs );
+
+	std::sort( words.begin(), words.end() );
+	words.erase( std::unique( words.begin(), words.end() ), words.end() );
+
+	return words;
+}
+
+void PresetContentIndex::addPreset( const QString & presetID, QStringVec words )
+{
+	for (const QString & word : words)
+		_presetsByWord[ word ].insert( presetID );
+
+	_wordsByPreset.insert( presetID, std::move(words) );
+}
+
+void PresetContentIndex::removePreset( const QString & presetID )
+{
+	auto it = _wordsByPreset.find( presetID );
+	if (it == _wordsByPreset.end())
+		return;
+
+	for (const QString & word : *it)
+	{
+		auto wordIt = _presetsByWord.find( word );
+		if (wordIt == _presetsByWord.end())
+			continue;
+		wordIt->remove( presetID );
+		if (wordIt->isEmpty())
+			_presetsByWord.erase( wordIt );
+	}
+
+	_wordsByPreset.erase( it );
+}
+
+QSet< QString > PresetContentIndex::findWord( const QString & foldedWord ) const
+{
+	// There are much fewer distinct words than presets times their mods, so even the scan for a part of a word is cheap.
+	QSet< QString > presetIDs;
+	for (auto it = _presetsByWord.begin(); it != _presetsByWord.end(); ++it)
+		if (it.key().contains( foldedWord ))
+			presetIDs.unite( it.value() );
+	return presetIDs;
+}
+
+QSet< QString > PresetContentIndex::findPresets( const QString & phrase ) const
+{
+	if (_allStale || !_stalePresets.isEmpty())
+	{
+		logLogicError() << "searching an index that is not up to date";
+	}
+
+	QSet< QString > presetIDs;
+	bool firstWord = true;
+
+	for (const QString & word : phrase.split( whitespaceRegex ))
+	{
+		if (word.isEmpty())
+			continue;
+
+		QSet< QString > wordPresetIDs = findWord( word.toCaseFolded() );
+
+		if (firstWord)
+			presetIDs = std::move( wordPresetIDs );
+		else
+			presetIDs.intersect( wordPresetIDs );
+		firstWord = false;
+
+		if (presetIDs.isEmpty())
+			break;
+	}
+
+	return presetIDs;
+}
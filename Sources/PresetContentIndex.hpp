@@ -0,0 +1,114 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: index of the files and arguments used by the presets for searching through their content
+//======================================================================================================================
+
+#ifndef PRESET_CONTENT_INDEX_INCLUDED
+#define PRESET_CONTENT_INDEX_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "UserData.hpp"  // Preset
+#include "CommonTypes.hpp"  // QStringVec
+#include "Utils/ErrorHandling.hpp"  // LoggingComponent
+
+#include <QString>
+#include <QHash>
+#include <QSet>
+
+
+//======================================================================================================================
+/// Inverted index mapping words from the content of the presets to the presets that contain them.
+/**
+  * The words are the preset name, the file names of the mods, the IWAD and the map packs, and the additional
+  * command line arguments, all case-folded. Instead of watching every place where a preset can be edited,
+  * the presets are marked stale and only the stale or new ones are re-indexed before the next search.
+  *
+  * The presets are identified by their IDs, the presets that are no longer in the list are dropped from the index.
+  */
+class PresetContentIndex : protected LoggingComponent {
+
+ public:
+
+	PresetContentIndex() : LoggingComponent("PresetContentIndex") {}
+
+	/// The content of this preset has been modified, it will be re-indexed before the next search.
+	void markStale( const QString & presetID )  { if (!_allStale) _stalePresets.insert( presetID ); }
+	/// The content of many presets has been modified or the whole list has been replaced.
+	void markAllStale()                         { _allStale = true; _stalePresets.clear(); }
+
+	/// Brings the index up to date with the current list of presets, only the stale and new presets are re-indexed.
+	/** All the presets must be loaded. */
+	template< typename PresetList >
+	void update( const PresetList & presets );
+
+	/// Returns IDs of the presets that contain all the words of the phrase, each at least as a part of some entry.
+	/** The search is always case-insensitive. */
+	QSet< QString > findPresets( const QString & phrase ) const;
+
+ private:
+
+	static QStringVec extractWords( const Preset & preset );
+
+	void addPreset( const QString & presetID, QStringVec words );
+	void removePreset( const QString & presetID );
+
+	/// Returns IDs of the presets containing an entry that contains the word.
+	QSet< QString > findWord( const QString & foldedWord ) const;
+
+ private:
+
+	QHash< QString, QSet< QString > > _presetsByWord;
+	QHash< QString, QStringVec > _wordsByPreset;  ///< for removing the old words when the preset is re-indexed
+	QSet< QString > _stalePresets;
+	bool _allStale = true;
+
+};
+
+template< typename PresetList >
+void PresetContentIndex::update( const PresetList & presets )
+{
+	if (_allStale)
+	{
+		_presetsByWord.clear();
+		_wordsByPreset.clear();
+	}
+
+	QSet< QString > currentIDs;
+	currentIDs.reserve( int( presets.size() ) );
+
+	for (const Preset & preset : presets)
+	{
+		if (preset.isSeparator)
+			continue;
+
+		QString presetID = preset.getID();
+		currentIDs.insert( presetID );
+
+		if (_wordsByPreset.contains( presetID ) && !_stalePresets.contains( presetID ))
+			continue;
+
+		removePreset( presetID );
+		addPreset( presetID, extractWords( preset ) );
+	}
+
+	// the presets that have been deleted or renamed
+	if (_wordsByPreset.size() > currentIDs.size())
+	{
+		QStringVec droppedIDs;
+		for (auto it = _wordsByPreset.keyBegin(); it != _wordsByPreset.keyEnd(); ++it)
+			if (!currentIDs.contains( *it ))
+				droppedIDs.append( *it );
+		for (const QString & presetID : droppedIDs)
+			removePreset( presetID );
+	}
+
+	_stalePresets.clear();
+	_allStale = false;
+}
+
+
+#endif // PRESET_CONTENT_INDEX_INCLUDED
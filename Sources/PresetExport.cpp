@@ -0,0 +1,264 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: export of presets to shell scripts and shortcuts
+//======================================================================================================================
+
+#include "PresetExport.hpp"
+
+#include "LaunchCommand.hpp"
+#include "Utils/ContainerUtils.hpp"  // findSuch
+#include "Utils/MiscUtils.hpp"  // PathChecker, PathStatBatch
+#include "Utils/ErrorHandling.hpp"
+
+#include <QFile>
+#include <QTextStream>
+#include <QSet>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QStringBuilder>
+
+#include <vector>
+#include <functional>
+#include <optional>
+
+
+//======================================================================================================================
+
+QString writeLaunchScript( const QString & scriptFilePath, const os::ShellCommand & cmd )
+{
+	QFile scriptFile( scriptFilePath );
+	if (!scriptFile.open( QIODevice::WriteOnly | QIODevice::Text ))
+	{
+		return "Cannot open file for writing ("%scriptFile.errorString()%")";
+	}
+
+	QTextStream stream( &scriptFile );
+
+	// make sure the working directory is set to the script file's directory
+ #if IS_WINDOWS
+	stream << "cd \"%~dp0\"\n";
+ #else
+	stream << "#!/bin/bash\n\n";
+	stream << "cd $(dirname $(readlink -f \"$0\"))\n";
+ #endif
+
+	stream << cmd.executable << " " << cmd.arguments.join(' ') << '\n';
+
+	stream.flush();
+	if (stream.status() != QTextStream::Ok)
+	{
+		return "Failed to write the file ("%scriptFile.errorString()%")";
+	}
+
+	return {};
+}
+
+
+//======================================================================================================================
+//  batch export
+
+namespace {
+
+/// Everything needed to export one preset, the input points into the other members.
+struct ExportJob
+{
+	Preset * preset = nullptr;
+	EngineInfo engine;   ///< own copy, the launch command input points to a non-const one
+	std::optional< IWAD > iwad;
+	LaunchCommandInput input;
+
+	QString filePath;
+	QString parentWorkingDir;
+	PathStyle enginePathStyle = defaultPathStyle;
+	QString engineWorkingDir;
+
+	PathStatBatch statBatch;   ///< paths of this command, before they are merged into the common batch
+
+	QString error;
+};
+
+// The jobs mostly wait for the drive, so there can be more threads than CPU cores.
+static constexpr int MaxExportThreads = 16;
+
+/// Calls the function for each index in worker threads and blocks until all of the calls are finished.
+static void runInParallel( int count, const std::function< void ( int idx ) > & func )
+{
+	class IndexTask : public QRunnable {
+		const std::function< void ( int idx ) > & _func;
+		int _first, _step, _count;
+	 public:
+		IndexTask( const std::function< void ( int idx ) > & func, int first, int step, int count )
+			: _func( func ), _first( first ), _step( step ), _count( count ) {}
+		virtual void run() override
+		{
+			for (int i = _first; i < _count; i += _step)
+				_func( i );
+		}
+	};
+
+	QThreadPool threadPool;
+	threadPool.setMaxThreadCount( MaxExportThreads );
+	const int threadCount = std::min( count, MaxExportThreads );
+	for (int threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+		threadPool.start( new IndexTask( func, threadIdx, threadCount, count ) );
+	threadPool.waitForDone();
+}
+
+/// Gives each preset a unique file name, even if their names differ only in the characters that had to be removed.
+static QStringVec makeUniqueFileNames( const std::vector< ExportJob > & jobs, const QString & fileSuffix )
+{
+	QStringVec fileNames;
+	fileNames.reserve( int( jobs.size() ) );
+	QSet< QString > usedNames;
+
+	for (const ExportJob & job : jobs)
+	{
+		QString baseName = fs::sanitizePath( job.preset->name );
+		if (baseName.isEmpty())
+			baseName = "preset";
+
+		QString fileName = baseName % '.' % fileSuffix;
+		for (int i = 2; usedNames.contains( fileName.toLower() ); ++i)  // Windows file names are case-insensitive
+			fileName = baseName % " (" % QString::number( i ) % ")." % fileSuffix;
+
+		usedNames.insert( fileName.toLower() );
+		fileNames.append( std::move(fileName) );
+	}
+
+	return fileNames;
+}
+
+} // namespace
+
+QVector< PresetExportResult > exportPresets(
+	PresetExportSnapshot & snapshot, ExportTarget target, const QString & outputDir, const QString & fileSuffix
+){
+	//-- prepare the jobs in this thread, it's cheap ---------------------------------
+
+	std::vector< ExportJob > jobs;
+	jobs.reserve( size_t( snapshot.presets.size() ) );
+	for (Preset & preset : snapshot.presets)
+	{
+		if (preset.isSeparator)
+			continue;
+		jobs.emplace_back();
+		jobs.back().preset = &preset;
+	}
+	// from now on the jobs must not move, the inputs will point into them
+
+	const QStringVec fileNames = makeUniqueFileNames( jobs, fileSuffix );
+	const QDir outDir( outputDir );
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		ExportJob & job = jobs[i];
+		job.filePath = outDir.filePath( fileNames[ int(i) ] );
+
+		int engineIdx = findSuch( snapshot.engines, [&]( const EngineInfo & engine )
+		                                            { return engine.executablePath == job.preset->selectedEnginePath; } );
+		if (engineIdx < 0)
+		{
+			job.error = "No engine is selected.";
+			continue;
+		}
+		job.engine = snapshot.engines[ engineIdx ];
+
+		if (target == ExportTarget::Script)
+		{
+			// Both the executable and the paths in the arguments need to be relative to the directory of the script file,
+			// because the script will set the working directory to it's own directory.
+			job.parentWorkingDir = outputDir;
+			job.enginePathStyle = snapshot.pathStyle;
+			job.engineWorkingDir = outputDir;
+		}
+		else
+		{
+			// the same as in MainWindow::exportPresetToShortcut(), see the comments there
+			job.parentWorkingDir = snapshot.launcherWorkingDir.path();
+			job.enginePathStyle = PathStyle::Absolute;
+			job.engineWorkingDir = fs::getAbsoluteDirOfFile( job.engine.executablePath );
+		}
+	}
+
+	auto generateCommand = [&]( ExportJob & job, PathChecker & pathChecker )
+	{
+		return generateLaunchCommand(
+			job.input, snapshot.launcherWorkingDir, job.parentWorkingDir, job.enginePathStyle, job.engineWorkingDir,
+			snapshot.pathStyle, QuotePaths, pathChecker
+		);
+	};
+
+	//-- collect the paths of all the commands ---------------------------------------
+
+	// reading the map names of the WADs can take a while, so even this is done in parallel
+	runInParallel( int( jobs.size() ), [&]( int idx )
+	{
+		ExportJob & job = jobs[ size_t(idx) ];
+		if (!job.error.isEmpty())
+			return;
+
+		fillLaunchCommandInput( job.input, *job.preset, job.engine, job.iwad, snapshot.opts );
+
+		PathChecker collectingChecker( nullptr, /*verificationRequired*/ true, &job.statBatch );
+		generateCommand( job, collectingChecker );
+	});
+
+	//-- stat them all at once -------------------------------------------------------
+
+	// the presets mostly share the same files, so this also stats each of them only once
+	PathStatBatch commonBatch;
+	for (const ExportJob & job : jobs)
+		commonBatch.addPaths( job.statBatch );
+	commonBatch.statAll();
+
+	//-- verify, generate and write --------------------------------------------------
+
+	runInParallel( int( jobs.size() ), [&]( int idx )
+	{
+		ExportJob & job = jobs[ size_t(idx) ];
+		if (!job.error.isEmpty())
+			return;
+
+		PathChecker::ErrorCollector errorCollector;  // this is a worker thread, the errors will be shown in the summary
+		PathChecker verifyingChecker( nullptr, /*verificationRequired*/ true, &commonBatch );
+		verifyingChecker.toggleItemHighlighting( false );  // the theme can be switched in the main thread meanwhile
+		os::ShellCommand cmd = generateCommand( job, verifyingChecker );
+		if (verifyingChecker.gotSomeInvalidPaths())
+		{
+			job.error = errorCollector.errors().join(' ');
+			return;
+		}
+		if (cmd.executable.isEmpty())
+		{
+			job.error = "Failed to generate the launch command.";
+			return;
+		}
+
+		if (target == ExportTarget::Script)
+		{
+			job.error = writeLaunchScript( job.filePath, cmd );
+		}
+		else
+		{
+		 #if IS_WINDOWS
+			bool success = os::createWindowsShortcut( job.filePath, cmd.executable, cmd.arguments, job.engineWorkingDir, job.preset->name );
+			if (!success)
+				job.error = "Failed to create a shortcut. Check errors.txt for details.";
+		 #else
+			job.error = "Shortcuts are supported only on Windows.";
+		 #endif
+		}
+	});
+
+	//-- report ----------------------------------------------------------------------
+
+	QVector< PresetExportResult > results;
+	results.reserve( int( jobs.size() ) );
+	for (ExportJob & job : jobs)
+	{
+		results.append({ job.preset->name, std::move(job.filePath), std::move(job.error) });
+	}
+	return results;
+}
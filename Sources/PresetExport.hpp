@@ -0,0 +1,65 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: export of presets to shell scripts and shortcuts
+//======================================================================================================================
+
+#ifndef PRESET_EXPORT_INCLUDED
+#define PRESET_EXPORT_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "UserData.hpp"
+#include "HeadlessLaunch.hpp"  // StoredLaunchOptions
+#include "Utils/FileSystemUtils.hpp"  // PathStyle
+#include "Utils/OSUtils.hpp"  // ShellCommand
+
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QDir>
+
+
+//======================================================================================================================
+
+enum class ExportTarget
+{
+	Script,
+	Shortcut,  ///< only on Windows
+};
+
+/// Read-only copy of everything the commands are generated from, taken in the main thread before the export.
+struct PresetExportSnapshot
+{
+	QList< Preset > presets;       ///< must be fully loaded, separators are skipped
+	QList< EngineInfo > engines;   ///< with all the derived information already filled
+	StoredLaunchOptions opts;
+	QDir launcherWorkingDir;       ///< to which all the stored paths are relative
+	PathStyle pathStyle = defaultPathStyle;
+};
+
+struct PresetExportResult
+{
+	QString presetName;
+	QString filePath;   ///< where the preset was (or would be) exported
+	QString error;      ///< empty if it was exported successfully
+};
+
+/// Writes a script that changes the working directory to its own directory and runs the command.
+/** Returns an error message, empty on success. */
+QString writeLaunchScript( const QString & scriptFilePath, const os::ShellCommand & cmd );
+
+/// Exports each preset of the snapshot into its own file in the output directory, named after the preset.
+/**
+  * The commands are generated and the files written in parallel, and the paths of all the commands are verified
+  * in a single batched pass. Nothing is displayed, the errors are returned in the results instead,
+  * so this can and should be called from a worker thread.
+  */
+QVector< PresetExportResult > exportPresets(
+	PresetExportSnapshot & snapshot, ExportTarget target, const QString & outputDir, const QString & fileSuffix
+);
+
+
+#endif // PRESET_EXPORT_INCLUDED
@@ -0,0 +1,480 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: generator of a fake huge installation for measuring how the launcher scales
+//======================================================================================================================
+
+#include "TestLibraryGenerator.hpp"
+
+#include "OptionsSerializer.hpp"
+#include "DoomFiles.hpp"  // saveFileSuffix, demoFileSuffix
+
+#include "Utils/StandardOutput.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QByteArray>
+#include <QRandomGenerator>
+#include <QtEndian>
+#include <QElapsedTimer>
+
+#include <vector>
+#include <iterator>  // size
+
+
+//======================================================================================================================
+//  parameters
+
+namespace {
+
+struct Params
+{
+	QString targetDir;
+	quint32 seed = 1;
+	int scale = 1;              ///< multiplies all the counts below except the directory tree shape
+
+	// the numbers at scale 1 roughly correspond to a big, but still realistic, installation
+	int iwadCount = 8;
+	int modCount = 64;
+	int mapTreeDepth = 3;
+	int mapTreeFanOut = 4;
+	int mapPacksPerDir = 8;
+	int maxMapsPerWad = 32;
+	int saveCount = 200;
+	int demoCount = 100;
+	int presetCount = 20;
+	int modsPerPreset = 5;
+};
+
+} // namespace
+
+static const char usage [] =
+	"Usage: --generate-test-library <empty dir> [--seed N] [--scale N] [--depth N] [--fan-out N] [--presets N] [--mods-per-preset N]";
+
+static bool parseParams( const QStringList & args, Params & params )
+{
+	for (qsizetype i = 0; i < args.size(); ++i)
+	{
+		const QString & arg = args[i];
+		if (!arg.startsWith("--"))
+		{
+			if (!params.targetDir.isEmpty())
+				return false;
+			params.targetDir = arg;
+			continue;
+		}
+
+		if (i + 1 >= args.size())
+			return false;
+		bool ok = false;
+		uint value = args[ ++i ].toUInt( &ok );
+		if (!ok || value > 1000000)
+			return false;
+
+		if (arg == "--seed")
+			params.seed = value;
+		else if (arg == "--scale" && value > 0)
+			params.scale = int( value );
+		else if (arg == "--depth")
+			params.mapTreeDepth = int( value );
+		else if (arg == "--fan-out" && value > 0)
+			params.mapTreeFanOut = int( value );
+		else if (arg == "--presets")
+			params.presetCount = int( value );
+		else if (arg == "--mods-per-preset")
+			params.modsPerPreset = int( value );
+		else
+			return false;
+	}
+
+	if (params.targetDir.isEmpty())
+		return false;
+
+	params.iwadCount *= params.scale;
+	params.modCount *= params.scale;
+	params.mapPacksPerDir *= params.scale;
+	params.saveCount *= params.scale;
+	params.demoCount *= params.scale;
+	params.presetCount *= params.scale;
+	return true;
+}
+
+
+//======================================================================================================================
+//  file content
+
+static void appendLE32( QByteArray & bytes, quint32 value )
+{
+	char buffer [4];
+	qToLittleEndian( value, buffer );
+	bytes.append( buffer, sizeof(buffer) );
+}
+
+static void appendBE32( QByteArray & bytes, quint32 value )
+{
+	char buffer [4];
+	qToBigEndian( value, buffer );
+	bytes.append( buffer, sizeof(buffer) );
+}
+
+static QByteArray randomBytes( QRandomGenerator & rng, int size )
+{
+	QByteArray bytes( size, Qt::Uninitialized );
+	for (char & byte : bytes)
+		byte = char( rng.bounded( 256 ) );
+	return bytes;
+}
+
+static QString randomTitle( QRandomGenerator & rng )
+{
+	static const char * const words [] = {
+		"Hell", "Base", "Tower", "Halls", "Dead", "Simple", "Refinery", "Gate", "Crusher", "Lab", "Abyss", "Citadel",
+		"Forgotten", "Rusty", "Inferno", "Station", "Temple", "Canyon", "Sewers", "Fortress", "Blood", "Nuclear", "Outpost",
+	};
+	constexpr quint32 wordCount = std::size( words );
+	return QString("%1 %2").arg( words[ rng.bounded( wordCount ) ], words[ rng.bounded( wordCount ) ] );
+}
+
+static QStringVec makeMapNames( QRandomGenerator & rng, int maxMaps )
+{
+	QStringVec mapNames;
+	int mapCount = 1 + int( rng.bounded( quint32( maxMaps ) ) );
+	bool doom1Style = rng.bounded( 4 ) == 0;
+	for (int i = 0; i < mapCount; ++i)
+	{
+		if (doom1Style)
+			mapNames.append( QString("E%1M%2").arg( i / 9 + 1 ).arg( i % 9 + 1 ) );
+		else
+			mapNames.append( QString("MAP%1").arg( i + 1, 2, 10, QChar('0') ) );
+	}
+	return mapNames;
+}
+
+/// Builds a WAD with a map marker lump and a few map data lumps for each map, and a MAPINFO describing the maps.
+static QByteArray makeWad( QRandomGenerator & rng, bool isIWAD, const QStringVec & mapNames )
+{
+	struct Lump
+	{
+		QByteArray name;
+		QByteArray data;
+	};
+	static const char * const mapDataLumps [] = { "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SECTORS" };
+
+	std::vector< Lump > lumps;
+
+	// some of the WADs define the maps only by the markers, so that both ways of reading the map names get exercised
+	if (!mapNames.isEmpty() && rng.bounded( 3 ) != 0)
+	{
+		QByteArray mapInfo;
+		for (const QString & mapName : mapNames)
+			mapInfo += QStringLiteral("map %1 \"%2\"\n{\n\tmusic = \"D_RUNNIN\"\n}\n\n").arg( mapName, randomTitle( rng ) ).toLatin1();
+		lumps.push_back({ "MAPINFO", std::move(mapInfo) });
+	}
+
+	// the mods without maps need at least something
+	if (mapNames.isEmpty())
+		lumps.push_back({ "DEHACKED", "Patch File for DeHackEd v3.0\nDoom version = 21\nPatch format = 6\n" });
+
+	for (const QString & mapName : mapNames)
+	{
+		lumps.push_back({ mapName.toLatin1(), {} });
+		for (const char * lumpName : mapDataLumps)
+			lumps.push_back({ lumpName, randomBytes( rng, 16 + int( rng.bounded( 240 ) ) ) });
+	}
+
+	// header: 4B type, 4B number of lumps, 4B offset of the lump directory
+	// lump directory: 4B offset of the data, 4B size of the data, 8B name padded with zeros
+	QByteArray data;
+	std::vector< quint32 > offsets;
+	for (const Lump & lump : lumps)
+	{
+		offsets.push_back( quint32( 12 + data.size() ) );
+		data += lump.data;
+	}
+
+	QByteArray wad;
+	wad.reserve( 12 + data.size() + int( lumps.size() ) * 16 );
+	wad.append( isIWAD ? "IWAD" : "PWAD", 4 );
+	appendLE32( wad, quint32( lumps.size() ) );
+	appendLE32( wad, quint32( 12 + data.size() ) );
+	wad += data;
+	for (size_t i = 0; i < lumps.size(); ++i)
+	{
+		appendLE32( wad, offsets[i] );
+		appendLE32( wad, quint32( lumps[i].data.size() ) );
+		QByteArray name = lumps[i].name.left( 8 );
+		name.append( 8 - name.size(), '\0' );
+		wad += name;
+	}
+	return wad;
+}
+
+static quint32 crc32( const QByteArray & bytes )
+{
+	quint32 crc = 0xFFFFFFFF;
+	for (char byte : bytes)
+	{
+		crc ^= uchar( byte );
+		for (int bit = 0; bit < 8; ++bit)
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+	}
+	return ~crc;
+}
+
+static void appendPngChunk( QByteArray & png, const char * type, const QByteArray & data )
+{
+	QByteArray typeAndData = QByteArray( type, 4 ) + data;
+	appendBE32( png, quint32( data.size() ) );
+	png += typeAndData;
+	appendBE32( png, crc32( typeAndData ) );
+}
+
+/// Builds a save file in the PNG-based format, with only the text chunks the launcher reads.
+static QByteArray makeSave( QRandomGenerator & rng, int index, const QString & mapName )
+{
+	auto textChunk = []( const char * key, const QString & value )
+	{
+		return QByteArray( key ) + '\0' + value.toUtf8();
+	};
+
+	QByteArray png( "\x89PNG\r\n\x1A\n", 8 );
+	appendPngChunk( png, "tEXt", textChunk( "Title", QStringLiteral("Save %1 - %2").arg( index ).arg( randomTitle( rng ) ) ) );
+	appendPngChunk( png, "tEXt", textChunk( "Current Map", mapName ) );
+	appendPngChunk( png, "tEXt", textChunk( "Creation Time", QStringLiteral("2024-01-01 12:%1:00").arg( index % 60, 2, 10, QChar('0') ) ) );
+	appendPngChunk( png, "tEXt", textChunk( "Comment", QStringLiteral("%1 - %2\nkills: %3/%4").arg( mapName, randomTitle( rng ) )
+		.arg( rng.bounded( 100 ) ).arg( 100 ) ) );
+	appendPngChunk( png, "IEND", {} );
+	return png;
+}
+
+/// Builds a vanilla v1.9 demo with random tics.
+static QByteArray makeDemo( QRandomGenerator & rng )
+{
+	QByteArray demo;
+	demo += char( 109 );                            // version
+	demo += char( rng.bounded( 5 ) );               // skill, 0-based
+	demo += char( 1 );                              // episode
+	demo += char( 1 + rng.bounded( 32 ) );          // map
+	demo += QByteArray( 5, '\0' );                  // deathmatch, respawn, fast, nomonsters, consoleplayer
+	demo += QByteArray( "\x01\x00\x00\x00", 4 );    // players in game
+	demo += randomBytes( rng, 4 * int( 35 + rng.bounded( 35 * 60 ) ) );  // 1 to 60 seconds of tics
+	demo += char( 0x80 );                           // end marker
+	return demo;
+}
+
+
+//======================================================================================================================
+//  installation
+
+static bool writeFile( const QString & filePath, const QByteArray & content )
+{
+	QFile file( filePath );
+	if (!file.open( QIODevice::WriteOnly ) || file.write( content ) != content.size())
+	{
+		stderrStream << "Cannot write " << filePath << ": " << file.errorString() << Qt::endl;
+		return false;
+	}
+	return true;
+}
+
+static bool makeDir( const QString & dirPath )
+{
+	if (!QDir().mkpath( dirPath ))
+	{
+		stderrStream << "Cannot create directory " << dirPath << Qt::endl;
+		return false;
+	}
+	return true;
+}
+
+static bool generateMapTree( QRandomGenerator & rng, const Params & params, const QString & dirPath, int depth, QStringVec & mapPacks )
+{
+	if (!makeDir( dirPath ))
+		return false;
+
+	for (int i = 0; i < params.mapPacksPerDir; ++i)
+	{
+		QString filePath = QStringLiteral("%1/pack%2.wad").arg( dirPath ).arg( i, 4, 10, QChar('0') );
+		if (!writeFile( filePath, makeWad( rng, false, makeMapNames( rng, params.maxMapsPerWad ) ) ))
+			return false;
+		mapPacks.append( filePath );
+	}
+
+	if (depth >= params.mapTreeDepth)
+		return true;
+
+	for (int i = 0; i < params.mapTreeFanOut; ++i)
+	{
+		QString subdirPath = QStringLiteral("%1/dir%2").arg( dirPath ).arg( i, 2, 10, QChar('0') );
+		if (!generateMapTree( rng, params, subdirPath, depth + 1, mapPacks ))
+			return false;
+	}
+	return true;
+}
+
+static bool generateOptions( QRandomGenerator & rng, const Params & params, const QString & rootDir,
+	const Engine & engine, const QList< IWAD > & iwads, const QList< Mod > & modFiles, const QStringVec & mapPacks )
+{
+	QList< EngineInfo > engines = { EngineInfo( engine ) };
+
+	QList< Preset > presets;
+	presets.reserve( params.presetCount );
+	for (int i = 0; i < params.presetCount; ++i)
+	{
+		Preset preset( QStringLiteral("Preset %1").arg( i, 4, 10, QChar('0') ) );
+		preset.selectedEnginePath = engine.executablePath;
+		preset.selectedIWAD = iwads[ int( rng.bounded( quint32( iwads.size() ) ) ) ].path;
+		if (!mapPacks.isEmpty())
+			preset.selectedMapPacks.append( mapPacks[ int( rng.bounded( quint32( mapPacks.size() ) ) ) ] );
+		for (int j = 0; j < params.modsPerPreset && !modFiles.isEmpty(); ++j)
+		{
+			Mod mod = modFiles[ int( rng.bounded( quint32( modFiles.size() ) ) ) ];
+			mod.checked = rng.bounded( 4 ) != 0;
+			preset.mods.append( std::move(mod) );
+		}
+		preset.cmdArgs = rng.bounded( 2 ) ? "-fast" : "";
+		presets.append( std::move(preset) );
+	}
+
+	LaunchOptions launchOpts;
+	MultiplayerOptions multOpts;
+	GameplayOptions gameOpts;
+	CompatibilityOptions compatOpts;
+	VideoOptions videoOpts;
+	AudioOptions audioOpts;
+	GlobalOptions globalOpts;
+
+	EngineSettings engineSettings;
+	engineSettings.defaultEngine = engine.executablePath;
+	IwadSettings iwadSettings;
+	iwadSettings.dir = rootDir + "/IWADs";
+	iwadSettings.updateFromDir = true;
+	MapSettings mapSettings;
+	mapSettings.dir = rootDir + "/Maps";
+	ModSettings modSettings;
+	modSettings.dir = rootDir + "/Mods";
+	LauncherSettings settings;
+
+	OptionsToSave opts =
+	{
+		engines,
+		iwads,
+
+		launchOpts,
+		multOpts,
+		gameOpts,
+		compatOpts,
+		videoOpts,
+		audioOpts,
+		globalOpts,
+
+		presets,
+		presets.isEmpty() ? -1 : 0,
+
+		engineSettings,
+		iwadSettings,
+		mapSettings,
+		modSettings,
+		settings,
+		WindowGeometry()
+	};
+
+	// the same serialization as the application uses, so that loading these options measures the real thing
+	OptionsWriteCache writeCache;
+	OptionsFileContent content = serializeOptions( opts, writeCache );
+
+	QString optionsFilePath = rootDir + '/' + defaultOptionsFileName;
+	return writeFile( optionsFilePath, content.json )
+	    && writeFile( getOptionsSidecarPath( optionsFilePath ), content.binary );
+}
+
+
+//======================================================================================================================
+//  public API
+
+int generateTestLibrary( const QStringList & args )
+{
+	Params params;
+	if (!parseParams( args, params ))
+	{
+		stderrStream << usage << Qt::endl;
+		return 1;
+	}
+
+	// refuse to mix thousands of fake files into a real directory
+	QDir targetDir( params.targetDir );
+	if (targetDir.exists() && !targetDir.isEmpty())
+	{
+		stderrStream << "The target directory " << params.targetDir << " is not empty" << Qt::endl;
+		return 1;
+	}
+	const QString rootDir = QFileInfo( params.targetDir ).absoluteFilePath();
+
+	QElapsedTimer timer;
+	timer.start();
+
+	QRandomGenerator rng( params.seed );
+
+	// IWADs
+	QList< IWAD > iwads;
+	if (!makeDir( rootDir + "/IWADs" ))
+		return 1;
+	for (int i = 0; i < params.iwadCount; ++i)
+	{
+		QString filePath = QStringLiteral("%1/IWADs/iwad%2.wad").arg( rootDir ).arg( i, 4, 10, QChar('0') );
+		if (!writeFile( filePath, makeWad( rng, true, makeMapNames( rng, params.maxMapsPerWad ) ) ))
+			return 1;
+		iwads.append( IWAD( QFileInfo( filePath ) ) );
+	}
+
+	// mods
+	QList< Mod > modFiles;
+	if (!makeDir( rootDir + "/Mods" ))
+		return 1;
+	for (int i = 0; i < params.modCount; ++i)
+	{
+		QString filePath = QStringLiteral("%1/Mods/mod%2.wad").arg( rootDir ).arg( i, 4, 10, QChar('0') );
+		if (!writeFile( filePath, makeWad( rng, false, {} ) ))
+			return 1;
+		modFiles.append( Mod( QFileInfo( filePath ) ) );
+	}
+
+	// map packs
+	QStringVec mapPacks;
+	if (!generateMapTree( rng, params, rootDir + "/Maps", 0, mapPacks ))
+		return 1;
+
+	// engine with its data dir full of saves and demos, the executable is only a placeholder
+	Engine engine;
+	engine.name = "Generated engine";
+	engine.executablePath = rootDir + "/Engine/gzdoom" + (IS_WINDOWS ? ".exe" : "");
+	engine.configDir = rootDir + "/Engine";
+	engine.dataDir = rootDir + "/Engine";
+	engine.family = EngineFamily::ZDoom;
+	if (!makeDir( engine.dataDir ) || !writeFile( engine.executablePath, {} ))
+		return 1;
+	for (int i = 0; i < params.saveCount; ++i)
+	{
+		QString mapName = QStringLiteral("MAP%1").arg( 1 + i % 32, 2, 10, QChar('0') );
+		QString filePath = QStringLiteral("%1/save%2.%3").arg( engine.dataDir ).arg( i, 5, 10, QChar('0') ).arg( doom::saveFileSuffix );
+		if (!writeFile( filePath, makeSave( rng, i, mapName ) ))
+			return 1;
+	}
+	for (int i = 0; i < params.demoCount; ++i)
+	{
+		QString filePath = QStringLiteral("%1/demo%2.%3").arg( engine.dataDir ).arg( i, 5, 10, QChar('0') ).arg( doom::demoFileSuffix );
+		if (!writeFile( filePath, makeDemo( rng ) ))
+			return 1;
+	}
+
+	if (!generateOptions( rng, params, rootDir, engine, iwads, modFiles, mapPacks ))
+		return 1;
+
+	stdoutStream << "Generated " << iwads.size() << " IWADs, " << modFiles.size() << " mods, " << mapPacks.size() << " map packs, "
+	             << params.saveCount << " saves, " << params.demoCount << " demos and " << params.presetCount << " presets"
+	             << " into " << rootDir << " in " << timer.elapsed() << " ms" << Qt::endl;
+	stdoutStream << "Copy " << defaultOptionsFileName << " and its sidecar into the launcher's data directory to use it." << Qt::endl;
+	return 0;
+}
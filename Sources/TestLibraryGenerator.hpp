@@ -0,0 +1,34 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: generator of a fake huge installation for measuring how the launcher scales
+//======================================================================================================================
+
+#ifndef TEST_LIBRARY_GENERATOR_INCLUDED
+#define TEST_LIBRARY_GENERATOR_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include <QString>
+#include <QStringList>
+
+
+//======================================================================================================================
+
+/// Generates a fake Doom installation of a configurable size into an empty directory.
+/**
+  * The directory gets IWADs and mods with valid WAD headers, lump directories and MAPINFO lumps, a tree of map pack
+  * directories with a given depth and fan-out, an engine data directory full of save files and demos, and an options.json
+  * serialized by the same code as the application saves it, referencing all of it in the presets.
+  * The content is derived from a seed, so the same arguments always produce the same installation.
+  *
+  * Not part of the regular build, add "CONFIG+=dev_tools" to the qmake command to enable it.
+  * \param args Arguments following --generate-test-library on the command line.
+  * \return Exit code for the application.
+  */
+int generateTestLibrary( const QStringList & args );
+
+
+#endif // TEST_LIBRARY_GENERATOR_INCLUDED
@@ -127,6 +127,11 @@ static QColor getDefaultEntryColor( const QPalette & /*palette*/ )
 	return QColor(0x00,0x7F,0xFF);
 }
 
+static QColor getConflictingEntryColor( const QPalette & /*palette*/ )
+{
+	return QColor(0xE0,0x80,0x00);
+}
+
 static std::pair< QColor, QColor > deriveSeparatorColors( const QPalette & palette )
 {
 	QColor activeText = palette.color( QPalette::Active, QPalette::Text );
@@ -150,24 +155,40 @@ static const char * const schemeStrings [] =
 };
 static_assert( size_t(ColorScheme::_EnumEnd) == std::size(schemeStrings), "Please update this table" );
 
-static Palette palettes [ std::size(schemeStrings) ];
+// Only one palette is normally used during the whole run, so they are built on the first use, not all at startup.
+static std::optional< Palette > palettes [ std::size(schemeStrings) ];
+
+static QPalette c_systemPalette;  ///< palette of the application when it starts, depends on system settings
 
 // This cannot be done in a static initializer, because it depends on qApp being already initialized.
 static void initColorPalettes()
 {
-	{
-		Palette & systemPalette = palettes[ size_t(ColorScheme::SystemDefault) ];
+	// Only remember it, because after a different scheme is set, qApp->palette() no longer returns the system one.
+	c_systemPalette = qApp->palette();
+}
 
-		static_cast< QPalette & >( systemPalette ) = qApp->palette();
+static void deriveEntryColors( Palette & palette )
+{
+	palette.invalidEntryText = getInvalidEntryColor( palette );
+	palette.toBeCreatedEntryText = getToBeCreatedEntryColor( palette );
+	palette.defaultEntryText = getDefaultEntryColor( palette );
+	palette.conflictingEntryText = getConflictingEntryColor( palette );
+	std::tie( palette.separatorText, palette.separatorBackground ) = deriveSeparatorColors( palette );
+}
 
-		systemPalette.invalidEntryText = getInvalidEntryColor( systemPalette );
-		systemPalette.toBeCreatedEntryText = getToBeCreatedEntryColor( systemPalette );
-		systemPalette.defaultEntryText = getDefaultEntryColor( systemPalette );
-		std::tie( systemPalette.separatorText, systemPalette.separatorBackground ) = deriveSeparatorColors( systemPalette );
-	}
+static Palette buildColorPalette( ColorScheme schemeID )
+{
+	Palette palette;
 
+	if (schemeID == ColorScheme::SystemDefault)
 	{
-		Palette & darkPalette = palettes[ size_t(ColorScheme::Dark) ];
+		Palette & systemPalette = palette;
+
+		static_cast< QPalette & >( systemPalette ) = c_systemPalette;
+	}
+	else if (schemeID == ColorScheme::Dark)
+	{
+		Palette & darkPalette = palette;
 
 		// https://forum.qt.io/topic/101391/windows-10-dark-theme/4
 		QColor darkColor = QColor(0x2D,0x2D,0x2D);
@@ -187,15 +208,10 @@ static void initColorPalettes()
 		darkPalette.setColor( QPalette::All,      QPalette::Highlight, QColor(0x2A,0x82,0xDA) );
 		darkPalette.setColor( QPalette::All,      QPalette::HighlightedText, Qt::black );
 		darkPalette.setColor( QPalette::Disabled, QPalette::HighlightedText, disabledColor );
-
-		darkPalette.invalidEntryText = getInvalidEntryColor( darkPalette );
-		darkPalette.toBeCreatedEntryText = getToBeCreatedEntryColor( darkPalette );
-		darkPalette.defaultEntryText = getDefaultEntryColor( darkPalette );
-		std::tie( darkPalette.separatorText, darkPalette.separatorBackground ) = deriveSeparatorColors( darkPalette );
 	}
-
+	else if (schemeID == ColorScheme::Light)
 	{
-		Palette & lightPalette = palettes[ size_t(ColorScheme::Light) ];
+		Palette & lightPalette = palette;
 
 		// based on "Breeze Light" in KDE
 		setColorsForRole( lightPalette, QPalette::WindowText,      QColor(0x232629), QColor(0x232629), QColor(0xa0a1a3) );
@@ -218,15 +234,13 @@ static void initColorPalettes()
 		setColorsForRole( lightPalette, QPalette::ToolTipBase,     QColor(0xf7f7f7), QColor(0xf7f7f7), QColor(0xf7f7f7) );
 		setColorsForRole( lightPalette, QPalette::ToolTipText,     QColor(0x232629), QColor(0x232629), QColor(0x232629) );
 		setColorsForRole( lightPalette, QPalette::PlaceholderText, QColor(0x232629), QColor(0x232629), QColor(0x232629) );
-
-		lightPalette.invalidEntryText = getInvalidEntryColor( lightPalette );
-		lightPalette.toBeCreatedEntryText = getToBeCreatedEntryColor( lightPalette );
-		lightPalette.defaultEntryText = getDefaultEntryColor( lightPalette );
-		std::tie( lightPalette.separatorText, lightPalette.separatorBackground ) = deriveSeparatorColors( lightPalette );
 	}
 
 	// ---> Define new palettes here <---
 
+	// computed only once per scheme, the palette is then cached
+	deriveEntryColors( palette );
+
 	/* Full palette dumps for reference
 
 	Windows 10 default
@@ -322,6 +336,18 @@ static void initColorPalettes()
 	PlaceholderText   #ffffff   #ffffff   #ffffff
 
 	*/
+
+	return palette;
+}
+
+static const Palette & getColorPalette( ColorScheme schemeID )
+{
+	std::optional< Palette > & palette = palettes[ size_t(schemeID) ];
+	if (!palette)
+	{
+		palette = buildColorPalette( schemeID );
+	}
+	return *palette;
 }
 
 static ColorScheme g_currentRealSchemeID = ColorScheme::SystemDefault;  ///< the scheme that was really set after examining system settings
@@ -332,8 +358,15 @@ static void setQtColorScheme( ColorScheme schemeID )
 	{
 		return;  // nothing to be done, this scheme is already active
 	}
-	qApp->setPalette( palettes[ size_t(schemeID) ] );
+	const Palette & palette = getColorPalette( schemeID );
 	g_currentRealSchemeID = schemeID;
+	// Setting the application palette goes through the whole widget tree and repaints every widget.
+	// The light scheme on a light system for example often doesn't change a single color, so skip the repolishing then.
+	if (palette == qApp->palette())
+	{
+		return;
+	}
+	qApp->setPalette( palette );
 }
 
 const char * schemeToString( ColorScheme scheme )
@@ -548,8 +581,16 @@ static void toggleDarkTitleBar( HWND hWnd, bool enable )
 	DwmSetWindowAttribute( hWnd, DWMWA_USE_IMMERSIVE_DARK_MODE, &useDarkMode, sizeof(useDarkMode) );
 }
 
+static std::optional< bool > g_darkTitleBarsEnabled;  ///< what was last applied to all windows, nothing before the first time
+
 static void toggleDarkTitleBars( bool enable )
 {
+	if (g_darkTitleBarsEnabled == enable)
+	{
+		return;  // already set, and new windows are handled by updateWindowBorder(), focusing every window again would only flicker
+	}
+	g_darkTitleBarsEnabled = enable;
+
 	QWindow * focusWindow = qApp->focusWindow();
 	for (QWindow * window : qApp->topLevelWindows())
 	{
@@ -676,12 +717,12 @@ void setAppColorScheme( ColorScheme userSchemeID )
 
 const Palette & getCurrentPalette()
 {
-	return palettes[ size_t(g_currentRealSchemeID) ];
+	return getColorPalette( g_currentRealSchemeID );
 }
 
 QString updateHyperlinkColor( QString richText )
 {
-	QString htmlColor = palettes[ size_t( g_currentRealSchemeID ) ].color( QPalette::Link ).name();
+	QString htmlColor = getColorPalette( g_currentRealSchemeID ).color( QPalette::Link ).name();
 	QString newText( std::move(richText) );
 	static const QRegularExpression regex("color:#[0-9a-fA-F]{6}");
 	newText.replace( regex, "color:"+htmlColor );
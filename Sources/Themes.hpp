@@ -37,6 +37,7 @@ struct Palette : public QPalette
 	QColor invalidEntryText;       ///< text color for a file/directory that doesn't exist or has a wrong type
 	QColor toBeCreatedEntryText;   ///< text color for a file/directory that doesn't exist but can be created
 	QColor defaultEntryText;       ///< text color for a file/directory that is set as default
+	QColor conflictingEntryText;   ///< text color for a file that overrides or is overridden by another file in the load order
 	QColor separatorText;          ///< text color for an entry that represents a visual separator
 	QColor separatorBackground;    ///< background color for an entry that represents a visual separator
 };
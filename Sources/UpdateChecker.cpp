@@ -10,12 +10,19 @@
 #include "Version.hpp"
 #include "Themes.hpp"  // updateWindowBorder
 #include "Utils/LangUtils.hpp"  // atScopeEndDo
+#include "Utils/FileSystemUtils.hpp"  // readWholeFile
+#include "Utils/AsyncFileWriter.hpp"
 #include "Utils/WidgetUtils.hpp"  // HYPERLINK
 
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QRegularExpression>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QCoreApplication>
 
 #include <QStringBuilder>
 #include <QMessageBox>
@@ -34,6 +41,10 @@ static const QString releasePageUrl = "https://github.com/Youda008/DoomRunner/re
 static const QString changelogUrl = "https://raw.githubusercontent.com/Youda008/DoomRunner/master/changelog.txt";
 
 
+static QString g_stateFilePath;
+static AsyncFileWriter * g_stateFileWriter = nullptr;
+
+
 UpdateChecker::UpdateChecker()
 :
 	LoggingComponent("UpdateChecker")
@@ -43,13 +54,48 @@ UpdateChecker::UpdateChecker()
 
 UpdateChecker::~UpdateChecker() {}
 
-void UpdateChecker::checkForUpdates_async( ResultCallback && callback )
+void UpdateChecker::setStateFilePath( const QString & filePath, AsyncFileWriter & fileWriter )
+{
+	g_stateFilePath = filePath;
+	g_stateFileWriter = &fileWriter;
+}
+
+void UpdateChecker::checkForUpdates_async( ResultCallback && callback, bool requestedByUser )
+{
+	loadState();
+
+	// The lab machines and alike start the application many times a day, there is no need to ask every time.
+	qint64 now = QDateTime::currentSecsSinceEpoch();
+	auto cachedVersionIter = cachedFiles.find( availableVersionUrl );
+	if (!requestedByUser && cachedVersionIter != cachedFiles.end() && now - lastCheckTime < minCheckIntervalSecs
+	 && now >= lastCheckTime)  // the clock might have been moved back
+	{
+		RequestData requestData{ Phase::VersionRequest, {}, std::move(callback), /*fromStoredFiles*/true };
+		versionReceived( cachedVersionIter->body, requestData );
+		return;
+	}
+
+	sendRequest( availableVersionUrl, { Phase::VersionRequest, {}, std::move(callback) } );
+}
+
+void UpdateChecker::sendRequest( const QString & url, RequestData && requestData )
 {
 	QNetworkRequest request;
-	request.setUrl( availableVersionUrl );
+	request.setUrl( url );
+
+	// if we have the file from the last time, let the server answer only whether it has changed
+	auto cachedIter = cachedFiles.find( url );
+	if (cachedIter != cachedFiles.end())
+	{
+		if (!cachedIter->etag.isEmpty())
+			request.setRawHeader( "If-None-Match", cachedIter->etag );
+		if (!cachedIter->lastModified.isEmpty())
+			request.setRawHeader( "If-Modified-Since", cachedIter->lastModified );
+	}
+
 	QNetworkReply * reply = manager.get( request );
 
-	pendingRequests[ reply ] = { Phase::VersionRequest, {}, std::move(callback) };
+	pendingRequests[ reply ] = std::move(requestData);
 }
 
 void UpdateChecker::requestFinished( QNetworkReply * reply )
@@ -62,7 +108,7 @@ void UpdateChecker::requestFinished( QNetworkReply * reply )
 	}
 	RequestData & requestData = requestIter.value();
 
-	auto guard = atScopeEndDo( [&](){ pendingRequests.erase( requestIter ); } );
+	auto guard = atScopeEndDo( [&](){ pendingRequests.erase( requestIter ); reply->deleteLater(); } );
 
 	if (reply->error())
 	{
@@ -73,24 +119,60 @@ void UpdateChecker::requestFinished( QNetworkReply * reply )
 
 	if (requestData.phase == Phase::VersionRequest)
 	{
-		versionReceived( reply, requestData );
+		QByteArray versionFile = receiveBody( reply, availableVersionUrl );
+		lastCheckTime = QDateTime::currentSecsSinceEpoch();
+		saveState();
+		versionReceived( versionFile, requestData );
 	}
 	else
 	{
-		changelogReceived( reply, requestData );
+		QByteArray changelog = receiveBody( reply, changelogUrl );
+		saveState();
+		changelogReceived( changelog, requestData );
+	}
+}
+
+QByteArray UpdateChecker::receiveBody( QNetworkReply * reply, const QString & url )
+{
+	int statusCode = reply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt();
+	if (statusCode == 304)  // Not Modified
+	{
+		auto cachedIter = cachedFiles.find( url );
+		if (cachedIter != cachedFiles.end())
+			return cachedIter->body;
+		logRuntimeError() << "The server answered 304 to an unconditional request for " << url;
+		return {};
 	}
+
+	CachedFile & cached = cachedFiles[ url ];
+	cached.etag = reply->rawHeader( "ETag" );
+	cached.lastModified = reply->rawHeader( "Last-Modified" );
+	cached.body = reply->readAll();
+	return cached.body;
 }
 
-void UpdateChecker::versionReceived( QNetworkReply * reply, RequestData & requestData )
+void UpdateChecker::postResult( ResultCallback && callback, Result result, QString errorDetail, QStringVec versionInfo )
 {
-	QString version( reply->readLine( 16 ) );
+	// the callers expect to be called later, for example the AboutDialog disables its button after starting the check
+	QMetaObject::invokeMethod( this,
+		[ callback = std::move(callback), result, errorDetail = std::move(errorDetail), versionInfo = std::move(versionInfo) ]()
+		{
+			callback( result, errorDetail, versionInfo );
+		},
+		Qt::QueuedConnection
+	);
+}
 
-	static const QRegularExpression versionFileRegex("^\"([0-9\\.]+)\"$");
+void UpdateChecker::versionReceived( const QByteArray & versionFile, RequestData & requestData )
+{
+	QString version = QString::fromUtf8( versionFile.left( versionFile.indexOf('\n') ) ).left( 16 );
+
+	static const QRegularExpression versionFileRegex("^\"([0-9\\.]+)\"\\r?$");
 	auto match = versionFileRegex.match( version );
 	if (!match.hasMatch())
 	{
 		logLogicError().noquote() << "Version number from github is in invalid format ("<<version<<"). Fix it!";
-		requestData.callback( InvalidFormat, std::move(version), {} );
+		postResult( std::move(requestData.callback), InvalidFormat, std::move(version), {} );
 		return;
 	}
 	QString availableVersionStr = match.captured(1);
@@ -99,26 +181,25 @@ void UpdateChecker::versionReceived( QNetworkReply * reply, RequestData & reques
 	bool updateAvailable = availableVersion > appVersion;
 	if (!updateAvailable)
 	{
-		requestData.callback( UpdateNotAvailable, {}, { availableVersionStr } );
+		postResult( std::move(requestData.callback), UpdateNotAvailable, {}, { availableVersionStr } );
 		return;
 	}
 
-	QNetworkRequest request;
-	request.setUrl( changelogUrl );
-	QNetworkReply * reply2 = manager.get( request );
-
-	pendingRequests[ reply2 ] = { Phase::ChangelogRequest, std::move(availableVersionStr), std::move(requestData.callback) };
-}
+	// Within the minimum interval the stored changelog is used too, it was received together with the stored version file.
+	auto cachedChangelogIter = cachedFiles.find( changelogUrl );
+	if (requestData.fromStoredFiles && cachedChangelogIter != cachedFiles.end())
+	{
+		requestData.newVersion = std::move(availableVersionStr);
+		changelogReceived( cachedChangelogIter->body, requestData );
+		return;
+	}
 
-// fucking Qt, are you fucking kidding me?
-static QString getLine( QNetworkReply * reply )
-{
-	QString line( reply->readLine() );  // what fucking sense does it make to include the '\n' char at every line
-	line.chop(1);                       // so that the user has to chop it himself???
-	return line;
+	// The changelog is requested conditionally too. When the version file changes, the changelog is downloaded
+	// once, and from then on the server only confirms our stored copy, until the next release.
+	sendRequest( changelogUrl, { Phase::ChangelogRequest, std::move(availableVersionStr), std::move(requestData.callback) } );
 }
 
-void UpdateChecker::changelogReceived( QNetworkReply * reply, RequestData & requestData )
+void UpdateChecker::changelogReceived( const QByteArray & changelog, RequestData & requestData )
 {
 	/* changelog format
 	1.5
@@ -135,19 +216,82 @@ void UpdateChecker::changelogReceived( QNetworkReply * reply, RequestData & requ
 	...
 	*/
 
-	QString line;
+	QStringList lines = QString::fromUtf8( changelog ).split('\n');
+	for (QString & line : lines)
+		if (line.endsWith('\r'))
+			line.chop(1);
+
 	QStringVec versionInfo;
 
 	// find the line with the new version
-	while ((line = getLine( reply )) != requestData.newVersion && !reply->atEnd()) {}
-	versionInfo.append( line );
+	int lineIdx = 0;
+	while (lineIdx < lines.size() && lines[ lineIdx ] != requestData.newVersion)
+		++lineIdx;
+	versionInfo.append( requestData.newVersion );
 
 	// get all changes until our current version
-	while ((line = getLine( reply )) != appVersion && !reply->atEnd())
-		versionInfo.append( std::move(line) );
+	for (++lineIdx; lineIdx < lines.size() && lines[ lineIdx ] != appVersion; ++lineIdx)
+		versionInfo.append( lines[ lineIdx ] );
 
 	// finally, call the user callback with all the data
-	requestData.callback( UpdateAvailable, {}, std::move(versionInfo) );
+	postResult( std::move(requestData.callback), UpdateAvailable, {}, std::move(versionInfo) );
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+//  persistent state
+
+void UpdateChecker::loadState()
+{
+	if (stateLoaded || g_stateFilePath.isEmpty())
+		return;
+	stateLoaded = true;
+
+	if (!QFileInfo::exists( g_stateFilePath ))
+		return;  // first check
+
+	QByteArray content;
+	QString error = fs::readWholeFile( g_stateFilePath, content );
+	if (!error.isEmpty())
+	{
+		logRuntimeError() << "Failed to read the stored state of the update checks: " << error;
+		return;
+	}
+
+	// it's only a cache, if anything is wrong, the files will be just downloaded again
+	QJsonObject jsRoot = QJsonDocument::fromJson( content ).object();
+	lastCheckTime = qint64( jsRoot["last_check"].toDouble() );
+	const QJsonObject jsFiles = jsRoot["files"].toObject();
+	for (auto it = jsFiles.begin(); it != jsFiles.end(); ++it)
+	{
+		QJsonObject jsFile = it.value().toObject();
+		CachedFile cached;
+		cached.etag = jsFile["etag"].toString().toUtf8();
+		cached.lastModified = jsFile["last_modified"].toString().toUtf8();
+		cached.body = jsFile["body"].toString().toUtf8();
+		cachedFiles.insert( it.key(), std::move(cached) );
+	}
+}
+
+void UpdateChecker::saveState()
+{
+	if (g_stateFilePath.isEmpty() || !g_stateFileWriter)
+		return;
+
+	QJsonObject jsFiles;
+	for (auto it = cachedFiles.begin(); it != cachedFiles.end(); ++it)
+	{
+		QJsonObject jsFile;
+		jsFile["etag"] = QString::fromUtf8( it->etag );
+		jsFile["last_modified"] = QString::fromUtf8( it->lastModified );
+		jsFile["body"] = QString::fromUtf8( it->body );
+		jsFiles[ it.key() ] = jsFile;
+	}
+	QJsonObject jsRoot;
+	jsRoot["last_check"] = double( lastCheckTime );
+	jsRoot["files"] = jsFiles;
+
+	// it's only a cache, the writer logs the error, the files will be just downloaded again next time
+	g_stateFileWriter->writeFile( g_stateFilePath, QJsonDocument( jsRoot ).toJson() );
 }
 
 
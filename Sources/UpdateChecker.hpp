@@ -16,14 +16,22 @@
 #include <QObject>
 #include <QString>
 #include <QHash>
+#include <QByteArray>
 #include <QNetworkAccessManager>
 
 #include <functional>
 
+class AsyncFileWriter;
+
 
 //======================================================================================================================
 /// Asynchronous update checking tool.
-/** The object must live until a response is received, i.e. it can't be local in a function. */
+/** The object must live until a response is received, i.e. it can't be local in a function.
+  *
+  * The downloaded files are stored together with their HTTP validators (ETag, Last-Modified) in a state file,
+  * so that the next checks send conditional requests and the server usually answers with a short 304 response.
+  * The automatic checks are additionally not repeated more often than minCheckInterval, the result of the last check
+  * is used instead, including the changelog when an update is available. */
 
 class UpdateChecker : public QObject, protected LoggingComponent {
 
@@ -44,8 +52,19 @@ class UpdateChecker : public QObject, protected LoggingComponent {
 
 	using ResultCallback = std::function< void ( Result result, QString errorDetail, QStringVec versionInfo ) >;
 
+	/// How often the automatic checks actually go to the network.
+	static constexpr qint64 minCheckIntervalSecs = 6 * 60 * 60;
+
+	/// Sets where the downloaded files and their validators are stored between the sessions, shared by all instances.
+	/** Without it, every check downloads the files again. The file is written by the fileWriter, which must outlive
+	  * the checks in progress. */
+	static void setStateFilePath( const QString & filePath, AsyncFileWriter & fileWriter );
+
 	/// Asynchronously checks for updates via HTTP connection and calls your callback when it's ready.
-	void checkForUpdates_async( ResultCallback && callback );
+	/** If the check is not requested by the user and the last check happened less than minCheckInterval ago,
+	  * the result is computed from the stored files without connecting anywhere. The callback is always called
+	  * asynchronously. */
+	void checkForUpdates_async( ResultCallback && callback, bool requestedByUser = false );
 
  private:
 
@@ -62,15 +81,37 @@ class UpdateChecker : public QObject, protected LoggingComponent {
 		Phase phase;
 		QString newVersion;
 		ResultCallback callback;
+		bool fromStoredFiles = false;  ///< the minimum interval hasn't passed yet, the network must not be touched
 	};
 
-	void versionReceived( QNetworkReply * reply, RequestData & requestData );
-	void changelogReceived( QNetworkReply * reply, RequestData & requestData );
+	void sendRequest( const QString & url, RequestData && requestData );
+	/// Returns the content of the reply, or the stored content if the server says it hasn't changed.
+	QByteArray receiveBody( QNetworkReply * reply, const QString & url );
+
+	void versionReceived( const QByteArray & versionFile, RequestData & requestData );
+	void changelogReceived( const QByteArray & changelog, RequestData & requestData );
+
+	/// Calls the callback from the event loop, like it would be called after a network reply.
+	void postResult( ResultCallback && callback, Result result, QString errorDetail, QStringVec versionInfo );
+
+	// persistent state
+	struct CachedFile
+	{
+		QByteArray etag;
+		QByteArray lastModified;
+		QByteArray body;
+	};
+	void loadState();
+	void saveState();
 
  private:
 
 	QNetworkAccessManager manager;
 
+	QHash< QString, CachedFile > cachedFiles;  ///< key is the URL
+	qint64 lastCheckTime = 0;   ///< seconds since epoch, when a version file was last received from the server
+	bool stateLoaded = false;
+
 	QHash< QNetworkReply *, RequestData > pendingRequests;
 
 };
@@ -15,12 +15,14 @@
 #include "Utils/JsonUtils.hpp"       // enumName, enumSize
 #include "Utils/FileSystemUtils.hpp" // PathStyle
 #include "Utils/OSUtils.hpp"         // EnvVar
+#include "Utils/StringPool.hpp"      // g_pathPool
 #include "EngineTraits.hpp"          // EngineFamily
 #include "Themes.hpp"                // Theme
 
 #include <QString>
 #include <QFileInfo>
 #include <QRect>
+#include <QJsonObject>
 
 
 //======================================================================================================================
@@ -68,7 +70,7 @@ struct IWAD : public EditableListModelItem
 	QString path;   ///< path to the IWAD file
 
 	IWAD() {}
-	IWAD( const QFileInfo & file ) : name( file.fileName() ), path( file.filePath() ) {}
+	IWAD( const QFileInfo & file ) : name( file.fileName() ), path( g_pathPool.intern( file.filePath() ) ) {}
 
 	// requirements of EditableListModel
 	bool isEditable() const                 { return true; }
@@ -87,7 +89,7 @@ struct Mod : public EditableListModelItem
 
 	Mod() {}
 	Mod( const QFileInfo & file, bool checked = true )
-		: path( file.filePath() ), fileName( file.fileName() ), checked( checked ) {}
+		: path( g_pathPool.intern( file.filePath() ) ), fileName( g_pathPool.intern( file.fileName() ) ), checked( checked ) {}
 
 	// requirements of EditableListModel
 	bool isEditable() const                 { return isCmdArg; }
@@ -269,14 +271,30 @@ struct Preset : public EditableListModelItem
 
 	EnvVars envVars;
 
+	QString lastLoadPhases;   ///< how long the phases of the engine's loading took in the last launch, see LoadPhaseTracker
+
+	/// Content of this preset that hasn't been deserialized yet, empty if the preset is fully loaded.
+	/** To make the startup fast, only the name is loaded from the options file at first,
+	  * the rest is deserialized by loadPresetContent() when the preset is needed for the first time. */
+	QJsonObject unloadedJson;
+
+	/// JSON of this preset from the last time the options were saved, empty if the preset has been modified since.
+	/** Not part of the user data, it only saves the serializer from re-serializing presets that haven't changed. */
+	mutable QJsonObject serializedJson;
+
 	Preset() {}
 	Preset( const QString & name ) : name( name ) {}
 	Preset( const QFileInfo & ) {}  // dummy, it's required by the EditableListModel template, but isn't actually used
 
+	/// Must be called whenever any of the members above is modified, otherwise the change will not get saved.
+	void markModified() const               { serializedJson = QJsonObject(); }
+
+	bool isLoaded() const                   { return unloadedJson.isEmpty(); }
+
 	// requirements of EditableListModel
 	bool isEditable() const                 { return true; }
 	const QString & getEditString() const   { return name; }
-	void setEditString( QString str )       { name = std::move(str); }
+	void setEditString( QString str )       { name = std::move(str); markModified(); }
 	QString getID() const                   { return name; }
 };
 
@@ -291,14 +309,41 @@ struct EngineSettings
 struct IwadSettings
 {
 	QString dir;                  ///< directory to update IWAD list from (value returned by SetupDialog)
+	QStringVec extraDirs;         ///< additional directories (e.g. on other disks), their IWADs are merged with the ones from dir
 	bool updateFromDir = false;   ///< whether the IWAD list should be periodically updated from a directory
 	bool searchSubdirs = false;   ///< whether to search for IWADs recursivelly in subdirectories
+	bool detectByHeader = false;  ///< whether to recognize IWADs by the file header instead of just by the suffix
 	QString defaultIWAD;
+
+	/// All the directories to update the IWAD list from, in the order of priority.
+	QStringVec getDirs() const
+	{
+		QStringVec dirs;
+		if (!dir.isEmpty())
+			dirs.append( dir );
+		for (const QString & extraDir : extraDirs)
+			if (!extraDir.isEmpty() && !dirs.contains( extraDir ))
+				dirs.append( extraDir );
+		return dirs;
+	}
 };
 
 struct MapSettings
 {
 	QString dir;   ///< directory with map packs to automatically load the list from
+	QStringVec extraDirs;   ///< additional directories (e.g. on other disks), each of them is displayed as a separate tree
+
+	/// All the directories to load the map packs from, the selected map packs are stored relative to them.
+	QStringVec getDirs() const
+	{
+		QStringVec dirs;
+		if (!dir.isEmpty())
+			dirs.append( dir );
+		for (const QString & extraDir : extraDirs)
+			if (!extraDir.isEmpty() && !dirs.contains( extraDir ))
+				dirs.append( extraDir );
+		return dirs;
+	}
 };
 
 struct ModSettings
@@ -335,6 +380,11 @@ struct LauncherSettings : public StorageSettings  // inherited instead of includ
 	bool closeOnLaunch = false;
 	bool checkForUpdates = true;
 	bool askForSandboxPermissions = true;
+	bool pollDirectories = false;   ///< periodically re-scan directories instead of watching them for changes
+	bool prewarmFiles = false;   ///< read the files of the selected preset into the system cache before launching
+	bool shareFileCache = false;   ///< exchange the WAD info with the other installations on this machine
+	bool logEngineOutput = false;   ///< save the output of the engine shown in the output window to a file
+	int maxCachedFiles = 10000;   ///< how many files each of the file-info caches remembers, 0 means unlimited, only in the options file
 
 	void assign( const StorageSettings & other ) { static_cast< StorageSettings & >( *this ) = other; }
 };
@@ -372,6 +422,8 @@ struct EngineInfo : public Engine, public EngineTraits, private os::SandboxInfo
 	auto sandboxEnvType() const           { return SandboxInfo::type; }
 	auto sandboxEnvName() const           { return getSandboxName( SandboxInfo::type ); }
 	const auto & sandboxAppName() const   { return SandboxInfo::appName; }
+	/// Determined once by initSandboxInfo(), so that the launch doesn't have to match the path again.
+	const os::SandboxInfo & sandboxInfo() const   { return *this; }
 };
 
 
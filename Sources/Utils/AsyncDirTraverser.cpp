@@ -0,0 +1,267 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: directory traversal in a background thread
+//======================================================================================================================
+
+#include "AsyncDirTraverser.hpp"
+
+#include "DirSnapshotCache.hpp"
+
+#include <QRunnable>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDirIterator>
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <algorithm>
+
+
+//======================================================================================================================
+
+/// How many entries the worker collects before it notifies the main thread.
+static constexpr int BatchSize = 256;
+
+struct AsyncDirTraverser::Job
+{
+	quint64 id;
+	QString dir;
+	std::atomic< bool > cancelled { false };
+
+	// shared between the worker thread and the main thread
+	QMutex mutex;
+	QList< QFileInfo > readyEntries;
+	bool finished = false;
+	diag::ScanHistory::Scan stats;   ///< valid when finished
+
+	// accessed only from the main thread
+	BatchCallback onBatch;
+	FinishCallback onFinished;
+};
+
+class AsyncDirTraverser::Task : public QRunnable {
+
+ public:
+
+	Task(
+		AsyncDirTraverser * owner, std::shared_ptr< Job > job, const QString & dir, bool recursively,
+		fs::EntryTypes typesToVisit, const PathConvertor & pathConvertor, EntryFilter && entryFilter,
+		std::optional< QStringVec > && fileSuffixes = std::nullopt
+	)
+	:
+		_owner( owner ), _job( std::move(job) ), _dir( dir ), _recursively( recursively ), _typesToVisit( typesToVisit ),
+		// QDir caches some of its data lazily, so rather don't share its instance with the main thread and make our own.
+		_workingDirPath( pathConvertor.workingDir().path() ), _pathStyle( pathConvertor.pathStyle() ),
+		_entryFilter( std::move(entryFilter) ), _fileSuffixes( std::move(fileSuffixes) )
+	{}
+
+	virtual void run() override
+	{
+		PathConvertor pathConvertor( QDir( _workingDirPath ), _pathStyle );
+
+		QElapsedTimer timer;
+		timer.start();
+		int entriesVisited = 0;
+		int entriesMatched = 0;
+
+		QList< QFileInfo > batch;
+
+		if (_typesToVisit.isSet( fs::EntryType::FILE ) && !_typesToVisit.isSet( fs::EntryType::DIR ))
+		{
+			// Only files are requested, those can be taken from the snapshot if the directories haven't changed.
+			const QStringList filePaths = fs::g_cachedDirSnapshots.getFiles( _dir, _recursively );
+			for (const QString & filePath : filePaths)
+			{
+				if (_job->cancelled)
+				{
+					return;  // nobody is waiting for the result anymore
+				}
+
+				++entriesVisited;
+
+				// check the name first, so that the non-matching files are not even converted
+				if (_fileSuffixes && !fs::hasOneOfSuffixes( filePath, *_fileSuffixes ))
+				{
+					continue;
+				}
+
+				QFileInfo entry( pathConvertor.convertPath( filePath ) );
+				if (!_entryFilter || _entryFilter( entry ))
+				{
+					++entriesMatched;
+					batch.append( std::move(entry) );
+					if (batch.size() >= BatchSize)
+					{
+						handOver( batch, /*finished*/false );
+					}
+				}
+			}
+		}
+		else if (!_dir.isEmpty() && QDir( _dir ).exists())
+		{
+			// equivalent of fs::traverseDirectory(), just interruptible
+			QDirIterator dirIt( _dir, QDir::AllEntries | QDir::NoDotAndDotDot,
+				_recursively ? QDirIterator::Subdirectories | QDirIterator::FollowSymlinks : QDirIterator::NoIteratorFlags
+			);
+			while (dirIt.hasNext())
+			{
+				if (_job->cancelled)
+				{
+					return;  // nobody is waiting for the result anymore
+				}
+
+				QFileInfo entry( pathConvertor.convertPath( dirIt.next() ) );
+				++entriesVisited;
+				bool isDesiredType = entry.isDir() ? _typesToVisit.isSet( fs::EntryType::DIR ) : _typesToVisit.isSet( fs::EntryType::FILE );
+				if (isDesiredType && (!_entryFilter || _entryFilter( entry )))
+				{
+					++entriesMatched;
+					batch.append( std::move(entry) );
+					if (batch.size() >= BatchSize)
+					{
+						handOver( batch, /*finished*/false );
+					}
+				}
+			}
+		}
+
+		{
+			QMutexLocker lock( &_job->mutex );
+			_job->stats = { _dir, timer.elapsed(), entriesVisited, entriesMatched };
+		}
+		handOver( batch, /*finished*/true );
+	}
+
+ private:
+
+	void handOver( QList< QFileInfo > & batch, bool finished )
+	{
+		{
+			QMutexLocker lock( &_job->mutex );
+			_job->readyEntries.append( batch );
+			_job->finished = finished;
+		}
+		batch.clear();
+
+		// emitted from a different thread than the owner lives in, so the slot will be invoked in the main thread
+		emit _owner->jobProgressed( _job->id );
+	}
+
+	AsyncDirTraverser * _owner;
+	std::shared_ptr< Job > _job;
+	QString _dir;
+	bool _recursively;
+	fs::EntryTypes _typesToVisit;
+	QString _workingDirPath;
+	PathStyle _pathStyle;
+	EntryFilter _entryFilter;
+	std::optional< QStringVec > _fileSuffixes;  ///< only files with these suffixes are visited, if set
+
+};
+
+
+//======================================================================================================================
+
+AsyncDirTraverser::AsyncDirTraverser() : LoggingComponent("AsyncDirTraverser")
+{
+	connect( this, &AsyncDirTraverser::jobProgressed, this, &AsyncDirTraverser::onJobProgressed, Qt::QueuedConnection );
+}
+
+AsyncDirTraverser::~AsyncDirTraverser()
+{
+	cancelAll();
+	_threadPool.waitForDone();  // the tasks refer to this object
+}
+
+std::shared_ptr< AsyncDirTraverser::Job > AsyncDirTraverser::createJob(
+	const void * requester, const QString & dir, BatchCallback && onBatch, FinishCallback && onFinished
+){
+	cancel( requester );  // the previous result would be outdated anyway
+
+	auto job = std::make_shared< Job >();
+	job->id = ++_lastJobID;
+	job->dir = dir;
+	job->onBatch = std::move(onBatch);
+	job->onFinished = std::move(onFinished);
+	_jobs.insert( requester, job );
+
+	return job;
+}
+
+void AsyncDirTraverser::traverse(
+	const void * requester, const QString & dir, bool recursively, fs::EntryTypes typesToVisit,
+	const PathConvertor & pathConvertor, EntryFilter entryFilter, BatchCallback onBatch, FinishCallback onFinished
+){
+	auto job = createJob( requester, dir, std::move(onBatch), std::move(onFinished) );
+
+	_threadPool.start( new Task( this, std::move(job), dir, recursively, typesToVisit, pathConvertor, std::move(entryFilter) ) );
+}
+
+void AsyncDirTraverser::traverseFiles(
+	const void * requester, const QString & dir, bool recursively, const QStringVec & fileSuffixes,
+	const PathConvertor & pathConvertor, BatchCallback onBatch, FinishCallback onFinished
+){
+	auto job = createJob( requester, dir, std::move(onBatch), std::move(onFinished) );
+
+	_threadPool.start( new Task(
+		this, std::move(job), dir, recursively, fs::EntryType::FILE, pathConvertor, /*entryFilter*/{}, QStringVec( fileSuffixes )
+	));
+}
+
+void AsyncDirTraverser::cancel( const void * requester )
+{
+	auto iter = _jobs.find( requester );
+	if (iter != _jobs.end())
+	{
+		logDebug() << "cancelling traversal " << iter.value()->id;
+		iter.value()->cancelled = true;
+		_jobs.erase( iter );
+	}
+}
+
+void AsyncDirTraverser::cancelAll()
+{
+	for (const auto & job : _jobs)
+		job->cancelled = true;
+	_jobs.clear();
+}
+
+void AsyncDirTraverser::onJobProgressed( quint64 jobID )
+{
+	// the job might have been cancelled or replaced while this notification was waiting in the event queue
+	auto iter = std::find_if( _jobs.begin(), _jobs.end(), [&]( const auto & job ) { return job->id == jobID; } );
+	if (iter == _jobs.end())
+		return;
+
+	const void * requester = iter.key();
+	std::shared_ptr< Job > job = iter.value();  // keep it alive, the callbacks may start a new traversal that replaces it
+
+	QList< QFileInfo > entries;
+	bool finished;
+	diag::ScanHistory::Scan stats;
+	{
+		QMutexLocker lock( &job->mutex );
+		entries.swap( job->readyEntries );
+		finished = job->finished;
+		stats = job->stats;
+	}
+
+	if (finished)
+	{
+		_lastScans.add( std::move(stats) );
+	}
+
+	if (!entries.isEmpty() && job->onBatch)
+	{
+		job->onBatch( std::move(entries) );
+	}
+
+	if (finished && !job->cancelled)
+	{
+		_jobs.remove( requester );
+		if (job->onFinished)
+			job->onFinished();
+	}
+}
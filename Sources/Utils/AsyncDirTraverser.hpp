@@ -0,0 +1,104 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: directory traversal in a background thread
+//======================================================================================================================
+
+#ifndef ASYNC_DIR_TRAVERSER_INCLUDED
+#define ASYNC_DIR_TRAVERSER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "CommonTypes.hpp"
+#include "FileSystemUtils.hpp"  // EntryTypes, PathConvertor
+#include "ErrorHandling.hpp"  // LoggingComponent
+#include "Diagnostics.hpp"  // ScanHistory
+
+#include <QObject>
+#include <QThreadPool>
+#include <QHash>
+#include <QList>
+#include <QFileInfo>
+
+#include <functional>
+#include <memory>
+
+
+//======================================================================================================================
+/// Walks directories on worker threads and hands the found entries over to the main thread in batches.
+/**
+  * Listing a directory means a stat() for every entry, which on a large tree with subdirectories or on a slow network
+  * share can take hundreds of milliseconds and freeze the whole window, when done on the main thread.
+  *
+  * Each traversal is identified by its requester (typically the model that will display the result). Starting a new
+  * traversal for the same requester cancels the previous one that is still in progress, so that an outdated result
+  * can never overwrite a newer one.
+  *
+  * Must be constructed and used from the main thread, all the callbacks except entryFilter are called in the main thread.
+  */
+class AsyncDirTraverser : public QObject, protected LoggingComponent {
+
+	Q_OBJECT
+
+ public:
+
+	/// Called from the worker thread, so it must not touch anything that the main thread might be modifying.
+	using EntryFilter = std::function< bool ( const QFileInfo & entry ) >;
+	using BatchCallback = std::function< void ( QList< QFileInfo > && entries ) >;
+	using FinishCallback = std::function< void () >;
+
+	AsyncDirTraverser();
+	virtual ~AsyncDirTraverser() override;
+
+	/// Starts traversing a directory in a worker thread.
+	/** Found entries matching the entryFilter are passed to onBatch in the order of traversal, as they are being found.
+	  * When the traversal is complete, onFinished is called. If the traversal is cancelled, none of them is called anymore. */
+	void traverse(
+		const void * requester, const QString & dir, bool recursively, fs::EntryTypes typesToVisit,
+		const PathConvertor & pathConvertor, EntryFilter entryFilter, BatchCallback onBatch, FinishCallback onFinished
+	);
+
+	/// Starts traversing a directory in a worker thread, visiting only files with one of the specified suffixes.
+	/** The file names are checked before any other processing, so this is faster than checking the suffix in entryFilter. */
+	void traverseFiles(
+		const void * requester, const QString & dir, bool recursively, const QStringVec & fileSuffixes,
+		const PathConvertor & pathConvertor, BatchCallback onBatch, FinishCallback onFinished
+	);
+
+	bool isInProgress( const void * requester ) const   { return _jobs.contains( requester ); }
+
+	/// Statistics of the last finished traversals, for the diagnostics. The duration is of the traversal in the worker thread.
+	const diag::ScanHistory & lastScans() const   { return _lastScans; }
+
+	/// Cancels the traversal started by this requester, if there is one still in progress.
+	void cancel( const void * requester );
+
+	void cancelAll();
+
+ signals:
+
+	/// Emitted from the worker thread when new entries are ready to be picked up. Not meant to be used from outside.
+	void jobProgressed( quint64 jobID );
+
+ private slots:
+
+	void onJobProgressed( quint64 jobID );
+
+ private:
+
+	struct Job;
+	class Task;
+
+	std::shared_ptr< Job > createJob( const void * requester, const QString & dir, BatchCallback && onBatch, FinishCallback && onFinished );
+
+	QThreadPool _threadPool;
+	quint64 _lastJobID = 0;
+	QHash< const void *, std::shared_ptr< Job > > _jobs;  ///< traversals in progress, key is the requester
+	diag::ScanHistory _lastScans;
+
+};
+
+
+#endif // ASYNC_DIR_TRAVERSER_INCLUDED
@@ -0,0 +1,96 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: writing files in a background thread
+//======================================================================================================================
+
+#include "AsyncFileWriter.hpp"
+
+#include "FileSystemUtils.hpp"  // updateFileSafely
+#include "TaskGroup.hpp"  // postToMainThread
+
+#include <QRunnable>
+
+
+//======================================================================================================================
+
+AsyncFileWriter::AsyncFileWriter() : LoggingComponent("AsyncFileWriter")
+{
+	_threadPool.setMaxThreadCount( 1 );  // the writes of the same file must not overtake each other
+	_threadPool.setExpiryTimeout( -1 );  // the thread is needed every few seconds, don't keep re-creating it
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+	flush();  // the task refers to this object, and the last changes must not be lost
+}
+
+void AsyncFileWriter::writeFile( const QString & filePath, QByteArray content, QObject * context, ErrorCallback onError )
+{
+	class WriteTask : public QRunnable {
+		AsyncFileWriter * _owner;
+	 public:
+		WriteTask( AsyncFileWriter * owner ) : _owner( owner ) {}
+		virtual void run() override
+		{
+			_owner->writePendingFiles();
+		}
+	};
+
+	QMutexLocker lock( &_mutex );
+
+	if (_pendingWrites.contains( filePath ))
+		logDebug() << "replacing the content of " << filePath << " that has not been written yet";
+	else
+		_writeOrder.append( filePath );  // a replaced content keeps the original position
+
+	_pendingWrites.insert( filePath, { std::move(content), context, std::move(onError) } );
+
+	// the running worker will pick it up before it finishes
+	if (!_workerRunning)
+	{
+		_workerRunning = true;
+		_threadPool.start( new WriteTask( this ) );
+	}
+}
+
+void AsyncFileWriter::flush()
+{
+	_threadPool.waitForDone();
+}
+
+void AsyncFileWriter::writePendingFiles()
+{
+	while (true)
+	{
+		QString filePath;
+		PendingWrite pending;
+		{
+			QMutexLocker lock( &_mutex );
+
+			if (_pendingWrites.isEmpty())
+			{
+				_workerRunning = false;
+				return;
+			}
+
+			filePath = _writeOrder.takeFirst();
+			pending = _pendingWrites.take( filePath );
+		}
+
+		QString error = fs::updateFileSafely( filePath, pending.content );
+		if (error.isEmpty())
+			continue;
+
+		logRuntimeError() << error;
+
+		if (!pending.onError)
+			continue;
+
+		postToMainThread( std::move(pending.context), [ onError = std::move(pending.onError), error ]()
+		{
+			onError( error );
+		});
+	}
+}
@@ -0,0 +1,75 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: writing files in a background thread
+//======================================================================================================================
+
+#ifndef ASYNC_FILE_WRITER_INCLUDED
+#define ASYNC_FILE_WRITER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QThreadPool>
+
+#include <functional>
+
+
+//======================================================================================================================
+/// Safely replaces files with new content in a worker thread, so that a slow drive doesn't freeze the window.
+/**
+  * The caller hands over the complete new content of the file, the worker then writes it using fs::updateFileSafely().
+  * If a newer content of the same file is handed over before the older one has been written, the older one is dropped.
+  * The files are written one by one in a single thread in the order in which they were first scheduled,
+  * so a newer content can never be overwritten by an older one and files written together keep their relative age.
+  *
+  * Must be used from the main thread. The destructor waits until all the pending writes finish.
+  */
+class AsyncFileWriter : protected LoggingComponent {
+
+ public:
+
+	using ErrorCallback = std::function< void ( const QString & error ) >;
+
+	AsyncFileWriter();
+	~AsyncFileWriter();
+
+	/// Schedules replacing the content of the file.
+	/** If the write fails, onError is called in the main thread, unless the context has been destroyed in the meantime. */
+	void writeFile( const QString & filePath, QByteArray content, QObject * context = nullptr, ErrorCallback onError = {} );
+
+	/// Blocks until all the scheduled writes are finished.
+	void flush();
+
+ private:
+
+	struct PendingWrite
+	{
+		QByteArray content;
+		QPointer< QObject > context;
+		ErrorCallback onError;
+	};
+
+	void writePendingFiles();
+
+	QMutex _mutex;  ///< protects the members below
+	QHash< QString, PendingWrite > _pendingWrites;  ///< key is the file path
+	QList< QString > _writeOrder;  ///< paths of the pending writes in the order of scheduling
+	bool _workerRunning = false;
+
+	QThreadPool _threadPool;
+
+};
+
+
+#endif // ASYNC_FILE_WRITER_INCLUDED
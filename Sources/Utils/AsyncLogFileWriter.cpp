@@ -0,0 +1,142 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: appending a stream of data to a log file in a background thread
+//======================================================================================================================
+
+#include "AsyncLogFileWriter.hpp"
+
+#include <QRunnable>
+#include <QStringBuilder>
+
+
+//======================================================================================================================
+
+AsyncLogFileWriter::AsyncLogFileWriter() : LoggingComponent("AsyncLogFileWriter")
+{
+	_threadPool.setMaxThreadCount( 1 );  // the chunks must be written in order
+	_threadPool.setExpiryTimeout( -1 );  // a chatty process produces output all the time, don't keep re-creating the thread
+}
+
+AsyncLogFileWriter::~AsyncLogFileWriter()
+{
+	close();  // the task refers to this object, and the last output is the most important one in case of a crash
+}
+
+void AsyncLogFileWriter::open( const QString & filePath, qint64 maxFileSize, int maxBackupCount )
+{
+	close();
+
+	_filePath = filePath;
+	_file.setFileName( filePath );
+	_fileSize = 0;
+	_maxFileSize = maxFileSize;
+	_maxBackupCount = maxBackupCount;
+	_openFailed = false;
+}
+
+void AsyncLogFileWriter::close()
+{
+	_threadPool.waitForDone();
+
+	if (_file.isOpen())
+		_file.close();
+	_filePath.clear();
+}
+
+void AsyncLogFileWriter::write( const QByteArray & data )
+{
+	class WriteTask : public QRunnable {
+		AsyncLogFileWriter * _owner;
+	 public:
+		WriteTask( AsyncLogFileWriter * owner ) : _owner( owner ) {}
+		virtual void run() override
+		{
+			_owner->writePendingData();
+		}
+	};
+
+	if (!isOpen() || data.isEmpty())
+		return;
+
+	QMutexLocker lock( &_mutex );
+
+	_pendingChunks.append( data );
+
+	// the running worker will pick it up before it finishes
+	if (!_workerRunning)
+	{
+		_workerRunning = true;
+		_threadPool.start( new WriteTask( this ) );
+	}
+}
+
+void AsyncLogFileWriter::writePendingData()
+{
+	while (true)
+	{
+		QList< QByteArray > chunks;
+		{
+			QMutexLocker lock( &_mutex );
+
+			if (_pendingChunks.isEmpty())
+			{
+				_workerRunning = false;
+				return;
+			}
+
+			chunks.swap( _pendingChunks );  // take everything that has accumulated while the previous batch was written
+		}
+
+		if (_openFailed)
+			continue;
+
+		if (!_file.isOpen() && !_file.open( QIODevice::WriteOnly | QIODevice::Truncate ))
+		{
+			logRuntimeError() << "cannot open " << _file.fileName() << ": " << _file.errorString();
+			_openFailed = true;
+			continue;
+		}
+
+		for (const QByteArray & chunk : chunks)
+		{
+			if (_fileSize > 0 && _fileSize + chunk.size() > _maxFileSize)
+			{
+				rotate();
+				if (_openFailed)
+					break;
+			}
+
+			qint64 written = _file.write( chunk );
+			if (written < 0)
+			{
+				logRuntimeError() << "cannot write to " << _file.fileName() << ": " << _file.errorString();
+				break;
+			}
+			_fileSize += written;
+		}
+
+		_file.flush();  // whatever has been received so far should survive a crash of the launcher
+	}
+}
+
+void AsyncLogFileWriter::rotate()
+{
+	QString filePath = _file.fileName();
+	_file.close();
+
+	// shift the backups, the oldest one falls out
+	QFile::remove( filePath % '.' % QString::number( _maxBackupCount ) );
+	for (int i = _maxBackupCount - 1; i >= 1; --i)
+		QFile::rename( filePath % '.' % QString::number( i ), filePath % '.' % QString::number( i + 1 ) );
+	if (_maxBackupCount > 0)
+		QFile::rename( filePath, filePath % ".1" );
+
+	_fileSize = 0;
+	if (!_file.open( QIODevice::WriteOnly | QIODevice::Truncate ))
+	{
+		logRuntimeError() << "cannot open " << filePath << ": " << _file.errorString();
+		_openFailed = true;
+	}
+}
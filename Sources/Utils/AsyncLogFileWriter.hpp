@@ -0,0 +1,76 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: appending a stream of data to a log file in a background thread
+//======================================================================================================================
+
+#ifndef ASYNC_LOG_FILE_WRITER_INCLUDED
+#define ASYNC_LOG_FILE_WRITER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QFile>
+#include <QMutex>
+#include <QThreadPool>
+
+
+//======================================================================================================================
+/// Appends chunks of data to a file in a worker thread, so that the producer never waits for the drive.
+/**
+  * The chunks are only queued by reference (QByteArray is implicitly shared), so handing them over doesn't copy them.
+  * The file is opened by the worker with the first chunk. When it grows over the maximum size, it's renamed to
+  * <path>.1 (the older <path>.1 to <path>.2 and so on) and a new file is started, at most maxBackupCount of the old
+  * ones are kept.
+  *
+  * Must be used from the main thread. The destructor writes the rest of the queued data and closes the file.
+  */
+class AsyncLogFileWriter : protected LoggingComponent {
+
+ public:
+
+	AsyncLogFileWriter();
+	~AsyncLogFileWriter();
+
+	/// Sets the file to which the following data will be written. The previous file is closed first.
+	void open( const QString & filePath, qint64 maxFileSize, int maxBackupCount );
+
+	/// Writes the rest of the queued data and closes the file. Blocks until it's done.
+	void close();
+
+	bool isOpen() const  { return !_filePath.isEmpty(); }
+
+	/// Queues the data to be appended to the file.
+	void write( const QByteArray & data );
+
+ private:
+
+	void writePendingData();
+	void rotate();
+
+	// accessed only from the main thread
+	QString _filePath;
+
+	QMutex _mutex;  ///< protects the members below
+	QList< QByteArray > _pendingChunks;
+	bool _workerRunning = false;
+
+	// accessed only from the worker thread, or when it's not running
+	QFile _file;
+	qint64 _fileSize = 0;
+	qint64 _maxFileSize = 0;
+	int _maxBackupCount = 0;
+	bool _openFailed = false;  ///< don't try again with every chunk and don't spam the log
+
+	QThreadPool _threadPool;
+
+};
+
+
+#endif // ASYNC_LOG_FILE_WRITER_INCLUDED
@@ -69,6 +69,71 @@ void reverse( Container & cont )
 	std::reverse( std::begin(cont), std::end(cont) );
 }
 
+/// Inserts all the elements at once, so the following elements are shifted only once instead of once per element.
+template< typename List >
+void insertRange( List & list, int idx, List && elems )
+{
+	if (elems.isEmpty())
+		return;
+
+	if (idx == list.size())  // appending doesn't shift anything
+	{
+		list.reserve( list.size() + elems.size() );
+		for (auto & elem : elems)
+			list.append( std::move(elem) );
+		return;
+	}
+
+	List newList;
+	newList.reserve( list.size() + elems.size() );
+	for (int i = 0; i < idx; ++i)
+		newList.append( std::move( list[i] ) );
+	for (auto & elem : elems)
+		newList.append( std::move(elem) );
+	for (int i = idx; i < list.size(); ++i)
+		newList.append( std::move( list[i] ) );
+	list.swap( newList );
+}
+
+/// Removes a contiguous block of elements, the following elements are shifted only once.
+template< typename List >
+void removeRange( List & list, int idx, int count )
+{
+	list.erase( list.begin() + idx, list.begin() + idx + count );
+}
+
+/// Makes the destination list equal to the source list by replacing only the part where they differ.
+/** The common beginning and end are left untouched, so after a local edit of the source (a move, an insertion
+  * or a removal of a few adjacent elements) only the changed elements are copied. The lists don't share their data
+  * afterwards, so a following modification of one of them doesn't have to copy the whole other one. */
+template< typename List, typename IsEqual >
+void replaceChangedRange( List & dst, const List & src, IsEqual isEqual )
+{
+	// at() doesn't detach the list from other copies
+	int begin = 0;
+	while (begin < dst.size() && begin < src.size() && isEqual( dst.at( begin ), src.at( begin ) ))
+		++begin;
+
+	int dstEnd = int( dst.size() );
+	int srcEnd = int( src.size() );
+	while (dstEnd > begin && srcEnd > begin && isEqual( dst.at( dstEnd - 1 ), src.at( srcEnd - 1 ) ))
+	{
+		--dstEnd;
+		--srcEnd;
+	}
+
+	if (begin == dstEnd && begin == srcEnd)
+		return;  // equal
+
+	List changed;
+	changed.reserve( srcEnd - begin );
+	for (int i = begin; i < srcEnd; ++i)
+		changed.append( src.at(i) );
+
+	removeRange( dst, begin, dstEnd - begin );
+	insertRange( dst, begin, std::move(changed) );
+}
+
 /** Convenience wrapper around iterator to container of pointers
   * that skips the additional needed dereference and returns a reference directly. */
 template< typename IterType >
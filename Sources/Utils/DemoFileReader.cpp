@@ -0,0 +1,324 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: extraction of the information about a recorded demo from a demo file
+//======================================================================================================================
+
+#include "DemoFileReader.hpp"
+
+#include "FileSystemUtils.hpp"  // getFileNameFromPath
+#include "MiscUtils.hpp"  // splitCommandLineArguments
+#include "JsonUtils.hpp"
+#include "ErrorHandling.hpp"
+
+#include <QFile>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include <cstring>  // memcmp
+#include <algorithm>
+
+
+template<> inline const char * enumName< doom::DemoFormat >() { return "DemoFormat"; }
+template<> inline uint enumSize< doom::DemoFormat >() { return uint( doom::DemoFormat::ZDoom ) + 1; }
+
+
+namespace doom {
+
+
+//======================================================================================================================
+
+FileInfoCache< DemoInfo > g_cachedDemoInfo( readDemoInfo );
+
+/// All the information we need is at the beginning of the header, the rest are gameplay options.
+static constexpr qint64 MaxHeaderSize = 64;
+
+/// The footer is only a command line and a few tiny lumps, the rest of the file are the recorded tics.
+static constexpr qint64 MaxFooterSize = 4096;
+
+static const uchar BoomSignature [6] = { 0x1d, 'B', 'o', 'o', 'm', 0xe6 };
+static const uchar MbfSignature [6] = { 0x1d, 'M', 'B', 'F', 0xe6, 0x00 };
+
+// IWADs of the games with MAPxx maps
+static const QStringVec doom2IwadNames = { "doom2", "plutonia", "tnt", "freedoom2", "freedm", "doom2f", "hacx", "chex3d2" };
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  header
+
+//  https://doomwiki.org/wiki/Demo#Technical_information
+
+static int countPlayers( const uchar * playerFlags, int maxPlayers )
+{
+	int numPlayers = 0;
+	for (int i = 0; i < maxPlayers; ++i)
+		if (playerFlags[i])
+			++numPlayers;
+	return numPlayers;
+}
+
+static const char * vanillaVersionDesc( int version )
+{
+	switch (version)
+	{
+		case 104: return "Doom v1.4";
+		case 105: return "Doom v1.5";
+		case 106: return "Doom v1.666";
+		case 107: return "Doom v1.7";
+		case 108: return "Doom v1.8";
+		case 109: return "Doom v1.9";
+		case 110: return "Doom v1.10";
+		case 111: return "Doom v1.91 (long tics)";
+		default:  return "Doom";
+	}
+}
+
+static bool parseVanillaHeader( const uchar * data, qint64 size, DemoInfo & demoInfo )
+{
+	const int version = data[0];
+
+	demoInfo.format = DemoFormat::Vanilla;
+
+	if (version <= 4)
+	{
+		// before v1.4 there was no version byte, the demo begins with the skill
+		if (size < 7)
+			return false;
+		demoInfo.formatDesc = "Doom v1.2";
+		demoInfo.compatLevel = 0;
+		demoInfo.skill = data[0];
+		demoInfo.episode = data[1];
+		demoInfo.map = data[2];
+		demoInfo.numPlayers = countPlayers( data + 3, 4 );
+	}
+	else
+	{
+		// version, skill, episode, map, deathmatch, respawn, fast, nomonsters, consoleplayer, 4x playeringame
+		if (size < 13)
+			return false;
+		demoInfo.formatDesc = vanillaVersionDesc( version );
+		demoInfo.compatLevel = version <= 106 ? 1 : 2;  // refined by the IWAD later if possible
+		demoInfo.skill = data[1];
+		demoInfo.episode = data[2];
+		demoInfo.map = data[3];
+		demoInfo.numPlayers = countPlayers( data + 9, 4 );
+	}
+
+	return true;
+}
+
+static bool parseBoomHeader( const uchar * data, qint64 size, DemoInfo & demoInfo )
+{
+	// version, 6B signature, compatibility, skill, episode, map, deathmatch, consoleplayer, options ...
+	if (size < 13)
+		return false;
+
+	const int version = data[0];
+	const bool isMBF = memcmp( data + 1, MbfSignature, sizeof(MbfSignature) ) == 0;
+	const bool isBoom = memcmp( data + 1, BoomSignature, sizeof(BoomSignature) ) == 0;
+	if (!isMBF && !isBoom)
+		return false;
+	const bool compatibilityMode = data[7] != 0;
+
+	demoInfo.format = DemoFormat::Boom;
+	switch (version)
+	{
+		case 200: demoInfo.formatDesc = "Boom v2.00"; demoInfo.compatLevel = compatibilityMode ? 7 : 8; break;
+		case 201: demoInfo.formatDesc = "Boom v2.01"; demoInfo.compatLevel = compatibilityMode ? 7 : 8; break;
+		case 202: demoInfo.formatDesc = "Boom v2.02"; demoInfo.compatLevel = compatibilityMode ? 7 : 9; break;
+		case 203: demoInfo.formatDesc = isMBF ? "MBF" : "LxDoom"; demoInfo.compatLevel = isMBF ? 11 : 10; break;
+		case 210: demoInfo.formatDesc = "PrBoom v2.1"; demoInfo.compatLevel = 12; break;
+		case 211: demoInfo.formatDesc = "PrBoom v2.2"; demoInfo.compatLevel = 13; break;
+		case 212: demoInfo.formatDesc = "PrBoom v2.3"; demoInfo.compatLevel = 14; break;
+		case 213: demoInfo.formatDesc = "PrBoom v2.4"; demoInfo.compatLevel = 15; break;
+		case 214: demoInfo.formatDesc = "PrBoom v2.5 (long tics)"; demoInfo.compatLevel = 16; break;
+		case 221: demoInfo.formatDesc = "MBF21"; demoInfo.compatLevel = 21; break;
+		default:  return false;
+	}
+
+	demoInfo.skill = data[8];
+	demoInfo.episode = data[9];
+	demoInfo.map = data[10];
+	// the player flags are after the 64 bytes of options, we don't need them enough to read further
+
+	return true;
+}
+
+static bool parseHeader( const QByteArray & header, DemoInfo & demoInfo )
+{
+	if (header.startsWith("FORM"))  // IFF container with ZDEM form
+	{
+		demoInfo.format = DemoFormat::ZDoom;
+		demoInfo.formatDesc = "ZDoom";
+		return true;
+	}
+
+	if (header.isEmpty())
+		return false;
+
+	const uchar * data = reinterpret_cast< const uchar * >( header.constData() );
+	const int version = data[0];
+
+	bool valid;
+	if (version <= 4 || (version >= 104 && version <= 111))
+		valid = parseVanillaHeader( data, header.size(), demoInfo );
+	else if (version >= 200 && version <= 221)
+		valid = parseBoomHeader( data, header.size(), demoInfo );
+	else
+		valid = false;
+
+	// a random file with a matching first byte would most likely have nonsense here
+	return valid && demoInfo.skill >= 0 && demoInfo.skill <= 4 && demoInfo.map >= 1 && demoInfo.map <= 99;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  footer
+
+static bool isCmdLineChar( char c )
+{
+	// the paths might contain UTF-8 characters
+	return uchar(c) >= 0x20 && uchar(c) != 0x7F;
+}
+
+static void parseFooter( const QByteArray & tail, DemoInfo & demoInfo )
+{
+	// The footer format differs between the ports and versions, but they all store the command line as plain text,
+	// so it's just found as a run of text that contains the -iwad option.
+	int iwadOptionPos = tail.lastIndexOf("-iwad");
+	if (iwadOptionPos < 0)
+		return;
+
+	int cmdLineBegin = iwadOptionPos;
+	while (cmdLineBegin > 0 && isCmdLineChar( tail[ cmdLineBegin - 1 ] ))
+		--cmdLineBegin;
+	int cmdLineEnd = iwadOptionPos;
+	while (cmdLineEnd < tail.size() && isCmdLineChar( tail[ cmdLineEnd ] ))
+		++cmdLineEnd;
+
+	const auto args = splitCommandLineArguments( QString::fromUtf8( tail.mid( cmdLineBegin, cmdLineEnd - cmdLineBegin ) ) );
+	for (int i = 0; i < args.size(); ++i)
+	{
+		const QString & arg = args[i].str;
+		if (arg == "-iwad" && i + 1 < args.size())
+		{
+			demoInfo.iwad = fs::getFileNameFromPath( args[ ++i ].str );
+		}
+		else if (arg == "-file")
+		{
+			while (i + 1 < args.size() && !args[ i + 1 ].str.startsWith('-'))
+				demoInfo.files.append( fs::getFileNameFromPath( args[ ++i ].str ) );
+		}
+		else if (arg == "-complevel" && i + 1 < args.size())
+		{
+			bool isInt;
+			int compatLevel = args[ ++i ].str.toInt( &isInt );
+			if (isInt)
+				demoInfo.compatLevel = compatLevel;  // the footer knows it better than the version
+		}
+	}
+}
+
+static bool isDoom2Iwad( const QString & iwadFileName )
+{
+	return doom2IwadNames.contains( fs::getFileBasenameFromPath( iwadFileName ).toLower() );
+}
+
+static void refineVanillaCompatLevel( DemoInfo & demoInfo )
+{
+	// v1.9 demos are played differently by the Ultimate Doom and Final Doom executables
+	if (demoInfo.format != DemoFormat::Vanilla || demoInfo.compatLevel != 2 || demoInfo.iwad.isEmpty())
+		return;
+
+	QString iwadName = fs::getFileBasenameFromPath( demoInfo.iwad ).toLower();
+	if (iwadName == "doom" || iwadName == "doomu")
+		demoInfo.compatLevel = 3;
+	else if (iwadName == "tnt" || iwadName == "plutonia")
+		demoInfo.compatLevel = 4;
+}
+
+
+//======================================================================================================================
+//  public API
+
+UncertainDemoInfo readDemoInfo( const QString & filePath )
+{
+	UncertainDemoInfo demoInfo;
+
+	QFile file( filePath );
+	if (!file.open( QIODevice::ReadOnly ))
+	{
+		logRuntimeError("DemoFileReader").noquote() << "Cannot open \""<<filePath<<"\": "<<file.errorString();
+		demoInfo.status = ReadStatus::CantOpen;
+		return demoInfo;
+	}
+
+	const qint64 fileSize = file.size();
+
+	QByteArray header = file.read( MaxHeaderSize );
+	if (!parseHeader( header, demoInfo ))
+	{
+		demoInfo.status = ReadStatus::InvalidFormat;
+		return demoInfo;
+	}
+
+	// the ZDoom demos tell what files they need in their own chunks, that's for another time
+	if (demoInfo.format != DemoFormat::ZDoom && fileSize > MaxHeaderSize)
+	{
+		qint64 tailSize = std::min( MaxFooterSize, fileSize - MaxHeaderSize );
+		if (file.seek( fileSize - tailSize ))
+			parseFooter( file.read( tailSize ), demoInfo );
+		refineVanillaCompatLevel( demoInfo );
+	}
+
+	demoInfo.status = ReadStatus::Success;
+	return demoInfo;
+}
+
+QString DemoInfo::getMapName() const
+{
+	if (map < 1)
+		return {};
+	else if (episode > 1 || (!iwad.isEmpty() && !isDoom2Iwad( iwad )))
+		return QStringLiteral("E%1M%2").arg( episode ).arg( map );
+	else if (!iwad.isEmpty() || map > 9)
+		return QStringLiteral("MAP%1").arg( map, 2, 10, QChar('0') );
+	else
+		return QStringLiteral("E1M%1 / MAP%2").arg( map ).arg( map, 2, 10, QChar('0') );  // can't tell without the IWAD
+}
+
+void DemoInfo::serialize( QJsonObject & jsDemoInfo ) const
+{
+	jsDemoInfo["format"] = int( format );
+	jsDemoInfo["format_desc"] = formatDesc;
+	jsDemoInfo["compat_level"] = compatLevel;
+	jsDemoInfo["skill"] = skill;
+	jsDemoInfo["episode"] = episode;
+	jsDemoInfo["map"] = map;
+	jsDemoInfo["num_players"] = numPlayers;
+	jsDemoInfo["iwad"] = iwad;
+	QJsonArray jsFiles;
+	for (const QString & file : files)
+		jsFiles.append( file );
+	jsDemoInfo["files"] = jsFiles;
+}
+
+void DemoInfo::deserialize( const JsonObjectCtx & jsDemoInfo )
+{
+	format = jsDemoInfo.getEnum< DemoFormat >( "format", DemoFormat::Unknown );
+	formatDesc = jsDemoInfo.getString( "format_desc", {}, DontShowError );
+	compatLevel = jsDemoInfo.getInt( "compat_level", -1, DontShowError );
+	skill = jsDemoInfo.getInt( "skill", -1, DontShowError );
+	episode = jsDemoInfo.getInt( "episode", -1, DontShowError );
+	map = jsDemoInfo.getInt( "map", -1, DontShowError );
+	numPlayers = jsDemoInfo.getInt( "num_players", -1, DontShowError );
+	iwad = jsDemoInfo.getString( "iwad", {}, DontShowError );
+	files.clear();
+	if (JsonArrayCtx jsFiles = jsDemoInfo.getArray( "files", DontShowError ))
+		for (int i = 0; i < jsFiles.size(); ++i)
+			files.append( jsFiles.getString( i, {}, DontShowError ) );
+}
+
+
+} // namespace doom
@@ -0,0 +1,71 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: extraction of the information about a recorded demo from a demo file
+//======================================================================================================================
+
+#ifndef DEMO_FILE_READER_INCLUDED
+#define DEMO_FILE_READER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "CommonTypes.hpp"  // QStringVec
+#include "FileInfoCache.hpp"
+
+#include <QString>
+
+class QJsonObject;
+class JsonObjectCtx;
+
+
+namespace doom {
+
+
+//======================================================================================================================
+
+/// which engines are able to play the demo
+enum class DemoFormat
+{
+	Unknown,
+	Vanilla,  ///< Doom v1.2 - v1.9 and its long-tics variants, played by all the vanilla-compatible engines
+	Boom,     ///< Boom, MBF, PrBoom and MBF21, played by the Boom-compatible engines
+	ZDoom,    ///< ZDoom's own IFF-based format
+};
+
+struct DemoInfo
+{
+	DemoFormat format = DemoFormat::Unknown;
+	QString formatDesc;     ///< human-readable name of the format version, e.g. "Doom v1.9"
+	int compatLevel = -1;   ///< PrBoom complevel needed to play the demo, -1 if it can't be determined
+	int skill = -1;         ///< 0-based, -1 if unknown
+	int episode = -1;       ///< 1-based, always 1 in Doom 2, -1 if unknown
+	int map = -1;           ///< 1-based, -1 if unknown
+	int numPlayers = -1;    ///< -1 if unknown
+	QString iwad;           ///< file name of the IWAD the demo was recorded with, if the demo footer says it
+	QStringVec files;       ///< file names of the additional files the demo was recorded with, if the demo footer says it
+
+	/// Returns the map either as ExMy or MAPxx, or empty string if unknown.
+	/** The header doesn't say which style the game uses, so it is guessed from the episode number and the IWAD. */
+	QString getMapName() const;
+
+	void serialize( QJsonObject & jsDemoInfo ) const;
+	void deserialize( const JsonObjectCtx & jsDemoInfo );
+};
+
+using UncertainDemoInfo = UncertainFileInfo< DemoInfo >;
+
+/// Reads the header and the footer of a demo file.
+/** Only the first 64 bytes are read for the header, and the end of the file for the footer, that PrBoom+ and DSDA-Doom
+  * append after the end marker with the command line the demo was recorded with. */
+UncertainDemoInfo readDemoInfo( const QString & filePath );
+
+
+extern FileInfoCache< DemoInfo > g_cachedDemoInfo;
+
+
+} // namespace doom
+
+
+#endif // DEMO_FILE_READER_INCLUDED
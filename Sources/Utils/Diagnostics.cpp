@@ -0,0 +1,52 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: runtime counters of what the application spends its time on
+//======================================================================================================================
+
+#include "Diagnostics.hpp"
+
+#include <QMutexLocker>
+
+
+namespace diag {
+
+
+//======================================================================================================================
+
+Stats g_stats;
+ScanHistory g_syncScans;
+
+
+//======================================================================================================================
+
+void ScanHistory::add( Scan scan )
+{
+	QMutexLocker lock( &_mutex );
+
+	if (_scans.size() < Capacity)
+	{
+		_scans.append( std::move(scan) );
+	}
+	else
+	{
+		_scans[ _nextIdx ] = std::move(scan);
+		_nextIdx = (_nextIdx + 1) % Capacity;
+	}
+}
+
+QVector< ScanHistory::Scan > ScanHistory::getScans() const
+{
+	QMutexLocker lock( &_mutex );
+
+	// when the buffer is full, the oldest one is the one to be overwritten next
+	QVector< Scan > scans;
+	scans.reserve( _scans.size() );
+	for (int i = 0; i < _scans.size(); ++i)
+		scans.append( _scans[ (_nextIdx + i) % _scans.size() ] );
+	return scans;
+}
+
+
+} // namespace diag
@@ -0,0 +1,107 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: runtime counters of what the application spends its time on
+//======================================================================================================================
+
+#ifndef DIAGNOSTICS_INCLUDED
+#define DIAGNOSTICS_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+#include <QMutex>
+
+#include <atomic>
+
+
+namespace diag {
+
+
+//======================================================================================================================
+// The counters are always enabled, they cost a relaxed atomic increment, so that a slowdown reported from a production
+// build can be attributed to something without having to reproduce it in a debug build.
+
+/// Number that can be incremented from any thread.
+class Counter {
+
+	std::atomic< quint64 > _value { 0 };
+
+ public:
+
+	void increment( quint64 amount = 1 )  { _value.fetch_add( amount, std::memory_order_relaxed ); }
+	quint64 value() const                 { return _value.load( std::memory_order_relaxed ); }
+
+};
+
+/// The latest measured value of something, that can be written from any thread.
+class Gauge {
+
+	std::atomic< qint64 > _value { 0 };
+
+ public:
+
+	void set( qint64 value )   { _value.store( value, std::memory_order_relaxed ); }
+	qint64 value() const       { return _value.load( std::memory_order_relaxed ); }
+
+};
+
+/// The last few directory scans, the oldest ones are overwritten. Can be written from any thread.
+class ScanHistory {
+
+ public:
+
+	struct Scan
+	{
+		QString dir;
+		qint64 durationMs = 0;
+		int entriesVisited = 0;
+		int entriesMatched = 0;  ///< passed the suffix check and the entry filter
+	};
+
+	static constexpr int Capacity = 32;
+
+	void add( Scan scan );
+
+	/// Returns the recorded scans from the oldest to the newest.
+	QVector< Scan > getScans() const;
+
+ private:
+
+	mutable QMutex _mutex;
+	QVector< Scan > _scans;  ///< ring buffer, grows up to the Capacity
+	int _nextIdx = 0;        ///< where the next scan will be written, once the buffer is full
+
+};
+
+/// Application-wide counters, the components with their own statistics (caches, directory traverser) keep them themselves.
+struct Stats
+{
+	Counter launchCommandUpdates;  ///< how many times the launch command was regenerated
+
+	Counter presetSwitches;
+	Gauge lastPresetSwitchMs;      ///< from the selection of a preset until all the widgets and the launch command are updated
+
+	Counter optionsSaves;
+	Gauge lastOptionsSaveMs;       ///< serialization of the options, the writing itself happens in the background
+	Gauge lastOptionsSaveBytes;
+
+	Counter logMessages;           ///< all the messages that passed the log level threshold
+	Counter logFileLines;          ///< the messages queued to be written into the log file
+	Counter logFileWrites;         ///< the batches actually written into the log file
+};
+
+extern Stats g_stats;
+
+/// The scans done in the main thread, the asynchronous ones are recorded by their AsyncDirTraverser.
+extern ScanHistory g_syncScans;
+
+
+} // namespace diag
+
+
+#endif // DIAGNOSTICS_INCLUDED
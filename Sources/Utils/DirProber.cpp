@@ -0,0 +1,234 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: availability checks of directories that never block the main thread
+//======================================================================================================================
+
+#include "DirProber.hpp"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QTimer>
+
+#include <thread>
+#include <chrono>
+#include <algorithm>  // min
+
+
+//======================================================================================================================
+
+// the reachable directories are probed again from time to time, so that a share that went away is discovered
+// before the owner tries to list it
+static constexpr qint64 RecheckIntervalMs = 10 * 1000;
+
+// the unresponsive ones are probed with a doubling delay up to the maximum
+static constexpr qint64 FirstRetryDelayMs = 5 * 1000;
+static constexpr qint64 MaxRetryDelayMs = 5 * 60 * 1000;
+
+// a dead mount blocks every thread that touches it, don't leave behind more than this many per directory
+static constexpr int MaxHungProbes = 3;
+
+// how long the destructor waits for the probes in flight, before the hung ones are left behind
+static constexpr qint64 ShutdownWaitMs = 500;
+
+
+//======================================================================================================================
+
+DirProber::DirProber()
+:
+	LoggingComponent("DirProber"),
+	_selfToken( std::make_shared< DirProber * >( this ) ),
+	_shuttingDown( std::make_shared< std::atomic< bool > >( false ) )
+{
+	_clock.start();
+}
+
+DirProber::~DirProber()
+{
+	*_shuttingDown = true;
+
+	// A probe normally takes microseconds, so give the ones in flight a moment, but don't let a dead mount hold up the exit.
+	// The hung ones are left behind, they don't touch anything but their own data when they return.
+	QElapsedTimer waitClock;
+	waitClock.start();
+	for (ProbeThread & probe : _probeThreads)
+	{
+		while (!*probe.finished && waitClock.elapsed() < ShutdownWaitMs)
+			std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+
+		if (*probe.finished)
+		{
+			probe.thread.join();
+		}
+		else
+		{
+			logDebug() << "a directory probe is still hanging, leaving it behind";
+			probe.thread.detach();
+		}
+	}
+}
+
+void DirProber::setStateChangedCallback( QObject * context, StateChangedCallback callback )
+{
+	_callbackContext = context;
+	_stateChangedCallback = std::move(callback);
+}
+
+DirProber::State DirProber::peekState( const QString & dirPath ) const
+{
+	if (dirPath.isEmpty())
+		return State::Missing;
+
+	auto iter = _dirs.find( dirPath );
+	return iter != _dirs.end() ? iter->state : State::Unknown;
+}
+
+DirProber::State DirProber::getState( const QString & dirPath )
+{
+	if (dirPath.isEmpty())
+		return State::Missing;  // nothing to touch
+
+	DirEntry & entry = _dirs[ dirPath ];
+	bool canProbe = !entry.probeInFlight || (entry.probeTimedOut && entry.hungProbes < MaxHungProbes);
+	if (canProbe && _clock.elapsed() >= entry.nextProbeTime)
+		startProbe( dirPath, entry );
+	return entry.state;
+}
+
+void DirProber::forgetAllExcept( const QStringVec & dirsInUse )
+{
+	// the results of the probes in flight will not find their entries and will be ignored
+	for (auto iter = _dirs.begin(); iter != _dirs.end(); )
+	{
+		if (!dirsInUse.contains( iter.key() ))
+			iter = _dirs.erase( iter );
+		else
+			++iter;
+	}
+}
+
+void DirProber::startProbe( const QString & dirPath, DirEntry & entry )
+{
+	joinFinishedThreads();
+
+	if (entry.probeInFlight)  // the previous one is hanging, its result will be ignored when it returns
+		entry.hungProbes++;
+
+	entry.probeInFlight = true;
+	entry.probeTimedOut = false;
+	entry.probeID = ++_lastProbeID;
+
+	std::weak_ptr< DirProber * > weakToken = _selfToken;
+	std::shared_ptr< std::atomic< bool > > shuttingDown = _shuttingDown;
+	auto finished = std::make_shared< std::atomic< bool > >( false );
+	quint64 probeID = entry.probeID;
+
+	// A thread of its own rather than a thread pool, because a probe of a dead mount can block for a long time
+	// and must not hold up the probes of the other directories, nor the application exit.
+	std::thread thread( [ dirPath, probeID, weakToken, shuttingDown, finished ]()
+	{
+		bool isDir = QFileInfo( dirPath ).isDir();  // this is what can block
+
+		QCoreApplication * app = QCoreApplication::instance();
+		if (app && !*shuttingDown)
+		{
+			QMetaObject::invokeMethod( app, [ dirPath, probeID, isDir, weakToken ]()
+			{
+				if (auto token = weakToken.lock())
+					(*token)->onProbeFinished( dirPath, probeID, isDir );
+			}, Qt::QueuedConnection );
+		}
+
+		*finished = true;
+	});
+	_probeThreads.push_back({ std::move(thread), std::move(finished) });
+
+	QTimer::singleShot( ProbeTimeoutMs, Qt::CoarseTimer, QCoreApplication::instance(), [ dirPath, probeID, weakToken ]()
+	{
+		if (auto token = weakToken.lock())
+			(*token)->onProbeTimedOut( dirPath, probeID );
+	});
+}
+
+void DirProber::onProbeFinished( const QString & dirPath, quint64 probeID, bool isDir )
+{
+	joinFinishedThreads();
+
+	auto iter = _dirs.find( dirPath );
+	if (iter == _dirs.end())
+		return;  // forgotten in the meantime
+	DirEntry & entry = iter.value();
+
+	if (probeID != entry.probeID)
+	{
+		// one of the hung probes has returned, the latest one decides
+		if (entry.hungProbes > 0)
+			entry.hungProbes--;
+		return;
+	}
+
+	entry.probeInFlight = false;
+
+	if (entry.probeTimedOut)
+	{
+		// It responded only after the deadline. The answer might just be the OS giving up on the share,
+		// so it stays unresponsive until a probe finishes in time.
+		entry.probeTimedOut = false;
+		return;
+	}
+
+	entry.failedProbes = 0;
+	entry.nextProbeTime = _clock.elapsed() + RecheckIntervalMs;
+	changeState( dirPath, entry, isDir ? State::Available : State::Missing );
+}
+
+void DirProber::onProbeTimedOut( const QString & dirPath, quint64 probeID )
+{
+	auto iter = _dirs.find( dirPath );
+	if (iter == _dirs.end() || iter->probeID != probeID || !iter->probeInFlight)
+		return;  // finished in time, or forgotten
+	DirEntry & entry = iter.value();
+
+	entry.probeTimedOut = true;
+
+	// The probe stays in flight, and if it doesn't return until the back-off delay passes, another one is started.
+	int shift = std::min( entry.failedProbes, 16 );
+	entry.nextProbeTime = _clock.elapsed() + std::min( FirstRetryDelayMs << shift, MaxRetryDelayMs );
+	entry.failedProbes++;
+
+	if (entry.state != State::Unresponsive)
+		logRuntimeError() << "Directory " << dirPath << " doesn't respond, it will not be accessed until it responds again";
+
+	changeState( dirPath, entry, State::Unresponsive );
+}
+
+void DirProber::joinFinishedThreads()
+{
+	for (auto iter = _probeThreads.begin(); iter != _probeThreads.end(); )
+	{
+		if (*iter->finished)
+		{
+			iter->thread.join();  // it's already past the last statement, this doesn't block
+			iter = _probeThreads.erase( iter );
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+void DirProber::changeState( const QString & dirPath, DirEntry & entry, State newState )
+{
+	if (entry.state == newState)
+		return;
+
+	if (entry.state == State::Unresponsive)
+		logInfo() << "Directory " << dirPath << " responds again";
+
+	entry.state = newState;
+
+	if (_callbackContext && _stateChangedCallback)  // otherwise the owner has been destroyed in the meantime
+		_stateChangedCallback( dirPath, newState );
+}
@@ -0,0 +1,123 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: availability checks of directories that never block the main thread
+//======================================================================================================================
+
+#ifndef DIR_PROBER_INCLUDED
+#define DIR_PROBER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "CommonTypes.hpp"  // QStringVec
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QString>
+#include <QHash>
+#include <QPointer>
+#include <QObject>
+#include <QElapsedTimer>
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+
+//======================================================================================================================
+/// Finds out in the background whether the configured directories exist and respond.
+/**
+  * When a directory is on a network share that went away, even a simple stat() blocks for the timeout of the OS,
+  * which can be more than 30 seconds on Windows. So the directories are probed in threads of their own, and when
+  * a probe doesn't finish within a deadline, the directory is marked unresponsive, and the owner should avoid touching it
+  * until it responds again. The unresponsive directories are probed again with an increasing delay, even when the previous
+  * probe is still hanging, because a mount that came back doesn't always release the calls stuck on it. There are at most
+  * a few hung probes of the same directory, so that a dead mount doesn't keep spawning threads.
+  *
+  * The destructor waits a moment for the probes in flight, the ones that still hang after that are left behind.
+  *
+  * Must be used only from the main thread, the callback is called in the main thread.
+  */
+class DirProber : protected LoggingComponent {
+
+ public:
+
+	enum class State : uint8_t
+	{
+		Unknown,       ///< not probed yet
+		Available,     ///< exists and responds
+		Missing,       ///< responds, but doesn't exist or is not a directory
+		Unresponsive,  ///< the last probe didn't finish in time
+	};
+
+	using StateChangedCallback = std::function< void ( const QString & dirPath, State newState ) >;
+
+	/// How long a probe can take before the directory is considered unresponsive.
+	static constexpr int ProbeTimeoutMs = 3000;
+
+	DirProber();
+	~DirProber();
+
+	/// Sets what should be called when the state of a directory changes. Not called after the context is destroyed.
+	void setStateChangedCallback( QObject * context, StateChangedCallback callback );
+
+	/// Returns the last known state of the directory without touching the file system,
+	/// and starts a new probe in the background, if the last result is too old.
+	State getState( const QString & dirPath );
+
+	/// Returns the last known state without starting any probe.
+	State peekState( const QString & dirPath ) const;
+
+	/// Whether the content of the directory can be listed without the risk of freezing.
+	static bool isReachable( State state )  { return state == State::Available || state == State::Missing; }
+
+	/// Stops probing the directories that are no longer used.
+	void forgetAllExcept( const QStringVec & dirsInUse );
+
+ private:
+
+	struct DirEntry
+	{
+		State state = State::Unknown;
+		bool probeInFlight = false;
+		bool probeTimedOut = false;  ///< the probe in flight has missed its deadline
+		quint64 probeID = 0;        ///< to recognize the deadline and the result of the latest probe
+		qint64 nextProbeTime = 0;   ///< milliseconds of _clock
+		int failedProbes = 0;       ///< how many times in a row the directory didn't respond, determines the back-off
+		int hungProbes = 0;         ///< older probes that missed their deadline and haven't returned yet
+	};
+
+	struct ProbeThread
+	{
+		std::thread thread;
+		std::shared_ptr< std::atomic< bool > > finished;
+	};
+
+	void startProbe( const QString & dirPath, DirEntry & entry );
+	void onProbeFinished( const QString & dirPath, quint64 probeID, bool isDir );
+	void onProbeTimedOut( const QString & dirPath, quint64 probeID );
+	void changeState( const QString & dirPath, DirEntry & entry, State newState );
+	void joinFinishedThreads();
+
+ private:
+
+	QHash< QString, DirEntry > _dirs;
+	quint64 _lastProbeID = 0;
+	QElapsedTimer _clock;
+
+	/// The probing threads can outlive this object, they reach it only through this token, and only in the main thread.
+	std::shared_ptr< DirProber * > _selfToken;
+	/// Set by the destructor, the threads that return after that don't post their results to the application anymore.
+	std::shared_ptr< std::atomic< bool > > _shuttingDown;
+	std::vector< ProbeThread > _probeThreads;  ///< joined when they finish
+
+	QPointer< QObject > _callbackContext;
+	StateChangedCallback _stateChangedCallback;
+
+};
+
+
+#endif // DIR_PROBER_INCLUDED
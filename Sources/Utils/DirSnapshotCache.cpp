@@ -0,0 +1,163 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: cache of directory listings that avoids re-scanning directories that haven't changed
+//======================================================================================================================
+
+#include "DirSnapshotCache.hpp"
+
+#include "TimeStats.hpp"
+
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QStringBuilder>
+
+
+namespace fs {
+
+
+//======================================================================================================================
+
+/// Some file systems store the modification time with a granularity of seconds (FAT even 2 seconds),
+/// so a change made shortly after the snapshot was taken could leave the time unchanged.
+/// Snapshots of directories modified this recently are therefore not trusted.
+static constexpr qint64 ModifTimeGranularityMs = 2000;
+
+static qint64 getModifTime( const QFileInfo & dirInfo )
+{
+	return dirInfo.lastModified().toMSecsSinceEpoch();
+}
+
+bool DirSnapshotCache::isUpToDate( const Snapshot & snapshot )
+{
+	for (auto iter = snapshot.dirModifTimes.begin(); iter != snapshot.dirModifTimes.end(); ++iter)
+	{
+		QFileInfo dirInfo( iter.key() );
+		if (!dirInfo.isDir() || getModifTime( dirInfo ) != iter.value())
+			return false;
+	}
+	return true;
+}
+
+void DirSnapshotCache::addToSnapshot(
+	Snapshot & snapshot, const QString & dirPath, const QString & canonicalDirPath, QStringList & canonicalAncestors,
+	qint64 now, bool & isReliable
+) const
+{
+	// read the time before listing the content, so that a change made during the listing invalidates the snapshot
+	qint64 modifTime = getModifTime( QFileInfo( dirPath ) );
+	if (modifTime > now - ModifTimeGranularityMs)
+		isReliable = false;
+	snapshot.dirModifTimes.insert( dirPath, modifTime );
+
+	canonicalAncestors.append( canonicalDirPath );
+
+	// same entries in the same order as fs::traverseDirectory() visits them
+	QDirIterator dirIt( dirPath, QDir::AllEntries | QDir::NoDotAndDotDot );
+	while (dirIt.hasNext())
+	{
+		QString entryPath = dirIt.next();
+		const QFileInfo & entry = dirIt.fileInfo();
+		if (entry.isDir())  // on most platforms this re-uses the type info from the directory listing
+		{
+			if (!snapshot.recursively)
+				continue;
+
+			// Only a symlink can lead outside of the current canonical path, the rest costs just a string concatenation.
+			QString canonicalEntryPath = entry.isSymLink()
+				? entry.canonicalFilePath()
+				: QString( canonicalDirPath % '/' % dirIt.fileName() );
+			if (canonicalEntryPath.isEmpty())  // dangling link
+				continue;
+			if (canonicalAncestors.contains( canonicalEntryPath ))
+			{
+				logDebug() << "skipping " << entryPath << ", it links back to " << canonicalEntryPath;
+				continue;
+			}
+
+			addToSnapshot( snapshot, entryPath, canonicalEntryPath, canonicalAncestors, now, isReliable );
+		}
+		else
+		{
+			snapshot.files.append( entryPath );
+		}
+	}
+
+	canonicalAncestors.removeLast();
+}
+
+DirSnapshotCache::Snapshot DirSnapshotCache::takeSnapshot( const QString & dirPath, bool recursively, bool & isReliable ) const
+{
+	ScopeTimer timer( "listing directory", /*reportThresholdMs*/10 );
+
+	Snapshot snapshot;
+	snapshot.recursively = recursively;
+
+	isReliable = true;
+	QStringList canonicalAncestors;
+	addToSnapshot(
+		snapshot, dirPath, QFileInfo( dirPath ).canonicalFilePath(), canonicalAncestors,
+		QDateTime::currentMSecsSinceEpoch(), isReliable
+	);
+
+	return snapshot;
+}
+
+QStringList DirSnapshotCache::getFiles( const QString & dirPath, bool recursively )
+{
+	if (dirPath.isEmpty() || !QFileInfo( dirPath ).isDir())
+	{
+		QMutexLocker lock( &_mutex );
+		_snapshots.remove( dirPath );
+		return {};
+	}
+
+	std::optional< Snapshot > lastSnapshot;
+	{
+		QMutexLocker lock( &_mutex );
+		auto iter = _snapshots.find( dirPath );
+		if (iter != _snapshots.end() && iter->recursively == recursively)
+			lastSnapshot = iter.value();  // implicitly shared, no deep copy
+	}
+	// check the times without holding the lock, the stats can be slow on a network drive
+	if (lastSnapshot && isUpToDate( *lastSnapshot ))
+	{
+		return lastSnapshot->files;
+	}
+
+	// traverse without holding the lock, so that scanning a large directory doesn't block scanning of other directories
+	bool isReliable;
+	Snapshot snapshot = takeSnapshot( dirPath, recursively, isReliable );
+	QStringList files = snapshot.files;
+
+	QMutexLocker lock( &_mutex );
+	if (isReliable)
+		_snapshots.insert( dirPath, std::move(snapshot) );
+	else
+		_snapshots.remove( dirPath );  // re-scan next time, after the modification time settles
+
+	return files;
+}
+
+std::optional< QStringList > DirSnapshotCache::peekFiles( const QString & dirPath, bool recursively )
+{
+	QMutexLocker lock( &_mutex );
+	auto iter = _snapshots.find( dirPath );
+	if (iter == _snapshots.end() || iter->recursively != recursively)
+		return std::nullopt;
+	return iter->files;
+}
+
+void DirSnapshotCache::clear()
+{
+	QMutexLocker lock( &_mutex );
+	_snapshots.clear();
+}
+
+DirSnapshotCache g_cachedDirSnapshots;
+
+
+} // namespace fs
@@ -0,0 +1,82 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: cache of directory listings that avoids re-scanning directories that haven't changed
+//======================================================================================================================
+
+#ifndef DIR_SNAPSHOT_CACHE_INCLUDED
+#define DIR_SNAPSHOT_CACHE_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMutex>
+
+#include <optional>
+
+
+namespace fs {
+
+
+//======================================================================================================================
+/// Remembers the files found in a directory and the modification times of the directory and all its subdirectories.
+/**
+  * Modification time of a directory changes whenever an entry is added, removed or renamed inside it,
+  * so as long as none of the times has changed, the previous listing is still valid and the directory doesn't need to be
+  * traversed again. That reduces the steady-state cost of keeping the lists up-to-date to one stat per directory.
+  *
+  * Symbolic links to directories are followed, except those that point back to a directory currently being traversed,
+  * which would make the traversal loop forever.
+  *
+  * Thread-safe, can be used from the background traversal as well as from the main thread.
+  */
+class DirSnapshotCache : protected LoggingComponent {
+
+ public:
+
+	DirSnapshotCache() : LoggingComponent("DirSnapshotCache") {}
+
+	/// Returns paths of all files inside a directory in the same form as QDirIterator would return them.
+	/** Traverses the directory only when it or some of its subdirectories has been modified since the last call. */
+	QStringList getFiles( const QString & dirPath, bool recursively );
+
+	/// Returns the paths from the last listing without checking whether it's still up-to-date, doesn't touch the disk.
+	/** Returns nothing if the directory hasn't been listed yet, or its last listing wasn't reliable. */
+	std::optional< QStringList > peekFiles( const QString & dirPath, bool recursively );
+
+	void clear();
+
+ private:
+
+	struct Snapshot
+	{
+		bool recursively = false;
+		QHash< QString, qint64 > dirModifTimes;  ///< the directory itself and all its visited subdirectories
+		QStringList files;
+	};
+
+	static bool isUpToDate( const Snapshot & snapshot );
+	void addToSnapshot(
+		Snapshot & snapshot, const QString & dirPath, const QString & canonicalDirPath, QStringList & canonicalAncestors,
+		qint64 now, bool & isReliable
+	) const;
+	Snapshot takeSnapshot( const QString & dirPath, bool recursively, bool & isReliable ) const;
+
+	QMutex _mutex;
+	QHash< QString, Snapshot > _snapshots;
+
+};
+
+extern DirSnapshotCache g_cachedDirSnapshots;
+
+
+} // namespace fs
+
+
+#endif // DIR_SNAPSHOT_CACHE_INCLUDED
@@ -0,0 +1,216 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: event-driven monitoring of directory content
+//======================================================================================================================
+
+#include "DirWatcher.hpp"
+
+#include "FileSystemUtils.hpp"
+
+#include <QDirIterator>
+#include <QStringBuilder>
+#include <QSet>
+
+
+//======================================================================================================================
+
+DirWatcher::DirWatcher() : LoggingComponent("DirWatcher")
+{
+	connect( &_watcher, &QFileSystemWatcher::directoryChanged, this, &DirWatcher::onDirectoryChanged );
+}
+
+QStringList DirWatcher::collectSubdirs( const QString & dirPath )
+{
+	QStringList subdirs;
+
+	QDirIterator dirIt( dirPath, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories );
+	while (dirIt.hasNext())
+	{
+		subdirs.append( dirIt.next() );
+	}
+
+	return subdirs;
+}
+
+bool DirWatcher::addPath( const QString & path )
+{
+	auto iter = _pathRefCounts.find( path );
+	if (iter != _pathRefCounts.end())
+	{
+		++iter.value();
+		return true;
+	}
+
+	if (!_watcher.addPath( path ))
+		return false;
+
+	_pathRefCounts.insert( path, 1 );
+	return true;
+}
+
+QStringList DirWatcher::addPaths( const QStringList & paths )
+{
+	QStringList failedPaths;
+	for (const QString & path : paths)
+		if (!addPath( path ))
+			failedPaths.append( path );
+	return failedPaths;
+}
+
+void DirWatcher::removePath( const QString & path )
+{
+	auto iter = _pathRefCounts.find( path );
+	if (iter == _pathRefCounts.end())
+		return;  // adding it failed
+
+	if (--iter.value() > 0)
+		return;  // still needed by another watched dir
+
+	_pathRefCounts.erase( iter );
+	_watcher.removePath( path );
+}
+
+void DirWatcher::removePaths( const QStringList & paths )
+{
+	for (const QString & path : paths)
+		removePath( path );
+}
+
+bool DirWatcher::watch( const QString & dirPath, bool recursively )
+{
+	auto iter = _watchedDirs.find( dirPath );
+	if (iter != _watchedDirs.end())
+	{
+		if (iter->recursively == recursively)
+			return true;  // nothing to do
+
+		// the recursion setting has changed, start over
+		unwatch( iter.value(), dirPath );
+		_watchedDirs.erase( iter );
+	}
+
+	if (!fs::isValidDir( dirPath ))
+	{
+		return false;  // there is nothing to watch yet, the caller will try again later
+	}
+
+	if (!addPath( dirPath ))
+	{
+		logDebug() << "cannot watch directory " << dirPath << ", falling back to polling";
+		return false;
+	}
+
+	WatchedDir watchedDir;
+	watchedDir.recursively = recursively;
+	if (recursively)
+	{
+		watchedDir.subdirs = collectSubdirs( dirPath );
+		if (!watchedDir.subdirs.isEmpty())
+		{
+			QStringList failedDirs = addPaths( watchedDir.subdirs );
+			if (!failedDirs.isEmpty())
+			{
+				// Partially watched tree would miss some changes, better fall back to polling the whole thing.
+				logDebug() << "cannot watch " << failedDirs.size() << " subdirectories of " << dirPath << ", falling back to polling";
+				unwatch( watchedDir, dirPath );
+				return false;
+			}
+		}
+	}
+
+	_watchedDirs.insert( dirPath, std::move(watchedDir) );
+	return true;
+}
+
+void DirWatcher::unwatch( const WatchedDir & watchedDir, const QString & dirPath )
+{
+	removePath( dirPath );
+	removePaths( watchedDir.subdirs );
+}
+
+bool DirWatcher::takeChange( const QString & dirPath )
+{
+	auto iter = _watchedDirs.find( dirPath );
+	if (iter == _watchedDirs.end())
+		return false;
+
+	bool changed = iter->changed;
+	iter->changed = false;
+	return changed;
+}
+
+void DirWatcher::unwatchAllExcept( const QStringVec & dirsInUse )
+{
+	for (auto iter = _watchedDirs.begin(); iter != _watchedDirs.end(); )
+	{
+		if (!dirsInUse.contains( iter.key() ))
+		{
+			unwatch( iter.value(), iter.key() );
+			iter = _watchedDirs.erase( iter );
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+void DirWatcher::unwatchAll()
+{
+	QStringList allPaths = _watcher.directories();
+	if (!allPaths.isEmpty())
+		_watcher.removePaths( allPaths );
+	_watchedDirs.clear();
+	_pathRefCounts.clear();
+}
+
+void DirWatcher::onDirectoryChanged( const QString & path )
+{
+	for (auto iter = _watchedDirs.begin(); iter != _watchedDirs.end(); )
+	{
+		const QString & rootPath = iter.key();
+		WatchedDir & watchedDir = iter.value();
+
+		bool isRoot = path == rootPath;
+		bool isSubdir = watchedDir.recursively && path.startsWith( rootPath % '/' );
+		if (!isRoot && !isSubdir)
+		{
+			++iter;
+			continue;
+		}
+
+		if (isRoot && !fs::isValidDir( rootPath ))
+		{
+			// The directory was deleted or renamed, the system stops watching it automatically.
+			// Forget it so that the owner goes back to polling until it appears again.
+			logDebug() << "watched directory " << rootPath << " disappeared";
+			unwatch( watchedDir, rootPath );
+			iter = _watchedDirs.erase( iter );
+			continue;
+		}
+
+		watchedDir.changed = true;
+
+		if (watchedDir.recursively)
+		{
+			// Subdirectories may have been created or deleted, keep the watched set in sync with the tree.
+			QStringList currentSubdirs = collectSubdirs( rootPath );
+			QSet< QString > currentSet, previousSet;  // range constructor is not available in older Qt
+			for (const QString & subdir : currentSubdirs)
+				currentSet.insert( subdir );
+			for (const QString & subdir : watchedDir.subdirs)
+				previousSet.insert( subdir );
+			for (const QString & subdir : currentSubdirs)
+				if (!previousSet.contains( subdir ))
+					addPath( subdir );
+			for (const QString & subdir : watchedDir.subdirs)
+				if (!currentSet.contains( subdir ))
+					removePath( subdir );
+			watchedDir.subdirs = std::move( currentSubdirs );
+		}
+
+		++iter;
+	}
+}
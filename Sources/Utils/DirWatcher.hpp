@@ -0,0 +1,90 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: event-driven monitoring of directory content
+//======================================================================================================================
+
+#ifndef DIR_WATCHER_INCLUDED
+#define DIR_WATCHER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "CommonTypes.hpp"
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+
+//======================================================================================================================
+/// Remembers which of the watched directories have changed since they were last looked at.
+/**
+  * Wraps QFileSystemWatcher (inotify on Linux, ReadDirectoryChangesW on Windows, FSEvents/kqueue on Mac)
+  * so that the directory lists don't have to be re-scanned periodically when nothing happens.
+  * Some file systems (typically network shares) don't deliver change events, or deliver them only for changes made
+  * from the local machine, for those the user can still switch to polling.
+  *
+  * The change notifications are not processed immediately, but only marked, so that a burst of changes (e.g. copying
+  * hundreds of files into the directory) results in a single re-scan the next time the owner checks for changes.
+  */
+class DirWatcher : public QObject, protected LoggingComponent {
+
+	Q_OBJECT
+
+ public:
+
+	DirWatcher();
+
+	/// Starts watching a directory, if it isn't watched already.
+	/** Returns false if the directory cannot be watched (doesn't exist, the system ran out of watch descriptors, ...),
+	  * in that case the caller should fall back to periodically re-scanning it. */
+	bool watch( const QString & dirPath, bool recursively );
+
+	bool isWatched( const QString & dirPath ) const   { return _watchedDirs.contains( dirPath ); }
+
+	/// Returns whether the watched directory has changed since the last call and resets the change flag.
+	bool takeChange( const QString & dirPath );
+
+	/// Stops watching all directories except those specified.
+	/** To be called when a directory stops being used (e.g. different engine with a different config dir is selected). */
+	void unwatchAllExcept( const QStringVec & dirsInUse );
+
+	void unwatchAll();
+
+ private slots:
+
+	void onDirectoryChanged( const QString & path );
+
+ private:
+
+	QStringList collectSubdirs( const QString & dirPath );
+
+	struct WatchedDir
+	{
+		bool recursively = false;
+		bool changed = false;
+		QStringList subdirs;  ///< all the nested directories that were added to the watcher, if recursively == true
+	};
+
+	void unwatch( const WatchedDir & watchedDir, const QString & dirPath );
+
+	// The watched trees can overlap (a recursive root containing another root), so the paths are reference-counted,
+	// and a path is removed from the watcher only when the last tree that contains it stops being watched.
+	bool addPath( const QString & path );
+	QStringList addPaths( const QStringList & paths );  ///< returns the paths that failed
+	void removePath( const QString & path );
+	void removePaths( const QStringList & paths );
+
+	QFileSystemWatcher _watcher;
+	QHash< QString, WatchedDir > _watchedDirs;  ///< the top-level dirs requested by the user, key is the original path
+	QHash< QString, int > _pathRefCounts;  ///< how many of the watched dirs need each path that was added to _watcher
+
+};
+
+
+#endif // DIR_WATCHER_INCLUDED
@@ -12,11 +12,24 @@
 //#include "StandardOutput.hpp"
 #include "OSUtils.hpp"          // getThisAppDataDir
 #include "FileSystemUtils.hpp"  // getPathFromFileName
+#include "Diagnostics.hpp"      // g_stats
 
 #include <QStringBuilder>
 #include <QMessageBox>
 #include <QDebug>
 #include <QDateTime>
+#include <QFile>
+#include <QStringList>
+
+// std instead of Qt, because the sink lives until the static destruction, when the Qt's thread bookkeeping is gone
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>  // set_terminate
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>  // abort
 
 
 //======================================================================================================================
@@ -75,6 +88,27 @@ const char * logLevelToStr( LogLevel level )
 		return "INVALID";
 }
 
+// pre-formatted, so that the line opening doesn't need any formatting
+static const char * const LogLevelTags [] =
+{
+	"[DEBUG  ] ",
+	"[INFO   ] ",
+	"[FAILURE] ",
+	"[BUG    ] ",
+};
+static_assert( std::size(LogLevelTags) == std::size(LogLevelStrings), "Please update this table too" );
+
+static LogLevel getInitialLogThreshold()
+{
+	QString levelStr = qEnvironmentVariable( "DOOMRUNNER_LOG_LEVEL" ).toUpper();
+	for (size_t i = 0; i < std::size(LogLevelStrings); ++i)
+		if (levelStr == LogLevelStrings[i])
+			return LogLevel( i );
+	return LogLevel::Debug;  // everything that passed the compile-time threshold
+}
+
+std::atomic< LogLevel > g_runtimeLogThreshold = getInitialLogThreshold();
+
 static const char * const logFileName = "errors.txt";
 
 const QString & getCachedErrorFilePath()
@@ -84,18 +118,191 @@ const QString & getCachedErrorFilePath()
 	return logFilePath;
 }
 
-LogStream::LogStream( LogLevel level, const char * component )
+//----------------------------------------------------------------------------------------------------------------------
+//  LogFileSink
+
+/// Process-wide writer of the log file, that keeps the file open and writes the lines in a background thread.
+/**
+  * Opening, writing, flushing and closing the file for every message takes several syscalls, which adds up when
+  * a directory scan or a WAD reading hits many bad files. Here the callers only append the line into a queue, and the
+  * worker writes everything that has accumulated in one batch with a single flush.
+  */
+class LogFileSink
+{
+	std::mutex _mutex;  ///< protects the members below
+	std::condition_variable _linesAdded;
+	std::condition_variable _batchWritten;
+	QStringList _pendingLines;
+	quint64 _enqueuedCount = 0;  ///< lines enqueued since the start, so that flush() knows when its lines are written
+	quint64 _writtenCount = 0;
+	bool _quitRequested = false;
+
+	std::thread _thread;  ///< started with the first line, most runs don't log anything into the file
+	QFile _file;  ///< accessed only from the worker thread
+
+ public:
+
+	static LogFileSink & instance()
+	{
+		// local static variables are initialized under a mutex, so it should be save to use from multiple threads.
+		static LogFileSink sink;
+		return sink;
+	}
+
+	~LogFileSink()
+	{
+		// the static destructor runs at the exit of the application, the last messages are usually the important ones
+		{
+			std::lock_guard< std::mutex > lock( _mutex );
+			_quitRequested = true;
+		}
+		_linesAdded.notify_one();
+		if (_thread.joinable())
+			_thread.join();
+	}
+
+	void enqueue( QString line )
+	{
+		std::lock_guard< std::mutex > lock( _mutex );
+
+		if (_quitRequested)
+			return;  // logging from another static destructor, nobody would write it
+
+		_pendingLines.append( std::move(line) );
+		_enqueuedCount++;
+		diag::g_stats.logFileLines.increment();
+
+		if (!_thread.joinable())
+			_thread = std::thread( &LogFileSink::writePendingLines, this );
+		else
+			_linesAdded.notify_one();
+	}
+
+	void flush()
+	{
+		std::unique_lock< std::mutex > lock( _mutex );
+		quint64 targetCount = _enqueuedCount;
+		_batchWritten.wait( lock, [&]() { return _writtenCount >= targetCount || !_thread.joinable(); } );
+	}
+
+	/// Variant for the moments when the application is going down, when it must not get stuck on its own lock.
+	/** If the crashing thread is the one that holds the lock, or the writing takes too long, it gives up. */
+	void flushBeforeCrash()
+	{
+		std::unique_lock< std::mutex > lock( _mutex, std::try_to_lock );
+		if (!lock.owns_lock())
+			return;
+		quint64 targetCount = _enqueuedCount;
+		_batchWritten.wait_for( lock, std::chrono::seconds( 2 ), [&]() { return _writtenCount >= targetCount || !_thread.joinable(); } );
+	}
+
+ private:
+
+	void writePendingLines()
+	{
+		std::unique_lock< std::mutex > lock( _mutex );
+
+		while (true)
+		{
+			_linesAdded.wait( lock, [this]() { return !_pendingLines.isEmpty() || _quitRequested; } );
+
+			if (_pendingLines.isEmpty())  // and quit was requested
+				return;
+
+			QStringList lines;
+			lines.swap( _pendingLines );
+			quint64 batchEndCount = _enqueuedCount;
+
+			lock.unlock();
+
+			if (!_file.isOpen())
+				_file.setFileName( getCachedErrorFilePath() );
+			if (_file.isOpen() || _file.open( QIODevice::Append ))
+			{
+				for (const QString & line : lines)
+					_file.write( line.toUtf8() );
+				_file.flush();
+				diag::g_stats.logFileWrites.increment();
+			}
+			// else there is nowhere to report it, the messages still went to the debug stream
+
+			lock.lock();
+
+			_writtenCount = batchEndCount;
+			_batchWritten.notify_all();
+		}
+	}
+};
+
+void flushLogFile()
+{
+	LogFileSink::instance().flush();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+//  flushing before a crash
+
+// The static destructor of the sink doesn't run when the application is aborted, which would lose exactly the messages
+// that explain why it happened.
+
+static QtMessageHandler g_prevMessageHandler = nullptr;
+static std::terminate_handler g_prevTerminateHandler = nullptr;
+
+static void flushingMessageHandler( QtMsgType type, const QMessageLogContext & context, const QString & message )
+{
+	if (type == QtFatalMsg)
+		LogFileSink::instance().flushBeforeCrash();
+
+	if (g_prevMessageHandler)
+		g_prevMessageHandler( type, context, message );  // the default one aborts for QtFatalMsg
+	else
+		fprintf( stderr, "%s\n", message.toLocal8Bit().constData() );  // qInstallMessageHandler() returned no default
+
+	if (type == QtFatalMsg)
+		std::abort();  // in case the previous handler didn't
+}
+
+[[noreturn]] static void flushingTerminateHandler()
+{
+	LogFileSink::instance().flushBeforeCrash();
+
+	if (g_prevTerminateHandler)
+		g_prevTerminateHandler();
+	std::abort();
+}
+
+static void flushingAbortSignalHandler( int )
+{
+	// Not async-signal-safe, but the process is being killed anyway, and the timed try-lock can't dead-lock it.
+	LogFileSink::instance().flushBeforeCrash();
+
+	std::signal( SIGABRT, SIG_DFL );
+	std::raise( SIGABRT );
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  LogStream
+
+LogStream::LogStream( LogLevel level, const char * component, bool enabled )
 :
-	_debugStream( debugStreamFromLogLevel( level ) ),
-	_logFile( getCachedErrorFilePath() ),
 	_logLevel( level )
 {
-	_debugStream.noquote().nospace();
+	if (!enabled)
+		return;
+
+	diag::g_stats.logMessages.increment();
+
+	if (shouldWriteToDebugStream())
+	{
+		_debugStream.emplace( debugStreamFromLogLevel( level ) );
+		_debugStream->noquote().nospace();
+	}
 
 	if (shouldWriteToFileStream())
 	{
-		if (_logFile.open( QIODevice::Append ))
-			_fileStream.setDevice( &_logFile );
+		_fileLine.emplace();
+		_fileStream.emplace( &*_fileLine, QIODevice::WriteOnly );
 	}
 
 	writeLineOpening( level, component );
@@ -103,11 +310,16 @@ LogStream::LogStream( LogLevel level, const char * component )
 
 LogStream::~LogStream()
 {
-	if (shouldAndCanWriteToFileStream())
+	if (_fileStream)
 	{
-		_fileStream << Qt::endl;
+		*_fileStream << '\n';
+		_fileStream->flush();  // into the string
+		LogFileSink::instance().enqueue( std::move(*_fileLine) );
+
+		// a logic error is often followed by a failed assert or a crash, make sure the message survives it
+		if (_logLevel == LogLevel::Bug)
+			LogFileSink::instance().flush();
 	}
-	// log file is closed automatically
 }
 
 QDebug LogStream::debugStreamFromLogLevel( LogLevel level )
@@ -124,20 +336,34 @@ QDebug LogStream::debugStreamFromLogLevel( LogLevel level )
 
 void LogStream::writeLineOpening( LogLevel level, const char * component )
 {
-	auto logLevelStr = logLevelToStr( level );
-	QString componentStr = component ? QStringLiteral("%1: ").arg( component ) : "";
+	const char * logLevelTag = size_t(level) < std::size(LogLevelTags) ? LogLevelTags[ size_t(level) ] : "[INVALID] ";
 
-	if (shouldWriteToDebugStream())
+	if (_debugStream)
 	{
-		_debugStream << QStringLiteral("[%1] %2").arg( logLevelStr, -7 ).arg( componentStr );
+		*_debugStream << logLevelTag;
+		if (component)
+			*_debugStream << component << ": ";
 	}
 
-	if (shouldAndCanWriteToFileStream())
+	if (_fileStream)
 	{
 		auto currentTime = QDateTime::currentDateTime().toString( Qt::DateFormat::ISODate );
 
-		_fileStream << QStringLiteral("[%1] [%2] %3").arg( currentTime ).arg( logLevelStr, -7 ).arg( componentStr );
+		*_fileStream << '[' << currentTime << "] " << logLevelTag;
+		if (component)
+			*_fileStream << component << ": ";
 	}
 }
 
 } // namespace impl
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void installLogFlushHandlers()
+{
+	impl::g_prevMessageHandler = qInstallMessageHandler( impl::flushingMessageHandler );
+	impl::g_prevTerminateHandler = std::set_terminate( impl::flushingTerminateHandler );
+	// failed assert() and std::abort() don't go through any of the above
+	std::signal( SIGABRT, impl::flushingAbortSignalHandler );
+}
@@ -18,6 +18,9 @@
 #include <QTextStream>
 #include <QFile>
 
+#include <optional>
+#include <atomic>
+
 class QWidget;
 
 
@@ -51,12 +54,33 @@ enum class LogLevel
 };
 const char * logLevelToStr( LogLevel level );
 
+/// Messages below this level are removed by the compiler together with the evaluation of their arguments.
+/** Can be overridden by DEFINES += LOG_LEVEL_THRESHOLD=<number of the level>. */
+#ifdef LOG_LEVEL_THRESHOLD
+	constexpr LogLevel compileTimeLogThreshold = LogLevel( LOG_LEVEL_THRESHOLD );
+#elif IS_DEBUG_BUILD
+	constexpr LogLevel compileTimeLogThreshold = LogLevel::Debug;
+#else
+	constexpr LogLevel compileTimeLogThreshold = LogLevel::Info;
+#endif
+
+/// Messages below this level are dropped at runtime before any of the streams is constructed.
+/** Initialized from the DOOMRUNNER_LOG_LEVEL environment variable (debug, info, failure, bug). */
+extern std::atomic< LogLevel > g_runtimeLogThreshold;
+
+inline bool isLogLevelEnabled( LogLevel level )
+{
+	return fut::to_underlying( level ) >= fut::to_underlying( g_runtimeLogThreshold.load( std::memory_order_relaxed ) );
+}
+
 /// Stream wrapper that logs to multiple streams depending on log level and build type
+/** The line for the log file is only composed here, it's handed over to a background writer when the stream is
+  * destroyed, so logging doesn't cost any file operations to the caller. */
 class LogStream
 {
-	QDebug _debugStream;
-	QFile _logFile;
-	QTextStream _fileStream;
+	std::optional< QDebug > _debugStream;  ///< empty if the message shouldn't go there
+	std::optional< QString > _fileLine;  ///< empty if the message shouldn't go into the log file
+	std::optional< QTextStream > _fileStream;  ///< writes into _fileLine
 
 	LogLevel _logLevel;
 	bool _addQuotes = true;
@@ -65,7 +89,8 @@ class LogStream
 
  public:
 
-	LogStream( LogLevel level, const char * componentName );
+	/// A disabled stream doesn't construct any of the streams and ignores everything written into it.
+	LogStream( LogLevel level, const char * componentName, bool enabled = true );
 	~LogStream();
 
 	LogStream & quote()
@@ -114,10 +139,10 @@ class LogStream
 	template< typename Obj >
 	void write( const Obj & obj )
 	{
-		if (shouldWriteToDebugStream())
-			_debugStream << obj;
-		if (shouldAndCanWriteToFileStream())
-			_fileStream << obj;
+		if (_debugStream)
+			*_debugStream << obj;
+		if (_fileStream)
+			*_fileStream << obj;
 	}
 
 	inline constexpr bool shouldWriteToDebugStream() const
@@ -129,11 +154,6 @@ class LogStream
 	{
 		return fut::to_underlying( _logLevel ) >= fut::to_underlying( LogLevel::Failure );
 	}
-
-	inline bool shouldAndCanWriteToFileStream() const
-	{
-		return _logFile.isOpen(); //&& shouldWriteToFileStream()  redundant, log file is always open when should write
-	}
 };
 
 /// Stream wrapper that does nothing (used to eliminate debug messages in release builds)
@@ -153,6 +173,21 @@ class DummyLogStream
 
 };
 
+/// Writes everything that has been logged so far into the log file and waits until it's done.
+/** Called automatically at the exit of the application, and after each logic error.
+  * An abort is covered by installLogFlushHandlers(). */
+void flushLogFile();
+
+/// Returns a stream that does nothing if the level is filtered out at compile time, and a disabled one if at runtime.
+template< LogLevel level >
+inline auto makeLogStream( [[maybe_unused]] const char * componentName )
+{
+	if constexpr (fut::to_underlying( level ) < fut::to_underlying( compileTimeLogThreshold ))
+		return DummyLogStream();
+	else
+		return LogStream( level, componentName, isLogLevelEnabled( level ) );
+}
+
 } // namespace impl
 
 
@@ -160,33 +195,33 @@ class DummyLogStream
 //  top-level logging API
 
 /// Writes a debugging message into stderr (in debug builds only).
-inline auto logDebug( [[maybe_unused]] const char * componentName = nullptr )
+inline auto logDebug( const char * componentName = nullptr )
 {
- #if IS_DEBUG_BUILD
-	return impl::LogStream( impl::LogLevel::Debug, componentName );
- #else
-	return impl::DummyLogStream();
- #endif
+	return impl::makeLogStream< impl::LogLevel::Debug >( componentName );
 }
 
 /// Writes a message about an event that is not necessarily an error, but is worth noting.
 inline auto logInfo( const char * componentName = nullptr )
 {
-	return impl::LogStream( impl::LogLevel::Info, componentName );
+	return impl::makeLogStream< impl::LogLevel::Info >( componentName );
 }
 
 /// Writes a message about a non-critical background error into stderr and an error file.
 inline auto logRuntimeError( const char * componentName = nullptr )
 {
-	return impl::LogStream( impl::LogLevel::Failure, componentName );
+	return impl::makeLogStream< impl::LogLevel::Failure >( componentName );
 }
 
 /// Writes a message about a serious background error into stderr and an error file.
 inline auto logLogicError( const char * componentName = nullptr )
 {
-	return impl::LogStream( impl::LogLevel::Bug, componentName );
+	return impl::makeLogStream< impl::LogLevel::Bug >( componentName );
 }
 
+/// Makes sure everything logged so far gets into the log file even when the application crashes.
+/** Covers qFatal(), uncaught exceptions and aborts (including failed asserts). Call it once at the start of main(). */
+void installLogFlushHandlers();
+
 
 //----------------------------------------------------------------------------------------------------------------------
 //  logging helpers for simplifying logging even further
@@ -107,3 +107,17 @@ bool ConfirmationFilter::eventFilter( QObject * obj, QEvent * event )
 
 	return QObject::eventFilter( obj, event );
 }
+
+
+//======================================================================================================================
+//  HoverFilter
+
+bool HoverFilter::eventFilter( QObject * obj, QEvent * event )
+{
+	if (event->type() == QEvent::Enter)
+	{
+		emit hovered();
+	}
+
+	return QObject::eventFilter( obj, event );
+}
@@ -113,4 +113,26 @@ class ConfirmationFilter : public QObject {
 };
 
 
+//======================================================================================================================
+/** Event filter that captures the mouse cursor entering a widget and emits it as signal. */
+
+class HoverFilter : public QObject {
+
+	Q_OBJECT
+
+ public:
+
+	HoverFilter() {}
+	virtual ~HoverFilter() override {}
+
+ protected:
+
+	virtual bool eventFilter( QObject * obj, QEvent * event ) override;
+
+ signals:
+
+	void hovered();
+
+};
+
 #endif // EVENT_FILTERS_INCLUDED
@@ -11,11 +11,23 @@
 #include "ContainerUtils.hpp"  // span
 #include "JsonUtils.hpp"
 #include "ErrorHandling.hpp"
+#include "FileSystemUtils.hpp"  // getFileBasenameFromPath
 
 #include <QFile>
 #include <QFileInfo>
 #include <QDateTime>
 #include <QStringBuilder>
+#include <QtEndian>
+#include <QtAlgorithms>  // qCountTrailingZeroBits
+
+#include <string_view>
+#include <cstring>
+#include <cctype>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define BYTE_SEARCH_SSE2
+#endif
 
 #if IS_WINDOWS
 	#include <windows.h>
@@ -26,6 +38,654 @@
 namespace os {
 
 
+//======================================================================================================================
+//  common
+
+/// Bounds-checked little-endian read from a file loaded in memory.
+template< typename Int >
+static bool readLE( const uchar * data, qint64 size, qint64 offset, Int & value )
+{
+	if (offset < 0 || offset + qint64( sizeof(Int) ) > size)
+		return false;
+	value = qFromLittleEndian< Int >( data + offset );
+	return true;
+}
+
+/// Maps the whole file into memory, or reads it into the buffer if it can't be mapped.
+/** Mapping lets us touch only the pages we are interested in, instead of reading tens of megabytes of code. */
+static const uchar * mapWholeFile( QFile & file, QByteArray & buffer, qint64 & size )
+{
+	size = file.size();
+	if (const uchar * data = file.map( 0, size ))
+		return data;
+
+	buffer = file.readAll();
+	size = buffer.size();
+	return reinterpret_cast< const uchar * >( buffer.constData() );
+}
+
+
+//======================================================================================================================
+//  portable PE parsing
+
+// Loading the executable through the system loader (LoadLibraryEx) maps the whole image and triggers the antivirus
+// scanning, which can take up to a second. The version resource can instead be found by walking the PE headers
+// and the resource directory of the memory-mapped file, which takes a few page reads and works on any platform.
+
+//  https://learn.microsoft.com/en-us/windows/win32/debug/pe-format
+//  https://learn.microsoft.com/en-us/windows/win32/menurc/vs-versioninfo
+
+class LoggingPeReader : protected LoggingComponent {
+
+ public:
+
+	LoggingPeReader( QString filePath ) : LoggingComponent("ExeReader"), _filePath( std::move(filePath) ) {}
+
+	UncertainExeVersionInfo readVersionInfo();
+
+ private:
+
+	/// one node of the VS_VERSIONINFO tree
+	struct VerBlock
+	{
+		qint64 end = 0;  ///< position right after the block including its children
+		quint16 valueLength = 0;
+		quint16 type = 0;  ///< 1 = text value, 0 = binary value
+		QString key;
+		qint64 valueBegin = 0;
+		qint64 childrenBegin = 0;
+	};
+
+	ReadStatus findVersionResource( qint64 & resOffset, qint64 & resSize );
+	bool rvaToOffset( quint32 rva, qint64 & offset ) const;
+	bool findResourceDirEntry( qint64 dirOffset, std::optional< quint32 > id, quint32 & entryOffset ) const;
+	bool parseVerBlock( qint64 pos, qint64 limit, VerBlock & block ) const;
+	void extractVersionInfo( qint64 resOffset, qint64 resSize, ExeVersionInfo & verInfo );
+
+	template< typename Int >
+	bool read( qint64 offset, Int & value ) const
+	{
+		return readLE( _data, _size, offset, value );
+	}
+
+	QString readUtf16( qint64 begin, qint64 limit, qint64 * end = nullptr ) const;
+
+	static qint64 align4( qint64 pos, qint64 base )  { return base + ((pos - base + 3) & ~qint64(3)); }
+
+	QString _filePath;
+	const uchar * _data = nullptr;
+	qint64 _size = 0;
+
+	// from the PE headers
+	qint64 _sectionTableOffset = 0;
+	quint16 _numSections = 0;
+	qint64 _resDirOffset = 0;  ///< file offset of the root resource directory
+
+};
+
+QString LoggingPeReader::readUtf16( qint64 begin, qint64 limit, qint64 * end ) const
+{
+	QString str;
+	qint64 pos = begin;
+	quint16 ch;
+	while (pos + 2 <= limit && read( pos, ch ))
+	{
+		pos += 2;
+		if (ch == 0)
+			break;
+		str.append( QChar( ch ) );
+	}
+	if (end)
+		*end = pos;  // after the null terminator
+	return str;
+}
+
+bool LoggingPeReader::rvaToOffset( quint32 rva, qint64 & offset ) const
+{
+	for (quint16 i = 0; i < _numSections; ++i)
+	{
+		qint64 section = _sectionTableOffset + qint64( i ) * 40;
+		quint32 virtualSize, virtualAddress, rawSize, rawOffset;
+		if (!read( section + 8, virtualSize ) || !read( section + 12, virtualAddress )
+		 || !read( section + 16, rawSize ) || !read( section + 20, rawOffset ))
+			return false;
+
+		quint32 sectionSize = std::max( virtualSize, rawSize );
+		if (rva >= virtualAddress && rva - virtualAddress < sectionSize)
+		{
+			offset = qint64( rawOffset ) + (rva - virtualAddress);
+			return offset < _size;
+		}
+	}
+	return false;
+}
+
+/// Finds the entry with the ID, or the first entry when no ID is given. The entryOffset is relative to the resource section.
+bool LoggingPeReader::findResourceDirEntry( qint64 dirOffset, std::optional< quint32 > id, quint32 & entryOffset ) const
+{
+	quint16 numNamed, numIds;
+	if (!read( dirOffset + 12, numNamed ) || !read( dirOffset + 14, numIds ))
+		return false;
+
+	// the named entries go first, then the ones with numeric IDs
+	qint64 entries = dirOffset + 16;
+	for (int i = 0; i < numNamed + numIds; ++i)
+	{
+		quint32 nameOrId, offsetToData;
+		if (!read( entries + i * 8, nameOrId ) || !read( entries + i * 8 + 4, offsetToData ))
+			return false;
+		if (!id || (i >= numNamed && nameOrId == *id))
+		{
+			entryOffset = offsetToData;
+			return true;
+		}
+	}
+	return false;
+}
+
+ReadStatus LoggingPeReader::findVersionResource( qint64 & resOffset, qint64 & resSize )
+{
+	static constexpr quint16 PE32Magic = 0x10b;
+	static constexpr quint16 PE32PlusMagic = 0x20b;
+	static constexpr quint32 ResourceDirIndex = 2;
+	static constexpr quint32 RT_VERSION_ID = 16;
+	static constexpr quint32 SubdirFlag = 0x80000000;
+
+	quint32 peHeaderOffset, peSignature;
+	if (!read( 0x3C, peHeaderOffset ) || !read( peHeaderOffset, peSignature ) || peSignature != 0x00004550)  // "PE\0\0"
+	{
+		logDebug() << _filePath << ": invalid PE header";
+		return ReadStatus::InvalidFormat;
+	}
+
+	qint64 coffHeader = qint64( peHeaderOffset ) + 4;
+	quint16 optHeaderSize, optMagic;
+	if (!read( coffHeader + 2, _numSections ) || !read( coffHeader + 16, optHeaderSize ))
+		return ReadStatus::InvalidFormat;
+	qint64 optHeader = coffHeader + 20;
+	_sectionTableOffset = optHeader + optHeaderSize;
+
+	if (!read( optHeader, optMagic ) || (optMagic != PE32Magic && optMagic != PE32PlusMagic))
+	{
+		logDebug() << _filePath << ": unknown optional header magic";
+		return ReadStatus::InvalidFormat;
+	}
+	qint64 numDirsPos = optHeader + (optMagic == PE32PlusMagic ? 108 : 92);
+	quint32 numDataDirs, resDirRva;
+	if (!read( numDirsPos, numDataDirs ) || numDataDirs <= ResourceDirIndex
+	 || !read( numDirsPos + 4 + ResourceDirIndex * 8, resDirRva ) || resDirRva == 0)
+	{
+		return ReadStatus::InfoNotPresent;  // no resources at all
+	}
+	if (!rvaToOffset( resDirRva, _resDirOffset ))
+	{
+		logDebug() << _filePath << ": resource directory outside of sections";
+		return ReadStatus::InvalidFormat;
+	}
+
+	// type -> name -> language, the loader looks for the resource ID 1, any language will do
+	// (this resource is optional, some exe files don't have it)
+	quint32 entry;
+	if (!findResourceDirEntry( _resDirOffset, RT_VERSION_ID, entry ))
+		return ReadStatus::InfoNotPresent;
+	if (!(entry & SubdirFlag))
+		return ReadStatus::InvalidFormat;
+	quint32 nameDir = entry & ~SubdirFlag;
+	if (!findResourceDirEntry( _resDirOffset + nameDir, 1, entry ) && !findResourceDirEntry( _resDirOffset + nameDir, std::nullopt, entry ))
+		return ReadStatus::InfoNotPresent;
+	if (entry & SubdirFlag)
+	{
+		if (!findResourceDirEntry( _resDirOffset + (entry & ~SubdirFlag), std::nullopt, entry ) || (entry & SubdirFlag))
+			return ReadStatus::InvalidFormat;
+	}
+
+	// IMAGE_RESOURCE_DATA_ENTRY, where the data offset is an RVA, unlike all the offsets above
+	quint32 dataRva, dataSize;
+	if (!read( _resDirOffset + entry, dataRva ) || !read( _resDirOffset + entry + 4, dataSize )
+	 || !rvaToOffset( dataRva, resOffset ) || resOffset + dataSize > _size)
+	{
+		logDebug() << _filePath << ": invalid version resource entry";
+		return ReadStatus::InvalidFormat;
+	}
+	resSize = dataSize;
+	return ReadStatus::Success;
+}
+
+bool LoggingPeReader::parseVerBlock( qint64 pos, qint64 limit, VerBlock & block ) const
+{
+	quint16 length;
+	if (!read( pos, length ) || !read( pos + 2, block.valueLength ) || !read( pos + 4, block.type ))
+		return false;
+	if (length < 6 || pos + length > limit)
+		return false;
+	block.end = pos + length;
+
+	qint64 keyEnd;
+	block.key = readUtf16( pos + 6, block.end, &keyEnd );
+	block.valueBegin = align4( keyEnd, pos );
+	qint64 valueBytes = block.type == 1 ? qint64( block.valueLength ) * 2 : block.valueLength;  // text length is in characters
+	block.childrenBegin = std::min( align4( block.valueBegin + valueBytes, pos ), block.end );
+	return true;
+}
+
+void LoggingPeReader::extractVersionInfo( qint64 resOffset, qint64 resSize, ExeVersionInfo & verInfo )
+{
+	static constexpr quint32 FixedInfoSignature = 0xFEEF04BD;
+
+	const qint64 resEnd = resOffset + resSize;
+
+	VerBlock root;
+	if (!parseVerBlock( resOffset, resEnd, root ) || root.key != "VS_VERSION_INFO")
+	{
+		logRuntimeError() << "Cannot read version info of "<<_filePath<<", invalid VS_VERSIONINFO block";
+		return;
+	}
+
+	// VS_FIXEDFILEINFO
+	quint32 signature, fileVersionMS, fileVersionLS;
+	if (root.valueLength >= 52 && read( root.valueBegin, signature ) && signature == FixedInfoSignature
+	 && read( root.valueBegin + 8, fileVersionMS ) && read( root.valueBegin + 12, fileVersionLS ))
+	{
+		verInfo.version.major = (fileVersionMS >> 16) & 0xffff;
+		verInfo.version.minor = (fileVersionMS >>  0) & 0xffff;
+		verInfo.version.patch = (fileVersionLS >> 16) & 0xffff;
+		verInfo.version.build = (fileVersionLS >>  0) & 0xffff;
+	}
+	else
+	{
+		logRuntimeError() << "Cannot read fixed version info of "<<_filePath<<", invalid VS_FIXEDFILEINFO";
+	}
+
+	// first find out the preferred language, then look for the strings of that language
+	QString langKey;
+	qint64 stringFileInfoPos = -1;
+	VerBlock child;
+	for (qint64 pos = root.childrenBegin; pos < root.end && parseVerBlock( pos, root.end, child ); pos = align4( child.end, resOffset ))
+	{
+		if (child.key == "StringFileInfo")
+		{
+			stringFileInfoPos = pos;
+		}
+		else if (child.key == "VarFileInfo")
+		{
+			VerBlock var;
+			if (parseVerBlock( child.childrenBegin, child.end, var ) && var.key == "Translation")
+			{
+				quint16 language, codePage;
+				if (var.valueLength >= 4 && read( var.valueBegin, language ) && read( var.valueBegin + 2, codePage ))
+					langKey = QStringLiteral("%1%2").arg( language, 4, 16, QChar('0') ).arg( codePage, 4, 16, QChar('0') );
+			}
+		}
+	}
+
+	VerBlock stringFileInfo;
+	if (stringFileInfoPos < 0 || !parseVerBlock( stringFileInfoPos, root.end, stringFileInfo ))
+	{
+		logDebug() << "No StringFileInfo in "<<_filePath;
+		return;
+	}
+
+	// if there is no table for the declared language, take the first one
+	VerBlock table;
+	bool tableFound = false;
+	for (qint64 pos = stringFileInfo.childrenBegin; pos < stringFileInfo.end && parseVerBlock( pos, stringFileInfo.end, child ); pos = align4( child.end, resOffset ))
+	{
+		if (!tableFound || child.key.compare( langKey, Qt::CaseInsensitive ) == 0)
+		{
+			bool isPreferred = child.key.compare( langKey, Qt::CaseInsensitive ) == 0;
+			table = child;
+			tableFound = true;
+			if (isPreferred)
+				break;
+		}
+	}
+	if (!tableFound)
+	{
+		logDebug() << "No string table in "<<_filePath;
+		return;
+	}
+
+	for (qint64 pos = table.childrenBegin; pos < table.end && parseVerBlock( pos, table.end, child ); pos = align4( child.end, resOffset ))
+	{
+		// some compilers put the length in bytes instead of characters here, so read only up to the null terminator
+		if (child.key == "ProductName")
+			verInfo.appName = readUtf16( child.valueBegin, child.end );
+		else if (child.key == "FileDescription")
+			verInfo.description = readUtf16( child.valueBegin, child.end );
+	}
+}
+
+UncertainExeVersionInfo LoggingPeReader::readVersionInfo()
+{
+	UncertainExeVersionInfo verInfo;
+
+	QFile file( _filePath );
+	if (!file.open( QIODevice::ReadOnly ))
+	{
+		logRuntimeError().noquote() << "Cannot open \""<<_filePath<<"\": "<<file.errorString();
+		verInfo.status = ReadStatus::CantOpen;
+		return verInfo;
+	}
+
+	if (file.peek( 2 ) != "MZ")
+	{
+		verInfo.status = ReadStatus::NotSupported;  // not a Windows executable
+		return verInfo;
+	}
+
+	// only the headers, the resource directory and the version resource will be actually read from the disk
+	QByteArray fileContent;
+	_data = mapWholeFile( file, fileContent, _size );
+
+	qint64 resOffset, resSize;
+	verInfo.status = findVersionResource( resOffset, resSize );
+	if (verInfo.status != ReadStatus::Success)
+	{
+		logDebug() << "Cannot find version resource in "<<_filePath<<": "<<statusToStr( verInfo.status );
+		return verInfo;
+	}
+
+	extractVersionInfo( resOffset, resSize, verInfo );
+
+	verInfo.status = ReadStatus::Success;
+	return verInfo;  // the file is unmapped when it's closed
+}
+
+
+//======================================================================================================================
+//  ELF and Mach-O scanning
+
+// Linux and macOS executables have no standard version resource, but the engines embed their version string
+// in the read-only data, so we look for it there. This only works for the engines we know the string format of.
+
+using namespace std::string_view_literals;
+
+struct EmbeddedVersionPattern
+{
+	std::string_view exeBaseName;  ///< lower case, without suffix
+	const char * appName;          ///< how the engine calls itself in the Windows version resource
+	std::string_view prefix;       ///< what precedes the version number in the binary, can contain null characters
+};
+
+static const EmbeddedVersionPattern embeddedVersionPatterns [] =
+{
+	// the git description is stored as a separate null-terminated string like "g4.11.3"
+	{ "gzdoom"sv,          "GZDoom",          "\0g"sv },
+	{ "lzdoom"sv,          "LZDoom",          "\0l"sv },
+	// the autotools/cmake PACKAGE_STRING
+	{ "chocolate-doom"sv,  "Chocolate Doom",  "Chocolate Doom "sv },
+	{ "crispy-doom"sv,     "Crispy Doom",     "Crispy Doom "sv },
+	{ "prboom-plus"sv,     "PrBoom+",         "prboom-plus "sv },
+	{ "dsda-doom"sv,       "DSDA-Doom",       "dsda-doom "sv },
+	{ "woof"sv,            "Woof!",           "Woof "sv },
+	{ "zandronum"sv,       "Zandronum",       "Zandronum "sv },
+};
+
+/// Finds the first occurrence of the needle in the data starting at the position from, returns -1 if there is none.
+/** The SSE2 variant tests 16 positions at once for the first and the last byte of the needle,
+  * and compares the whole needle only on the positions where both match. */
+static qint64 findBytes( const uchar * data, qint64 size, qint64 from, std::string_view needle )
+{
+	const qint64 n = qint64( needle.size() );
+	if (n == 0 || size - from < n)
+		return -1;
+
+	qint64 pos = from;
+
+ #if defined(BYTE_SEARCH_SSE2)
+	const __m128i first = _mm_set1_epi8( needle.front() );
+	const __m128i last = _mm_set1_epi8( needle.back() );
+	for (; pos + n - 1 + 16 <= size; pos += 16)
+	{
+		__m128i blockFirst = _mm_loadu_si128( reinterpret_cast< const __m128i * >( data + pos ) );
+		__m128i blockLast = _mm_loadu_si128( reinterpret_cast< const __m128i * >( data + pos + n - 1 ) );
+		uint mask = uint( _mm_movemask_epi8( _mm_and_si128( _mm_cmpeq_epi8( blockFirst, first ), _mm_cmpeq_epi8( blockLast, last ) ) ) );
+		while (mask != 0)
+		{
+			uint bit = qCountTrailingZeroBits( mask );
+			if (memcmp( data + pos + bit, needle.data(), size_t( n ) ) == 0)
+				return pos + bit;
+			mask &= mask - 1;
+		}
+	}
+ #endif
+
+	// the rest (or everything, when SSE2 is not available)
+	while (pos + n <= size)
+	{
+		const void * found = memchr( data + pos, uchar( needle.front() ), size_t( size - n + 1 - pos ) );
+		if (!found)
+			return -1;
+		pos = static_cast< const uchar * >( found ) - data;
+		if (memcmp( data + pos, needle.data(), size_t( n ) ) == 0)
+			return pos;
+		++pos;
+	}
+	return -1;
+}
+
+class LoggingBinaryScanner : protected LoggingComponent {
+
+ public:
+
+	LoggingBinaryScanner( QString filePath ) : LoggingComponent("ExeReader"), _filePath( std::move(filePath) ) {}
+
+	UncertainExeVersionInfo readVersionInfo();
+
+ private:
+
+	bool findElfReadOnlyData( qint64 & begin, qint64 & end ) const;
+	bool findMachOStrings( qint64 & begin, qint64 & end ) const;
+	bool parseVersionAt( qint64 pos, qint64 end, bool mustEndWithNull, Version & version ) const;
+
+	template< typename Int >
+	bool read( qint64 offset, Int & value ) const
+	{
+		return readLE( _data, _size, offset, value );
+	}
+
+	QString _filePath;
+	const uchar * _data = nullptr;
+	qint64 _size = 0;
+
+};
+
+bool LoggingBinaryScanner::findElfReadOnlyData( qint64 & begin, qint64 & end ) const
+{
+	// https://refspecs.linuxfoundation.org/elf/gabi4+/ch4.eheader.html
+	if (_size < 0x40 || _data[4] < 1 || _data[4] > 2 || _data[5] != 1)  // only little-endian, 32-bit or 64-bit
+		return false;
+	const bool is64 = _data[4] == 2;
+
+	quint64 shOffset;
+	quint16 shEntSize, shNum, shStrIdx;
+	if (is64)
+	{
+		if (!read( 0x28, shOffset ) || !read( 0x3A, shEntSize ) || !read( 0x3C, shNum ) || !read( 0x3E, shStrIdx ))
+			return false;
+	}
+	else
+	{
+		quint32 shOffset32;
+		if (!read( 0x20, shOffset32 ) || !read( 0x2E, shEntSize ) || !read( 0x30, shNum ) || !read( 0x32, shStrIdx ))
+			return false;
+		shOffset = shOffset32;
+	}
+
+	auto getSection = [&]( quint16 idx, quint32 & nameOffset, quint64 & offset, quint64 & size ) -> bool
+	{
+		qint64 header = qint64( shOffset ) + qint64( idx ) * shEntSize;
+		if (!read( header, nameOffset ))
+			return false;
+		if (is64)
+			return read( header + 0x18, offset ) && read( header + 0x20, size );
+		quint32 offset32, size32;
+		if (!read( header + 0x10, offset32 ) || !read( header + 0x14, size32 ))
+			return false;
+		offset = offset32;
+		size = size32;
+		return true;
+	};
+
+	quint32 unused;
+	quint64 strTabOffset, strTabSize;
+	if (shStrIdx >= shNum || !getSection( shStrIdx, unused, strTabOffset, strTabSize ))
+		return false;
+
+	for (quint16 i = 0; i < shNum; ++i)
+	{
+		quint32 nameOffset;
+		quint64 offset, size;
+		if (!getSection( i, nameOffset, offset, size ))
+			return false;
+
+		static constexpr char rodataName [] = ".rodata";
+		qint64 namePos = qint64( strTabOffset ) + nameOffset;
+		if (namePos + qint64( sizeof(rodataName) ) <= _size && memcmp( _data + namePos, rodataName, sizeof(rodataName) ) == 0
+		 && offset + size <= quint64( _size ))
+		{
+			begin = qint64( offset );
+			end = qint64( offset + size );
+			return true;
+		}
+	}
+	return false;
+}
+
+bool LoggingBinaryScanner::findMachOStrings( qint64 & begin, qint64 & end ) const
+{
+	// https://github.com/apple-oss-distributions/xnu/blob/main/EXTERNAL_HEADERS/mach-o/loader.h
+	static constexpr quint32 MH_MAGIC_64 = 0xFEEDFACF;
+	static constexpr quint32 LC_SEGMENT_64 = 0x19;
+
+	quint32 magic, numCmds;
+	if (!read( 0, magic ) || magic != MH_MAGIC_64 || !read( 16, numCmds ))
+		return false;  // universal binaries and 32-bit ones are scanned whole
+
+	qint64 cmd = 32;
+	for (quint32 i = 0; i < numCmds; ++i)
+	{
+		quint32 cmdType, cmdSize, numSects;
+		if (!read( cmd, cmdType ) || !read( cmd + 4, cmdSize ) || cmdSize == 0)
+			return false;
+
+		if (cmdType == LC_SEGMENT_64 && read( cmd + 64, numSects ))
+		{
+			for (quint32 j = 0; j < numSects; ++j)
+			{
+				qint64 sect = cmd + 72 + qint64( j ) * 80;
+				quint64 size;
+				quint32 offset;
+				if (sect + 80 > _size || !read( sect + 40, size ) || !read( sect + 48, offset ))
+					return false;
+				if (strncmp( reinterpret_cast< const char * >( _data + sect ), "__cstring", 16 ) == 0
+				 && quint64( offset ) + size <= quint64( _size ))
+				{
+					begin = offset;
+					end = qint64( offset + size );
+					return true;
+				}
+			}
+		}
+		cmd += cmdSize;
+	}
+	return false;
+}
+
+/// Parses [v]major.minor[.patch[.build]] and checks that it's not just a part of a longer text.
+bool LoggingBinaryScanner::parseVersionAt( qint64 pos, qint64 end, bool mustEndWithNull, Version & version ) const
+{
+	if (pos < end && _data[ pos ] == 'v')
+		++pos;
+
+	uint16_t parts [4] = { 0, 0, 0, 0 };
+	int numParts = 0;
+	while (numParts < 4)
+	{
+		qint64 digitsBegin = pos;
+		uint value = 0;
+		while (pos < end && isdigit( _data[ pos ] ) && pos - digitsBegin < 5)
+			value = value * 10 + uint( _data[ pos++ ] - '0' );
+		if (pos == digitsBegin || value > 0xFFFF)
+			return false;
+		parts[ numParts++ ] = uint16_t( value );
+
+		if (pos + 1 < end && _data[ pos ] == '.' && isdigit( _data[ pos + 1 ] ))
+			++pos;
+		else
+			break;
+	}
+	if (numParts < 2)
+		return false;
+
+	// "g4.11.3" or "g4.11.3-123-gabcdef" for a development build
+	uchar terminator = pos < end ? _data[ pos ] : '\0';
+	if (mustEndWithNull ? (terminator != '\0' && terminator != '-') : (isalnum( terminator ) || terminator == '.'))
+		return false;
+
+	version = Version( parts[0], parts[1], parts[2], parts[3] );
+	return true;
+}
+
+UncertainExeVersionInfo LoggingBinaryScanner::readVersionInfo()
+{
+	UncertainExeVersionInfo verInfo;
+
+	QString baseName = fs::getFileBasenameFromPath( _filePath ).toLower();
+	const EmbeddedVersionPattern * pattern = nullptr;
+	for (const EmbeddedVersionPattern & p : embeddedVersionPatterns)
+		if (QLatin1String( p.exeBaseName.data(), int( p.exeBaseName.size() ) ) == baseName)
+			pattern = &p;
+	if (!pattern)
+	{
+		verInfo.status = ReadStatus::NotSupported;  // we don't know what to look for
+		return verInfo;
+	}
+
+	QFile file( _filePath );
+	if (!file.open( QIODevice::ReadOnly ))
+	{
+		logRuntimeError().noquote() << "Cannot open \""<<_filePath<<"\": "<<file.errorString();
+		verInfo.status = ReadStatus::CantOpen;
+		return verInfo;
+	}
+
+	QByteArray magic = file.peek( 4 );
+	if (!magic.startsWith( "\x7F" "ELF" ) && magic != QByteArray( "\xCF\xFA\xED\xFE", 4 ) && magic != QByteArray( "\xCA\xFE\xBA\xBE", 4 ))
+	{
+		verInfo.status = ReadStatus::NotSupported;  // not an executable we understand, maybe a script
+		return verInfo;
+	}
+
+	QByteArray fileContent;
+	_data = mapWholeFile( file, fileContent, _size );
+
+	// searching only the read-only data means reading a few MB instead of the whole binary
+	qint64 begin = 0, end = _size;
+	if (!findElfReadOnlyData( begin, end ) && !findMachOStrings( begin, end ))
+	{
+		logDebug() << _filePath << ": read-only data section not found, searching the whole file";
+		begin = 0;
+		end = _size;
+	}
+
+	const bool mustEndWithNull = pattern->prefix.front() == '\0';
+	for (qint64 pos = findBytes( _data, end, begin, pattern->prefix ); pos >= 0; pos = findBytes( _data, end, pos + 1, pattern->prefix ))
+	{
+		if (parseVersionAt( pos + qint64( pattern->prefix.size() ), end, mustEndWithNull, verInfo.version ))
+		{
+			verInfo.appName = pattern->appName;
+			verInfo.status = ReadStatus::Success;
+			return verInfo;
+		}
+	}
+
+	logDebug() << "Version string not found in "<<_filePath;
+	verInfo.status = ReadStatus::InfoNotPresent;
+	return verInfo;
+}
+
+
 //======================================================================================================================
 //  Windows
 
@@ -307,14 +967,27 @@ UncertainExeVersionInfo LoggingExeReader::readVersionInfo()
 //======================================================================================================================
 //  public API
 
-UncertainExeVersionInfo readExeVersionInfo( [[maybe_unused]] const QString & filePath )
+UncertainExeVersionInfo readExeVersionInfo( const QString & filePath )
 {
+	LoggingPeReader peReader( filePath );
+	UncertainExeVersionInfo verInfo = peReader.readVersionInfo();
+
+	if (verInfo.status == ReadStatus::NotSupported)  // not a Windows executable
+	{
+		LoggingBinaryScanner binaryScanner( filePath );
+		verInfo = binaryScanner.readVersionInfo();
+	}
+
  #if IS_WINDOWS
-	LoggingExeReader exeReader( filePath );
-	return exeReader.readVersionInfo();
- #else
-	return { {}, ReadStatus::NotSupported };
+	// the system loader might understand even the weird executables our parser doesn't
+	if (verInfo.status == ReadStatus::InvalidFormat)
+	{
+		LoggingExeReader exeReader( filePath );
+		verInfo = exeReader.readVersionInfo();
+	}
  #endif
+
+	return verInfo;
 }
 
 FileInfoCache< ExeVersionInfo > g_cachedExeInfo( readExeVersionInfo );
@@ -39,6 +39,8 @@ using UncertainExeVersionInfo = UncertainFileInfo< ExeVersionInfo >;
 /// Reads executable version info from the file's built-in resource.
 /** Even if status == Success, not all the fields have to be filled. If the version info resource was found,
   * but some of the expected entries is not present, the corresponding ExeVersionInfo field will remain empty/invalid.
+  * Windows executables are parsed directly without the system loader, so this also works for them on other systems.
+  * Linux and macOS executables of the known engines are searched for the version string the engine embeds in itself.
   * BEWARE that on some systems opening the executable file can take incredibly long, so caching is strongly adviced. */
 UncertainExeVersionInfo readExeVersionInfo( const QString & filePath );
 
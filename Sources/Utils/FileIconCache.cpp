@@ -0,0 +1,243 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: icons of file-system entries provided by the OS, resolved outside of painting
+//======================================================================================================================
+
+#include "FileIconCache.hpp"
+
+#include <QCoreApplication>
+#include <QRunnable>
+#include <QFileInfo>
+#include <QPixmap>
+#include <QDataStream>
+#include <QIODevice>
+
+#include <cstring>  // memcmp
+
+
+//======================================================================================================================
+
+FileIconCache g_fileIconCache;
+
+// File icons are mostly determined by file suffix, so we can cache the icons only for the suffixes to load less
+// icons in total. The only exception is when a file has no suffix on Linux, then the icon can be determined
+// by file header, but those files will not be used as mods, so we can ignore that.
+// Special handling is needed for directories, because they don't have suffixes (usually),
+// but we want to display them differently than files without suffixes.
+static const QString dirIconKey = "<dir>";
+
+static const char FileMagic [] = "DRIC";
+static constexpr quint32 FormatVersion = 1;
+
+// the worker examines the paths in batches, so that a long list doesn't wait until the last entry is examined
+static constexpr int MaxPathsPerBatch = 64;
+
+
+//======================================================================================================================
+
+FileIconCache::FileIconCache() : LoggingComponent("FileIconCache")
+{
+	// one thread is enough, the entries are examined sequentially and most of them are answered from the OS cache
+	_threadPool.setMaxThreadCount( 1 );
+}
+
+FileIconCache::~FileIconCache()
+{
+	_resolvedCallback = {};
+	_threadPool.waitForDone();  // the tasks refer to this object
+}
+
+QString FileIconCache::getIconKey( const QString & path )
+{
+	QFileInfo entryInfo( path );
+	return entryInfo.isDir() ? dirIconKey : entryInfo.suffix().toLower();
+}
+
+QFileIconProvider & FileIconCache::iconProvider()
+{
+	// better construct it only once rather than in every call
+	if (!_iconProvider)
+	{
+		_iconProvider.emplace();
+		_iconProvider->setOptions( QFileIconProvider::DontUseCustomDirectoryIcons );  // custom dir icons might cause freezes
+	}
+	return *_iconProvider;
+}
+
+const QIcon & FileIconCache::getIcon( const QString & path )
+{
+	auto keyIter = _keysByPath.find( path );
+	if (keyIter != _keysByPath.end())
+	{
+		auto iconIter = _iconsByKey.find( keyIter.value() );
+		if (iconIter != _iconsByKey.end())
+			return iconIter.value();
+		return resolveIcon( keyIter.value(), path );  // the icon cache was replaced since the path was examined
+	}
+
+	if (!_pendingPaths.contains( path ))
+	{
+		_pendingPaths.insert( path );
+		_queuedPaths.append( path );
+		if (!_workerRunning)
+			startClassifying();
+	}
+
+	if (!_placeholderIcon)
+	{
+		// the generic icon doesn't depend on any particular file, so it doesn't touch the file system
+		_placeholderIcon = iconProvider().icon( QFileIconProvider::File );
+	}
+	return *_placeholderIcon;
+}
+
+void FileIconCache::setResolvedCallback( QObject * context, ResolvedCallback callback )
+{
+	_callbackContext = context;
+	_resolvedCallback = std::move(callback);
+}
+
+void FileIconCache::startClassifying()
+{
+	class ClassifyTask : public QRunnable {
+		FileIconCache * _owner;
+		QStringList _paths;
+	 public:
+		ClassifyTask( FileIconCache * owner, QStringList && paths ) : _owner( owner ), _paths( std::move(paths) ) {}
+		virtual void run() override
+		{
+			// This is the part that can block for seconds when the files are on a network drive or a sleeping disk.
+			QVector< std::pair< QString, QString > > pathKeys;
+			pathKeys.reserve( _paths.size() );
+			for (QString & path : _paths)
+			{
+				QString iconKey = getIconKey( path );
+				pathKeys.append({ std::move(path), std::move(iconKey) });
+			}
+
+			QCoreApplication * app = QCoreApplication::instance();
+			if (!app)
+				return;
+			QMetaObject::invokeMethod( app, [ owner = _owner, pathKeys = std::move(pathKeys) ]()
+			{
+				owner->onPathsClassified( pathKeys );
+			}, Qt::QueuedConnection );
+		}
+	};
+
+	QStringList batch;
+	if (_queuedPaths.size() <= MaxPathsPerBatch)
+	{
+		batch = std::move( _queuedPaths );
+		_queuedPaths.clear();
+	}
+	else
+	{
+		batch = _queuedPaths.mid( 0, MaxPathsPerBatch );
+		_queuedPaths.erase( _queuedPaths.begin(), _queuedPaths.begin() + MaxPathsPerBatch );
+	}
+
+	_workerRunning = true;
+	_threadPool.start( new ClassifyTask( this, std::move(batch) ) );
+}
+
+void FileIconCache::onPathsClassified( const QVector< std::pair< QString, QString > > & pathKeys )
+{
+	_workerRunning = false;
+
+	QStringList resolvedPaths;
+	resolvedPaths.reserve( pathKeys.size() );
+
+	for (const auto & [path, iconKey] : pathKeys)
+	{
+		_pendingPaths.remove( path );
+		_keysByPath.insert( path, iconKey );
+		if (!_iconsByKey.contains( iconKey ))
+			resolveIcon( iconKey, path );
+		resolvedPaths.append( path );
+	}
+
+	if (!_queuedPaths.isEmpty())
+		startClassifying();
+
+	if (_callbackContext && _resolvedCallback)  // otherwise the requester has been destroyed in the meantime
+		_resolvedCallback( resolvedPaths );
+}
+
+const QIcon & FileIconCache::resolveIcon( const QString & iconKey, const QString & path )
+{
+	// QPixmap can only be created in the main thread, but this happens only once per suffix, and not during painting.
+	QIcon origIcon = iconKey == dirIconKey
+		? iconProvider().icon( QFileIconProvider::Folder )
+		: iconProvider().icon( QFileInfo( path ) );
+
+	// strip the icon from unnecessary high-res variants that slow down the painting process
+	QIcon icon;
+	QList< QSize > availableSizes = origIcon.availableSizes();
+	if (!availableSizes.isEmpty())
+		icon = QIcon( origIcon.pixmap( availableSizes.at(0) ) );
+
+	_dirty = true;
+	return _iconsByKey.insert( iconKey, std::move(icon) ).value();
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  serialization
+
+QByteArray FileIconCache::serialize()
+{
+	QByteArray bytes;
+	QDataStream stream( &bytes, QIODevice::WriteOnly );
+	stream.setVersion( QDataStream::Qt_5_0 );
+
+	stream.writeRawData( FileMagic, sizeof(FileMagic) - 1 );
+	stream << FormatVersion << quint32( _iconsByKey.size() );
+	for (auto it = _iconsByKey.begin(); it != _iconsByKey.end(); ++it)
+	{
+		QList< QSize > availableSizes = it.value().availableSizes();
+		QPixmap pixmap = !availableSizes.isEmpty() ? it.value().pixmap( availableSizes.at(0) ) : QPixmap();
+		stream << it.key() << pixmap;
+	}
+
+	_dirty = false;
+	return bytes;
+}
+
+QString FileIconCache::deserialize( const QByteArray & data )
+{
+	QDataStream stream( data );
+	stream.setVersion( QDataStream::Qt_5_0 );
+
+	char magic [sizeof(FileMagic) - 1];
+	quint32 version = 0, numIcons = 0;
+	if (stream.readRawData( magic, sizeof(magic) ) != int( sizeof(magic) ) || memcmp( magic, FileMagic, sizeof(magic) ) != 0)
+		return "the file is not a valid icon cache";
+	stream >> version;
+	if (version != FormatVersion)
+	{
+		logInfo() << "ignoring icon cache of version " << version << ", the icons will be loaded again";
+		return {};
+	}
+	stream >> numIcons;
+
+	QHash< QString, QIcon > iconsByKey;
+	for (quint32 i = 0; i < numIcons && stream.status() == QDataStream::Ok; ++i)
+	{
+		QString iconKey;
+		QPixmap pixmap;
+		stream >> iconKey >> pixmap;
+		iconsByKey.insert( iconKey, pixmap.isNull() ? QIcon() : QIcon( pixmap ) );
+	}
+	if (stream.status() != QDataStream::Ok)
+		return "the file is truncated or corrupted";
+
+	// the icons resolved before the loading are more up to date
+	for (auto it = _iconsByKey.begin(); it != _iconsByKey.end(); ++it)
+		iconsByKey.insert( it.key(), it.value() );
+	_iconsByKey = std::move( iconsByKey );
+
+	return {};
+}
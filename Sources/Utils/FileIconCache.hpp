@@ -0,0 +1,105 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: icons of file-system entries provided by the OS, resolved outside of painting
+//======================================================================================================================
+
+#ifndef FILE_ICON_CACHE_INCLUDED
+#define FILE_ICON_CACHE_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QIcon>
+#include <QByteArray>
+#include <QPointer>
+#include <QObject>
+#include <QThreadPool>
+#include <QFileIconProvider>
+
+#include <optional>
+#include <functional>
+#include <utility>
+
+
+//======================================================================================================================
+/// Cache of file-system icons that never makes the caller wait for the file system or the OS shell.
+/**
+  * File icons are mostly determined by file suffix, so the icons are cached only for the suffixes, directories share
+  * a single icon. To know which icon belongs to a path, the entry has to be examined, which can block on network drives,
+  * so that is done in a worker thread, while a placeholder is returned. QPixmap can only be used in the main thread,
+  * so the icon of a new suffix is then obtained from QFileIconProvider in the main thread, but only once per suffix,
+  * outside of the painting, and the results are stored into a file, so that the next sessions don't need it at all.
+  *
+  * Must be used only from the main thread.
+  */
+class FileIconCache : protected LoggingComponent {
+
+ public:
+
+	using ResolvedCallback = std::function< void ( const QStringList & paths ) >;
+
+	FileIconCache();
+	~FileIconCache();
+
+	/// Returns the icon of a file-system entry if it's already known, otherwise returns a placeholder
+	/// and resolves the icon in the background.
+	const QIcon & getIcon( const QString & path );
+
+	/// Sets what should be called when icons of some entries, previously returned as placeholders, have been resolved.
+	/** The callback is not called after the context object is destroyed. */
+	void setResolvedCallback( QObject * context, ResolvedCallback callback );
+
+	/// Whether there are icons that haven't been saved yet.
+	bool isDirty() const  { return _dirty; }
+
+	/// To be called when writing the serialized icons failed, so that they are saved again next time.
+	void markAsDirty()  { _dirty = true; }
+
+	/// Encodes the suffix icons into the content of a binary file and marks the cache as saved.
+	QByteArray serialize();
+
+	/// Loads the suffix icons from the content of a binary file.
+	/** Returns description of an error that might potentially happen, or empty string on success.
+	  * Data of a different format version are not an error, they are ignored and the icons will be resolved again. */
+	QString deserialize( const QByteArray & data );
+
+ private:
+
+	void startClassifying();
+	void onPathsClassified( const QVector< std::pair< QString, QString > > & pathKeys );
+	const QIcon & resolveIcon( const QString & iconKey, const QString & path );
+	QFileIconProvider & iconProvider();
+
+	static QString getIconKey( const QString & path );
+
+ private:
+
+	QHash< QString, QString > _keysByPath;  ///< which icon belongs to which path
+	QHash< QString, QIcon > _iconsByKey;    ///< icons by lower-case suffix, or by dirIconKey
+	QStringList _queuedPaths;               ///< waiting for the worker to examine them
+	QSet< QString > _pendingPaths;          ///< either queued or being examined
+	bool _workerRunning = false;
+	bool _dirty = false;
+
+	std::optional< QFileIconProvider > _iconProvider;  ///< constructed only when needed
+	std::optional< QIcon > _placeholderIcon;
+
+	QPointer< QObject > _callbackContext;
+	ResolvedCallback _resolvedCallback;
+
+	QThreadPool _threadPool;
+
+};
+
+extern FileIconCache g_fileIconCache;
+
+
+#endif // FILE_ICON_CACHE_INCLUDED
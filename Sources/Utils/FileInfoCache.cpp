@@ -9,6 +9,10 @@
 
 #include "Utils/ContainerUtils.hpp"
 
+#include <QFile>
+#include <QCryptographicHash>
+#include <QtEndian>
+
 
 static const char * const ReadStatusStrings [] =
 {
@@ -37,3 +41,32 @@ ReadStatus statusFromStr( const QString & statusStr )
 	else
 		return ReadStatus::Uninitialized;
 }
+
+quint64 computeFileFingerprint( const QString & filePath, qint64 fileSize )
+{
+	static constexpr qint64 SampleSize = 64 * 1024;
+
+	QFile file( filePath );
+	if (fileSize < 0 || !file.open( QIODevice::ReadOnly ))
+		return 0;
+
+	QCryptographicHash hash( QCryptographicHash::Md5 );  // not for security, just fast and well distributed
+
+	char sizeBytes [8];
+	qToLittleEndian( fileSize, sizeBytes );
+	hash.addData( sizeBytes, sizeof(sizeBytes) );
+
+	QByteArray head = file.read( SampleSize );
+	hash.addData( head );
+	if (fileSize > SampleSize)
+	{
+		qint64 tailOffset = std::max( fileSize - SampleSize, SampleSize );  // don't hash the same bytes twice
+		if (!file.seek( tailOffset ))
+			return 0;
+		hash.addData( file.read( SampleSize ) );
+	}
+
+	QByteArray digest = hash.result();
+	quint64 fingerprint = qFromLittleEndian< quint64 >( digest.constData() );
+	return fingerprint != 0 ? fingerprint : 1;  // 0 is reserved for "not computed"
+}
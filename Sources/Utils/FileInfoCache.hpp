@@ -13,12 +13,30 @@
 
 #include "Utils/JsonUtils.hpp"
 #include "Utils/FileSystemUtils.hpp"  // isValidFile
+#include "Utils/StringPool.hpp"  // g_pathPool
+#include "Utils/Diagnostics.hpp"  // Counter
 #include "Utils/ErrorHandling.hpp"
+#include "Utils/TimeStats.hpp"
+#include "Utils/TaskGroup.hpp"  // postToMainThread
 
 #include <QString>
 #include <QHash>
+#include <QList>
 #include <QFileInfo>
 #include <QDateTime>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QPointer>
+#include <QVector>
+#include <QPair>
+
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <atomic>
 
 
 //======================================================================================================================
@@ -44,164 +62,669 @@ struct UncertainFileInfo : public FileInfo
 	ReadStatus status = ReadStatus::Uninitialized;
 };
 
+/// Identifies a version of a file, when any of the values changes, the cached info is outdated.
+/** The size is included, because on some file systems the modification time of a file that is replaced shortly after
+  * the previous change stays the same. */
+struct FileStamp
+{
+	qint64 size = -1;
+	qint64 lastModified = 0;  ///< in milliseconds since epoch
+
+	FileStamp() {}
+	FileStamp( qint64 size, qint64 lastModified ) : size( size ), lastModified( lastModified ) {}
+	/// Uses the metadata the QFileInfo already has, if they were retrieved earlier (e.g. during a directory scan).
+	explicit FileStamp( const QFileInfo & file ) : size( file.size() ), lastModified( file.lastModified().toMSecsSinceEpoch() ) {}
+
+	bool operator==( const FileStamp & other ) const  { return size == other.size && lastModified == other.lastModified; }
+	bool operator!=( const FileStamp & other ) const  { return !operator==( other ); }
+};
+
+/// Computes a quick fingerprint of a file's content from its size and the first and last 64 KB.
+/** That covers the headers and directories of the formats we read (the WAD lump directory and the ZIP central directory
+  * are usually at the end) while reading only a fraction of a big file. Returns 0 if the file cannot be read. */
+quint64 computeFileFingerprint( const QString & filePath, qint64 fileSize );
+
+/// Cache of information extracted from files, invalidated when the file's size or modification time changes.
+/**
+  * Thread-safe. The synchronous getFileInfo() reads the file in the calling thread on a cache miss,
+  * the asynchronous requestFileInfo() and prefetchFileInfo() read it in a worker thread.
+  * Concurrent asynchronous requests for the same file are merged into a single read.
+  *
+  * Optionally the entries can also be identified by a fingerprint of the file content. Entries of files that disappeared
+  * are then kept aside, and when a file with the same fingerprint appears under a different path (the library has been
+  * reorganized), its entry is moved there instead of reading the file again. These orphaned entries are saved too,
+  * so that a file moved while the application was closed for a longer time is still recognized, until they expire.
+  *
+  * The number of entries is limited, when the limit is exceeded, the least recently used entries are evicted,
+  * so that the cache file doesn't grow forever as mods are downloaded and deleted over the years.
+  *
+  * The fingerprinted entries can also be shared with other installations of this application, that know the same files
+  * under different paths. Those are looked up by the fingerprint only when the file is not in the cache under its path.
+  */
 template< typename FileInfo >
 class FileInfoCache : public LoggingComponent {
 
+ public:
+
+	using ReadFileInfoFunc = UncertainFileInfo< FileInfo > (*)( const QString & );
+	using Callback = std::function< void ( const UncertainFileInfo< FileInfo > & fileInfo ) >;
+
 	struct Entry
 	{
 		UncertainFileInfo< FileInfo > fileInfo;
-		qint64 lastModified;
+		FileStamp stamp;
+		quint64 fingerprint = 0;  ///< 0 if not computed
+		mutable qint64 lastAccess = 0;  ///< in milliseconds since epoch, 0 if unknown
+		mutable qint64 savedAccess = 0;  ///< lastAccess as it was when the entry was last loaded or saved
 	};
 
-	using ReadFileInfoFunc = UncertainFileInfo< FileInfo > (*)( const QString & );
+	static constexpr int DefaultMaxEntries = 10000;
+
+ private:
+
+	struct OrphanEntry
+	{
+		QString lastPath;  ///< where the file was, the entry is saved under this path and becomes an orphan again when loaded
+		Entry entry;
+	};
+
+	struct PendingCallback
+	{
+		QPointer< QObject > context;
+		Callback callback;
+	};
 
+	/// How many times the worker tries to read a file that could not be opened or read, before it gives up.
+	static constexpr int MaxReadAttempts = 3;
+	static constexpr unsigned long RetryDelayMs = 200;
+	static constexpr int MaxWorkerThreads = 4;
+	/// Access times are only persisted with this precision, otherwise every cache hit would require saving the cache again.
+	static constexpr qint64 AccessTimeResolutionMs = 24 * 60 * 60 * 1000;
+	/// How long the entry of a file that disappeared is kept after it was last used, in case the file turns up elsewhere.
+	static constexpr qint64 OrphanLifetimeMs = 90 * AccessTimeResolutionMs;
+
+	mutable QMutex _mutex;  ///< protects all the members below
 	QHash< QString, Entry > _cache;
-	ReadFileInfoFunc _readFileInfo;
+	QHash< quint64, OrphanEntry > _orphans;  ///< entries of files that no longer exist at their path, key is the fingerprint
+	QHash< quint64, Entry > _shared;  ///< entries known to the other installations, key is the fingerprint, the path is unknown
+	QHash< QString, QList< PendingCallback > > _pendingReads;  ///< files being read in a worker, with who's waiting for them
 	mutable bool _dirty = false;
+	quint64 _generation = 0;  ///< incremented on every change of the entries, so that derived data know when to update
+
+	ReadFileInfoFunc _readFileInfo;
+	bool _useFingerprints;
+	int _maxEntries = DefaultMaxEntries;
+	std::unique_ptr< QThreadPool > _threadPool;  ///< created on the first asynchronous request
+	std::atomic< bool > _shutDown { false };  ///< no more files are read in the workers, read by them without the lock
+
+	// for the diagnostics
+	mutable diag::Counter _hits;     ///< up-to-date entry found
+	mutable diag::Counter _misses;   ///< no entry for the path
+	mutable diag::Counter _rereads;  ///< entry found, but outdated or unusable
 
  public:
 
-	FileInfoCache( ReadFileInfoFunc readFileInfo )
-		: LoggingComponent("FileInfoCache"), _readFileInfo( readFileInfo ) {}
+	FileInfoCache( ReadFileInfoFunc readFileInfo, bool useFingerprints = false, int maxEntries = DefaultMaxEntries )
+		: LoggingComponent("FileInfoCache"), _readFileInfo( readFileInfo ), _useFingerprints( useFingerprints ), _maxEntries( maxEntries ) {}
 
-	/// Reads selected information from a file and stores it into a cache.
-	/** If the file was already read earlier and was not modified since, it returns the cached info. */
-	const UncertainFileInfo< FileInfo > & getFileInfo( const QString & filePath )
+	~FileInfoCache()
 	{
-		auto fileLastModified = QFileInfo( filePath ).lastModified().toSecsSinceEpoch();
+		// Normally it's already done by shutdown(), this is only the last resort, the global caches are destroyed
+		// after the QApplication.
+		if (_threadPool)
+			_threadPool->waitForDone();  // the tasks refer to this object
+	}
 
-		auto cacheIter = _cache.find( filePath );
-		if (cacheIter == _cache.end())
+	/// Drops the queued asynchronous requests and waits for the reads in progress, their callbacks are not called.
+	/** Must be called while the QApplication still exists, the workers post their results to it.
+	  * The synchronous getFileInfo() keeps working, the asynchronous requests are ignored from now on. */
+	void shutdown()
+	{
+		QThreadPool * threadPool;
 		{
-			logDebug() << "entry not found, reading info from file: " << filePath;
-			cacheIter = readFileInfoToCache( filePath, fileLastModified );
+			QMutexLocker lock( &_mutex );
+			_shutDown = true;
+			_pendingReads.clear();
+			threadPool = _threadPool.get();
 		}
-		else if (cacheIter->lastModified != fileLastModified)
+
+		// without the lock, the workers need it to finish
+		if (threadPool)
 		{
-			logDebug() << "entry is outdated, reading info from file: " << filePath;
-			cacheIter = readFileInfoToCache( filePath, fileLastModified );
+			threadPool->clear();
+			threadPool->waitForDone();
 		}
-		else if (cacheIter->fileInfo.status == ReadStatus::CantOpen
-			  || cacheIter->fileInfo.status == ReadStatus::FailedToRead)
+	}
+
+	struct Stats
+	{
+		quint64 hits;
+		quint64 misses;
+		quint64 rereads;
+		int entries;
+	};
+	/// How the cache performed since the start of the application, for the diagnostics.
+	Stats getStats() const
+	{
+		QMutexLocker lock( &_mutex );
+		return { _hits.value(), _misses.value(), _rereads.value(), int( _cache.size() ) };
+	}
+
+	/// Reads selected information from a file and stores it into a cache.
+	/** If the file was already read earlier and was not modified since, it returns the cached info. */
+	UncertainFileInfo< FileInfo > getFileInfo( const QString & filePath )
+	{
+		return getFileInfo( filePath, FileStamp( QFileInfo( filePath ) ) );
+	}
+
+	/// Same as above, but with the current stamp of the file already known by the caller, so that it isn't stat-ed again.
+	UncertainFileInfo< FileInfo > getFileInfo( const QString & filePath, const FileStamp & currentStamp )
+	{
 		{
-			logDebug() << "reading file failed last time, trying again: " << filePath;
-			cacheIter = readFileInfoToCache( filePath, fileLastModified );
+			QMutexLocker lock( &_mutex );
+			if (auto cachedInfo = getUpToDateInfo( filePath, currentStamp ))
+				return *cachedInfo;
 		}
-		else if (cacheIter->fileInfo.status == ReadStatus::Uninitialized)
+
+		// don't hold the lock during reading, reading an executable can take seconds
+		quint64 fingerprint;
+		auto fileInfo = readOrRecoverFileInfo( filePath, currentStamp, fingerprint );
+
+		QMutexLocker lock( &_mutex );
+		storeFileInfo( filePath, currentStamp, fingerprint, fileInfo );
+		return fileInfo;
+	}
+
+	/// Reads selected information from a file in a worker thread and passes it to the callback in the main thread.
+	/** The context must live in the main thread, if it is destroyed before the info is available, the callback is not called.
+	  * Requests for a file that is already being read are merged with the pending one. */
+	void requestFileInfo( const QString & filePath, QObject * context, Callback callback )
+	{
+		QMutexLocker lock( &_mutex );
+
+		if (_shutDown)
+			return;
+
+		auto pendingIter = _pendingReads.find( filePath );
+		if (pendingIter == _pendingReads.end())
 		{
-			logRuntimeError() << "entry is corrupted, reading info from file: " << filePath;
-			cacheIter = readFileInfoToCache( filePath, fileLastModified );
+			pendingIter = _pendingReads.insert( filePath, {} );
+			startWorker( filePath );
 		}
 		else
 		{
-			//logDebug() << "using cached info: " << filePath;
+			logDebug() << "merging request for " << filePath << " with the one in progress";
 		}
 
-		return cacheIter->fileInfo;
+		if (callback)
+			pendingIter->append({ context, std::move(callback) });
+	}
+
+	/// Makes sure the info of this file is in the cache when someone asks for it. Can be called from any thread.
+	void prefetchFileInfo( const QString & filePath )
+	{
+		requestFileInfo( filePath, nullptr, {} );
+	}
+
+	/// Sets how many entries the cache can hold before the least recently used ones are evicted, 0 means unlimited.
+	void setMaxEntries( int maxEntries )
+	{
+		QMutexLocker lock( &_mutex );
+		_maxEntries = maxEntries;
+		evictIfFull();
+	}
+
+	auto size() const
+	{
+		QMutexLocker lock( &_mutex );
+		return _cache.size();
+	}
+
+	/// Returns a number that changes whenever any entry is added, updated or removed.
+	quint64 generation() const
+	{
+		QMutexLocker lock( &_mutex );
+		return _generation;
 	}
 
 	/// Indicates whether the cache has been modified since the last time it was loaded from file or dumped to file.
-	bool isDirty() const  { return _dirty; }
+	bool isDirty() const
+	{
+		QMutexLocker lock( &_mutex );
+		return _dirty;
+	}
 
 	QJsonObject serialize() const
 	{
+		ScopeTimer timer( "serializing file info cache" );
+
 		QJsonObject jsMap;
 
-		for (auto iter = _cache.begin(); iter != _cache.end(); ++iter)
+		auto serializeEntry = [&]( const QString & filePath, const Entry & entry )
 		{
-			// don't save invalid or empty entries
-			if (iter->fileInfo.status == ReadStatus::Uninitialized || iter->fileInfo.status == ReadStatus::NotSupported)
-			{
-				continue;
-			}
-
-			jsMap[ iter.key() ] = serialize( iter.value() );
-		}
+			jsMap[ filePath ] = serialize( entry );
+		};
+		forEachEntry( serializeEntry );
+		forEachOrphan( serializeEntry );
 
-		_dirty = false;
+		markAsSaved();
 
 		return jsMap;
 	}
 
 	void deserialize( const JsonObjectCtx & jsCache )
 	{
-		_dirty = false;
+		ScopeTimer timer( "deserializing file info cache" );
+
+		markAsSaved();
 
 		auto keys = jsCache.keys();
 		for (QString & filePath : keys)
 		{
-			if (!fs::isValidFile( filePath ))
-			{
-				logDebug() << "removing entry, file no longer exists: " << filePath;
-				_dirty = true;
-				continue;
-			}
-
 			JsonObjectCtx jsEntry = jsCache.getObject( filePath );
 			if (!jsEntry)
 			{
 				logRuntimeError() << "removing corrupted entry (invalid JSON type): " << filePath;
+				QMutexLocker lock( &_mutex );
 				_dirty = true;
 				continue;
 			}
 
 			Entry entry;
 			deserialize( jsEntry, entry );
-			if (entry.fileInfo.status == ReadStatus::Uninitialized || entry.lastModified == 0)
+			addLoadedEntry( std::move(filePath), std::move(entry) );
+		}
+	}
+
+	//-- custom storage formats ----------------------------------------------------------------------------------------
+
+	/// Calls visitor( filePath, entry ) for every entry of an existing file worth saving.
+	/** The cache is locked during the whole iteration, so the visitor must not call back into this cache. */
+	template< typename Visitor >
+	void forEachEntry( const Visitor & visitor ) const
+	{
+		QMutexLocker lock( &_mutex );
+
+		for (auto iter = _cache.begin(); iter != _cache.end(); ++iter)
+		{
+			// don't save invalid or empty entries
+			if (iter->fileInfo.status == ReadStatus::Uninitialized || iter->fileInfo.status == ReadStatus::NotSupported)
 			{
-				logRuntimeError() << "removing corrupted entry (vital fields missing): " << filePath;
-				_dirty = true;
 				continue;
 			}
 
-			_cache.insert( std::move(filePath), std::move(entry) );
+			visitor( iter.key(), iter.value() );
+		}
+	}
+
+	/// Calls visitor( lastPath, entry ) for every entry of a file that no longer exists and may yet turn up elsewhere.
+	/** These must be saved together with the others, addLoadedEntry() then puts them back among the orphans.
+	  * The cache is locked during the whole iteration, so the visitor must not call back into this cache. */
+	template< typename Visitor >
+	void forEachOrphan( const Visitor & visitor ) const
+	{
+		QMutexLocker lock( &_mutex );
+
+		for (const OrphanEntry & orphan : _orphans)
+		{
+			if (_cache.contains( orphan.lastPath ))  // a different file has been created at its path since
+				continue;
+
+			visitor( orphan.lastPath, orphan.entry );
+		}
+	}
+
+	/// Inserts an entry loaded from a storage format, entries of files that no longer exist become orphans or are dropped.
+	void addLoadedEntry( QString filePath, Entry && entry )
+	{
+		if (entry.fileInfo.status == ReadStatus::Uninitialized || entry.stamp.lastModified == 0)
+		{
+			logRuntimeError() << "removing corrupted entry (vital fields missing): " << filePath;
+			QMutexLocker lock( &_mutex );
+			_dirty = true;
+			return;
+		}
+		if (entry.lastAccess == 0)  // saved by an older version, give it the full lifetime
+		{
+			entry.lastAccess = QDateTime::currentMSecsSinceEpoch();
+		}
+		entry.savedAccess = entry.lastAccess;
+
+		bool fileExists = fs::isValidFile( filePath );
+
+		QMutexLocker lock( &_mutex );
+
+		if (!fileExists)
+		{
+			if (_useFingerprints && entry.fingerprint != 0
+			 && QDateTime::currentMSecsSinceEpoch() - entry.lastAccess < OrphanLifetimeMs)
+			{
+				// it's saved again as it is, so if it was already an orphan last time, the cache is not modified
+				logDebug() << "file no longer exists, keeping the entry in case it was moved: " << filePath;
+				_orphans.insert( entry.fingerprint, { std::move(filePath), std::move(entry) } );
+			}
+			else
+			{
+				logDebug() << "removing entry, file no longer exists: " << filePath;
+				_dirty = true;
+			}
+			return;
+		}
+
+		_cache.insert( g_pathPool.intern( filePath ), std::move(entry) );
+		++_generation;
+		evictIfFull();
+	}
+
+	/// To be called after the entries have been saved or loaded using a custom storage format.
+	void markAsSaved() const
+	{
+		QMutexLocker lock( &_mutex );
+		_dirty = false;
+		for (const Entry & entry : _cache)
+			entry.savedAccess = entry.lastAccess;
+	}
+
+	/// To be called when writing the serialized entries failed, so that they are saved again next time.
+	void markAsDirty() const
+	{
+		QMutexLocker lock( &_mutex );
+		_dirty = true;
+	}
+
+	//-- sharing with other installations ------------------------------------------------------------------------------
+
+	/// Adds an entry that another installation read, it will be used when a file with the same fingerprint is requested.
+	/** Only the file info, the size and the fingerprint of the entry are needed. */
+	void addSharedEntry( Entry && entry )
+	{
+		if (!_useFingerprints || entry.fingerprint == 0 || !isShareable( entry.fileInfo.status ))
+			return;
+
+		QMutexLocker lock( &_mutex );
+		_shared.insert( entry.fingerprint, std::move(entry) );
+	}
+
+	/// Calls visitor( entry ) for every fingerprinted entry that the other installations don't know yet.
+	/** The entries become known to them only after they're successfully written and added using addSharedEntry().
+	  * The cache is locked during the whole iteration, so the visitor must not call back into this cache. */
+	template< typename Visitor >
+	void forEachUnsharedEntry( const Visitor & visitor )
+	{
+		QMutexLocker lock( &_mutex );
+
+		for (auto iter = _cache.begin(); iter != _cache.end(); ++iter)
+		{
+			const Entry & entry = iter.value();
+			if (entry.fingerprint == 0 || !isShareable( entry.fileInfo.status ))
+				continue;
+
+			auto sharedIter = _shared.find( entry.fingerprint );
+			if (sharedIter != _shared.end() && sharedIter->stamp.size == entry.stamp.size)
+				continue;
+
+			visitor( entry );
 		}
 	}
 
  private:
 
-	auto readFileInfoToCache( const QString & filePath, qint64 fileModifiedTimestamp )
+	static bool isReadFailure( ReadStatus status )
 	{
-		Entry newEntry;
+		return status == ReadStatus::CantOpen || status == ReadStatus::FailedToRead;
+	}
+
+	/// Whether the status says something about the file content, and not about this installation or this moment.
+	static bool isShareable( ReadStatus status )
+	{
+		return status == ReadStatus::Success || status == ReadStatus::InvalidFormat || status == ReadStatus::InfoNotPresent;
+	}
+
+	/// Must be called with the mutex locked.
+	const UncertainFileInfo< FileInfo > * getUpToDateInfo( const QString & filePath, const FileStamp & currentStamp ) const
+	{
+		auto cacheIter = _cache.find( filePath );
+		if (cacheIter == _cache.end())
+		{
+			logDebug() << "entry not found, reading info from file: " << filePath;
+			_misses.increment();
+			return nullptr;
+		}
+		else if (cacheIter->stamp != currentStamp)
+		{
+			logDebug() << "entry is outdated, reading info from file: " << filePath;
+			_rereads.increment();
+			return nullptr;
+		}
+		else if (isReadFailure( cacheIter->fileInfo.status ))
+		{
+			logDebug() << "reading file failed last time, trying again: " << filePath;
+			_rereads.increment();
+			return nullptr;
+		}
+		else if (cacheIter->fileInfo.status == ReadStatus::Uninitialized)
+		{
+			logRuntimeError() << "entry is corrupted, reading info from file: " << filePath;
+			_rereads.increment();
+			return nullptr;
+		}
+		else
+		{
+			//logDebug() << "using cached info: " << filePath;
+			_hits.increment();
+			touch( *cacheIter );
+			return &cacheIter->fileInfo;
+		}
+	}
 
-		newEntry.fileInfo = _readFileInfo( filePath );
-		newEntry.lastModified = fileModifiedTimestamp;
+	/// Reads the file, unless it's a file that was moved from a different path and its entry can be re-used.
+	/** Must be called with the mutex unlocked. */
+	UncertainFileInfo< FileInfo > readOrRecoverFileInfo( const QString & filePath, const FileStamp & currentStamp, quint64 & fingerprint )
+	{
+		fingerprint = 0;
+		if (!_useFingerprints)
+			return _readFileInfo( filePath );
 
-		if (newEntry.fileInfo.status == ReadStatus::CantOpen)
+		bool canRecover;
+		{
+			QMutexLocker lock( &_mutex );
+			canRecover = !_orphans.isEmpty() || !_shared.isEmpty();
+		}
+		if (!canRecover)
+		{
+			// There is nothing to match the fingerprint against, so it's needed only for the new entry, in case the file
+			// is moved later. Files that couldn't be read or aren't supported have nothing worth recognizing.
+			auto fileInfo = _readFileInfo( filePath );
+			if (isShareable( fileInfo.status ))
+				fingerprint = computeFileFingerprint( filePath, currentStamp.size );
+			return fileInfo;
+		}
+
+		fingerprint = computeFileFingerprint( filePath, currentStamp.size );
+		if (fingerprint != 0)
+		{
+			QMutexLocker lock( &_mutex );
+			auto orphanIter = _orphans.find( fingerprint );
+			if (orphanIter != _orphans.end() && orphanIter->entry.stamp.size == currentStamp.size)
+			{
+				logDebug() << "recognized a moved file, re-using its entry: " << filePath;
+				UncertainFileInfo< FileInfo > fileInfo = std::move(orphanIter->entry.fileInfo);
+				_orphans.erase( orphanIter );
+				return fileInfo;
+			}
+			auto sharedIter = _shared.find( fingerprint );
+			if (sharedIter != _shared.end() && sharedIter->stamp.size == currentStamp.size)
+			{
+				logDebug() << "another installation already read this file, re-using its entry: " << filePath;
+				return sharedIter->fileInfo;
+			}
+		}
+
+		return _readFileInfo( filePath );
+	}
+
+	/// Must be called with the mutex locked.
+	void storeFileInfo( const QString & filePath, const FileStamp & stamp, quint64 fingerprint, const UncertainFileInfo< FileInfo > & fileInfo )
+	{
+		if (fileInfo.status == ReadStatus::CantOpen)
 		{
 			logDebug() << "couldn't open file: " << filePath;
 		}
-		else if (newEntry.fileInfo.status == ReadStatus::FailedToRead)
+		else if (fileInfo.status == ReadStatus::FailedToRead)
 		{
 			logDebug() << "failed to read file: " << filePath;
 		}
-		else if (newEntry.fileInfo.status == ReadStatus::NotSupported)
+		else if (fileInfo.status == ReadStatus::NotSupported)
 		{
 			//logDebug() << "file info not implemented: " << filePath;
 		}
 
+		Entry newEntry;
+		newEntry.fileInfo = fileInfo;
+		newEntry.stamp = stamp;
+		newEntry.fingerprint = fingerprint;
+		newEntry.lastAccess = QDateTime::currentMSecsSinceEpoch();
+
 		_dirty = true;
-		return _cache.insert( filePath, std::move(newEntry) );
+		_cache.insert( g_pathPool.intern( filePath ), std::move(newEntry) );  // the same paths are stored in the user data
+		++_generation;
+		evictIfFull();
+	}
+
+	/// Must be called with the mutex locked.
+	void touch( const Entry & entry ) const
+	{
+		// compared to what is in the file, an entry used every hour would otherwise never get saved
+		qint64 now = QDateTime::currentMSecsSinceEpoch();
+		if (now - entry.savedAccess >= AccessTimeResolutionMs)
+			_dirty = true;
+		entry.lastAccess = now;
 	}
 
-	static QJsonObject serialize( const Entry & cacheEntry )
+	/// Must be called with the mutex locked.
+	void evictIfFull()
+	{
+		if (_maxEntries <= 0 || _cache.size() <= _maxEntries)
+			return;
+
+		// Evict a bit more than necessary, so that the cache isn't scanned again on every following insertion.
+		int numToEvict = _cache.size() - (_maxEntries - _maxEntries / 10);
+
+		QVector< QPair< qint64, QString > > byAccess;
+		byAccess.reserve( _cache.size() );
+		for (auto iter = _cache.begin(); iter != _cache.end(); ++iter)
+			byAccess.append({ iter->lastAccess, iter.key() });
+		std::nth_element( byAccess.begin(), byAccess.begin() + numToEvict, byAccess.end() );
+
+		logDebug() << "cache is full, evicting " << numToEvict << " least recently used entries";
+		for (int i = 0; i < numToEvict; ++i)
+			_cache.remove( byAccess[i].second );
+		_dirty = true;
+		++_generation;
+	}
+
+	/// Must be called with the mutex locked.
+	void startWorker( const QString & filePath )
+	{
+		if (!_threadPool)
+		{
+			_threadPool = std::make_unique< QThreadPool >();
+			_threadPool->setMaxThreadCount( std::min( QThread::idealThreadCount(), MaxWorkerThreads ) );
+		}
+
+		_threadPool->start( makeRunnable( [ this, filePath ]()
+		{
+			readFileInfoInWorker( filePath );
+		}));
+	}
+
+	template< typename Func >
+	static QRunnable * makeRunnable( Func && func )
+	{
+		// QRunnable::create() is only available since Qt 5.15
+		class FuncRunnable : public QRunnable {
+			Func _func;
+		 public:
+			FuncRunnable( Func && func ) : _func( std::move(func) ) {}
+			virtual void run() override  { _func(); }
+		};
+		return new FuncRunnable( std::move(func) );
+	}
+
+	void readFileInfoInWorker( const QString & filePath )
+	{
+		UncertainFileInfo< FileInfo > fileInfo;
+		FileStamp currentStamp;
+
+		for (int attempt = 1; attempt <= MaxReadAttempts; ++attempt)
+		{
+			if (_shutDown)  // nobody will use the result, and reading a big file would delay the exit
+				return;
+
+			currentStamp = FileStamp( QFileInfo( filePath ) );
+			{
+				QMutexLocker lock( &_mutex );
+				if (auto cachedInfo = getUpToDateInfo( filePath, currentStamp ))
+				{
+					fileInfo = *cachedInfo;
+					break;
+				}
+			}
+
+			quint64 fingerprint;
+			fileInfo = readOrRecoverFileInfo( filePath, currentStamp, fingerprint );
+
+			// the file might be temporarily locked by another process or on a network drive that has just woken up
+			if (!isReadFailure( fileInfo.status ) || attempt == MaxReadAttempts)
+			{
+				QMutexLocker lock( &_mutex );
+				storeFileInfo( filePath, currentStamp, fingerprint, fileInfo );
+				break;
+			}
+			QThread::msleep( RetryDelayMs );
+		}
+
+		QList< PendingCallback > callbacks;
+		{
+			QMutexLocker lock( &_mutex );
+			callbacks = _pendingReads.take( filePath );
+		}
+
+		for (PendingCallback & pending : callbacks)
+		{
+			postToMainThread( std::move(pending.context), [ callback = std::move(pending.callback), fileInfo ]()
+			{
+				callback( fileInfo );
+			});
+		}
+	}
+
+	static QJsonObject serialize( const Entry & entry )
 	{
 		QJsonObject jsFileInfo;
 
-		jsFileInfo["status"] = statusToStr( cacheEntry.fileInfo.status );
-		jsFileInfo["last_modified"] = cacheEntry.lastModified;
+		jsFileInfo["status"] = statusToStr( entry.fileInfo.status );
+		jsFileInfo["last_modified"] = entry.stamp.lastModified;
+		jsFileInfo["size"] = entry.stamp.size;
+		if (entry.fingerprint != 0)
+			jsFileInfo["fingerprint"] = QString::number( entry.fingerprint, 16 );  // JSON numbers can't hold 64-bit integers
+		jsFileInfo["last_access"] = entry.lastAccess;
 
-		cacheEntry.fileInfo.serialize( jsFileInfo );
+		entry.fileInfo.serialize( jsFileInfo );
 
 		return jsFileInfo;
 	}
 
-	static void deserialize( const JsonObjectCtx & jsFileInfo, Entry & cacheEntry )
+	static void deserialize( const JsonObjectCtx & jsFileInfo, Entry & entry )
 	{
-		cacheEntry.fileInfo.status = statusFromStr( jsFileInfo.getString( "status" ) );
-		cacheEntry.lastModified = jsFileInfo.getInt( "last_modified", 0 );
-
-		cacheEntry.fileInfo.deserialize( jsFileInfo );
+		entry.fileInfo.status = statusFromStr( jsFileInfo.getString( "status" ) );
+		// Older versions stored the time in seconds and no size, such entries will simply be considered outdated.
+		entry.stamp.lastModified = jsFileInfo.getInt64( "last_modified", 0 );
+		entry.stamp.size = jsFileInfo.getInt64( "size", -1, DontShowError );
+		entry.fingerprint = jsFileInfo.getString( "fingerprint", {}, DontShowError ).toULongLong( nullptr, 16 );
+		entry.lastAccess = jsFileInfo.getInt64( "last_access", 0, DontShowError );
+
+		entry.fileInfo.deserialize( jsFileInfo );
 	}
 
 };
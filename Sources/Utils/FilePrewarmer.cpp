@@ -0,0 +1,184 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: loading files into the system's page cache in advance
+//======================================================================================================================
+
+#include "FilePrewarmer.hpp"
+
+#include <QFile>
+#include <QByteArray>
+#include <QThread>
+#include <QRunnable>
+
+#include <algorithm>
+
+#if !IS_WINDOWS
+	#include <fcntl.h>  // posix_fadvise
+#endif
+
+#if !IS_WINDOWS && defined(POSIX_FADV_WILLNEED)  // MacOS doesn't have it
+	#define HAS_FADVISE true
+#else
+	#define HAS_FADVISE false
+#endif
+
+
+//======================================================================================================================
+
+static constexpr qint64 ChunkSize = 4 * 1024 * 1024;
+static constexpr unsigned long PauseBetweenChunksMs = 5;
+/// bigger amount would just push other useful data out of the cache, the engine will read the rest itself
+static constexpr qint64 MaxBytesPerRequest = 1024 * 1024 * 1024;
+
+FilePrewarmer::FilePrewarmer() : LoggingComponent("FilePrewarmer")
+{
+	_threadPool.setMaxThreadCount( 1 );  // reading several files at once would only make the drive seek back and forth
+}
+
+FilePrewarmer::~FilePrewarmer()
+{
+	cancelAll();
+	_threadPool.waitForDone();  // the task refers to this object
+}
+
+void FilePrewarmer::prewarmFiles( QStringVec filePaths )
+{
+	class PrewarmTask : public QRunnable {
+		FilePrewarmer * _owner;
+	 public:
+		PrewarmTask( FilePrewarmer * owner ) : _owner( owner ) {}
+		virtual void run() override
+		{
+			_owner->prewarmPendingFiles();
+		}
+	};
+
+	QMutexLocker lock( &_mutex );
+
+	if (filePaths == _lastRequest)
+		return;
+
+	_lastRequest = filePaths;
+	_pendingFiles = std::move(filePaths);
+	_requestID++;
+
+	// the running worker will pick it up after the current chunk
+	if (!_workerRunning && !_pendingFiles.isEmpty())
+	{
+		_workerRunning = true;
+		_threadPool.start( new PrewarmTask( this ) );
+	}
+}
+
+void FilePrewarmer::cancelAll()
+{
+	QMutexLocker lock( &_mutex );
+
+	_pendingFiles.clear();
+	_lastRequest.clear();  // the cancelled files might not have been read, so allow requesting them again
+	_requestID++;
+}
+
+bool FilePrewarmer::isCancelled( int requestID )
+{
+	QMutexLocker lock( &_mutex );
+	return requestID != _requestID;
+}
+
+void FilePrewarmer::prewarmPendingFiles()
+{
+	// the priority argument of QThreadPool::start() only orders the queue, it doesn't affect the thread
+	QThread::currentThread()->setPriority( QThread::LowestPriority );
+
+	int requestID = 0;
+	qint64 bytesLeft = 0;
+
+	while (true)
+	{
+		QString filePath;
+		{
+			QMutexLocker lock( &_mutex );
+
+			if (_pendingFiles.isEmpty())
+			{
+				_workerRunning = false;
+				return;
+			}
+
+			if (requestID != _requestID)  // new request, new budget
+			{
+				requestID = _requestID;
+				bytesLeft = MaxBytesPerRequest;
+			}
+
+			filePath = _pendingFiles.takeFirst();
+		}
+
+		if (!prewarmFile( filePath, requestID, bytesLeft ))
+		{
+			QMutexLocker lock( &_mutex );
+			if (requestID == _requestID)  // out of budget, skip the rest of this request
+				_pendingFiles.clear();
+		}
+	}
+}
+
+bool FilePrewarmer::prewarmFile( const QString & filePath, int requestID, qint64 & bytesLeft )
+{
+	QFile file( filePath );
+	if (!file.open( QIODevice::ReadOnly ))
+	{
+		logDebug() << "cannot open " << filePath << ": " << file.errorString();
+		return true;  // it's just an optimization, the engine will report the missing file
+	}
+
+	qint64 fileSize = file.size();
+	qint64 offset = 0;
+
+ #if !HAS_FADVISE
+	QByteArray buffer( int( ChunkSize ), Qt::Uninitialized );
+ #endif
+
+	while (offset < fileSize)
+	{
+		if (bytesLeft <= 0)
+		{
+			logDebug() << "budget exhausted at " << filePath;
+			return false;
+		}
+		if (isCancelled( requestID ))
+		{
+			return true;
+		}
+
+		qint64 length = std::min( { ChunkSize, fileSize - offset, bytesLeft } );
+
+	 #if HAS_FADVISE
+		// only hints the kernel to read the chunk, but it's not free, so it also needs to be throttled
+		int status = posix_fadvise( file.handle(), off_t( offset ), off_t( length ), POSIX_FADV_WILLNEED );
+		if (status != 0)
+		{
+			logDebug() << "posix_fadvise failed on " << filePath << " with code " << status;
+			return true;
+		}
+	 #else
+		qint64 bytesRead = file.read( buffer.data(), length );
+		if (bytesRead <= 0)
+		{
+			logDebug() << "cannot read " << filePath << ": " << file.errorString();
+			return true;
+		}
+		length = bytesRead;
+	 #endif
+
+		offset += length;
+		bytesLeft -= length;
+
+		QThread::msleep( PauseBetweenChunksMs );
+	}
+
+	logDebug() << "prewarmed " << filePath;
+	return true;
+}
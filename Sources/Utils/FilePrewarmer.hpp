@@ -0,0 +1,65 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: loading files into the system's page cache in advance
+//======================================================================================================================
+
+#ifndef FILE_PREWARMER_INCLUDED
+#define FILE_PREWARMER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "CommonTypes.hpp"
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QString>
+#include <QMutex>
+#include <QThreadPool>
+
+
+//======================================================================================================================
+/// Reads files in a low-priority background thread, so that they are already in the system's page cache when the engine
+/// opens them. This makes the engine start noticeably faster when the files are big and lie on a slow or network drive.
+/**
+  * On Linux the kernel is asked to read the files ahead using posix_fadvise(), elsewhere the files are simply read
+  * and the data thrown away. Either way the reading is done in chunks with short pauses between them, so that it
+  * doesn't saturate the drive the user might be working with.
+  *
+  * Only the latest request matters, a new request cancels the files of the previous one that have not been read yet.
+  *
+  * Must be used from the main thread. The destructor cancels the reading and waits until the worker finishes.
+  */
+class FilePrewarmer : protected LoggingComponent {
+
+ public:
+
+	FilePrewarmer();
+	~FilePrewarmer();
+
+	/// Schedules reading the files, replacing the files of the previous request.
+	/** Requesting the same files again does nothing, they would already be in the cache. The paths must be absolute. */
+	void prewarmFiles( QStringVec filePaths );
+
+	/// Stops reading the scheduled files as soon as possible.
+	void cancelAll();
+
+ private:
+
+	void prewarmPendingFiles();
+	bool prewarmFile( const QString & filePath, int requestID, qint64 & bytesLeft );
+	bool isCancelled( int requestID );
+
+	QMutex _mutex;  ///< protects the members below
+	QStringVec _pendingFiles;  ///< files of the latest request that have not been read yet
+	QStringVec _lastRequest;   ///< to recognize a repeated request
+	int _requestID = 0;        ///< increased with every request, so that the worker knows the current one was replaced
+	bool _workerRunning = false;
+
+	QThreadPool _threadPool;
+
+};
+
+
+#endif // FILE_PREWARMER_INCLUDED
@@ -90,6 +90,76 @@ QString updateFileSafely( const QString & filePath, const QByteArray & newConten
 	return {};
 }
 
+bool isLexicallyClean( const QString & path )
+{
+	const int len = path.size();
+	if (len == 0 || path[ len - 1 ] == '/')
+		return false;
+
+	int compStart = 0;
+	for (int i = 0; i <= len; ++i)
+	{
+		if (i < len && path[i] != '/')
+		{
+			if (path[i] == '\\')  // QDir would normalize it on Windows
+				return false;
+			continue;
+		}
+
+		int compLen = i - compStart;
+		if (compLen == 0 && i != 0)  // the leading slash of a Unix absolute path is the only allowed empty component
+			return false;
+		if (compLen == 1 && path[ compStart ] == '.')
+			return false;
+		if (compLen == 2 && path[ compStart ] == '.' && path[ compStart + 1 ] == '.')
+			return false;
+		compStart = i + 1;
+	}
+
+	return true;
+}
+
+/// Relative path that can be simply appended to a base directory.
+static bool isPlainRelativePath( const QString & path )
+{
+	// on Windows "C:file" is relative to the current dir of drive C, only QDir knows what to do with that
+	return isRelativePath( path ) && !path.contains(':') && isLexicallyClean( path );
+}
+
+QString getAbsolutePathLexically( const QString & baseAbsPath, const QString & path )
+{
+	if (isAbsolutePath( path ))
+	{
+		return isLexicallyClean( path ) ? path : QString();
+	}
+	if (isPlainRelativePath( path ))
+	{
+		if (baseAbsPath.endsWith('/'))  // root dir
+			return baseAbsPath % path;
+		else
+			return baseAbsPath % '/' % path;
+	}
+	return {};
+}
+
+QString getRelativePathLexically( const QString & baseAbsPath, const QString & path )
+{
+	if (isPlainRelativePath( path ))
+	{
+		return path;
+	}
+
+	// Only the paths inside the base dir are simple, the rest needs to go up using "..".
+	// Compared case-sensitively even on Windows, a mismatch just falls back to QDir.
+	int prefixLen = baseAbsPath.endsWith('/') ? baseAbsPath.size() : baseAbsPath.size() + 1;
+	if (isAbsolutePath( path ) && path.size() > prefixLen && path.startsWith( baseAbsPath )
+	 && path[ prefixLen - 1 ] == '/' && isLexicallyClean( path ))
+	{
+		return path.mid( prefixLen );
+	}
+	return {};
+}
+
 void traverseDirectory(
 	const QString & dir, bool recursively, EntryTypes typesToVisit,
 	const PathConvertor & pathConvertor, const std::function< void ( const QFileInfo & entry ) > & visitEntry
@@ -128,3 +198,88 @@ void traverseDirectory(
 
 
 } // namespace fs
+
+
+//======================================================================================================================
+//  PathConvertor and PathRebaser
+
+// Every list update converts the same paths again and again, in most cases to the same form they already are in.
+// The memory is cleared when it gets too big, which can happen only when the directories contain a huge number of files.
+static constexpr int MaxRememberedPaths = 4096;
+
+template< typename Func >
+static QString rememberResult( QHash< QString, QString > & memory, const QString & path, const Func & resolvePath )
+{
+	auto iter = memory.constFind( path );
+	if (iter != memory.constEnd())
+		return iter.value();
+
+	QString result = resolvePath();
+	if (memory.size() >= MaxRememberedPaths)
+		memory.clear();
+	memory.insert( path, result );
+	return result;
+}
+
+QString PathConvertor::getAbsolutePath( const QString & path ) const
+{
+	if (path.isEmpty())
+		return {};
+
+	QString absPath = fs::getAbsolutePathLexically( _workingDirAbsPath, path );
+	return !absPath.isNull() ? absPath : QFileInfo( _workingDir, path ).absoluteFilePath();
+}
+
+QString PathConvertor::getRelativePath( const QString & path ) const
+{
+	if (path.isEmpty())
+		return {};
+
+	QString relPath = fs::getRelativePathLexically( _workingDirAbsPath, path );
+	return !relPath.isNull() ? relPath : _workingDir.relativeFilePath( path );
+}
+
+QString PathConvertor::convertPath( const QString & path ) const
+{
+	if (path.isEmpty())
+		return {};
+
+	// Most of the paths are already in the right form, don't fill the memory with those.
+	QString converted = usingAbsolutePaths()
+		? fs::getAbsolutePathLexically( _workingDirAbsPath, path )
+		: fs::getRelativePathLexically( _workingDirAbsPath, path );
+	if (!converted.isNull())
+		return converted;
+
+	return rememberResult( _convertedPaths, path, [&]()
+	{
+		return usingAbsolutePaths()
+			? QFileInfo( _workingDir, path ).absoluteFilePath()
+			: _workingDir.relativeFilePath( path );
+	});
+}
+
+QString PathRebaser::rebasePathFromTo(
+	const QString & path, const QDir & inputBaseDir, const QString & inputBaseAbsPath,
+	const QDir & outputBaseDir, const QString & outputBaseAbsPath, QHash< QString, QString > & memory
+) const {
+	if (path.isEmpty())
+		return {};
+
+	QString absPath = fs::isAbsolutePath( path ) ? path : fs::getAbsolutePathLexically( inputBaseAbsPath, path );
+	if (!absPath.isNull())
+	{
+		if (outputAbsolutePaths())
+			return absPath;
+
+		QString relPath = fs::getRelativePathLexically( outputBaseAbsPath, absPath );
+		if (!relPath.isNull())
+			return relPath;
+	}
+
+	return rememberResult( memory, path, [&]()
+	{
+		QString absPath = fs::isAbsolutePath( path ) ? path : inputBaseDir.absoluteFilePath( path );
+		return outputAbsolutePaths() ? absPath : outputBaseDir.relativeFilePath( absPath );
+	});
+}
@@ -11,11 +11,14 @@
 
 #include "Essential.hpp"
 
+#include "CommonTypes.hpp"  // QStringVec
+
 #include <QString>
 #include <QStringBuilder>
 #include <QByteArray>
 #include <QDir>
 #include <QFileInfo>
+#include <QHash>
 
 class QModelIndex;
 class PathConvertor;
@@ -141,6 +144,20 @@ inline QString getDirnameOfFile( const QString & filePath )
 	return QFileInfo( filePath ).dir().dirName();
 }
 
+/// Checks whether a file name or path ends with one of the suffixes, without the need to construct QFileInfo.
+/** The comparison is case-insensitive and the suffixes are expected without the dot, the same as QFileInfo::suffix(). */
+inline bool hasOneOfSuffixes( const QString & filePath, const QStringVec & suffixes )
+{
+	int dotPos = filePath.lastIndexOf('.');
+	if (dotPos < 0 || filePath.indexOf('/', dotPos) >= 0)  // the dot must be in the file name, not in a directory name
+		return false;
+	int suffixLen = filePath.size() - dotPos - 1;
+	for (const QString & suffix : suffixes)
+		if (suffix.size() == suffixLen && filePath.endsWith( suffix, Qt::CaseInsensitive ))
+			return true;
+	return false;
+}
+
 inline QString replaceFileSuffix( const QString & filePath, const QString & newSuffix )
 {
 	QFileInfo fileInfo( filePath );
@@ -153,6 +170,19 @@ inline bool isInsideDir( const QString & entryPath, const QDir & dir )
 	return QFileInfo( entryPath ).absoluteFilePath().startsWith( dir.absolutePath() );
 }
 
+/// Whether the path consists only of plain names separated by '/', so that QDir would not have anything to resolve in it.
+/** That means no "." or ".." components, no empty components, no trailing separator and no backslashes. */
+bool isLexicallyClean( const QString & path );
+
+/// Fast variant of QDir( baseDir ).absoluteFilePath( path ), which works only with strings.
+/** The baseAbsPath must be an absolute and clean path. Returns null string if the path would need QDir to be resolved. */
+QString getAbsolutePathLexically( const QString & baseAbsPath, const QString & path );
+
+/// Fast variant of QDir( baseDir ).relativeFilePath( path ), which works only with strings.
+/** The baseAbsPath must be an absolute and clean path. Returns null string if the path would need QDir to be resolved,
+  * which is also the case when the path is outside of the base directory. */
+QString getRelativePathLexically( const QString & baseAbsPath, const QString & path );
+
 /// Creates directory if it doesn't exist already, returns false if it doesn't exist and cannot be created.
 inline bool createDirIfDoesntExist( const QString & dirPath )
 {
@@ -214,11 +244,13 @@ class PathConvertor {
 
 	QDir _workingDir;  ///< directory which relative paths are relative to
 	PathStyle _pathStyle;  ///< whether to store paths to engines, IWADs, maps and mods in absolute or relative form
+	QString _workingDirAbsPath;  ///< absolute clean path of _workingDir for the lexical conversions
+	mutable QHash< QString, QString > _convertedPaths;  ///< results of convertPath() that had to be resolved by QDir
 
  public:
 
 	PathConvertor( const QDir & workingDir, PathStyle pathStyle )
-		: _workingDir( workingDir ), _pathStyle( pathStyle ) {}
+		: _workingDir( workingDir ), _pathStyle( pathStyle ), _workingDirAbsPath( getCleanAbsPath( workingDir ) ) {}
 
 	PathConvertor( const QDir & baseDir, bool useAbsolutePaths )
 		: PathConvertor( baseDir, useAbsolutePaths ? PathStyle::Absolute : PathStyle::Relative ) {}
@@ -233,27 +265,40 @@ class PathConvertor {
 	bool usingAbsolutePaths() const                    { return _pathStyle == PathStyle::Absolute; }
 	bool usingRelativePaths() const                    { return _pathStyle == PathStyle::Relative; }
 
-	void setWorkingDir( const QDir & workingDir )      { _workingDir = workingDir; }
-	void setPathStyle( PathStyle pathStyle )           { _pathStyle = pathStyle; }
-	void toggleAbsolutePaths( bool useAbsolutePaths )  { _pathStyle = useAbsolutePaths ? PathStyle::Absolute : PathStyle::Relative; }
-
-	QString getAbsolutePath( const QString & path ) const
+	void setWorkingDir( const QDir & workingDir )
 	{
-		return path.isEmpty() ? QString() : QFileInfo( _workingDir, path ).absoluteFilePath();
+		_workingDir = workingDir;
+		_workingDirAbsPath = getCleanAbsPath( workingDir );
+		_convertedPaths.clear();
 	}
-	QString getRelativePath( const QString & path ) const
+	void setPathStyle( PathStyle pathStyle )
 	{
-		return path.isEmpty() ? QString() : _workingDir.relativeFilePath( path );
+		_pathStyle = pathStyle;
+		_convertedPaths.clear();
 	}
-	QString convertPath( const QString & path ) const
+	void toggleAbsolutePaths( bool useAbsolutePaths )
 	{
-		return usingAbsolutePaths() ? getAbsolutePath( path ) : getRelativePath( path );
+		setPathStyle( useAbsolutePaths ? PathStyle::Absolute : PathStyle::Relative );
 	}
 
+	QString getAbsolutePath( const QString & path ) const;
+	QString getRelativePath( const QString & path ) const;
+
+	/// Converts the path to the configured path style.
+	/** The paths that are already in the right form are recognized by simple string operations. The rest is resolved
+	  * by QDir, which is expensive, so the results are remembered. Because of that, an instance must not be used
+	  * from multiple threads at once, each thread should have its own copy. */
+	QString convertPath( const QString & path ) const;
+
+ private:
+
+	static QString getCleanAbsPath( const QDir & dir )  { return QDir::cleanPath( dir.absolutePath() ); }
+
 };
 
 
-/** Helper that allows rebasing path from one baseDir to another. */
+/** Helper that allows rebasing path from one baseDir to another.
+  * The same as in PathConvertor, the results that needed QDir are remembered, so an instance must not be shared between threads. */
 class PathRebaser {
 
 	QDir _inBaseDir;  ///< base dir for the relative input paths
@@ -261,10 +306,16 @@ class PathRebaser {
 	PathStyle _outPathStyle;  ///< whether the output paths should be relative or absolute
 	bool _quotePaths;  ///< whether to surround all output paths with quotes (needed when generating a batch)
 	                   // !!IMPORTANT!! Never store the quoted paths and pass them back to PathConvertor, they are output-only.
+	QString _inBaseAbsPath;  ///< absolute clean path of _inBaseDir for the lexical conversions
+	QString _outBaseAbsPath;  ///< absolute clean path of _outBaseDir for the lexical conversions
+	mutable QHash< QString, QString > _rebasedPaths;  ///< results of rebasePath() that had to be resolved by QDir
+	mutable QHash< QString, QString > _rebasedBackPaths;  ///< results of rebasePathBack() that had to be resolved by QDir
+
  public:
 
 	PathRebaser( const QDir & inputBaseDir, const QDir & outputBaseDir, PathStyle pathStyle, bool quotePaths = false )
-		: _inBaseDir( inputBaseDir ), _outBaseDir( outputBaseDir ), _outPathStyle( pathStyle ), _quotePaths( quotePaths ) {}
+		: _inBaseDir( inputBaseDir ), _outBaseDir( outputBaseDir ), _outPathStyle( pathStyle ), _quotePaths( quotePaths ),
+		  _inBaseAbsPath( getCleanAbsPath( inputBaseDir ) ), _outBaseAbsPath( getCleanAbsPath( outputBaseDir ) ) {}
 
 	PathRebaser( const PathRebaser & other ) = default;
 	PathRebaser( PathRebaser && other ) = default;
@@ -277,16 +328,35 @@ class PathRebaser {
 	bool outputAbsolutePaths() const                   { return _outPathStyle == PathStyle::Absolute; }
 	bool quotePaths() const                            { return _quotePaths; }
 
-	void setInputBaseDir( const QDir & baseDir )       { _inBaseDir = baseDir; }
-	void setOutputBaseDir( const QDir & baseDir )      { _outBaseDir = baseDir; }
+	void setInputBaseDir( const QDir & baseDir )
+	{
+		_inBaseDir = baseDir;
+		_inBaseAbsPath = getCleanAbsPath( baseDir );
+		_rebasedPaths.clear();
+		_rebasedBackPaths.clear();
+	}
+	void setOutputBaseDir( const QDir & baseDir )
+	{
+		_outBaseDir = baseDir;
+		_outBaseAbsPath = getCleanAbsPath( baseDir );
+		_rebasedPaths.clear();
+		_rebasedBackPaths.clear();
+	}
+
+	/// Whether the other rebaser produces the same results, so this one can be used instead of it including its memory.
+	bool hasSameSetup( const PathRebaser & other ) const
+	{
+		return _inBaseAbsPath == other._inBaseAbsPath && _outBaseAbsPath == other._outBaseAbsPath
+		    && _outPathStyle == other._outPathStyle && _quotePaths == other._quotePaths;
+	}
 
 	QString rebasePath( const QString & path ) const
 	{
-		return rebasePathFromTo( path, _inBaseDir, _outBaseDir );
+		return rebasePathFromTo( path, _inBaseDir, _inBaseAbsPath, _outBaseDir, _outBaseAbsPath, _rebasedPaths );
 	}
 	QString rebasePathBack( const QString & path ) const
 	{
-		return rebasePathFromTo( path, _outBaseDir, _inBaseDir );
+		return rebasePathFromTo( path, _outBaseDir, _outBaseAbsPath, _inBaseDir, _inBaseAbsPath, _rebasedBackPaths );
 	}
 
 	QString rebaseAndQuotePath( const QString & path ) const
@@ -304,16 +374,12 @@ class PathRebaser {
 
  private:
 
-	QString rebasePathFromTo( const QString & path, const QDir & inputBaseDir, const QDir & outputBaseDir ) const
-	{
-		if (path.isEmpty())
-			return {};
-
-		QString absPath = fs::isAbsolutePath( path ) ? path : inputBaseDir.absoluteFilePath( path );
-		QString newPath = outputAbsolutePaths() ? absPath : outputBaseDir.relativeFilePath( absPath );
+	static QString getCleanAbsPath( const QDir & dir )  { return QDir::cleanPath( dir.absolutePath() ); }
 
-		return newPath;
-	}
+	QString rebasePathFromTo(
+		const QString & path, const QDir & inputBaseDir, const QString & inputBaseAbsPath,
+		const QDir & outputBaseDir, const QString & outputBaseAbsPath, QHash< QString, QString > & memory
+	) const;
 
 };
 
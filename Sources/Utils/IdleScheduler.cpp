@@ -0,0 +1,146 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: periodic background jobs executed when the user is not interacting with the application
+//======================================================================================================================
+
+#include "IdleScheduler.hpp"
+
+#include <QApplication>
+#include <QEvent>
+#include <QTimerEvent>
+
+#include <algorithm>  // stable_sort
+
+
+//======================================================================================================================
+
+static constexpr int TickInterval = 250;  ///< [ms] how often the due jobs are checked
+static constexpr qint64 QuietPeriod = 750;  ///< [ms] how long the user must be inactive for the jobs to run
+static constexpr qint64 MainThreadBudget = 8;  ///< [ms] the jobs in the main thread can take per tick, about half a frame
+
+IdleScheduler::IdleScheduler() : LoggingComponent("IdleScheduler")
+{
+	_clock.start();
+}
+
+IdleScheduler::~IdleScheduler()
+{
+	stop();
+	// the worker TaskGroups wait for their jobs in their destructors
+}
+
+void IdleScheduler::addPeriodicJob( const char * name, qint64 interval, qint64 maxDelay, Priority priority, RunIn runIn, Job job )
+{
+	auto entry = std::make_shared< JobEntry >();
+	entry->name = name;
+	entry->interval = interval;
+	entry->maxDelay = maxDelay;
+	entry->priority = priority;
+	entry->runIn = runIn;
+	entry->job = std::move(job);
+	entry->dueTime = _clock.elapsed() + interval;
+	if (runIn == RunIn::WorkerThread)
+		entry->worker = std::make_unique< TaskGroup >();
+
+	_jobs.append( std::move(entry) );
+	std::stable_sort( _jobs.begin(), _jobs.end(), []( const auto & job1, const auto & job2 )
+	{
+		return job1->priority > job2->priority;
+	});
+}
+
+void IdleScheduler::start()
+{
+	qApp->installEventFilter( this );
+	_timer.start( TickInterval, this );
+}
+
+void IdleScheduler::stop()
+{
+	_timer.stop();
+	if (qApp)  // might already be destroyed when called from the destructor
+		qApp->removeEventFilter( this );
+}
+
+bool IdleScheduler::eventFilter( QObject * obj, QEvent * event )
+{
+	switch (event->type())
+	{
+	 case QEvent::KeyPress:
+	 case QEvent::MouseButtonPress:
+	 case QEvent::MouseButtonDblClick:
+	 case QEvent::Wheel:
+	 case QEvent::DragMove:
+	 case QEvent::TouchUpdate:
+		_lastInteraction = _clock.elapsed();
+		break;
+	 case QEvent::MouseMove:
+		if (QApplication::mouseButtons() != Qt::NoButton)  // dragging a slider, a splitter or a list item
+			_lastInteraction = _clock.elapsed();
+		break;
+	 default:
+		break;
+	}
+
+	return QObject::eventFilter( obj, event );
+}
+
+bool IdleScheduler::isUserInteracting( qint64 now ) const
+{
+	// a held button means the drag is still in progress, even if the mouse doesn't move
+	return QApplication::mouseButtons() != Qt::NoButton
+	    || (_lastInteraction >= 0 && now - _lastInteraction < QuietPeriod);
+}
+
+void IdleScheduler::timerEvent( QTimerEvent * event )
+{
+	if (event->timerId() != _timer.timerId())
+	{
+		QObject::timerEvent( event );
+		return;
+	}
+
+	const qint64 tickStart = _clock.elapsed();
+	const bool userInteracting = isUserInteracting( tickStart );
+
+	for (const auto & entry : _jobs)  // already in the order of priority
+	{
+		qint64 now = _clock.elapsed();
+		if (now < entry->dueTime)
+			continue;
+
+		const bool overdue = now >= entry->dueTime + entry->maxDelay;
+		if (!overdue)
+		{
+			if (userInteracting)
+				continue;
+			if (entry->runIn == RunIn::MainThread && now - tickStart >= MainThreadBudget)
+				continue;  // let the event loop breathe, the next tick is soon
+		}
+		else if (userInteracting)
+		{
+			logDebug() << "job " << entry->name << " waited too long, running it despite the user input";
+		}
+
+		runJob( *entry );
+	}
+}
+
+void IdleScheduler::runJob( JobEntry & entry )
+{
+	if (entry.runIn == RunIn::WorkerThread)
+	{
+		if (entry.worker->isRunning())
+			return;  // the previous run is slow, this one would only pile up behind it, try again on the next tick
+		entry.worker->addTask( entry.job );
+	}
+	else
+	{
+		entry.job();
+	}
+
+	// the missed periods are not caught up, they would all do the same work
+	entry.dueTime = _clock.elapsed() + entry.interval;
+}
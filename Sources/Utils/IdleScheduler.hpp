@@ -0,0 +1,103 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: periodic background jobs executed when the user is not interacting with the application
+//======================================================================================================================
+
+#ifndef IDLE_SCHEDULER_INCLUDED
+#define IDLE_SCHEDULER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "TaskGroup.hpp"
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QObject>
+#include <QVector>
+#include <QBasicTimer>
+#include <QElapsedTimer>
+
+#include <functional>
+#include <memory>
+
+
+//======================================================================================================================
+/// Runs periodic maintenance jobs (saving files, refreshing lists, ...) at moments when they don't disturb the user.
+/**
+  * A job that becomes due while the user is typing, clicking, scrolling or dragging something is postponed until
+  * the user stops for a moment, but at most by its maximum delay, after which it's executed anyway.
+  * A job that missed several of its periods is executed only once and then its period starts over.
+  * The jobs executed in the main thread share a time budget per timer tick, when it's exhausted,
+  * the rest of the due jobs that can still wait are moved to the next tick, so that they don't all land on the same frame.
+  *
+  * Must be used from the main thread.
+  * The destructor waits until the jobs running in the worker threads finish.
+  */
+class IdleScheduler : public QObject, protected LoggingComponent {
+
+	Q_OBJECT
+
+ public:
+
+	enum class Priority
+	{
+		Low,
+		Normal,
+		High,  ///< what the user can see, is executed first within a tick
+	};
+
+	enum class RunIn
+	{
+		MainThread,
+		WorkerThread,  ///< the job must be thread-safe and must not touch the UI
+	};
+
+	using Job = std::function< void () >;
+
+	IdleScheduler();
+	virtual ~IdleScheduler() override;
+
+	/// Adds a job that will be executed about every interval milliseconds, the first time after the first interval.
+	/** If the user is interacting with the application when the job is due, it's postponed by up to maxDelay milliseconds.
+	  * A job in a worker thread is not started again until its previous run is finished. */
+	void addPeriodicJob( const char * name, qint64 interval, qint64 maxDelay, Priority priority, RunIn runIn, Job job );
+
+	/// Starts checking the jobs and watching the user input of the whole application.
+	void start();
+
+	/// No more jobs will be started, the ones running in the worker threads are not interrupted.
+	void stop();
+
+ protected:
+
+	virtual bool eventFilter( QObject * obj, QEvent * event ) override;
+	virtual void timerEvent( QTimerEvent * event ) override;
+
+ private:
+
+	struct JobEntry
+	{
+		const char * name;
+		qint64 interval;
+		qint64 maxDelay;
+		Priority priority;
+		RunIn runIn;
+		Job job;
+		qint64 dueTime;  ///< since the start of _clock
+		std::unique_ptr< TaskGroup > worker;  ///< only for the jobs run in a worker thread
+	};
+
+	bool isUserInteracting( qint64 now ) const;
+	void runJob( JobEntry & entry );
+
+	QVector< std::shared_ptr< JobEntry > > _jobs;  ///< sorted by priority, the highest first
+	QBasicTimer _timer;
+	QElapsedTimer _clock;
+	qint64 _lastInteraction = -1;  ///< since the start of _clock, -1 if there was none yet
+
+};
+
+
+#endif // IDLE_SCHEDULER_INCLUDED
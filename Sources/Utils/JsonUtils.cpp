@@ -52,15 +52,99 @@ QString JsonValueCtx::getJsonPath() const
 //======================================================================================================================
 //  JsonObjectCtx
 
+// The value() returns Undefined when the key is missing, which is the same as contains() followed by operator[],
+// except that the object is searched only once.
+
 JsonObjectCtxProxy JsonObjectCtx::getObject( const QString & key, bool showError ) const
 {
-	if (!_wrappedObject.contains( key ))
+	return valueToObject( _wrappedObject.value( key ), key, showError );
+}
+
+JsonArrayCtxProxy JsonObjectCtx::getArray( const QString & key, bool showError ) const
+{
+	return valueToArray( _wrappedObject.value( key ), key, showError );
+}
+
+bool JsonObjectCtx::getBool( const QString & key, bool defaultVal, bool showError ) const
+{
+	return valueToBool( _wrappedObject.value( key ), key, defaultVal, showError );
+}
+
+int JsonObjectCtx::getInt( const QString & key, int defaultVal, bool showError ) const
+{
+	return valueToInt( _wrappedObject.value( key ), key, defaultVal, showError );
+}
+
+uint JsonObjectCtx::getUInt( const QString & key, uint defaultVal, bool showError ) const
+{
+	return valueToUInt( _wrappedObject.value( key ), key, defaultVal, showError );
+}
+
+uint16_t JsonObjectCtx::getUInt16( const QString & key, uint16_t defaultVal, bool showError ) const
+{
+	return valueToUInt16( _wrappedObject.value( key ), key, defaultVal, showError );
+}
+
+int64_t JsonObjectCtx::getInt64( const QString & key, int64_t defaultVal, bool showError ) const
+{
+	return valueToInt64( _wrappedObject.value( key ), key, defaultVal, showError );
+}
+
+double JsonObjectCtx::getDouble( const QString & key, double defaultVal, bool showError ) const
+{
+	return valueToDouble( _wrappedObject.value( key ), key, defaultVal, showError );
+}
+
+QString JsonObjectCtx::getString( const QString & key, QString defaultVal, bool showError ) const
+{
+	return valueToString( _wrappedObject.value( key ), key, std::move(defaultVal), showError );
+}
+
+JsonMembers JsonObjectCtx::getMembers( const char * const * keys, int keyCount ) const
+{
+	JsonMembers members( this, keys, keyCount );
+
+ #if IS_DEBUG_BUILD
+	for (int i = 1; i < keyCount; i++)
+		if (qstrcmp( keys[i-1], keys[i] ) >= 0)
+			logLogicError("JsonValueCtx") << "JSON key table is not sorted at " << keys[i];
+ #endif
+
+	// Both the members and the table are sorted, so one comparison either matches the member with the key,
+	// or tells which of the two is not present in the other one and can be skipped.
+	// key() still builds a QString for each visited member, only the repeated lookups of the keys are saved.
+	int keyIdx = 0;
+	auto memberIter = _wrappedObject.constBegin();
+	while (memberIter != _wrappedObject.constEnd() && keyIdx < keyCount)
+	{
+		int cmp = memberIter.key().compare( QLatin1String( keys[ keyIdx ] ) );
+		if (cmp == 0)
+		{
+			members._values[ keyIdx ] = memberIter.value();
+			++memberIter;
+			++keyIdx;
+		}
+		else if (cmp < 0)
+		{
+			++memberIter;  // member that this deserialization doesn't read
+		}
+		else
+		{
+			++keyIdx;  // key that is missing in the object, stays Undefined
+		}
+	}
+
+	return members;
+}
+
+template< typename Key >
+JsonObjectCtxProxy JsonObjectCtx::valueToObject( const QJsonValue & val, const Key & key, bool showError ) const
+{
+	if (val.isUndefined())
 	{
 		missingKey( key, showError );
 		return JsonObjectCtxProxy();
 	}
-	QJsonValue val = _wrappedObject[ key ];
-
 	if (!val.isObject())
 	{
 		invalidTypeAtKey( key, "object" );
@@ -69,14 +153,14 @@ JsonObjectCtxProxy JsonObjectCtx::getObject( const QString & key, bool showError
 	return JsonObjectCtxProxy( val.toObject(), _context, this, key );
 }
 
-JsonArrayCtxProxy JsonObjectCtx::getArray( const QString & key, bool showError ) const
+template< typename Key >
+JsonArrayCtxProxy JsonObjectCtx::valueToArray( const QJsonValue & val, const Key & key, bool showError ) const
 {
-	if (!_wrappedObject.contains( key ))
+	if (val.isUndefined())
 	{
 		missingKey( key, showError );
 		return JsonArrayCtxProxy();
 	}
-	QJsonValue val = _wrappedObject[ key ];
 	if (!val.isArray())
 	{
 		invalidTypeAtKey( key, "array" );
@@ -85,14 +169,14 @@ JsonArrayCtxProxy JsonObjectCtx::getArray( const QString & key, bool showError )
 	return JsonArrayCtxProxy( val.toArray(), _context, this, key );
 }
 
-bool JsonObjectCtx::getBool( const QString & key, bool defaultVal, bool showError ) const
+template< typename Key >
+bool JsonObjectCtx::valueToBool( const QJsonValue & val, const Key & key, bool defaultVal, bool showError ) const
 {
-	if (!_wrappedObject.contains( key ))
+	if (val.isUndefined())
 	{
 		missingKey( key, showError );
 		return defaultVal;
 	}
-	QJsonValue val = _wrappedObject[ key ];
 	if (!val.isBool())
 	{
 		invalidTypeAtKey( key, "bool" );
@@ -101,14 +185,14 @@ bool JsonObjectCtx::getBool( const QString & key, bool defaultVal, bool showErro
 	return val.toBool();
 }
 
-int JsonObjectCtx::getInt( const QString & key, int defaultVal, bool showError ) const
+template< typename Key >
+int JsonObjectCtx::valueToInt( const QJsonValue & val, const Key & key, int defaultVal, bool showError ) const
 {
-	if (!_wrappedObject.contains( key ))
+	if (val.isUndefined())
 	{
 		missingKey( key, showError );
 		return defaultVal;
 	}
-	QJsonValue val = _wrappedObject[ key ];
 	if (!val.isDouble())
 	{
 		invalidTypeAtKey( key, "int" );
@@ -123,14 +207,14 @@ int JsonObjectCtx::getInt( const QString & key, int defaultVal, bool showError )
 	return int(d);
 }
 
-uint JsonObjectCtx::getUInt( const QString & key, uint defaultVal, bool showError ) const
+template< typename Key >
+uint JsonObjectCtx::valueToUInt( const QJsonValue & val, const Key & key, uint defaultVal, bool showError ) const
 {
-	if (!_wrappedObject.contains( key ))
+	if (val.isUndefined())
 	{
 		missingKey( key, showError );
 		return defaultVal;
 	}
-	QJsonValue val = _wrappedObject[ key ];
 	if (!val.isDouble())
 	{
 		invalidTypeAtKey( key, "uint" );
@@ -145,14 +229,14 @@ uint JsonObjectCtx::getUInt( const QString & key, uint defaultVal, bool showErro
 	return uint(d);
 }
 
-uint16_t JsonObjectCtx::getUInt16( const QString & key, uint16_t defaultVal, bool showError ) const
+template< typename Key >
+uint16_t JsonObjectCtx::valueToUInt16( const QJsonValue & val, const Key & key, uint16_t defaultVal, bool showError ) const
 {
-	if (!_wrappedObject.contains( key ))
+	if (val.isUndefined())
 	{
 		missingKey( key, showError );
 		return defaultVal;
 	}
-	QJsonValue val = _wrappedObject[ key ];
 	if (!val.isDouble())
 	{
 		invalidTypeAtKey( key, "uint16" );
@@ -167,14 +251,14 @@ uint16_t JsonObjectCtx::getUInt16( const QString & key, uint16_t defaultVal, boo
 	return uint16_t(d);
 }
 
-int64_t JsonObjectCtx::getInt64( const QString & key, int64_t defaultVal, bool showError ) const
+template< typename Key >
+int64_t JsonObjectCtx::valueToInt64( const QJsonValue & val, const Key & key, int64_t defaultVal, bool showError ) const
 {
-	if (!_wrappedObject.contains( key ))
+	if (val.isUndefined())
 	{
 		missingKey( key, showError );
 		return defaultVal;
 	}
-	QJsonValue val = _wrappedObject[ key ];
 	if (!val.isDouble())
 	{
 		invalidTypeAtKey( key, "int64" );
@@ -189,14 +273,14 @@ int64_t JsonObjectCtx::getInt64( const QString & key, int64_t defaultVal, bool s
 	return int64_t(d);
 }
 
-double JsonObjectCtx::getDouble( const QString & key, double defaultVal, bool showError ) const
+template< typename Key >
+double JsonObjectCtx::valueToDouble( const QJsonValue & val, const Key & key, double defaultVal, bool showError ) const
 {
-	if (!_wrappedObject.contains( key ))
+	if (val.isUndefined())
 	{
 		missingKey( key, showError );
 		return defaultVal;
 	}
-	QJsonValue val = _wrappedObject[ key ];
 	if (!val.isDouble())
 	{
 		invalidTypeAtKey( key, "double" );
@@ -205,14 +289,14 @@ double JsonObjectCtx::getDouble( const QString & key, double defaultVal, bool sh
 	return val.toDouble();
 }
 
-QString JsonObjectCtx::getString( const QString & key, QString defaultVal, bool showError ) const
+template< typename Key >
+QString JsonObjectCtx::valueToString( const QJsonValue & val, const Key & key, QString defaultVal, bool showError ) const
 {
-	if (!_wrappedObject.contains( key ))
+	if (val.isUndefined())
 	{
 		missingKey( key, showError );
 		return defaultVal;
 	}
-	QJsonValue val = _wrappedObject[ key ];
 	if (val.isNull())
 	{
 		invalidTypeAtKey( key, "string", showError );
@@ -227,6 +311,55 @@ QString JsonObjectCtx::getString( const QString & key, QString defaultVal, bool
 }
 
 
+//======================================================================================================================
+//  JsonMembers
+
+JsonObjectCtxProxy JsonMembers::getObject( int keyIdx, bool showError ) const
+{
+	return _object->valueToObject( _values[ keyIdx ], key( keyIdx ), showError );
+}
+
+JsonArrayCtxProxy JsonMembers::getArray( int keyIdx, bool showError ) const
+{
+	return _object->valueToArray( _values[ keyIdx ], key( keyIdx ), showError );
+}
+
+bool JsonMembers::getBool( int keyIdx, bool defaultVal, bool showError ) const
+{
+	return _object->valueToBool( _values[ keyIdx ], key( keyIdx ), defaultVal, showError );
+}
+
+int JsonMembers::getInt( int keyIdx, int defaultVal, bool showError ) const
+{
+	return _object->valueToInt( _values[ keyIdx ], key( keyIdx ), defaultVal, showError );
+}
+
+uint JsonMembers::getUInt( int keyIdx, uint defaultVal, bool showError ) const
+{
+	return _object->valueToUInt( _values[ keyIdx ], key( keyIdx ), defaultVal, showError );
+}
+
+uint16_t JsonMembers::getUInt16( int keyIdx, uint16_t defaultVal, bool showError ) const
+{
+	return _object->valueToUInt16( _values[ keyIdx ], key( keyIdx ), defaultVal, showError );
+}
+
+int64_t JsonMembers::getInt64( int keyIdx, int64_t defaultVal, bool showError ) const
+{
+	return _object->valueToInt64( _values[ keyIdx ], key( keyIdx ), defaultVal, showError );
+}
+
+double JsonMembers::getDouble( int keyIdx, double defaultVal, bool showError ) const
+{
+	return _object->valueToDouble( _values[ keyIdx ], key( keyIdx ), defaultVal, showError );
+}
+
+QString JsonMembers::getString( int keyIdx, QString defaultVal, bool showError ) const
+{
+	return _object->valueToString( _values[ keyIdx ], key( keyIdx ), std::move(defaultVal), showError );
+}
+
+
 //======================================================================================================================
 //  JsonArrayCtx
 
@@ -522,32 +655,48 @@ bool writeJsonToFile( const QJsonDocument & jsonDoc, const QString & filePath, c
 }
 
 JsonDocumentCtx readJsonFromFile( const QString & filePath, const QString & fileDesc, bool ignoreEmpty )
+{
+	QJsonDocument jsonDoc;
+	QString error = parseJsonFile( filePath, fileDesc, ignoreEmpty, jsonDoc );
+	if (!error.isEmpty())
+	{
+		reportRuntimeError( nullptr, "Error loading "+fileDesc, error );
+		return JsonDocumentCtx();
+	}
+	if (jsonDoc.isNull())  // ignored empty file
+	{
+		return JsonDocumentCtx();
+	}
+
+	return JsonDocumentCtx( filePath, jsonDoc );
+}
+
+QString parseJsonFile( const QString & filePath, const QString & fileDesc, bool ignoreEmpty, QJsonDocument & jsonDoc )
 {
 	QByteArray bytes;
 	QString readError = fs::readWholeFile( filePath, bytes );
 	if (!readError.isEmpty())
 	{
-		reportRuntimeError( nullptr, "Error loading "+fileDesc, readError );
-		return JsonDocumentCtx();
+		return readError;
 	}
 
+	return parseJsonFileContent( bytes, filePath, fileDesc, ignoreEmpty, jsonDoc );
+}
+
+QString parseJsonFileContent( const QByteArray & bytes, const QString & filePath, const QString & fileDesc, bool ignoreEmpty, QJsonDocument & jsonDoc )
+{
 	if (bytes.isEmpty())
 	{
-		if (!ignoreEmpty)
-			reportRuntimeError( nullptr, "Error loading "+fileDesc, fileDesc+" file is empty." );
-		return JsonDocumentCtx();
+		return ignoreEmpty ? QString() : fileDesc+" file is empty.";
 	}
 
 	QJsonParseError parseError;
-	QJsonDocument jsonDoc = QJsonDocument::fromJson( bytes, &parseError );
+	jsonDoc = QJsonDocument::fromJson( bytes, &parseError );
 	if (jsonDoc.isNull())
 	{
-		reportRuntimeError( nullptr, "Error loading "+fileDesc,
-			"Failed to parse \""%fs::getFileNameFromPath(filePath)%"\": "%parseError.errorString()%"\n"
-			"You can either open it in notepad and try to repair it, or delete it and start from scratch."
-		);
-		return JsonDocumentCtx();
+		return "Failed to parse \""%fs::getFileNameFromPath(filePath)%"\": "%parseError.errorString()%"\n"
+		       "You can either open it in notepad and try to repair it, or delete it and start from scratch.";
 	}
 
-	return JsonDocumentCtx( filePath, jsonDoc );
+	return {};
 }
@@ -18,6 +18,10 @@
 #include <QJsonValue>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QLatin1String>
+#include <QVarLengthArray>
+
+#include <array>
 
 
 //======================================================================================================================
@@ -50,6 +54,13 @@ uint enumSize() { return 0; }
 //    (JsonObjectCtx::getArray returns JsonArrayCtx and JsonArrayCtx::getObject returns JsonObjectCtx) and we can't
 //    declare one before the other. Therefore getObject/getArray return a proxy class that is declared before both and
 //    that is then automatically converted (by a constructor) to the final JsonObjectCtx/JsonArrayCtx.
+//
+// 4. JsonMembers - getMembers()
+//    Each getX( key ) converts the key literal into a QString and searches the object for it. When a deserialization
+//    function reads many members of many objects of the same kind (mods of thousands of presets), it can instead list
+//    its keys in a JsonKeys table and fetch them all with a single pass over the object. QJsonObject keeps its members
+//    sorted by key, so if the table is sorted the same way, the walk is a merge of two sorted sequences and costs one
+//    key comparison per member. The values are then taken by their index in the table.
 
 
 constexpr bool ShowError = true;
@@ -133,6 +144,13 @@ class JsonValueCtx {
 
 };
 
+/// Keys of the members that a deserialization function reads from a JSON object.
+/** Must be sorted alphabetically (case-sensitive, ASCII order), that's how QJsonObject orders its members. */
+template< size_t N >
+using JsonKeys = std::array< const char *, N >;
+
+class JsonMembers;
+
 /// proxy class that solves cyclic dependancy between JsonObjectCtx and JsonArrayCtx
 class JsonObjectCtxProxy : public JsonValueCtx {
 
@@ -204,6 +222,9 @@ class JsonObjectCtx : public JsonObjectCtxProxy {
 
 	auto keys() const { return _wrappedObject.keys(); }
 
+	/// Returns the underlying JSON object, for example to keep it for later deserialization.
+	const QJsonObject & wrappedObject() const { return _wrappedObject; }
+
 	/// Returns a sub-object at a specified key.
 	/** If it doesn't exist it shows an error dialog and returns invalid object. */
 	JsonObjectCtxProxy getObject( const QString & key, bool showError = true ) const;
@@ -254,14 +275,89 @@ class JsonObjectCtx : public JsonObjectCtxProxy {
 		}
 	}
 
+	/// Fetches the values of all the keys in the table with a single pass over the object.
+	/** The values are then retrieved from the result by their index in the table. */
+	template< size_t N >
+	JsonMembers getMembers( const JsonKeys< N > & keys ) const;
+
  protected:
 
+	friend class JsonMembers;
+
+	JsonMembers getMembers( const char * const * keys, int keyCount ) const;
+
+	// Common for the key lookups and for JsonMembers. The value is Undefined when the key is missing.
+	// The key is a template, so that JsonMembers can pass a QLatin1String that is converted to QString only on error.
+	template< typename Key > JsonObjectCtxProxy valueToObject( const QJsonValue & val, const Key & key, bool showError ) const;
+	template< typename Key > JsonArrayCtxProxy valueToArray( const QJsonValue & val, const Key & key, bool showError ) const;
+	template< typename Key > bool valueToBool( const QJsonValue & val, const Key & key, bool defaultVal, bool showError ) const;
+	template< typename Key > int valueToInt( const QJsonValue & val, const Key & key, int defaultVal, bool showError ) const;
+	template< typename Key > uint valueToUInt( const QJsonValue & val, const Key & key, uint defaultVal, bool showError ) const;
+	template< typename Key > uint16_t valueToUInt16( const QJsonValue & val, const Key & key, uint16_t defaultVal, bool showError ) const;
+	template< typename Key > int64_t valueToInt64( const QJsonValue & val, const Key & key, int64_t defaultVal, bool showError ) const;
+	template< typename Key > double valueToDouble( const QJsonValue & val, const Key & key, double defaultVal, bool showError ) const;
+	template< typename Key > QString valueToString( const QJsonValue & val, const Key & key, QString defaultVal, bool showError ) const;
+
 	void missingKey( const QString & key, bool showError ) const;
 	void invalidTypeAtKey( const QString & key, const QString & expectedType, bool showError = true ) const;
 	QString elemPath( const QString & elemName ) const;
 
 };
 
+/** Values of the members of a JSON object fetched by JsonObjectCtx::getMembers(), indexed by their position in the key table.
+  * Behaves like the getters of JsonObjectCtx, including the error messages. Must not outlive the object and the table. */
+class JsonMembers {
+
+	const JsonObjectCtx * _object;
+	const char * const * _keys;
+	QVarLengthArray< QJsonValue, 20 > _values;  ///< Undefined for the keys that are not in the object
+
+	friend class JsonObjectCtx;
+
+	JsonMembers( const JsonObjectCtx * object, const char * const * keys, int keyCount )
+		: _object( object ), _keys( keys ), _values( keyCount )
+	{
+		for (QJsonValue & value : _values)
+			value = QJsonValue( QJsonValue::Undefined );  // default-constructed is Null, which would mean invalid type
+	}
+
+	QLatin1String key( int keyIdx ) const  { return QLatin1String( _keys[ keyIdx ] ); }
+
+ public:
+
+	/// Whether the object has a member with the key at this index.
+	bool contains( int keyIdx ) const  { return !_values[ keyIdx ].isUndefined(); }
+
+	JsonObjectCtxProxy getObject( int keyIdx, bool showError = true ) const;
+	JsonArrayCtxProxy getArray( int keyIdx, bool showError = true ) const;
+	bool getBool( int keyIdx, bool defaultVal, bool showError = true ) const;
+	int getInt( int keyIdx, int defaultVal, bool showError = true ) const;
+	uint getUInt( int keyIdx, uint defaultVal, bool showError = true ) const;
+	uint16_t getUInt16( int keyIdx, uint16_t defaultVal, bool showError = true ) const;
+	int64_t getInt64( int keyIdx, int64_t defaultVal, bool showError = true ) const;
+	double getDouble( int keyIdx, double defaultVal, bool showError = true ) const;
+	QString getString( int keyIdx, QString defaultVal = QString(), bool showError = true ) const;
+
+	template< typename Enum >
+	Enum getEnum( int keyIdx, Enum defaultVal, bool showError = true ) const
+	{
+		uint intVal = getUInt( keyIdx, uint(defaultVal), showError );
+		if (intVal <= enumSize< Enum >()) {
+			return Enum( intVal );
+		} else {
+			_object->invalidTypeAtKey( key( keyIdx ), enumName< Enum >() );
+			return defaultVal;
+		}
+	}
+
+};
+
+template< size_t N >
+JsonMembers JsonObjectCtx::getMembers( const JsonKeys< N > & keys ) const
+{
+	return getMembers( keys.data(), int(N) );
+}
+
 /** Wrapper around QJsonArray that knows its position in the JSON document and pops up an error messsage on invalid operations. */
 class JsonArrayCtx : public JsonArrayCtxProxy {
 
@@ -275,6 +371,9 @@ class JsonArrayCtx : public JsonArrayCtxProxy {
 
 	int size() const { return _wrappedArray.size(); }
 
+	/// Returns the underlying JSON array, for example to compare it with another one.
+	const QJsonArray & wrappedArray() const { return _wrappedArray; }
+
 	/// Returns a sub-object at a specified index.
 	/** If it doesn't exist it shows an error dialog and returns invalid array. */
 	JsonObjectCtxProxy getObject( int index, bool showError = true ) const;
@@ -455,5 +554,12 @@ inline constexpr bool CheckIfEmpty = false;
 bool writeJsonToFile( const QJsonDocument & jsonDoc, const QString & filePath, const QString & fileDesc );
 JsonDocumentCtx readJsonFromFile( const QString & filePath, const QString & fileDesc, bool ignoreEmpty = false );
 
+/// Reads and parses the file like readJsonFromFile(), but instead of showing the error it returns it, so it can be used in any thread.
+/** Returns empty string on success. When the file is empty and ignoreEmpty is true, the document stays null without an error. */
+QString parseJsonFile( const QString & filePath, const QString & fileDesc, bool ignoreEmpty, QJsonDocument & jsonDoc );
+
+/// Second half of parseJsonFile(), for when the content of the file has already been read for some other purpose.
+QString parseJsonFileContent( const QByteArray & bytes, const QString & filePath, const QString & fileDesc, bool ignoreEmpty, QJsonDocument & jsonDoc );
+
 
 #endif // JSON_UTILS_INCLUDED
@@ -0,0 +1,194 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: finding and reading the text descriptions of map packs
+//======================================================================================================================
+
+#include "MapDescReader.hpp"
+
+#include "WADReader.hpp"  // readWadLumps
+#include "ZipReader.hpp"
+#include "SevenZipReader.hpp"  // hasSevenZipSignature
+#include "FileSystemUtils.hpp"  // replaceFileSuffix
+#include "ErrorHandling.hpp"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QStringBuilder>
+
+
+namespace doom {
+
+
+//======================================================================================================================
+
+/// A description is a text for human to read, anything bigger is most likely not what we are looking for.
+static constexpr qint64 MaxDescSize = 1 * 1024 * 1024;
+
+/// The descriptions are only needed for the map packs the user is currently looking at.
+static constexpr int MaxCachedDescs = 64;
+
+/// there is no standard, these are the names the authors use for the text lumps
+static const QStringVec descLumpNames = { "WADINFO", "README", "INFO" };
+
+/// the patches are text themselves, but not a description, and don't contain anything else
+static const QStringVec patchSuffixes = { "deh", "bex", "hhe" };
+
+static const QStringVec descFileSuffixes = { "txt" };
+
+static bool looksLikeText( const QByteArray & content )
+{
+	return !content.isEmpty() && !content.contains('\0');
+}
+
+static void readDescFromTextFile( const QString & filePath, UncertainMapPackDesc & desc )
+{
+	QFile descFile( filePath );
+	if (!descFile.open( QIODevice::ReadOnly ))
+	{
+		desc.status = ReadStatus::CantOpen;
+		return;
+	}
+
+	desc.sourceName = QFileInfo( filePath ).fileName();
+	desc.text = QString::fromUtf8( descFile.read( MaxDescSize ) );
+	desc.status = ReadStatus::Success;
+}
+
+static int getEntryScore( const zip::Entry & entry, const QString & packBaseName )
+{
+	// only the root of the package, the other directories contain the lumps
+	if (entry.isDir() || entry.name.contains('/') || !entry.name.endsWith( ".txt", Qt::CaseInsensitive ))
+		return 0;
+
+	QString entryBaseName = entry.name.left( entry.name.size() - 4 );
+	if (entryBaseName.compare( packBaseName, Qt::CaseInsensitive ) == 0)
+		return 3;
+	else if (entryBaseName.contains( "readme", Qt::CaseInsensitive ))
+		return 2;
+	else
+		return 1;
+}
+
+static void readDescFromZip( QFile & file, const QString & packFileName, UncertainMapPackDesc & desc )
+{
+	// only the directory at the end of the archive and the selected entry are read
+	zip::ArchiveReader archive( file );
+	QVector< zip::Entry > entries;
+	desc.status = archive.readEntries( entries );
+	if (desc.status != ReadStatus::Success)
+		return;
+
+	QString packBaseName = QFileInfo( packFileName ).completeBaseName();
+
+	const zip::Entry * bestEntry = nullptr;
+	int bestScore = 0;
+	for (const zip::Entry & entry : entries)
+	{
+		int score = getEntryScore( entry, packBaseName );
+		if (score > bestScore)
+		{
+			bestEntry = &entry;
+			bestScore = score;
+		}
+	}
+
+	QByteArray content;
+	if (!bestEntry || archive.readContent( *bestEntry, content, MaxDescSize ) != ReadStatus::Success || !looksLikeText( content ))
+	{
+		desc.status = ReadStatus::InfoNotPresent;
+		return;
+	}
+
+	desc.sourceName = packFileName % " : " % bestEntry->name;
+	desc.text = QString::fromUtf8( content );
+	desc.status = ReadStatus::Success;
+}
+
+static void readDescFromWad( const QString & filePath, const QString & packFileName, UncertainMapPackDesc & desc )
+{
+	QHash< QString, QByteArray > lumps;
+	desc.status = readWadLumps( filePath, descLumpNames, MaxDescSize, lumps );
+	if (desc.status != ReadStatus::Success)
+		return;
+
+	for (const QString & lumpName : descLumpNames)
+	{
+		auto lumpIter = lumps.find( lumpName );
+		if (lumpIter != lumps.end() && looksLikeText( *lumpIter ))
+		{
+			desc.sourceName = packFileName % " : " % lumpName;
+			desc.text = QString::fromUtf8( *lumpIter );
+			return;
+		}
+	}
+
+	desc.status = ReadStatus::InfoNotPresent;
+}
+
+
+//======================================================================================================================
+//  public API
+
+QString getMapPackDescFile( const QString & mapPackPath )
+{
+	// most of the map packs are distributed with the text file, and that one is what the authors keep up to date
+	// try TXT too in case we are in a case-sensitive file-system such as Linux
+	for (const char * suffix : { "txt", "TXT" })
+	{
+		QString descFilePath = fs::replaceFileSuffix( mapPackPath, suffix );
+		if (QFileInfo::exists( descFilePath ))
+			return descFilePath;
+	}
+	return mapPackPath;
+}
+
+UncertainMapPackDesc readMapPackDesc( const QString & filePath )
+{
+	ScopeTimer timer( "reading map pack description", /*reportThresholdMs*/10 );
+
+	UncertainMapPackDesc desc;
+
+	if (fs::hasOneOfSuffixes( filePath, descFileSuffixes ))
+	{
+		readDescFromTextFile( filePath, desc );
+		return desc;
+	}
+	if (fs::hasOneOfSuffixes( filePath, patchSuffixes ))
+	{
+		desc.status = ReadStatus::NotSupported;
+		return desc;
+	}
+
+	QFile file( filePath );
+	if (!file.open( QIODevice::ReadOnly ))
+	{
+		desc.status = ReadStatus::CantOpen;
+		return desc;
+	}
+
+	QString packFileName = QFileInfo( filePath ).fileName();
+	QByteArray fileStart = file.peek( 8 );
+	if (zip::hasZipSignature( fileStart ))
+	{
+		readDescFromZip( file, packFileName, desc );
+	}
+	else if (sevenzip::hasSevenZipSignature( fileStart ))
+	{
+		desc.status = ReadStatus::NotSupported;  // the entries are compressed in solid blocks, not worth decompressing for a text
+	}
+	else
+	{
+		file.close();
+		readDescFromWad( filePath, packFileName, desc );
+	}
+
+	return desc;
+}
+
+FileInfoCache< MapPackDesc > g_cachedMapPackDescs( readMapPackDesc, /*useFingerprints*/false, MaxCachedDescs );
+
+
+} // namespace doom
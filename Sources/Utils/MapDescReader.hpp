@@ -0,0 +1,50 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: finding and reading the text descriptions of map packs
+//======================================================================================================================
+
+#ifndef MAP_DESC_READER_INCLUDED
+#define MAP_DESC_READER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "FileInfoCache.hpp"
+
+#include <QString>
+
+
+namespace doom {
+
+
+//======================================================================================================================
+
+struct MapPackDesc
+{
+	QString sourceName;  ///< name of the file, archive entry or lump the text comes from, to be displayed to the user
+	QString text;
+};
+
+using UncertainMapPackDesc = UncertainFileInfo< MapPackDesc >;
+
+/// Returns the file the description of the map pack should be read from, and the cache queried with.
+/** That is the text file next to the map pack with the same name if there is one, otherwise the map pack itself.
+  * This way the cache entry is invalidated when the text file is edited, not only when the map pack changes. */
+QString getMapPackDescFile( const QString & mapPackPath );
+
+/// Reads the description from the file returned by getMapPackDescFile().
+/** In a map pack the description is looked up in this order: a text file in the root of a ZIP package
+  * (preferably with the same name or a readme), a text lump in a WAD. Returns InfoNotPresent if there is none,
+  * and NotSupported for the 7z packages and the DeHackEd patches. */
+UncertainMapPackDesc readMapPackDesc( const QString & filePath );
+
+/// Descriptions of the recently viewed map packs, only the last few are kept in memory and none is saved to a file.
+extern FileInfoCache< MapPackDesc > g_cachedMapPackDescs;
+
+
+} // namespace doom
+
+
+#endif // MAP_DESC_READER_INCLUDED
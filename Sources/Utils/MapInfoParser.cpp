@@ -0,0 +1,240 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: extraction of map names from MAPINFO, ZMAPINFO and UMAPINFO lumps
+//======================================================================================================================
+
+#include "MapInfoParser.hpp"
+
+#include <QString>
+#include <QByteArray>
+
+#include <cctype>
+#include <algorithm>
+
+
+namespace doom {
+
+
+//======================================================================================================================
+//  tokenizer
+
+//  https://zdoom.org/wiki/MAPINFO
+//  https://doomwiki.org/wiki/UMAPINFO
+
+namespace {
+
+struct Token
+{
+	enum Type
+	{
+		End,
+		Word,        ///< identifier, number or keyword
+		String,      ///< content of a quoted string, without the quotes
+		OpenBrace,
+		CloseBrace,
+		Other,       ///< '=', ',' and similar
+	};
+
+	Type type = End;
+	const char * begin = nullptr;
+	qint64 length = 0;
+	bool startsLine = false;  ///< whether it's the first token on its line
+
+	bool equalsIgnoreCase( const char * str ) const
+	{
+		qint64 i = 0;
+		for (; i < length && str[i] != '\0'; ++i)
+			if (toupper( uchar( begin[i] ) ) != toupper( uchar( str[i] ) ))
+				return false;
+		return i == length && str[i] == '\0';
+	}
+};
+
+/// Splits the lump into tokens, just pointing into the original buffer.
+class Tokenizer {
+
+ public:
+
+	Tokenizer( const char * data, qint64 size ) : _pos( data ), _end( data + size ) {}
+
+	Token next()
+	{
+		skipWhitespaceAndComments();
+
+		Token token;
+		token.startsLine = _atLineStart;
+		_atLineStart = false;
+
+		if (_pos >= _end)
+		{
+			token.type = Token::End;
+			return token;
+		}
+
+		char c = *_pos;
+		if (c == '"')
+		{
+			token.type = Token::String;
+			token.begin = ++_pos;
+			while (_pos < _end && *_pos != '"')
+			{
+				if (*_pos == '\\' && _pos + 1 < _end)
+					++_pos;  // skip the escaped character, it might be a quote
+				else if (*_pos == '\n')
+					_atLineStart = true;  // multi-line string, the next token is at the beginning of a line
+				++_pos;
+			}
+			token.length = _pos - token.begin;
+			if (_pos < _end)
+				++_pos;  // closing quote
+		}
+		else if (c == '{' || c == '}' || isSeparator( c ))
+		{
+			token.type = c == '{' ? Token::OpenBrace : c == '}' ? Token::CloseBrace : Token::Other;
+			token.begin = _pos++;
+			token.length = 1;
+		}
+		else
+		{
+			token.type = Token::Word;
+			token.begin = _pos;
+			while (_pos < _end && !isspace( uchar( *_pos ) ) && !isSeparator( *_pos )
+			    && *_pos != '{' && *_pos != '}' && *_pos != '"' && !isCommentStart())
+				++_pos;
+			token.length = _pos - token.begin;
+		}
+
+		return token;
+	}
+
+ private:
+
+	static bool isSeparator( char c )
+	{
+		return c == '=' || c == ',' || c == ';';
+	}
+
+	bool isCommentStart() const
+	{
+		return _pos + 1 < _end && _pos[0] == '/' && (_pos[1] == '/' || _pos[1] == '*');
+	}
+
+	void skipWhitespaceAndComments()
+	{
+		while (_pos < _end)
+		{
+			char c = *_pos;
+			if (c == '\n')
+			{
+				_atLineStart = true;
+				++_pos;
+			}
+			else if (isspace( uchar( c ) ))
+			{
+				++_pos;
+			}
+			else if (c == ';' || (c == '/' && _pos + 1 < _end && _pos[1] == '/'))
+			{
+				// line comment, the old MAPINFO uses semicolons for them
+				while (_pos < _end && *_pos != '\n')
+					++_pos;
+			}
+			else if (c == '/' && _pos + 1 < _end && _pos[1] == '*')
+			{
+				_pos += 2;
+				while (_pos < _end && !(_pos[0] == '*' && _pos + 1 < _end && _pos[1] == '/'))
+				{
+					if (*_pos == '\n')
+						_atLineStart = true;
+					++_pos;
+				}
+				_pos = std::min( _pos + 2, _end );
+			}
+			else
+			{
+				break;
+			}
+		}
+	}
+
+	const char * _pos;
+	const char * _end;
+	bool _atLineStart = true;
+
+};
+
+} // namespace
+
+
+//======================================================================================================================
+//  parser
+
+/// lump names are limited to 8 characters, anything longer is not a map name
+static constexpr qint64 MaxLumpNameLength = 8;
+
+static bool isNumber( const Token & token )
+{
+	for (qint64 i = 0; i < token.length; ++i)
+		if (!isdigit( uchar( token.begin[i] ) ))
+			return false;
+	return token.length > 0;
+}
+
+static void appendMapName( const Token & nameToken, QStringVec & mapNames )
+{
+	if (nameToken.length == 0 || nameToken.length > MaxLumpNameLength)
+		return;
+
+	if (isNumber( nameToken ))  // Hexen refers to the maps by numbers
+	{
+		int mapNum = QByteArray::fromRawData( nameToken.begin, int( nameToken.length ) ).toInt();
+		mapNames.append( QStringLiteral("MAP%1").arg( mapNum, 2, 10, QChar('0') ) );
+	}
+	else
+	{
+		mapNames.append( QString::fromLatin1( nameToken.begin, int( nameToken.length ) ).toUpper() );
+	}
+}
+
+void getMapNamesFromMapInfo( const char * data, qint64 size, QStringVec & mapNames )
+{
+	Tokenizer tokenizer( data, size );
+
+	int depth = 0;
+	bool prevWasCloseBrace = false;
+
+	for (Token token = tokenizer.next(); token.type != Token::End; token = tokenizer.next())
+	{
+		bool isCloseBrace = false;
+
+		if (token.type == Token::OpenBrace)
+		{
+			++depth;
+		}
+		else if (token.type == Token::CloseBrace)
+		{
+			depth = std::max( depth - 1, 0 );  // unbalanced braces in a broken lump shouldn't stop us from finding the rest
+			isCloseBrace = true;
+		}
+		// A definition starts at the top level, either on a new line (the old syntax has no braces)
+		// or right after the previous block. The same keyword inside a block would be a property of something else.
+		else if (token.type == Token::Word && depth == 0 && (token.startsLine || prevWasCloseBrace)
+		      && token.equalsIgnoreCase( "map" ))
+		{
+			Token nameToken = tokenizer.next();
+			if (nameToken.type == Token::Word || nameToken.type == Token::String)
+				appendMapName( nameToken, mapNames );
+			else if (nameToken.type == Token::OpenBrace)  // broken definition, but keep track of the nesting
+				++depth;
+			else if (nameToken.type == Token::End)
+				break;
+		}
+
+		prevWasCloseBrace = isCloseBrace;
+	}
+}
+
+
+} // namespace doom
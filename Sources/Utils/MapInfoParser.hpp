@@ -0,0 +1,35 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: extraction of map names from MAPINFO, ZMAPINFO and UMAPINFO lumps
+//======================================================================================================================
+
+#ifndef MAP_INFO_PARSER_INCLUDED
+#define MAP_INFO_PARSER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "CommonTypes.hpp"
+
+
+namespace doom {
+
+
+/// Finds the map definitions in a MAPINFO-like lump and appends the map lump names to the list.
+/**
+  * Understands the old line-based Hexen/ZDoom MAPINFO syntax (map MAP01 "Name" / map MAP01 lookup HUSTR_1),
+  * the block-based ZMAPINFO syntax (map MAP01 "Name" { ... }) and UMAPINFO (MAP MAP01 { levelname = "Name" }),
+  * including line and block comments. Hexen-style map numbers (map 1 "Name") are converted to MAPxx.
+  *
+  * It works directly on the raw bytes without any copying or regex, only the found names are allocated.
+  * All names are returned in upper case, because the engines treat lump names case-insensitively.
+  */
+void getMapNamesFromMapInfo( const char * data, qint64 size, QStringVec & mapNames );
+
+
+} // namespace doom
+
+
+#endif // MAP_INFO_PARSER_INCLUDED
@@ -17,6 +17,10 @@
 #include <QTextStream>
 #include <QLineEdit>
 #include <QStringBuilder>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include <algorithm>
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -145,6 +149,23 @@ void markItemAsDefault( const ReadOnlyListModelItem & item )
 	item.textColor = themes::getCurrentPalette().defaultEntryText;
 }
 
+bool markItemAsConflicting( const ReadOnlyListModelItem & item, const QString & description )
+{
+	bool changed = !item.isConflicting || item.toolTip != description;
+	item.isConflicting = true;
+	item.toolTip = description;
+	return changed;
+}
+
+bool unmarkItemAsConflicting( const ReadOnlyListModelItem & item )
+{
+	bool changed = item.isConflicting;
+	if (item.isConflicting)
+		item.toolTip.clear();
+	item.isConflicting = false;
+	return changed;
+}
+
 void unmarkItemAsDefault( const ReadOnlyListModelItem & item )
 {
 	item.textColor = themes::getCurrentPalette().color( QPalette::Text );
@@ -154,18 +175,34 @@ void unmarkItemAsDefault( const ReadOnlyListModelItem & item )
 //----------------------------------------------------------------------------------------------------------------------
 //  PathChecker
 
+static thread_local PathChecker::ErrorCollector * t_errorCollector = nullptr;
+
+PathChecker::ErrorCollector::ErrorCollector()
+	: _previous( t_errorCollector )
+{
+	t_errorCollector = this;
+}
+
+PathChecker::ErrorCollector::~ErrorCollector()
+{
+	t_errorCollector = _previous;
+}
+
 void PathChecker::_maybeShowError( bool & errorMessageDisplayed, QWidget * parent, QString title, QString message )
 {
 	if (!errorMessageDisplayed)
 	{
-		reportUserError( parent, title, message );
+		if (t_errorCollector)
+			t_errorCollector->_errors.append( std::move(message) );
+		else
+			reportUserError( parent, title, message );
 		errorMessageDisplayed = true;  // don't spam too many errors when something goes wrong
 	}
 }
 
 bool PathChecker::_checkPath(
 	const QString & path, EntryType expectedType, bool & errorMessageDisplayed,
-	QWidget * parent, QString subjectName, QString errorPostscript
+	QWidget * parent, QString subjectName, QString errorPostscript, const PathStatBatch * statBatch
 ){
 	if (path.isEmpty())
 	{
@@ -174,14 +211,15 @@ bool PathChecker::_checkPath(
 		return false;
 	}
 
-	return _checkNonEmptyPath( path, expectedType, errorMessageDisplayed, parent, subjectName, errorPostscript );
+	return _checkNonEmptyPath( path, expectedType, errorMessageDisplayed, parent, subjectName, errorPostscript, statBatch );
 }
 
 bool PathChecker::_checkNonEmptyPath(
 	const QString & path, EntryType expectedType, bool & errorMessageDisplayed,
-	QWidget * parent, QString subjectName, QString errorPostscript
+	QWidget * parent, QString subjectName, QString errorPostscript, const PathStatBatch * statBatch
 ){
-	if (!fs::exists( path ))
+	EntryKind entryKind = statBatch ? statBatch->getEntryKind( path ) : PathStatBatch::statEntry( path );
+	if (entryKind == EntryKind::Missing)
 	{
 		QString fileOrDir = correspondingValue( expectedType,
 			corresponds( EntryType::File, "File" ),
@@ -193,21 +231,20 @@ bool PathChecker::_checkNonEmptyPath(
 		return false;
 	}
 
-	return _checkCollision( path, expectedType, errorMessageDisplayed, parent, subjectName, errorPostscript );
+	return _checkCollision( path, entryKind, expectedType, errorMessageDisplayed, parent, subjectName, errorPostscript );
 }
 
 bool PathChecker::_checkCollision(
-	const QString & path, EntryType expectedType, bool & errorMessageDisplayed,
+	const QString & path, EntryKind entryKind, EntryType expectedType, bool & errorMessageDisplayed,
 	QWidget * parent, QString subjectName, QString errorPostscript
 ){
-	QFileInfo entry( path );
-	if (expectedType == EntryType::File && !entry.isFile())
+	if (expectedType == EntryType::File && entryKind != EntryKind::File)
 	{
 		_maybeShowError( errorMessageDisplayed, parent, "Path is a directory",
 			capitalize(subjectName)%" ("%path%") is a directory, but it should be a file. "%errorPostscript );
 		return false;
 	}
-	if (expectedType == EntryType::Dir && !entry.isDir())
+	if (expectedType == EntryType::Dir && entryKind != EntryKind::Dir)
 	{
 		_maybeShowError( errorMessageDisplayed, parent, "Path is a file",
 			capitalize(subjectName)%" ("%path%") is a file, but it should be a directory. "%errorPostscript );
@@ -217,6 +254,82 @@ bool PathChecker::_checkCollision(
 }
 
 
+//----------------------------------------------------------------------------------------------------------------------
+//  PathStatBatch
+
+// the threads mostly wait for the drive, so there can be more of them than CPU cores
+static constexpr int MaxStatThreads = 16;
+
+PathStatBatch::EntryKind PathStatBatch::statEntry( const QString & path )
+{
+	QFileInfo entry( path );
+	if (!entry.exists())
+		return EntryKind::Missing;
+	else if (entry.isFile())
+		return EntryKind::File;
+	else if (entry.isDir())
+		return EntryKind::Dir;
+	else
+		return EntryKind::Other;
+}
+
+void PathStatBatch::addPath( const QString & path )
+{
+	_paths.append( path );
+}
+
+void PathStatBatch::addPaths( const PathStatBatch & other )
+{
+	_paths.append( other._paths );
+}
+
+void PathStatBatch::statAll()
+{
+	_collecting = false;
+
+	// different commands mostly refer to the same files, one stat of each is enough
+	std::sort( _paths.begin(), _paths.end() );
+	_paths.erase( std::unique( _paths.begin(), _paths.end() ), _paths.end() );
+
+	// each thread writes only its own elements, so no locking is needed
+	QVector< EntryKind > kinds( _paths.size() );
+
+	// The threads are waiting for I/O, the pool size of the global instance is meant for computations.
+	QThreadPool threadPool;
+	threadPool.setMaxThreadCount( MaxStatThreads );
+	const int threadCount = std::min( int( _paths.size() ), MaxStatThreads );
+	for (int threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+	{
+		class StatTask : public QRunnable {
+			const QVector< QString > & _paths;
+			QVector< EntryKind > & _kinds;
+			int _first, _step;
+		 public:
+			StatTask( const QVector< QString > & paths, QVector< EntryKind > & kinds, int first, int step )
+				: _paths( paths ), _kinds( kinds ), _first( first ), _step( step ) {}
+			virtual void run() override
+			{
+				for (int i = _first; i < _paths.size(); i += _step)
+					_kinds[i] = statEntry( _paths[i] );
+			}
+		};
+		threadPool.start( new StatTask( _paths, kinds, threadIdx, threadCount ) );
+	}
+	threadPool.waitForDone();
+
+	_results.reserve( _paths.size() );
+	for (int i = 0; i < _paths.size(); ++i)
+		_results.insert( _paths[i], kinds[i] );
+	_paths.clear();
+}
+
+PathStatBatch::EntryKind PathStatBatch::getEntryKind( const QString & path ) const
+{
+	auto iter = _results.find( path );
+	return iter != _results.end() ? iter.value() : statEntry( path );
+}
+
+
 //----------------------------------------------------------------------------------------------------------------------
 //  other
 
@@ -16,6 +16,7 @@
 
 #include <QString>
 #include <QVector>
+#include <QHash>
 #include <QColor>
 
 class QLineEdit;
@@ -57,15 +58,66 @@ void unhighlightListItem( const ReadOnlyListModelItem & item );
 /// Marks this item as the default one.
 void markItemAsDefault( const ReadOnlyListModelItem & item );
 
+/// Marks this item as conflicting with other items and describes the conflicts in its tool tip.
+/** Items highlighted as invalid stay highlighted that way, it's the more important information.
+  * Returns whether the marking has changed, so that the views are notified only when needed. */
+bool markItemAsConflicting( const ReadOnlyListModelItem & item, const QString & description );
+/// Removes the marking made by markItemAsConflicting(), if there is one. Returns whether there was one.
+bool unmarkItemAsConflicting( const ReadOnlyListModelItem & item );
+
 /// Removes the default item marking.
 void unmarkItemAsDefault( const ReadOnlyListModelItem & item );
 
 
+/// Types of many entries found out at once, so that the PathChecker doesn't have to wait for each file one after another.
+/**
+  * On a network drive, most of the time needed to verify the paths of a big preset is spent waiting for the individual
+  * stats. So the PathChecker is first run with this batch in the collecting state, where it only records the paths
+  * and doesn't check anything. Then statAll() stats all the collected paths in parallel, and the PathChecker is
+  * run again with the results, without touching the file system.
+  */
+class PathStatBatch {
+
+ public:
+
+	enum class EntryKind : uint8_t
+	{
+		Missing,
+		File,
+		Dir,
+		Other,  ///< exists, but it's neither a file nor a directory
+	};
+
+	static EntryKind statEntry( const QString & path );
+
+	bool isCollecting() const  { return _collecting; }
+
+	void addPath( const QString & path );
+
+	/// Adds the paths collected by another batch, so that the paths of many commands can be stated in a single pass.
+	void addPaths( const PathStatBatch & other );
+
+	/// Stats all the collected paths in worker threads and blocks until all of them are finished.
+	void statAll();
+
+	/// Returns the result collected by statAll(), or stats the entry if it was not collected.
+	EntryKind getEntryKind( const QString & path ) const;
+
+ private:
+
+	bool _collecting = true;
+	QVector< QString > _paths;
+	QHash< QString, EntryKind > _results;
+
+};
+
 class PathChecker {
 
 	QWidget * parent;
 	bool verificationRequired;
 	bool errorMessageDisplayed = false;
+	bool itemHighlightingEnabled = true;
+	PathStatBatch * statBatch;
 
  private: // internal D.R.Y. helpers
 
@@ -78,44 +130,66 @@ class PathChecker {
 
 	static void _maybeShowError( bool & errorMessageDisplayed, QWidget * parent, QString title, QString message );
 
+	using EntryKind = PathStatBatch::EntryKind;
+
 	static bool _checkPath( const QString & path, EntryType expectedType, bool & errorMessageDisplayed,
-	                        QWidget * parent, QString subjectName, QString errorPostscript );
+	                        QWidget * parent, QString subjectName, QString errorPostscript, const PathStatBatch * statBatch = nullptr );
 	static bool _checkNonEmptyPath( const QString & path, EntryType expectedType, bool & errorMessageDisplayed,
-	                                QWidget * parent, QString subjectName, QString errorPostscript );
-	static bool _checkCollision( const QString & path, EntryType expectedType, bool & errorMessageDisplayed,
+	                                QWidget * parent, QString subjectName, QString errorPostscript, const PathStatBatch * statBatch = nullptr );
+	static bool _checkCollision( const QString & path, EntryKind entryKind, EntryType expectedType, bool & errorMessageDisplayed,
 	                             QWidget * parent, QString subjectName, QString errorPostscript );
 
-	bool _checkPath( const QString & path, EntryType expectedType, QString subjectName, QString errorPostscript )
+	/// Returns true if the path should not be checked now.
+	bool _skipCheck( const QString & path )
 	{
 		if (!verificationRequired)
 			return true;
 
-		return _checkPath( path, expectedType, errorMessageDisplayed, parent, subjectName, errorPostscript );
+		if (statBatch && statBatch->isCollecting())
+		{
+			if (!path.isEmpty())
+				statBatch->addPath( path );
+			return true;
+		}
+
+		return false;
+	}
+
+	bool _checkPath( const QString & path, EntryType expectedType, QString subjectName, QString errorPostscript )
+	{
+		if (_skipCheck( path ))
+			return true;
+
+		return _checkPath( path, expectedType, errorMessageDisplayed, parent, subjectName, errorPostscript, statBatch );
 	}
 
 	template< typename ListItem >
 	bool _checkItemPath( ListItem & item, EntryType expectedType, QString subjectName, QString errorPostscript )
 	{
-		if (!verificationRequired)
+		if (_skipCheck( item.getFilePath() ))
 			return true;
 
-		bool verified = _checkPath( item.getFilePath(), expectedType, errorMessageDisplayed, parent, subjectName, errorPostscript );
-		if (!verified)
-			highlightInvalidListItem( item );
-		else
-			unhighlightListItem( item );
+		bool verified = _checkPath( item.getFilePath(), expectedType, errorMessageDisplayed, parent, subjectName, errorPostscript, statBatch );
+		if (itemHighlightingEnabled)
+		{
+			if (!verified)
+				highlightInvalidListItem( item );
+			else
+				unhighlightListItem( item );
+		}
 		return verified;
 	}
 
 	bool _checkCollision( const QString & path, EntryType expectedType, QString subjectName, QString errorPostscript )
 	{
-		if (!verificationRequired)
+		if (_skipCheck( path ) || path.isEmpty())
 			return true;
 
-		if (path.isEmpty() || !fs::exists( path ))
+		EntryKind entryKind = statBatch ? statBatch->getEntryKind( path ) : PathStatBatch::statEntry( path );
+		if (entryKind == EntryKind::Missing)
 			return true;
 
-		return _checkCollision( path, expectedType, errorMessageDisplayed, parent, subjectName, errorPostscript );
+		return _checkCollision( path, entryKind, expectedType, errorMessageDisplayed, parent, subjectName, errorPostscript );
 	}
 
  public: // context-free
@@ -152,8 +226,14 @@ class PathChecker {
 
  public: // context-sensitive (depend on settings from constructor)
 
-	PathChecker( QWidget * parent, bool verificationRequired )
-		: parent( parent ), verificationRequired( verificationRequired ) {}
+	/// If the statBatch is in the collecting state, the paths are only recorded into it and nothing is checked,
+	/// otherwise the checks use its results.
+	PathChecker( QWidget * parent, bool verificationRequired, PathStatBatch * statBatch = nullptr )
+		: parent( parent ), verificationRequired( verificationRequired ), statBatch( statBatch ) {}
+
+	/// The list items with invalid paths are highlighted by default, which reads the palette of the current theme,
+	/// so checkers running outside of the main thread must disable it.
+	void toggleItemHighlighting( bool enabled )  { itemHighlightingEnabled = enabled; }
 
 	bool checkAnyPath( const QString & path, QString subjectName, QString errorPostscript )
 	{
@@ -198,11 +278,36 @@ class PathChecker {
 		return _checkItemPath( item, EntryType::Dir, subjectName, errorPostscript );
 	}
 
+	bool isVerificationRequired() const
+	{
+		return verificationRequired;
+	}
+
 	bool gotSomeInvalidPaths() const
 	{
 		return errorMessageDisplayed;
 	}
 
+	/// While it exists, the PathCheckers of the current thread store their error messages into it instead of showing them.
+	/** Worker threads must not show message boxes, the messages have to be reported later from the main thread. */
+	class ErrorCollector {
+
+	 public:
+
+		ErrorCollector();
+		~ErrorCollector();
+
+		const QStringVec & errors() const  { return _errors; }
+
+	 private:
+
+		friend class PathChecker;
+
+		QStringVec _errors;
+		ErrorCollector * _previous;
+
+	};
+
 };
 
 
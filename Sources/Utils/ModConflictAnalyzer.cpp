@@ -0,0 +1,192 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: finding the mods that override each other's lumps, in a background thread
+//======================================================================================================================
+
+#include "ModConflictAnalyzer.hpp"
+
+#include "WADReader.hpp"  // g_cachedLumpNames
+#include "FileSystemUtils.hpp"  // getFileNameFromPath
+#include "TimeStats.hpp"
+
+#include <QRunnable>
+#include <QPointer>
+#include <QCoreApplication>
+#include <QStringBuilder>
+#include <QSet>
+
+
+namespace doom {
+
+
+static constexpr int MaxExampleLumps = 5;
+
+/// Results of the pairs of files that are no longer in the load order are kept up to this count,
+/// so that unchecking and checking a mod again doesn't compare it again.
+static constexpr int MaxPairResults = 4096;
+
+
+//======================================================================================================================
+
+ModConflictAnalyzer::ModConflictAnalyzer() : LoggingComponent("ModConflictAnalyzer")
+{
+	_threadPool.setMaxThreadCount( 1 );
+}
+
+ModConflictAnalyzer::~ModConflictAnalyzer()
+{
+	_threadPool.clear();
+	_threadPool.waitForDone();  // the task refers to this object
+}
+
+void ModConflictAnalyzer::analyze( const QStringVec & loadOrder, QObject * context, Callback callback )
+{
+	class AnalyzeTask : public QRunnable {
+
+		ModConflictAnalyzer * _owner;
+		quint64 _requestID;
+		QStringVec _loadOrder;
+		QPointer< QObject > _context;
+		Callback _callback;
+
+	 public:
+
+		AnalyzeTask( ModConflictAnalyzer * owner, quint64 requestID, QStringVec loadOrder, QObject * context, Callback callback )
+			: _owner( owner ), _requestID( requestID ), _loadOrder( std::move(loadOrder) ), _context( context ), _callback( std::move(callback) ) {}
+
+		virtual void run() override
+		{
+			// the user is still clicking, only the last state matters
+			if (_requestID != _owner->_latestRequestID)
+				return;
+
+			Conflicts conflicts = _owner->computeConflicts( _loadOrder );
+
+			QCoreApplication * app = QCoreApplication::instance();
+			if (!app)
+				return;
+			QMetaObject::invokeMethod( app,
+				[ owner = _owner, requestID = _requestID, context = _context, callback = std::move(_callback), conflicts = std::move(conflicts) ]()
+			{
+				// the owner lives in the main thread, so it's either still alive or the context is gone too
+				if (context && requestID == owner->_latestRequestID)
+					callback( conflicts );
+			}, Qt::QueuedConnection );
+		}
+
+	};
+
+	quint64 requestID = ++_latestRequestID;
+	_threadPool.start( new AnalyzeTask( this, requestID, loadOrder, context, std::move(callback) ) );
+}
+
+ModConflictAnalyzer::Conflicts ModConflictAnalyzer::computeConflicts( const QStringVec & loadOrder )
+{
+	ScopeTimer timer( "analyzing mod conflicts", /*reportThresholdMs*/10 );
+
+	// the same file can be in the load order more than once, it doesn't conflict with itself
+	QVector< UncertainLumpNameSet > lumpNames;
+	lumpNames.reserve( loadOrder.size() );
+	for (const QString & filePath : loadOrder)
+		lumpNames.append( g_cachedLumpNames.getFileInfo( filePath ) );
+
+	Conflicts conflicts;
+	QSet< QString > usedPairs;
+	int comparedPairs = 0;
+
+	for (qsizetype i = 0; i < loadOrder.size(); ++i)
+	{
+		if (lumpNames[i].status != ReadStatus::Success || lumpNames[i].names.isEmpty())
+			continue;
+
+		for (qsizetype j = i + 1; j < loadOrder.size(); ++j)
+		{
+			if (lumpNames[j].status != ReadStatus::Success || lumpNames[j].names.isEmpty() || loadOrder[i] == loadOrder[j])
+				continue;
+
+			// the result doesn't depend on the order, so it's stored under the alphabetical order of the paths
+			bool swapped = loadOrder[j] < loadOrder[i];
+			const QString & firstPath = swapped ? loadOrder[j] : loadOrder[i];
+			const QString & secondPath = swapped ? loadOrder[i] : loadOrder[j];
+			const LumpNameSet & firstNames = swapped ? lumpNames[j] : lumpNames[i];
+			const LumpNameSet & secondNames = swapped ? lumpNames[i] : lumpNames[j];
+
+			QString pairKey = firstPath % '\n' % secondPath;
+			usedPairs.insert( pairKey );
+
+			auto resultIter = _pairResults.find( pairKey );
+			if (resultIter == _pairResults.end()
+			 || resultIter->contentHash1 != firstNames.contentHash || resultIter->contentHash2 != secondNames.contentHash)
+			{
+				// both lists are sorted, so a single pass through them finds all the common names
+				PairResult result = { firstNames.contentHash, secondNames.contentHash, 0, {} };
+				auto iter1 = firstNames.names.begin();
+				auto iter2 = secondNames.names.begin();
+				while (iter1 != firstNames.names.end() && iter2 != secondNames.names.end())
+				{
+					if (*iter1 < *iter2)
+						++iter1;
+					else if (*iter2 < *iter1)
+						++iter2;
+					else
+					{
+						if (result.exampleLumps.size() < MaxExampleLumps)
+							result.exampleLumps.append( *iter1 );
+						result.lumpCount++;
+						++iter1;
+						++iter2;
+					}
+				}
+				resultIter = _pairResults.insert( pairKey, std::move(result) );
+				comparedPairs++;
+			}
+
+			if (resultIter->lumpCount > 0)
+			{
+				conflicts[ loadOrder[i] ].append({ loadOrder[j], /*otherIsLater*/true, resultIter->lumpCount, resultIter->exampleLumps });
+				conflicts[ loadOrder[j] ].append({ loadOrder[i], /*otherIsLater*/false, resultIter->lumpCount, resultIter->exampleLumps });
+			}
+		}
+	}
+
+	if (_pairResults.size() > MaxPairResults)
+	{
+		for (auto iter = _pairResults.begin(); iter != _pairResults.end(); )
+		{
+			if (!usedPairs.contains( iter.key() ))
+				iter = _pairResults.erase( iter );
+			else
+				++iter;
+		}
+	}
+
+	logDebug() << "compared " << comparedPairs << " pairs of files, " << conflicts.size() << " files have conflicts";
+
+	return conflicts;
+}
+
+QString ModConflictAnalyzer::describeConflicts( const QVector< Conflict > & conflicts )
+{
+	QString description;
+	for (const Conflict & conflict : conflicts)
+	{
+		if (!description.isEmpty())
+			description += '\n';
+		QString otherFileName = fs::getFileNameFromPath( conflict.otherPath );
+		QString lumps;
+		for (const QString & lumpName : conflict.exampleLumps)
+			lumps += (lumps.isEmpty() ? "" : ", ") + lumpName;
+		if (conflict.lumpCount > conflict.exampleLumps.size())
+			lumps += ", ...";
+		if (conflict.otherIsLater)
+			description += QStringLiteral("%1 lumps are replaced by %2 (%3)").arg( conflict.lumpCount ).arg( otherFileName, lumps );
+		else
+			description += QStringLiteral("Replaces %1 lumps of %2 (%3)").arg( conflict.lumpCount ).arg( otherFileName, lumps );
+	}
+	return description;
+}
+
+
+} // namespace doom
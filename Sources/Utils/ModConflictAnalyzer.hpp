@@ -0,0 +1,88 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: finding the mods that override each other's lumps, in a background thread
+//======================================================================================================================
+
+#ifndef MOD_CONFLICT_ANALYZER_INCLUDED
+#define MOD_CONFLICT_ANALYZER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "CommonTypes.hpp"  // QStringVec
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QObject>
+#include <QThreadPool>
+
+#include <functional>
+#include <atomic>
+
+
+namespace doom {
+
+
+//======================================================================================================================
+/// Finds out which files of a load order contain the same lumps, so that the later ones replace them in the earlier ones.
+/**
+  * The lump names of each file are read through g_cachedLumpNames, so a file is read only once until it changes.
+  * The results of each pair of files are kept as well, so when a mod is checked or unchecked, only that mod is compared
+  * with the rest, and reordering the mods doesn't compare anything at all.
+  *
+  * Must be used from the main thread, the callback is called in the main thread.
+  */
+class ModConflictAnalyzer : protected LoggingComponent {
+
+ public:
+
+	/// lumps shared by a file with one other file of the load order
+	struct Conflict
+	{
+		QString otherPath;
+		bool otherIsLater;        ///< the other file replaces the lumps of this one, otherwise this one replaces the other's
+		int lumpCount;
+		QStringVec exampleLumps;  ///< first few of the shared lump names
+	};
+	using Conflicts = QHash< QString, QVector< Conflict > >;  ///< key is the file path, only the files with a conflict are present
+
+	using Callback = std::function< void ( const Conflicts & conflicts ) >;
+
+	ModConflictAnalyzer();
+	~ModConflictAnalyzer();
+
+	/// Compares the files in a worker thread and calls the callback in the main thread with the result.
+	/** The callback is not called when the context is destroyed or another analysis is started in the meantime. */
+	void analyze( const QStringVec & loadOrder, QObject * context, Callback callback );
+
+	/// Makes a text for the user, one line per conflicting file.
+	static QString describeConflicts( const QVector< Conflict > & conflicts );
+
+ private:
+
+	struct PairResult
+	{
+		quint64 contentHash1;  ///< of the lump names of the file that is first in the key
+		quint64 contentHash2;
+		int lumpCount;
+		QStringVec exampleLumps;
+	};
+
+	/// Runs in the worker thread.
+	Conflicts computeConflicts( const QStringVec & loadOrder );
+
+	QThreadPool _threadPool;  ///< single thread, so that the analyses don't compete for the pair results
+	QHash< QString, PairResult > _pairResults;  ///< key is both paths in alphabetical order, accessed only by the worker
+	std::atomic< quint64 > _latestRequestID { 0 };
+
+};
+
+
+} // namespace doom
+
+
+#endif // MOD_CONFLICT_ANALYZER_INCLUDED
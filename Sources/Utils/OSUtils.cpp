@@ -123,6 +123,19 @@ QString getThisAppDataDir()
  #endif
 }
 
+QString getSharedThisAppDataDir()
+{
+ #if IS_WINDOWS
+	QString programDataDir = qEnvironmentVariable( "ProgramData" );  // C:\ProgramData
+	if (programDataDir.isEmpty())
+		programDataDir = QDir::rootPath() % "ProgramData";
+	return QDir::fromNativeSeparators( programDataDir ) % '/' % QApplication::applicationName();
+ #else
+	// unlike /tmp this survives reboots, and unlike /var/cache it's writable by everyone
+	return "/var/tmp/" % QApplication::applicationName();
+ #endif
+}
+
 
 //-- cached variants -------------------------------------------------------------------------------
 // We don't use local static variables, because those use a mutex to prevent initialization by multiple threads.
@@ -262,12 +275,17 @@ inline static QString fixExePath( QString exePath )
 
 ShellCommand getRunCommand(
 	const QString & executablePath, const PathRebaser & currentDirToNewWorkingDir, const QStringVec & dirsToBeAccessed
+){
+	return getRunCommand( executablePath, getSandboxInfo( executablePath ), currentDirToNewWorkingDir, dirsToBeAccessed );
+}
+
+ShellCommand getRunCommand(
+	const QString & executablePath, const SandboxInfo & traits,
+	const PathRebaser & currentDirToNewWorkingDir, const QStringVec & dirsToBeAccessed
 ){
 	ShellCommand cmd;
 	QStringVec cmdParts;
 
-	SandboxInfo traits = getSandboxInfo( executablePath );
-
 	// different installations require different ways to launch the program executable
  #ifdef FLATPAK_BUILD
 	if (fs::getAbsoluteDirOfFile( executablePath ) == QApplication::applicationDirPath())
@@ -341,6 +359,9 @@ QVector< MonitorInfo > listMonitors()
 	{
 		MonitorInfo myInfo;
 		myInfo.name = screens[ monitorIdx ]->name();
+		myInfo.serialNumber = screens[ monitorIdx ]->serialNumber();
+		myInfo.x = screens[ monitorIdx ]->geometry().x();
+		myInfo.y = screens[ monitorIdx ]->geometry().y();
 		myInfo.width = screens[ monitorIdx ]->size().width();
 		myInfo.height = screens[ monitorIdx ]->size().height();
 		myInfo.isPrimary = monitorIdx == 0;
@@ -350,6 +371,69 @@ QVector< MonitorInfo > listMonitors()
 	return monitors;
 }
 
+static QVector< MonitorInfo > g_cachedMonitors;
+static bool g_cachedMonitorsValid = false;
+static bool g_monitorSignalsConnected = false;
+
+static void invalidateMonitors()
+{
+	g_cachedMonitorsValid = false;
+}
+
+static void connectMonitorSignals()
+{
+	if (g_monitorSignalsConnected)
+		return;
+	g_monitorSignalsConnected = true;
+
+	// the connections are made before any watchMonitorChanges() callback and the callbacks are queued,
+	// so the cache is always invalidated before anyone is notified
+	auto connectScreen = []( QScreen * screen )
+	{
+		QObject::connect( screen, &QScreen::geometryChanged, qApp, invalidateMonitors );
+	};
+	for (QScreen * screen : QGuiApplication::screens())
+		connectScreen( screen );
+	QObject::connect( qApp, &QGuiApplication::screenAdded, qApp, [ connectScreen ]( QScreen * screen )
+	{
+		invalidateMonitors();
+		connectScreen( screen );
+	});
+	QObject::connect( qApp, &QGuiApplication::screenRemoved, qApp, invalidateMonitors );
+	QObject::connect( qApp, &QGuiApplication::primaryScreenChanged, qApp, invalidateMonitors );
+}
+
+const QVector< MonitorInfo > & getMonitors()
+{
+	connectMonitorSignals();
+	if (!g_cachedMonitorsValid)
+	{
+		g_cachedMonitors = listMonitors();
+		g_cachedMonitorsValid = true;
+	}
+	return g_cachedMonitors;
+}
+
+void watchMonitorChanges( QObject * context, std::function< void () > onChange )
+{
+	connectMonitorSignals();
+
+	auto notify = [ onChange ]() { onChange(); };
+	auto connectScreen = [ context, notify ]( QScreen * screen )
+	{
+		QObject::connect( screen, &QScreen::geometryChanged, context, notify, Qt::QueuedConnection );
+	};
+	for (QScreen * screen : QGuiApplication::screens())
+		connectScreen( screen );
+	QObject::connect( qApp, &QGuiApplication::screenAdded, context, [ context, connectScreen, notify ]( QScreen * screen )
+	{
+		connectScreen( screen );  // right away, the screen might be gone by the time a queued call gets to it
+		QMetaObject::invokeMethod( context, notify, Qt::QueuedConnection );
+	});
+	QObject::connect( qApp, &QGuiApplication::screenRemoved, context, notify, Qt::QueuedConnection );
+	QObject::connect( qApp, &QGuiApplication::primaryScreenChanged, context, notify, Qt::QueuedConnection );
+}
+
 
 //======================================================================================================================
 //  miscellaneous
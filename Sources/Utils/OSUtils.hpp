@@ -15,8 +15,12 @@
 #include <QString>
 #include <QList>
 #include <QVector>
+#include <QMetaType>
+
+#include <functional>
 
 class PathRebaser;
+class QObject;
 
 
 namespace os {
@@ -54,6 +58,10 @@ QString getThisAppConfigDir();
 /// Returns directory where this application should save its data files. This may be the same as the config dir.
 QString getThisAppDataDir();
 
+/// Returns directory where all the installations of this application and all the users of this machine
+/// can store the data they share.
+QString getSharedThisAppDataDir();
+
 
 // cached variants of the functions above for standard directories that might be expensive to get
 
@@ -111,6 +119,11 @@ struct ShellCommand
 ShellCommand getRunCommand(
 	const QString & executablePath, const PathRebaser & currentDirToNewWorkingDir, const QStringVec & dirsToBeAccessed = {}
 );
+/// Same as above, but uses the sandbox info that has already been determined, instead of matching the path again.
+ShellCommand getRunCommand(
+	const QString & executablePath, const SandboxInfo & sandbox,
+	const PathRebaser & currentDirToNewWorkingDir, const QStringVec & dirsToBeAccessed = {}
+);
 
 
 //======================================================================================================================
@@ -123,12 +136,24 @@ const QString & getLinuxDesktopEnv();
 struct MonitorInfo
 {
 	QString name;
+	QString serialNumber;  ///< empty if the system doesn't provide it
+	int x;  ///< position on the virtual desktop
+	int y;
 	int width;
 	int height;
 	bool isPrimary;
 };
+/// Enumerates the monitors again, prefer getMonitors().
 QVector< MonitorInfo > listMonitors();
 
+/// Returns the monitor list from the last enumeration, it is enumerated again only after the screen configuration changes.
+/** Must be called from the main thread. The index in this list is what EngineTraits::getCmdMonitorIndex() expects. */
+const QVector< MonitorInfo > & getMonitors();
+
+/// Calls the callback (queued, in the context's thread) whenever a screen is added, removed or changes its resolution.
+/** When the callback is called, getMonitors() already returns the new list. */
+void watchMonitorChanges( QObject * context, std::function< void () > onChange );
+
 
 //======================================================================================================================
 //  miscellaneous
@@ -155,10 +180,16 @@ struct EnvVar
 {
 	QString name;
 	QString value;
+
+	friend bool operator==( const EnvVar & a, const EnvVar & b )  { return a.name == b.name && a.value == b.value; }
+	friend bool operator!=( const EnvVar & a, const EnvVar & b )  { return !(a == b); }
 };
 
 
 } // namespace os
 
+// so that a monitor can be remembered in the data of a combo-box item
+Q_DECLARE_METATYPE( os::MonitorInfo )
+
 
 #endif // OS_UTILS_INCLUDED
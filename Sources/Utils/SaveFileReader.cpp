@@ -0,0 +1,191 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: extraction of the information about a saved game from a save file
+//======================================================================================================================
+
+#include "SaveFileReader.hpp"
+
+#include "ZipReader.hpp"
+#include "JsonUtils.hpp"
+#include "ErrorHandling.hpp"
+
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QStringBuilder>
+#include <QtEndian>
+
+#include <algorithm>
+
+
+namespace doom {
+
+
+//======================================================================================================================
+
+FileInfoCache< SaveInfo > g_cachedSaveInfo( readSaveInfo );
+
+/// The info entry only contains a few strings, anything bigger is not what we are looking for.
+static constexpr qint64 MaxInfoSize = 1 * 1024 * 1024;
+
+static const char InfoEntryName [] = "info.json";
+static const char PngSignature [] = "\x89PNG\r\n\x1A\n";
+
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The engines put the level name and the time into a single human-readable comment.
+static void parseComment( const QString & comment, SaveInfo & saveInfo )
+{
+	QString firstLine = comment.section( '\n', 0, 0 ).trimmed();
+	QString mapPrefix = saveInfo.mapName % " - ";
+	saveInfo.levelName = !saveInfo.mapName.isEmpty() && firstLine.startsWith( mapPrefix, Qt::CaseInsensitive )
+		? firstLine.mid( mapPrefix.size() )
+		: firstLine;
+
+	static const QRegularExpression timeRegex("\\d+:\\d\\d:\\d\\d");
+	QRegularExpressionMatch timeMatch = timeRegex.match( comment );
+	if (timeMatch.hasMatch())
+		saveInfo.levelTime = timeMatch.captured();
+}
+
+static void readSaveInfoFromZip( const QString & filePath, QFile & file, UncertainSaveInfo & saveInfo )
+{
+	zip::ArchiveReader archive( file );
+	QVector< zip::Entry > entries;
+	saveInfo.status = archive.readEntries( entries );
+	if (saveInfo.status != ReadStatus::Success)
+		return;
+
+	auto infoEntryIter = std::find_if( entries.begin(), entries.end(), []( const zip::Entry & entry )
+	{
+		return entry.name.compare( InfoEntryName, Qt::CaseInsensitive ) == 0;
+	});
+	if (infoEntryIter == entries.end())
+	{
+		saveInfo.status = ReadStatus::InfoNotPresent;
+		return;
+	}
+
+	QByteArray content;
+	saveInfo.status = archive.readContent( *infoEntryIter, content, MaxInfoSize );
+	if (saveInfo.status != ReadStatus::Success)
+		return;
+
+	QJsonParseError error;
+	QJsonDocument jsonDoc = QJsonDocument::fromJson( content, &error );
+	if (!jsonDoc.isObject())
+	{
+		logRuntimeError("SaveFileReader").noquote() << "Failed to parse info.json of \""<<filePath<<"\": "<<error.errorString();
+		saveInfo.status = ReadStatus::InvalidFormat;
+		return;
+	}
+	QJsonObject jsInfo = jsonDoc.object();
+
+	saveInfo.title = jsInfo.value("Title").toString();
+	saveInfo.mapName = jsInfo.value("Current Map").toString();
+	saveInfo.creationTime = jsInfo.value("Creation Time").toString();
+	parseComment( jsInfo.value("Comment").toString(), saveInfo );
+}
+
+//  https://www.w3.org/TR/png/#5Chunk-layout
+
+static void readSaveInfoFromPng( QFile & file, UncertainSaveInfo & saveInfo )
+{
+	// each chunk is: 4B length, 4B type, data, 4B checksum
+	QHash< QString, QString > texts;
+	qint64 chunkPos = sizeof(PngSignature) - 1;
+	while (file.seek( chunkPos ))
+	{
+		QByteArray chunkHeader = file.read( 8 );
+		if (chunkHeader.size() < 8)
+			break;
+
+		const quint32 dataLength = qFromBigEndian< quint32 >( chunkHeader.constData() );
+		const QByteArray chunkType = chunkHeader.mid( 4, 4 );
+		if (chunkType == "IEND")
+			break;
+
+		// only the small text chunks are read, the image data are skipped
+		if (chunkType == "tEXt" && dataLength <= MaxInfoSize)
+		{
+			QByteArray data = file.read( dataLength );
+			int separatorPos = data.indexOf('\0');
+			if (separatorPos > 0)
+				texts.insert( QString::fromLatin1( data.left( separatorPos ) ), QString::fromUtf8( data.mid( separatorPos + 1 ) ) );
+		}
+
+		chunkPos += 8 + qint64( dataLength ) + 4;
+	}
+
+	if (!texts.contains("Title") && !texts.contains("Current Map"))
+	{
+		saveInfo.status = ReadStatus::InfoNotPresent;
+		return;
+	}
+
+	saveInfo.title = texts.value("Title");
+	saveInfo.mapName = texts.value("Current Map");
+	saveInfo.creationTime = texts.value("Creation Time");
+	parseComment( texts.value("Comment"), saveInfo );
+	saveInfo.status = ReadStatus::Success;
+}
+
+
+//======================================================================================================================
+//  public API
+
+UncertainSaveInfo readSaveInfo( const QString & filePath )
+{
+	UncertainSaveInfo saveInfo;
+
+	QFile file( filePath );
+	if (!file.open( QIODevice::ReadOnly ))
+	{
+		logRuntimeError("SaveFileReader").noquote() << "Cannot open \""<<filePath<<"\": "<<file.errorString();
+		saveInfo.status = ReadStatus::CantOpen;
+		return saveInfo;
+	}
+
+	QByteArray fileStart = file.peek( sizeof(PngSignature) - 1 );
+	if (zip::hasZipSignature( fileStart ))
+	{
+		readSaveInfoFromZip( filePath, file, saveInfo );
+	}
+	else if (fileStart == QByteArray( PngSignature, sizeof(PngSignature) - 1 ))
+	{
+		readSaveInfoFromPng( file, saveInfo );
+	}
+	else
+	{
+		saveInfo.status = ReadStatus::NotSupported;
+	}
+
+	return saveInfo;
+}
+
+void SaveInfo::serialize( QJsonObject & jsSaveInfo ) const
+{
+	jsSaveInfo["title"] = title;
+	jsSaveInfo["map_name"] = mapName;
+	jsSaveInfo["level_name"] = levelName;
+	jsSaveInfo["level_time"] = levelTime;
+	jsSaveInfo["creation_time"] = creationTime;
+}
+
+void SaveInfo::deserialize( const JsonObjectCtx & jsSaveInfo )
+{
+	title = jsSaveInfo.getString( "title", {}, DontShowError );
+	mapName = jsSaveInfo.getString( "map_name", {}, DontShowError );
+	levelName = jsSaveInfo.getString( "level_name", {}, DontShowError );
+	levelTime = jsSaveInfo.getString( "level_time", {}, DontShowError );
+	creationTime = jsSaveInfo.getString( "creation_time", {}, DontShowError );
+}
+
+
+} // namespace doom
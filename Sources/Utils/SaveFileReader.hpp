@@ -0,0 +1,54 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: extraction of the information about a saved game from a save file
+//======================================================================================================================
+
+#ifndef SAVE_FILE_READER_INCLUDED
+#define SAVE_FILE_READER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "FileInfoCache.hpp"
+
+#include <QString>
+
+class QJsonObject;
+class JsonObjectCtx;
+
+
+namespace doom {
+
+
+//======================================================================================================================
+
+struct SaveInfo
+{
+	QString title;         ///< description entered by the user when saving
+	QString mapName;       ///< lump name of the map, e.g. MAP01
+	QString levelName;     ///< e.g. Entryway
+	QString levelTime;     ///< time spent in the level, as h:mm:ss
+	QString creationTime;  ///< as written by the engine, it's not meant to be parsed
+
+	void serialize( QJsonObject & jsSaveInfo ) const;
+	void deserialize( const JsonObjectCtx & jsSaveInfo );
+};
+
+using UncertainSaveInfo = UncertainFileInfo< SaveInfo >;
+
+/// Reads the description of a saved game from a ZDoom save file.
+/** The current saves are ZIP archives, only their central directory and the small info.json entry are read.
+  * The old ones (before GZDoom 3) are PNG files with the information in text chunks, only the chunk headers are read
+  * to find them. Other formats return NotSupported. */
+UncertainSaveInfo readSaveInfo( const QString & filePath );
+
+
+extern FileInfoCache< SaveInfo > g_cachedSaveInfo;
+
+
+} // namespace doom
+
+
+#endif // SAVE_FILE_READER_INCLUDED
@@ -0,0 +1,1244 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: 7z archive parsing (pk7 and similar) without extracting the whole archive
+//======================================================================================================================
+
+#include "SevenZipReader.hpp"
+
+#include <QFile>
+#include <QtEndian>
+
+#include <vector>
+#include <algorithm>
+#include <iterator>  // begin, end
+#include <cstring>  // memcpy
+
+
+namespace sevenzip {
+
+
+//======================================================================================================================
+//  decompression
+
+//  https://www.7-zip.org/sdk.html - DOC/lzma-specification.txt
+//  The structure follows the reference decoder LzmaSpec.cpp from the LZMA SDK. Just like with the ZIP inflater,
+//  we only ever decompress the archive header and a few KB of text with it, so it's not worth depending on liblzma.
+
+static constexpr int NumBitModelTotalBits = 11;
+static constexpr uint BitModelTotal = 1u << NumBitModelTotalBits;
+static constexpr int NumMoveBits = 5;
+static constexpr uint16_t ProbInitValue = BitModelTotal / 2;
+
+class RangeDecoder {
+
+ public:
+
+	bool init( const uchar * in, qint64 inSize )
+	{
+		_in = in;
+		_inSize = inSize;
+		_inPos = 0;
+		_error = false;
+		_range = 0xFFFFFFFF;
+		_code = 0;
+
+		if (nextByte() != 0)
+			return false;
+		for (int i = 0; i < 4; ++i)
+			_code = (_code << 8) | nextByte();
+		return !_error && _code != _range;
+	}
+
+	bool hasError() const   { return _error; }
+
+	uint decodeBit( uint16_t & prob )
+	{
+		uint32_t bound = (_range >> NumBitModelTotalBits) * prob;
+		uint symbol;
+		if (_code < bound)
+		{
+			prob = uint16_t( prob + ((BitModelTotal - prob) >> NumMoveBits) );
+			_range = bound;
+			symbol = 0;
+		}
+		else
+		{
+			prob = uint16_t( prob - (prob >> NumMoveBits) );
+			_code -= bound;
+			_range -= bound;
+			symbol = 1;
+		}
+		normalize();
+		return symbol;
+	}
+
+	uint32_t decodeDirectBits( int numBits )
+	{
+		uint32_t result = 0;
+		do
+		{
+			_range >>= 1;
+			_code -= _range;
+			uint32_t t = 0 - (_code >> 31);
+			_code += _range & t;
+			if (_code == _range)
+				_error = true;  // corrupted data
+			normalize();
+			result <<= 1;
+			result += t + 1;
+		}
+		while (--numBits);
+		return result;
+	}
+
+ private:
+
+	static constexpr uint32_t TopValue = 1u << 24;
+
+	uchar nextByte()
+	{
+		if (_inPos >= _inSize)
+		{
+			_error = true;  // ran out of input
+			return 0;
+		}
+		return _in[ _inPos++ ];
+	}
+
+	void normalize()
+	{
+		if (_range < TopValue)
+		{
+			_range <<= 8;
+			_code = (_code << 8) | nextByte();
+		}
+	}
+
+	const uchar * _in = nullptr;
+	qint64 _inSize = 0;
+	qint64 _inPos = 0;
+	uint32_t _range = 0;
+	uint32_t _code = 0;
+	bool _error = false;
+
+};
+
+static uint bitTreeReverseDecode( uint16_t * probs, int numBits, RangeDecoder & rc )
+{
+	uint m = 1;
+	uint symbol = 0;
+	for (int i = 0; i < numBits; ++i)
+	{
+		uint bit = rc.decodeBit( probs[m] );
+		m = (m << 1) + bit;
+		symbol |= bit << i;
+	}
+	return symbol;
+}
+
+template< int NumBits >
+struct BitTreeDecoder
+{
+	uint16_t probs [1 << NumBits];
+
+	void init()   { std::fill( std::begin(probs), std::end(probs), ProbInitValue ); }
+
+	uint decode( RangeDecoder & rc )
+	{
+		uint m = 1;
+		for (int i = 0; i < NumBits; ++i)
+			m = (m << 1) + rc.decodeBit( probs[m] );
+		return m - (1u << NumBits);
+	}
+
+	uint reverseDecode( RangeDecoder & rc )   { return bitTreeReverseDecode( probs, NumBits, rc ); }
+};
+
+static constexpr int NumPosBitsMax = 4;
+static constexpr uint NumStates = 12;
+static constexpr uint NumLenToPosStates = 4;
+static constexpr uint NumAlignBits = 4;
+static constexpr uint StartPosModelIndex = 4;
+static constexpr uint EndPosModelIndex = 14;
+static constexpr uint NumFullDistances = 1 << (EndPosModelIndex >> 1);
+static constexpr uint MatchMinLen = 2;
+
+struct LenDecoder
+{
+	uint16_t choice;
+	uint16_t choice2;
+	BitTreeDecoder<3> lowCoder [1 << NumPosBitsMax];
+	BitTreeDecoder<3> midCoder [1 << NumPosBitsMax];
+	BitTreeDecoder<8> highCoder;
+
+	void init()
+	{
+		choice = ProbInitValue;
+		choice2 = ProbInitValue;
+		highCoder.init();
+		for (auto & coder : lowCoder)
+			coder.init();
+		for (auto & coder : midCoder)
+			coder.init();
+	}
+
+	uint decode( RangeDecoder & rc, uint posState )
+	{
+		if (rc.decodeBit( choice ) == 0)
+			return lowCoder[ posState ].decode( rc );
+		if (rc.decodeBit( choice2 ) == 0)
+			return 8 + midCoder[ posState ].decode( rc );
+		return 16 + highCoder.decode( rc );
+	}
+};
+
+class LzmaDecoder {
+
+ public:
+
+	/// The output buffer also serves as the dictionary, so nothing that was decoded is ever thrown away.
+	LzmaDecoder( qint64 outSize ) : _outSize( outSize )
+	{
+		_out.resize( int( outSize ) );
+		_buf = reinterpret_cast< uchar * >( _out.data() );
+	}
+
+	/// Sets the lc, lp and pb parameters encoded in one byte, returns false if they are invalid.
+	bool setProperties( uint propsByte )
+	{
+		if (propsByte >= 9 * 5 * 5)
+			return false;
+		_lc = propsByte % 9;
+		propsByte /= 9;
+		_lp = propsByte % 5;
+		_pb = propsByte / 5;
+		_literalProbs.resize( size_t( 0x300 ) << (_lc + _lp) );
+		return true;
+	}
+
+	void resetState()
+	{
+		std::fill( _literalProbs.begin(), _literalProbs.end(), ProbInitValue );
+		for (auto & decoder : _posSlotDecoder)
+			decoder.init();
+		std::fill( std::begin(_posDecoders), std::end(_posDecoders), ProbInitValue );
+		_alignDecoder.init();
+		_lenDecoder.init();
+		_repLenDecoder.init();
+		std::fill( std::begin(_isMatch), std::end(_isMatch), ProbInitValue );
+		std::fill( std::begin(_isRep), std::end(_isRep), ProbInitValue );
+		std::fill( std::begin(_isRepG0), std::end(_isRepG0), ProbInitValue );
+		std::fill( std::begin(_isRepG1), std::end(_isRepG1), ProbInitValue );
+		std::fill( std::begin(_isRepG2), std::end(_isRepG2), ProbInitValue );
+		std::fill( std::begin(_isRep0Long), std::end(_isRep0Long), ProbInitValue );
+
+		_state = 0;
+		_rep0 = _rep1 = _rep2 = _rep3 = 0;
+	}
+
+	/// Decodes one LZMA stream that should produce unpackSize bytes, but stops earlier when the output is full.
+	/** Returns false if the data are not a valid LZMA stream. The state is kept for the next LZMA2 chunk. */
+	bool decode( const uchar * in, qint64 inSize, qint64 unpackSize )
+	{
+		RangeDecoder rc;
+		if (!rc.init( in, inSize ))
+			return false;
+
+		const qint64 endPos = std::min( _outPos + unpackSize, _outSize );
+		while (_outPos < endPos && !rc.hasError())
+		{
+			uint posState = uint( _outPos ) & ((1u << _pb) - 1);
+
+			if (rc.decodeBit( _isMatch[ (_state << NumPosBitsMax) + posState ] ) == 0)
+			{
+				decodeLiteral( rc );
+				_state = _state < 4 ? 0 : _state < 10 ? _state - 3 : _state - 6;
+				continue;
+			}
+
+			uint len;
+			if (rc.decodeBit( _isRep[ _state ] ) != 0)
+			{
+				if (_rep0 >= quint64( _outPos ))
+					return false;
+
+				if (rc.decodeBit( _isRepG0[ _state ] ) == 0)
+				{
+					if (rc.decodeBit( _isRep0Long[ (_state << NumPosBitsMax) + posState ] ) == 0)
+					{
+						// short rep - a single byte from the last distance
+						_state = _state < 7 ? 9 : 11;
+						_buf[ _outPos ] = _buf[ _outPos - _rep0 - 1 ];
+						++_outPos;
+						continue;
+					}
+				}
+				else
+				{
+					uint32_t dist;
+					if (rc.decodeBit( _isRepG1[ _state ] ) == 0)
+					{
+						dist = _rep1;
+					}
+					else
+					{
+						if (rc.decodeBit( _isRepG2[ _state ] ) == 0)
+						{
+							dist = _rep2;
+						}
+						else
+						{
+							dist = _rep3;
+							_rep3 = _rep2;
+						}
+						_rep2 = _rep1;
+					}
+					_rep1 = _rep0;
+					_rep0 = dist;
+				}
+				len = _repLenDecoder.decode( rc, posState );
+				_state = _state < 7 ? 8 : 11;
+			}
+			else
+			{
+				_rep3 = _rep2;
+				_rep2 = _rep1;
+				_rep1 = _rep0;
+				len = _lenDecoder.decode( rc, posState );
+				_state = _state < 7 ? 7 : 10;
+				_rep0 = decodeDistance( rc, len );
+				if (_rep0 == 0xFFFFFFFF)
+					return !rc.hasError();  // end marker, the stream ended before the declared size
+			}
+
+			if (_rep0 >= quint64( _outPos ))
+				return false;  // points before the beginning of the data
+
+			qint64 copyLen = std::min( qint64( len + MatchMinLen ), endPos - _outPos );
+			for (qint64 i = 0; i < copyLen; ++i, ++_outPos)
+				_buf[ _outPos ] = _buf[ _outPos - _rep0 - 1 ];
+		}
+
+		return !rc.hasError();
+	}
+
+	/// Appends an uncompressed LZMA2 chunk.
+	void appendUncompressed( const uchar * data, qint64 size )
+	{
+		qint64 copyLen = std::min( size, _outSize - _outPos );
+		memcpy( _buf + _outPos, data, size_t( copyLen ) );
+		_outPos += copyLen;
+	}
+
+	bool isFull() const   { return _outPos >= _outSize; }
+
+	QByteArray takeOutput()
+	{
+		_out.resize( int( _outPos ) );
+		return std::move(_out);
+	}
+
+ private:
+
+	void decodeLiteral( RangeDecoder & rc )
+	{
+		uint prevByte = _outPos > 0 ? _buf[ _outPos - 1 ] : 0;
+		uint litState = ((uint( _outPos ) & ((1u << _lp) - 1)) << _lc) + (prevByte >> (8 - _lc));
+		uint16_t * probs = &_literalProbs[ size_t( 0x300 ) * litState ];
+
+		uint symbol = 1;
+		if (_state >= 7)  // after a match, the previous occurrence predicts the bits of this byte
+		{
+			uint matchByte = _buf[ _outPos - _rep0 - 1 ];
+			do
+			{
+				uint matchBit = (matchByte >> 7) & 1;
+				matchByte <<= 1;
+				uint bit = rc.decodeBit( probs[ ((1 + matchBit) << 8) + symbol ] );
+				symbol = (symbol << 1) | bit;
+				if (matchBit != bit)
+					break;
+			}
+			while (symbol < 0x100);
+		}
+		while (symbol < 0x100)
+			symbol = (symbol << 1) | rc.decodeBit( probs[ symbol ] );
+
+		_buf[ _outPos++ ] = uchar( symbol - 0x100 );
+	}
+
+	uint32_t decodeDistance( RangeDecoder & rc, uint len )
+	{
+		uint lenState = std::min( len, NumLenToPosStates - 1 );
+		uint posSlot = _posSlotDecoder[ lenState ].decode( rc );
+		if (posSlot < StartPosModelIndex)
+			return posSlot;
+
+		int numDirectBits = int( posSlot >> 1 ) - 1;
+		uint32_t dist = (2 | (posSlot & 1)) << numDirectBits;
+		if (posSlot < EndPosModelIndex)
+		{
+			dist += bitTreeReverseDecode( _posDecoders + dist - posSlot, numDirectBits, rc );
+		}
+		else
+		{
+			dist += rc.decodeDirectBits( numDirectBits - int( NumAlignBits ) ) << NumAlignBits;
+			dist += _alignDecoder.reverseDecode( rc );
+		}
+		return dist;
+	}
+
+	QByteArray _out;
+	uchar * _buf;
+	qint64 _outSize;
+	qint64 _outPos = 0;
+
+	uint _lc = 0, _lp = 0, _pb = 0;
+	uint _state = 0;
+	uint32_t _rep0 = 0, _rep1 = 0, _rep2 = 0, _rep3 = 0;
+
+	std::vector< uint16_t > _literalProbs;
+	BitTreeDecoder<6> _posSlotDecoder [NumLenToPosStates];
+	uint16_t _posDecoders [1 + NumFullDistances - EndPosModelIndex];
+	BitTreeDecoder< NumAlignBits > _alignDecoder;
+	LenDecoder _lenDecoder;
+	LenDecoder _repLenDecoder;
+	uint16_t _isMatch [NumStates << NumPosBitsMax];
+	uint16_t _isRep [NumStates];
+	uint16_t _isRepG0 [NumStates];
+	uint16_t _isRepG1 [NumStates];
+	uint16_t _isRepG2 [NumStates];
+	uint16_t _isRep0Long [NumStates << NumPosBitsMax];
+
+};
+
+//  https://github.com/tukaani-project/xz/blob/master/src/liblzma/lzma/lzma2_decoder.c
+//  LZMA2 is a sequence of chunks, each either stored or compressed by LZMA with optionally reset state.
+
+static bool decodeLzma2( const uchar * in, qint64 inSize, LzmaDecoder & decoder )
+{
+	qint64 pos = 0;
+	bool hasProperties = false;
+
+	while (!decoder.isFull())
+	{
+		if (pos >= inSize)
+			return false;
+		uint control = in[ pos++ ];
+
+		if (control == 0x00)  // end of stream
+		{
+			return true;
+		}
+		else if (control < 0x80)  // uncompressed chunk
+		{
+			if (control > 0x02 || pos + 2 > inSize)
+				return false;
+			qint64 size = ((qint64( in[pos] ) << 8) | in[pos + 1]) + 1;
+			pos += 2;
+			if (pos + size > inSize)
+				return false;
+			decoder.appendUncompressed( in + pos, size );
+			pos += size;
+			continue;
+		}
+
+		if (pos + 4 > inSize)
+			return false;
+		qint64 unpackSize = (qint64( control & 0x1F ) << 16) + (qint64( in[pos] ) << 8) + in[pos + 1] + 1;
+		qint64 packSize = ((qint64( in[pos + 2] ) << 8) | in[pos + 3]) + 1;
+		pos += 4;
+
+		uint resetMode = (control >> 5) & 0x03;
+		if (resetMode >= 2)  // new properties
+		{
+			if (pos >= inSize)
+				return false;
+			uint props = in[ pos++ ];
+			if (props >= 9 * 5 * 5 || props % 9 + (props / 9) % 5 > 4)  // LZMA2 allows only lc + lp <= 4
+				return false;
+			decoder.setProperties( props );
+			hasProperties = true;
+		}
+		else if (!hasProperties)
+		{
+			return false;
+		}
+		if (resetMode >= 1)
+			decoder.resetState();
+
+		if (pos + packSize > inSize || !decoder.decode( in + pos, packSize, unpackSize ))
+			return false;
+		pos += packSize;
+	}
+
+	return true;
+}
+
+
+//======================================================================================================================
+//  archive structure
+
+//  https://www.7-zip.org/sdk.html - DOC/7zFormat.txt
+
+static const uchar Signature [] = { '7', 'z', 0xBC, 0xAF, 0x27, 0x1C };
+static constexpr qint64 SignatureHeaderSize = 32;
+
+/// Sanity limit, the header of an archive with a million files takes around 50 MB.
+static constexpr qint64 MaxHeaderSize = 128 * 1024 * 1024;
+
+/// How much of the packed data is read at most to decompress a given amount, even incompressible data don't grow more.
+static qint64 getMaxPackedSize( qint64 unpackedSize )  { return unpackedSize + unpackedSize / 8 + 64 * 1024; }
+
+enum PropertyID : uint
+{
+	kEnd = 0x00,
+	kHeader = 0x01,
+	kArchiveProperties = 0x02,
+	kAdditionalStreamsInfo = 0x03,
+	kMainStreamsInfo = 0x04,
+	kFilesInfo = 0x05,
+	kPackInfo = 0x06,
+	kUnPackInfo = 0x07,
+	kSubStreamsInfo = 0x08,
+	kSize = 0x09,
+	kCRC = 0x0A,
+	kFolder = 0x0B,
+	kCodersUnPackSize = 0x0C,
+	kNumUnPackStream = 0x0D,
+	kEmptyStream = 0x0E,
+	kEmptyFile = 0x0F,
+	kName = 0x11,
+	kEncodedHeader = 0x17,
+};
+
+static const QByteArray CopyMethodID = QByteArray( "\x00", 1 );
+static const QByteArray LzmaMethodID = QByteArray( "\x03\x01\x01", 3 );
+static const QByteArray Lzma2MethodID = QByteArray( "\x21", 1 );
+
+bool hasSevenZipSignature( const QByteArray & fileStart )
+{
+	return fileStart.size() >= int( sizeof(Signature) ) && memcmp( fileStart.constData(), Signature, sizeof(Signature) ) == 0;
+}
+
+namespace {
+
+// Limits of the counts in the header. Real archives are far below them, but a corrupted or malicious header could
+// otherwise make the parser allocate gigabytes before it finds out the data aren't there.
+static constexpr int MaxEntries = 1 << 18;  ///< files, folders, packed streams
+static constexpr int MaxCoderStreams = 64;
+static constexpr int MaxPropsSize = 256;  ///< LZMA has 5 bytes, LZMA2 1 byte
+
+/// Sequential reader of the header structures, any read beyond the end sets the error flag.
+class ByteReader {
+
+ public:
+
+	ByteReader( const uchar * data, qint64 size ) : _data( data ), _size( size ) {}
+	ByteReader( const QByteArray & data ) : ByteReader( reinterpret_cast< const uchar * >( data.constData() ), data.size() ) {}
+
+	bool hasError() const   { return _error; }
+
+	uint readByte()
+	{
+		if (_pos >= _size)
+		{
+			_error = true;
+			return 0;
+		}
+		return _data[ _pos++ ];
+	}
+
+	const uchar * readBytes( quint64 count )
+	{
+		if (count > quint64( _size - _pos ))
+		{
+			_error = true;
+			return nullptr;
+		}
+		const uchar * bytes = _data + _pos;
+		_pos += qint64( count );
+		return bytes;
+	}
+
+	/// Variable-length number, the count of leading 1 bits in the first byte says how many bytes follow.
+	quint64 readNumber()
+	{
+		uint first = readByte();
+		uint mask = 0x80;
+		quint64 value = 0;
+		for (int i = 0; i < 8; ++i)
+		{
+			if ((first & mask) == 0)
+			{
+				quint64 high = first & (mask - 1);
+				return value | (high << (8 * i));
+			}
+			value |= quint64( readByte() ) << (8 * i);
+			mask >>= 1;
+		}
+		return value;
+	}
+
+	/// Number of items that follow, refused if it's above the limit
+	/// or if the rest of the data couldn't possibly describe that many.
+	int readCount( int maxCount = MaxEntries )
+	{
+		quint64 count = readNumber();
+		if (_error || count > quint64( maxCount ) || count > quint64( _size - _pos ) * 8)
+		{
+			_error = true;
+			return 0;
+		}
+		return int( count );
+	}
+
+	quint16 readUInt16()
+	{
+		const uchar * bytes = readBytes( 2 );
+		return bytes ? qFromLittleEndian< quint16 >( bytes ) : 0;
+	}
+
+	/// Bit vector with the most significant bit first.
+	QVector< bool > readBits( int count )
+	{
+		QVector< bool > bits( count, false );
+		uint byte = 0;
+		for (int i = 0; i < count && !_error; ++i)
+		{
+			if (i % 8 == 0)
+				byte = readByte();
+			bits[i] = (byte >> (7 - i % 8)) & 1;
+		}
+		return bits;
+	}
+
+	/// Bit vector preceded by a byte saying whether all the bits are set.
+	QVector< bool > readOptionalBits( int count )
+	{
+		bool allDefined = readByte() != 0;
+		return allDefined ? QVector< bool >( count, true ) : readBits( count );
+	}
+
+	void skipDigests( int count )
+	{
+		const QVector< bool > defined = readOptionalBits( count );
+		readBytes( 4 * quint64( std::count( defined.begin(), defined.end(), true ) ) );
+	}
+
+	/// Skips a property of an unknown type.
+	void skipData()   { readBytes( readNumber() ); }
+
+ private:
+
+	const uchar * _data;
+	qint64 _size;
+	qint64 _pos = 0;
+	bool _error = false;
+
+};
+
+/// everything about the packed and unpacked streams, only what we need is kept
+struct StreamsInfo
+{
+	quint64 packPos = 0;
+	QVector< quint64 > packSizes;
+
+	struct FolderLayout
+	{
+		bool isSimple = true;
+		QByteArray methodID;
+		QByteArray props;
+		int numPackedStreams = 1;
+		int numOutStreams = 1;
+		int mainOutStream = 0;  ///< the one not bound to another coder
+		bool hasCRC = false;
+		quint64 unpackSize = 0;
+	};
+	QVector< FolderLayout > folders;
+
+	QVector< int > numSubStreams;  ///< files in each folder
+	QVector< quint64 > subStreamSizes;  ///< of all the folders in order
+};
+
+static bool parsePackInfo( ByteReader & reader, StreamsInfo & info )
+{
+	info.packPos = reader.readNumber();
+	int numPackStreams = reader.readCount();
+
+	for (uint type = reader.readByte(); type != kEnd && !reader.hasError(); type = reader.readByte())
+	{
+		if (type == kSize)
+			for (int i = 0; i < numPackStreams && !reader.hasError(); ++i)
+				info.packSizes.append( reader.readNumber() );
+		else if (type == kCRC)
+			reader.skipDigests( numPackStreams );
+		else
+			reader.skipData();
+	}
+
+	return !reader.hasError() && info.packSizes.size() == numPackStreams;
+}
+
+static bool parseFolder( ByteReader & reader, StreamsInfo::FolderLayout & folder )
+{
+	int numCoders = reader.readCount( MaxCoderStreams );
+	if (numCoders < 1)
+		return false;
+
+	int totalInStreams = 0;
+	int totalOutStreams = 0;
+	for (int coderIdx = 0; coderIdx < numCoders; ++coderIdx)
+	{
+		uint flags = reader.readByte();
+		if (flags & 0x80)
+			return false;  // alternative methods are reserved and never used
+
+		const uchar * methodID = reader.readBytes( flags & 0x0F );
+		int numInStreams = 1;
+		int numOutStreams = 1;
+		if (flags & 0x10)  // complex coder
+		{
+			numInStreams = reader.readCount( MaxCoderStreams );
+			numOutStreams = reader.readCount( MaxCoderStreams );
+		}
+		const uchar * props = nullptr;
+		int propsSize = 0;
+		if (flags & 0x20)  // has properties
+		{
+			propsSize = reader.readCount( MaxPropsSize );
+			props = reader.readBytes( quint64( propsSize ) );
+		}
+		if (reader.hasError())
+			return false;
+
+		if (coderIdx == 0)
+		{
+			folder.methodID = QByteArray( reinterpret_cast< const char * >( methodID ), int( flags & 0x0F ) );
+			folder.props = QByteArray( reinterpret_cast< const char * >( props ), propsSize );
+		}
+		totalInStreams += numInStreams;
+		totalOutStreams += numOutStreams;
+	}
+	if (totalOutStreams < 1 || totalOutStreams > 64 || totalInStreams > 64)
+		return false;
+
+	int numBindPairs = totalOutStreams - 1;
+	QVector< bool > isOutStreamBound( totalOutStreams, false );
+	for (int i = 0; i < numBindPairs && !reader.hasError(); ++i)
+	{
+		reader.readNumber();  // in index
+		quint64 outIdx = reader.readNumber();
+		if (outIdx >= quint64( totalOutStreams ))
+			return false;
+		isOutStreamBound[ int( outIdx ) ] = true;
+	}
+
+	folder.numPackedStreams = totalInStreams - numBindPairs;
+	if (folder.numPackedStreams < 1)
+		return false;
+	if (folder.numPackedStreams > 1)
+		for (int i = 0; i < folder.numPackedStreams && !reader.hasError(); ++i)
+			reader.readNumber();  // packed stream index
+
+	folder.numOutStreams = totalOutStreams;
+	folder.mainOutStream = int( std::find( isOutStreamBound.begin(), isOutStreamBound.end(), false ) - isOutStreamBound.begin() );
+	folder.isSimple = numCoders == 1 && totalInStreams == 1 && totalOutStreams == 1;
+
+	return !reader.hasError() && folder.mainOutStream < totalOutStreams;
+}
+
+static bool parseCodersInfo( ByteReader & reader, StreamsInfo & info )
+{
+	if (reader.readByte() != kFolder)
+		return false;
+	int numFolders = reader.readCount();
+	if (reader.readByte() != 0 || reader.hasError())
+		return false;  // the folders are stored in another stream, 7-Zip never does that
+
+	info.folders.resize( numFolders );
+	for (StreamsInfo::FolderLayout & folder : info.folders)
+		if (!parseFolder( reader, folder ))
+			return false;
+
+	if (reader.readByte() != kCodersUnPackSize)
+		return false;
+	for (StreamsInfo::FolderLayout & folder : info.folders)
+	{
+		for (int i = 0; i < folder.numOutStreams && !reader.hasError(); ++i)
+		{
+			quint64 size = reader.readNumber();
+			if (i == folder.mainOutStream)
+				folder.unpackSize = size;
+		}
+	}
+
+	for (uint type = reader.readByte(); type != kEnd && !reader.hasError(); type = reader.readByte())
+	{
+		if (type == kCRC)
+		{
+			const QVector< bool > defined = reader.readOptionalBits( numFolders );
+			for (int i = 0; i < numFolders && !reader.hasError(); ++i)
+			{
+				info.folders[i].hasCRC = defined[i];
+				if (defined[i])
+					reader.readBytes( 4 );
+			}
+		}
+		else
+		{
+			reader.skipData();
+		}
+	}
+
+	return !reader.hasError();
+}
+
+static bool parseSubStreamsInfo( ByteReader & reader, StreamsInfo & info )
+{
+	info.numSubStreams.fill( 1, info.folders.size() );
+
+	uint type = reader.readByte();
+	if (type == kNumUnPackStream)
+	{
+		// the total is limited too, each of the sub-streams gets its size entry
+		int totalSubStreams = 0;
+		for (int & numSubStreams : info.numSubStreams)
+		{
+			numSubStreams = reader.readCount( MaxEntries - totalSubStreams );
+			totalSubStreams += numSubStreams;
+			if (reader.hasError())
+				return false;
+		}
+		type = reader.readByte();
+	}
+
+	// the size of the last stream in a folder is the rest of the folder
+	for (int folderIdx = 0; folderIdx < info.folders.size(); ++folderIdx)
+	{
+		int numSubStreams = info.numSubStreams[ folderIdx ];
+		quint64 folderSize = info.folders[ folderIdx ].unpackSize;
+		if (numSubStreams == 0)
+			continue;
+		if (type != kSize && numSubStreams > 1)
+			return false;
+
+		quint64 sum = 0;
+		if (type == kSize)
+		{
+			for (int i = 1; i < numSubStreams; ++i)
+			{
+				quint64 size = reader.readNumber();
+				if (reader.hasError())
+					return false;
+				if (size > folderSize - sum)
+					return false;
+				info.subStreamSizes.append( size );
+				sum += size;
+			}
+		}
+		info.subStreamSizes.append( folderSize - sum );
+	}
+	if (type == kSize)
+		type = reader.readByte();
+
+	for (; type != kEnd && !reader.hasError(); type = reader.readByte())
+	{
+		if (type == kCRC)
+		{
+			int numUnknownDigests = 0;
+			for (int folderIdx = 0; folderIdx < info.folders.size(); ++folderIdx)
+				if (info.numSubStreams[ folderIdx ] != 1 || !info.folders[ folderIdx ].hasCRC)
+					numUnknownDigests += info.numSubStreams[ folderIdx ];
+			reader.skipDigests( numUnknownDigests );
+		}
+		else
+		{
+			reader.skipData();
+		}
+	}
+
+	return !reader.hasError();
+}
+
+static bool parseStreamsInfo( ByteReader & reader, StreamsInfo & info )
+{
+	uint type = reader.readByte();
+	if (type == kPackInfo)
+	{
+		if (!parsePackInfo( reader, info ))
+			return false;
+		type = reader.readByte();
+	}
+	if (type == kUnPackInfo)
+	{
+		if (!parseCodersInfo( reader, info ))
+			return false;
+		type = reader.readByte();
+	}
+	if (type == kSubStreamsInfo)
+	{
+		if (!parseSubStreamsInfo( reader, info ))
+			return false;
+		type = reader.readByte();
+	}
+	else
+	{
+		info.numSubStreams.fill( 1, info.folders.size() );
+		for (const StreamsInfo::FolderLayout & folder : info.folders)
+			info.subStreamSizes.append( folder.unpackSize );
+	}
+
+	return type == kEnd && !reader.hasError();
+}
+
+static bool parseFilesInfo( ByteReader & reader, const StreamsInfo & streams, QVector< Entry > & entries )
+{
+	int numFiles = reader.readCount();
+	if (reader.hasError())
+		return false;
+
+	QVector< bool > isEmptyStream( numFiles, false );
+	QVector< bool > isEmptyFile;
+	QVector< QString > names( numFiles );
+
+	for (uint type = reader.readByte(); type != kEnd && !reader.hasError(); type = reader.readByte())
+	{
+		quint64 size = reader.readNumber();
+		const uchar * data = reader.readBytes( size );
+		if (reader.hasError())
+			return false;
+		ByteReader property( data, qint64( size ) );
+
+		if (type == kEmptyStream)
+		{
+			isEmptyStream = property.readBits( numFiles );
+		}
+		else if (type == kEmptyFile)
+		{
+			isEmptyFile = property.readBits( int( std::count( isEmptyStream.begin(), isEmptyStream.end(), true ) ) );
+		}
+		else if (type == kName)
+		{
+			if (property.readByte() != 0)
+				return false;  // the names are stored in another stream, 7-Zip never does that
+			for (QString & name : names)
+			{
+				if (property.hasError())
+					break;
+				// null-terminated UTF-16
+				for (quint16 ch = property.readUInt16(); ch != 0 && !property.hasError(); ch = property.readUInt16())
+					name.append( QChar( ch ) );
+			}
+		}
+		// the times and attributes are not needed
+
+		if (property.hasError())
+			return false;
+	}
+	if (reader.hasError())
+		return false;
+
+	entries.clear();
+	entries.reserve( numFiles );
+
+	int folderIdx = 0;
+	int subStreamIdx = 0;  ///< in the current folder
+	int subStreamSizeIdx = 0;  ///< in all the folders
+	quint64 offsetInFolder = 0;
+	int emptyStreamIdx = 0;
+
+	for (int fileIdx = 0; fileIdx < numFiles; ++fileIdx)
+	{
+		Entry entry;
+		// some archivers on Windows store the names with the native separator
+		entry.name = names[ fileIdx ].replace( '\\', '/' );
+
+		if (isEmptyStream[ fileIdx ])
+		{
+			// an empty stream is a directory, unless it's marked as an empty file
+			entry.isDirectory = emptyStreamIdx >= isEmptyFile.size() || !isEmptyFile[ emptyStreamIdx ];
+			++emptyStreamIdx;
+		}
+		else
+		{
+			while (folderIdx < streams.folders.size() && subStreamIdx >= streams.numSubStreams[ folderIdx ])
+			{
+				++folderIdx;
+				subStreamIdx = 0;
+				offsetInFolder = 0;
+			}
+			if (folderIdx >= streams.folders.size() || subStreamSizeIdx >= streams.subStreamSizes.size())
+				return false;  // more files than streams
+
+			entry.folderIdx = folderIdx;
+			entry.offsetInFolder = offsetInFolder;
+			entry.size = streams.subStreamSizes[ subStreamSizeIdx++ ];
+			offsetInFolder += entry.size;
+			++subStreamIdx;
+		}
+
+		entries.append( std::move(entry) );
+	}
+
+	return true;
+}
+
+} // namespace
+
+
+//======================================================================================================================
+//  ArchiveReader
+
+ArchiveReader::ArchiveReader( QFile & file )
+:
+	LoggingComponent("7zReader"), _file( file ), _fileSize( file.size() )
+{}
+
+ReadStatus ArchiveReader::decodeFolder( const Folder & folder, qint64 outSize, QByteArray & output )
+{
+	if (!folder.isSimple)
+	{
+		logDebug() << _file.fileName() << ": unsupported combination of coders";
+		return ReadStatus::NotSupported;
+	}
+	bool isCopy = folder.methodID == CopyMethodID;
+	bool isLzma = folder.methodID == LzmaMethodID;
+	bool isLzma2 = folder.methodID == Lzma2MethodID;
+	if (!isCopy && !isLzma && !isLzma2)
+	{
+		logDebug() << _file.fileName() << ": unsupported compression method " << folder.methodID.toHex();
+		return ReadStatus::NotSupported;  // also the encrypted archives
+	}
+	if (quint64( outSize ) > folder.unpackSize || folder.packOffset > quint64( _fileSize )
+	 || folder.packSize > quint64( _fileSize ) - folder.packOffset)
+	{
+		logDebug() << _file.fileName() << ": compressed block points beyond the end of file";
+		return ReadStatus::InvalidFormat;
+	}
+
+	// only the beginning of the block is needed, the rest is not even read
+	qint64 readSize = std::min( qint64( folder.packSize ), isCopy ? outSize : getMaxPackedSize( outSize ) );
+	QByteArray packed;
+	if (_file.seek( qint64( folder.packOffset ) ))
+		packed = _file.read( readSize );
+	if (packed.size() < readSize)
+	{
+		logRuntimeError() << _file.fileName() << ": failed to read a compressed block";
+		return ReadStatus::FailedToRead;
+	}
+
+	if (isCopy)
+	{
+		if (packed.size() != outSize)
+		{
+			logDebug() << _file.fileName() << ": stored block is shorter than declared";
+			return ReadStatus::InvalidFormat;
+		}
+		output = std::move(packed);
+		return ReadStatus::Success;
+	}
+
+	const uchar * in = reinterpret_cast< const uchar * >( packed.constData() );
+	LzmaDecoder decoder( outSize );
+	bool success;
+	if (isLzma)
+	{
+		success = folder.props.size() == 5 && decoder.setProperties( uchar( folder.props[0] ) );
+		if (success)
+		{
+			decoder.resetState();
+			success = decoder.decode( in, packed.size(), outSize );
+		}
+	}
+	else
+	{
+		success = folder.props.size() == 1 && decodeLzma2( in, packed.size(), decoder );
+	}
+	output = decoder.takeOutput();
+
+	if (!success || output.size() != outSize)
+	{
+		logDebug() << _file.fileName() << ": failed to decompress a block";
+		return ReadStatus::InvalidFormat;
+	}
+
+	return ReadStatus::Success;
+}
+
+ReadStatus ArchiveReader::readHeader( QByteArray & header )
+{
+	QByteArray startHeader;
+	if (_fileSize >= SignatureHeaderSize && _file.seek( 0 ))
+		startHeader = _file.read( SignatureHeaderSize );
+	if (startHeader.size() < SignatureHeaderSize || !hasSevenZipSignature( startHeader ))
+	{
+		logDebug() << _file.fileName() << ": invalid signature header";
+		return ReadStatus::InvalidFormat;
+	}
+
+	quint64 nextHeaderOffset = qFromLittleEndian< quint64 >( startHeader.constData() + 12 );
+	quint64 nextHeaderSize = qFromLittleEndian< quint64 >( startHeader.constData() + 20 );
+	if (nextHeaderSize == 0)
+	{
+		header.clear();  // empty archive
+		return ReadStatus::Success;
+	}
+	if (nextHeaderSize > quint64( MaxHeaderSize ) || nextHeaderOffset > quint64( _fileSize )
+	 || qint64( nextHeaderOffset + nextHeaderSize ) > _fileSize - SignatureHeaderSize)
+	{
+		logDebug() << _file.fileName() << ": header points beyond the end of file";
+		return ReadStatus::InvalidFormat;
+	}
+
+	if (_file.seek( SignatureHeaderSize + qint64( nextHeaderOffset ) ))
+		header = _file.read( qint64( nextHeaderSize ) );
+	if (header.size() < qint64( nextHeaderSize ))
+	{
+		logRuntimeError() << _file.fileName() << ": failed to read the header";
+		return ReadStatus::FailedToRead;
+	}
+
+	// the header is usually compressed, and is then described by a streams info of its own
+	for (int depth = 0; !header.isEmpty() && uchar( header[0] ) == kEncodedHeader; ++depth)
+	{
+		ByteReader reader( header );
+		reader.readByte();
+		StreamsInfo streams;
+		if (depth >= 4 || !parseStreamsInfo( reader, streams ) || streams.folders.isEmpty() || streams.packSizes.isEmpty())
+		{
+			logDebug() << _file.fileName() << ": invalid encoded header";
+			return ReadStatus::InvalidFormat;
+		}
+
+		const StreamsInfo::FolderLayout & layout = streams.folders[0];
+		if (layout.unpackSize > quint64( MaxHeaderSize ))
+		{
+			logDebug() << _file.fileName() << ": header is too big";
+			return ReadStatus::InvalidFormat;
+		}
+
+		Folder folder;
+		folder.isSimple = layout.isSimple;
+		folder.methodID = layout.methodID;
+		folder.props = layout.props;
+		folder.packOffset = SignatureHeaderSize + streams.packPos;
+		folder.packSize = streams.packSizes[0];
+		folder.unpackSize = layout.unpackSize;
+
+		QByteArray decoded;
+		ReadStatus status = decodeFolder( folder, qint64( folder.unpackSize ), decoded );
+		if (status != ReadStatus::Success)
+			return status;
+		header = std::move(decoded);
+	}
+
+	if (!header.isEmpty() && uchar( header[0] ) != kHeader)
+	{
+		logDebug() << _file.fileName() << ": unknown header type " << uint( uchar( header[0] ) );
+		return ReadStatus::InvalidFormat;
+	}
+
+	return ReadStatus::Success;
+}
+
+ReadStatus ArchiveReader::readEntries( QVector< Entry > & entries )
+{
+	entries.clear();
+	_folders.clear();
+
+	QByteArray header;
+	ReadStatus status = readHeader( header );
+	if (status != ReadStatus::Success || header.isEmpty())
+		return status;
+
+	ByteReader reader( header );
+	reader.readByte();  // kHeader
+
+	StreamsInfo mainStreams;
+	bool success = true;
+	uint type = reader.readByte();
+	if (type == kArchiveProperties)
+	{
+		for (uint propType = reader.readByte(); propType != kEnd && !reader.hasError(); propType = reader.readByte())
+			reader.skipData();
+		type = reader.readByte();
+	}
+	if (type == kAdditionalStreamsInfo)
+	{
+		StreamsInfo additionalStreams;
+		success = success && parseStreamsInfo( reader, additionalStreams );
+		type = reader.readByte();
+	}
+	if (success && type == kMainStreamsInfo)
+	{
+		success = parseStreamsInfo( reader, mainStreams );
+		type = reader.readByte();
+	}
+	if (success && type == kFilesInfo)
+	{
+		success = parseFilesInfo( reader, mainStreams, entries );
+		type = reader.readByte();
+	}
+	if (!success || type != kEnd || reader.hasError())
+	{
+		logDebug() << _file.fileName() << ": invalid header";
+		entries.clear();
+		return ReadStatus::InvalidFormat;
+	}
+
+	// remember where the data of each folder are, for reading the content later
+	int packStreamIdx = 0;
+	quint64 packOffset = SignatureHeaderSize + mainStreams.packPos;
+	for (const StreamsInfo::FolderLayout & layout : mainStreams.folders)
+	{
+		Folder folder;
+		folder.isSimple = layout.isSimple && packStreamIdx < mainStreams.packSizes.size();
+		folder.methodID = layout.methodID;
+		folder.props = layout.props;
+		folder.packOffset = packOffset;
+		folder.packSize = packStreamIdx < mainStreams.packSizes.size() ? mainStreams.packSizes[ packStreamIdx ] : 0;
+		folder.unpackSize = layout.unpackSize;
+
+		for (int i = 0; i < layout.numPackedStreams && packStreamIdx < mainStreams.packSizes.size(); ++i)
+			packOffset += mainStreams.packSizes[ packStreamIdx++ ];
+
+		_folders.append( std::move(folder) );
+	}
+
+	return ReadStatus::Success;
+}
+
+ReadStatus ArchiveReader::readContent( const Entry & entry, QByteArray & content, qint64 maxSize )
+{
+	if (entry.folderIdx < 0)
+	{
+		content.clear();
+		return ReadStatus::Success;
+	}
+	if (entry.folderIdx >= _folders.size())
+	{
+		logLogicError() << _file.fileName() << ": " << entry.name << " is not from this archive";
+		return ReadStatus::InvalidFormat;
+	}
+
+	// the entries before this one in the same solid block must be decompressed too
+	if (entry.size > quint64( maxSize ) || entry.offsetInFolder > quint64( maxSize ) - entry.size)
+	{
+		logDebug() << _file.fileName() << ": " << entry.name << " is too big or too deep in a solid block";
+		return ReadStatus::NotSupported;
+	}
+
+	QByteArray decoded;
+	ReadStatus status = decodeFolder( _folders[ entry.folderIdx ], qint64( entry.offsetInFolder + entry.size ), decoded );
+	if (status != ReadStatus::Success)
+		return status;
+
+	content = decoded.mid( int( entry.offsetInFolder ) );
+	return ReadStatus::Success;
+}
+
+
+} // namespace sevenzip
@@ -0,0 +1,90 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: 7z archive parsing (pk7 and similar) without extracting the whole archive
+//======================================================================================================================
+
+#ifndef SEVEN_ZIP_READER_INCLUDED
+#define SEVEN_ZIP_READER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "FileInfoCache.hpp"  // ReadStatus
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+
+class QFile;
+
+
+namespace sevenzip {
+
+
+/// one file stored in the archive, as described by the header
+struct Entry
+{
+	QString name;  ///< path inside the archive with '/' as separator
+	quint64 size = 0;  ///< uncompressed
+	bool isDirectory = false;
+	int folderIdx = -1;  ///< compressed block the content is in, -1 for empty files and directories
+	quint64 offsetInFolder = 0;  ///< where the content starts in the uncompressed block
+
+	bool isDir() const   { return isDirectory; }
+};
+
+/// Returns whether the data look like the beginning of a 7z archive.
+bool hasSevenZipSignature( const QByteArray & fileStart );
+
+/// Reads the list of files and selected file contents from a 7z archive.
+/**
+  * Only the header at the end of the file is read and decompressed to get the list of entries, which is small
+  * compared to the packed files. The files are usually compressed together in solid blocks, so to get the content
+  * of one entry, everything before it in its block has to be decompressed, but nothing after it.
+  */
+class ArchiveReader : protected LoggingComponent {
+
+ public:
+
+	/// The file must be already open for reading and must stay open for the lifetime of this reader.
+	ArchiveReader( QFile & file );
+
+	/// Reads the list of all entries from the header.
+	ReadStatus readEntries( QVector< Entry > & entries );
+
+	/// Reads and decompresses the content of one entry, readEntries() must have been called before.
+	/** Entries that would need more than maxSize bytes of their block decompressed are refused,
+	  * so that a big solid block or a damaged or malicious archive cannot exhaust the memory. */
+	ReadStatus readContent( const Entry & entry, QByteArray & content, qint64 maxSize );
+
+ private:
+
+	/// block of files compressed together
+	struct Folder
+	{
+		bool isSimple = true;  ///< one coder reading from one packed stream, the other configurations are not supported
+		QByteArray methodID;   ///< of the first coder
+		QByteArray props;      ///< of the first coder
+		quint64 packOffset = 0;  ///< absolute position in the file
+		quint64 packSize = 0;
+		quint64 unpackSize = 0;
+	};
+
+	ReadStatus readHeader( QByteArray & header );
+	ReadStatus decodeFolder( const Folder & folder, qint64 outSize, QByteArray & output );
+
+	QFile & _file;
+	qint64 _fileSize;
+
+	QVector< Folder > _folders;  ///< of the main streams, for reading the content
+
+};
+
+
+} // namespace sevenzip
+
+
+#endif // SEVEN_ZIP_READER_INCLUDED
@@ -0,0 +1,50 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: table of unique strings that makes the equal strings share one allocation
+//======================================================================================================================
+
+#include "StringPool.hpp"
+
+#include <QMutexLocker>
+
+
+//======================================================================================================================
+
+StringPool g_pathPool;
+
+QString StringPool::intern( const QString & str )
+{
+	if (str.isEmpty())
+		return {};  // the empty strings share a static data already
+
+	QMutexLocker lock( &_mutex );
+
+	auto iter = _strings.constFind( str );
+	if (iter != _strings.constEnd())
+		return *iter;  // a shallow copy of the pooled one
+
+	_strings.insert( str );
+	return str;
+}
+
+void StringPool::prune()
+{
+	QMutexLocker lock( &_mutex );
+
+	for (auto iter = _strings.begin(); iter != _strings.end(); )
+	{
+		// QSet gives only a const access, but the reference count doesn't change by looking at it
+		if (iter->isDetached())
+			iter = _strings.erase( iter );
+		else
+			++iter;
+	}
+}
+
+int StringPool::size() const
+{
+	QMutexLocker lock( &_mutex );
+	return _strings.size();
+}
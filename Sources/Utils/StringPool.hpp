@@ -0,0 +1,62 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: table of unique strings that makes the equal strings share one allocation
+//======================================================================================================================
+
+#ifndef STRING_POOL_INCLUDED
+#define STRING_POOL_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include <QString>
+#include <QSet>
+#include <QMutex>
+
+
+//======================================================================================================================
+/// Table of unique strings, the strings returned from it share their data with all the other equal ones.
+/**
+  * The presets typically reference the same few hundred files thousands of times, and each loaded or constructed path
+  * would otherwise have its own copy. QString is implicitly shared, so when all the equal strings are taken from here,
+  * they point to a single allocation, and comparing them with isSameString() is just a pointer comparison.
+  *
+  * Thread-safe, the file info caches intern their keys from the worker threads.
+  */
+class StringPool {
+
+ public:
+
+	/// Returns a string equal to the argument, that shares its data with the previously interned equal strings.
+	QString intern( const QString & str );
+
+	/// Replaces the string with the interned one in place.
+	void internInPlace( QString & str )  { str = intern( str ); }
+
+	/// Removes the strings that are no longer referenced from anywhere else than from the pool.
+	void prune();
+
+	int size() const;
+
+ private:
+
+	mutable QMutex _mutex;
+	QSet< QString > _strings;
+
+};
+
+extern StringPool g_pathPool;   ///< the file paths and file names stored in the user data and in the caches
+
+
+/// Compares two strings, and if both of them come from the same pool, the comparison costs only a pointer comparison.
+inline bool isSameString( const QString & str1, const QString & str2 )
+{
+	if (str1.constData() == str2.constData() && str1.size() == str2.size())
+		return true;
+	return str1 == str2;  // at least one of them is not interned
+}
+
+
+#endif // STRING_POOL_INCLUDED
@@ -0,0 +1,92 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: group of independent tasks running in parallel in worker threads
+//======================================================================================================================
+
+#include "TaskGroup.hpp"
+
+#include <QRunnable>
+
+
+//======================================================================================================================
+
+TaskGroup::TaskGroup() : LoggingComponent("TaskGroup")
+{
+	// the default maximum is the number of CPU cores, which is enough for the few tasks we have
+}
+
+TaskGroup::~TaskGroup()
+{
+	waitForDone();  // the tasks refer to this object
+}
+
+void TaskGroup::addTask( Task task )
+{
+	class GroupTask : public QRunnable {
+		TaskGroup * _owner;
+		Task _task;
+	 public:
+		GroupTask( TaskGroup * owner, Task && task ) : _owner( owner ), _task( std::move(task) ) {}
+		virtual void run() override
+		{
+			_task();
+			_owner->onTaskFinished();
+		}
+	};
+
+	{
+		QMutexLocker lock( &_mutex );
+		_runningTasks++;
+	}
+
+	_threadPool.start( new GroupTask( this, std::move(task) ) );
+}
+
+void TaskGroup::whenAllDone( QObject * context, Callback callback )
+{
+	QMutexLocker lock( &_mutex );
+
+	_context = context;
+	_callback = std::move(callback);
+
+	if (_runningTasks == 0)  // they might have finished already
+		postCallback();
+}
+
+bool TaskGroup::isRunning()
+{
+	QMutexLocker lock( &_mutex );
+	return _runningTasks > 0;
+}
+
+void TaskGroup::waitForDone()
+{
+	{
+		QMutexLocker lock( &_mutex );
+		_callback = {};
+	}
+
+	_threadPool.waitForDone();
+}
+
+void TaskGroup::onTaskFinished()
+{
+	QMutexLocker lock( &_mutex );
+
+	_runningTasks--;
+
+	if (_runningTasks == 0 && _callback)
+		postCallback();
+}
+
+void TaskGroup::postCallback()
+{
+	if (!_callback)
+		return;
+
+	postToMainThread( std::move(_context), std::move(_callback) );
+
+	_callback = {};
+}
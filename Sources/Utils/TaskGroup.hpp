@@ -0,0 +1,90 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: group of independent tasks running in parallel in worker threads
+//======================================================================================================================
+
+#ifndef TASK_GROUP_INCLUDED
+#define TASK_GROUP_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QObject>
+#include <QPointer>
+#include <QMutex>
+#include <QThreadPool>
+#include <QCoreApplication>
+
+#include <functional>
+
+
+//======================================================================================================================
+/// Runs independent tasks in parallel in worker threads and lets the main thread know when all of them are finished.
+/**
+  * The tasks store their results wherever they have to, the results can then be safely read in the completion callback.
+  * The tasks must not interact with the UI, error messages have to be stored and reported in the completion callback.
+  *
+  * Must be used from the main thread. The destructor waits until the running tasks finish.
+  */
+class TaskGroup : protected LoggingComponent {
+
+ public:
+
+	using Task = std::function< void () >;
+	using Callback = std::function< void () >;
+
+	TaskGroup();
+	~TaskGroup();
+
+	/// Starts the task in one of the worker threads.
+	void addTask( Task task );
+
+	/// Calls the callback in the main thread after all the tasks added so far are finished,
+	/// unless the context has been destroyed in the meantime. Replaces the previous callback.
+	void whenAllDone( QObject * context, Callback callback );
+
+	/// Returns true if any of the tasks is still running.
+	bool isRunning();
+
+	/// Blocks until all the tasks are finished. The completion callback is then not called.
+	void waitForDone();
+
+ private:
+
+	void onTaskFinished();
+	void postCallback();  ///< _mutex must be locked
+
+	QMutex _mutex;  ///< protects the members below
+	int _runningTasks = 0;
+	QPointer< QObject > _context;
+	Callback _callback;
+
+	QThreadPool _threadPool;
+
+};
+
+
+//======================================================================================================================
+/// Calls the function in the main thread, unless the context has been destroyed in the meantime.
+/** Can be called from any thread. Does nothing if the application is shutting down. */
+template< typename Func >
+void postToMainThread( QPointer< QObject > context, Func && func )
+{
+	QCoreApplication * app = QCoreApplication::instance();
+	if (!app)
+		return;  // the application is shutting down
+
+	// The context must be checked in the main thread, here it could be destroyed right after the check.
+	QMetaObject::invokeMethod( app, [ context = std::move(context), func = std::forward< Func >( func ) ]() mutable
+	{
+		if (context)  // otherwise the requester has been destroyed in the meantime
+			func();
+	}, Qt::QueuedConnection );
+}
+
+
+#endif // TASK_GROUP_INCLUDED
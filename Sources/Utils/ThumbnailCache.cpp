@@ -0,0 +1,341 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: small previews of the title pictures of map packs, decoded in the background and cached on disk
+//======================================================================================================================
+
+#include "ThumbnailCache.hpp"
+
+#include "TitlePicReader.hpp"
+
+#include <QCoreApplication>
+#include <QRunnable>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QDir>
+#include <QStringBuilder>
+
+#include <algorithm>
+
+
+//======================================================================================================================
+
+ThumbnailCache g_thumbnailCache;
+
+// the title pictures are made for 320x200 stretched to 4:3, which gives exactly this
+static constexpr int ThumbnailWidth = 40;
+static constexpr int ThumbnailHeight = 30;
+
+// More workers would only make a spinning disk seek between the files, and the decoding itself takes nothing.
+static constexpr int MaxConcurrentTasks = 2;
+
+// When the user scrolls quickly through a long list, the requests of the rows that have already disappeared
+// would otherwise pile up and delay the ones that are visible now.
+static constexpr int MaxQueuedRequests = 256;
+
+// about 5 KB each
+static constexpr int MaxCachedThumbnails = 2000;
+
+// About 5 KB each, and the map packs that are no longer there or have changed leave their thumbnails behind.
+// When there are more, the oldest ones are deleted, so that the cache doesn't grow forever.
+static constexpr int MaxDiskCacheFiles = 10000;
+static constexpr int DiskCacheFilesAfterPruning = MaxDiskCacheFiles * 3 / 4;  // so that it's not done every session
+
+// empty file in the disk cache saying that the map pack has no picture
+static const char NoPictureSuffix [] = ".none";
+
+struct ThumbnailCache::FallbackPalette
+{
+	const QString wadPath;
+
+	FallbackPalette( const QString & wadPath ) : wadPath( wadPath ) {}
+
+	/// Reads the palette when it's needed for the first time, then it stays the same.
+	void load()
+	{
+		QMutexLocker lock( &_mutex );
+		if (_loaded)
+			return;
+		if (!wadPath.isEmpty())
+			colors = doom::readWadPalette( wadPath );
+		if (!colors.isEmpty())
+			id = QCryptographicHash::hash( colors, QCryptographicHash::Md5 ).toHex().left( 16 );
+		_loaded = true;
+	}
+
+	// only valid after load()
+	QByteArray colors;
+	QString id;  ///< distinguishes the thumbnails decoded with this palette in the disk cache
+
+ private:
+
+	QMutex _mutex;
+	bool _loaded = false;
+};
+
+
+//======================================================================================================================
+//  worker part
+
+static QImage scaleToThumbnail( const QImage & picture )
+{
+	// the pixels of the original screen mode are taller than wide
+	QSize displaySize( picture.width(), picture.height() * 6 / 5 );
+	QSize size = displaySize.scaled( ThumbnailCache::thumbnailSize(), Qt::KeepAspectRatio ).expandedTo( QSize( 1, 1 ) );
+	return picture.scaled( size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+}
+
+static void createNoPictureMark( const QString & cacheDir, const QString & filePath )
+{
+	QDir().mkpath( cacheDir );
+	QFile( filePath ).open( QIODevice::WriteOnly );
+}
+
+static void storeThumbnail( const QString & cacheDir, const QString & filePath, const QImage & thumbnail )
+{
+	QDir().mkpath( cacheDir );
+	thumbnail.save( filePath, "PNG" );
+}
+
+void ThumbnailCache::loadThumbnail( const Request & request, const QString & cacheDir, FallbackPalette & palette,
+                                    QImage & thumbnail, bool & usesFallbackPalette )
+{
+	palette.load();  // reads the IWAD only for the first task
+
+	// Computing the fingerprint reads only the beginning and the end of the file, so it's much cheaper than reading
+	// the picture from a compressed archive, and unlike the path it stays the same when the file is moved.
+	quint64 fingerprint = !cacheDir.isEmpty() ? computeFileFingerprint( request.filePath, request.stamp.size ) : 0;
+	QString cacheFileBase = fingerprint != 0 ? cacheDir % '/' % QString::number( fingerprint, 16 ) : QString();
+	QString ownPaletteFile = cacheFileBase % ".png";
+	QString fallbackPaletteFile = cacheFileBase % '_' % palette.id % ".png";
+
+	if (!cacheFileBase.isEmpty())
+	{
+		if (QFile::exists( cacheFileBase % NoPictureSuffix ))
+			return;
+		if (thumbnail.load( ownPaletteFile, "PNG" ))
+			return;
+		if (!palette.id.isEmpty() && thumbnail.load( fallbackPaletteFile, "PNG" ))
+		{
+			usesFallbackPalette = true;
+			return;
+		}
+	}
+
+	doom::UncertainTitlePic titlePic = doom::readTitlePic( request.filePath, palette.colors );
+	usesFallbackPalette = titlePic.usesFallbackPalette;
+
+	if (titlePic.status == ReadStatus::Success)
+	{
+		thumbnail = scaleToThumbnail( titlePic.image );
+		if (!cacheFileBase.isEmpty())
+			storeThumbnail( cacheDir, usesFallbackPalette ? fallbackPaletteFile : ownPaletteFile, thumbnail );
+	}
+	// when it's missing only the palette, a different IWAD might provide it
+	else if (titlePic.status == ReadStatus::InfoNotPresent && !usesFallbackPalette && !cacheFileBase.isEmpty())
+	{
+		createNoPictureMark( cacheDir, cacheFileBase % NoPictureSuffix );
+	}
+}
+
+
+void ThumbnailCache::pruneDiskCache( const QString & cacheDir )
+{
+	// the file times say when the thumbnail was created, which is as good as it gets without writing on every read
+	QFileInfoList files = QDir( cacheDir ).entryInfoList( QDir::Files, QDir::Time | QDir::Reversed );  // oldest first
+	if (files.size() <= MaxDiskCacheFiles)
+		return;
+
+	qsizetype toRemove = files.size() - DiskCacheFilesAfterPruning;
+	for (qsizetype i = 0; i < toRemove; ++i)
+		QFile::remove( files[ i ].filePath() );  // if it's needed again, it will simply be decoded again
+
+	logDebug("ThumbnailCache") << "removed " << toRemove << " old thumbnails from the disk cache";
+}
+
+
+//======================================================================================================================
+//  main thread part
+
+ThumbnailCache::ThumbnailCache()
+:
+	LoggingComponent("ThumbnailCache"),
+	_thumbnails( MaxCachedThumbnails ),
+	_fallbackPalette( std::make_shared< FallbackPalette >( QString() ) )
+{
+	_threadPool.setMaxThreadCount( MaxConcurrentTasks );
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+	_readyCallback = {};
+	_queue.clear();
+	_threadPool.waitForDone();  // the tasks refer to this object, in case shutdown() wasn't called
+}
+
+void ThumbnailCache::shutdown()
+{
+	_shutDown = true;
+	_callbackContext = nullptr;
+	_readyCallback = {};
+	cancelPending();
+	_threadPool.clear();  // the prune task, if it hasn't started yet
+	_threadPool.waitForDone();
+	_thumbnails.clear();
+}
+
+QSize ThumbnailCache::thumbnailSize()
+{
+	return QSize( ThumbnailWidth, ThumbnailHeight );
+}
+
+void ThumbnailCache::setCacheDir( const QString & dirPath )
+{
+	_cacheDir = dirPath;
+
+	class PruneTask : public QRunnable {
+		QString _cacheDir;
+	 public:
+		PruneTask( const QString & cacheDir ) : _cacheDir( cacheDir ) {}
+		virtual void run() override  { pruneDiskCache( _cacheDir ); }
+	};
+
+	// listing thousands of files takes a while on a spinning disk, and it's not urgent
+	if (!dirPath.isEmpty())
+		_threadPool.start( new PruneTask( dirPath ), /*priority*/-1 );
+}
+
+void ThumbnailCache::setFallbackPalette( const QString & wadPath )
+{
+	if (wadPath == _fallbackPalette->wadPath)
+		return;
+
+	// the tasks that are already running keep the previous one, and their results will be recognized as outdated
+	_fallbackPalette = std::make_shared< FallbackPalette >( wadPath );
+
+	QStringList outdatedPaths;
+	const auto cachedPaths = _thumbnails.keys();
+	for (const QString & path : cachedPaths)
+	{
+		if (_thumbnails.object( path )->usesFallbackPalette)
+		{
+			_thumbnails.remove( path );
+			outdatedPaths.append( path );
+		}
+	}
+
+	if (!outdatedPaths.isEmpty() && _callbackContext && _readyCallback)
+		_readyCallback( outdatedPaths );
+}
+
+void ThumbnailCache::setReadyCallback( QObject * context, ReadyCallback callback )
+{
+	_callbackContext = context;
+	_readyCallback = std::move(callback);
+}
+
+QPixmap ThumbnailCache::getThumbnail( const QString & filePath, const FileStamp & stamp )
+{
+	if (_shutDown)
+		return {};
+
+	if (Thumbnail * thumbnail = _thumbnails.object( filePath ))  // also marks it as the most recently used
+	{
+		if (thumbnail->stamp == stamp)
+			return thumbnail->pixmap;
+		_thumbnails.remove( filePath );  // the file has changed
+	}
+
+	if (_queuedPaths.contains( filePath ))
+	{
+		// It's being asked for again, so it's still visible, move it before the ones that might have disappeared.
+		auto requestIter = std::find_if( _queue.begin(), _queue.end(), [&]( const Request & r ) { return r.filePath == filePath; } );
+		if (requestIter != _queue.end())
+			_queue.move( int( requestIter - _queue.begin() ), _queue.size() - 1 );
+		return {};
+	}
+
+	_queue.append({ filePath, stamp });
+	_queuedPaths.insert( filePath );
+	if (_queue.size() > MaxQueuedRequests)
+	{
+		_queuedPaths.remove( _queue.first().filePath );
+		_queue.removeFirst();
+	}
+
+	startTasks();
+
+	return {};
+}
+
+void ThumbnailCache::cancelPending()
+{
+	for (const Request & request : _queue)
+		_queuedPaths.remove( request.filePath );
+	_queue.clear();
+}
+
+void ThumbnailCache::startTasks()
+{
+	class LoadTask : public QRunnable {
+		ThumbnailCache * _owner;
+		Request _request;
+		QString _cacheDir;
+		std::shared_ptr< FallbackPalette > _palette;
+	 public:
+		LoadTask( ThumbnailCache * owner, Request && request, const QString & cacheDir, const std::shared_ptr< FallbackPalette > & palette )
+			: _owner( owner ), _request( std::move(request) ), _cacheDir( cacheDir ), _palette( palette ) {}
+		virtual void run() override
+		{
+			QImage thumbnail;
+			bool usesFallbackPalette = false;
+			loadThumbnail( _request, _cacheDir, *_palette, thumbnail, usesFallbackPalette );
+
+			// QPixmap can only be created in the main thread
+			QCoreApplication * app = QCoreApplication::instance();
+			if (!app)
+				return;
+			QMetaObject::invokeMethod( app,
+				[ owner = _owner, request = std::move(_request), thumbnail = std::move(thumbnail), usesFallbackPalette, palette = _palette ]()
+				{
+					owner->onThumbnailLoaded( request, thumbnail, usesFallbackPalette, palette.get() );
+				},
+				Qt::QueuedConnection
+			);
+		}
+	};
+
+	// the most recent requests are the rows the user is looking at right now
+	while (_runningTasks < MaxConcurrentTasks && !_queue.isEmpty())
+	{
+		++_runningTasks;
+		_threadPool.start( new LoadTask( this, _queue.takeLast(), _cacheDir, _fallbackPalette ) );
+	}
+}
+
+void ThumbnailCache::onThumbnailLoaded( const Request & request, const QImage & image, bool usesFallbackPalette, const FallbackPalette * palette )
+{
+	if (_shutDown)  // posted before shutdown() waited for the workers
+		return;
+
+	--_runningTasks;
+	_queuedPaths.remove( request.filePath );
+
+	// if the palette changed in the meantime, let it be requested again with the new one
+	if (!usesFallbackPalette || palette == _fallbackPalette.get())
+	{
+		auto thumbnail = new Thumbnail;
+		thumbnail->pixmap = !image.isNull() ? QPixmap::fromImage( image ) : QPixmap();
+		thumbnail->stamp = request.stamp;
+		thumbnail->usesFallbackPalette = usesFallbackPalette;
+		_thumbnails.insert( request.filePath, thumbnail );
+	}
+
+	startTasks();
+
+	if (_callbackContext && _readyCallback)  // otherwise the requester has been destroyed in the meantime
+		_readyCallback({ request.filePath });
+}
@@ -0,0 +1,130 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: small previews of the title pictures of map packs, decoded in the background and cached on disk
+//======================================================================================================================
+
+#ifndef THUMBNAIL_CACHE_INCLUDED
+#define THUMBNAIL_CACHE_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "FileInfoCache.hpp"  // FileStamp
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QSet>
+#include <QCache>
+#include <QPixmap>
+#include <QImage>
+#include <QSize>
+#include <QPointer>
+#include <QObject>
+#include <QThreadPool>
+
+#include <functional>
+#include <memory>
+
+
+//======================================================================================================================
+/// Thumbnails of the title pictures of map packs (TITLEPIC or INTERPIC) that never make the caller wait.
+/**
+  * When a thumbnail is not in memory, a null pixmap is returned and the request is queued. The queue is processed
+  * from the most recent request, so the rows the user is currently looking at are decoded first, and the oldest
+  * requests are dropped when the user scrolls through thousands of files. Only a few workers run at once, because
+  * more parallel reads would only make a spinning disk seek back and forth.
+  *
+  * The workers first look into the disk cache, where the thumbnails are stored under the fingerprint of the map pack,
+  * so they survive renames and moves, and only if it's not there, they read the picture from the map pack and decode it.
+  * The map packs without a picture are remembered in the disk cache too, so that they're not opened in every session.
+  * The recently used thumbnails are kept in memory, the least recently used ones are evicted.
+  * The disk cache is limited too, the oldest files are deleted when the cache directory is set.
+  *
+  * Must be used only from the main thread.
+  */
+class ThumbnailCache : protected LoggingComponent {
+
+ public:
+
+	using ReadyCallback = std::function< void ( const QStringList & paths ) >;
+
+	ThumbnailCache();
+	~ThumbnailCache();
+
+	/// Size into which the pictures are scaled, keeping the aspect ratio.
+	static QSize thumbnailSize();
+
+	/// Directory for the disk cache, it's created when the first thumbnail is stored. Empty path disables the disk cache.
+	void setCacheDir( const QString & dirPath );
+
+	/// The WAD (usually an IWAD) whose palette is used for the pictures of map packs that don't have their own.
+	/** When it changes, the thumbnails decoded with the previous palette are discarded and the callback is told
+	  * about their paths, so that they can be requested again. */
+	void setFallbackPalette( const QString & wadPath );
+
+	/// Sets what should be called when thumbnails, previously returned as null, have been loaded.
+	/** The callback is not called after the context object is destroyed. */
+	void setReadyCallback( QObject * context, ReadyCallback callback );
+
+	/// Returns the thumbnail of a map pack if it's already loaded, otherwise returns null pixmap and loads it
+	/// in the background. Returns null pixmap also when the map pack has no picture.
+	/** The stamp is used to recognize that the file has changed since the thumbnail was loaded. */
+	QPixmap getThumbnail( const QString & filePath, const FileStamp & stamp );
+
+	/// Drops all the queued requests, e.g. when the user switches to a different directory.
+	void cancelPending();
+
+	/// Stops loading, waits for the running workers and releases the thumbnails.
+	/** Must be called before the QApplication is destroyed, the pixmaps can't outlive it. */
+	void shutdown();
+
+ private:
+
+	struct Request
+	{
+		QString filePath;
+		FileStamp stamp;
+	};
+
+	struct Thumbnail
+	{
+		QPixmap pixmap;  ///< null if the map pack doesn't have any picture
+		FileStamp stamp;
+		bool usesFallbackPalette = false;
+	};
+
+	/// palette shared by the workers, it's read by the first one that needs it
+	struct FallbackPalette;
+
+	void startTasks();
+	static void pruneDiskCache( const QString & cacheDir );
+	static void loadThumbnail( const Request & request, const QString & cacheDir, FallbackPalette & palette,
+	                           QImage & thumbnail, bool & usesFallbackPalette );
+	void onThumbnailLoaded( const Request & request, const QImage & image, bool usesFallbackPalette, const FallbackPalette * palette );
+
+ private:
+
+	QCache< QString, Thumbnail > _thumbnails;
+	QList< Request > _queue;       ///< the most recent request is at the end
+	QSet< QString > _queuedPaths;  ///< either queued or being loaded
+	int _runningTasks = 0;
+	bool _shutDown = false;
+
+	QString _cacheDir;
+	std::shared_ptr< FallbackPalette > _fallbackPalette;
+
+	QPointer< QObject > _callbackContext;
+	ReadyCallback _readyCallback;
+
+	QThreadPool _threadPool;
+
+};
+
+extern ThumbnailCache g_thumbnailCache;
+
+
+#endif // THUMBNAIL_CACHE_INCLUDED
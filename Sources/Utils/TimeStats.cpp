@@ -0,0 +1,175 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: measuring how long things take
+//======================================================================================================================
+
+#include "TimeStats.hpp"
+
+#include "StandardOutput.hpp"
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+
+#include <cstring>
+#include <algorithm>
+
+
+//======================================================================================================================
+//  StartupTimeline
+
+StartupTimeline g_startupTimeline;
+
+void StartupTimeline::init( int argc, char * argv [] )
+{
+	// QCoreApplication::arguments() is not available yet, and the QApplication construction should be measured too.
+	enabled = !qEnvironmentVariableIsEmpty( "DOOMRUNNER_PROFILE_STARTUP" );
+	for (int i = 1; i < argc && !enabled; ++i)
+		if (strcmp( argv[i], "--profile-startup" ) == 0)
+			enabled = true;
+
+	if (enabled)
+		timer.start();
+}
+
+void StartupTimeline::finish( const QString & reportFilePath )
+{
+	if (!enabled)
+		return;
+	enabled = false;
+
+	QStringList lines;
+	lines << "Startup timeline:";
+	for (const TimePoint & point : timePoints)
+	{
+		lines << QStringLiteral("  %1 %2ms  (at %3ms)")
+			.arg( QString( point.stageDesc ) + ':', -32 ).arg( point.durationMs, 5 ).arg( point.elapsedMs, 5 );
+	}
+	qint64 totalMs = timer.elapsed();
+	lines << QStringLiteral("  %1 %2ms").arg( "waiting for events:", -32 ).arg( waitedMs, 5 );
+	lines << QStringLiteral("  %1 %2ms").arg( "total:", -32 ).arg( totalMs, 5 );
+	QString report = lines.join('\n') + '\n';
+
+	stdoutStream << report;
+	stdoutStream.flush();
+
+	QFile reportFile( reportFilePath );
+	if (reportFile.open( QFile::WriteOnly | QFile::Text ))
+		reportFile.write( report.toUtf8() );
+	else
+		logRuntimeError("Timing") << "Could not write startup timeline to " << reportFilePath << ": " << reportFile.errorString();
+
+	timePoints.clear();
+}
+
+
+//======================================================================================================================
+//  LaunchTimeline
+
+QString LaunchTimeline::finish()
+{
+	if (!timer.isValid())
+		return {};
+	timer.invalidate();
+
+	qint64 launcherMs = 0;
+	qint64 engineMs = 0;
+	QStringList stages;
+	for (const TimePoint & point : timePoints)
+	{
+		if (point.side == Side::Launcher)
+			launcherMs += point.durationMs;
+		else if (point.side == Side::Engine)
+			engineMs += point.durationMs;
+		stages << QStringLiteral("%1: %2ms").arg( point.stageDesc ).arg( point.durationMs );
+	}
+	timePoints.clear();
+
+	return QStringLiteral("%1  launcher: %2ms, engine: %3ms  (%4)")
+		.arg( QDateTime::currentDateTime().toString( Qt::ISODate ) )
+		.arg( launcherMs, 4 ).arg( engineMs, 5 )
+		.arg( stages.join(", ") );
+}
+
+
+//======================================================================================================================
+//  LoadPhaseTracker
+
+static constexpr qint64 LoadingQuietPeriodMs = 2000;  // engines keep printing while loading, then they wait for the player
+
+void LoadPhaseTracker::start( const LoadPhaseMarker * markers )
+{
+	this->markers = markers;
+	maxPrefixLength = 0;
+	for (const LoadPhaseMarker * marker = markers; marker && marker->phaseName; ++marker)
+		maxPrefixLength = std::max( maxPrefixLength, int( strlen( marker->linePrefix ) ) );
+
+	timer.start();
+	lastOutputMs = 0;
+	phases.clear();
+	lineStart.clear();
+	loadingFinished = false;
+}
+
+void LoadPhaseTracker::processOutput( const QByteArray & output )
+{
+	if (!isTracking())
+		return;
+
+	qint64 receivedMs = timer.elapsed();
+	if (!phases.isEmpty() && receivedMs - lastOutputMs > LoadingQuietPeriodMs)
+	{
+		loadingFinished = true;  // the last phase ended with the last output before the pause
+		return;
+	}
+	lastOutputMs = receivedMs;
+
+	int pos = 0;
+	while (pos < output.size())
+	{
+		int lineEnd = output.indexOf( '\n', pos );
+		int end = lineEnd >= 0 ? lineEnd : output.size();
+
+		// the rest of the line doesn't matter
+		if (lineStart.size() < maxPrefixLength)
+			lineStart += output.mid( pos, std::min( end - pos, maxPrefixLength - lineStart.size() ) );
+
+		if (lineEnd < 0)
+			break;  // continued in the next chunk
+
+		matchLine( receivedMs );
+		lineStart.clear();
+		pos = lineEnd + 1;
+	}
+}
+
+void LoadPhaseTracker::matchLine( qint64 receivedMs )
+{
+	for (const LoadPhaseMarker * marker = markers; marker->phaseName; ++marker)
+	{
+		if (lineStart.startsWith( marker->linePrefix ))
+		{
+			phases.append({ marker->phaseName, receivedMs });
+			return;
+		}
+	}
+}
+
+QString LoadPhaseTracker::finish()
+{
+	if (!markers)
+		return {};
+	markers = nullptr;
+
+	QStringList phaseDescs;
+	for (int i = 0; i < phases.size(); ++i)
+	{
+		qint64 endMs = i + 1 < phases.size() ? phases[ i + 1 ].startMs : lastOutputMs;
+		phaseDescs << QStringLiteral("%1 %2 s").arg( phases[i].name ).arg( double( endMs - phases[i].startMs ) / 1000.0, 0, 'f', 1 );
+	}
+	phases.clear();
+
+	return phaseDescs.join(", ");
+}
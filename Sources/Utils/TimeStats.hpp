@@ -1,9 +1,15 @@
 #ifndef TIME_STATS_INCLUDED
 #define TIME_STATS_INCLUDED
 
+#include "Essential.hpp"
+
+#include "ErrorHandling.hpp"  // logDebug
+
 #include <QElapsedTimer>
 #include <QDebug>
 #include <QFile>
+#include <QVector>
+#include <QByteArray>
 
 class TimeStats
 {
@@ -63,4 +69,190 @@ public:
 	}
 };
 
+/// Logs how long the enclosing scope took, if it took at least the given number of milliseconds.
+/** Meant to stay permanently in the hot paths, so that the timings of the same operation can be compared across runs
+  * and versions from the debug output. Compiles to nothing in release builds. */
+class ScopeTimer
+{
+ #if IS_DEBUG_BUILD
+	QElapsedTimer timer;
+	const char * activityDesc;
+	qint64 reportThresholdMs;
+ #endif
+
+public:
+
+	ScopeTimer( [[maybe_unused]] const char * activityDesc, [[maybe_unused]] qint64 reportThresholdMs = 0 )
+	{
+	 #if IS_DEBUG_BUILD
+		this->activityDesc = activityDesc;
+		this->reportThresholdMs = reportThresholdMs;
+		timer.start();
+	 #endif
+	}
+
+	~ScopeTimer()
+	{
+	 #if IS_DEBUG_BUILD
+		auto elapsed = timer.elapsed();
+		if (elapsed >= reportThresholdMs)
+			logDebug("Timing") << activityDesc << " took " << elapsed << "ms";
+	 #endif
+	}
+};
+
+/// Records how long the individual stages of the application startup took.
+/** Enabled by the --profile-startup command-line argument or by the DOOMRUNNER_PROFILE_STARTUP environment variable,
+  * otherwise the time points cost just a branch. When the startup is finished, the report is printed to the standard
+  * output and written into a file, so that a slower startup after an update can be attributed to a particular stage.
+  * Must only be used from the main thread. */
+class StartupTimeline
+{
+	struct TimePoint
+	{
+		const char * stageDesc;
+		qint64 durationMs;  ///< since the previous time point
+		qint64 elapsedMs;   ///< since the start of the application
+	};
+
+	QElapsedTimer timer;
+	qint64 lastVal = 0;
+	qint64 waitedMs = 0;
+	QVector< TimePoint > timePoints;
+	bool enabled = false;
+
+public:
+
+	/// Must be called at the very beginning of main.
+	void init( int argc, char * argv [] );
+
+	bool isEnabled() const   { return enabled; }
+
+	/// Records that a stage has finished, its duration is the time since the previous time point.
+	void addTimePoint( const char * stageDesc )
+	{
+		if (!enabled)
+			return;
+		auto elapsed = timer.elapsed();
+		timePoints.append({ stageDesc, elapsed - lastVal, elapsed });
+		lastVal = elapsed;
+	}
+
+	/// Excludes the time since the previous time point from the next stage, for example when it was waiting for a timer.
+	void skipWaiting()
+	{
+		if (!enabled)
+			return;
+		auto elapsed = timer.elapsed();
+		waitedMs += elapsed - lastVal;
+		lastVal = elapsed;
+	}
+
+	/// Prints the report and writes it into the file, the following time points are ignored.
+	void finish( const QString & reportFilePath );
+};
+
+extern StartupTimeline g_startupTimeline;
+
+/// Records how long the individual stages of launching the engine took, from the click on the Launch button
+/// until the engine printed its first output.
+/** Unlike the startup timeline it's always enabled, the few time points per launch cost nothing. The stages done by
+  * the launcher are summed separately from the stages that depend on the engine, so that the record shows which one
+  * is responsible for a slow launch. Must only be used from the main thread. */
+class LaunchTimeline
+{
+	enum class Side
+	{
+		Launcher,
+		Engine,
+		User,  ///< waiting for the user's answer, counted neither to the launcher nor to the engine
+	};
+
+	struct TimePoint
+	{
+		const char * stageDesc;
+		qint64 durationMs;  ///< since the previous time point
+		Side side;
+	};
+
+	QElapsedTimer timer;
+	qint64 lastVal = 0;
+	QVector< TimePoint > timePoints;
+
+	void addTimePoint( const char * stageDesc, Side side )
+	{
+		if (!timer.isValid())
+			return;
+		auto elapsed = timer.elapsed();
+		timePoints.append({ stageDesc, elapsed - lastVal, side });
+		lastVal = elapsed;
+	}
+
+public:
+
+	/// Must be called right when the user requests the launch.
+	void start()
+	{
+		timer.start();
+		lastVal = 0;
+		timePoints.clear();
+	}
+
+	/// Records that a stage done by the launcher has finished, its duration is the time since the previous time point.
+	void addLauncherTimePoint( const char * stageDesc )   { addTimePoint( stageDesc, Side::Launcher ); }
+
+	/// Records that a stage which depends on the speed of the engine has finished.
+	void addEngineTimePoint( const char * stageDesc )     { addTimePoint( stageDesc, Side::Engine ); }
+
+	/// Records that the launcher has finished waiting for the user, for example in a confirmation dialog.
+	void addWaitingTimePoint( const char * stageDesc )    { addTimePoint( stageDesc, Side::User ); }
+
+	/// Returns a single line describing all the time points, the following time points are ignored.
+	QString finish();
+};
+
+/// Line that a process prints to its output when it begins a certain phase of its loading.
+struct LoadPhaseMarker
+{
+	const char * linePrefix;  ///< the line must start with this
+	const char * phaseName;   ///< nullptr terminates the list of markers
+};
+
+/// Measures how long the individual phases of a process's loading took, from the markers it prints to its output.
+/** Each phase lasts until the next marker. The loading is considered finished when the output goes quiet for a while,
+  * usually because the game waits for the player. The output must be fed exactly as it arrives, the time points are
+  * taken when it's received. Only the beginnings of the lines are looked at, so it costs almost nothing.
+  * Must only be used from the main thread. */
+class LoadPhaseTracker
+{
+	struct Phase
+	{
+		const char * name;
+		qint64 startMs;
+	};
+
+	const LoadPhaseMarker * markers = nullptr;
+	int maxPrefixLength = 0;
+	QElapsedTimer timer;
+	qint64 lastOutputMs = 0;
+	QVector< Phase > phases;
+	QByteArray lineStart;  ///< beginning of the current line, possibly continued in the next chunk of output
+	bool loadingFinished = false;
+
+	void matchLine( qint64 receivedMs );
+
+public:
+
+	/// Must be called right when the process is started. Null markers disable the tracking.
+	void start( const LoadPhaseMarker * markers );
+
+	bool isTracking() const   { return markers && !loadingFinished; }
+
+	/// Looks for the markers in a chunk of the output.
+	void processOutput( const QByteArray & output );
+
+	/// Returns the phases in the form "WAD init 2.1 s, textures 4.3 s, map 0.8 s", empty if no marker was found.
+	QString finish();
+};
+
 #endif // TIME_STATS_INCLUDED
@@ -0,0 +1,287 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: finding and decoding the title pictures of map packs
+//======================================================================================================================
+
+#include "TitlePicReader.hpp"
+
+#include "WADReader.hpp"  // readWadLumps
+#include "ZipReader.hpp"
+#include "ErrorHandling.hpp"
+
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QtEndian>
+
+
+namespace doom {
+
+
+//======================================================================================================================
+
+/// A full-screen picture in any of the supported formats is far smaller than this.
+static constexpr qint64 MaxPictureSize = 4 * 1024 * 1024;
+
+/// only the first of the 14 palettes in PLAYPAL is the normal one
+static constexpr int PaletteSize = 256 * 3;
+
+/// full-screen picture stored as raw palette indexes, used by Heretic and Hexen for the title screens
+static constexpr int RawPictureWidth = 320;
+static constexpr int RawPictureHeight = 200;
+
+static const QStringVec pictureLumpNames = { "TITLEPIC", "INTERPIC" };  // in order of preference
+static const QString paletteLumpName = "PLAYPAL";
+static const QStringVec allLumpNames = { "TITLEPIC", "INTERPIC", "PLAYPAL" };
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  decoding
+
+static bool isStandardImage( const QByteArray & data )
+{
+	return data.startsWith( "\x89PNG" ) || data.startsWith( "\xFF\xD8\xFF" );  // PNG or JPEG
+}
+
+static QVector< QRgb > toColorTable( const QByteArray & palette )
+{
+	QVector< QRgb > colors( 256 );
+	const uchar * bytes = reinterpret_cast< const uchar * >( palette.constData() );
+	for (int i = 0; i < 256; ++i)
+		colors[i] = qRgb( bytes[ i*3 + 0 ], bytes[ i*3 + 1 ], bytes[ i*3 + 2 ] );
+	return colors;
+}
+
+//  https://doomwiki.org/wiki/Picture_format
+
+static QImage decodeDoomPicture( const QByteArray & lump, const QVector< QRgb > & colors )
+{
+	const uchar * data = reinterpret_cast< const uchar * >( lump.constData() );
+	const qint64 size = lump.size();
+
+	if (size < 8)
+		return {};
+
+	const int width = qFromLittleEndian< qint16 >( data + 0 );
+	const int height = qFromLittleEndian< qint16 >( data + 2 );
+	if (width <= 0 || height <= 0 || width > 4096 || height > 4096 || size < 8 + qint64( width ) * 4)
+		return {};
+
+	QImage image( width, height, QImage::Format_ARGB32 );
+	image.fill( Qt::transparent );
+
+	for (int x = 0; x < width; ++x)
+	{
+		qint64 pos = qFromLittleEndian< quint32 >( data + 8 + x * 4 );
+		int top = -1;
+		while (true)
+		{
+			if (pos >= size)
+				return {};  // every column must be terminated
+			const int topDelta = data[ pos ];
+			if (topDelta == 0xFF)
+				break;
+			if (pos + 3 > size)
+				return {};
+
+			// tall pictures exceeding 254 pixels store the offset relative to the previous post
+			top = topDelta <= top ? top + topDelta : topDelta;
+			const int length = data[ pos + 1 ];
+			pos += 3;  // top delta, length, unused padding
+			if (pos + length + 1 > size)
+				return {};
+
+			for (int i = 0; i < length; ++i)
+			{
+				const int y = top + i;
+				if (y < height)
+					reinterpret_cast< QRgb * >( image.scanLine( y ) )[ x ] = colors[ data[ pos + i ] ];
+			}
+			pos += length + 1;  // pixels, unused padding
+		}
+	}
+
+	return image;
+}
+
+/// Raw pictures have no header that could be checked, any 64000 bytes would pass as one.
+/** But a drawn picture has large areas of the same color, so most pixels repeat the one on the left or above,
+  * while in compressed or random data that happens only for about 1 in 128 pixels. */
+static bool looksLikeRawPicture( const uchar * data )
+{
+	int repeatedPixels = 0;
+	for (int y = 1; y < RawPictureHeight; ++y)
+	{
+		const uchar * line = data + y * RawPictureWidth;
+		const uchar * prevLine = line - RawPictureWidth;
+		for (int x = 1; x < RawPictureWidth; ++x)
+			if (line[ x ] == line[ x - 1 ] || line[ x ] == prevLine[ x ])
+				++repeatedPixels;
+	}
+	return repeatedPixels >= RawPictureWidth * RawPictureHeight / 8;
+}
+
+static QImage decodeRawPicture( const QByteArray & lump, const QVector< QRgb > & colors )
+{
+	const uchar * data = reinterpret_cast< const uchar * >( lump.constData() );
+
+	if (lump.size() != RawPictureWidth * RawPictureHeight || !looksLikeRawPicture( data ))
+		return {};
+
+	QImage image( RawPictureWidth, RawPictureHeight, QImage::Format_RGB32 );
+	for (int y = 0; y < RawPictureHeight; ++y)
+	{
+		QRgb * line = reinterpret_cast< QRgb * >( image.scanLine( y ) );
+		for (int x = 0; x < RawPictureWidth; ++x)
+			line[ x ] = colors[ data[ y * RawPictureWidth + x ] ];
+	}
+	return image;
+}
+
+static void decodePicture( const QByteArray & picture, const QByteArray & ownPalette, const QByteArray & fallbackPalette, UncertainTitlePic & titlePic )
+{
+	if (isStandardImage( picture ))
+	{
+		titlePic.image = QImage::fromData( picture );
+		titlePic.status = !titlePic.image.isNull() ? ReadStatus::Success : ReadStatus::InvalidFormat;
+		return;
+	}
+
+	const bool hasOwnPalette = ownPalette.size() >= PaletteSize;
+	titlePic.usesFallbackPalette = !hasOwnPalette;
+	const QByteArray & palette = hasOwnPalette ? ownPalette : fallbackPalette;
+	if (palette.size() < PaletteSize)
+	{
+		titlePic.status = ReadStatus::InfoNotPresent;  // can't be displayed until we know which game it's for
+		return;
+	}
+	const QVector< QRgb > colors = toColorTable( palette );
+
+	titlePic.image = decodeDoomPicture( picture, colors );
+	if (titlePic.image.isNull() && picture.size() == RawPictureWidth * RawPictureHeight)
+		titlePic.image = decodeRawPicture( picture, colors );
+
+	titlePic.status = !titlePic.image.isNull() ? ReadStatus::Success : ReadStatus::InvalidFormat;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  lookup
+
+/// Returns the upper-case lump name an archive entry corresponds to, or empty string if it's not in a directory
+/// where the engines look for the graphics.
+static QString getLumpNameOfEntry( const zip::Entry & entry )
+{
+	if (entry.isDir())
+		return {};
+
+	int lastSlash = entry.name.lastIndexOf('/');
+	if (lastSlash >= 0 && entry.name.left( lastSlash ).compare( "graphics", Qt::CaseInsensitive ) != 0)
+		return {};
+
+	QString fileName = entry.name.mid( lastSlash + 1 );
+	int dotPos = fileName.indexOf('.');
+	return (dotPos >= 0 ? fileName.left( dotPos ) : fileName).toUpper();
+}
+
+static void readTitlePicFromZip( QFile & file, const QByteArray & fallbackPalette, UncertainTitlePic & titlePic )
+{
+	zip::ArchiveReader archive( file );
+	QVector< zip::Entry > entries;
+	titlePic.status = archive.readEntries( entries );
+	if (titlePic.status != ReadStatus::Success)
+		return;
+
+	QHash< QString, const zip::Entry * > entriesByLumpName;
+	for (const zip::Entry & entry : entries)
+	{
+		QString lumpName = getLumpNameOfEntry( entry );
+		if (lumpName == paletteLumpName || pictureLumpNames.contains( lumpName ))
+			entriesByLumpName.insert( lumpName, &entry );
+	}
+
+	const zip::Entry * pictureEntry = nullptr;
+	for (const QString & lumpName : pictureLumpNames)
+		if ((pictureEntry = entriesByLumpName.value( lumpName )) != nullptr)
+			break;
+	if (!pictureEntry)
+	{
+		titlePic.status = ReadStatus::InfoNotPresent;
+		return;
+	}
+
+	QByteArray picture;
+	titlePic.status = archive.readContent( *pictureEntry, picture, MaxPictureSize );
+	if (titlePic.status != ReadStatus::Success)
+		return;
+
+	QByteArray ownPalette;
+	if (!isStandardImage( picture ))
+		if (const zip::Entry * paletteEntry = entriesByLumpName.value( paletteLumpName ))
+			archive.readContent( *paletteEntry, ownPalette, MaxPictureSize );
+
+	decodePicture( picture, ownPalette, fallbackPalette, titlePic );
+}
+
+static void readTitlePicFromWad( const QString & filePath, const QByteArray & fallbackPalette, UncertainTitlePic & titlePic )
+{
+	QHash< QString, QByteArray > lumps;
+	titlePic.status = readWadLumps( filePath, allLumpNames, MaxPictureSize, lumps );
+	if (titlePic.status != ReadStatus::Success)
+		return;
+
+	for (const QString & lumpName : pictureLumpNames)
+	{
+		auto lumpIter = lumps.find( lumpName );
+		if (lumpIter != lumps.end())
+		{
+			decodePicture( *lumpIter, lumps.value( paletteLumpName ), fallbackPalette, titlePic );
+			return;
+		}
+	}
+
+	titlePic.status = ReadStatus::InfoNotPresent;  // only the palette is there
+}
+
+
+//======================================================================================================================
+//  public API
+
+UncertainTitlePic readTitlePic( const QString & filePath, const QByteArray & fallbackPalette )
+{
+	UncertainTitlePic titlePic;
+
+	QFile file( filePath );
+	if (!file.open( QIODevice::ReadOnly ))
+	{
+		titlePic.status = ReadStatus::CantOpen;
+		return titlePic;
+	}
+
+	if (zip::hasZipSignature( file.peek( 4 ) ))
+	{
+		readTitlePicFromZip( file, fallbackPalette, titlePic );
+	}
+	else
+	{
+		file.close();
+		readTitlePicFromWad( filePath, fallbackPalette, titlePic );
+	}
+
+	return titlePic;
+}
+
+QByteArray readWadPalette( const QString & filePath )
+{
+	QHash< QString, QByteArray > lumps;
+	if (readWadLumps( filePath, { paletteLumpName }, MaxPictureSize, lumps ) != ReadStatus::Success)
+		return {};
+
+	QByteArray palette = lumps.value( paletteLumpName );
+	return palette.size() >= PaletteSize ? palette.left( PaletteSize ) : QByteArray();
+}
+
+
+} // namespace doom
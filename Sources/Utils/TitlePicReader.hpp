@@ -0,0 +1,49 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: finding and decoding the title pictures of map packs
+//======================================================================================================================
+
+#ifndef TITLE_PIC_READER_INCLUDED
+#define TITLE_PIC_READER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "FileInfoCache.hpp"  // UncertainFileInfo, ReadStatus
+
+#include <QString>
+#include <QByteArray>
+#include <QImage>
+
+
+namespace doom {
+
+
+//======================================================================================================================
+
+struct TitlePic
+{
+	QImage image;
+	bool usesFallbackPalette = false;  ///< the map pack doesn't have its own palette, so the fallback one was used
+};
+
+using UncertainTitlePic = UncertainFileInfo< TitlePic >;
+
+/// Finds the title picture of a map pack (TITLEPIC, or INTERPIC when there is none) and decodes it.
+/** The picture can be in the Doom picture format, which is decoded using the PLAYPAL of the map pack,
+  * or the fallback palette when the map pack doesn't have any, or in PNG or JPEG, which is common in PK3 files.
+  * Returns InfoNotPresent if there is no picture, or if the fallback palette is needed but empty.
+  * Can be called from any thread. */
+UncertainTitlePic readTitlePic( const QString & filePath, const QByteArray & fallbackPalette );
+
+/// Reads the first palette of the PLAYPAL lump of a WAD, usually an IWAD.
+/** Returns empty array if the WAD has none. Can be called from any thread. */
+QByteArray readWadPalette( const QString & filePath );
+
+
+} // namespace doom
+
+
+#endif // TITLE_PIC_READER_INCLUDED
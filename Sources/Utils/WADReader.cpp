@@ -7,17 +7,34 @@
 
 #include "WADReader.hpp"
 
+#include "ZipReader.hpp"
+#include "SevenZipReader.hpp"
+#include "MapInfoParser.hpp"
 #include "JsonUtils.hpp"
 #include "ErrorHandling.hpp"
+#include "TimeStats.hpp"
 
 #include <QHash>
 #include <QFile>
 #include <QFileInfo>
 #include <QDateTime>
-#include <QTextStream>
-#include <QRegularExpression>
+#include <QVector>
+#include <QtAlgorithms>  // qCountTrailingZeroBits
+#include <QStringBuilder>
 
 #include <cctype>
+#include <cstring>
+#include <functional>
+#include <algorithm>  // sort, unique
+#include <iterator>  // size
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define LUMP_DIR_CHECK_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+	#include <arm_neon.h>
+	#define LUMP_DIR_CHECK_NEON
+#endif
 
 
 namespace doom {
@@ -34,9 +51,28 @@ class LoggingWadReader : protected LoggingComponent {
 	LoggingWadReader( QString filePath ) : LoggingComponent("ExeReader"), _filePath( std::move(filePath) ) {}
 
 	UncertainWadInfo readWadInfo();
+	UncertainFileInfo< WadHeaderInfo > readWadHeaderInfo();
+	ReadStatus readLumps( const QStringVec & lumpNames, qint64 maxLumpSize, QHash< QString, QByteArray > & lumps );
+	UncertainLumpNameSet readLumpNames();
 
  private:
 
+	struct WadHeader;
+	struct LumpEntry;
+
+	/// Returns the bytes of a lump, or nothing when the file can't be read.
+	using LumpDataReader = std::function< std::optional< QByteArray > ( const LumpEntry & lump ) >;
+
+	UncertainWadInfo readWadInfoFromMemory( const char * fileData, qint64 fileSize );
+	UncertainWadInfo readWadInfoFromFile( QFile & file, qint64 fileSize );
+	template< typename ArchiveReader, typename Entry >
+	UncertainWadInfo readWadInfoFromArchive( QFile & file );
+	template< typename ArchiveReader, typename Entry >
+	UncertainFileInfo< WadHeaderInfo > readWadHeaderInfoFromArchive( QFile & file );
+
+	bool checkHeader( const WadHeader & header, qint64 fileSize, UncertainWadInfo & wadInfo );
+	void scanLumpDir( const char * lumpDir, uint32_t numLumps, qint64 fileSize, const LumpDataReader & readLumpData, UncertainWadInfo & wadInfo );
+
 	QString _filePath;
 
 };
@@ -48,7 +84,7 @@ class LoggingWadReader : protected LoggingComponent {
 //  https://doomwiki.org/wiki/WAD
 
 /// section that every WAD file begins with
-struct WadHeader
+struct LoggingWadReader::WadHeader
 {
 	char wadType [4];  ///< either "IWAD" or "PWAD" but the string is NOT null terminated
 	uint32_t numLumps;  ///< number of entries in the lump directory
@@ -56,33 +92,45 @@ struct WadHeader
 };
 
 /// one entry of the lump directory
-struct LumpEntry
+struct LoggingWadReader::LumpEntry
 {
 	uint32_t dataOffset;
 	uint32_t size;
 	char name [8];  ///< might not be null-terminated when the string takes all 8 bytes
 };
 
-template< size_t N >
-QString charArrayToString( const char (&arr) [N] )
+// The lump names are checked directly on the raw 8-byte arrays, because a megawad can have tens of thousands of lumps
+// and building a QString for each of them just to find a few map markers would be wasteful.
+
+static size_t getLumpNameLength( const char (&name) [8] )
 {
-	// we need to make sure we have a null-terminated string, because the original one isn't when it's 8 chars long
-	char arr0 [N+1];
-	strncpy( arr0, arr, std::min( sizeof(arr0), sizeof(arr) ) );
-	arr0[N] = '\0';
-	return QString( arr0 );
+	size_t length = 0;
+	while (length < sizeof(name) && name[ length ] != '\0')
+		++length;
+	return length;
 }
 
-static bool isPrintableAsciiString( const QString & str )
+static bool isPrintableAscii( const char * str, size_t length )
 {
-	auto strLatin = str.toLatin1();
-	for (auto c : strLatin)
-		if (!isprint( c ))
+	for (size_t i = 0; i < length; ++i)
+		if (!isprint( uchar( str[i] ) ))
 			return false;
 	return true;
 }
 
-static const QSet< QString > blacklistedNames =
+template< size_t N >
+static bool nameEquals( const char * name, size_t length, const char (&str) [N] )
+{
+	return length == N - 1 && memcmp( name, str, N - 1 ) == 0;
+}
+
+template< size_t N >
+static bool nameEndsWith( const char * name, size_t length, const char (&suffix) [N] )
+{
+	return length >= N - 1 && memcmp( name + length - (N - 1), suffix, N - 1 ) == 0;
+}
+
+static const char * const blacklistedNames [] =
 {
 	"SEGS",
 	"SECTORS",
@@ -95,51 +143,269 @@ static const QSet< QString > blacklistedNames =
 	"REJECT",
 };
 
-static bool isMapMarker( const LumpEntry & lump, const QString & lumpName )
+static bool isMapMarker( uint32_t lumpSize, const char * name, size_t length )
+{
+	if (lumpSize != 0)
+		return false;
+	if (nameEndsWith( name, length, "_START" ) || nameEndsWith( name, length, "_END" )
+	 || nameEndsWith( name, length, "_S" ) || nameEndsWith( name, length, "_E" ))
+		return false;
+	for (const char * blacklistedName : blacklistedNames)
+		if (strlen( blacklistedName ) == length && memcmp( name, blacklistedName, length ) == 0)
+			return false;
+	return true;
+}
+
+static quint16 getKeyLumpFlag( const char * name, size_t length )
+{
+	if (nameEquals( name, length, "MAPINFO" ) || nameEquals( name, length, "ZMAPINFO" ) || nameEquals( name, length, "UMAPINFO" ))
+		return MapInfoLump;
+	else if (nameEquals( name, length, "DEHACKED" ))
+		return DehackedLump;
+	else if (nameEquals( name, length, "TITLEPIC" ))
+		return TitlePicLump;
+	else
+		return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+//  fast validation of the lump directory
+
+// Checking every character of every lump name with isprint() dominates the time of prefetching thousands of WADs,
+// so where the platform allows it, each 16-byte entry is loaded into a single vector register and its whole name
+// is checked at once. This happens in the same pass that collects the map names, so the directory is read only once.
+
+/// properties of one lump entry, one bit per byte of the name
+struct LumpEntryBits
+{
+	uint nameNonPrintable;  ///< including the null characters
+	uint nameNull;
+};
+
+#if defined(LUMP_DIR_CHECK_NEON)
+/// Converts a 64-bit mask with each byte being either 0x00 or 0xFF into 8 bits.
+static uint compressByteMask( uint64_t byteMask )
+{
+	return uint( ((byteMask & 0x8040201008040201ULL) * 0x0101010101010101ULL) >> 56 );
+}
+#endif
+
+static LumpEntryBits getLumpEntryBits( const char * entry )
+{
+	LumpEntryBits bits;
+
+ #if defined(LUMP_DIR_CHECK_SSE2)
+
+	__m128i v = _mm_loadu_si128( reinterpret_cast< const __m128i * >( entry ) );
+	// signed comparison, so that the bytes >= 0x80 are also outside the range
+	__m128i printable = _mm_and_si128( _mm_cmpgt_epi8( v, _mm_set1_epi8( 0x1F ) ), _mm_cmplt_epi8( v, _mm_set1_epi8( 0x7F ) ) );
+	__m128i null = _mm_cmpeq_epi8( v, _mm_setzero_si128() );
+	uint printableBits = uint( _mm_movemask_epi8( printable ) );
+	uint nullBits = uint( _mm_movemask_epi8( null ) );
+
+	// bytes 0-3 are the offset, 4-7 the size and 8-15 the name
+	bits.nameNonPrintable = ~(printableBits >> 8) & 0xFF;
+	bits.nameNull = nullBits >> 8;
+
+ #elif defined(LUMP_DIR_CHECK_NEON)
+
+	uint8x16_t v = vld1q_u8( reinterpret_cast< const uint8_t * >( entry ) );
+	uint8x16_t printable = vandq_u8( vcgeq_u8( v, vdupq_n_u8( 0x20 ) ), vcleq_u8( v, vdupq_n_u8( 0x7E ) ) );
+	uint8x16_t null = vceqq_u8( v, vdupq_n_u8( 0 ) );
+	uint64_t printableName = vgetq_lane_u64( vreinterpretq_u64_u8( printable ), 1 );
+	uint64_t nullName = vgetq_lane_u64( vreinterpretq_u64_u8( null ), 1 );
+
+	bits.nameNonPrintable = ~compressByteMask( printableName ) & 0xFF;
+	bits.nameNull = compressByteMask( nullName );
+
+ #else
+
+	bits.nameNonPrintable = 0;
+	bits.nameNull = 0;
+	for (uint i = 0; i < 8; ++i)
+	{
+		uchar c = uchar( entry[ 8 + i ] );
+		bits.nameNonPrintable |= uint( c < 0x20 || c > 0x7E ) << i;
+		bits.nameNull |= uint( c == '\0' ) << i;
+	}
+
+ #endif
+
+	return bits;
+}
+
+/// The name ends at the first null character or at the end of the 8 bytes.
+static size_t getLumpNameLength( const LumpEntryBits & bits )
+{
+	return qCountTrailingZeroBits( bits.nameNull | 0x100u );
+}
+
+/// Name must consist of printable characters up to its end.
+static bool isValidLumpName( const LumpEntryBits & bits, size_t nameLength )
 {
-	return lump.size == 0
-		&& !lumpName.endsWith("_START") && !lumpName.endsWith("_END")
-		&& !lumpName.endsWith("_S") && !lumpName.endsWith("_E")
-		&& !blacklistedNames.contains( lumpName );
+	uint nameMask = (1u << nameLength) - 1;
+	return (bits.nameNonPrintable & nameMask) == 0;
 }
 
-static void getMapNamesFromMAPINFO( const QByteArray & lumpData, QStringVec & mapNames )
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// The ports prefer ZMAPINFO when both are present, and UMAPINFO is the only one understood by the non-ZDoom ports.
+static const char * const mapInfoLumpNames [] = { "ZMAPINFO", "MAPINFO", "UMAPINFO" };
+static constexpr size_t NumMapInfoKinds = std::size( mapInfoLumpNames );
+
+static int getMapInfoPriority( const char * name, size_t length )
 {
-	QTextStream lumpText( lumpData, QIODevice::ReadOnly );
+	for (size_t i = 0; i < NumMapInfoKinds; ++i)
+		if (strlen( mapInfoLumpNames[i] ) == length && memcmp( name, mapInfoLumpNames[i], length ) == 0)
+			return int( i );
+	return -1;
+}
+
+bool LoggingWadReader::checkHeader( const WadHeader & header, qint64 fileSize, UncertainWadInfo & wadInfo )
+{
+	if (strncmp( header.wadType, "IWAD", sizeof(header.wadType) ) == 0)
+		wadInfo.type = WadType::IWAD;
+	else if (strncmp( header.wadType, "PWAD", sizeof(header.wadType) ) == 0)
+		wadInfo.type = WadType::PWAD;
+	else
+		wadInfo.type = WadType::Neither;
+
+	if (wadInfo.type == WadType::Neither)  // not a WAD format
+	{
+		logDebug() << _filePath << ": invalid WAD signature";
+		wadInfo.status = ReadStatus::InvalidFormat;
+		return false;
+	}
+
+	if (header.numLumps < 1 || header.numLumps > 65536)  // some garbage -> not a WAD
+	{
+		logDebug() << _filePath << ": invalid number of lumps";
+		wadInfo.status = ReadStatus::InvalidFormat;
+		return false;
+	}
+	qint64 lumpDirSize = qint64( header.numLumps ) * qint64( sizeof(LumpEntry) );
+	if (qint64( header.lumpDirOffset ) + lumpDirSize > fileSize)
+	{
+		logDebug() << _filePath << ": lump header points beyond the end of file";
+		wadInfo.status = ReadStatus::InvalidFormat;
+		return false;
+	}
 
-	static const QRegularExpression mapDefRegex("map\\s+(\\w+)\\s+\"([^\"]+)\"");
+	return true;
+}
 
-	QString line;
-	while (lumpText.readLineInto( &line ))
+void LoggingWadReader::scanLumpDir(
+	const char * lumpDir, uint32_t numLumps, qint64 fileSize, const LumpDataReader & readLumpData, UncertainWadInfo & wadInfo
+){
+	static_assert( sizeof(LumpEntry) == 16, "LumpEntry must match the layout in the file" );
+
+	std::optional< LumpEntry > mapInfoLumps [NumMapInfoKinds];
+
+	for (uint32_t i = 0; i < numLumps; ++i)
 	{
-		auto match = mapDefRegex.match( line );
-		if (match.hasMatch())
+		const char * entry = lumpDir + i * sizeof(LumpEntry);
+
+		// The entries don't have to be aligned in a memory-mapped file, so copy each one out before accessing its fields.
+		LumpEntry lump;
+		memcpy( &lump, entry, sizeof(LumpEntry) );
+		LumpEntryBits bits = getLumpEntryBits( entry );
+		size_t nameLength = getLumpNameLength( bits );
+
+		bool pointsBeyondEnd = qint64( lump.dataOffset ) + qint64( lump.size ) > fileSize;
+		if (pointsBeyondEnd || !isValidLumpName( bits, nameLength ))  // some garbage -> not a WAD
 		{
-			mapNames.append( match.captured(1) );
+			if (pointsBeyondEnd)
+				logDebug() << _filePath << ": lump points beyond the end of file";
+			else
+				logDebug() << _filePath << ": lump name is not a printable text";
+			wadInfo.mapNames.clear();  // what was collected so far is not valid either
+			wadInfo.keyLumps = 0;
+			wadInfo.status = ReadStatus::InvalidFormat;
+			return;
+		}
+
+		wadInfo.keyLumps |= getKeyLumpFlag( lump.name, nameLength );
+
+		// try to gather the map names from the marker lumps,
+		// but if we find a MAPINFO lump, let that one override the markers
+
+		if (isMapMarker( lump.size, lump.name, nameLength ))
+		{
+			wadInfo.mapNames.append( QString::fromLatin1( lump.name, int( nameLength ) ) );
+		}
+
+		// like with any other lump, the engines use the last one of the same name, the earlier ones are overridden
+		int mapInfoPriority = getMapInfoPriority( lump.name, nameLength );
+		if (mapInfoPriority >= 0)
+		{
+			mapInfoLumps[ mapInfoPriority ] = lump;
 		}
 	}
+
+	for (const std::optional< LumpEntry > & mapInfoLump : mapInfoLumps)
+	{
+		if (!mapInfoLump)
+			continue;
+
+		std::optional< QByteArray > lumpData = readLumpData( *mapInfoLump );
+		if (!lumpData)
+		{
+			wadInfo.status = ReadStatus::FailedToRead;
+			return;
+		}
+		else if (lumpData->size() < int( mapInfoLump->size ))
+		{
+			continue;
+		}
+
+		QStringVec mapInfoNames;
+		getMapNamesFromMapInfo( lumpData->constData(), lumpData->size(), mapInfoNames );
+		if (!mapInfoNames.isEmpty())  // it might only contain some global settings
+		{
+			wadInfo.mapNames = std::move(mapInfoNames);
+			break;
+		}
+	}
+
+	wadInfo.status = ReadStatus::Success;
 }
 
-UncertainWadInfo LoggingWadReader::readWadInfo()
+UncertainWadInfo LoggingWadReader::readWadInfoFromMemory( const char * fileData, qint64 fileSize )
 {
 	UncertainWadInfo wadInfo;
 
-	QFile file( _filePath );
-	if (!file.open( QIODevice::ReadOnly ))
+	WadHeader header;
+	if (qint64( sizeof(header) ) > fileSize)
 	{
-		logRuntimeError().noquote() << "Cannot open \""<<_filePath<<"\": "<<file.errorString();
-		wadInfo.status = ReadStatus::CantOpen;
+		logDebug() << _filePath << " is smaller than WAD header";
+		wadInfo.status = ReadStatus::InvalidFormat;
 		return wadInfo;
 	}
+	memcpy( &header, fileData, sizeof(header) );
 
-	const qint64 fileSize = file.size();
-	if (fileSize < 0)
+	if (!checkHeader( header, fileSize, wadInfo ))
 	{
-		logLogicError() << "file size is negative ("<<fileSize<<"), wtf??";
-		wadInfo.status = ReadStatus::FailedToRead;
 		return wadInfo;
 	}
 
+	// the lump directory is scanned right where it is, nothing needs to be copied
+	scanLumpDir( fileData + header.lumpDirOffset, header.numLumps, fileSize,
+		[ fileData ]( const LumpEntry & lump ) -> std::optional< QByteArray >
+		{
+			// MAPINFO is parsed before the file is unmapped, so the data doesn't have to be copied either
+			return QByteArray::fromRawData( fileData + lump.dataOffset, int( lump.size ) );
+		},
+		wadInfo
+	);
+
+	return wadInfo;
+}
+
+UncertainWadInfo LoggingWadReader::readWadInfoFromFile( QFile & file, qint64 fileSize )
+{
+	UncertainWadInfo wadInfo;
+
 	// read and validate WAD header
 
 	WadHeader header;
@@ -156,97 +422,509 @@ UncertainWadInfo LoggingWadReader::readWadInfo()
 		return wadInfo;
 	}
 
-	if (strncmp( header.wadType, "IWAD", sizeof(header.wadType) ) == 0)
-		wadInfo.type = WadType::IWAD;
-	else if (strncmp( header.wadType, "PWAD", sizeof(header.wadType) ) == 0)
-		wadInfo.type = WadType::PWAD;
-	else
-		wadInfo.type = WadType::Neither;
-
-	if (wadInfo.type == WadType::Neither)  // not a WAD format
+	if (!checkHeader( header, fileSize, wadInfo ))
 	{
-		logDebug() << _filePath << ": invalid WAD signature";
-		wadInfo.status = ReadStatus::InvalidFormat;
 		return wadInfo;
 	}
 
 	// read all lumps
 
-	if (header.numLumps < 1 || header.numLumps > 65536)  // some garbage -> not a WAD
+	// the lump directory is basically an array of LumpEntry structs, so let's read it all at once
+	qint64 lumpDirSize = qint64( header.numLumps ) * qint64( sizeof(LumpEntry) );
+	QByteArray lumpDir;
+	if (file.seek( header.lumpDirOffset ))
+		lumpDir = file.read( lumpDirSize );
+	if (lumpDir.size() < lumpDirSize)
 	{
-		logDebug() << _filePath << ": invalid number of lumps";
-		wadInfo.status = ReadStatus::InvalidFormat;
+		logRuntimeError() << _filePath << ": failed to read the lump directory";
+		wadInfo.status = ReadStatus::FailedToRead;
 		return wadInfo;
 	}
-	qint64 lumpDirSize = header.numLumps * sizeof(LumpEntry);
-	if (header.lumpDirOffset + lumpDirSize > fileSize)
+
+	scanLumpDir( lumpDir.constData(), header.numLumps, fileSize,
+		[ this, &file ]( const LumpEntry & lump ) -> std::optional< QByteArray >
+		{
+			if (!file.seek( lump.dataOffset ))
+			{
+				logRuntimeError() << _filePath << ": failed to seek to lump offset";
+				return std::nullopt;
+			}
+			return file.read( lump.size );
+		},
+		wadInfo
+	);
+
+	return wadInfo;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+//  ZIP and 7z package loading
+
+//  https://zdoom.org/wiki/Using_ZIPs_as_WAD_replacement
+//  The 7z packages (pk7) have the same layout, only the archive format differs.
+
+/// MAPINFO is a small text file, anything bigger is most likely not what we are looking for.
+static constexpr qint64 MaxMapInfoSize = 4 * 1024 * 1024;
+
+static bool isRootLumpFile( const QString & entryName, const char * lumpName )
+{
+	// MAPINFO and the like must be in the root directory and may or may not have an extension
+	if (entryName.contains('/'))
+		return false;
+	int dotIdx = entryName.indexOf('.');
+	return entryName.left( dotIdx ).compare( QLatin1String( lumpName ), Qt::CaseInsensitive ) == 0;
+}
+
+static quint16 getKeyLumpFlag( const QString & entryName )
+{
+	// besides the root, the lumps can also be in their namespace directory
+	if (isRootLumpFile( entryName, "MAPINFO" ) || isRootLumpFile( entryName, "ZMAPINFO" ) || isRootLumpFile( entryName, "UMAPINFO" ))
+		return MapInfoLump;
+	else if (isRootLumpFile( entryName, "DEHACKED" ))
+		return DehackedLump;
+	else if (isRootLumpFile( entryName, "TITLEPIC" ) || entryName.startsWith( "graphics/titlepic", Qt::CaseInsensitive ))
+		return TitlePicLump;
+	else
+		return 0;
+}
+
+template< typename ArchiveReader, typename Entry >
+UncertainWadInfo LoggingWadReader::readWadInfoFromArchive( QFile & file )
+{
+	UncertainWadInfo wadInfo;
+	wadInfo.type = WadType::Archive;
+
+	// read only the directory at the end of the archive, none of the packed files needs to be decompressed for that
+	ArchiveReader archive( file );
+	QVector< Entry > entries;
+	wadInfo.status = archive.readEntries( entries );
+	if (wadInfo.status != ReadStatus::Success)
 	{
-		logDebug() << _filePath << ": lump header points beyond the end of file";
-		wadInfo.status = ReadStatus::InvalidFormat;
 		return wadInfo;
 	}
-	// the lump directory is basically an array of LumpEntry structs, so let's read it all at once
-	std::unique_ptr< LumpEntry [] > lumpDir( new LumpEntry [header.numLumps] );
-	if (!file.seek( header.lumpDirOffset ) || file.read( (char*)lumpDir.get(), lumpDirSize ) < lumpDirSize)
+
+	// each map is a separate WAD in the maps directory
+	const Entry * mapInfoEntries [NumMapInfoKinds] = {};
+	for (const Entry & entry : entries)
 	{
-		logRuntimeError() << _filePath << ": failed to read the lump directory";
-		wadInfo.status = ReadStatus::FailedToRead;
-		return wadInfo;
+		wadInfo.keyLumps |= getKeyLumpFlag( entry.name );
+
+		if (entry.name.startsWith( "maps/", Qt::CaseInsensitive ) && entry.name.endsWith( ".wad", Qt::CaseInsensitive )
+		 && entry.name.indexOf( '/', 5 ) < 0)
+		{
+			wadInfo.mapNames.append( entry.name.mid( 5, entry.name.size() - 5 - 4 ).toUpper() );
+		}
+		else
+		{
+			// the last one wins, the same as in a WAD
+			for (size_t i = 0; i < NumMapInfoKinds; ++i)
+				if (isRootLumpFile( entry.name, mapInfoLumpNames[i] ))
+					mapInfoEntries[i] = &entry;
+		}
 	}
 
-	for (uint32_t i = 0; i < header.numLumps; ++i)
+	// if we find a MAPINFO, let that one override the map files
+	for (const Entry * entry : mapInfoEntries)
 	{
-		LumpEntry & lump = lumpDir[i];
-		QString lumpName = charArrayToString( lump.name );
-
-		if (lump.dataOffset + lump.size > fileSize)  // some garbage -> not a WAD
+		QByteArray content;
+		if (entry && archive.readContent( *entry, content, MaxMapInfoSize ) == ReadStatus::Success)
 		{
-			logDebug() << _filePath << ": lump points beyond the end of file";
-			wadInfo.status = ReadStatus::InvalidFormat;
-			return wadInfo;
+			QStringVec mapInfoNames;
+			getMapNamesFromMapInfo( content.constData(), content.size(), mapInfoNames );
+			if (!mapInfoNames.isEmpty())
+			{
+				wadInfo.mapNames = std::move(mapInfoNames);
+				break;
+			}
 		}
-		else if (!isPrintableAsciiString( lumpName ))  // some garbage -> not a WAD
+	}
+
+	return wadInfo;
+}
+
+template< typename ArchiveReader, typename Entry >
+UncertainFileInfo< WadHeaderInfo > LoggingWadReader::readWadHeaderInfoFromArchive( QFile & file )
+{
+	UncertainFileInfo< WadHeaderInfo > headerInfo;
+
+	// an IPK3 or IPK7 is recognized by the IWADINFO lump, which only needs the directory at the end of the archive
+	ArchiveReader archive( file );
+	QVector< Entry > entries;
+	headerInfo.status = archive.readEntries( entries );
+	headerInfo.type = WadType::Archive;
+	for (const Entry & entry : entries)
+	{
+		if (isRootLumpFile( entry.name, "IWADINFO" ))
 		{
-			logDebug() << _filePath << ": lump name is not a printable text";
-			wadInfo.status = ReadStatus::InvalidFormat;
-			return wadInfo;
+			headerInfo.type = WadType::IWAD;
+			break;
 		}
+	}
+	return headerInfo;
+}
 
-		// try to gather the map names from the marker lumps,
-		// but if we find a MAPINFO lump, let that one override the markers
 
-		if (isMapMarker( lump, lumpName ))
+//----------------------------------------------------------------------------------------------------------------------
+
+UncertainWadInfo LoggingWadReader::readWadInfo()
+{
+	UncertainWadInfo wadInfo;
+
+	QFile file( _filePath );
+	if (!file.open( QIODevice::ReadOnly ))
+	{
+		logRuntimeError().noquote() << "Cannot open \""<<_filePath<<"\": "<<file.errorString();
+		wadInfo.status = ReadStatus::CantOpen;
+		return wadInfo;
+	}
+
+	const qint64 fileSize = file.size();
+	if (fileSize < 0)
+	{
+		logLogicError() << "file size is negative ("<<fileSize<<"), wtf??";
+		wadInfo.status = ReadStatus::FailedToRead;
+		return wadInfo;
+	}
+
+	// ZIP and 7z packages keep their directory at the end of the file, these must not be mapped and scanned from the beginning
+	QByteArray fileStart = file.peek( 6 );
+	if (zip::hasZipSignature( fileStart ))
+	{
+		return readWadInfoFromArchive< zip::ArchiveReader, zip::Entry >( file );
+	}
+	if (sevenzip::hasSevenZipSignature( fileStart ))
+	{
+		return readWadInfoFromArchive< sevenzip::ArchiveReader, sevenzip::Entry >( file );
+	}
+
+	// Mapping the file lets us look only at the pages of the lump directory instead of copying it into a buffer.
+	// It can fail for various reasons (empty file, special file system, exhausted address space on 32-bit systems),
+	// and then the file is read the ordinary way.
+	if (fileSize > 0)
+	{
+		if (uchar * fileData = file.map( 0, fileSize ))
 		{
-			wadInfo.mapNames.append( lumpName );
+			wadInfo = readWadInfoFromMemory( reinterpret_cast< const char * >( fileData ), fileSize );
+			file.unmap( fileData );
+			return wadInfo;
 		}
+		logDebug() << _filePath << ": cannot map the file ("<<file.errorString()<<"), reading it instead";
+	}
+
+	return readWadInfoFromFile( file, fileSize );
+}
+
+
+UncertainFileInfo< WadHeaderInfo > LoggingWadReader::readWadHeaderInfo()
+{
+	UncertainFileInfo< WadHeaderInfo > headerInfo;
+
+	QFile file( _filePath );
+	if (!file.open( QIODevice::ReadOnly ))
+	{
+		logRuntimeError().noquote() << "Cannot open \""<<_filePath<<"\": "<<file.errorString();
+		headerInfo.status = ReadStatus::CantOpen;
+		return headerInfo;
+	}
+
+	QByteArray fileStart = file.peek( sizeof(WadHeader) );
+
+	if (zip::hasZipSignature( fileStart ))
+	{
+		return readWadHeaderInfoFromArchive< zip::ArchiveReader, zip::Entry >( file );
+	}
+	if (sevenzip::hasSevenZipSignature( fileStart ))
+	{
+		return readWadHeaderInfoFromArchive< sevenzip::ArchiveReader, sevenzip::Entry >( file );
+	}
+
+	if (fileStart.size() < int( sizeof(WadHeader) ))
+	{
+		logDebug() << _filePath << " is smaller than WAD header";
+		headerInfo.status = ReadStatus::InvalidFormat;
+		return headerInfo;
+	}
+
+	if (fileStart.startsWith( "IWAD" ))
+		headerInfo.type = WadType::IWAD;
+	else if (fileStart.startsWith( "PWAD" ))
+		headerInfo.type = WadType::PWAD;
+	else
+		headerInfo.type = WadType::Neither;
+
+	headerInfo.status = ReadStatus::Success;
+	return headerInfo;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+//  lump names for the load order analysis
+
+//  https://zdoom.org/wiki/Namespace
+//  https://zdoom.org/wiki/Using_ZIPs_as_WAD_replacement
+
+// These are combined from all the loaded files by the engines, so having them in multiple mods is not a conflict.
+static const char * const cumulativeLumpNames [] =
+{
+	"DECORATE", "ZSCRIPT", "MAPINFO", "ZMAPINFO", "UMAPINFO", "EMAPINFO", "DEHACKED", "SNDINFO", "SNDSEQ", "GLDEFS",
+	"LANGUAGE", "KEYCONF", "TEXTURES", "ANIMDEFS", "DECALDEF", "LOCKDEFS", "TERRAIN", "MENUDEF", "CVARINFO", "LOADACS",
+	"MODELDEF", "VOXELDEF", "FONTDEFS", "REVERBS", "SECRETS", "ALTHUDCF", "DOOMDEFS", "HERETDEFS", "HEXNDEFS", "STRFDEFS",
+	"TEXCOLOR", "TEXTCOLO", "SPLASHES", "MUSINFO", "PALVERS", "IWADINFO",
+};
+
+// lumps that belong to a map, the map conflicts are already detected by the marker
+static const char * const mapDataLumpNames [] =
+{
+	"THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SEGS", "SSECTORS", "NODES", "SECTORS", "REJECT", "BLOCKMAP",
+	"BEHAVIOR", "SCRIPTS", "TEXTMAP", "ZNODES", "DIALOGUE", "ENDMAP", "LEAFS", "LIGHTS", "MACROS",
+};
+
+// the top directories of a ZIP package, whose files are lumps of a namespace, no matter how deep they are
+static const char * const namespaceDirNames [] =
+{
+	"sprites", "flats", "patches", "textures", "colormaps", "acs", "hires", "voxels", "graphics", "sounds", "music",
+};
+
+static bool isOneOf( const QString & name, const char * const * names, size_t count )
+{
+	for (size_t i = 0; i < count; ++i)
+		if (name == QLatin1String( names[i] ))
+			return true;
+	return false;
+}
+
+/// Converts the prefix of a marker (S_START, SS_START, P1_START) or the top directory of a ZIP package
+/// to the name of the namespace they represent, empty for the global namespace.
+static QString getNamespaceName( QString prefix )
+{
+	prefix = prefix.toLower();
+	if (prefix == "s" || prefix == "ss" || prefix == "sprites")
+		return "sprites";
+	else if (prefix == "f" || prefix == "ff" || prefix == "flats")
+		return "flats";
+	else if (prefix == "p" || prefix == "pp" || prefix == "p1" || prefix == "p2" || prefix == "p3" || prefix == "patches")
+		return "patches";
+	else if (prefix == "tx" || prefix == "textures")
+		return "textures";
+	else if (prefix == "c" || prefix == "colormaps")
+		return "colormaps";
+	else if (prefix == "a" || prefix == "acs")
+		return "acs";
+	else if (prefix == "hi" || prefix == "hires")
+		return "hires";
+	else if (prefix == "vx" || prefix == "voxels")
+		return "voxels";
+	else if (prefix == "graphics" || prefix == "sounds" || prefix == "music")
+		return {};  // in a WAD these are global lumps
+	else
+		return prefix;
+}
+
+static void addLumpName( QStringVec & names, const QString & nameSpace, const QString & lumpName )
+{
+	if (nameSpace.isEmpty())
+	{
+		if (!isOneOf( lumpName, cumulativeLumpNames, std::size( cumulativeLumpNames ) ))
+			names.append( lumpName );
+	}
+	else
+	{
+		names.append( nameSpace % '/' % lumpName );
+	}
+}
+
+static void finalizeLumpNames( UncertainLumpNameSet & lumpNames )
+{
+	std::sort( lumpNames.names.begin(), lumpNames.names.end() );
+	lumpNames.names.erase( std::unique( lumpNames.names.begin(), lumpNames.names.end() ), lumpNames.names.end() );
+	lumpNames.contentHash = quint64( qHashRange( lumpNames.names.begin(), lumpNames.names.end() ) ) ^ quint64( lumpNames.names.size() );
+	lumpNames.status = ReadStatus::Success;
+}
+
+UncertainLumpNameSet LoggingWadReader::readLumpNames()
+{
+	UncertainLumpNameSet lumpNames;
+
+	QFile file( _filePath );
+	if (!file.open( QIODevice::ReadOnly ))
+	{
+		logRuntimeError().noquote() << "Cannot open \""<<_filePath<<"\": "<<file.errorString();
+		lumpNames.status = ReadStatus::CantOpen;
+		return lumpNames;
+	}
+
+	const qint64 fileSize = file.size();
 
-		if (lumpName == "MAPINFO")
+	if (zip::hasZipSignature( file.peek( 4 ) ))
+	{
+		zip::ArchiveReader archive( file );
+		QVector< zip::Entry > entries;
+		lumpNames.status = archive.readEntries( entries );
+		if (lumpNames.status != ReadStatus::Success)
+			return lumpNames;
+
+		for (const zip::Entry & entry : entries)
 		{
-			qint64 origPos = file.pos();
+			if (entry.isDir())
+				continue;
 
-			if (!file.seek( lump.dataOffset ))
+			int firstSlash = entry.name.indexOf('/');
+			int lastSlash = entry.name.lastIndexOf('/');
+			QString fileName = entry.name.mid( lastSlash + 1 );
+			QString lumpName = fileName.left( fileName.indexOf('.') ).toUpper();
+			if (lumpName.isEmpty())
+				continue;
+
+			if (firstSlash < 0)  // root, the same as the global namespace of a WAD
 			{
-				logRuntimeError() << _filePath << ": failed to seek to lump offset";
-				wadInfo.status = ReadStatus::FailedToRead;
-				return wadInfo;
+				addLumpName( lumpNames.names, {}, lumpName );
+				continue;
 			}
 
-			QByteArray lumpData = file.read( lump.size );
-			if (lumpData.size() < int( lump.size ))
+			QString topDir = entry.name.left( firstSlash ).toLower();
+			if (topDir == "maps")
 			{
-				file.seek( origPos );
-				continue;
+				if (firstSlash == lastSlash && fileName.endsWith( ".wad", Qt::CaseInsensitive ))
+					lumpNames.names.append( "maps/" + lumpName );
+			}
+			else if (isOneOf( topDir, namespaceDirNames, std::size( namespaceDirNames ) ))
+			{
+				// its sub-directories are just for organization, the engine uses only the file name
+				addLumpName( lumpNames.names, getNamespaceName( topDir ), lumpName );
+			}
+			else
+			{
+				// anything else is only accessible by the full path, for example the files included from ZSCRIPT
+				lumpNames.names.append( entry.name.toLower() );
 			}
+		}
 
-			wadInfo.mapNames.clear();
-			getMapNamesFromMAPINFO( lumpData, wadInfo.mapNames );
+		finalizeLumpNames( lumpNames );
+		return lumpNames;
+	}
 
-			break;
+	WadHeader header;
+	if (file.read( (char*)&header, sizeof(header) ) < qint64( sizeof(header) ))
+	{
+		logDebug() << _filePath << " is smaller than WAD header";
+		lumpNames.status = ReadStatus::InvalidFormat;
+		return lumpNames;
+	}
+
+	UncertainWadInfo headerCheck;
+	if (!checkHeader( header, fileSize, headerCheck ))
+	{
+		lumpNames.status = headerCheck.status;
+		return lumpNames;
+	}
+
+	qint64 lumpDirSize = qint64( header.numLumps ) * qint64( sizeof(LumpEntry) );
+	QByteArray lumpDir;
+	if (file.seek( header.lumpDirOffset ))
+		lumpDir = file.read( lumpDirSize );
+	if (lumpDir.size() < lumpDirSize)
+	{
+		logRuntimeError() << _filePath << ": failed to read the lump directory";
+		lumpNames.status = ReadStatus::FailedToRead;
+		return lumpNames;
+	}
+
+	QString nameSpace;  // set by the X_START markers, reset by the X_END markers
+	lumpNames.names.reserve( int( header.numLumps ) );
+	for (uint32_t i = 0; i < header.numLumps; ++i)
+	{
+		LumpEntry lump;
+		memcpy( &lump, lumpDir.constData() + qint64( i ) * qint64( sizeof(LumpEntry) ), sizeof(lump) );
+		size_t nameLength = getLumpNameLength( lump.name );
+		if (nameLength == 0 || !isPrintableAscii( lump.name, nameLength ))
+			continue;
+
+		if (lump.size == 0)
+		{
+			if (nameEndsWith( lump.name, nameLength, "_START" ))
+				nameSpace = getNamespaceName( QString::fromLatin1( lump.name, int( nameLength - 6 ) ) );
+			else if (nameEndsWith( lump.name, nameLength, "_END" ))
+				nameSpace.clear();
+			else if (isMapMarker( lump.size, lump.name, nameLength ))
+				lumpNames.names.append( "maps/" + QString::fromLatin1( lump.name, int( nameLength ) ).toUpper() );
+			continue;
 		}
+
+		QString lumpName = QString::fromLatin1( lump.name, int( nameLength ) ).toUpper();
+		if (lumpName.startsWith( "GL_" ) || isOneOf( lumpName, mapDataLumpNames, std::size( mapDataLumpNames ) ))
+			continue;
+
+		addLumpName( lumpNames.names, nameSpace, lumpName );
 	}
 
-	wadInfo.status = ReadStatus::Success;
-	return wadInfo;
+	finalizeLumpNames( lumpNames );
+	return lumpNames;
+}
+
+ReadStatus LoggingWadReader::readLumps( const QStringVec & lumpNames, qint64 maxLumpSize, QHash< QString, QByteArray > & lumps )
+{
+	QFile file( _filePath );
+	if (!file.open( QIODevice::ReadOnly ))
+	{
+		logRuntimeError().noquote() << "Cannot open \""<<_filePath<<"\": "<<file.errorString();
+		return ReadStatus::CantOpen;
+	}
+
+	const qint64 fileSize = file.size();
+
+	WadHeader header;
+	if (file.read( (char*)&header, sizeof(header) ) < qint64( sizeof(header) ))
+	{
+		logDebug() << _filePath << " is smaller than WAD header";
+		return ReadStatus::InvalidFormat;
+	}
+
+	UncertainWadInfo headerCheck;
+	if (!checkHeader( header, fileSize, headerCheck ))
+	{
+		return headerCheck.status;
+	}
+
+	qint64 lumpDirSize = qint64( header.numLumps ) * qint64( sizeof(LumpEntry) );
+	QByteArray lumpDir;
+	if (file.seek( header.lumpDirOffset ))
+		lumpDir = file.read( lumpDirSize );
+	if (lumpDir.size() < lumpDirSize)
+	{
+		logRuntimeError() << _filePath << ": failed to read the lump directory";
+		return ReadStatus::FailedToRead;
+	}
+
+	// the engines use the last lump of a name, so search from the end, then the first match is the right one
+	for (uint32_t lumpIdx = header.numLumps; lumpIdx > 0 && lumps.size() < lumpNames.size(); --lumpIdx)
+	{
+		LumpEntry lump;
+		memcpy( &lump, lumpDir.constData() + qint64( lumpIdx - 1 ) * qint64( sizeof(LumpEntry) ), sizeof(lump) );
+
+		QString lumpName = QString::fromLatin1( lump.name, int( getLumpNameLength( lump.name ) ) ).toUpper();
+		if (!lumpNames.contains( lumpName ) || lumps.contains( lumpName ))
+			continue;
+
+		if (qint64( lump.size ) > maxLumpSize || qint64( lump.dataOffset ) + qint64( lump.size ) > fileSize)
+		{
+			logDebug() << _filePath << ": lump " << lumpName << " is too big or points beyond the end of file";
+			continue;
+		}
+
+		if (!file.seek( lump.dataOffset ))
+		{
+			logRuntimeError() << _filePath << ": failed to seek to lump offset";
+			return ReadStatus::FailedToRead;
+		}
+		QByteArray content = file.read( lump.size );
+		if (content.size() < qint64( lump.size ))
+		{
+			logRuntimeError() << _filePath << ": failed to read lump " << lumpName;
+			return ReadStatus::FailedToRead;
+		}
+		lumps.insert( lumpName, std::move(content) );
+	}
+
+	return lumps.isEmpty() ? ReadStatus::InfoNotPresent : ReadStatus::Success;
 }
 
 
@@ -255,11 +933,37 @@ UncertainWadInfo LoggingWadReader::readWadInfo()
 
 UncertainWadInfo readWadInfo( const QString & filePath )
 {
+	ScopeTimer timer( "reading WAD info", /*reportThresholdMs*/10 );
+
 	LoggingWadReader wadReader( filePath );
 	return wadReader.readWadInfo();
 }
 
-FileInfoCache< WadInfo > g_cachedWadInfo( readWadInfo );
+FileInfoCache< WadInfo > g_cachedWadInfo( readWadInfo, /*useFingerprints*/true );  // map packs get moved around a lot
+
+UncertainFileInfo< WadHeaderInfo > readWadHeaderInfo( const QString & filePath )
+{
+	LoggingWadReader wadReader( filePath );
+	return wadReader.readWadHeaderInfo();
+}
+
+FileInfoCache< WadHeaderInfo > g_cachedWadHeaders( readWadHeaderInfo );
+
+UncertainLumpNameSet readLumpNames( const QString & filePath )
+{
+	ScopeTimer timer( "reading lump names", /*reportThresholdMs*/10 );
+
+	LoggingWadReader wadReader( filePath );
+	return wadReader.readLumpNames();
+}
+
+FileInfoCache< LumpNameSet > g_cachedLumpNames( readLumpNames );
+
+ReadStatus readWadLumps( const QString & filePath, const QStringVec & lumpNames, qint64 maxLumpSize, QHash< QString, QByteArray > & lumps )
+{
+	LoggingWadReader wadReader( filePath );
+	return wadReader.readLumps( lumpNames, maxLumpSize, lumps );
+}
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -269,6 +973,7 @@ void WadInfo::serialize( QJsonObject & jsWadInfo ) const
 {
 	jsWadInfo["type"] = int( type );
 	jsWadInfo["map_names"] = serializeStringVec( mapNames );
+	jsWadInfo["key_lumps"] = int( keyLumps );
 }
 
 void WadInfo::deserialize( const JsonObjectCtx & jsWadInfo )
@@ -276,6 +981,29 @@ void WadInfo::deserialize( const JsonObjectCtx & jsWadInfo )
 	type = jsWadInfo.getEnum< doom::WadType >( "type", doom::WadType::Neither );
 	if (JsonArrayCtx jsMapNames = jsWadInfo.getArray( "map_names" ))
 		mapNames = deserializeStringVec( jsMapNames );
+	keyLumps = quint16( jsWadInfo.getInt( "key_lumps", 0, DontShowError ) );
+}
+
+void WadHeaderInfo::serialize( QJsonObject & jsHeaderInfo ) const
+{
+	jsHeaderInfo["type"] = int( type );
+}
+
+void WadHeaderInfo::deserialize( const JsonObjectCtx & jsHeaderInfo )
+{
+	type = jsHeaderInfo.getEnum< doom::WadType >( "type", doom::WadType::Neither );
+}
+
+void LumpNameSet::serialize( QJsonObject & jsLumpNames ) const
+{
+	jsLumpNames["names"] = serializeStringVec( names );
+}
+
+void LumpNameSet::deserialize( const JsonObjectCtx & jsLumpNames )
+{
+	if (JsonArrayCtx jsNames = jsLumpNames.getArray( "names" ))
+		names = deserializeStringVec( jsNames );
+	contentHash = quint64( qHashRange( names.begin(), names.end() ) ) ^ quint64( names.size() );
 }
 
 
@@ -15,6 +15,8 @@
 #include "FileInfoCache.hpp"
 
 #include <QString>
+#include <QByteArray>
+#include <QHash>
 
 class QJsonObject;
 class JsonObjectCtx;
@@ -28,12 +30,24 @@ enum class WadType
 	Neither,
 	IWAD,
 	PWAD,
+	Archive,  ///< ZIP-based or 7z-based package (pk3, ipk3, pk7, ...)
+};
+
+/// lumps whose presence says something about what the WAD changes, bit flags
+enum KeyLump : quint16
+{
+	MapInfoLump  = 1 << 0,  ///< MAPINFO, ZMAPINFO or UMAPINFO
+	DehackedLump = 1 << 1,
+	TitlePicLump = 1 << 2,
 };
 
 struct WadInfo
 {
 	WadType type = WadType::Neither;
 	QStringVec mapNames;
+	quint16 keyLumps = 0;  ///< combination of KeyLump flags
+
+	bool hasLump( KeyLump lump ) const  { return (keyLumps & lump) != 0; }
 
 	void serialize( QJsonObject & jsWadInfo ) const;
 	void deserialize( const JsonObjectCtx & jsWadInfo );
@@ -41,12 +55,55 @@ struct WadInfo
 
 using UncertainWadInfo = UncertainFileInfo< WadInfo >;
 
-/// Reads selected information from a WAD file.
+/// Reads selected information from a WAD file, a ZIP-based package (pk3) or a 7z-based package (pk7).
 /** BEWARE that on file I/O operations may sometimes be expensive, caching the info is adviced. */
 UncertainWadInfo readWadInfo( const QString & filePath );
 
+/// what a file declares itself to be
+struct WadHeaderInfo
+{
+	WadType type = WadType::Neither;  ///< ZIP packages with IWADINFO are reported as IWAD, the others as Archive
+
+	void serialize( QJsonObject & jsHeaderInfo ) const;
+	void deserialize( const JsonObjectCtx & jsHeaderInfo );
+};
+
+/// Reads only the 12-byte header of a WAD file, or the directory of a ZIP or 7z package.
+/** Much cheaper than readWadInfo(), meant for deciding which files to offer at all. */
+UncertainFileInfo< WadHeaderInfo > readWadHeaderInfo( const QString & filePath );
+
+/// names of the lumps a file provides, for finding out which files override each other's content
+struct LumpNameSet
+{
+	/// Sorted and unique. The names are prefixed by their namespace (sprites/POSSA1, maps/MAP01), so that the entries
+	/// of a WAD and of a ZIP package that the engine would treat as the same lump have the same name.
+	QStringVec names;
+	quint64 contentHash = 0;  ///< changes whenever the names change, so that the results derived from them know when to update
+
+	void serialize( QJsonObject & jsLumpNames ) const;
+	void deserialize( const JsonObjectCtx & jsLumpNames );
+};
+
+using UncertainLumpNameSet = UncertainFileInfo< LumpNameSet >;
+
+/// Reads the names of the lumps from a WAD file or the entries of a ZIP-based package.
+/** The lumps that are merged by the engines instead of replaced (DECORATE, MAPINFO, ...), the map data lumps
+  * and the markers are left out, what remains are the names that replace each other in the load order. */
+UncertainLumpNameSet readLumpNames( const QString & filePath );
+
+/// Reads the content of the lumps with these (upper-case) names from a WAD file.
+/** When there are more lumps of the same name, the last one is taken, the same way as the engines do it.
+  * Lumps bigger than maxLumpSize are skipped. Returns InfoNotPresent when none of them is in the file. */
+ReadStatus readWadLumps( const QString & filePath, const QStringVec & lumpNames, qint64 maxLumpSize, QHash< QString, QByteArray > & lumps );
+
 
 extern FileInfoCache< WadInfo > g_cachedWadInfo;
+extern FileInfoCache< WadHeaderInfo > g_cachedWadHeaders;
+/// Key of g_cachedWadHeaders in the JSON cache file, its version must be increased whenever readWadHeaderInfo()
+/// starts recognizing files it didn't before, otherwise they would stay cached with the old result.
+/** v2: 7z packages (ipk7 used to be cached as Neither) */
+inline const char * const WadHeaderCacheKey = "wad_headers_v2";
+extern FileInfoCache< LumpNameSet > g_cachedLumpNames;  ///< not persisted, a big mod has thousands of lumps
 
 
 } // namespace doom
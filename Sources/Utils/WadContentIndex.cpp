@@ -0,0 +1,117 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: index of which WAD files contain which maps and key lumps
+//======================================================================================================================
+
+#include "WadContentIndex.hpp"
+
+#include "TimeStats.hpp"
+
+#include <QRunnable>
+
+
+namespace doom {
+
+
+static const KeyLump allKeyLumps [] = { MapInfoLump, DehackedLump, TitlePicLump };
+
+
+//======================================================================================================================
+
+WadContentIndex::WadContentIndex() : LoggingComponent("WadContentIndex")
+{
+	_threadPool.setMaxThreadCount( 1 );
+}
+
+WadContentIndex::~WadContentIndex()
+{
+	_threadPool.clear();
+	_threadPool.waitForDone();  // the task refers to this object
+}
+
+QStringVec WadContentIndex::findFilesWithMap( const QString & mapName )
+{
+	updateIfOutdated();
+
+	QMutexLocker lock( &_mutex );
+	return _index.filesByMap.value( mapName.toUpper() );
+}
+
+QStringVec WadContentIndex::findFilesWithLump( KeyLump lump )
+{
+	updateIfOutdated();
+
+	QMutexLocker lock( &_mutex );
+	return _index.filesByLump.value( quint16( lump ) );
+}
+
+void WadContentIndex::rebuildInBackground()
+{
+	class RebuildTask : public QRunnable {
+		WadContentIndex * _owner;
+	 public:
+		RebuildTask( WadContentIndex * owner ) : _owner( owner ) {}
+		virtual void run() override
+		{
+			_owner->_rebuildQueued = false;
+			_owner->updateIfOutdated();
+		}
+	};
+
+	// if a rebuild is already waiting, it will see the latest state of the cache anyway
+	if (!_rebuildQueued.exchange( true ))
+	{
+		_threadPool.start( new RebuildTask( this ) );
+	}
+}
+
+void WadContentIndex::updateIfOutdated()
+{
+	// read the generation before building, so that changes made during the build trigger another one next time
+	quint64 cacheGeneration = g_cachedWadInfo.generation();
+
+	QMutexLocker lock( &_mutex );  // held during the build, so that concurrent queries don't build it twice
+
+	if (cacheGeneration == _builtGeneration)
+		return;
+
+	_index = buildIndex();
+	_builtGeneration = cacheGeneration;
+}
+
+WadContentIndex::Index WadContentIndex::buildIndex()
+{
+	ScopeTimer timer( "building WAD content index", /*reportThresholdMs*/5 );
+
+	Index index;
+
+	g_cachedWadInfo.forEachEntry( [&]( const QString & filePath, const FileInfoCache< WadInfo >::Entry & entry )
+	{
+		const UncertainWadInfo & wadInfo = entry.fileInfo;
+		if (wadInfo.status != ReadStatus::Success)
+			return;
+
+		for (const QString & mapName : wadInfo.mapNames)
+		{
+			QStringVec & files = index.filesByMap[ mapName.toUpper() ];
+			if (files.isEmpty() || files.last() != filePath)  // MAPINFO may define the same map more than once
+				files.append( filePath );
+		}
+
+		for (KeyLump lump : allKeyLumps)
+			if (wadInfo.hasLump( lump ))
+				index.filesByLump[ quint16( lump ) ].append( filePath );
+	});
+
+	return index;
+}
+
+
+//======================================================================================================================
+
+WadContentIndex g_wadContentIndex;
+
+
+} // namespace doom
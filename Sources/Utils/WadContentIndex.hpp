@@ -0,0 +1,80 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: index of which WAD files contain which maps and key lumps
+//======================================================================================================================
+
+#ifndef WAD_CONTENT_INDEX_INCLUDED
+#define WAD_CONTENT_INDEX_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "CommonTypes.hpp"
+#include "WADReader.hpp"  // KeyLump
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QThreadPool>
+
+#include <atomic>
+
+
+namespace doom {
+
+
+//======================================================================================================================
+/// Answers questions like "which files contain MAP07" across all the WADs known to g_cachedWadInfo.
+/**
+  * The index is derived from the WAD info cache, which is persistent and gets filled with the whole map directory
+  * by the WadInfoPrefetcher, so no file has to be opened to build it. It is rebuilt whenever the cache changes,
+  * either in the background by rebuildInBackground(), or on the first query after the change.
+  *
+  * Thread-safe. The returned paths are in the same form as the paths the cache was queried with.
+  */
+class WadContentIndex : protected LoggingComponent {
+
+ public:
+
+	WadContentIndex();
+	~WadContentIndex();
+
+	/// Returns the files that contain a map of this name (case-insensitive).
+	QStringVec findFilesWithMap( const QString & mapName );
+
+	/// Returns the files that contain the key lump, for example which files change the title screen.
+	QStringVec findFilesWithLump( KeyLump lump );
+
+	/// Rebuilds the index in a worker thread, if the cache has changed since the last build.
+	void rebuildInBackground();
+
+ private:
+
+	struct Index
+	{
+		QHash< QString, QStringVec > filesByMap;
+		QHash< quint16, QStringVec > filesByLump;
+	};
+
+	static Index buildIndex();
+	void updateIfOutdated();
+
+	QMutex _mutex;  ///< protects the members below
+	Index _index;
+	quint64 _builtGeneration = quint64(-1);
+
+	QThreadPool _threadPool;
+	std::atomic< bool > _rebuildQueued { false };
+
+};
+
+extern WadContentIndex g_wadContentIndex;
+
+
+} // namespace doom
+
+
+#endif // WAD_CONTENT_INDEX_INCLUDED
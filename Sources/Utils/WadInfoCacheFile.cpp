@@ -0,0 +1,651 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: compact binary storage of the WAD info cache
+//======================================================================================================================
+
+#include "WadInfoCacheFile.hpp"
+
+#include "WADReader.hpp"
+#include "FileSystemUtils.hpp"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QLockFile>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QByteArray>
+#include <QtEndian>
+#include <QStringBuilder>
+
+#include <cstring>
+#include <cstddef>  // offsetof
+
+#if !IS_WINDOWS
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <cerrno>
+#endif
+
+
+namespace doom {
+
+
+//======================================================================================================================
+//  file format
+
+// All numbers are little-endian. The file is laid out as:
+//   FileHeader
+//   EntryRecord [numEntries]
+//   quint32 mapNameRefs [numMapRefs]   - indexes to the string table, each entry owns a continuous range of them
+//   quint32 stringOffsets [numStrings + 1]   - offsets of the strings in the string data, the last one marks the end
+//   char stringData [stringDataSize]   - UTF-8 strings without null terminators
+
+static const char FileMagic [4] = { 'D', 'R', 'W', 'C' };
+static constexpr quint16 FormatVersion = 6;  // also bumped when the reader learns to read files it rejected before
+
+struct FileHeader
+{
+	char magic [4];
+	quint16 version;
+	quint16 reserved;
+	quint32 numEntries;
+	quint32 numMapRefs;
+	quint32 numStrings;
+	quint32 stringDataSize;
+};
+static_assert( sizeof(FileHeader) == 24, "FileHeader must not contain padding" );
+
+struct EntryRecord
+{
+	qint64 lastModified;  ///< in milliseconds
+	qint64 fileSize;
+	quint64 fingerprint;
+	qint64 lastAccess;  ///< in milliseconds
+	quint32 pathIdx;
+	quint32 firstMapRef;
+	quint32 numMapNames;
+	quint8 status;
+	quint8 wadType;
+	quint16 keyLumps;
+};
+static_assert( sizeof(EntryRecord) == 48, "EntryRecord must not contain padding" );
+
+template< typename Struct >
+static void appendStruct( QByteArray & bytes, const Struct & s )
+{
+	bytes.append( reinterpret_cast< const char * >( &s ), int( sizeof(s) ) );
+}
+
+template< typename Struct >
+static Struct readStruct( const char * data )
+{
+	Struct s;
+	memcpy( &s, data, sizeof(s) );  // the data in a byte array don't have to be aligned
+	return s;
+}
+
+static void appendLE32( QByteArray & bytes, quint32 value )
+{
+	char buffer [4];
+	qToLittleEndian( value, buffer );
+	bytes.append( buffer, 4 );
+}
+
+/// Stores each distinct string only once.
+class StringTable {
+
+ public:
+
+	quint32 intern( const QString & str )
+	{
+		auto iter = _indexes.find( str );
+		if (iter != _indexes.end())
+			return iter.value();
+
+		quint32 index = quint32( _offsets.size() );
+		_indexes.insert( str, index );
+		_offsets.append( quint32( _data.size() ) );
+		_data.append( str.toUtf8() );
+		return index;
+	}
+
+	quint32 size() const   { return quint32( _offsets.size() ); }
+	quint32 dataSize() const   { return quint32( _data.size() ); }
+
+	void appendTo( QByteArray & bytes ) const
+	{
+		for (quint32 offset : _offsets)
+			appendLE32( bytes, offset );
+		appendLE32( bytes, quint32( _data.size() ) );  // end of the last string
+		bytes.append( _data );
+	}
+
+ private:
+
+	QHash< QString, quint32 > _indexes;
+	QVector< quint32 > _offsets;
+	QByteArray _data;
+
+};
+
+
+//======================================================================================================================
+//  saving
+
+QByteArray serializeWadInfoCache()
+{
+	QVector< EntryRecord > records;
+	QVector< quint32 > mapNameRefs;
+	StringTable strings;
+
+	auto serializeEntry = [&]( const QString & wadPath, const FileInfoCache< WadInfo >::Entry & entry )
+	{
+		const UncertainWadInfo & wadInfo = entry.fileInfo;
+
+		EntryRecord record;
+		record.lastModified = qToLittleEndian( entry.stamp.lastModified );
+		record.fileSize = qToLittleEndian( entry.stamp.size );
+		record.fingerprint = qToLittleEndian( entry.fingerprint );
+		record.lastAccess = qToLittleEndian( entry.lastAccess );
+		record.pathIdx = qToLittleEndian( strings.intern( wadPath ) );
+		record.firstMapRef = qToLittleEndian( quint32( mapNameRefs.size() ) );
+		record.numMapNames = qToLittleEndian( quint32( wadInfo.mapNames.size() ) );
+		record.status = quint8( wadInfo.status );
+		record.wadType = quint8( wadInfo.type );
+		record.keyLumps = qToLittleEndian( wadInfo.keyLumps );
+		records.append( record );
+
+		for (const QString & mapName : wadInfo.mapNames)
+			mapNameRefs.append( strings.intern( mapName ) );
+	};
+	g_cachedWadInfo.forEachEntry( serializeEntry );
+	g_cachedWadInfo.forEachOrphan( serializeEntry );  // they become orphans again when loaded
+
+	FileHeader header;
+	memcpy( header.magic, FileMagic, sizeof(header.magic) );
+	header.version = qToLittleEndian( FormatVersion );
+	header.reserved = 0;
+	header.numEntries = qToLittleEndian( quint32( records.size() ) );
+	header.numMapRefs = qToLittleEndian( quint32( mapNameRefs.size() ) );
+	header.numStrings = qToLittleEndian( strings.size() );
+	header.stringDataSize = qToLittleEndian( strings.dataSize() );
+
+	QByteArray bytes;
+	bytes.reserve( int( sizeof(header) + records.size() * sizeof(EntryRecord) + (mapNameRefs.size() + strings.size() + 1) * 4
+	                    + strings.dataSize() ) );
+	appendStruct( bytes, header );
+	for (const EntryRecord & record : records)
+		appendStruct( bytes, record );
+	for (quint32 ref : mapNameRefs)
+		appendLE32( bytes, ref );
+	strings.appendTo( bytes );
+
+	// if the caller fails to write it, it has to call markAsDirty()
+	g_cachedWadInfo.markAsSaved();
+	return bytes;
+}
+
+
+//======================================================================================================================
+//  loading
+
+QString loadWadInfoCache( const QString & filePath )
+{
+	QByteArray bytes;
+	QString error = fs::readWholeFile( filePath, bytes );
+	if (!error.isEmpty())
+		return error;
+
+	const char * data = bytes.constData();
+	const qint64 size = bytes.size();
+	auto corrupted = [&]() -> QString { return "File "%filePath%" is corrupted, the cache will be rebuilt."; };
+
+	if (size < qint64( sizeof(FileHeader) ))
+		return corrupted();
+	FileHeader header = readStruct< FileHeader >( data );
+	if (memcmp( header.magic, FileMagic, sizeof(header.magic) ) != 0)
+		return corrupted();
+	if (qFromLittleEndian( header.version ) != FormatVersion)
+		return {};  // older or newer format, nothing to load, it will be overwritten with the current one
+
+	const qint64 numEntries = qFromLittleEndian( header.numEntries );
+	const qint64 numMapRefs = qFromLittleEndian( header.numMapRefs );
+	const qint64 numStrings = qFromLittleEndian( header.numStrings );
+	const qint64 stringDataSize = qFromLittleEndian( header.stringDataSize );
+
+	const qint64 recordsPos = sizeof(FileHeader);
+	const qint64 mapRefsPos = recordsPos + numEntries * qint64( sizeof(EntryRecord) );
+	const qint64 stringOffsetsPos = mapRefsPos + numMapRefs * 4;
+	const qint64 stringDataPos = stringOffsetsPos + (numStrings + 1) * 4;
+	if (stringDataPos + stringDataSize != size)
+		return corrupted();
+
+	// decode every distinct string only once, the entries then share the same implicitly shared QStrings
+	QVector< QString > strings;
+	strings.reserve( int( numStrings ) );
+	quint32 strBegin = qFromLittleEndian< quint32 >( data + stringOffsetsPos );
+	for (qint64 i = 0; i < numStrings; ++i)
+	{
+		quint32 strEnd = qFromLittleEndian< quint32 >( data + stringOffsetsPos + (i + 1) * 4 );
+		if (strEnd < strBegin || strEnd > stringDataSize)
+			return corrupted();
+		strings.append( QString::fromUtf8( data + stringDataPos + strBegin, int( strEnd - strBegin ) ) );
+		strBegin = strEnd;
+	}
+
+	for (qint64 i = 0; i < numEntries; ++i)
+	{
+		EntryRecord record = readStruct< EntryRecord >( data + recordsPos + i * qint64( sizeof(EntryRecord) ) );
+		quint32 pathIdx = qFromLittleEndian( record.pathIdx );
+		qint64 firstMapRef = qFromLittleEndian( record.firstMapRef );
+		qint64 numMapNames = qFromLittleEndian( record.numMapNames );
+		if (pathIdx >= numStrings || firstMapRef + numMapNames > numMapRefs
+		 || record.status >= quint8( ReadStatus::Uninitialized ) || record.wadType > quint8( WadType::Archive ))
+			return corrupted();
+
+		FileInfoCache< WadInfo >::Entry entry;
+		UncertainWadInfo & wadInfo = entry.fileInfo;
+		wadInfo.status = ReadStatus( record.status );
+		wadInfo.type = WadType( record.wadType );
+		wadInfo.keyLumps = qFromLittleEndian( record.keyLumps );
+		wadInfo.mapNames.reserve( int( numMapNames ) );
+		for (qint64 j = firstMapRef; j < firstMapRef + numMapNames; ++j)
+		{
+			quint32 nameIdx = qFromLittleEndian< quint32 >( data + mapRefsPos + j * 4 );
+			if (nameIdx >= numStrings)
+				return corrupted();
+			wadInfo.mapNames.append( strings[ int( nameIdx ) ] );
+		}
+
+		entry.stamp = FileStamp( qFromLittleEndian( record.fileSize ), qFromLittleEndian( record.lastModified ) );
+		entry.fingerprint = qFromLittleEndian( record.fingerprint );
+		entry.lastAccess = qFromLittleEndian( record.lastAccess );
+		g_cachedWadInfo.addLoadedEntry( strings[ int( pathIdx ) ], std::move(entry) );
+	}
+
+	return {};
+}
+
+
+//======================================================================================================================
+//  shared file
+
+// All numbers are little-endian. The file is laid out as:
+//   SharedFileHeader
+//   SharedRecord + char mapNames [namesSize]   - repeated until the end of the file, the map names are UTF-8 joined by '\n'
+// Every record starts with a magic and carries a checksum of itself, so that when a write is cut off by a crash
+// and the next installation appends after it, the reader skips the damaged bytes and finds the beginning of the next record.
+
+static const char SharedFileMagic [4] = { 'D', 'R', 'W', 'S' };
+static const char SharedRecordMagic [4] = { 'D', 'R', 'W', 'R' };
+// the version is part of the file name, so that different versions of the application don't overwrite each other's file
+static const QString sharedFileName = "shared_wad_info_v" % QString::number( FormatVersion ) % ".bin";
+
+static constexpr qint64 MaxSharedFileSize = 16 * 1024 * 1024;  ///< the file is started over when it grows above this limit
+static constexpr int SharedLockTimeout = 1000;  ///< [ms] the others hold the lock only for a single read or write
+
+struct SharedFileHeader
+{
+	char magic [4];
+	quint16 version;
+	quint16 reserved;
+};
+static_assert( sizeof(SharedFileHeader) == 8, "SharedFileHeader must not contain padding" );
+
+struct SharedRecord
+{
+	char magic [4];
+	quint32 checksum;  ///< of the rest of the record and the map names
+	quint64 fingerprint;
+	qint64 fileSize;
+	quint32 namesSize;
+	quint8 status;
+	quint8 wadType;
+	quint16 keyLumps;
+};
+static_assert( sizeof(SharedRecord) == 32, "SharedRecord must not contain padding" );
+static constexpr qint64 SharedRecordChecksumStart = offsetof( SharedRecord, fingerprint );
+
+static bool isValidSharedHeader( const SharedFileHeader & header )
+{
+	return memcmp( header.magic, SharedFileMagic, sizeof(header.magic) ) == 0
+	    && qFromLittleEndian( header.version ) == FormatVersion;
+}
+
+/// the record and its map names must be continuous in memory
+static quint32 computeRecordChecksum( const char * record, qint64 namesSize )
+{
+	QCryptographicHash hash( QCryptographicHash::Md5 );  // not for security, the file is writable by others anyway
+	hash.addData( record + SharedRecordChecksumStart, int( qint64( sizeof(SharedRecord) ) - SharedRecordChecksumStart + namesSize ) );
+	return qFromLittleEndian< quint32 >( hash.result().constData() );
+}
+
+static QByteArray makeSharedFileHeader()
+{
+	SharedFileHeader header;
+	memcpy( header.magic, SharedFileMagic, sizeof(header.magic) );
+	header.version = qToLittleEndian( FormatVersion );
+	header.reserved = 0;
+
+	QByteArray bytes;
+	appendStruct( bytes, header );
+	return bytes;
+}
+
+//-- protection against the other users ------------------------------------------------------------
+
+// On Linux the directory is in /var/tmp, where any local user could prepare it in advance, with a symlink in place of
+// the file pointing to a file of the victim. So a directory is trusted only when it's our own (then the sticky bit
+// prevents the others from replacing our files), or when it's root-owned and sticky (created by the administrator
+// for all the users, then the files of the other users can be used too). The files are never opened through a symlink
+// or a hard link and a file is never truncated, it's only replaced by a new one, and only when it's our own.
+// On Windows the ProgramData subdirectories are protected by their ACLs.
+
+enum class DirTrust
+{
+	Untrusted,
+	Own,        ///< only our own files can be used
+	Common,     ///< root-owned and sticky, the files of all the users can be used
+};
+
+#if !IS_WINDOWS
+
+static DirTrust checkSharedDir( const QString & dirPath, bool createIfMissing, QString & error )
+{
+	const QByteArray nativePath = QFile::encodeName( dirPath );
+
+	struct stat dirStat;
+	if (lstat( nativePath.constData(), &dirStat ) != 0)
+	{
+		if (errno != ENOENT || !createIfMissing)
+			return DirTrust::Untrusted;  // nothing to read there
+		if (mkdir( nativePath.constData(), 0700 ) != 0 || chmod( nativePath.constData(), 01777 ) != 0
+		 || lstat( nativePath.constData(), &dirStat ) != 0)
+		{
+			error = "Cannot create directory "%dirPath%" ("%QString::fromLocal8Bit( strerror( errno ) )%")";
+			return DirTrust::Untrusted;
+		}
+	}
+
+	if (!S_ISDIR( dirStat.st_mode ))  // lstat() doesn't follow a symlink, so that's refused too
+	{
+		error = dirPath%" is not a directory, refusing to use it.";
+		return DirTrust::Untrusted;
+	}
+	if (dirStat.st_uid == geteuid())
+	{
+		// don't leave our directory world-writable without the sticky bit, the others could replace our files
+		if ((dirStat.st_mode & S_IWOTH) && !(dirStat.st_mode & S_ISVTX) && chmod( nativePath.constData(), 01777 ) != 0)
+		{
+			error = "Cannot set permissions of directory "%dirPath%", refusing to use it.";
+			return DirTrust::Untrusted;
+		}
+		return DirTrust::Own;
+	}
+	if (dirStat.st_uid == 0 && (dirStat.st_mode & S_ISVTX))
+	{
+		return DirTrust::Common;
+	}
+
+	error = "Directory "%dirPath%" belongs to another user, refusing to use it.";
+	return DirTrust::Untrusted;
+}
+
+/// Opens the file without following a symlink and checks that it can be trusted.
+static QString openSharedFile( QFile & file, DirTrust dirTrust, bool forWriting, bool & isOwn )
+{
+	const QString filePath = file.fileName();
+	const int flags = (forWriting ? O_RDWR | O_CREAT : O_RDONLY) | O_NOFOLLOW | O_CLOEXEC;
+	const int fd = ::open( QFile::encodeName( filePath ).constData(), flags, 0666 );
+	if (fd < 0)
+		return "Cannot open file "%filePath%" ("%QString::fromLocal8Bit( strerror( errno ) )%")";
+
+	struct stat fileStat;
+	if (fstat( fd, &fileStat ) != 0 || !S_ISREG( fileStat.st_mode ) || fileStat.st_nlink != 1)
+	{
+		::close( fd );
+		return "File "%filePath%" is not a regular file, refusing to use it.";
+	}
+	isOwn = fileStat.st_uid == geteuid();
+	if (!isOwn && dirTrust != DirTrust::Common)
+	{
+		::close( fd );
+		return "File "%filePath%" belongs to another user, refusing to use it.";
+	}
+	if (forWriting)
+	{
+		fchmod( fd, 0666 );  // so that the other users can append too, fails harmlessly for the files of the others
+	}
+
+	if (!file.open( fd, forWriting ? QIODevice::ReadWrite : QIODevice::ReadOnly, QFileDevice::AutoCloseHandle ))
+	{
+		::close( fd );
+		return "Cannot open file "%filePath%" ("%file.errorString()%")";
+	}
+	return {};
+}
+
+#else // IS_WINDOWS
+
+static DirTrust checkSharedDir( const QString & dirPath, bool createIfMissing, QString & error )
+{
+	QDir dir( dirPath );
+	if (!dir.exists())
+	{
+		if (!createIfMissing)
+			return DirTrust::Untrusted;  // nothing to read there
+		if (!dir.mkpath("."))
+		{
+			error = "Cannot create directory "%dirPath;
+			return DirTrust::Untrusted;
+		}
+	}
+	return DirTrust::Common;
+}
+
+static QString openSharedFile( QFile & file, DirTrust, bool forWriting, bool & isOwn )
+{
+	isOwn = true;  // the ACLs decide who can write there
+	if (!file.open( forWriting ? QIODevice::ReadWrite : QIODevice::ReadOnly ))
+		return "Cannot open file "%file.fileName()%" ("%file.errorString()%")";
+	return {};
+}
+
+#endif // IS_WINDOWS
+
+//-- loading ---------------------------------------------------------------------------------------
+
+QString loadSharedWadInfoCache( const QString & dirPath )
+{
+	QString error;
+	const DirTrust dirTrust = checkSharedDir( dirPath, /*createIfMissing*/false, error );
+	if (dirTrust == DirTrust::Untrusted)
+		return error;
+
+	const QString filePath = QDir( dirPath ).filePath( sharedFileName );
+	if (!QFileInfo::exists( filePath ))
+		return {};
+
+	// Also the reading is done under the lock, because another installation might replace the file
+	// while it's being read.
+	QLockFile lockFile( filePath % ".lock" );
+	if (!lockFile.tryLock( SharedLockTimeout ))
+		return {};  // the entries will be simply read from the WADs
+
+	QFile file( filePath );
+	bool isOwn = false;
+	error = openSharedFile( file, dirTrust, /*forWriting*/false, isOwn );
+	if (!error.isEmpty())
+		return error;
+
+	const qint64 size = file.size();
+	QByteArray buffer;
+	const char * data = nullptr;
+	if (const uchar * mapped = file.map( 0, size ))
+	{
+		data = reinterpret_cast< const char * >( mapped );
+	}
+	else  // not all file systems support mapping
+	{
+		buffer = file.readAll();
+		if (buffer.size() != size)
+			return "Failed to read file "%filePath%" ("%file.errorString()%")";
+		data = buffer.constData();
+	}
+
+	if (size < qint64( sizeof(SharedFileHeader) ))
+		return {};  // another installation is just creating it
+	SharedFileHeader header = readStruct< SharedFileHeader >( data );
+	if (!isValidSharedHeader( header ))
+		return "File "%filePath%" is corrupted, it will be started over.";
+
+	const QByteArray content = QByteArray::fromRawData( data, int( size ) );  // for searching, doesn't copy
+	const QByteArray recordMagic = QByteArray::fromRawData( SharedRecordMagic, sizeof(SharedRecordMagic) );
+	QSet< QString > mapNamePool;  // the entries then share the same implicitly shared QStrings
+	int damagedRecords = 0;
+
+	qint64 pos = sizeof(SharedFileHeader);
+	while (pos + qint64( sizeof(SharedRecord) ) <= size)
+	{
+		SharedRecord record = readStruct< SharedRecord >( data + pos );
+		const qint64 namesSize = qFromLittleEndian( record.namesSize );
+		const qint64 namesPos = pos + qint64( sizeof(SharedRecord) );
+		const bool isValid = memcmp( record.magic, SharedRecordMagic, sizeof(record.magic) ) == 0
+		                  && namesPos + namesSize <= size
+		                  && qFromLittleEndian( record.checksum ) == computeRecordChecksum( data + pos, namesSize );
+		if (!isValid)
+		{
+			// an interrupted write, or garbage, resynchronize on the next record
+			damagedRecords++;
+			pos = content.indexOf( recordMagic, int( pos + 1 ) );
+			if (pos < 0)
+				break;
+			continue;
+		}
+		pos = namesPos + namesSize;
+
+		if (record.status >= quint8( ReadStatus::Uninitialized ) || record.wadType > quint8( WadType::Archive ))
+			continue;  // written by a newer or broken installation, the others are still usable
+
+		FileInfoCache< WadInfo >::Entry entry;
+		UncertainWadInfo & wadInfo = entry.fileInfo;
+		wadInfo.status = ReadStatus( record.status );
+		wadInfo.type = WadType( record.wadType );
+		wadInfo.keyLumps = qFromLittleEndian( record.keyLumps );
+		if (namesSize > 0)
+		{
+			const QString allNames = QString::fromUtf8( data + namesPos, int( namesSize ) );
+			for (const QString & mapName : allNames.split( '\n' ))
+			{
+				auto nameIter = mapNamePool.find( mapName );
+				if (nameIter == mapNamePool.end())
+					nameIter = mapNamePool.insert( mapName );
+				wadInfo.mapNames.append( *nameIter );
+			}
+		}
+
+		entry.stamp = FileStamp( qFromLittleEndian( record.fileSize ), 0 );
+		entry.fingerprint = qFromLittleEndian( record.fingerprint );
+		g_cachedWadInfo.addSharedEntry( std::move(entry) );
+	}
+
+	if (damagedRecords > 0)
+		logDebug("WadInfoCache") << "skipped " << damagedRecords << " damaged places in " << filePath;
+
+	return {};
+}
+
+//-- appending -------------------------------------------------------------------------------------
+
+QString appendToSharedWadInfoCache( const QString & dirPath )
+{
+	QVector< FileInfoCache< WadInfo >::Entry > newEntries;
+	QByteArray records;
+	g_cachedWadInfo.forEachUnsharedEntry( [&]( const FileInfoCache< WadInfo >::Entry & entry )
+	{
+		const UncertainWadInfo & wadInfo = entry.fileInfo;
+		const QByteArray names = wadInfo.mapNames.join( '\n' ).toUtf8();
+
+		SharedRecord record;
+		memcpy( record.magic, SharedRecordMagic, sizeof(record.magic) );
+		record.checksum = 0;
+		record.fingerprint = qToLittleEndian( entry.fingerprint );
+		record.fileSize = qToLittleEndian( entry.stamp.size );
+		record.namesSize = qToLittleEndian( quint32( names.size() ) );
+		record.status = quint8( wadInfo.status );
+		record.wadType = quint8( wadInfo.type );
+		record.keyLumps = qToLittleEndian( wadInfo.keyLumps );
+
+		const int recordPos = records.size();
+		appendStruct( records, record );
+		records.append( names );
+		const quint32 checksum = computeRecordChecksum( records.constData() + recordPos, names.size() );
+		qToLittleEndian( checksum, records.data() + recordPos + offsetof( SharedRecord, checksum ) );
+
+		newEntries.append( entry );
+	});
+	if (records.isEmpty())
+		return {};
+
+	QString error;
+	const DirTrust dirTrust = checkSharedDir( dirPath, /*createIfMissing*/true, error );
+	if (dirTrust == DirTrust::Untrusted)
+		return error;
+	const QString filePath = QDir( dirPath ).filePath( sharedFileName );
+
+	QLockFile lockFile( filePath % ".lock" );
+	if (!lockFile.tryLock( SharedLockTimeout ))
+		return "Shared file "%filePath%" is locked by another installation, the entries will be shared later.";
+
+	{
+		QFile file( filePath );
+		bool isOwn = false;
+		error = openSharedFile( file, dirTrust, /*forWriting*/true, isOwn );
+		if (!error.isEmpty())
+			return error;
+
+		SharedFileHeader header;
+		const bool isEmpty = file.size() == 0;
+		const bool needsStartOver = file.size() > MaxSharedFileSize
+			|| (!isEmpty && (file.read( reinterpret_cast< char * >( &header ), sizeof(header) ) != qint64( sizeof(header) )
+			                 || !isValidSharedHeader( header )));
+
+		if (!needsStartOver)
+		{
+			QByteArray bytes = isEmpty ? makeSharedFileHeader() : QByteArray();
+			bytes.append( records );
+
+			// A partial record left at the end by a crashed writer is skipped by the reader thanks to the record magic.
+			if (!file.seek( file.size() ) || file.write( bytes ) != bytes.size())
+				return "Failed to write file "%filePath%" ("%file.errorString()%")";
+			if (!file.flush())
+				return "Failed to write file "%filePath%" ("%file.errorString()%")";
+		}
+		else if (!isOwn)
+		{
+			return "File "%filePath%" of another user needs to be started over, leaving that to its owner.";
+		}
+		else
+		{
+			// never truncate the file in place, replace it by a new one, so that even a hard link to it stays intact
+			file.close();
+			error = fs::updateFileSafely( filePath, makeSharedFileHeader() + records );
+			if (!error.isEmpty())
+				return error;
+		}
+	}
+
+	// only now the others know them, if any of the steps above failed, they will be retried with the next save
+	for (FileInfoCache< WadInfo >::Entry & entry : newEntries)
+		g_cachedWadInfo.addSharedEntry( std::move(entry) );
+
+	return {};
+}
+
+} // namespace doom
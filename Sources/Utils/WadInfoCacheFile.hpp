@@ -0,0 +1,57 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: compact binary storage of the WAD info cache
+//======================================================================================================================
+
+#ifndef WAD_INFO_CACHE_FILE_INCLUDED
+#define WAD_INFO_CACHE_FILE_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include <QString>
+#include <QByteArray>
+
+
+namespace doom {
+
+
+// Re-parsing every WAD on each start is cheaper than parsing the same information from JSON, but not cheaper than
+// loading a flat binary file in a single read. The file consists of a header, an array of fixed-size entry records
+// and a table of unique strings, so that names like MAP01 shared by hundreds of WADs are stored only once.
+
+/// Encodes the content of g_cachedWadInfo into the content of the binary file and marks the cache as saved.
+/** If writing the content fails, call g_cachedWadInfo.markAsDirty(), otherwise the new entries would not be saved until
+  * something else changes. */
+QByteArray serializeWadInfoCache();
+
+/// Loads the entries from a binary file into g_cachedWadInfo.
+/** Returns description of an error that might potentially happen, or empty string on success.
+  * A file of a different format version is not an error, it is ignored and the cache will be rebuilt. */
+QString loadWadInfoCache( const QString & filePath );
+
+
+// Multiple installations of this application on one machine (portable copies, a copy per user) usually know the same
+// WADs. In addition to its own cache each of them can also use a shared file in a common directory.
+// The shared file is append-only and contains only the content-derived part of the entries, looked up by the fingerprint,
+// because the paths and the timestamps are different for each installation. The access is guarded by a lock file.
+// On Linux a directory created by an ordinary user is used only by that user, to share the file between all users
+// the administrator has to create it root-owned with the sticky bit (mode 1777).
+
+/// Loads the entries from the shared file in the directory as entries known to the other installations.
+/** Returns description of an error that might potentially happen, or empty string on success.
+  * A missing file is not an error, and neither is a file locked by another installation for too long. */
+QString loadSharedWadInfoCache( const QString & dirPath );
+
+/// Appends the fingerprinted entries of g_cachedWadInfo, that the other installations don't know yet, to the shared file.
+/** Returns description of an error that might potentially happen, or empty string on success.
+  * Can be called from a worker thread. */
+QString appendToSharedWadInfoCache( const QString & dirPath );
+
+
+} // namespace doom
+
+
+#endif // WAD_INFO_CACHE_FILE_INCLUDED
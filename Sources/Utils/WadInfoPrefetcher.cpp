@@ -0,0 +1,102 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: reading of WAD info in background threads ahead of time
+//======================================================================================================================
+
+#include "WadInfoPrefetcher.hpp"
+
+#include "WADReader.hpp"  // g_cachedWadInfo
+#include "DirSnapshotCache.hpp"
+
+#include <QRunnable>
+#include <QDir>
+
+
+namespace doom {
+
+
+//======================================================================================================================
+
+class WadInfoPrefetcher::ListTask : public QRunnable {
+
+ public:
+
+	ListTask( WadInfoPrefetcher * owner, const QString & dirPath, const QStringVec & fileSuffixes, const PathConvertor & pathConvertor )
+	:
+		_owner( owner ), _dirPath( dirPath ), _fileSuffixes( fileSuffixes ),
+		// QDir caches some of its data lazily, so rather don't share its instance with the main thread and make our own.
+		_workingDirPath( pathConvertor.workingDir().path() ), _pathStyle( pathConvertor.pathStyle() )
+	{}
+
+	virtual void run() override
+	{
+		if (_owner->_cancelled)
+			return;
+
+		PathConvertor pathConvertor( QDir( _workingDirPath ), _pathStyle );
+
+		const QStringList filePaths = fs::g_cachedDirSnapshots.getFiles( _dirPath, /*recursively*/false );
+		for (const QString & filePath : filePaths)
+		{
+			if (_owner->_cancelled)  // a big directory takes a while to go through
+				return;
+
+			if (fs::hasOneOfSuffixes( filePath, _fileSuffixes ))
+			{
+				g_cachedWadInfo.prefetchFileInfo( pathConvertor.convertPath( filePath ) );
+			}
+		}
+	}
+
+ private:
+
+	WadInfoPrefetcher * _owner;
+	QString _dirPath;
+	QStringVec _fileSuffixes;
+	QString _workingDirPath;
+	PathStyle _pathStyle;
+
+};
+
+
+//======================================================================================================================
+
+WadInfoPrefetcher::WadInfoPrefetcher() : LoggingComponent("WadInfoPrefetcher")
+{
+	_threadPool.setMaxThreadCount( 1 );  // listing is cheap compared to reading, one thread is enough
+}
+
+WadInfoPrefetcher::~WadInfoPrefetcher()
+{
+	cancelAll();
+	_threadPool.waitForDone();  // the tasks refer to this object
+}
+
+void WadInfoPrefetcher::prefetchFiles( const QStringVec & filePaths )
+{
+	for (const QString & filePath : filePaths)
+	{
+		g_cachedWadInfo.prefetchFileInfo( filePath );
+	}
+}
+
+void WadInfoPrefetcher::prefetchDir( const QString & dirPath, const QStringVec & fileSuffixes, const PathConvertor & pathConvertor )
+{
+	_cancelled = false;
+
+	if (!dirPath.isEmpty())
+	{
+		_threadPool.start( new ListTask( this, dirPath, fileSuffixes, pathConvertor ) );
+	}
+}
+
+void WadInfoPrefetcher::cancelAll()
+{
+	_cancelled = true;
+	_threadPool.clear();
+}
+
+
+} // namespace doom
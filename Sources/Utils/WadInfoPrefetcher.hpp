@@ -0,0 +1,65 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: reading of WAD info in background threads ahead of time
+//======================================================================================================================
+
+#ifndef WAD_INFO_PREFETCHER_INCLUDED
+#define WAD_INFO_PREFETCHER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "CommonTypes.hpp"
+#include "FileSystemUtils.hpp"  // PathConvertor
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QThreadPool>
+
+#include <atomic>
+
+
+namespace doom {
+
+
+//======================================================================================================================
+/// Fills g_cachedWadInfo in the background, so that reading the map names when the user selects a WAD is a cache hit.
+/**
+  * Parsing a big WAD or PK3 on a cold disk cache can take long enough to freeze the window for a noticeable moment,
+  * so the files are read by the worker threads of the cache right after they appear in the directory lists.
+  * The cache reads a file again only when its modification time changes.
+  *
+  * Must be constructed and used from the main thread.
+  */
+class WadInfoPrefetcher : protected LoggingComponent {
+
+ public:
+
+	WadInfoPrefetcher();
+	~WadInfoPrefetcher();
+
+	/// Queues reading of the files that haven't been read yet or have changed since.
+	void prefetchFiles( const QStringVec & filePaths );
+
+	/// Lists a directory (not recursively) in a worker thread and queues reading of the files with one of the suffixes.
+	/** The paths are converted the same way as the paths the cache will be queried with. */
+	void prefetchDir( const QString & dirPath, const QStringVec & fileSuffixes, const PathConvertor & pathConvertor );
+
+	/// Drops the directories that are still waiting to be listed.
+	void cancelAll();
+
+ private:
+
+	class ListTask;
+
+	QThreadPool _threadPool;  ///< only for the listing, the files are read by the cache's own workers
+	std::atomic< bool > _cancelled { false };
+
+};
+
+
+} // namespace doom
+
+
+#endif // WAD_INFO_PREFETCHER_INCLUDED
@@ -14,8 +14,12 @@
 #include "CommonTypes.hpp"
 #include "ContainerUtils.hpp"    // findSuch
 #include "FileSystemUtils.hpp"   // traverseDirectory
+#include "AsyncDirTraverser.hpp"
+#include "DirSnapshotCache.hpp"
 #include "Widgets/ListModel.hpp"
 #include "ErrorHandling.hpp"
+#include "TimeStats.hpp"
+#include "Diagnostics.hpp"  // g_syncScans
 
 #include <QAbstractItemView>
 #include <QListView>
@@ -27,11 +31,14 @@
 #include <QDir>
 #include <QDirIterator>
 #include <QFileInfo>
+#include <QElapsedTimer>
+#include <QHash>
 
 class QTableWidget;
 
 #include <functional>
 #include <type_traits>
+#include <memory>
 
 
 //======================================================================================================================
@@ -158,6 +165,35 @@ int appendItem( QListView * view, ListModel & model, const typename ListModel::I
 	return model.size() - 1;
 }
 
+/// Adds several items to the end of the list with a single notification of the view and selects the last one.
+template< typename ListModel >
+int appendItems( QListView * view, ListModel & model, QList< typename ListModel::Item > && items )
+{
+	if (!model.canBeModified())
+	{
+		reportLogicError( view->parentWidget(), "Model cannot be modified",
+			"Cannot append items because the model is locked for changes."
+		);
+		return -1;
+	}
+	if (items.isEmpty())
+	{
+		return -1;
+	}
+
+	deselectAllAndUnsetCurrent( view );
+
+	model.startAppending( int( items.size() ) );
+
+	model.insertRange( model.size(), std::move(items) );
+
+	model.finishAppending();
+
+	selectAndSetCurrentByIndex( view, model.size() - 1 );  // select the last appended item
+
+	return model.size() - 1;
+}
+
 /// Adds an item to the begining of the list and selects it.
 template< typename ListModel >
 void prependItem( QListView * view, ListModel & model, const typename ListModel::Item & item )
@@ -590,11 +626,9 @@ QString getSelectedItemID( QListView * view, const ListModel & model )
 template< typename ListModel >  // Item must have getID() method that returns some kind of persistant unique identifier
 bool setCurrentItemByID( QListView * view, const ListModel & model, const QString & itemID )
 {
-	using Item = typename ListModel::Item;
-
 	if (!itemID.isEmpty())
 	{
-		int newItemIdx = findSuch( model, [&]( const Item & item ) { return item.getID() == itemID; } );
+		int newItemIdx = model.findIndexByID( itemID );
 		if (newItemIdx >= 0)
 		{
 			setCurrentItemByIndex( view, newItemIdx );
@@ -608,11 +642,9 @@ bool setCurrentItemByID( QListView * view, const ListModel & model, const QStrin
 template< typename ListModel >  // Item must have getID() method that returns some kind of persistant unique identifier
 bool selectItemByID( QListView * view, const ListModel & model, const QString & itemID )
 {
-	using Item = typename ListModel::Item;
-
 	if (!itemID.isEmpty())
 	{
-		int newItemIdx = findSuch( model, [&]( const Item & item ) { return item.getID() == itemID; } );
+		int newItemIdx = model.findIndexByID( itemID );
 		if (newItemIdx >= 0)
 		{
 			selectItemByIndex( view, newItemIdx );
@@ -636,11 +668,9 @@ auto getSelectedItemIDs( QListView * view, const ListModel & model ) -> QStringV
 template< typename ListModel >  // Item must have getID() method that returns some kind of persistant unique identifier
 void selectItemsByIDs( QListView * view, const ListModel & model, const QStringVec & itemIDs )
 {
-	using Item = typename ListModel::Item;
-
 	for (const auto & itemID : itemIDs)
 	{
-		int newItemIdx = findSuch( model, [&]( const Item & item ) { return item.getID() == itemID; } );
+		int newItemIdx = model.findIndexByID( itemID );
 		if (newItemIdx >= 0)
 			selectItemByIndex( view, newItemIdx );
 	}
@@ -666,18 +696,109 @@ bool areSelectionsEqual( const QVector< ItemID > & selection1, const QVector< It
 	return orderedSelection1 == orderedSelection2;
 }
 
-/// Fills a list with entries found in a directory.
-template< typename ListModel >
-void updateListFromDir( ListModel & model, QListView * view, const QString & dir, bool recursively,
-                        const PathConvertor & pathConvertor, std::function< bool ( const QFileInfo & file ) > isDesiredFile )
+/// Creates list items from the files found in a directory.
+template< typename Item >
+QList< Item > readItemsFromDir( const QString & dir, bool recursively, const PathConvertor & pathConvertor,
+                                const std::function< bool ( const QFileInfo & file ) > & isDesiredFile )
 {
-	using Item = typename ListModel::Item;
+	QList< Item > items;
+
+	QElapsedTimer timer;
+	timer.start();
 
-	// Doing a differential update (deleting only things that were deleted and adding only things that were added)
-	// is not worth here. It's too complicated and prone to bugs and its advantages are too small.
-	// Instead we just clear everything and then load it from scratch according to the current state of the directory
-	// and update selection and scroll bar.
+	// most of the time nothing has changed since the last time, so the directory doesn't need to be traversed again
+	const QStringList filePaths = fs::g_cachedDirSnapshots.getFiles( dir, recursively );
+	for (const QString & filePath : filePaths)
+	{
+		QFileInfo file( pathConvertor.convertPath( filePath ) );
+		if (isDesiredFile( file ))
+		{
+			items.append( Item( file ) );
+		}
+	}
+
+	// these are the ones that freeze the window, if anything does
+	diag::g_syncScans.add({ dir, timer.elapsed(), int( filePaths.size() ), int( items.size() ) });
+
+	return items;
+}
+
+/// Asynchronous variant of readItemsFromDir(), the directory is traversed in a worker thread.
+/** isDesiredFile is called from the worker thread, so it must not access any data that the main thread can modify.
+  * onDone is called in the main thread once the traversal is complete. A subsequent call with the same requester
+  * cancels the traversal still in progress, and its onDone will never be called. */
+template< typename Item >
+void readItemsFromDir_async( AsyncDirTraverser & traverser, const void * requester,
+                             const QString & dir, bool recursively, const PathConvertor & pathConvertor,
+                             std::function< bool ( const QFileInfo & file ) > isDesiredFile,
+                             std::function< void ( QList< Item > && items ) > onDone )
+{
+	auto items = std::make_shared< QList< Item > >();
+
+	traverser.traverse( requester, dir, recursively, fs::EntryType::FILE, pathConvertor, std::move(isDesiredFile),
+		/*onBatch*/[ items ]( QList< QFileInfo > && files )
+		{
+			for (const QFileInfo & file : files)
+				items->append( Item( file ) );
+		},
+		/*onFinished*/[ items, onDone = std::move(onDone) ]()
+		{
+			onDone( std::move( *items ) );
+		}
+	);
+}
+
+/// Creates list items from the files with one of the suffixes found in a directory.
+/** Faster than the variant with a predicate, because the non-matching files are skipped by name before any processing. */
+template< typename Item >
+QList< Item > readItemsFromDir( const QString & dir, bool recursively, const PathConvertor & pathConvertor,
+                                const QStringVec & fileSuffixes )
+{
+	QList< Item > items;
 
+	QElapsedTimer timer;
+	timer.start();
+
+	const QStringList filePaths = fs::g_cachedDirSnapshots.getFiles( dir, recursively );
+	for (const QString & filePath : filePaths)
+	{
+		if (fs::hasOneOfSuffixes( filePath, fileSuffixes ))
+		{
+			items.append( Item( QFileInfo( pathConvertor.convertPath( filePath ) ) ) );
+		}
+	}
+
+	diag::g_syncScans.add({ dir, timer.elapsed(), int( filePaths.size() ), int( items.size() ) });
+
+	return items;
+}
+
+/// Asynchronous variant of the suffix-filtered readItemsFromDir(), the directory is traversed in a worker thread.
+template< typename Item >
+void readItemsFromDir_async( AsyncDirTraverser & traverser, const void * requester,
+                             const QString & dir, bool recursively, const PathConvertor & pathConvertor,
+                             const QStringVec & fileSuffixes,
+                             std::function< void ( QList< Item > && items ) > onDone )
+{
+	auto items = std::make_shared< QList< Item > >();
+
+	traverser.traverseFiles( requester, dir, recursively, fileSuffixes, pathConvertor,
+		/*onBatch*/[ items ]( QList< QFileInfo > && files )
+		{
+			for (const QFileInfo & file : files)
+				items->append( Item( file ) );
+		},
+		/*onFinished*/[ items, onDone = std::move(onDone) ]()
+		{
+			onDone( std::move( *items ) );
+		}
+	);
+}
+
+/// Replaces the whole content of a list with new items and restores the selection.
+template< typename ListModel >
+void resetListContent( ListModel & model, QListView * view, QList< typename ListModel::Item > && newItems )
+{
 	// note down the current scroll bar position
 	auto scrollPos = view->verticalScrollBar()->value();
 
@@ -689,18 +810,8 @@ void updateListFromDir( ListModel & model, QListView * view, const QString & dir
 
 	deselectAllAndUnsetCurrent( view );
 
-	model.startCompleteUpdate();  // this resets the highlighted item pointed to by a mouse cursor,
-	                              // but that's an acceptable drawback, instead of making differential update
-	model.clear();
-
-	traverseDirectory( dir, recursively, fs::EntryType::FILE, pathConvertor, [&]( const QFileInfo & file )
-	{
-		if (isDesiredFile( file ))
-		{
-			model.append( Item( file ) );
-		}
-	});
-
+	model.startCompleteUpdate();  // this resets the highlighted item pointed to by a mouse cursor
+	model.assignList( std::move(newItems) );
 	model.finishCompleteUpdate();
 
 	// restore the selection so that the same file remains selected
@@ -713,6 +824,97 @@ void updateListFromDir( ListModel & model, QListView * view, const QString & dir
 	view->verticalScrollBar()->setValue( scrollPos );
 }
 
+/// Makes the content of a list equal to the new items, while touching only the items that were removed or added.
+/** Unchanged items stay in place, so the view keeps its selection, current item, scroll position and mouse hover
+  * highlight without any manual restoring. Items are matched by their getID().
+  * If the unchanged items changed their relative order, it falls back to resetting the whole content. */
+template< typename ListModel >
+void updateListContent( ListModel & model, QListView * view, QList< typename ListModel::Item > && newItems )
+{
+	ScopeTimer timer( "updating list content", /*reportThresholdMs*/5 );
+
+	QHash< QString, int > newIndexes;
+	newIndexes.reserve( newItems.size() );
+	for (int i = 0; i < newItems.size(); ++i)
+		newIndexes.insert( newItems[i].getID(), i );
+
+	// remove the items that are no longer present, in contiguous ranges from the back so that the indexes stay valid
+	for (int row = model.size() - 1; row >= 0; )
+	{
+		if (newIndexes.contains( model[ row ].getID() ))
+		{
+			--row;
+			continue;
+		}
+		int lastRow = row;
+		while (row >= 0 && !newIndexes.contains( model[ row ].getID() ))
+			--row;
+		model.startDeleting( row + 1, lastRow - row );
+		model.removeRange( row + 1, lastRow - row );
+		model.finishDeleting();
+	}
+
+	// The remaining items must be in the same relative order as in the new list, otherwise we would have to move them.
+	// That happens very rarely (file system returning the entries in a different order), so just do it the simple way.
+	int lastNewIdx = -1;
+	for (const auto & item : model)
+	{
+		int newIdx = newIndexes.value( item.getID() );
+		if (newIdx < lastNewIdx)
+		{
+			resetListContent( model, view, std::move(newItems) );
+			return;
+		}
+		lastNewIdx = newIdx;
+	}
+
+	// Now the current items are a sub-sequence of the new items, merge the added items in, in contiguous ranges.
+	int row = 0;
+	for (int newIdx = 0; newIdx < newItems.size(); )
+	{
+		if (row < model.size() && model[ row ].getID() == newItems[ newIdx ].getID())
+		{
+			++row;
+			++newIdx;
+			continue;
+		}
+		int firstNewIdx = newIdx;
+		while (newIdx < newItems.size() && (row >= model.size() || model[ row ].getID() != newItems[ newIdx ].getID()))
+			++newIdx;
+		int count = newIdx - firstNewIdx;
+		QList< typename ListModel::Item > addedItems;
+		addedItems.reserve( count );
+		for (int i = firstNewIdx; i < newIdx; ++i)
+			addedItems.append( std::move( newItems[i] ) );  // these are not needed anymore
+		model.startInserting( row, count );
+		model.insertRange( row, std::move(addedItems) );
+		model.finishInserting();
+		row += count;
+	}
+}
+
+/// Fills a list with entries found in a directory.
+template< typename ListModel >
+void updateListFromDir( ListModel & model, QListView * view, const QString & dir, bool recursively,
+                        const PathConvertor & pathConvertor, std::function< bool ( const QFileInfo & file ) > isDesiredFile )
+{
+	using Item = typename ListModel::Item;
+
+	// Resetting the whole model is expensive with thousands of files and it also resets the mouse hover highlight,
+	// so we update only those entries that were actually added or removed since the last time.
+	updateListContent( model, view, readItemsFromDir< Item >( dir, recursively, pathConvertor, isDesiredFile ) );
+}
+
+/// Fills a list with files found in a directory that have one of the specified suffixes.
+template< typename ListModel >
+void updateListFromDir( ListModel & model, QListView * view, const QString & dir, bool recursively,
+                        const PathConvertor & pathConvertor, const QStringVec & fileSuffixes )
+{
+	using Item = typename ListModel::Item;
+
+	updateListContent( model, view, readItemsFromDir< Item >( dir, recursively, pathConvertor, fileSuffixes ) );
+}
+
 
 
 
@@ -735,11 +937,9 @@ QString getCurrentItemID( QComboBox * view, const ListModel & model )
 template< typename ListModel >  // Item must have getID() method that returns some kind of persistant unique identifier
 bool setCurrentItemByID( QComboBox * view, const ListModel & model, const QString & itemID )
 {
-	using Item = typename ListModel::Item;
-
 	if (!itemID.isEmpty())
 	{
-		int newItemIdx = findSuch( model, [&]( const Item & item ) { return item.getID() == itemID; } );
+		int newItemIdx = model.findIndexByID( itemID );
 		if (newItemIdx >= 0)
 		{
 			view->setCurrentIndex( newItemIdx );
@@ -749,40 +949,42 @@ bool setCurrentItemByID( QComboBox * view, const ListModel & model, const QStrin
 	return false;
 }
 
-/// Fills a combo-box with entries found in a directory.
-template< typename ListModel >
-void updateComboBoxFromDir( ListModel & model, QComboBox * view, const QString & dir, bool recursively,
-                            bool includeEmptyItem, const PathConvertor & pathConvertor,
-                            std::function< bool ( const QFileInfo & file ) > isDesiredFile )
+/// Replaces the content of a combo-box with new items and restores the selected item.
+template< typename ListModel >  // Item must have getID() method that returns some kind of persistant unique identifier
+void updateComboBoxContent( ListModel & model, QComboBox * view, bool includeEmptyItem, QList< typename ListModel::Item > && newItems )
 {
-	using Item = typename ListModel::Item;
-
-	// note down the currently selected item
-	QString lastText = view->currentText();
+	// note down the currently selected item,
+	// by its ID rather than its text, because the display string can change without the item being a different one
+	int lastIdx = view->currentIndex();
+	QString lastID = lastIdx >= 0 && lastIdx < model.size() ? model[ lastIdx ].getID() : QString();
+	bool hadSelection = lastIdx >= 0;
 
 	view->setCurrentIndex( -1 );
 
 	model.startCompleteUpdate();
 
-	model.clear();
-
 	// in combo-box item cannot be deselected, so we provide an empty item to express "no selection"
 	if (includeEmptyItem)
-		model.append( QString() );
+		newItems.prepend( QString() );
 
-	traverseDirectory( dir, recursively, fs::EntryType::FILE, pathConvertor, [&]( const QFileInfo & file )
-	{
-		if (isDesiredFile( file ))
-		{
-			model.append( Item( file ) );
-		}
-	});
+	model.assignList( std::move(newItems) );
 
 	model.finishCompleteUpdate();
 
 	// restore the originally selected item, the selection will be reset if the item does not exist in the new content
-	// because findText returns -1 which is valid value for setCurrentIndex
-	view->setCurrentIndex( view->findText( lastText ) );
+	// because findIndexByID returns -1 which is valid value for setCurrentIndex
+	view->setCurrentIndex( hadSelection ? model.findIndexByID( lastID ) : -1 );
+}
+
+/// Fills a combo-box with entries found in a directory.
+template< typename ListModel >
+void updateComboBoxFromDir( ListModel & model, QComboBox * view, const QString & dir, bool recursively,
+                            bool includeEmptyItem, const PathConvertor & pathConvertor,
+                            std::function< bool ( const QFileInfo & file ) > isDesiredFile )
+{
+	using Item = typename ListModel::Item;
+
+	updateComboBoxContent( model, view, includeEmptyItem, readItemsFromDir< Item >( dir, recursively, pathConvertor, isDesiredFile ) );
 }
 
 
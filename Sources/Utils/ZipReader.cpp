@@ -0,0 +1,583 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: ZIP archive parsing (pk3 and similar) without extracting the whole archive
+//======================================================================================================================
+
+#include "ZipReader.hpp"
+
+#include <QFile>
+#include <QtEndian>
+
+#include <algorithm>
+
+
+namespace zip {
+
+
+//======================================================================================================================
+//  decompression
+
+//  https://www.rfc-editor.org/rfc/rfc1951
+//  The structure follows puff.c by Mark Adler - it's not the fastest decoder, but it's small and we only ever decompress
+//  a few KB of text with it, so it's not worth depending on zlib for that.
+
+class Inflater {
+
+ public:
+
+	Inflater( const QByteArray & input, qint64 expectedSize )
+		: _in( reinterpret_cast< const uchar * >( input.constData() ) ), _inSize( input.size() ), _maxOutSize( expectedSize )
+	{
+		_out.reserve( int( expectedSize ) );
+	}
+
+	/// Returns false if the data are not a valid deflate stream or decompress to more than the expected size.
+	bool inflate()
+	{
+		bool isLast;
+		do
+		{
+			isLast = getBits(1);
+			int type = getBits(2);
+			bool success = type == 0 ? inflateStored()
+			             : type == 1 ? inflateFixed()
+			             : type == 2 ? inflateDynamic()
+			             : false;
+			if (!success || _error)
+				return false;
+		}
+		while (!isLast);
+
+		return true;
+	}
+
+	QByteArray takeOutput()   { return std::move(_out); }
+
+ private:
+
+	static constexpr int MaxBits = 15;  ///< maximum bits in a code
+	static constexpr int MaxLitLenCodes = 286;
+	static constexpr int MaxDistCodes = 30;
+	static constexpr int FixedLitLenCodes = 288;  ///< fixed code table has 2 more that are never used
+
+	struct Huffman
+	{
+		short count [MaxBits + 1];  ///< number of symbols of each length
+		short symbol [FixedLitLenCodes];  ///< symbols ordered by their codes
+	};
+
+	int getBits( int need )
+	{
+		uint32_t val = _bitBuf;
+		while (_bitCnt < need)
+		{
+			if (_inPos >= _inSize)
+			{
+				_error = true;  // ran out of input
+				return 0;
+			}
+			val |= uint32_t( _in[ _inPos++ ] ) << _bitCnt;
+			_bitCnt += 8;
+		}
+		_bitBuf = val >> need;
+		_bitCnt -= need;
+		return int( val & ((1u << need) - 1) );
+	}
+
+	bool putByte( char byte )
+	{
+		if (_out.size() >= _maxOutSize)
+			return false;
+		_out.append( byte );
+		return true;
+	}
+
+	bool inflateStored()
+	{
+		// discard the remaining bits of the current byte
+		_bitBuf = 0;
+		_bitCnt = 0;
+
+		if (_inPos + 4 > _inSize)
+			return false;
+		uint len = uint( _in[_inPos] ) | (uint( _in[_inPos + 1] ) << 8);
+		uint nlen = uint( _in[_inPos + 2] ) | (uint( _in[_inPos + 3] ) << 8);
+		_inPos += 4;
+		if (len != (~nlen & 0xFFFF) || _inPos + len > _inSize || _out.size() + len > _maxOutSize)
+			return false;
+
+		_out.append( reinterpret_cast< const char * >( _in + _inPos ), int( len ) );
+		_inPos += len;
+		return true;
+	}
+
+	int decode( const Huffman & h )
+	{
+		int code = 0;   // bits being decoded
+		int first = 0;  // first code of the current length
+		int index = 0;  // index of the first code of the current length in the symbol table
+		for (int len = 1; len <= MaxBits; ++len)
+		{
+			code |= getBits(1);
+			int count = h.count[ len ];
+			if (code - count < first)
+				return h.symbol[ index + (code - first) ];
+			index += count;
+			first += count;
+			first <<= 1;
+			code <<= 1;
+		}
+		return -1;  // ran out of codes
+	}
+
+	/// Returns 0 for a complete code, negative for an over-subscribed one and positive for an incomplete one.
+	static int construct( Huffman & h, const short * lengths, int n )
+	{
+		std::fill( std::begin( h.count ), std::end( h.count ), short(0) );
+		for (int symbol = 0; symbol < n; ++symbol)
+			h.count[ lengths[ symbol ] ]++;
+		if (h.count[0] == n)
+			return 0;  // no codes, complete but decoding will fail
+
+		int left = 1;
+		for (int len = 1; len <= MaxBits; ++len)
+		{
+			left <<= 1;
+			left -= h.count[ len ];
+			if (left < 0)
+				return left;
+		}
+
+		short offs [MaxBits + 1];
+		offs[1] = 0;
+		for (int len = 1; len < MaxBits; ++len)
+			offs[ len + 1 ] = short( offs[ len ] + h.count[ len ] );
+		for (int symbol = 0; symbol < n; ++symbol)
+			if (lengths[ symbol ] != 0)
+				h.symbol[ offs[ lengths[ symbol ] ]++ ] = short( symbol );
+
+		return left;
+	}
+
+	bool inflateCodes( const Huffman & litLenCode, const Huffman & distCode )
+	{
+		static const short lenBase [29] = {
+			3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+		};
+		static const short lenExtra [29] = {
+			0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+		};
+		static const short distBase [30] = {
+			1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+			4097, 6145, 8193, 12289, 16385, 24577
+		};
+		static const short distExtra [30] = {
+			0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+		};
+
+		int symbol;
+		do
+		{
+			symbol = decode( litLenCode );
+			if (symbol < 0 || _error)
+				return false;
+
+			if (symbol < 256)  // literal
+			{
+				if (!putByte( char( symbol ) ))
+					return false;
+			}
+			else if (symbol > 256)  // length + distance pair
+			{
+				symbol -= 257;
+				if (symbol >= 29)
+					return false;
+				int len = lenBase[ symbol ] + getBits( lenExtra[ symbol ] );
+
+				symbol = decode( distCode );
+				if (symbol < 0 || symbol >= 30 || _error)
+					return false;
+				int dist = distBase[ symbol ] + getBits( distExtra[ symbol ] );
+				if (dist > _out.size())
+					return false;  // distance too far back
+
+				// the source and destination can overlap, so it has to be copied byte by byte
+				for (int i = 0; i < len; ++i)
+					if (!putByte( _out.at( _out.size() - dist ) ))
+						return false;
+			}
+		}
+		while (symbol != 256);  // end of block
+
+		return true;
+	}
+
+	bool inflateFixed()
+	{
+		Huffman litLenCode, distCode;
+		short lengths [FixedLitLenCodes];
+
+		int symbol = 0;
+		for (; symbol < 144; ++symbol)
+			lengths[ symbol ] = 8;
+		for (; symbol < 256; ++symbol)
+			lengths[ symbol ] = 9;
+		for (; symbol < 280; ++symbol)
+			lengths[ symbol ] = 7;
+		for (; symbol < FixedLitLenCodes; ++symbol)
+			lengths[ symbol ] = 8;
+		construct( litLenCode, lengths, FixedLitLenCodes );
+
+		for (symbol = 0; symbol < MaxDistCodes; ++symbol)
+			lengths[ symbol ] = 5;
+		construct( distCode, lengths, MaxDistCodes );
+
+		return inflateCodes( litLenCode, distCode );
+	}
+
+	bool inflateDynamic()
+	{
+		static const short order [19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		Huffman litLenCode, distCode;
+		short lengths [MaxLitLenCodes + MaxDistCodes];
+
+		int numLitLen = getBits(5) + 257;
+		int numDist = getBits(5) + 1;
+		int numCodeLen = getBits(4) + 4;
+		if (numLitLen > MaxLitLenCodes || numDist > MaxDistCodes || _error)
+			return false;
+
+		// code lengths of the code that encodes the code lengths of the other codes
+		int index = 0;
+		for (; index < numCodeLen; ++index)
+			lengths[ order[ index ] ] = short( getBits(3) );
+		for (; index < 19; ++index)
+			lengths[ order[ index ] ] = 0;
+		if (construct( litLenCode, lengths, 19 ) != 0 || _error)
+			return false;  // it must be complete
+
+		index = 0;
+		while (index < numLitLen + numDist)
+		{
+			int symbol = decode( litLenCode );
+			if (symbol < 0 || _error)
+				return false;
+
+			if (symbol < 16)
+			{
+				lengths[ index++ ] = short( symbol );
+			}
+			else
+			{
+				short len = 0;
+				if (symbol == 16)  // repeat the last length 3..6 times
+				{
+					if (index == 0)
+						return false;
+					len = lengths[ index - 1 ];
+					symbol = 3 + getBits(2);
+				}
+				else if (symbol == 17)  // repeat zero 3..10 times
+					symbol = 3 + getBits(3);
+				else  // repeat zero 11..138 times
+					symbol = 11 + getBits(7);
+
+				if (index + symbol > numLitLen + numDist || _error)
+					return false;
+				while (symbol--)
+					lengths[ index++ ] = len;
+			}
+		}
+
+		if (lengths[256] == 0)
+			return false;  // there's no end-of-block code
+
+		// incomplete codes are only allowed when they consist of a single code
+		int err = construct( litLenCode, lengths, numLitLen );
+		if (err < 0 || (err > 0 && numLitLen - litLenCode.count[0] != 1))
+			return false;
+		err = construct( distCode, lengths + numLitLen, numDist );
+		if (err < 0 || (err > 0 && numDist - distCode.count[0] != 1))
+			return false;
+
+		return inflateCodes( litLenCode, distCode );
+	}
+
+	const uchar * _in;
+	qint64 _inSize;
+	qint64 _inPos = 0;
+	uint32_t _bitBuf = 0;
+	int _bitCnt = 0;
+	bool _error = false;
+
+	QByteArray _out;
+	qint64 _maxOutSize;
+
+};
+
+
+//======================================================================================================================
+//  archive structure
+
+//  https://pkware.cachefly.net/webdocs/casestudies/APPNOTE.TXT
+
+static constexpr quint32 LocalHeaderSignature = 0x04034b50;
+static constexpr quint32 CentralDirHeaderSignature = 0x02014b50;
+static constexpr quint32 EndOfCentralDirSignature = 0x06054b50;
+static constexpr quint32 Zip64EndOfCentralDirSignature = 0x06064b50;
+static constexpr quint32 Zip64LocatorSignature = 0x07064b50;
+
+static constexpr qint64 LocalHeaderSize = 30;
+static constexpr qint64 CentralDirHeaderSize = 46;
+static constexpr qint64 EndOfCentralDirSize = 22;
+static constexpr qint64 Zip64EndOfCentralDirSize = 56;
+static constexpr qint64 Zip64LocatorSize = 20;
+static constexpr qint64 MaxCommentSize = 0xFFFF;
+
+/// Sanity limit, a central directory of a million files takes around 100 MB.
+static constexpr qint64 MaxCentralDirSize = 128 * 1024 * 1024;
+
+static constexpr quint16 EncryptedFlag = 1 << 0;
+static constexpr quint16 Utf8NameFlag = 1 << 11;
+
+static constexpr quint16 StoredMethod = 0;
+static constexpr quint16 DeflatedMethod = 8;
+
+// the structures in the archive are not aligned, so the fields have to be read byte by byte
+static quint16 readLE16( const char * data )  { return qFromLittleEndian< quint16 >( data ); }
+static quint32 readLE32( const char * data )  { return qFromLittleEndian< quint32 >( data ); }
+static quint64 readLE64( const char * data )  { return qFromLittleEndian< quint64 >( data ); }
+
+bool hasZipSignature( const QByteArray & fileStart )
+{
+	return fileStart.size() >= 4
+		&& (readLE32( fileStart.constData() ) == LocalHeaderSignature
+		 || readLE32( fileStart.constData() ) == EndOfCentralDirSignature);  // empty archive
+}
+
+/// Replaces the 32-bit values that overflowed with the 64-bit ones from the Zip64 extended information extra field.
+static void applyZip64Extra( Entry & entry, const char * extra, qint64 extraSize )
+{
+	qint64 pos = 0;
+	while (pos + 4 <= extraSize)
+	{
+		quint16 fieldID = readLE16( extra + pos );
+		quint16 fieldSize = readLE16( extra + pos + 2 );
+		pos += 4;
+		if (pos + fieldSize > extraSize)
+			return;
+
+		if (fieldID == 0x0001)
+		{
+			// only the values that are set to 0xFFFFFFFF in the header are present, in this order
+			const char * field = extra + pos;
+			const char * fieldEnd = field + fieldSize;
+			if (entry.uncompressedSize == 0xFFFFFFFF && field + 8 <= fieldEnd)
+				{ entry.uncompressedSize = readLE64( field ); field += 8; }
+			if (entry.compressedSize == 0xFFFFFFFF && field + 8 <= fieldEnd)
+				{ entry.compressedSize = readLE64( field ); field += 8; }
+			if (entry.localHeaderOffset == 0xFFFFFFFF && field + 8 <= fieldEnd)
+				{ entry.localHeaderOffset = readLE64( field ); field += 8; }
+			return;
+		}
+
+		pos += fieldSize;
+	}
+}
+
+
+//======================================================================================================================
+//  ArchiveReader
+
+ArchiveReader::ArchiveReader( QFile & file )
+:
+	LoggingComponent("ZipReader"), _file( file ), _fileSize( file.size() )
+{}
+
+bool ArchiveReader::findEndOfCentralDir( qint64 & cdOffset, qint64 & cdSize, quint64 & numEntries )
+{
+	// the record is at the very end, followed only by a comment of variable length
+	qint64 tailSize = std::min( _fileSize, EndOfCentralDirSize + MaxCommentSize + Zip64LocatorSize );
+	if (tailSize < EndOfCentralDirSize || !_file.seek( _fileSize - tailSize ))
+		return false;
+	QByteArray tail = _file.read( tailSize );
+	if (tail.size() < tailSize)
+		return false;
+	const char * data = tail.constData();
+
+	for (qint64 pos = tailSize - EndOfCentralDirSize; pos >= 0; --pos)
+	{
+		if (readLE32( data + pos ) != EndOfCentralDirSignature)
+			continue;
+		quint16 commentSize = readLE16( data + pos + 20 );
+		if (pos + EndOfCentralDirSize + commentSize > tailSize)
+			continue;  // just some bytes in the comment or in the last entry that happen to look like the signature
+
+		numEntries = readLE16( data + pos + 10 );
+		cdSize = readLE32( data + pos + 12 );
+		cdOffset = readLE32( data + pos + 16 );
+
+		bool hasOverflowed = numEntries == 0xFFFF || cdSize == 0xFFFFFFFF || cdOffset == 0xFFFFFFFF;
+		if (hasOverflowed && pos >= Zip64LocatorSize && readLE32( data + pos - Zip64LocatorSize ) == Zip64LocatorSignature)
+		{
+			qint64 zip64RecordOffset = qint64( readLE64( data + pos - Zip64LocatorSize + 8 ) );
+			if (zip64RecordOffset < 0 || zip64RecordOffset + Zip64EndOfCentralDirSize > _fileSize || !_file.seek( zip64RecordOffset ))
+				return false;
+			QByteArray record = _file.read( Zip64EndOfCentralDirSize );
+			if (record.size() < Zip64EndOfCentralDirSize || readLE32( record.constData() ) != Zip64EndOfCentralDirSignature)
+				return false;
+
+			numEntries = readLE64( record.constData() + 32 );
+			cdSize = qint64( readLE64( record.constData() + 40 ) );
+			cdOffset = qint64( readLE64( record.constData() + 48 ) );
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+ReadStatus ArchiveReader::readEntries( QVector< Entry > & entries )
+{
+	qint64 cdOffset, cdSize;
+	quint64 numEntries;
+	if (!findEndOfCentralDir( cdOffset, cdSize, numEntries ))
+	{
+		logDebug() << _file.fileName() << ": end of central directory not found";
+		return ReadStatus::InvalidFormat;
+	}
+
+	if (cdOffset < 0 || cdSize < 0 || cdSize > MaxCentralDirSize || cdOffset + cdSize > _fileSize
+	 || numEntries > quint64( cdSize / CentralDirHeaderSize ))
+	{
+		logDebug() << _file.fileName() << ": central directory points beyond the end of file";
+		return ReadStatus::InvalidFormat;
+	}
+
+	QByteArray centralDir;
+	if (_file.seek( cdOffset ))
+		centralDir = _file.read( cdSize );
+	if (centralDir.size() < cdSize)
+	{
+		logRuntimeError() << _file.fileName() << ": failed to read the central directory";
+		return ReadStatus::FailedToRead;
+	}
+	const char * data = centralDir.constData();
+
+	entries.clear();
+	entries.reserve( int( numEntries ) );
+
+	qint64 pos = 0;
+	for (quint64 i = 0; i < numEntries; ++i)
+	{
+		if (pos + CentralDirHeaderSize > cdSize || readLE32( data + pos ) != CentralDirHeaderSignature)
+		{
+			logDebug() << _file.fileName() << ": invalid central directory entry";
+			return ReadStatus::InvalidFormat;
+		}
+
+		Entry entry;
+		entry.flags = readLE16( data + pos + 8 );
+		entry.method = readLE16( data + pos + 10 );
+		entry.compressedSize = readLE32( data + pos + 20 );
+		entry.uncompressedSize = readLE32( data + pos + 24 );
+		quint16 nameSize = readLE16( data + pos + 28 );
+		quint16 extraSize = readLE16( data + pos + 30 );
+		quint16 commentSize = readLE16( data + pos + 32 );
+		entry.localHeaderOffset = readLE32( data + pos + 42 );
+
+		const char * name = data + pos + CentralDirHeaderSize;
+		const char * extra = name + nameSize;
+		pos += CentralDirHeaderSize + nameSize + extraSize + commentSize;
+		if (pos > cdSize)
+		{
+			logDebug() << _file.fileName() << ": central directory entry exceeds the directory";
+			return ReadStatus::InvalidFormat;
+		}
+
+		// names without the UTF-8 flag are officially in CP437, but in practice they're plain ASCII
+		entry.name = (entry.flags & Utf8NameFlag) ? QString::fromUtf8( name, nameSize ) : QString::fromLatin1( name, nameSize );
+		applyZip64Extra( entry, extra, extraSize );
+
+		entries.append( std::move(entry) );
+	}
+
+	return ReadStatus::Success;
+}
+
+ReadStatus ArchiveReader::readContent( const Entry & entry, QByteArray & content, qint64 maxSize )
+{
+	if (entry.flags & EncryptedFlag)
+	{
+		logDebug() << _file.fileName() << ": " << entry.name << " is encrypted";
+		return ReadStatus::NotSupported;
+	}
+	if (entry.method != StoredMethod && entry.method != DeflatedMethod)
+	{
+		logDebug() << _file.fileName() << ": " << entry.name << " uses unsupported compression method " << entry.method;
+		return ReadStatus::NotSupported;
+	}
+	if (entry.uncompressedSize > quint64( maxSize ) || entry.compressedSize > quint64( _fileSize ))
+	{
+		logDebug() << _file.fileName() << ": " << entry.name << " is too big";
+		return ReadStatus::NotSupported;
+	}
+
+	// the local header may have a different extra field than the central directory, its size must be read from it
+	qint64 headerOffset = qint64( entry.localHeaderOffset );
+	QByteArray localHeader;
+	if (headerOffset + LocalHeaderSize <= _fileSize && _file.seek( headerOffset ))
+		localHeader = _file.read( LocalHeaderSize );
+	if (localHeader.size() < LocalHeaderSize || readLE32( localHeader.constData() ) != LocalHeaderSignature)
+	{
+		logDebug() << _file.fileName() << ": invalid local header of " << entry.name;
+		return ReadStatus::InvalidFormat;
+	}
+	qint64 dataOffset = headerOffset + LocalHeaderSize
+		+ readLE16( localHeader.constData() + 26 ) + readLE16( localHeader.constData() + 28 );
+	qint64 compressedSize = qint64( entry.compressedSize );
+	if (dataOffset + compressedSize > _fileSize)
+	{
+		logDebug() << _file.fileName() << ": " << entry.name << " points beyond the end of file";
+		return ReadStatus::InvalidFormat;
+	}
+
+	QByteArray rawData;
+	if (_file.seek( dataOffset ))
+		rawData = _file.read( compressedSize );
+	if (rawData.size() < compressedSize)
+	{
+		logRuntimeError() << _file.fileName() << ": failed to read " << entry.name;
+		return ReadStatus::FailedToRead;
+	}
+
+	if (entry.method == StoredMethod)
+	{
+		content = std::move(rawData);
+	}
+	else
+	{
+		Inflater inflater( rawData, qint64( entry.uncompressedSize ) );
+		if (!inflater.inflate())
+		{
+			logDebug() << _file.fileName() << ": failed to decompress " << entry.name;
+			return ReadStatus::InvalidFormat;
+		}
+		content = inflater.takeOutput();
+	}
+
+	if (quint64( content.size() ) != entry.uncompressedSize)
+	{
+		logDebug() << _file.fileName() << ": " << entry.name << " has different size than declared";
+		return ReadStatus::InvalidFormat;
+	}
+
+	return ReadStatus::Success;
+}
+
+
+} // namespace zip
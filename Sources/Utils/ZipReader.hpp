@@ -0,0 +1,76 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: ZIP archive parsing (pk3 and similar) without extracting the whole archive
+//======================================================================================================================
+
+#ifndef ZIP_READER_INCLUDED
+#define ZIP_READER_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "FileInfoCache.hpp"  // ReadStatus
+#include "ErrorHandling.hpp"  // LoggingComponent
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+
+class QFile;
+
+
+namespace zip {
+
+
+/// one file stored in the archive, as described by the central directory
+struct Entry
+{
+	QString name;  ///< path inside the archive with '/' as separator
+	quint16 flags = 0;
+	quint16 method = 0;  ///< compression method
+	quint64 compressedSize = 0;
+	quint64 uncompressedSize = 0;
+	quint64 localHeaderOffset = 0;
+
+	bool isDir() const   { return name.endsWith('/'); }
+};
+
+/// Returns whether the data look like the beginning of a ZIP archive.
+bool hasZipSignature( const QByteArray & fileStart );
+
+/// Reads the list of files and selected file contents from a ZIP archive.
+/**
+  * Only the end-of-central-directory record and the central directory at the end of the file are read
+  * to get the list of entries, so it's cheap even for an archive of several GB, the content of the entries is only
+  * decompressed on request.
+  */
+class ArchiveReader : protected LoggingComponent {
+
+ public:
+
+	/// The file must be already open for reading and must stay open for the lifetime of this reader.
+	ArchiveReader( QFile & file );
+
+	/// Reads the list of all entries from the central directory.
+	ReadStatus readEntries( QVector< Entry > & entries );
+
+	/// Reads and decompresses the content of one entry.
+	/** Entries bigger than maxSize are refused, so that a damaged or malicious archive cannot exhaust the memory. */
+	ReadStatus readContent( const Entry & entry, QByteArray & content, qint64 maxSize );
+
+ private:
+
+	bool findEndOfCentralDir( qint64 & cdOffset, qint64 & cdSize, quint64 & numEntries );
+
+	QFile & _file;
+	qint64 _fileSize;
+
+};
+
+
+} // namespace zip
+
+
+#endif // ZIP_READER_INCLUDED
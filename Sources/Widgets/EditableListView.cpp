@@ -167,6 +167,15 @@ void EditableListView::enableTogglingIcons()
 	connect( toggleIconsAction, &QAction::triggered, this, QOverload<>::of( &thisClass::toggleIcons ) );
 }
 
+void EditableListView::toggleLargeListMode( bool enabled )
+{
+	// Without this, the view asks the model for the size hint of every single row, which means constructing
+	// the display string and looking up the icon of items that will never be visible.
+	this->setUniformItemSizes( enabled );
+	this->setLayoutMode( enabled ? QListView::Batched : QListView::SinglePass );
+	this->setBatchSize( 200 );
+}
+
 void EditableListView::contextMenuEvent( QContextMenuEvent * event )
 {
 	QModelIndex clickedItemIndex = this->indexAt( event->pos() );
@@ -247,6 +256,10 @@ void EditableListView::toggleIcons()
 	bool newIconState = !model->areIconsEnabled();
 	model->toggleIcons( newIconState );
 	toggleIconsAction->setText( newIconState ? "Hide icons" : "Show icons" );
+
+	if (this->uniformItemSizes())
+		this->scheduleDelayedItemsLayout();  // the remembered item size might have included the icon
+
 }
 
 void EditableListView::toggleIcons( bool enabled )
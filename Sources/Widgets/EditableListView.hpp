@@ -76,6 +76,14 @@ class EditableListView : public QListView, protected LoggingComponent {
 	/// Allows the user to show or hide item icons via context menu.
 	void enableTogglingIcons();
 
+	// performance
+
+	/// Optimizes the view for lists with thousands of items, makes scrolling and resizing cost only the visible rows.
+	/** All the items are assumed to have the same size as the first one, and the items are laid out in batches,
+	  * so the view stays responsive while a long list is being laid out. If the display strings of the model are
+	  * expensive to construct, it should be used together with ListModelCommon::toggleDisplayCache(). */
+	void toggleLargeListMode( bool enabled );
+
 	/// Creates a custom action and adds it to the context menu.
 	/** The resulting QAction object will emit triggered() signal that needs to be connected to the desired callback. */
 	QAction * addAction( const QString & text, const QKeySequence & shortcut );
@@ -8,6 +8,38 @@
 #include "ListModel.hpp"
 
 
+ListModelCommon::ListModelCommon() : LoggingComponent("ListModel")
+{
+	// Every modification must be announced to the views, so these catch all the changes that can shift the items.
+	// dataChanged is included because the ID can be derived from an editable member.
+	auto onChanged = [ this ]() { invalidateIDIndex(); invalidateDisplayCache(); };
+	connect( this, &QAbstractItemModel::rowsInserted, this, onChanged );
+	connect( this, &QAbstractItemModel::rowsRemoved, this, onChanged );
+	connect( this, &QAbstractItemModel::rowsMoved, this, onChanged );
+	connect( this, &QAbstractItemModel::layoutChanged, this, onChanged );
+	connect( this, &QAbstractItemModel::modelReset, this, onChanged );
+	connect( this, &QAbstractItemModel::dataChanged, this,
+		[ this ]( const QModelIndex & topLeft, const QModelIndex & bottomRight, const QVector<int> & roles )
+	{
+		if (!isOnlyPresentation( roles ))  // the icons and the annotations don't affect the IDs
+			invalidateIDIndex();
+		if (affectsDisplayString( roles ))
+			invalidateDisplayCache( topLeft.row(), bottomRight.row() );
+	});
+}
+
+void ListModelCommon::invalidateDisplayCache( int firstRow, int lastRow )
+{
+	if (firstRow < 0 || lastRow >= displayCache.size())
+	{
+		displayCache.clear();
+		return;
+	}
+	for (int row = firstRow; row <= lastRow; ++row)
+		displayCache[ row ] = QString();
+}
+
+
 void ListModelCommon::contentChanged( int changedRowsBegin, int changedRowsEnd )
 {
 	if (changedRowsEnd < 0)
@@ -21,3 +53,40 @@ void ListModelCommon::contentChanged( int changedRowsBegin, int changedRowsEnd )
 		Qt::ForegroundRole, Qt::BackgroundRole, Qt::TextAlignmentRole
 	});
 }
+
+void ListModelCommon::iconsChanged( int changedRowsBegin, int changedRowsEnd )
+{
+	if (changedRowsEnd < 0)
+		changedRowsEnd = this->rowCount();
+
+	const QModelIndex firstChangedIndex = createIndex( changedRowsBegin, /*column*/0 );
+	const QModelIndex lastChangedIndex = createIndex( changedRowsEnd - 1, /*column*/0 );
+
+	emit dataChanged( firstChangedIndex, lastChangedIndex, { Qt::DecorationRole } );
+}
+
+void ListModelCommon::annotationsChanged( int changedRowsBegin, int changedRowsEnd )
+{
+	if (changedRowsEnd < 0)
+		changedRowsEnd = this->rowCount();
+
+	const QModelIndex firstChangedIndex = createIndex( changedRowsBegin, /*column*/0 );
+	const QModelIndex lastChangedIndex = createIndex( changedRowsEnd - 1, /*column*/0 );
+
+	emit dataChanged( firstChangedIndex, lastChangedIndex, { Qt::ForegroundRole, Qt::ToolTipRole } );
+}
+
+bool ListModelCommon::isOnlyPresentation( const QVector<int> & roles )
+{
+	if (roles.isEmpty())  // everything might have changed
+		return false;
+	for (int role : roles)
+		if (role != Qt::DecorationRole && role != Qt::ForegroundRole && role != Qt::ToolTipRole)
+			return false;
+	return true;
+}
+
+bool ListModelCommon::affectsDisplayString( const QVector<int> & roles )
+{
+	return roles.isEmpty() || roles.contains( Qt::DisplayRole ) || roles.contains( Qt::EditRole );
+}
@@ -11,13 +11,15 @@
 
 #include "Essential.hpp"
 
-#include "Utils/ContainerUtils.hpp"  // PointerIterator
+#include "Utils/ContainerUtils.hpp"  // insertRange, removeRange
 #include "Utils/FileSystemUtils.hpp"  // PathConvertor
+#include "Utils/StringPool.hpp"  // isSameString
 #include "Utils/ErrorHandling.hpp"
 #include "Themes.hpp"  // separator colors
 
 #include <QAbstractListModel>
 #include <QList>
+#include <QHash>
 #include <QString>
 #include <QMimeData>
 #include <QUrl>
@@ -71,9 +73,9 @@ class DropTarget {
 		_droppedCount = count;
 	}
 
-	void decrementRow()
+	void decrementRow( int count = 1 )
 	{
-		_droppedRow--;
+		_droppedRow -= count;
 	}
 
  private:
@@ -97,6 +99,10 @@ struct ReadOnlyListModelItem
 {
 	mutable std::optional< QColor > textColor;
 	mutable std::optional< QColor > backgroundColor;
+	mutable QString toolTip;  ///< empty means no tool tip
+	/// Displayed in the conflict color, unless textColor says otherwise.
+	/** Kept apart from textColor, so that the two markings don't overwrite each other and follow the theme changes. */
+	mutable bool isConflicting = false;
 	bool isSeparator = false;  ///< true means this is a special item used to mark a section
 
 	const QString & getFilePath() const
@@ -218,6 +224,11 @@ class DirectList {
 	void removeAt( int idx )                      { _list.removeAt( idx ); }
 	void move( int from, int to )                 { _list.move( from, to ); }
 
+	// batch modification, the following items are shifted only once
+
+	void insertRange( int idx, QList< Item > && items )  { ::insertRange( _list, idx, std::move(items) ); }
+	void removeRange( int idx, int count )               { ::removeRange( _list, idx, count ); }
+
 	//-- special -------------------------------------------------------------------------------------------------------
 
 	/// Whether the list modification functions can be safely called.
@@ -228,159 +239,344 @@ class DirectList {
 
 //======================================================================================================================
 /// A wrapper around QList allowing to temporarily filter the content present only items matching a specified criteria.
-/** One of possible list implementations for ListModel variants. */
+/** One of possible list implementations for ListModel variants.
+  *
+  * The filtered content is stored as indexes into the full list, not as pointers to its items, so they stay valid
+  * when the list re-allocates, and the list can be modified even when it's filtered. The indexes are adjusted
+  * with every modification. When the list is not filtered, no indexes are stored at all. */
 
 template< typename Item_ >
 class FilteredList {
 
 	QList< Item_ > _fullList;
-	QVector< Item_ * > _filteredList;
+	QVector< quint32 > _filteredIndexes;  ///< indexes into _fullList of the displayed items, valid only if _isFiltered
+	bool _isFiltered = false;
+
+	// state of the last search, so that typing more characters only filters the previous results again
+	struct SearchKey
+	{
+		QString original;  ///< shares the data with the item's string as long as the item is not renamed
+		QString folded;    ///< for case-insensitive matching without folding the same string with every search
+	};
+	QVector< SearchKey > _searchIndex;  ///< the same order as _fullList, reset when its size changes
+	QString _lastPhrase;                ///< empty when the results of the last search cannot be reused
+	bool _lastCaseSensitive = false;
+	QRegularExpression _regex;          ///< compiling it is expensive, keep it until the phrase changes
+
+	/// Iterates over the displayed items in the full list.
+	template< typename List, typename ItemRef >
+	class Iterator
+	{
+		List * _list;
+		int _pos;
+	 public:
+		Iterator( List * list, int pos ) : _list( list ), _pos( pos ) {}
+		ItemRef operator*() const { return (*_list)[ _pos ]; }
+		auto operator->() const { return &(*_list)[ _pos ]; }
+		Iterator & operator++() { ++_pos; return *this; }
+		Iterator operator++(int) { auto tmp = *this; ++_pos; return tmp; }
+		friend bool operator==( const Iterator & a, const Iterator & b ) { return a._pos == b._pos; }
+		friend bool operator!=( const Iterator & a, const Iterator & b ) { return a._pos != b._pos; }
+	};
 
  public:
 
 	using Item = Item_;
 
 	FilteredList() {}
-	FilteredList( const QList< Item > & itemList ) : _fullList( itemList ) { restore(); }
+	FilteredList( const QList< Item > & itemList ) : _fullList( itemList ) {}
 
 	//-- wrapper functions for manipulating the list -------------------------------------------------------------------
 
 	auto & fullList()                             { return _fullList; }
 	const auto & fullList() const                 { return _fullList; }
-	auto & filteredList()                         { return _filteredList; }
-	const auto & filteredList() const             { return _filteredList; }
 	void updateList( const QList< Item > & list ) { _fullList = list; restore(); }
 	void assignList( QList< Item > && list )      { _fullList = std::move(list); restore(); }
 
 	// content access
 
-	using iterator = PointerIterator< decltype( _filteredList.begin() ) >;
-	using const_iterator = PointerIterator< decltype( _filteredList.cbegin() ) >;
-
-	auto count() const                            { return _filteredList.count(); }
-	auto size() const                             { return _filteredList.size(); }
-	auto isEmpty() const                          { return _filteredList.isEmpty(); }
-	auto & operator[]( int idx )                  { return *_filteredList[ idx ]; }
-	const auto & operator[]( int idx ) const      { return *_filteredList[ idx ]; }
-	iterator begin()                              { return PointerIterator( _filteredList.begin() ); }
-	const_iterator begin() const                  { return PointerIterator( _filteredList.begin() ); }
-	iterator end()                                { return PointerIterator( _filteredList.end() ); }
-	const_iterator end() const                    { return PointerIterator( _filteredList.end() ); }
-	auto & first()                                { return *_filteredList.first(); }
-	const auto & first() const                    { return *_filteredList.first(); }
-	auto & last()                                 { return *_filteredList.last(); }
-	const auto & last() const                     { return *_filteredList.last(); }
-	auto indexOf( const Item & item ) const       { return _filteredList.indexOf( &item ); }
-
-	// list modification - only when the list is not filtered
+	using iterator = Iterator< FilteredList, Item & >;
+	using const_iterator = Iterator< const FilteredList, const Item & >;
+
+	int count() const                             { return size(); }
+	int size() const                              { return int( _isFiltered ? _filteredIndexes.size() : _fullList.size() ); }
+	bool isEmpty() const                          { return size() == 0; }
+	auto & operator[]( int idx )                  { return _fullList[ toFullIdx( idx ) ]; }
+	const auto & operator[]( int idx ) const      { return _fullList[ toFullIdx( idx ) ]; }
+	iterator begin()                              { return iterator( this, 0 ); }
+	const_iterator begin() const                  { return const_iterator( this, 0 ); }
+	iterator end()                                { return iterator( this, size() ); }
+	const_iterator end() const                    { return const_iterator( this, size() ); }
+	auto & first()                                { return (*this)[ 0 ]; }
+	const auto & first() const                    { return (*this)[ 0 ]; }
+	auto & last()                                 { return (*this)[ size() - 1 ]; }
+	const auto & last() const                     { return (*this)[ size() - 1 ]; }
+	int indexOf( const Item & item ) const
+	{
+		for (int i = 0; i < size(); ++i)
+			if (&(*this)[i] == &item)
+				return i;
+		return -1;
+	}
+
+	// list modification - the indexes are the positions in the displayed content, the item is displayed even if it
+	//                     doesn't match the current search
 
 	void clear()
 	{
-		ensureCanBeModified();
-		_filteredList.clear();
 		_fullList.clear();
+		_filteredIndexes.clear();
+		forgetLastSearch();
 	}
 
 	void append( const Item & item )
 	{
-		ensureCanBeModified();
 		_fullList.append( item );
-		_filteredList.append( &_fullList.last() );
+		if (_isFiltered)
+			_filteredIndexes.append( quint32( _fullList.size() - 1 ) );
+		forgetLastSearch();
 	}
 
 	void prepend( const Item & item )
 	{
-		ensureCanBeModified();
-		_fullList.prepend( item );
-		_filteredList.prepend( &_fullList.first() );
+		insert( 0, item );
 	}
 
 	void insert( int idx, const Item & item )
 	{
-		ensureCanBeModified();
-		_fullList.insert( idx, item );
-		_filteredList.insert( idx, &_fullList[ idx ] );
+		int fullIdx = toFullInsertIdx( idx );
+		_fullList.insert( fullIdx, item );
+		if (_isFiltered)
+		{
+			shiftFilteredIndexes( fullIdx, +1 );
+			_filteredIndexes.insert( idx, quint32( fullIdx ) );
+		}
+		forgetLastSearch();
 	}
 
 	void removeAt( int idx )
 	{
-		if (!isFiltered())
+		int fullIdx = toFullIdx( idx );
+		_fullList.removeAt( fullIdx );
+		if (_isFiltered)
 		{
-			_fullList.removeAt( idx );
-			_filteredList.removeAt( idx );
+			_filteredIndexes.removeAt( idx );
+			shiftFilteredIndexes( fullIdx, -1 );
+		}
+		forgetLastSearch();
+	}
+
+	void move( int from, int to )
+	{
+		if (!_isFiltered)
+		{
+			_fullList.move( from, to );
 		}
 		else
 		{
-			// can be allowed for filtered list, but the fullList entry needs to be found and deleted too
-			auto * ptr = _filteredList.takeAt( idx );
-			for (int i = 0; i < _fullList.size(); ++i)
-				if (&_fullList[i] == ptr)
-					_fullList.removeAt( i );
+			int fullFrom = toFullIdx( from );
+			int fullTo = toFullIdx( to );
+			_fullList.move( fullFrom, fullTo );
+			// the items between the two positions moved by one towards the original position
+			for (quint32 & fullIdx : _filteredIndexes)
+			{
+				if (int(fullIdx) == fullFrom)
+					fullIdx = quint32( fullTo );
+				else if (fullFrom < fullTo && int(fullIdx) > fullFrom && int(fullIdx) <= fullTo)
+					--fullIdx;
+				else if (fullFrom > fullTo && int(fullIdx) >= fullTo && int(fullIdx) < fullFrom)
+					++fullIdx;
+			}
+			_filteredIndexes.move( from, to );
 		}
+		forgetLastSearch();
 	}
 
-	void move( int from, int to )
+	// batch modification, the following items are shifted only once
+
+	void insertRange( int idx, QList< Item > && items )
 	{
-		ensureCanBeModified();
-		_fullList.move( from, to );
-		_filteredList.move( from, to );
+		int count = int( items.size() );
+		int fullIdx = toFullInsertIdx( idx );
+		::insertRange( _fullList, fullIdx, std::move(items) );
+		if (_isFiltered)
+		{
+			shiftFilteredIndexes( fullIdx, count );
+			QVector< quint32 > newIndexes;
+			newIndexes.reserve( _filteredIndexes.size() + count );
+			for (int i = 0; i < idx; ++i)
+				newIndexes.append( _filteredIndexes[i] );
+			for (int i = 0; i < count; ++i)
+				newIndexes.append( quint32( fullIdx + i ) );
+			for (int i = idx; i < _filteredIndexes.size(); ++i)
+				newIndexes.append( _filteredIndexes[i] );
+			_filteredIndexes.swap( newIndexes );
+		}
+		forgetLastSearch();
+	}
+
+	void removeRange( int idx, int count )
+	{
+		if (!_isFiltered)
+		{
+			::removeRange( _fullList, idx, count );
+		}
+		else
+		{
+			// the displayed items don't have to be next to each other in the full list
+			for (int i = idx + count - 1; i >= idx; --i)
+				removeAt( i );
+		}
+		forgetLastSearch();
 	}
 
 	//-- searching/filtering -------------------------------------------------------------------------------------------
 
 	/// Filters the list model entries to display only those that match a given criteria.
+	/** When the phrase only extends the previous one, only the previous results are filtered. */
 	void search( const QString & phrase, bool caseSensitive, bool useRegex )
 	{
-		_filteredList.clear();
-
 		if (useRegex)
 		{
-			QRegularExpression regex( phrase );
-			for (auto & item : _fullList)
-				if (!item.isSeparator && regex.isValid() && regex.match( item.getEditString() ).hasMatch())
-					_filteredList.append( &item );
+			if (_regex.pattern() != phrase)
+				_regex.setPattern( phrase );
+
+			forgetLastSearch();  // a longer regex can match more
+			if (_regex.isValid())
+				searchAll( [&]( int fullIdx ) { return _regex.match( getSearchKey( fullIdx ).original ).hasMatch(); } );
+			else
+				searchAll( []( int ) { return false; } );
+			return;
+		}
+
+		Qt::CaseSensitivity caseSensitivity = caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+		bool narrowDown = _isFiltered && !_lastPhrase.isEmpty() && caseSensitive == _lastCaseSensitive
+		               && phrase.contains( _lastPhrase, caseSensitivity );
+
+		_lastPhrase = phrase;
+		_lastCaseSensitive = caseSensitive;
+
+		if (caseSensitive)
+		{
+			auto matches = [&]( int fullIdx ) { return getSearchKey( fullIdx ).original.contains( phrase, Qt::CaseSensitive ); };
+			narrowDown ? searchPrevious( matches ) : searchAll( matches );
 		}
 		else
 		{
-			Qt::CaseSensitivity caseSensitivity = caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
-			for (auto & item : _fullList)
-				if (!item.isSeparator && item.getEditString().contains( phrase, caseSensitivity ))
-					_filteredList.append( &item );
+			QString foldedPhrase = phrase.toCaseFolded();
+			auto matches = [&]( int fullIdx ) { return getSearchKey( fullIdx ).folded.contains( foldedPhrase, Qt::CaseSensitive ); };
+			narrowDown ? searchPrevious( matches ) : searchAll( matches );
 		}
 	}
 
+	/// Filters the list model entries to display only those whose ID is in the set, usually the result of an external index.
+	template< typename IDSet >
+	void searchByIDs( const IDSet & matchingIDs )
+	{
+		forgetLastSearch();  // more characters can also add results here
+
+		searchAll( [&]( int fullIdx ) { return matchingIDs.contains( _fullList[ fullIdx ].getID() ); } );
+	}
+
 	/// Restores the list model to display the full unfiltered content.
 	void restore()
 	{
-		_filteredList.clear();
-		for (auto & item : _fullList)
-			_filteredList.append( &item );
+		_isFiltered = false;
+		_filteredIndexes.clear();
+		forgetLastSearch();
 	}
 
 	/// Whether the list is currently filtered or showing the full content.
 	bool isFiltered() const
 	{
-		return _filteredList.size() != _fullList.size();
+		return _isFiltered;
 	}
 
 	//-- special -------------------------------------------------------------------------------------------------------
 
 	/// Whether the list modification functions can be safely called.
-	/** This list cannot be modified when it is filtered. */
+	/** This list can be modified even when it is filtered. */
 	bool canBeModified() const
 	{
-		return !isFiltered();
+		return true;
 	}
 
- protected:
+ private:
+
+	int toFullIdx( int idx ) const
+	{
+		return _isFiltered ? int( _filteredIndexes[ idx ] ) : idx;
+	}
+
+	/// Position in the full list where an item inserted at a displayed position should go.
+	int toFullInsertIdx( int idx ) const
+	{
+		if (!_isFiltered)
+			return idx;
+		else if (idx < _filteredIndexes.size())
+			return int( _filteredIndexes[ idx ] );  // right before the displayed item that will follow it
+		else
+			return _filteredIndexes.isEmpty() ? int( _fullList.size() ) : int( _filteredIndexes.last() ) + 1;
+	}
+
+	/// Adjusts the indexes after items were inserted or removed at a position of the full list.
+	void shiftFilteredIndexes( int fullIdx, int shift )
+	{
+		for (quint32 & idx : _filteredIndexes)
+			if (int(idx) >= fullIdx)
+				idx = quint32( int(idx) + shift );
+	}
+
+	void forgetLastSearch()
+	{
+		_lastPhrase.clear();
+	}
+
+	/// Returns the search key of an item from the full list, updated if the item has been renamed since the last search.
+	const SearchKey & getSearchKey( int fullIdx )
+	{
+		const QString & itemStr = _fullList[ fullIdx ].getEditString();
+		SearchKey & key = _searchIndex[ fullIdx ];
+		if (!key.original.isSharedWith( itemStr ) && key.original != itemStr)
+		{
+			key.original = itemStr;
+			key.folded = itemStr.toCaseFolded();
+		}
+		return key;
+	}
+
+	template< typename MatchFunc >
+	void searchAll( const MatchFunc & matches )
+	{
+		// the items can also be modified directly through fullList()
+		if (_searchIndex.size() != _fullList.size())
+		{
+			_searchIndex.clear();
+			_searchIndex.resize( _fullList.size() );  // filled by getSearchKey()
+		}
+
+		_filteredIndexes.clear();
+		for (int i = 0; i < _fullList.size(); ++i)
+			if (!_fullList[i].isSeparator && matches( i ))
+				_filteredIndexes.append( quint32(i) );
+		_isFiltered = true;
+	}
 
-	void ensureCanBeModified()
+	/// Filters only the results of the previous search.
+	template< typename MatchFunc >
+	void searchPrevious( const MatchFunc & matches )
 	{
-		if (!canBeModified())
+		if (_searchIndex.size() != _fullList.size())
 		{
-			logLogicError("FilteredList") << "the list cannot be modified when it is filtered";
-			throw std::logic_error("the list cannot be modified when it is filtered");
+			searchAll( matches );
+			return;
 		}
+
+		int newCount = 0;
+		for (int i = 0; i < _filteredIndexes.size(); ++i)
+			if (matches( int( _filteredIndexes[i] ) ))
+				_filteredIndexes[ newCount++ ] = _filteredIndexes[i];
+		_filteredIndexes.resize( newCount );
 	}
 
 };
@@ -393,17 +589,44 @@ class ListModelCommon : public QAbstractListModel, protected LoggingComponent {
 
  public:
 
-	ListModelCommon() : LoggingComponent("ListModel") {}
+	ListModelCommon();
 
 	//-- model configuration -------------------------------------------------------------------------------------------
 
 	void toggleIcons( bool enabled )  { iconsEnabled = enabled; }
 	bool areIconsEnabled() const      { return iconsEnabled; }
 
+	/// Enables a hash index of the item IDs, so that findIndexByID() doesn't have to go through the whole list.
+	/** It's worth it for long lists where the selection is restored by IDs after every update.
+	  * The index is rebuilt on the next look-up after any change that the model notifies its views about. */
+	void toggleIDIndex( bool enabled )  { idIndexEnabled = enabled; invalidateIDIndex(); }
+
+	/// Must be called when the IDs of the items are changed without notifying the views.
+	void invalidateIDIndex()            { idIndexValid = false; idIndex.clear(); }
+
+	/// Enables caching of the display strings of the rows, so that they are not constructed again every time
+	/// the view paints or lays out the row.
+	/** It's worth it for long lists with an expensive display string function. The rows are invalidated by the same
+	  * notifications as the ID index, the changed rows only by dataChanged() of a role that affects the text.
+	  * The colors and the icons are not cached, they are already stored in the items and only wrapped on return. */
+	void toggleDisplayCache( bool enabled )  { displayCacheEnabled = enabled; invalidateDisplayCache(); }
+
+	/// Must be called when the displayed content of the items is changed without notifying the views.
+	void invalidateDisplayCache()            { displayCache.clear(); }
+
 	//-- data change notifications -------------------------------------------------------------------------------------
 
 	/// Notifies the view that the content of some items has been changed.
 	void contentChanged( int changedRowsBegin, int changedRowsEnd = -1 );
+	/// Notifies the view that only the icons of some items have been changed, the item data remain the same.
+	void iconsChanged( int changedRowsBegin, int changedRowsEnd = -1 );
+	/// Notifies the view that only the text colors and the tool tips of some items have been changed.
+	void annotationsChanged( int changedRowsBegin, int changedRowsEnd = -1 );
+
+	/// Whether a change of these roles is only a change of how the items look, not of their data.
+	static bool isOnlyPresentation( const QVector<int> & roles );
+	/// Whether a change of these roles can change the display string.
+	static bool affectsDisplayString( const QVector<int> & roles );
 
 	// One of the following functions must always be called before and after doing any modifications to the list,
 	// otherwise the list might not update correctly or it might even crash trying to access items that no longer exist.
@@ -426,18 +649,18 @@ class ListModelCommon : public QAbstractListModel, protected LoggingComponent {
 		endInsertRows();
 	}
 
-	void startInserting( int row )
+	void startInserting( int row, int count = 1 )
 	{
-		beginInsertRows( QModelIndex(), row, row );
+		beginInsertRows( QModelIndex(), row, row + count - 1 );
 	}
 	void finishInserting()
 	{
 		endInsertRows();
 	}
 
-	void startDeleting( int row )
+	void startDeleting( int row, int count = 1 )
 	{
-		beginRemoveRows( QModelIndex(), row, row );
+		beginRemoveRows( QModelIndex(), row, row + count - 1 );
 	}
 	void finishDeleting()
 	{
@@ -460,10 +683,83 @@ class ListModelCommon : public QAbstractListModel, protected LoggingComponent {
 		return index( row, /*column*/0, /*parent*/QModelIndex() );
 	}
 
+ protected:
+
+	template< typename List >
+	int findIndexByID( const List & list, const QString & itemID ) const
+	{
+		if (!idIndexEnabled)
+		{
+			return findSuch( list, [&]( const auto & item ) { return isSameString( item.getID(), itemID ); } );
+		}
+
+		if (!idIndexValid)
+		{
+			rebuildIDIndex( list );
+		}
+
+		int idx = idIndex.value( itemID, -1 );
+		// in case the list has been modified without any notification
+		if (idx >= 0 && (idx >= list.size() || list[ idx ].getID() != itemID))
+		{
+			logLogicError() << "the ID index is out of date, the model was modified without notifying the views";
+			rebuildIDIndex( list );
+			idx = idIndex.value( itemID, -1 );
+		}
+		return idx;
+	}
+
+	template< typename List >
+	void rebuildIDIndex( const List & list ) const
+	{
+		idIndex.clear();
+		idIndex.reserve( int( list.size() ) );
+		for (int i = 0; i < list.size(); ++i)
+		{
+			QString itemID = list[i].getID();
+			if (!idIndex.contains( itemID ))  // the first of the duplicates, like the linear search
+				idIndex.insert( std::move(itemID), i );
+		}
+		idIndexValid = true;
+	}
+
+	template< typename Item, typename MakeDisplayString >
+	QString getDisplayString( int row, const Item & item, const MakeDisplayString & makeDisplayString ) const
+	{
+		if (!displayCacheEnabled)
+		{
+			return makeDisplayString( item );
+		}
+
+		if (displayCache.size() != this->rowCount())  // invalidated, or the list was resized without a notification
+		{
+			displayCache.clear();
+			displayCache.resize( this->rowCount() );
+		}
+
+		QString & cached = displayCache[ row ];
+		if (cached.isNull())
+		{
+			cached = makeDisplayString( item );
+			if (cached.isNull())
+				cached = QStringLiteral("");  // so that an empty name is not constructed again
+		}
+		return cached;
+	}
+
+	void invalidateDisplayCache( int firstRow, int lastRow );
+
  protected:
 
 	bool iconsEnabled = false;
 
+	bool idIndexEnabled = false;
+	mutable bool idIndexValid = false;
+	mutable QHash< QString, int > idIndex;
+
+	bool displayCacheEnabled = false;
+	mutable QVector< QString > displayCache;  ///< null string means the row is not cached yet
+
 };
 
 
@@ -483,10 +779,14 @@ class ReadOnlyListModel : public ListModelCommon, public ListImpl {
 	ReadOnlyListModel( const QList< Item > & itemList, std::function< QString ( const Item & ) > makeDisplayString )
 		: ListImpl( itemList ), makeDisplayString( makeDisplayString ) {}
 
+	/// Returns the index of the first item with this ID, or -1 if there is none.
+	int findIndexByID( const QString & itemID ) const
+		{ return ListModelCommon::findIndexByID( static_cast< const ListImpl & >( *this ), itemID ); }
+
 	//-- model configuration -------------------------------------------------------------------------------------------
 
 	void setDisplayStringFunc( std::function< QString ( const Item & ) > makeDisplayString )
-		{ this->makeDisplayString = makeDisplayString; }
+		{ this->makeDisplayString = makeDisplayString; this->invalidateDisplayCache(); }
 
 	//-- implementation of QAbstractItemModel's virtual methods --------------------------------------------------------
 
@@ -508,7 +808,7 @@ class ReadOnlyListModel : public ListModelCommon, public ListImpl {
 			{
 				// Some UI elements may want to display only the Item name, some others a string constructed from multiple
 				// Item elements. This way we generalize from the way the display string is constructed from the Item.
-				return makeDisplayString( item );
+				return this->getDisplayString( index.row(), item, makeDisplayString );
 			}
 			else if (role == Qt::ForegroundRole)
 			{
@@ -516,6 +816,8 @@ class ReadOnlyListModel : public ListModelCommon, public ListImpl {
 					return QBrush( themes::getCurrentPalette().separatorText );
 				else if (item.textColor)
 					return QBrush( *item.textColor );
+				else if (item.isConflicting)
+					return QBrush( themes::getCurrentPalette().conflictingEntryText );
 				else
 					return QVariant();  // default
 			}
@@ -535,6 +837,13 @@ class ReadOnlyListModel : public ListModelCommon, public ListImpl {
 				else
 					return QVariant();  // default
 			}
+			else if (role == Qt::ToolTipRole)
+			{
+				if (!item.toolTip.isEmpty())
+					return item.toolTip;
+				else
+					return QVariant();  // default
+			}
 			else if (role == Qt::DecorationRole && iconsEnabled && !item.isSeparator)
 			{
 				return item.getIcon();
@@ -582,11 +891,15 @@ class EditableListModel : public ListModelCommon, public ListImpl, public DropTa
 	EditableListModel( const QList< Item > & itemList, std::function< QString ( const Item & ) > makeDisplayString )
 		: ListImpl( itemList ), DropTarget(), makeDisplayString( makeDisplayString ), pathConvertor( nullptr ) {}
 
+	/// Returns the index of the first item with this ID, or -1 if there is none.
+	int findIndexByID( const QString & itemID ) const
+		{ return ListModelCommon::findIndexByID( static_cast< const ListImpl & >( *this ), itemID ); }
+
 
 	//-- customization of how data will be represented -----------------------------------------------------------------
 
 	void setDisplayStringFunc( std::function< QString ( const Item & ) > makeDisplayString )
-		{ this->makeDisplayString = makeDisplayString; }
+		{ this->makeDisplayString = makeDisplayString; this->invalidateDisplayCache(); }
 
 	void toggleIcons( bool enabled ) { iconsEnabled = enabled; }
 
@@ -654,7 +967,7 @@ class EditableListModel : public ListModelCommon, public ListImpl, public DropTa
 			{
 				// Each list view might want to display the same data differently, so we allow the user of the list model
 				// to specify it by a function for each view separately.
-				return makeDisplayString( item );
+				return this->getDisplayString( index.row(), item, makeDisplayString );
 			}
 			else if (role == Qt::EditRole && canBeEdited( item ))
 			{
@@ -670,6 +983,8 @@ class EditableListModel : public ListModelCommon, public ListImpl, public DropTa
 					return QBrush( themes::getCurrentPalette().separatorText );
 				else if (item.textColor)
 					return QBrush( *item.textColor );
+				else if (item.isConflicting)
+					return QBrush( themes::getCurrentPalette().conflictingEntryText );
 				else
 					return QVariant();  // default
 			}
@@ -689,6 +1004,13 @@ class EditableListModel : public ListModelCommon, public ListImpl, public DropTa
 				else
 					return QVariant();  // default
 			}
+			else if (role == Qt::ToolTipRole)
+			{
+				if (!item.toolTip.isEmpty())
+					return item.toolTip;
+				else
+					return QVariant();  // default
+			}
 			else if (role == Qt::DecorationRole && canHaveIcon( item ))
 			{
 				return item.getIcon();
@@ -744,7 +1066,18 @@ class EditableListModel : public ListModelCommon, public ListImpl, public DropTa
 
 	virtual bool insertRows( int row, int count, const QModelIndex & parent ) override
 	{
-		if (parent.isValid() || row < 0)
+		QList< Item > newItems;
+		newItems.reserve( count );
+		for (int i = 0; i < count; i++)
+			newItems.append( Item() );
+
+		return insertItems( row, std::move(newItems), parent );
+	}
+
+	/// Inserts a whole block of items with a single notification of the views.
+	bool insertItems( int row, QList< Item > && newItems, const QModelIndex & parent = QModelIndex() )
+	{
+		if (parent.isValid() || row < 0 || row > this->size() || newItems.isEmpty())
 			return false;
 
 		if (!this->canBeModified())
@@ -753,12 +1086,9 @@ class EditableListModel : public ListModelCommon, public ListImpl, public DropTa
 			return false;
 		}
 
-		QAbstractListModel::beginInsertRows( parent, row, row + count - 1 );
+		QAbstractListModel::beginInsertRows( parent, row, row + int( newItems.size() ) - 1 );
 
-		// n times moving all the elements forward to insert one is not nice
-		// but it happens only once in awhile and the number of elements is almost always very low
-		for (int i = 0; i < count; i++)
-			this->insert( row + i, Item() );
+		this->insertRange( row, std::move(newItems) );
 
 		QAbstractListModel::endInsertRows();
 
@@ -778,14 +1108,11 @@ class EditableListModel : public ListModelCommon, public ListImpl, public DropTa
 
 		QAbstractListModel::beginRemoveRows( parent, row, row + count - 1 );
 
-		// n times moving all the elements backward to insert one is not nice
-		// but it happens only once in awhile and the number of elements is almost always very low
-		for (int i = 0; i < count; i++)
-		{
-			this->removeAt( row );
-			if (row < DropTarget::droppedRow())  // we are removing a row that is before the target row
-				DropTarget::decrementRow();      // so target row's index is moving backwards
-		}
+		this->removeRange( row, count );
+
+		// the rows that were before the target row move its index backwards
+		int removedBeforeTarget = std::clamp( DropTarget::droppedRow() - row, 0, count );
+		DropTarget::decrementRow( removedBeforeTarget );
 
 		QAbstractListModel::endRemoveRows();
 
@@ -871,16 +1198,10 @@ class EditableListModel : public ListModelCommon, public ListImpl, public DropTa
 		const int * rawData = reinterpret_cast< int * >( encodedData.data() );
 		int count = encodedData.size() / int(sizeof(int));
 
-		// Because insertRows shifts the items and invalidates the indexes, we need to capture the original items before
-		// allocating space at the target position. We can avoid making a local temporary copy of Item by abusing
-		// the fact that QList is essentially an array of pointers to objects (official API documentation says so).
-		// So we can just save the pointers to the items and when the rows are inserted and shifted, those pointers
-		// will still point to the correct items and we can use them copy or move the data from them to the target pos.
-		//
-		// We could probably avoid even the copy/move constructors and the allocation when inserting an item into QList,
-		// but we would need a direct access to the pointers inside QList which it doesn't provide.
-		// Alternativelly the QList<Item> could be replaced with QVector<Item*> or QVector<unique_ptr<Item>>
-		// but that would just complicate a lot of other things.
+		// Because inserting shifts the items and invalidates the indexes, we need to capture the original items before
+		// inserting them at the target position. They are moved out into a temporary list, which is then moved
+		// into the target position as a whole, so the list is re-arranged only once. The moved-from originals
+		// are removed afterwards by the view calling removeRows().
 
 		QVector< int > origItemIndexes;
 		for (int i = 0; i < count; i++)
@@ -889,22 +1210,22 @@ class EditableListModel : public ListModelCommon, public ListImpl, public DropTa
 		// The indexes of selected items can come in arbitrary order, but we need to drop them in ascending order.
 		std::sort( origItemIndexes.begin(), origItemIndexes.end() );
 
-		QVector< Item * > origItemRefs;
-		for (int origItemIdx : origItemIndexes)
+		if (parent.isValid() || count <= 0)
 		{
-			origItemRefs.append( &(*this)[ origItemIdx ] );
+			return false;
 		}
 
-		// allocate space for the items to move to
-		if (!insertRows( row, count, parent ))
+		QList< Item > movedItems;
+		movedItems.reserve( count );
+		for (int origItemIdx : origItemIndexes)
 		{
-			return false;
+			movedItems.append( std::move( (*this)[ origItemIdx ] ) );
 		}
 
 		// move the original items to the target position
-		for (int i = 0; i < count; i++)
+		if (!insertItems( row, std::move(movedItems), parent ))
 		{
-			(*this)[ row + i ] = std::move( *origItemRefs[i] );
+			return false;
 		}
 
 		// idiotic workaround because Qt is fucking retarded   (read the comment at the top of EditableListView.cpp)
@@ -924,35 +1245,30 @@ class EditableListModel : public ListModelCommon, public ListImpl, public DropTa
 			return false;
 		}
 
-		// first we need to know how many items will be inserted, so that we can allocate space for them
-		QList< QFileInfo > filesToBeInserted;
+		// construct all the items first, so that they can be inserted as a single block
+		QList< Item > itemsToBeInserted;
+		itemsToBeInserted.reserve( urls.size() );
 		for (const QUrl & droppedUrl : urls)
 		{
 			QString localPath = droppedUrl.toLocalFile();
 			if (!localPath.isEmpty())
 			{
-				QFileInfo fileInfo( pathConvertor->convertPath( localPath ) );
-				filesToBeInserted.append( std::move(fileInfo) );
+				// This template class doesn't know about the structure of Item, it's supposed to be universal for any.
+				// Therefore only author of Item knows how to assign a dropped file into it, so he must define it by a constructor.
+				itemsToBeInserted.append( Item( QFileInfo( pathConvertor->convertPath( localPath ) ) ) );
 			}
 		}
+		int insertedCount = int( itemsToBeInserted.size() );
 
-		// allocate space for the items to be dropped to
-		if (!insertRows( row, filesToBeInserted.count(), parent ))
+		if (!insertItems( row, std::move(itemsToBeInserted), parent ))
 		{
 			return false;
 		}
 
-		for (int i = 0; i < filesToBeInserted.count(); i++)
-		{
-			// This template class doesn't know about the structure of Item, it's supposed to be universal for any.
-			// Therefore only author of Item knows how to assign a dropped file into it, so he must define it by a constructor.
-			(*this)[ row + i ] = Item( filesToBeInserted[ i ] );
-		}
-
 		// idiotic workaround because Qt is fucking retarded   (read the comment at the top of EditableListView.cpp)
 		//
 		// note down the destination drop index, so it can be later retrieved by ListView
-		DropTarget::itemsDropped( row, filesToBeInserted.count() );
+		DropTarget::itemsDropped( row, insertedCount );
 
 		return true;
 	}
@@ -0,0 +1,815 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: tree model of directories with map packs, populated lazily in the background
+//======================================================================================================================
+
+#include "MapPackModel.hpp"
+
+#include "Utils/ThumbnailCache.hpp"
+
+#include <QMimeData>
+#include <QPixmap>
+#include <QUrl>
+#include <QStringBuilder>
+
+#include <algorithm>
+#include <iterator>
+
+
+//======================================================================================================================
+
+// the file names are compared the way the file system of the platform does it
+static constexpr Qt::CaseSensitivity fileNameCase = IS_WINDOWS ? Qt::CaseInsensitive : Qt::CaseSensitive;
+
+/// the WAD info of the files arrives one by one, so wait a moment for the others before notifying the views
+static constexpr int InfoChangesDelayMs = 50;
+
+struct MapPackModel::Node
+{
+	Node * parent = nullptr;
+	int row = 0;  ///< position in the parent's children, kept up to date on every insertion and removal
+	QString name;
+	QString path;  ///< absolute
+	bool isDir = false;
+
+	// directory
+	LoadState loadState = LoadState::NotLoaded;
+	bool refreshing = false;
+	std::vector< std::unique_ptr< Node > > children;
+
+	// file
+	FileStamp stamp;
+	bool wadInfoRequested = false;
+	bool wadInfoKnown = false;
+	doom::WadType wadType = doom::WadType::Neither;
+	int mapCount = 0;
+};
+
+// directories first, then alphabetically, like the file managers do it
+static bool isOrderedBefore( bool isDir1, const QString & name1, bool isDir2, const QString & name2 )
+{
+	if (isDir1 != isDir2)
+		return isDir1;
+	int cmp = name1.compare( name2, Qt::CaseInsensitive );
+	return cmp != 0 ? cmp < 0 : name1 < name2;
+}
+
+static const char * wadTypeToStr( doom::WadType type )
+{
+	switch (type)
+	{
+		case doom::WadType::IWAD:    return "IWAD";
+		case doom::WadType::PWAD:    return "PWAD";
+		case doom::WadType::Archive: return "Archive";
+		default:                     return "";
+	}
+}
+
+
+//======================================================================================================================
+
+MapPackModel::MapPackModel( QObject * parent )
+:
+	QAbstractItemModel( parent ),
+	LoggingComponent("MapPackModel"),
+	_root( std::make_unique< Node >() )
+{
+	_root->isDir = true;
+	_root->loadState = LoadState::Loaded;  // empty root, nothing to load
+
+	_infoChangesTimer.setSingleShot( true );
+	_infoChangesTimer.setInterval( InfoChangesDelayMs );
+	connect( &_infoChangesTimer, &QTimer::timeout, this, &thisClass::emitInfoChanges );
+}
+
+MapPackModel::~MapPackModel()
+{
+	_traverser.cancelAll();  // the callbacks refer to the nodes
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  public API
+
+void MapPackModel::toggleThumbnails( bool enabled )
+{
+	if (enabled == _thumbnailsEnabled)
+		return;
+
+	_thumbnailsEnabled = enabled;
+	if (enabled)
+	{
+		g_thumbnailCache.setReadyCallback( this, [ this ]( const QStringList & paths )
+		{
+			onThumbnailsReady( paths );
+		});
+	}
+	else
+	{
+		g_thumbnailCache.setReadyCallback( nullptr, {} );
+		g_thumbnailCache.cancelPending();
+	}
+
+	if (!_root->children.empty())
+	{
+		beginResetModel();  // the row heights change
+		endResetModel();
+	}
+}
+
+void MapPackModel::setRootPaths( const QStringVec & dirPaths )
+{
+	QStringVec absPaths;
+	for (const QString & dirPath : dirPaths)
+	{
+		if (dirPath.isEmpty())
+			continue;
+		QString absPath = toAbsolutePath( dirPath );
+		if (!absPaths.contains( absPath ))
+			absPaths.append( std::move(absPath) );
+	}
+	if (absPaths == _rootPaths)
+	{
+		return;  // the same directories stated in a different way, keep everything that is loaded
+	}
+
+	logDebug() << "setRootPaths: " << absPaths.join(',');
+
+	_traverser.cancelAll();
+	_pendingInfoChanges.clear();
+	_infoChangesTimer.stop();
+	if (_thumbnailsEnabled)
+		g_thumbnailCache.cancelPending();  // the old rows will never be displayed again
+
+	beginResetModel();
+	_root = std::make_unique< Node >();
+	_root->isDir = true;
+	if (absPaths.size() == 1)
+	{
+		_root->path = absPaths[0];
+	}
+	else
+	{
+		_root->loadState = LoadState::Loaded;  // the top-level nodes are known right away
+		for (const QString & absPath : absPaths)
+		{
+			auto rootNode = std::make_unique< Node >();
+			rootNode->parent = _root.get();
+			rootNode->row = int( _root->children.size() );
+			rootNode->name = absPath;  // the whole path, the directories on different disks often have the same name
+			rootNode->path = absPath;
+			rootNode->isDir = true;
+			_root->children.push_back( std::move(rootNode) );
+		}
+	}
+	_rootPaths = std::move(absPaths);
+	++_rootGeneration;
+	endResetModel();
+
+	// each one is listed by its own job, so that a slow one (e.g. on a network share) doesn't delay the others
+	if (!_root->path.isEmpty())
+		startLoading( _root.get() );
+	for (const auto & rootNode : _root->children)
+		startLoading( rootNode.get() );
+
+	advancePendingLoad();  // the requested paths might be in the new directories
+}
+
+void MapPackModel::refresh( const QString & dirPath )
+{
+	// only the directories the user has already seen are worth listing again, the rest will be loaded when needed
+	std::function< void ( Node * ) > refreshDir = [&]( Node * dirNode )
+	{
+		if (dirNode->loadState != LoadState::Loaded)
+			return;
+		if (!dirNode->refreshing && !dirNode->path.isEmpty())  // the node above multiple roots has nothing to list
+			startLoading( dirNode );
+		for (const auto & child : dirNode->children)
+			if (child->isDir)
+				refreshDir( child.get() );
+	};
+
+	if (dirPath.isEmpty())
+	{
+		refreshDir( _root.get() );
+		return;
+	}
+
+	bool found;
+	Node * dirNode = findDeepestNode( toAbsolutePath( dirPath ), found );
+	if (found && dirNode->isDir)
+		refreshDir( dirNode );
+}
+
+bool MapPackModel::ensurePathsLoaded( const QStringVec & paths, QObject * context, LoadedCallback callback )
+{
+	PendingLoad pendingLoad;
+	pendingLoad.absPaths.reserve( paths.size() );
+	for (const QString & path : paths)
+		pendingLoad.absPaths.append( toAbsolutePath( path ) );
+	pendingLoad.context = context;
+	pendingLoad.callback = std::move(callback);
+
+	bool allResolved = true;
+	for (const QString & absPath : pendingLoad.absPaths)
+		if (!advanceLoadOfPath( absPath ))  // don't stop at the first one, so that the directories are loaded in parallel
+			allResolved = false;
+
+	if (allResolved)
+		_pendingLoad.reset();  // the previous request is outdated
+	else
+		_pendingLoad = std::move(pendingLoad);
+
+	return allResolved;
+}
+
+QModelIndex MapPackModel::index( const QString & path ) const
+{
+	bool found;
+	const Node * node = findDeepestNode( toAbsolutePath( path ), found );
+	return found ? getIndex( node ) : QModelIndex();
+}
+
+QString MapPackModel::filePath( const QModelIndex & index ) const
+{
+	return index.isValid() ? getNode( index )->path : QString();
+}
+
+bool MapPackModel::isDir( const QModelIndex & index ) const
+{
+	return index.isValid() && getNode( index )->isDir;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  implementation of QAbstractItemModel
+
+QModelIndex MapPackModel::index( int row, int column, const QModelIndex & parent ) const
+{
+	const Node * parentNode = getNode( parent );
+	if (row < 0 || row >= int( parentNode->children.size() ) || column < 0 || column >= ColumnCount)
+	{
+		return QModelIndex();
+	}
+	return createIndex( row, column, parentNode->children[ size_t( row ) ].get() );
+}
+
+QModelIndex MapPackModel::parent( const QModelIndex & index ) const
+{
+	if (!index.isValid())
+	{
+		return QModelIndex();
+	}
+	return getIndex( getNode( index )->parent );
+}
+
+int MapPackModel::rowCount( const QModelIndex & parent ) const
+{
+	if (parent.column() > 0)  // only the first column has children
+	{
+		return 0;
+	}
+	return int( getNode( parent )->children.size() );
+}
+
+int MapPackModel::columnCount( const QModelIndex & ) const
+{
+	return ColumnCount;
+}
+
+bool MapPackModel::hasChildren( const QModelIndex & parent ) const
+{
+	if (parent.column() > 0)
+	{
+		return false;
+	}
+	const Node * node = getNode( parent );
+	if (!node->isDir)
+	{
+		return false;
+	}
+	// until the directory is listed, let the view display the expand arrow, so that the user can request it
+	return node->loadState != LoadState::Loaded || !node->children.empty();
+}
+
+bool MapPackModel::canFetchMore( const QModelIndex & parent ) const
+{
+	const Node * node = getNode( parent );
+	return node->isDir && node->loadState == LoadState::NotLoaded;
+}
+
+void MapPackModel::fetchMore( const QModelIndex & parent )
+{
+	Node * node = getNode( parent );
+	if (node->isDir && node->loadState == LoadState::NotLoaded)
+	{
+		startLoading( node );  // the entries will be inserted when the listing finishes
+	}
+}
+
+Qt::ItemFlags MapPackModel::flags( const QModelIndex & index ) const
+{
+	if (!index.isValid())
+	{
+		return Qt::NoItemFlags;
+	}
+
+	Qt::ItemFlags flags = Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsDragEnabled;
+	if (!getNode( index )->isDir)
+		flags |= Qt::ItemNeverHasChildren;
+	return flags;
+}
+
+QVariant MapPackModel::data( const QModelIndex & index, int role ) const
+{
+	if (!index.isValid())
+	{
+		return QVariant();
+	}
+
+	const Node * node = getNode( index );
+	bool hasWadInfo = !node->isDir && node->wadInfoKnown && node->wadType != doom::WadType::Neither;
+
+	if (role == Qt::DisplayRole)
+	{
+		switch (index.column())
+		{
+			case NameColumn:     return node->name;
+			case MapCountColumn: return hasWadInfo ? QVariant( node->mapCount ) : QVariant();
+			case TypeColumn:     return hasWadInfo ? QVariant( wadTypeToStr( node->wadType ) ) : QVariant();
+			default:             return QVariant();
+		}
+	}
+	else if (role == Qt::ToolTipRole && index.column() == NameColumn && hasWadInfo)
+	{
+		// the other columns are usually hidden, so at least this way
+		return QString( wadTypeToStr( node->wadType ) ) % ", " % QString::number( node->mapCount )
+		     % (node->mapCount == 1 ? " map" : " maps");
+	}
+	else if (role == Qt::DecorationRole && index.column() == NameColumn && _thumbnailsEnabled && !node->isDir)
+	{
+		// The view asks only for the rows it's displaying, so these are the ones loaded first.
+		QPixmap thumbnail = g_thumbnailCache.getThumbnail( node->path, node->stamp );
+		return !thumbnail.isNull() ? QVariant( thumbnail ) : QVariant();
+	}
+	else if (role == Qt::TextAlignmentRole && index.column() == MapCountColumn)
+	{
+		return int( Qt::AlignRight | Qt::AlignVCenter );
+	}
+
+	return QVariant();
+}
+
+QVariant MapPackModel::headerData( int section, Qt::Orientation orientation, int role ) const
+{
+	if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+	{
+		return QVariant();
+	}
+
+	switch (section)
+	{
+		case NameColumn:     return "Name";
+		case MapCountColumn: return "Maps";
+		case TypeColumn:     return "Type";
+		default:             return QVariant();
+	}
+}
+
+QStringList MapPackModel::mimeTypes() const
+{
+	// the same as QFileSystemModel, so that the entries can be dropped to the mod list or to other applications
+	return { "text/uri-list" };
+}
+
+QMimeData * MapPackModel::mimeData( const QModelIndexList & indexes ) const
+{
+	QList< QUrl > urls;
+	for (const QModelIndex & index : indexes)
+		if (index.isValid() && index.column() == NameColumn)  // the view selects all the columns of a row
+			urls.append( QUrl::fromLocalFile( getNode( index )->path ) );
+
+	QMimeData * mimeData = new QMimeData;
+	mimeData->setUrls( urls );
+	return mimeData;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  nodes
+
+MapPackModel::Node * MapPackModel::getNode( const QModelIndex & index ) const
+{
+	return index.isValid() ? static_cast< Node * >( index.internalPointer() ) : _root.get();
+}
+
+QModelIndex MapPackModel::getIndex( const Node * node, int column ) const
+{
+	if (!node || node == _root.get())
+	{
+		return QModelIndex();
+	}
+	return createIndex( node->row, column, const_cast< Node * >( node ) );
+}
+
+QString MapPackModel::toAbsolutePath( const QString & path ) const
+{
+	return QDir::cleanPath( _pathContext ? _pathContext->getAbsolutePath( path ) : QFileInfo( path ).absoluteFilePath() );
+}
+
+/// Returns where the names below the root directory begin in the path, or -1 if the path is outside of it.
+static int matchRootPath( const QString & absPath, const QString & rootPath )
+{
+	if (rootPath.isEmpty() || !absPath.startsWith( rootPath, fileNameCase ))
+		return -1;
+	if (absPath.size() == rootPath.size() || rootPath.endsWith('/'))  // the root of a drive ends with it
+		return rootPath.size();
+	if (absPath[ rootPath.size() ] != '/')
+		return -1;  // only begins with the same name
+	return rootPath.size() + 1;
+}
+
+MapPackModel::Node * MapPackModel::findRootNode( const QString & absPath, int & namesBegin ) const
+{
+	if (!_root->path.isEmpty())  // single root displayed at the top level
+	{
+		namesBegin = matchRootPath( absPath, _root->path );
+		return namesBegin >= 0 ? _root.get() : nullptr;
+	}
+
+	// one root can be inside another one, then the path belongs to the inner one
+	Node * rootNode = nullptr;
+	namesBegin = -1;
+	for (const auto & child : _root->children)
+	{
+		int childNamesBegin = matchRootPath( absPath, child->path );
+		if (childNamesBegin > namesBegin)
+		{
+			rootNode = child.get();
+			namesBegin = childNamesBegin;
+		}
+	}
+	return rootNode;
+}
+
+MapPackModel::Node * MapPackModel::findDeepestNode( const QString & absPath, bool & found ) const
+{
+	found = false;
+
+	int namesBegin;
+	Node * node = findRootNode( absPath, namesBegin );
+	if (!node)
+	{
+		return nullptr;  // outside of the root directories
+	}
+	if (namesBegin >= absPath.size())
+	{
+		found = true;
+		return node;
+	}
+
+	const QStringList names = absPath.mid( namesBegin ).split('/');
+	for (const QString & name : names)
+	{
+		if (node->loadState != LoadState::Loaded)
+			return node;
+
+		auto childIter = std::find_if( node->children.begin(), node->children.end(), [&]( const auto & child )
+		{
+			return child->name.compare( name, fileNameCase ) == 0;
+		});
+		if (childIter == node->children.end())
+			return node;
+
+		node = childIter->get();
+	}
+
+	found = true;
+	return node;
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  loading
+
+void MapPackModel::startLoading( Node * dirNode )
+{
+	if (dirNode->loadState == LoadState::Loaded)
+		dirNode->refreshing = true;
+	else
+		dirNode->loadState = LoadState::Loading;
+
+	// the paths of the nodes are absolute, they are converted only when they leave the model
+	static const PathConvertor absPathConvertor( QDir(), PathStyle::Absolute );
+
+	auto entries = std::make_shared< QList< QFileInfo > >();
+
+	// the filter is called from the worker thread, so it must have its own copy of the suffixes
+	_traverser.traverse( dirNode, dirNode->path, /*recursively*/false, fs::EntryType::BOTH, absPathConvertor,
+		[ suffixes = _fileSuffixes ]( const QFileInfo & entry )
+		{
+			if (entry.isSymLink())
+				return false;
+			return entry.isDir() || fs::hasOneOfSuffixes( entry.fileName(), suffixes );
+		},
+		[ entries ]( QList< QFileInfo > && batch )
+		{
+			entries->append( batch );
+		},
+		[ this, dirNode, entries ]()
+		{
+			onDirListed( dirNode, std::move(*entries) );
+		}
+	);
+}
+
+void MapPackModel::onDirListed( Node * dirNode, QList< QFileInfo > && entries )
+{
+	bool firstLoad = dirNode->loadState != LoadState::Loaded;
+	dirNode->loadState = LoadState::Loaded;
+	dirNode->refreshing = false;
+
+	std::vector< std::unique_ptr< Node > > newNodes;
+	newNodes.reserve( size_t( entries.size() ) );
+	for (const QFileInfo & entry : entries)
+	{
+		auto node = std::make_unique< Node >();
+		node->name = entry.fileName();
+		node->path = dirNode->path.endsWith('/') ? dirNode->path % node->name : dirNode->path % '/' % node->name;
+		node->isDir = entry.isDir();
+		if (!node->isDir)
+			node->stamp = FileStamp( entry );  // the traversal has already retrieved it
+		newNodes.push_back( std::move(node) );
+	}
+	std::sort( newNodes.begin(), newNodes.end(), []( const auto & a, const auto & b )
+	{
+		return isOrderedBefore( a->isDir, a->name, b->isDir, b->name );
+	});
+
+	if (firstLoad)
+	{
+		bool wasEmpty = newNodes.empty();
+		insertEntries( dirNode, 0, std::move(newNodes) );
+		if (wasEmpty && dirNode != _root.get())
+		{
+			QModelIndex dirIndex = getIndex( dirNode );
+			emit dataChanged( dirIndex, dirIndex );  // let the view remove the expand arrow
+		}
+	}
+	else
+	{
+		// Both lists are sorted the same way, so the entries that remain are in the same order in both of them,
+		// and the differences can be applied in contiguous blocks without resetting the expanded sub-directories.
+		QHash< QString, const Node * > newNodesByName;
+		newNodesByName.reserve( int( newNodes.size() ) );
+		for (const auto & node : newNodes)
+			newNodesByName.insert( node->name, node.get() );
+
+		auto isGone = [&]( int row )
+		{
+			const Node * oldNode = dirNode->children[ size_t( row ) ].get();
+			const Node * newNode = newNodesByName.value( oldNode->name );
+			return !newNode || newNode->isDir != oldNode->isDir;
+		};
+
+		for (int row = int( dirNode->children.size() ) - 1; row >= 0; --row)
+		{
+			if (!isGone( row ))
+				continue;
+			int lastRow = row;
+			while (row > 0 && isGone( row - 1 ))
+				--row;
+			removeEntries( dirNode, row, lastRow - row + 1 );
+		}
+
+		std::vector< std::unique_ptr< Node > > addedBlock;
+		size_t childIdx = 0;
+		auto flushAddedBlock = [&]()
+		{
+			if (addedBlock.empty())
+				return;
+			size_t blockSize = addedBlock.size();
+			insertEntries( dirNode, int( childIdx ), std::move(addedBlock) );
+			addedBlock.clear();
+			childIdx += blockSize;
+		};
+
+		for (auto & newNode : newNodes)
+		{
+			// the block is not inserted yet, so this is the next of the remaining old entries
+			if (childIdx < dirNode->children.size() && dirNode->children[ childIdx ]->name == newNode->name)
+			{
+				flushAddedBlock();
+				Node * existingNode = dirNode->children[ childIdx ].get();
+				if (!existingNode->isDir && existingNode->stamp != newNode->stamp)
+				{
+					// the file has been modified, its info might be different
+					existingNode->stamp = newNode->stamp;
+					existingNode->wadInfoRequested = false;
+					requestWadInfo( existingNode );
+				}
+				++childIdx;
+			}
+			else
+			{
+				addedBlock.push_back( std::move(newNode) );
+			}
+		}
+		flushAddedBlock();
+	}
+
+	advancePendingLoad();
+}
+
+void MapPackModel::insertEntries( Node * dirNode, int row, std::vector< std::unique_ptr< Node > > && newNodes )
+{
+	if (newNodes.empty())
+		return;
+
+	int count = int( newNodes.size() );
+	for (auto & node : newNodes)
+		node->parent = dirNode;
+
+	beginInsertRows( getIndex( dirNode ), row, row + count - 1 );
+	auto & children = dirNode->children;
+	children.insert( children.begin() + row, std::make_move_iterator( newNodes.begin() ), std::make_move_iterator( newNodes.end() ) );
+	for (size_t i = size_t( row ); i < children.size(); ++i)
+		children[i]->row = int( i );
+	endInsertRows();
+
+	// the rows of the collected info changes have shifted
+	auto pendingIter = _pendingInfoChanges.find( dirNode );
+	if (pendingIter != _pendingInfoChanges.end())
+		*pendingIter = { 0, int( children.size() ) - 1 };
+
+	for (int i = row; i < row + count; ++i)
+		requestWadInfo( children[ size_t( i ) ].get() );
+}
+
+void MapPackModel::removeEntries( Node * dirNode, int row, int count )
+{
+	auto & children = dirNode->children;
+
+	beginRemoveRows( getIndex( dirNode ), row, row + count - 1 );
+	for (int i = row; i < row + count; ++i)
+		forgetSubtree( children[ size_t( i ) ].get() );
+	children.erase( children.begin() + row, children.begin() + row + count );
+	for (size_t i = size_t( row ); i < children.size(); ++i)
+		children[i]->row = int( i );
+	endRemoveRows();
+
+	auto pendingIter = _pendingInfoChanges.find( dirNode );
+	if (pendingIter != _pendingInfoChanges.end())
+	{
+		if (children.empty())
+			_pendingInfoChanges.erase( pendingIter );
+		else
+			*pendingIter = { 0, int( children.size() ) - 1 };
+	}
+}
+
+void MapPackModel::forgetSubtree( Node * node )
+{
+	// nothing may refer to the node after it's deleted
+	if (node->isDir)
+	{
+		_traverser.cancel( node );
+		_pendingInfoChanges.remove( node );
+		for (const auto & child : node->children)
+			forgetSubtree( child.get() );
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  WAD info and thumbnails
+
+void MapPackModel::requestWadInfo( Node * fileNode )
+{
+	if (fileNode->isDir || fileNode->wadInfoRequested)
+		return;
+
+	fileNode->wadInfoRequested = true;
+
+	// The cache is shared with the rest of the application, so it must be queried with the same paths.
+	// This also serves as the prefetching of the map names, so that they're ready when the user selects the file.
+	QString queryPath = _pathContext ? _pathContext->convertPath( fileNode->path ) : fileNode->path;
+	doom::g_cachedWadInfo.requestFileInfo( queryPath, this,
+		[ this, absPath = fileNode->path, rootGeneration = _rootGeneration ]( const doom::UncertainWadInfo & wadInfo )
+		{
+			onWadInfoRead( absPath, rootGeneration, wadInfo );
+		}
+	);
+}
+
+void MapPackModel::onWadInfoRead( const QString & absPath, quint64 rootGeneration, const doom::UncertainWadInfo & wadInfo )
+{
+	if (rootGeneration != _rootGeneration)
+		return;  // the model has been reset since the request
+
+	// the node might have been removed in the meantime, so it has to be looked up again
+	bool found;
+	Node * node = findDeepestNode( absPath, found );
+	if (!found || node->isDir)
+		return;
+
+	node->wadInfoKnown = wadInfo.status == ReadStatus::Success;
+	node->wadType = wadInfo.type;
+	node->mapCount = int( wadInfo.mapNames.size() );
+
+	markInfoChanged( node );
+}
+
+void MapPackModel::onThumbnailsReady( const QStringList & absPaths )
+{
+	for (const QString & absPath : absPaths)
+	{
+		bool found;
+		const Node * node = findDeepestNode( absPath, found );
+		if (found && !node->isDir)
+			markInfoChanged( node );
+	}
+}
+
+void MapPackModel::markInfoChanged( const Node * fileNode )
+{
+	auto pendingIter = _pendingInfoChanges.find( fileNode->parent );
+	if (pendingIter == _pendingInfoChanges.end())
+	{
+		_pendingInfoChanges.insert( fileNode->parent, { fileNode->row, fileNode->row } );
+	}
+	else
+	{
+		pendingIter->first = std::min( pendingIter->first, fileNode->row );
+		pendingIter->second = std::max( pendingIter->second, fileNode->row );
+	}
+
+	if (!_infoChangesTimer.isActive())
+		_infoChangesTimer.start();
+}
+
+void MapPackModel::emitInfoChanges()
+{
+	auto pendingChanges = std::move( _pendingInfoChanges );
+	_pendingInfoChanges.clear();
+
+	for (auto iter = pendingChanges.begin(); iter != pendingChanges.end(); ++iter)
+	{
+		const Node * dirNode = iter.key();
+		int lastRow = std::min( iter->second, int( dirNode->children.size() ) - 1 );
+		if (iter->first > lastRow)
+			continue;
+
+		emit dataChanged(
+			getIndex( dirNode->children[ size_t( iter->first ) ].get(), NameColumn ),
+			getIndex( dirNode->children[ size_t( lastRow ) ].get(), TypeColumn ),
+			{ Qt::DisplayRole, Qt::ToolTipRole, Qt::DecorationRole }
+		);
+	}
+}
+
+
+//----------------------------------------------------------------------------------------------------------------------
+//  loading of requested paths
+
+bool MapPackModel::advanceLoadOfPath( const QString & absPath )
+{
+	bool found;
+	Node * node = findDeepestNode( absPath, found );
+	if (found || !node)
+	{
+		return true;  // already there, or outside of the roots, where it will never be
+	}
+	if (node->loadState == LoadState::Loaded)
+	{
+		return true;  // the directory is listed and the next entry isn't in it, it doesn't exist
+	}
+	if (node->loadState == LoadState::NotLoaded)
+	{
+		startLoading( node );
+	}
+	return false;
+}
+
+void MapPackModel::advancePendingLoad()
+{
+	if (!_pendingLoad)
+		return;
+
+	bool allResolved = true;
+	for (const QString & absPath : _pendingLoad->absPaths)
+		if (!advanceLoadOfPath( absPath ))
+			allResolved = false;
+
+	if (!allResolved)
+		return;
+
+	// the callback might make a new request
+	PendingLoad pendingLoad = std::move( *_pendingLoad );
+	_pendingLoad.reset();
+
+	if (pendingLoad.context && pendingLoad.callback)  // otherwise the requester has been destroyed in the meantime
+		pendingLoad.callback();
+}
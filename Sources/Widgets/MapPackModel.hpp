@@ -0,0 +1,191 @@
+//======================================================================================================================
+// Project: DoomRunner
+//----------------------------------------------------------------------------------------------------------------------
+// Author:      Jan Broz (Youda008)
+// Description: tree model of directories with map packs, populated lazily in the background
+//======================================================================================================================
+
+#ifndef MAP_PACK_MODEL_INCLUDED
+#define MAP_PACK_MODEL_INCLUDED
+
+
+#include "Essential.hpp"
+
+#include "CommonTypes.hpp"  // QStringVec
+#include "Utils/AsyncDirTraverser.hpp"
+#include "Utils/FileSystemUtils.hpp"  // PathConvertor
+#include "Utils/WADReader.hpp"  // WadType, UncertainWadInfo
+#include "Utils/ErrorHandling.hpp"  // LoggingComponent
+
+#include <QAbstractItemModel>
+#include <QString>
+#include <QDir>
+#include <QList>
+#include <QStringList>
+#include <QHash>
+#include <QFileInfo>
+#include <QPointer>
+#include <QTimer>
+#include <QPair>
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <optional>
+
+
+//======================================================================================================================
+/// Tree of the map packs and the sub-directories of the root directories, replacement of QFileSystemModel.
+/**
+  * With a single root directory, its content is displayed at the top level. With more of them, each one has its own
+  * top-level node named by its path, so that the map packs from different disks can be browsed in one view.
+  *
+  * Each directory is listed in a worker thread only when it's needed (the roots right away, the sub-directories when
+  * they are expanded or when a path inside them is requested), and its entries are inserted in a single step after
+  * the listing is complete. Unlike with QFileSystemModel, the indexes are therefore valid as soon as the callback
+  * of ensurePathsLoaded() is called.
+  *
+  * The information about the WADs (number of maps, type) is read in the background through doom::g_cachedWadInfo
+  * as soon as the files appear in the model, and displayed in the additional columns once it's available.
+  *
+  * The paths returned by the model are absolute, like with QFileSystemModel. The model doesn't watch the file system,
+  * the owner calls refresh() when it finds out that the directory has changed.
+  */
+class MapPackModel : public QAbstractItemModel, protected LoggingComponent {
+
+	Q_OBJECT
+
+	using thisClass = MapPackModel;
+	using superClass = QAbstractItemModel;
+
+ public:
+
+	enum Column
+	{
+		NameColumn,
+		MapCountColumn,
+		TypeColumn,
+
+		ColumnCount
+	};
+
+	using LoadedCallback = std::function< void () >;
+
+	MapPackModel( QObject * parent = nullptr );
+	virtual ~MapPackModel() override;
+
+	/// Only files with these suffixes are displayed, directories are displayed always.
+	void setFileSuffixes( const QStringVec & suffixes )  { _fileSuffixes = suffixes; }
+
+	/// The path convertor is used to convert the input paths and to query the WAD info cache with the same paths
+	/// as the rest of the application does. The model doesn't modify it.
+	void setPathContext( const PathConvertor * pathConvertor )  { _pathContext = pathConvertor; }
+
+	/// Displays the title pictures of the map packs as the icons, they're loaded in the background through g_thumbnailCache.
+	/** The view should set its icon size to ThumbnailCache::thumbnailSize(). */
+	void toggleThumbnails( bool enabled );
+
+	/// Clears the model and starts loading the root directories in the background, each of them in parallel.
+	/** Does nothing if the directories are the same as the current ones. */
+	void setRootPaths( const QStringVec & dirPaths );
+	/// Absolute paths of the root directories.
+	const QStringVec & rootPaths() const  { return _rootPaths; }
+
+	/// Lists all the loaded directories inside dirPath again in the background and updates only the entries that changed.
+	/** If dirPath is empty, it refreshes all the root directories. */
+	void refresh( const QString & dirPath = {} );
+
+	/// Makes sure all the directories on the way to these paths are loaded, so that index() can find the paths.
+	/** Returns true if they are already loaded. Otherwise starts loading them, returns false and calls the callback
+	  * when they are loaded, unless the context has been destroyed in the meantime. The paths that don't exist or are
+	  * outside of the root directories don't prevent it, index() will just return invalid index for them.
+	  * Replaces the previous request. */
+	bool ensurePathsLoaded( const QStringVec & paths, QObject * context, LoadedCallback callback );
+
+	/// Returns the index of an entry in the name column, or invalid index if it's not loaded yet or doesn't exist.
+	QModelIndex index( const QString & path ) const;
+	QString filePath( const QModelIndex & index ) const;
+	bool isDir( const QModelIndex & index ) const;
+
+	/// For the diagnostics dialog that displays how long the listing takes.
+	const AsyncDirTraverser & dirTraverser() const  { return _traverser; }
+
+	//-- implementation of QAbstractItemModel's virtual methods --------------------------------------------------------
+
+	virtual QModelIndex index( int row, int column, const QModelIndex & parent = QModelIndex() ) const override;
+	virtual QModelIndex parent( const QModelIndex & index ) const override;
+	virtual int rowCount( const QModelIndex & parent = QModelIndex() ) const override;
+	virtual int columnCount( const QModelIndex & parent = QModelIndex() ) const override;
+	virtual bool hasChildren( const QModelIndex & parent = QModelIndex() ) const override;
+	virtual bool canFetchMore( const QModelIndex & parent ) const override;
+	virtual void fetchMore( const QModelIndex & parent ) override;
+	virtual Qt::ItemFlags flags( const QModelIndex & index ) const override;
+	virtual QVariant data( const QModelIndex & index, int role ) const override;
+	virtual QVariant headerData( int section, Qt::Orientation orientation, int role ) const override;
+	virtual QStringList mimeTypes() const override;
+	virtual QMimeData * mimeData( const QModelIndexList & indexes ) const override;
+
+ private:
+
+	struct Node;
+
+	enum class LoadState : uint8_t
+	{
+		NotLoaded,
+		Loading,
+		Loaded,
+	};
+
+	Node * getNode( const QModelIndex & index ) const;
+	QModelIndex getIndex( const Node * node, int column = NameColumn ) const;
+	/// Returns the node of the root directory the path is inside of, and where the names below the root begin in the path.
+	Node * findRootNode( const QString & absPath, int & namesBegin ) const;
+	/// Returns the deepest loaded node on the way to the path, and whether it's the node of the path itself.
+	Node * findDeepestNode( const QString & absPath, bool & found ) const;
+	QString toAbsolutePath( const QString & path ) const;
+
+	void startLoading( Node * dirNode );
+	void onDirListed( Node * dirNode, QList< QFileInfo > && entries );
+	void insertEntries( Node * dirNode, int row, std::vector< std::unique_ptr< Node > > && newNodes );
+	void removeEntries( Node * dirNode, int row, int count );
+	void forgetSubtree( Node * node );
+
+	void requestWadInfo( Node * fileNode );
+	void onWadInfoRead( const QString & absPath, quint64 rootGeneration, const doom::UncertainWadInfo & wadInfo );
+	void onThumbnailsReady( const QStringList & absPaths );
+	void markInfoChanged( const Node * fileNode );
+	void emitInfoChanges();
+
+	/// Continues loading the directories needed by ensurePathsLoaded(), calls the callback when there is nothing more to load.
+	void advancePendingLoad();
+	bool advanceLoadOfPath( const QString & absPath );  ///< returns true when the path is resolved
+
+ private:
+
+	/// With a single root directory this is its node, otherwise it has no path and its children are the root directories.
+	std::unique_ptr< Node > _root;
+	QStringVec _rootPaths;  ///< absolute
+	quint64 _rootGeneration = 0;  ///< incremented when the root is replaced, so that late results are recognized
+
+	QStringVec _fileSuffixes;
+	const PathConvertor * _pathContext = nullptr;
+	bool _thumbnailsEnabled = false;
+
+	AsyncDirTraverser _traverser;  ///< the listing jobs are identified by the directory nodes
+
+	struct PendingLoad
+	{
+		QStringVec absPaths;
+		QPointer< QObject > context;
+		LoadedCallback callback;
+	};
+	std::optional< PendingLoad > _pendingLoad;
+
+	/// the WAD info and the thumbnails arrive file by file, so the changes are collected and the views notified about them in bulk
+	QHash< Node *, QPair< int, int > > _pendingInfoChanges;  ///< key is directory, value is range of rows
+	QTimer _infoChangesTimer;
+
+};
+
+
+#endif // MAP_PACK_MODEL_INCLUDED
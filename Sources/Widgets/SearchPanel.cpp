@@ -6,15 +6,27 @@
 #include <QCheckBox>
 
 
+// short enough not to be noticed, long enough to skip the intermediate phrases when typing fast
+static constexpr int PhraseDebounceMs = 150;
+
+
 SearchPanel::SearchPanel(
-	QToolButton * showBtn, QLineEdit * searchLine, QCheckBox * caseChkBox, QCheckBox * regexChkBox
+	QToolButton * showBtn, QLineEdit * searchLine, QCheckBox * caseChkBox, QCheckBox * regexChkBox,
+	QCheckBox * contentChkBox
 ) :
-	showBtn( showBtn ), searchLine( searchLine ), caseChkBox( caseChkBox ), regexChkBox( regexChkBox )
+	showBtn( showBtn ), searchLine( searchLine ), caseChkBox( caseChkBox ), regexChkBox( regexChkBox ),
+	contentChkBox( contentChkBox )
 {
 	connect( showBtn, &QToolButton::clicked, this, &thisClass::toggleExpanded );
 	connect( searchLine, &QLineEdit::textChanged, this, &thisClass::changeSearchPhrase );
 	connect( caseChkBox, &QCheckBox::toggled, this, &thisClass::toggleCaseSensitive );
 	connect( regexChkBox, &QCheckBox::toggled, this, &thisClass::toggleUseRegex );
+	if (contentChkBox)
+		connect( contentChkBox, &QCheckBox::toggled, this, &thisClass::toggleSearchContent );
+
+	phraseTimer.setSingleShot( true );
+	phraseTimer.setInterval( PhraseDebounceMs );
+	connect( &phraseTimer, &QTimer::timeout, this, &thisClass::emitSearchParams );
 }
 
 void SearchPanel::setExpanded( bool expanded )
@@ -27,6 +39,8 @@ void SearchPanel::setExpanded( bool expanded )
 	searchLine->setVisible( expanded );
 	caseChkBox->setVisible( expanded );
 	regexChkBox->setVisible( expanded );
+	if (contentChkBox)
+		contentChkBox->setVisible( expanded );
 
 	showBtn->setArrowType( expanded ? Qt::ArrowType::DownArrow : Qt::ArrowType::UpArrow );
 }
@@ -49,15 +63,30 @@ void SearchPanel::toggleExpanded()
 
 void SearchPanel::changeSearchPhrase( const QString & phrase )
 {
-	emit searchParamsChanged( phrase, caseChkBox->isChecked(), regexChkBox->isChecked() );
+	if (phrase.isEmpty())
+		emitSearchParams();  // restoring the full list should be immediate
+	else
+		phraseTimer.start();  // restarts it if it's already running
+}
+
+void SearchPanel::toggleCaseSensitive( bool )
+{
+	emitSearchParams();
+}
+
+void SearchPanel::toggleUseRegex( bool )
+{
+	emitSearchParams();
 }
 
-void SearchPanel::toggleCaseSensitive( bool enable )
+void SearchPanel::toggleSearchContent( bool )
 {
-	emit searchParamsChanged( searchLine->text(), enable, regexChkBox->isChecked() );
+	emitSearchParams();
 }
 
-void SearchPanel::toggleUseRegex( bool enable )
+void SearchPanel::emitSearchParams()
 {
-	emit searchParamsChanged( searchLine->text(), caseChkBox->isChecked(), enable );
+	phraseTimer.stop();  // when called directly
+	bool searchContent = contentChkBox && contentChkBox->isChecked();
+	emit searchParamsChanged( searchLine->text(), caseChkBox->isChecked(), regexChkBox->isChecked(), searchContent );
 }
@@ -1,4 +1,5 @@
 #include <QObject>
+#include <QTimer>
 
 class QString;
 class QToolButton;
@@ -13,7 +14,11 @@ class SearchPanel : public QObject {
 
  public:
 
-	SearchPanel( QToolButton * showBtn, QLineEdit * searchPhraseLine, QCheckBox * caseChkBox, QCheckBox * regexChkBox );
+	/// The contentChkBox can be nullptr if the list doesn't support searching through the content of its items.
+	SearchPanel(
+		QToolButton * showBtn, QLineEdit * searchPhraseLine, QCheckBox * caseChkBox, QCheckBox * regexChkBox,
+		QCheckBox * contentChkBox = nullptr
+	);
 	~SearchPanel() override {}
 
  public slots:
@@ -26,10 +31,15 @@ class SearchPanel : public QObject {
 	void changeSearchPhrase( const QString & phrase );
 	void toggleCaseSensitive( bool enable );
 	void toggleUseRegex( bool enable );
+	void toggleSearchContent( bool enable );
+
+ private slots:
+
+	void emitSearchParams();
 
  signals:
 
-	void searchParamsChanged( const QString & phrase, bool caseSensitive, bool useRegex );
+	void searchParamsChanged( const QString & phrase, bool caseSensitive, bool useRegex, bool searchContent );
 
  public:
 
@@ -37,5 +47,10 @@ class SearchPanel : public QObject {
 	QLineEdit * searchLine;
 	QCheckBox * caseChkBox;
 	QCheckBox * regexChkBox;
+	QCheckBox * contentChkBox;
+
+ private:
+
+	QTimer phraseTimer;  ///< delays the search until the user stops typing
 
 };
@@ -6,29 +6,64 @@
 //======================================================================================================================
 
 #include "MainWindow.hpp"
+#include "HeadlessLaunch.hpp"
+#ifdef DEV_TOOLS_BUILD
+	#include "TestLibraryGenerator.hpp"
+#endif
 #include "Themes.hpp"
 #include "Utils/StandardOutput.hpp"
+#include "Utils/TimeStats.hpp"  // g_startupTimeline
+#include "Utils/ErrorHandling.hpp"  // installLogFlushHandlers
 
 #include <QApplication>
 #include <QDir>
+#include <QStringList>
 
 
 //======================================================================================================================
 
 int main( int argc, char * argv [] )
 {
+	g_startupTimeline.init( argc, argv );
+
 	QApplication a( argc, argv );
+	g_startupTimeline.addTimePoint( "QApplication construction" );
 
 	// All stored relative paths are relative to the directory of this application,
 	// launching it from a different current working directory would break it.
 	QDir::setCurrent( QApplication::applicationDirPath() );
 
 	initStdStreams();
+	installLogFlushHandlers();
+
+	// A preset can be launched from a desktop shortcut or a script without opening the launcher window.
+	QStringList args = QApplication::arguments();
+	int launchArgIdx = int( args.indexOf( "--launch" ) );
+	if (launchArgIdx >= 0)
+	{
+		if (launchArgIdx + 1 >= args.size())
+		{
+			stderrStream << "Usage: " << args[0] << " --launch \"<preset name>\" [--dry-run]" << Qt::endl;
+			return 1;
+		}
+		return launchPresetHeadless( args[ launchArgIdx + 1 ], args.contains( "--dry-run" ) );
+	}
+
+ #ifdef DEV_TOOLS_BUILD
+	// a fake installation for measuring how the launcher scales with the number of files and presets
+	int generateArgIdx = int( args.indexOf( "--generate-test-library" ) );
+	if (generateArgIdx >= 0)
+	{
+		return generateTestLibrary( args.mid( generateArgIdx + 1 ) );
+	}
+ #endif
 
 	themes::init();
+	g_startupTimeline.addTimePoint( "theme init" );
 
 	MainWindow w;
 	w.show();
+	g_startupTimeline.addTimePoint( "show" );
 	int exitCode = a.exec();
 
 	return exitCode;